@@ -0,0 +1,167 @@
+#include "Benchmark.h"
+
+#include <fstream>
+#include <sstream>
+
+// --------------------------------------------------------
+// Defaults, for when the command line leaves something out
+// --------------------------------------------------------
+Benchmark::Settings Benchmark::GetDefaultSettings()
+{
+	Settings settings = {};
+	settings.Enabled = false;
+	settings.WarmUpFrames = 120;
+	settings.Frames = 1200;
+	settings.TimeStep = 1.0f / 60.0f;
+	settings.ResultsFile = "BenchmarkResults.csv";
+	settings.ScreenshotFile = "BenchmarkScreenshot.ppm";
+	return settings;
+}
+
+// --------------------------------------------------------
+// Reads benchmark settings from the command line
+//
+// commandLine - Arguments only, as WinMain() gets them
+// settings    - Filled in from the defaults and the arguments
+// --------------------------------------------------------
+bool Benchmark::ParseCommandLine(const char* commandLine, Settings* settings)
+{
+	*settings = GetDefaultSettings();
+	if (!commandLine)
+		return true;
+
+	std::istringstream arguments(commandLine);
+	std::string argument;
+	bool enabled = false;
+	while (arguments >> argument)
+	{
+		if (argument == "-benchmark")
+			enabled = true;
+		else if (argument == "-frames")
+			arguments >> settings->Frames;
+		else if (argument == "-warmup")
+			arguments >> settings->WarmUpFrames;
+		else if (argument == "-timestep")
+			arguments >> settings->TimeStep;
+		else if (argument == "-camerapath")
+			arguments >> settings->CameraPathFile;
+		else if (argument == "-results")
+			arguments >> settings->ResultsFile;
+		else if (argument == "-screenshot")
+			arguments >> settings->ScreenshotFile;
+
+		// A flag missing its value (or given a bad one)
+		if (arguments.fail())
+			return false;
+	}
+
+	if (enabled && (settings->Frames == 0 || settings->TimeStep <= 0.0f))
+		return false;
+
+	settings->Enabled = enabled;
+	return true;
+}
+
+// --------------------------------------------------------
+// Constructor - loads the camera path, falling back to an
+// orbit around the scene if there isn't one
+// --------------------------------------------------------
+Benchmark::Benchmark(const Settings& settings)
+	:
+	settings(settings),
+	loadedPath(false),
+	framesStarted(0),
+	lastFrameStart(),
+	frameTimes(settings.Frames)
+{
+	if (!settings.CameraPathFile.empty())
+		loadedPath = path.LoadFromFile(settings.CameraPathFile);
+	if (!loadedPath)
+		path = CameraPath::CreateOrbit(15.0f, 2.5f, 20.0f);
+}
+
+// --------------------------------------------------------
+// Moves on to the next frame, timing the one that just ended
+// if it was measured
+// --------------------------------------------------------
+void Benchmark::BeginFrame()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	// The frame ending now is number framesStarted - 1, counting from zero
+	if (framesStarted > settings.WarmUpFrames && framesStarted <= settings.WarmUpFrames + settings.Frames)
+	{
+		frameTimes.AddFrame(std::chrono::duration<double, std::milli>(now - lastFrameStart).count());
+	}
+
+	lastFrameStart = now;
+	framesStarted++;
+}
+
+// --------------------------------------------------------
+// Where the camera should be this frame - simulated time
+// only, so every run sees exactly the same views
+// --------------------------------------------------------
+void Benchmark::GetCameraPose(float position[3], float rotation[3])
+{
+	unsigned int frame = framesStarted > 0 ? framesStarted - 1 : 0;
+	path.Evaluate(frame * settings.TimeStep, position, rotation);
+}
+
+// --------------------------------------------------------
+// Adds a number to the results file
+// --------------------------------------------------------
+void Benchmark::AddResult(const std::string& name, double value)
+{
+	extraResults.push_back(std::make_pair(name, value));
+}
+
+// --------------------------------------------------------
+// Writes the run's settings, frame time stats, extra numbers
+// and screenshot hash as name,value lines
+// --------------------------------------------------------
+bool Benchmark::WriteResults(uint64_t screenshotHash, bool screenshotCaptured)
+{
+	std::ofstream results(settings.ResultsFile);
+	if (!results.is_open())
+		return false;
+
+	FrameTimeStats::Summary summary = frameTimes.GetRecentSummary();
+	results << "name,value\n";
+	results << "warmup_frames," << settings.WarmUpFrames << "\n";
+	results << "frames," << summary.Frames << "\n";
+	results << "timestep_s," << settings.TimeStep << "\n";
+	results << "camera_path," << (loadedPath ? settings.CameraPathFile : "orbit") << "\n";
+	results << "mean_ms," << summary.Mean << "\n";
+	results << "p50_ms," << summary.P50 << "\n";
+	results << "p95_ms," << summary.P95 << "\n";
+	results << "p99_ms," << summary.P99 << "\n";
+	results << "max_ms," << summary.Max << "\n";
+	results << "over_budget," << summary.OverBudget << "\n";
+	for (const std::pair<std::string, double>& extra : extraResults)
+		results << extra.first << "," << extra.second << "\n";
+
+	// Hex, so it reads the same in any tool
+	std::ostringstream hash;
+	hash << std::hex;
+	hash.width(16);
+	hash.fill('0');
+	hash << screenshotHash;
+	results << "screenshot_hash," << (screenshotCaptured ? hash.str() : "none") << "\n";
+
+	return results.good();
+}
+
+// --------------------------------------------------------
+// FNV-1a over a block of bytes
+// --------------------------------------------------------
+uint64_t Benchmark::Hash(const void* data, size_t size, uint64_t hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
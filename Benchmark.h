@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "CameraPath.h"
+#include "FrameTimeStats.h"
+
+// --------------------------------------------------------
+// A repeatable benchmark run: a fixed number of frames along
+// a camera path, at a fixed simulated time step
+//
+// - Warm-up frames run first, so shader caches, streaming and
+//   clocks settle before anything is measured
+// - Measured frames are timed by the wall clock, between
+//   consecutive calls to BeginFrame()
+// - The results file is plain name,value lines, so runs can
+//   be diffed or collected by a script
+// - No graphics dependencies - the game supplies the camera
+//   and the final screenshot's hash
+// --------------------------------------------------------
+class Benchmark
+{
+public:
+	struct Settings
+	{
+		bool Enabled;
+		unsigned int WarmUpFrames;
+		unsigned int Frames;			// Measured, after warming up
+		float TimeStep;					// Simulated seconds per frame
+		std::string CameraPathFile;		// From CameraPath::SaveToFile() - empty for the built-in orbit
+		std::string ResultsFile;
+		std::string ScreenshotFile;		// The final frame, as a PPM
+	};
+
+	// Defaults, for when the command line leaves something out
+	static Settings GetDefaultSettings();
+
+	// Reads settings from a command line like:
+	//   -benchmark [-frames N] [-warmup N] [-timestep seconds]
+	//              [-camerapath file] [-results file] [-screenshot file]
+	// - Enabled is only set if -benchmark is there
+	// - Returns false (and leaves benchmarking off) on anything it can't read
+	static bool ParseCommandLine(const char* commandLine, Settings* settings);
+
+	Benchmark(const Settings& settings);
+
+	// Call at the start of every frame, before updating
+	void BeginFrame();
+
+	// Where the camera should be this frame
+	void GetCameraPose(float position[3], float rotation[3]);
+
+	// Is this the last measured frame (the one to take a screenshot of)?
+	bool IsFinalFrame() { return framesStarted == settings.WarmUpFrames + settings.Frames; }
+
+	// Has the last measured frame finished?
+	bool IsFinished() { return framesStarted > settings.WarmUpFrames + settings.Frames; }
+
+	// Is this the first frame after the last measured one?
+	bool JustFinished() { return framesStarted == settings.WarmUpFrames + settings.Frames + 1; }
+
+	// Extra numbers for the results file, like GPU timings
+	void AddResult(const std::string& name, double value);
+
+	// Writes the settings, frame time stats, extra results and
+	// the final screenshot's hash
+	bool WriteResults(uint64_t screenshotHash, bool screenshotCaptured);
+
+	// FNV-1a, for hashing screenshots a row at a time
+	// - Start with HashSeed, and feed each call's result into the next
+	static const uint64_t HashSeed = 14695981039346656037ULL;
+	static uint64_t Hash(const void* data, size_t size, uint64_t hash);
+
+	// Getters
+	const Settings& GetSettings() { return settings; }
+	unsigned int GetFramesStarted() { return framesStarted; }
+	FrameTimeStats& GetFrameTimes() { return frameTimes; }
+
+private:
+	Settings settings;
+	CameraPath path;
+	bool loadedPath;
+
+	// Frames started so far, counting the current one
+	unsigned int framesStarted;
+	std::chrono::steady_clock::time_point lastFrameStart;
+
+	FrameTimeStats frameTimes;
+	std::vector<std::pair<std::string, double>> extraResults;
+};
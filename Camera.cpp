@@ -9,6 +9,8 @@ Camera::Camera(float x, float y, float z, float aspectRatio, float fieldOfView,
 
     this->fieldOfView = fieldOfView;
     this->aspectRatio = aspectRatio;
+    this->nearClip = 0.01f;
+    this->farClip = 100.0f;
 
     this->movementSpeed = movementSpeed;
     this->mouseLookSpeed = mouseLookSpeed;
@@ -98,16 +100,26 @@ void Camera::UpdateViewMatrix()
 
 void Camera::UpdateProjectionMatrix(float aspectRatio)
 {
+    // Remember it, so anything rebuilding data from the projection sees the same values
+    this->aspectRatio = aspectRatio;
+
     // Z positive goes INTO the screen with Left Hand
     XMMATRIX proj = XMMatrixPerspectiveFovLH(
         fieldOfView,
         aspectRatio,
-        0.01f,
-        100.0f
+        nearClip,
+        farClip
     );
     XMStoreFloat4x4(&projMatrix, proj);
 }
 
+void Camera::SetPose(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 pitchYawRoll)
+{
+    transform.SetPosition(position.x, position.y, position.z);
+    transform.SetPitchYawRoll(pitchYawRoll.x, pitchYawRoll.y, pitchYawRoll.z);
+    UpdateViewMatrix();
+}
+
 DirectX::XMFLOAT4X4 Camera::GetView()
 {
     return viewMatrix;
@@ -132,3 +144,13 @@ float* Camera::GetAspectRatio()
 {
     return &aspectRatio;
 }
+
+float Camera::GetNearClip()
+{
+    return nearClip;
+}
+
+float Camera::GetFarClip()
+{
+    return farClip;
+}
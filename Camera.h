@@ -15,11 +15,16 @@ public:
 	void UpdateViewMatrix();
 	void UpdateProjectionMatrix(float aspectRatio);
 
+	// Places the camera directly, ignoring input (for scripted paths)
+	void SetPose(DirectX::XMFLOAT3 position, DirectX::XMFLOAT3 pitchYawRoll);
+
 	DirectX::XMFLOAT4X4 GetView();
 	DirectX::XMFLOAT4X4 GetProjection();
 	Transform GetTransform();
 	float* GetFOV();
 	float* GetAspectRatio();
+	float GetNearClip();
+	float GetFarClip();
 
 private:
 	DirectX::XMFLOAT4X4 viewMatrix;
@@ -29,6 +34,8 @@ private:
 
 	float fieldOfView;
 	float aspectRatio;
+	float nearClip;
+	float farClip;
 
 	float movementSpeed;
 	float mouseLookSpeed;
@@ -0,0 +1,169 @@
+#include "CameraPath.h"
+
+#include <fstream>
+#include <math.h>
+#include <sstream>
+
+// --------------------------------------------------------
+// Catmull-Rom between p1 and p2, with p0 and p3 as neighbours
+// --------------------------------------------------------
+static float CatmullRom(float p0, float p1, float p2, float p3, float t)
+{
+	float t2 = t * t;
+	float t3 = t2 * t;
+	return 0.5f * (
+		2.0f * p1 +
+		(p2 - p0) * t +
+		(2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+		(3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+// --------------------------------------------------------
+// Constructor
+// --------------------------------------------------------
+CameraPath::CameraPath()
+{
+}
+
+// --------------------------------------------------------
+// Adds a key to the end of the path
+// --------------------------------------------------------
+void CameraPath::AddKey(const Key& key)
+{
+	keys.push_back(key);
+}
+
+// --------------------------------------------------------
+// Where the camera is at a time along the path
+//
+// - The path wraps around once it runs out, so a benchmark
+//   can run for longer than the path does
+// - The first and last keys stand in for their own missing
+//   neighbours, so the path starts and stops smoothly
+// --------------------------------------------------------
+bool CameraPath::Evaluate(float time, float position[3], float rotation[3])
+{
+	if (keys.empty())
+		return false;
+
+	float duration = GetDuration();
+	if (duration > 0.0f)
+	{
+		time = fmodf(time, duration);
+		if (time < 0.0f)
+			time += duration;
+	}
+
+	// The segment this time falls in
+	size_t next = 0;
+	while (next < keys.size() && keys[next].Time <= time)
+		next++;
+	size_t current = next > 0 ? next - 1 : 0;
+	if (next >= keys.size())
+		next = keys.size() - 1;
+
+	const Key& k1 = keys[current];
+	const Key& k2 = keys[next];
+	const Key& k0 = keys[current > 0 ? current - 1 : current];
+	const Key& k3 = keys[next + 1 < keys.size() ? next + 1 : next];
+
+	float span = k2.Time - k1.Time;
+	float t = span > 0.0f ? (time - k1.Time) / span : 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		position[i] = CatmullRom(k0.Position[i], k1.Position[i], k2.Position[i], k3.Position[i], t);
+		rotation[i] = CatmullRom(k0.Rotation[i], k1.Rotation[i], k2.Rotation[i], k3.Rotation[i], t);
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Loads keys from a text file, one per line:
+//   time x y z pitch yaw roll
+// Blank lines and lines starting with # are skipped
+// --------------------------------------------------------
+bool CameraPath::LoadFromFile(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+		return false;
+
+	std::vector<Key> loaded;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream values(line);
+		Key key = {};
+		values >> key.Time
+			>> key.Position[0] >> key.Position[1] >> key.Position[2]
+			>> key.Rotation[0] >> key.Rotation[1] >> key.Rotation[2];
+		if (values.fail())
+			return false;
+
+		// Keys have to stay in order for Evaluate() to find them
+		if (!loaded.empty() && key.Time < loaded.back().Time)
+			return false;
+		loaded.push_back(key);
+	}
+
+	if (loaded.empty())
+		return false;
+
+	keys = loaded;
+	return true;
+}
+
+// --------------------------------------------------------
+// Saves keys in the format LoadFromFile() reads
+// --------------------------------------------------------
+bool CameraPath::SaveToFile(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+		return false;
+
+	file << "# time x y z pitch yaw roll\n";
+	file.precision(7);
+	for (const Key& key : keys)
+	{
+		file << key.Time << " "
+			<< key.Position[0] << " " << key.Position[1] << " " << key.Position[2] << " "
+			<< key.Rotation[0] << " " << key.Rotation[1] << " " << key.Rotation[2] << "\n";
+	}
+	return file.good();
+}
+
+// --------------------------------------------------------
+// A full turn around the origin, starting behind it (on -Z)
+// and looking in at it, bobbing up and down as it goes
+//
+// radius   - Distance from the origin on the XZ plane
+// height   - Average height above the origin
+// duration - Seconds for the whole turn
+// --------------------------------------------------------
+CameraPath CameraPath::CreateOrbit(float radius, float height, float duration)
+{
+	const int segments = 16;
+	const float pi = 3.14159265f;
+
+	CameraPath path;
+	for (int i = 0; i <= segments; i++)
+	{
+		float angle = 2.0f * pi * i / segments;
+		float y = height * (1.0f + 0.5f * sinf(2.0f * angle));
+
+		Key key = {};
+		key.Time = duration * i / segments;
+		key.Position[0] = -radius * sinf(angle);
+		key.Position[1] = y;
+		key.Position[2] = -radius * cosf(angle);
+		key.Rotation[0] = atan2f(y, radius);	// Pitch down towards the origin
+		key.Rotation[1] = angle;				// Yaw keeps growing, so the loop doesn't spin back
+		key.Rotation[2] = 0.0f;
+		path.AddKey(key);
+	}
+	return path;
+}
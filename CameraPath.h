@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// A camera path through timed keys, for repeatable flythroughs
+//
+// - Positions and rotations (pitch, yaw, roll) are smoothed
+//   with a Catmull-Rom spline through every key
+// - Rotations are interpolated as plain angles, so recorded
+//   yaw should keep growing past a full turn rather than
+//   wrapping (which is what Transform::Rotate() does anyway)
+// - Saved as text, one key per line: time x y z pitch yaw roll
+// - No graphics dependencies
+// --------------------------------------------------------
+class CameraPath
+{
+public:
+	struct Key
+	{
+		float Time;			// Seconds from the start of the path
+		float Position[3];
+		float Rotation[3];	// Pitch, yaw, roll
+	};
+
+	CameraPath();
+
+	// Keys must be added in time order
+	void AddKey(const Key& key);
+	void Clear() { keys.clear(); }
+
+	// Where the camera is at a time along the path, wrapping
+	// around once the path runs out
+	// - Returns false if there are no keys
+	bool Evaluate(float time, float position[3], float rotation[3]);
+
+	bool LoadFromFile(const std::string& path);
+	bool SaveToFile(const std::string& path);
+
+	// A slow loop around the origin, looking in at it
+	static CameraPath CreateOrbit(float radius, float height, float duration);
+
+	// Getters
+	unsigned int GetKeyCount() { return (unsigned int)keys.size(); }
+	float GetDuration() { return keys.empty() ? 0.0f : keys.back().Time; }
+
+private:
+	std::vector<Key> keys;
+};
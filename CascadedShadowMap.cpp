@@ -0,0 +1,142 @@
+#include "CascadedShadowMap.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Constructor - Creates the texture arrays (one slice per
+// cascade), their views, and the states for drawing them
+//
+// resolution - Width and height of each cascade
+// --------------------------------------------------------
+CascadedShadowMap::CascadedShadowMap(Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int resolution)
+	:
+	cascades(resolution),
+	rendered(),
+	cached()
+{
+	// Typeless, so it can be both a depth buffer and a texture
+	D3D11_TEXTURE2D_DESC shadowDesc = {};
+	shadowDesc.Width = resolution;
+	shadowDesc.Height = resolution;
+	shadowDesc.ArraySize = MaxCascades;
+	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	shadowDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	shadowDesc.MipLevels = 1;
+	shadowDesc.SampleDesc.Count = 1;
+	shadowDesc.Usage = D3D11_USAGE_DEFAULT;
+	if (FAILED(device->CreateTexture2D(&shadowDesc, 0, shadowTexture.GetAddressOf())))
+		return;
+
+	// The static cache matches it exactly, so it can be copied over whole
+	if (FAILED(device->CreateTexture2D(&shadowDesc, 0, staticTexture.GetAddressOf())))
+		return;
+
+	// One depth view per cascade, in each
+	for (unsigned int i = 0; i < MaxCascades; i++)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		dsvDesc.Texture2DArray.MipSlice = 0;
+		dsvDesc.Texture2DArray.FirstArraySlice = i;
+		dsvDesc.Texture2DArray.ArraySize = 1;
+		device->CreateDepthStencilView(shadowTexture.Get(), &dsvDesc, cascadeDSVs[i].GetAddressOf());
+		device->CreateDepthStencilView(staticTexture.Get(), &dsvDesc, staticDSVs[i].GetAddressOf());
+	}
+
+	// And one texture view of all of them
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = MaxCascades;
+	device->CreateShaderResourceView(shadowTexture.Get(), &srvDesc, srv.GetAddressOf());
+
+	// Comparison sampler - anything outside the map is lit
+	D3D11_SAMPLER_DESC sampDesc = {};
+	sampDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
+	sampDesc.ComparisonFunc = D3D11_COMPARISON_LESS;
+	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+	sampDesc.BorderColor[0] = 1.0f;
+	sampDesc.BorderColor[1] = 1.0f;
+	sampDesc.BorderColor[2] = 1.0f;
+	sampDesc.BorderColor[3] = 1.0f;
+	device->CreateSamplerState(&sampDesc, sampler.GetAddressOf());
+
+	// Biased to avoid acne, and without depth clipping, so casters between
+	// the light and the cascade are flattened onto its near plane
+	D3D11_RASTERIZER_DESC rastDesc = {};
+	rastDesc.FillMode = D3D11_FILL_SOLID;
+	rastDesc.CullMode = D3D11_CULL_BACK;
+	rastDesc.DepthClipEnable = false;
+	rastDesc.DepthBias = 1000; // Multiplied by (smallest possible positive value storable in the depth buffer)
+	rastDesc.DepthBiasClamp = 0.0f;
+	rastDesc.SlopeScaledDepthBias = 1.0f;
+	device->CreateRasterizerState(&rastDesc, rasterizer.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// Fits every cascade to its slice of the camera's frustum
+// --------------------------------------------------------
+void CascadedShadowMap::Fit(
+	const XMFLOAT4X4& view,
+	float fieldOfView,
+	float aspectRatio,
+	float nearClip,
+	XMFLOAT3 lightDirection,
+	unsigned int cascadeCount,
+	float shadowDistance,
+	float splitLambda,
+	float casterDistance)
+{
+	cascades.Fit(view, fieldOfView, aspectRatio, nearClip, lightDirection, cascadeCount, shadowDistance, splitLambda, casterDistance);
+}
+
+// --------------------------------------------------------
+// Compares the current placement and casters with what a
+// depth array was last drawn with
+//
+// The placement is whole texels along the light's axes, so
+// small camera moves leave it (and the map) untouched, and
+// it covers every input except the casters themselves
+// --------------------------------------------------------
+bool CascadedShadowMap::Matches(const Contents& contents, uint64_t casterVersion)
+{
+	return
+		contents.Valid &&
+		contents.CasterVersion == casterVersion &&
+		ShadowCascades::SamePlacement(contents.Placement, cascades.GetPlacement());
+}
+
+// --------------------------------------------------------
+// Records what a depth array now holds
+// --------------------------------------------------------
+void CascadedShadowMap::Record(Contents& contents, uint64_t casterVersion)
+{
+	contents.Valid = true;
+	contents.Placement = cascades.GetPlacement();
+	contents.CasterVersion = casterVersion;
+}
+
+// --------------------------------------------------------
+// Starts the map over from the static casters
+// - Both arrays share a description, and depth resources can
+//   only be copied whole, so this copies every slice at once
+// --------------------------------------------------------
+void CascadedShadowMap::RestoreStatic(ID3D11DeviceContext* context)
+{
+	context->CopyResource(shadowTexture.Get(), staticTexture.Get());
+}
+
+// --------------------------------------------------------
+// Forces both the map and the static cache to be redrawn
+// --------------------------------------------------------
+void CascadedShadowMap::Invalidate()
+{
+	rendered.Valid = false;
+	cached.Valid = false;
+}
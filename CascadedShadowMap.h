@@ -0,0 +1,92 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <stdint.h>
+
+#include "ShadowCascades.h"
+
+// --------------------------------------------------------
+// Shadows for one directional light, split into cascades
+//
+// - ShadowCascades works out where the cascades go; this
+//   holds the GPU side, with each cascade in one slice of a
+//   Texture2DArray
+// - Remembers where the cascades were when it was last
+//   drawn, so callers can skip drawing when neither the
+//   cascades nor the casters have changed
+// - Keeps a second array holding only the static casters.
+//   While the cascades stay put, each frame starts from a
+//   copy of it and only dynamic casters are drawn on top
+// --------------------------------------------------------
+class CascadedShadowMap
+{
+public:
+	static const unsigned int MaxCascades = ShadowCascades::MaxCascades;
+	typedef ShadowCascades::Cascade Cascade;
+
+	CascadedShadowMap(Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int resolution = 2048);
+
+	// Fits the cascades to the camera's view for this frame (see ShadowCascades::Fit())
+	void Fit(
+		const DirectX::XMFLOAT4X4& view,
+		float fieldOfView,
+		float aspectRatio,
+		float nearClip,
+		DirectX::XMFLOAT3 lightDirection,
+		unsigned int cascadeCount,
+		float shadowDistance,
+		float splitLambda,
+		float casterDistance);
+
+	// Is what's in the map out of date?
+	// casterVersion - Changes whenever any caster does
+	bool NeedsRender(uint64_t casterVersion) { return !Matches(rendered, casterVersion); }
+	void MarkRendered(uint64_t casterVersion) { Record(rendered, casterVersion); }
+
+	// Is the static cache out of date?
+	// staticCasterVersion - Changes whenever a static caster does, or one
+	//                       becomes (or stops being) static
+	bool NeedsStaticRender(uint64_t staticCasterVersion) { return !Matches(cached, staticCasterVersion); }
+	void MarkStaticRendered(uint64_t staticCasterVersion) { Record(cached, staticCasterVersion); }
+
+	// Overwrites every cascade with the static casters' depth
+	void RestoreStatic(ID3D11DeviceContext* context);
+
+	void Invalidate();
+
+	// Getters
+	unsigned int GetCascadeCount() { return cascades.GetCascadeCount(); }
+	const Cascade& GetCascade(unsigned int index) { return cascades.GetCascade(index); }
+	unsigned int GetResolution() { return cascades.GetResolution(); }
+	ID3D11DepthStencilView* GetDSV(unsigned int index) { return cascadeDSVs[index].Get(); }
+	ID3D11DepthStencilView* GetStaticDSV(unsigned int index) { return staticDSVs[index].Get(); }
+	ID3D11ShaderResourceView* GetSRV() { return srv.Get(); }
+	ID3D11SamplerState* GetSampler() { return sampler.Get(); }
+	ID3D11RasterizerState* GetRasterizer() { return rasterizer.Get(); }
+
+private:
+	ShadowCascades cascades;
+
+	// What a depth array was last drawn with
+	struct Contents
+	{
+		bool Valid;
+		ShadowCascades::Placement Placement;
+		uint64_t CasterVersion;
+	};
+	Contents rendered;	// The map itself
+	Contents cached;	// The static casters only
+
+	bool Matches(const Contents& contents, uint64_t casterVersion);
+	void Record(Contents& contents, uint64_t casterVersion);
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> staticTexture;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> cascadeDSVs[MaxCascades];
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> staticDSVs[MaxCascades];
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizer;
+};
+
@@ -0,0 +1,63 @@
+#include "ClusterHeader.hlsli"
+
+// How many clusters each group culls, and lights it loads at once
+#define GROUP_SIZE 64
+
+cbuffer externalData : register(b0)
+{
+	uint cullLightCount;
+}
+
+// Inputs - both built on the CPU by ClusterGrid
+StructuredBuffer<ClusterBounds> Clusters		: register(t0);
+StructuredBuffer<ClusterCullLight> CullLights	: register(t1);
+
+// Outputs - a count per cluster, and MAX_LIGHTS_PER_CLUSTER slots per cluster
+RWStructuredBuffer<uint> ClusterLightCounts		: register(u0);
+RWStructuredBuffer<uint> ClusterLightIndices	: register(u1);
+
+// Each batch of lights is loaded once per group and shared
+groupshared ClusterCullLight sharedLights[GROUP_SIZE];
+
+// --------------------------------------------------------
+// One thread per cluster
+//
+// - Every thread walks the lights in order, so each list
+//   comes out in the same order as the CPU version's
+// - No atomics: each cluster owns its slots
+// --------------------------------------------------------
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID, uint groupIndex : SV_GroupIndex)
+{
+	uint cluster = id.x;
+	bool valid = cluster < CLUSTER_COUNT;
+
+	ClusterBounds bounds = Clusters[min(cluster, CLUSTER_COUNT - 1)];
+	uint count = 0;
+
+	for (uint first = 0; first < cullLightCount; first += GROUP_SIZE)
+	{
+		// Load this batch
+		if (first + groupIndex < cullLightCount)
+			sharedLights[groupIndex] = CullLights[first + groupIndex];
+		GroupMemoryBarrierWithGroupSync();
+
+		// Test it
+		uint batchCount = min(GROUP_SIZE, cullLightCount - first);
+		for (uint i = 0; valid && i < batchCount; i++)
+		{
+			ClusterCullLight light = sharedLights[i];
+			if (SphereIntersectsCluster(bounds, light.ViewPosition, light.Range) && count < MAX_LIGHTS_PER_CLUSTER)
+			{
+				ClusterLightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + count] = light.LightIndex;
+				count++;
+			}
+		}
+
+		// Don't overwrite the batch until everyone's done with it
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	if (valid)
+		ClusterLightCounts[cluster] = count;
+}
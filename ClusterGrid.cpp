@@ -0,0 +1,234 @@
+#include "ClusterGrid.h"
+#include "JobSystem.h"
+
+#include <math.h>
+#include <atomic>
+
+// --------------------------------------------------------
+// Constructor - the bounds are built by SetProjection()
+// --------------------------------------------------------
+ClusterGrid::ClusterGrid()
+	:
+	nearZ(0.0f),
+	farZ(0.0f),
+	depthScale(0.0f),
+	depthBias(0.0f),
+	lightCounts(ClusterCount),
+	lightIndices(ClusterCount * MaxLightsPerCluster),
+	overflowCount(0)
+{
+	bounds.resize(ClusterCount);
+}
+
+// --------------------------------------------------------
+// Builds every cluster's view space bounding box
+//
+// fieldOfViewY - Vertical field of view, in radians
+// aspectRatio  - Width over height
+// nearZ, farZ  - The projection's clip planes
+// --------------------------------------------------------
+void ClusterGrid::SetProjection(float fieldOfViewY, float aspectRatio, float nearZ, float farZ)
+{
+	this->nearZ = nearZ;
+	this->farZ = farZ;
+
+	// Slices are spaced so each is the same ratio deeper than the last
+	float logRatio = logf(farZ / nearZ);
+	depthScale = Slices / logRatio;
+	depthBias = -(Slices * logf(nearZ)) / logRatio;
+
+	float tanY = tanf(fieldOfViewY * 0.5f);
+	float tanX = tanY * aspectRatio;
+
+	for (unsigned int z = 0; z < Slices; z++)
+	{
+		float sliceNear = nearZ * powf(farZ / nearZ, (float)z / Slices);
+		float sliceFar = nearZ * powf(farZ / nearZ, (float)(z + 1) / Slices);
+
+		for (unsigned int y = 0; y < TilesY; y++)
+		{
+			// Tile rows go top to bottom, like pixels
+			float ndcTop = 1.0f - 2.0f * y / TilesY;
+			float ndcBottom = 1.0f - 2.0f * (y + 1) / TilesY;
+
+			for (unsigned int x = 0; x < TilesX; x++)
+			{
+				float ndcLeft = -1.0f + 2.0f * x / TilesX;
+				float ndcRight = -1.0f + 2.0f * (x + 1) / TilesX;
+
+				// The tile's frustum widens with depth, so the box has to
+				// cover its corners on both the near and far faces
+				ClusterBounds& b = bounds[GetClusterIndex(x, y, z)];
+				b = {};
+				b.Min[0] = fminf(ndcLeft * tanX * sliceNear, ndcLeft * tanX * sliceFar);
+				b.Max[0] = fmaxf(ndcRight * tanX * sliceNear, ndcRight * tanX * sliceFar);
+				b.Min[1] = fminf(ndcBottom * tanY * sliceNear, ndcBottom * tanY * sliceFar);
+				b.Max[1] = fmaxf(ndcTop * tanY * sliceNear, ndcTop * tanY * sliceFar);
+				b.Min[2] = sliceNear;
+				b.Max[2] = sliceFar;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Empties the light list, keeping its memory for next frame
+// --------------------------------------------------------
+void ClusterGrid::ClearLights()
+{
+	lights.clear();
+}
+
+// --------------------------------------------------------
+// Adds a light to cull
+//
+// viewPosition - The light's position in view space
+// range        - The light's range (where attenuation hits zero)
+// lightIndex   - What the clusters will store for this light
+// --------------------------------------------------------
+void ClusterGrid::AddLight(const float viewPosition[3], float range, unsigned int lightIndex)
+{
+	ClusterCullLight light = {};
+	light.ViewPosition[0] = viewPosition[0];
+	light.ViewPosition[1] = viewPosition[1];
+	light.ViewPosition[2] = viewPosition[2];
+	light.Range = range;
+	light.LightIndex = lightIndex;
+	lights.push_back(light);
+}
+
+// --------------------------------------------------------
+// Sphere vs. box, by squared distance to the box
+//
+// The shader does exactly these operations in exactly this
+// order (marked precise, so nothing is fused or reordered)
+// --------------------------------------------------------
+bool ClusterGrid::SphereIntersectsCluster(const ClusterBounds& bounds, const ClusterCullLight& light)
+{
+	float distanceSq = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		float v = light.ViewPosition[i];
+		if (v < bounds.Min[i])
+		{
+			float d = bounds.Min[i] - v;
+			distanceSq = distanceSq + d * d;
+		}
+		if (v > bounds.Max[i])
+		{
+			float d = v - bounds.Max[i];
+			distanceSq = distanceSq + d * d;
+		}
+	}
+	return distanceSq <= light.Range * light.Range;
+}
+
+// --------------------------------------------------------
+// Finds the slice for a view space depth, as the pixel
+// shader does
+// --------------------------------------------------------
+unsigned int ClusterGrid::GetSlice(float viewZ)
+{
+	float slice = floorf(logf(viewZ) * depthScale + depthBias);
+	if (slice < 0.0f) return 0;
+	if (slice >= Slices) return Slices - 1;
+	return (unsigned int)slice;
+}
+
+// --------------------------------------------------------
+// Clusters are stored slice by slice, row by row
+// --------------------------------------------------------
+unsigned int ClusterGrid::GetClusterIndex(unsigned int tileX, unsigned int tileY, unsigned int slice)
+{
+	return (slice * TilesY + tileY) * TilesX + tileX;
+}
+
+// --------------------------------------------------------
+// Fills every cluster's light list
+//
+// jobSystem - Optional; without it, everything runs on this thread
+// --------------------------------------------------------
+void ClusterGrid::Cull(JobSystem* jobSystem)
+{
+	if (!jobSystem)
+	{
+		unsigned int overflows = 0;
+		CullSlices(0, Slices, &overflows);
+		overflowCount = overflows;
+		return;
+	}
+
+	// Each job owns whole slices, so any split gives the same lists
+	std::atomic<unsigned int> overflows(0);
+	jobSystem->ParallelFor(0, Slices, 1,
+		[&](unsigned int begin, unsigned int end)
+		{
+			unsigned int rangeOverflows = 0;
+			CullSlices(begin, end, &rangeOverflows);
+			overflows += rangeOverflows;
+		});
+	overflowCount = overflows;
+}
+
+// --------------------------------------------------------
+// Culls every light against a range of depth slices
+//
+// Rather than testing every light against every cluster,
+// each light only visits the clusters it could touch.  The
+// lights are still visited in order, and the candidates get
+// the full test, so the lists match the brute force ones.
+//
+// overflows - Incremented for each cluster that ran out of slots
+// --------------------------------------------------------
+void ClusterGrid::CullSlices(unsigned int firstSlice, unsigned int endSlice, unsigned int* overflows)
+{
+	const unsigned int clustersPerSlice = TilesX * TilesY;
+	for (unsigned int c = firstSlice * clustersPerSlice; c < endSlice * clustersPerSlice; c++)
+		lightCounts[c] = 0;
+
+	std::vector<bool> overflowed(ClusterCount, false);
+
+	for (const ClusterCullLight& light : lights)
+	{
+		// The slices the sphere spans, plus one either side in case of rounding
+		float nearEdge = light.ViewPosition[2] - light.Range;
+		float farEdge = light.ViewPosition[2] + light.Range;
+		unsigned int lowSlice = nearEdge <= nearZ ? 0 : GetSlice(nearEdge);
+		unsigned int highSlice = farEdge <= nearZ ? 0 : GetSlice(farEdge);
+		lowSlice = lowSlice > firstSlice ? lowSlice - 1 : firstSlice;
+		highSlice = highSlice + 1 < endSlice ? highSlice + 1 : endSlice - 1;
+
+		float rangeSq = light.Range * light.Range;
+		for (unsigned int z = lowSlice; z <= highSlice; z++)
+		{
+			for (unsigned int y = 0; y < TilesY; y++)
+			{
+				// A row shares its Y extent, so one axis rejects the whole row
+				// - Same math as the full test, whose distance can only be larger
+				const ClusterBounds& row = bounds[GetClusterIndex(0, y, z)];
+				float v = light.ViewPosition[1];
+				float dy = v < row.Min[1] ? row.Min[1] - v : (v > row.Max[1] ? v - row.Max[1] : 0.0f);
+				if (dy * dy > rangeSq)
+					continue;
+
+				for (unsigned int x = 0; x < TilesX; x++)
+				{
+					unsigned int c = GetClusterIndex(x, y, z);
+					if (!SphereIntersectsCluster(bounds[c], light))
+						continue;
+
+					// Lights past the limit are dropped, in order, just like on the GPU
+					if (lightCounts[c] < MaxLightsPerCluster)
+						lightIndices[c * MaxLightsPerCluster + lightCounts[c]++] = light.LightIndex;
+					else
+						overflowed[c] = true;
+				}
+			}
+		}
+	}
+
+	for (unsigned int c = firstSlice * clustersPerSlice; c < endSlice * clustersPerSlice; c++)
+	{
+		if (overflowed[c]) (*overflows)++;
+	}
+}
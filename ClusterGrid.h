@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+
+class JobSystem;
+
+// --------------------------------------------------------
+// A cluster's view space bounding box
+// - Laid out as two float4s to match ClusterHeader.hlsli
+// --------------------------------------------------------
+struct ClusterBounds
+{
+	float Min[3];
+	float Padding0;
+	float Max[3];
+	float Padding1;
+};
+
+// --------------------------------------------------------
+// A light to cull, as a view space sphere
+// - Laid out to match ClusterHeader.hlsli
+// --------------------------------------------------------
+struct ClusterCullLight
+{
+	float ViewPosition[3];
+	float Range;
+	unsigned int LightIndex; // Index into the light buffer the pixel shader reads
+	unsigned int Padding[3];
+};
+
+// --------------------------------------------------------
+// Splits the view frustum into a grid of "froxels" and
+// finds the lights touching each one
+//
+// - Screen tiles in X and Y, exponential slices in depth,
+//   so near clusters stay small and far ones don't waste slots
+// - Each cluster has a fixed number of index slots, so the
+//   lists can be written without atomics (or locks) and
+//   always come out in light order
+// - This is the CPU reference: ClusterCullCS.hlsl runs the
+//   same test in the same order, on the same bounds and
+//   lights, so the two produce identical lists
+// - Has no graphics dependencies, so it can run anywhere
+// --------------------------------------------------------
+class ClusterGrid
+{
+public:
+	// Must match the defines in ClusterHeader.hlsli
+	static const unsigned int TilesX = 16;
+	static const unsigned int TilesY = 9;
+	static const unsigned int Slices = 24;
+	static const unsigned int ClusterCount = TilesX * TilesY * Slices;
+	static const unsigned int MaxLightsPerCluster = 128;
+
+	ClusterGrid();
+
+	// Rebuilds the cluster bounds - call whenever the projection changes
+	void SetProjection(float fieldOfViewY, float aspectRatio, float nearZ, float farZ);
+
+	// The lights to cull this frame, already in view space
+	void ClearLights();
+	void AddLight(const float viewPosition[3], float range, unsigned int lightIndex);
+
+	// Fills the per-cluster light lists, splitting the clusters
+	// across the job system's threads if one is given
+	void Cull(JobSystem* jobSystem);
+
+	// The shared intersection test - must stay in step with the shader's version
+	static bool SphereIntersectsCluster(const ClusterBounds& bounds, const ClusterCullLight& light);
+
+	// Which cluster a given view space depth and tile fall in
+	unsigned int GetSlice(float viewZ);
+	static unsigned int GetClusterIndex(unsigned int tileX, unsigned int tileY, unsigned int slice);
+
+	// Getters
+	float GetNearZ() { return nearZ; }
+	float GetFarZ() { return farZ; }
+	float GetDepthScale() { return depthScale; }
+	float GetDepthBias() { return depthBias; }
+	const std::vector<ClusterBounds>& GetBounds() { return bounds; }
+	const std::vector<ClusterCullLight>& GetLights() { return lights; }
+	const std::vector<unsigned int>& GetLightCounts() { return lightCounts; }
+	const std::vector<unsigned int>& GetLightIndices() { return lightIndices; }
+	unsigned int GetOverflowCount() { return overflowCount; }
+
+private:
+	float nearZ;
+	float farZ;
+
+	// slice = floor(log(viewZ) * depthScale + depthBias)
+	float depthScale;
+	float depthBias;
+
+	std::vector<ClusterBounds> bounds;
+	std::vector<ClusterCullLight> lights;
+
+	// One count per cluster, and MaxLightsPerCluster indices per cluster
+	std::vector<unsigned int> lightCounts;
+	std::vector<unsigned int> lightIndices;
+
+	// Clusters that touched more lights than they have slots for last time
+	unsigned int overflowCount;
+
+	void CullSlices(unsigned int firstSlice, unsigned int endSlice, unsigned int* overflows);
+};
+
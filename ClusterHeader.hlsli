@@ -0,0 +1,74 @@
+#ifndef __GGP_CLUSTER_HEADER__
+#define __GGP_CLUSTER_HEADER__
+
+// Must match the constants in ClusterGrid.h
+#define CLUSTER_TILES_X				16
+#define CLUSTER_TILES_Y				9
+#define CLUSTER_SLICES				24
+#define CLUSTER_COUNT				(CLUSTER_TILES_X * CLUSTER_TILES_Y * CLUSTER_SLICES)
+#define MAX_LIGHTS_PER_CLUSTER		128
+
+// A cluster's view space bounding box (xyz only)
+struct ClusterBounds
+{
+	float4 Min;
+	float4 Max;
+};
+
+// A light to cull, as a view space sphere
+struct ClusterCullLight
+{
+	float3 ViewPosition;
+	float Range;
+	uint LightIndex;
+	uint3 Padding;
+};
+
+// Sphere vs. box, by squared distance to the box
+// - Exactly the same operations, in the same order, as
+//   ClusterGrid::SphereIntersectsCluster() on the CPU
+bool SphereIntersectsCluster(ClusterBounds bounds, float3 center, float range)
+{
+	precise float distanceSq = 0.0f;
+	[unroll]
+	for (int i = 0; i < 3; i++)
+	{
+		float v = center[i];
+		if (v < bounds.Min[i])
+		{
+			precise float d = bounds.Min[i] - v;
+			distanceSq = distanceSq + d * d;
+		}
+		if (v > bounds.Max[i])
+		{
+			precise float d = v - bounds.Max[i];
+			distanceSq = distanceSq + d * d;
+		}
+	}
+	precise float rangeSq = range * range;
+	return distanceSq <= rangeSq;
+}
+
+// Undoes the perspective projection's depth to get view space Z
+//
+// depth   - SV_POSITION.z
+// nearFar - The camera's clip planes
+float GetViewDepth(float depth, float2 nearFar)
+{
+	return nearFar.x * nearFar.y / (nearFar.y - depth * (nearFar.y - nearFar.x));
+}
+
+// Finds the cluster a pixel belongs to
+//
+// screenPos  - SV_POSITION, in pixels
+// viewZ      - The pixel's view space depth
+// tileScale  - Tiles per pixel, in X and Y
+// depthScale - From ClusterGrid, so slice = floor(log(viewZ) * depthScale + depthBias)
+uint GetClusterIndex(float4 screenPos, float viewZ, float2 tileScale, float depthScale, float depthBias)
+{
+	uint2 tile = min(uint2(screenPos.xy * tileScale), uint2(CLUSTER_TILES_X - 1, CLUSTER_TILES_Y - 1));
+	uint slice = (uint)clamp(floor(log(viewZ) * depthScale + depthBias), 0.0f, CLUSTER_SLICES - 1.0f);
+	return (slice * CLUSTER_TILES_Y + tile.y) * CLUSTER_TILES_X + tile.x;
+}
+
+#endif
@@ -0,0 +1,198 @@
+#include "ClusterLightCuller.h"
+
+#include <string.h>
+
+// --------------------------------------------------------
+// Constructor - Creates the fixed-size buffers up front;
+// the light buffer grows as needed
+// --------------------------------------------------------
+ClusterLightCuller::ClusterLightCuller(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	std::shared_ptr<SimpleComputeShader> cullShader)
+	:
+	device(device),
+	cullShader(cullShader),
+	lightCapacity(0)
+{
+	CreateStructuredBuffer(sizeof(ClusterBounds), ClusterGrid::ClusterCount, D3D11_USAGE_DEFAULT,
+		D3D11_BIND_SHADER_RESOURCE, boundsBuffer, boundsSRV, 0);
+	CreateStructuredBuffer(sizeof(unsigned int), ClusterGrid::ClusterCount, D3D11_USAGE_DEFAULT,
+		D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS, countBuffer, countSRV, &countUAV);
+	CreateStructuredBuffer(sizeof(unsigned int), ClusterGrid::ClusterCount * ClusterGrid::MaxLightsPerCluster, D3D11_USAGE_DEFAULT,
+		D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS, indexBuffer, indexSRV, &indexUAV);
+}
+
+// --------------------------------------------------------
+// Creates a structured buffer and its views
+//
+// uav - Optional, only created if given
+// --------------------------------------------------------
+void ClusterLightCuller::CreateStructuredBuffer(
+	unsigned int stride,
+	unsigned int count,
+	D3D11_USAGE usage,
+	unsigned int bindFlags,
+	Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer,
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv,
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>* uav)
+{
+	buffer.Reset();
+	srv.Reset();
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = stride * count;
+	desc.Usage = usage;
+	desc.BindFlags = bindFlags;
+	desc.CPUAccessFlags = usage == D3D11_USAGE_DYNAMIC ? D3D11_CPU_ACCESS_WRITE : 0;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	desc.StructureByteStride = stride;
+	if (FAILED(device->CreateBuffer(&desc, 0, buffer.GetAddressOf())))
+		return;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = count;
+	device->CreateShaderResourceView(buffer.Get(), &srvDesc, srv.GetAddressOf());
+
+	if (uav)
+	{
+		uav->Reset();
+
+		D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+		uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+		uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+		uavDesc.Buffer.FirstElement = 0;
+		uavDesc.Buffer.NumElements = count;
+		device->CreateUnorderedAccessView(buffer.Get(), &uavDesc, uav->GetAddressOf());
+	}
+}
+
+// --------------------------------------------------------
+// Copies the grid's cluster bounds to the GPU
+// --------------------------------------------------------
+void ClusterLightCuller::UploadBounds(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ClusterGrid& grid)
+{
+	context->UpdateSubresource(boundsBuffer.Get(), 0, 0, grid.GetBounds().data(), 0, 0);
+}
+
+// --------------------------------------------------------
+// Copies the grid's lights to the GPU, growing the buffer
+// (by doubling) if there are more than it holds
+// --------------------------------------------------------
+void ClusterLightCuller::UploadLights(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ClusterGrid& grid)
+{
+	const std::vector<ClusterCullLight>& lights = grid.GetLights();
+	unsigned int count = (unsigned int)lights.size();
+	if (count > lightCapacity || !lightBuffer)
+	{
+		unsigned int newCapacity = lightCapacity < 64 ? 64 : lightCapacity;
+		while (newCapacity < count)
+			newCapacity *= 2;
+
+		CreateStructuredBuffer(sizeof(ClusterCullLight), newCapacity, D3D11_USAGE_DYNAMIC,
+			D3D11_BIND_SHADER_RESOURCE, lightBuffer, lightSRV, 0);
+		lightCapacity = lightBuffer ? newCapacity : 0;
+	}
+
+	if (count == 0 || !lightBuffer)
+		return;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(lightBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+	memcpy(mapped.pData, lights.data(), sizeof(ClusterCullLight) * count);
+	context->Unmap(lightBuffer.Get(), 0);
+}
+
+// --------------------------------------------------------
+// Dispatches the culling shader - one thread per cluster
+//
+// The output buffers must not be bound to the pixel shader
+// while this runs, or the runtime will unbind them
+// --------------------------------------------------------
+void ClusterLightCuller::CullOnGpu(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ClusterGrid& grid)
+{
+	UploadLights(context, grid);
+
+	cullShader->SetInt("cullLightCount", (int)grid.GetLights().size());
+	cullShader->SetShaderResourceView("Clusters", boundsSRV);
+	cullShader->SetShaderResourceView("CullLights", lightSRV);
+	cullShader->SetUnorderedAccessView("ClusterLightCounts", countUAV);
+	cullShader->SetUnorderedAccessView("ClusterLightIndices", indexUAV);
+	cullShader->SetShader();
+	cullShader->CopyAllBufferData();
+	cullShader->DispatchByThreads(ClusterGrid::ClusterCount, 1, 1);
+
+	// Unbind the outputs so the pixel shader can read them
+	cullShader->SetUnorderedAccessView("ClusterLightCounts", 0);
+	cullShader->SetUnorderedAccessView("ClusterLightIndices", 0);
+}
+
+// --------------------------------------------------------
+// Copies lists the grid culled on the CPU to the GPU
+// --------------------------------------------------------
+void ClusterLightCuller::UploadCpuResults(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ClusterGrid& grid)
+{
+	context->UpdateSubresource(countBuffer.Get(), 0, 0, grid.GetLightCounts().data(), 0, 0);
+	context->UpdateSubresource(indexBuffer.Get(), 0, 0, grid.GetLightIndices().data(), 0, 0);
+}
+
+// --------------------------------------------------------
+// Compares the GPU's lists with the grid's
+//
+// Only the used slots of each cluster are compared, since
+// the rest hold whatever was there before
+//
+// Returns the number of clusters whose lists differ
+// --------------------------------------------------------
+unsigned int ClusterLightCuller::Validate(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ClusterGrid& grid)
+{
+	if (!countStaging)
+	{
+		D3D11_BUFFER_DESC desc = {};
+		desc.Usage = D3D11_USAGE_STAGING;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		desc.ByteWidth = sizeof(unsigned int) * ClusterGrid::ClusterCount;
+		device->CreateBuffer(&desc, 0, countStaging.GetAddressOf());
+		desc.ByteWidth = sizeof(unsigned int) * ClusterGrid::ClusterCount * ClusterGrid::MaxLightsPerCluster;
+		device->CreateBuffer(&desc, 0, indexStaging.GetAddressOf());
+	}
+	if (!countStaging || !indexStaging)
+		return ClusterGrid::ClusterCount;
+
+	context->CopyResource(countStaging.Get(), countBuffer.Get());
+	context->CopyResource(indexStaging.Get(), indexBuffer.Get());
+
+	// Mapping waits for the GPU to finish the copies
+	D3D11_MAPPED_SUBRESOURCE countMap = {};
+	D3D11_MAPPED_SUBRESOURCE indexMap = {};
+	if (FAILED(context->Map(countStaging.Get(), 0, D3D11_MAP_READ, 0, &countMap)))
+		return ClusterGrid::ClusterCount;
+	if (FAILED(context->Map(indexStaging.Get(), 0, D3D11_MAP_READ, 0, &indexMap)))
+	{
+		context->Unmap(countStaging.Get(), 0);
+		return ClusterGrid::ClusterCount;
+	}
+
+	const unsigned int* gpuCounts = (const unsigned int*)countMap.pData;
+	const unsigned int* gpuIndices = (const unsigned int*)indexMap.pData;
+	const std::vector<unsigned int>& cpuCounts = grid.GetLightCounts();
+	const std::vector<unsigned int>& cpuIndices = grid.GetLightIndices();
+
+	unsigned int mismatches = 0;
+	for (unsigned int c = 0; c < ClusterGrid::ClusterCount; c++)
+	{
+		unsigned int first = c * ClusterGrid::MaxLightsPerCluster;
+		if (gpuCounts[c] != cpuCounts[c] ||
+			memcmp(&gpuIndices[first], &cpuIndices[first], sizeof(unsigned int) * cpuCounts[c]) != 0)
+		{
+			mismatches++;
+		}
+	}
+
+	context->Unmap(indexStaging.Get(), 0);
+	context->Unmap(countStaging.Get(), 0);
+	return mismatches;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include "ClusterGrid.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// The GPU half of clustered light culling
+//
+// - Owns the buffers the pixel shader reads its per-cluster
+//   light lists from
+// - Fills them either by dispatching ClusterCullCS, or by
+//   uploading lists a ClusterGrid culled on the CPU
+// - Validate() reads the GPU's lists back and compares them
+//   with the CPU's, which must match exactly
+// --------------------------------------------------------
+class ClusterLightCuller
+{
+public:
+	ClusterLightCuller(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		std::shared_ptr<SimpleComputeShader> cullShader);
+
+	// Copies the grid's cluster bounds - call when its projection changes
+	void UploadBounds(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ClusterGrid& grid);
+
+	// Culls the grid's lights against its clusters on the GPU
+	void CullOnGpu(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ClusterGrid& grid);
+
+	// Uses the lists the grid culled itself instead
+	void UploadCpuResults(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ClusterGrid& grid);
+
+	// Reads back the GPU's lists (stalling until they're done) and
+	// compares them with the grid's, returning the clusters that differ
+	unsigned int Validate(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ClusterGrid& grid);
+
+	// For binding to the pixel shader
+	ID3D11ShaderResourceView* GetLightCountSRV() { return countSRV.Get(); }
+	ID3D11ShaderResourceView* GetLightIndexSRV() { return indexSRV.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	std::shared_ptr<SimpleComputeShader> cullShader;
+
+	// Inputs
+	Microsoft::WRL::ComPtr<ID3D11Buffer> boundsBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> boundsSRV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> lightBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> lightSRV;
+	unsigned int lightCapacity;
+
+	// Outputs
+	Microsoft::WRL::ComPtr<ID3D11Buffer> countBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> countSRV;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> countUAV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> indexSRV;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> indexUAV;
+
+	// Readback for validation - only created if it's ever used
+	Microsoft::WRL::ComPtr<ID3D11Buffer> countStaging;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexStaging;
+
+	void CreateStructuredBuffer(
+		unsigned int stride,
+		unsigned int count,
+		D3D11_USAGE usage,
+		unsigned int bindFlags,
+		Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer,
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv,
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView>* uav);
+	void UploadLights(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ClusterGrid& grid);
+};
+
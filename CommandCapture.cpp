@@ -0,0 +1,446 @@
+#include "CommandCapture.h"
+#include "CommandStream.h"
+
+#include <fstream>
+#include <sstream>
+#include <string.h>
+
+// --------------------------------------------------------
+// Defaults, for when the command line leaves something out
+// --------------------------------------------------------
+CommandCapture::Settings CommandCapture::GetDefaultSettings()
+{
+	Settings settings = {};
+	settings.Enabled = false;
+	settings.File = "Capture.rcap";
+	settings.FirstFrame = 60;
+	settings.Frames = 1;
+	return settings;
+}
+
+// --------------------------------------------------------
+// Reads capture settings from the command line
+//
+// commandLine - Arguments only, as WinMain() gets them
+// settings    - Filled in from the defaults and the arguments
+// --------------------------------------------------------
+bool CommandCapture::ParseCommandLine(const char* commandLine, Settings* settings)
+{
+	*settings = GetDefaultSettings();
+	if (!commandLine)
+		return true;
+
+	std::istringstream arguments(commandLine);
+	std::string argument;
+	bool enabled = false;
+	while (arguments >> argument)
+	{
+		if (argument == "-capture")
+		{
+			enabled = true;
+			arguments >> settings->File;
+		}
+		else if (argument == "-capturestart")
+			arguments >> settings->FirstFrame;
+		else if (argument == "-captureframes")
+			arguments >> settings->Frames;
+
+		// A flag missing its value (or given a bad one)
+		if (arguments.fail())
+			return false;
+	}
+
+	if (enabled && settings->Frames == 0)
+		return false;
+
+	settings->Enabled = enabled;
+	return true;
+}
+
+CommandCapture::CommandCapture(std::shared_ptr<RenderContext> target)
+	:
+	target(target),
+	capturing(false)
+{
+	Reset();
+}
+
+// --------------------------------------------------------
+// Forgets everything captured, so the next capture defines
+// its resources from scratch
+// --------------------------------------------------------
+void CommandCapture::Reset()
+{
+	frameCount = 0;
+	stream.clear();
+	resourceIds.clear();
+	bufferDescs.clear();
+	shaders.clear();
+	nextId = 1;
+	for (unsigned int i = 0; i < StageCount; i++)
+		boundShaders[i] = 0;
+}
+
+// --------------------------------------------------------
+// Starts capturing a frame
+// - Nothing bound before this is known, so the frame has to
+//   bind everything it uses (as every frame here does)
+// --------------------------------------------------------
+void CommandCapture::BeginFrame()
+{
+	capturing = true;
+	frameCount++;
+	for (unsigned int i = 0; i < StageCount; i++)
+		boundShaders[i] = 0;
+	CommandStream::WriteValue(stream, CommandStream::BeginFrame);
+}
+
+void CommandCapture::EndFrame()
+{
+	capturing = false;
+}
+
+// --------------------------------------------------------
+// Writes the header, the captured commands and an End
+//
+// Returns false if the file couldn't be written (the
+// capture is discarded either way)
+// --------------------------------------------------------
+bool CommandCapture::Save(const std::string& path)
+{
+	capturing = false;
+	CommandStream::WriteValue(stream, CommandStream::End);
+
+	CommandStream::Header header = {};
+	header.Magic = CommandStream::Magic;
+	header.Version = CommandStream::Version;
+	header.FrameCount = frameCount;
+	header.ResourceCount = nextId - 1;
+	header.CommandBytes = stream.size();
+
+	std::ofstream file(path, std::ios::binary);
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)stream.data(), stream.size());
+	bool written = file.good();
+
+	Reset();
+	return written;
+}
+
+// --------------------------------------------------------
+// Resource ids - each resource is defined the first time
+// one is asked for, so ask before writing the command
+// that uses it.  Null is always zero.
+// --------------------------------------------------------
+unsigned int CommandCapture::GetBufferId(RenderBuffer* buffer)
+{
+	if (!buffer)
+		return 0;
+
+	// Stack-wrapped buffers can share an address with an earlier, different one
+	const RenderBufferDesc& desc = buffer->GetDesc();
+	std::unordered_map<const void*, RenderBufferDesc>::iterator known = bufferDescs.find(buffer);
+	if (known != bufferDescs.end() &&
+		known->second.Type == desc.Type &&
+		known->second.Access == desc.Access &&
+		known->second.ByteWidth == desc.ByteWidth &&
+		known->second.Stride == desc.Stride)
+		return resourceIds[buffer];
+
+	unsigned int id = nextId++;
+	resourceIds[buffer] = id;
+	bufferDescs[buffer] = desc;
+
+	CommandStream::WriteValue(stream, CommandStream::DefineBuffer);
+	CommandStream::WriteValue(stream, id);
+	CommandStream::WriteValue(stream, desc.Type);
+	CommandStream::WriteValue(stream, desc.Access);
+	CommandStream::WriteValue(stream, desc.ByteWidth);
+	CommandStream::WriteValue(stream, desc.Stride);
+	return id;
+}
+
+unsigned int CommandCapture::GetTextureId(RenderTexture* texture)
+{
+	if (!texture)
+		return 0;
+
+	std::unordered_map<const void*, unsigned int>::iterator known = resourceIds.find(texture);
+	if (known != resourceIds.end())
+		return known->second;
+
+	unsigned int id = nextId++;
+	resourceIds[texture] = id;
+
+	const RenderTextureDesc& desc = texture->GetDesc();
+	CommandStream::WriteValue(stream, CommandStream::DefineTexture);
+	CommandStream::WriteValue(stream, id);
+	CommandStream::WriteValue(stream, desc.Width);
+	CommandStream::WriteValue(stream, desc.Height);
+	CommandStream::WriteValue(stream, desc.MipLevels);
+	CommandStream::WriteValue(stream, desc.ArraySize);
+	CommandStream::WriteValue(stream, desc.Cube ? 1 : 0);
+	return id;
+}
+
+unsigned int CommandCapture::GetSamplerId(RenderSampler* sampler)
+{
+	if (!sampler)
+		return 0;
+
+	std::unordered_map<const void*, unsigned int>::iterator known = resourceIds.find(sampler);
+	if (known != resourceIds.end())
+		return known->second;
+
+	unsigned int id = nextId++;
+	resourceIds[sampler] = id;
+
+	const RenderSamplerDesc& desc = sampler->GetDesc();
+	CommandStream::WriteValue(stream, CommandStream::DefineSampler);
+	CommandStream::WriteValue(stream, id);
+	CommandStream::WriteValue(stream, desc.Filter);
+	CommandStream::WriteValue(stream, desc.Address);
+	CommandStream::WriteValue(stream, desc.MaxAnisotropy);
+	return id;
+}
+
+unsigned int CommandCapture::GetPipelineStateId(RenderPipelineState* state)
+{
+	if (!state)
+		return 0;
+
+	std::unordered_map<const void*, unsigned int>::iterator known = resourceIds.find(state);
+	if (known != resourceIds.end())
+		return known->second;
+
+	unsigned int id = nextId++;
+	resourceIds[state] = id;
+
+	const RenderPipelineStateDesc& desc = state->GetDesc();
+	CommandStream::WriteValue(stream, CommandStream::DefinePipelineState);
+	CommandStream::WriteValue(stream, id);
+	CommandStream::WriteValue(stream, desc.Cull);
+	CommandStream::WriteValue(stream, desc.DepthEnable ? 1 : 0);
+	CommandStream::WriteValue(stream, desc.DepthWrite ? 1 : 0);
+	CommandStream::WriteValue(stream, desc.DepthTest);
+	return id;
+}
+
+// --------------------------------------------------------
+// A shader's id and last written constants, defining the
+// shader (as its constant buffer sizes) if it's new
+// --------------------------------------------------------
+CommandCapture::ShaderRecord* CommandCapture::GetShaderRecord(RenderShader* shader)
+{
+	std::unordered_map<const void*, ShaderRecord>::iterator known = shaders.find(shader);
+	if (known != shaders.end())
+		return &known->second;
+
+	ShaderRecord& record = shaders[shader];
+	record.Id = nextId++;
+	record.Constants.resize(shader->GetConstantBufferCount());
+
+	CommandStream::WriteValue(stream, CommandStream::DefineShader);
+	CommandStream::WriteValue(stream, record.Id);
+	CommandStream::WriteValue(stream, record.Constants.size());
+	for (unsigned int i = 0; i < record.Constants.size(); i++)
+		CommandStream::WriteValue(stream, shader->GetConstantBufferSize(i));
+	return &record;
+}
+
+// --------------------------------------------------------
+// Writes whichever of a shader's constant buffers changed
+// since they were last written
+// --------------------------------------------------------
+void CommandCapture::WriteConstants(RenderShader* shader)
+{
+	ShaderRecord* record = GetShaderRecord(shader);
+	for (unsigned int i = 0; i < record->Constants.size(); i++)
+	{
+		unsigned int size = shader->GetConstantBufferSize(i);
+		const unsigned char* data = (const unsigned char*)shader->GetConstantBufferData(i);
+		std::vector<unsigned char>& last = record->Constants[i];
+		if (!data || (last.size() == size && memcmp(last.data(), data, size) == 0))
+			continue;
+
+		last.assign(data, data + size);
+		CommandStream::WriteValue(stream, CommandStream::SetConstants);
+		CommandStream::WriteValue(stream, record->Id);
+		CommandStream::WriteValue(stream, i);
+		CommandStream::WriteValue(stream, size);
+		CommandStream::WriteBytes(stream, data, size);
+	}
+}
+
+// Shaders can have new constants copied while bound, so check them all before each draw
+void CommandCapture::WriteBoundConstants()
+{
+	for (unsigned int i = 0; i < StageCount; i++)
+	{
+		if (boundShaders[i])
+			WriteConstants(boundShaders[i]);
+	}
+}
+
+void CommandCapture::SetPipelineState(RenderPipelineState* state)
+{
+	if (capturing)
+	{
+		unsigned int id = GetPipelineStateId(state);
+		CommandStream::WriteValue(stream, CommandStream::SetPipelineState);
+		CommandStream::WriteValue(stream, id);
+	}
+	target->SetPipelineState(state);
+}
+
+void CommandCapture::SetVertexBuffer(RenderBuffer* buffer, unsigned int stride, unsigned int offset)
+{
+	if (capturing)
+	{
+		unsigned int id = GetBufferId(buffer);
+		CommandStream::WriteValue(stream, CommandStream::SetVertexBuffer);
+		CommandStream::WriteValue(stream, id);
+		CommandStream::WriteValue(stream, stride);
+		CommandStream::WriteValue(stream, offset);
+	}
+	target->SetVertexBuffer(buffer, stride, offset);
+}
+
+void CommandCapture::SetIndexBuffer(RenderBuffer* buffer, unsigned int offset)
+{
+	if (capturing)
+	{
+		unsigned int id = GetBufferId(buffer);
+		CommandStream::WriteValue(stream, CommandStream::SetIndexBuffer);
+		CommandStream::WriteValue(stream, id);
+		CommandStream::WriteValue(stream, offset);
+	}
+	target->SetIndexBuffer(buffer, offset);
+}
+
+// --------------------------------------------------------
+// Writes the shader's latest constants, then the bind
+// - Ranges aren't written - on replay the constants are
+//   copied and bound the usual way
+// --------------------------------------------------------
+void CommandCapture::SetShader(Stage stage, RenderShader* shader, const RenderConstantBufferRanges* ranges)
+{
+	if (capturing)
+	{
+		unsigned int id = 0;
+		if (shader)
+		{
+			WriteConstants(shader);
+			id = GetShaderRecord(shader)->Id;
+		}
+		CommandStream::WriteValue(stream, CommandStream::SetShader);
+		CommandStream::WriteValue(stream, stage);
+		CommandStream::WriteValue(stream, id);
+		if (stage < StageCount)
+			boundShaders[stage] = shader;
+	}
+	target->SetShader(stage, shader, ranges);
+}
+
+void CommandCapture::SetConstantBuffer(Stage stage, unsigned int slot, RenderBuffer* buffer)
+{
+	if (capturing)
+	{
+		unsigned int id = GetBufferId(buffer);
+		CommandStream::WriteValue(stream, CommandStream::SetConstantBuffer);
+		CommandStream::WriteValue(stream, stage);
+		CommandStream::WriteValue(stream, slot);
+		CommandStream::WriteValue(stream, id);
+	}
+	target->SetConstantBuffer(stage, slot, buffer);
+}
+
+void CommandCapture::SetTextures(Stage stage, unsigned int startSlot, unsigned int count, RenderTexture* const* textures)
+{
+	if (capturing)
+	{
+		std::vector<unsigned int> ids(count);
+		for (unsigned int i = 0; i < count; i++)
+			ids[i] = GetTextureId(textures[i]);
+
+		CommandStream::WriteValue(stream, CommandStream::SetTextures);
+		CommandStream::WriteValue(stream, stage);
+		CommandStream::WriteValue(stream, startSlot);
+		CommandStream::WriteValue(stream, count);
+		for (unsigned int id : ids)
+			CommandStream::WriteValue(stream, id);
+	}
+	target->SetTextures(stage, startSlot, count, textures);
+}
+
+void CommandCapture::SetSamplers(Stage stage, unsigned int startSlot, unsigned int count, RenderSampler* const* samplers)
+{
+	if (capturing)
+	{
+		std::vector<unsigned int> ids(count);
+		for (unsigned int i = 0; i < count; i++)
+			ids[i] = GetSamplerId(samplers[i]);
+
+		CommandStream::WriteValue(stream, CommandStream::SetSamplers);
+		CommandStream::WriteValue(stream, stage);
+		CommandStream::WriteValue(stream, startSlot);
+		CommandStream::WriteValue(stream, count);
+		for (unsigned int id : ids)
+			CommandStream::WriteValue(stream, id);
+	}
+	target->SetSamplers(stage, startSlot, count, samplers);
+}
+
+void CommandCapture::UpdateBuffer(RenderBuffer* buffer, const void* data, unsigned int size)
+{
+	if (capturing)
+	{
+		unsigned int id = GetBufferId(buffer);
+		unsigned int byteWidth = buffer->GetDesc().ByteWidth;
+		unsigned int written = size < byteWidth ? size : byteWidth;
+		CommandStream::WriteValue(stream, CommandStream::UpdateBuffer);
+		CommandStream::WriteValue(stream, id);
+		CommandStream::WriteValue(stream, written);
+		CommandStream::WriteBytes(stream, data, written);
+	}
+	target->UpdateBuffer(buffer, data, size);
+}
+
+void CommandCapture::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	if (capturing)
+	{
+		WriteBoundConstants();
+		CommandStream::WriteValue(stream, CommandStream::DrawIndexed);
+		CommandStream::WriteValue(stream, indexCount);
+		CommandStream::WriteValue(stream, startIndex);
+		CommandStream::WriteSigned(stream, baseVertex);
+	}
+	target->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void CommandCapture::DrawIndexedIndirect(RenderBuffer* argsBuffer, unsigned int argsOffset)
+{
+	if (capturing)
+	{
+		WriteBoundConstants();
+		unsigned int id = GetBufferId(argsBuffer);
+		CommandStream::WriteValue(stream, CommandStream::DrawIndexedIndirect);
+		CommandStream::WriteValue(stream, id);
+		CommandStream::WriteValue(stream, argsOffset);
+	}
+	target->DrawIndexedIndirect(argsBuffer, argsOffset);
+}
+
+void CommandCapture::Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ)
+{
+	if (capturing)
+	{
+		WriteBoundConstants();
+		CommandStream::WriteValue(stream, CommandStream::Dispatch);
+		CommandStream::WriteValue(stream, groupsX);
+		CommandStream::WriteValue(stream, groupsY);
+		CommandStream::WriteValue(stream, groupsZ);
+	}
+	target->Dispatch(groupsX, groupsY, groupsZ);
+}
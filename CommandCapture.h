@@ -0,0 +1,105 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "RenderDevice.h"
+
+// --------------------------------------------------------
+// A RenderContext that writes down everything submitted
+// through it, then passes it on to the real one
+//
+// - Only frames between BeginFrame() and EndFrame() are
+//   captured; otherwise it just passes commands through
+// - The capture holds binds, constant data, buffer updates,
+//   draws and dispatches, plus the descriptions of the
+//   resources and shaders they use (not texture contents,
+//   shader code or anything the GPU writes) - see
+//   CommandStream.h
+// - Only what goes through a RenderContext is captured, not
+//   work issued straight to the graphics API
+// - Constants are read from each shader's local copy, so
+//   shaders bound with captured ranges (recorded on another
+//   thread) should be drawn serially while capturing
+// - Save() writes the capture for CommandReplayer to replay
+// - Portable C++ - builds anywhere
+// --------------------------------------------------------
+class CommandCapture : public RenderContext
+{
+public:
+	struct Settings
+	{
+		bool Enabled;
+		std::string File;
+		unsigned int FirstFrame;	// Frames to let pass before capturing
+		unsigned int Frames;
+	};
+
+	// Defaults, for when the command line leaves something out
+	static Settings GetDefaultSettings();
+
+	// Reads settings from a command line like:
+	//   -capture file [-capturestart N] [-captureframes N]
+	// - Enabled is only set if -capture is there
+	// - Returns false on anything it can't read
+	static bool ParseCommandLine(const char* commandLine, Settings* settings);
+
+	CommandCapture(std::shared_ptr<RenderContext> target);
+
+	// Captured frames - everything between the two goes into the capture
+	void BeginFrame();
+	void EndFrame();
+	bool IsCapturing() { return capturing; }
+	unsigned int GetFrameCount() { return frameCount; }
+	size_t GetCaptureSize() { return stream.size(); }
+
+	// Writes every frame captured so far, then starts over
+	bool Save(const std::string& path);
+
+	void SetPipelineState(RenderPipelineState* state);
+	void SetVertexBuffer(RenderBuffer* buffer, unsigned int stride, unsigned int offset);
+	void SetIndexBuffer(RenderBuffer* buffer, unsigned int offset);
+	void SetShader(Stage stage, RenderShader* shader, const RenderConstantBufferRanges* ranges);
+	void SetConstantBuffer(Stage stage, unsigned int slot, RenderBuffer* buffer);
+	void SetTextures(Stage stage, unsigned int startSlot, unsigned int count, RenderTexture* const* textures);
+	void SetSamplers(Stage stage, unsigned int startSlot, unsigned int count, RenderSampler* const* samplers);
+	void UpdateBuffer(RenderBuffer* buffer, const void* data, unsigned int size);
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void DrawIndexedIndirect(RenderBuffer* argsBuffer, unsigned int argsOffset);
+	void Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
+
+private:
+	static const unsigned int StageCount = 3;
+
+	// The constants last written for a shader, so unchanged ones aren't written again
+	struct ShaderRecord
+	{
+		unsigned int Id;
+		std::vector<std::vector<unsigned char>> Constants;
+	};
+
+	std::shared_ptr<RenderContext> target;
+
+	bool capturing;
+	unsigned int frameCount;
+	std::vector<unsigned char> stream;
+
+	// Everything defined in the capture so far, by address
+	// - Buffers are redefined if their address is reused for a different one
+	std::unordered_map<const void*, unsigned int> resourceIds;
+	std::unordered_map<const void*, RenderBufferDesc> bufferDescs;
+	std::unordered_map<const void*, ShaderRecord> shaders;
+	unsigned int nextId;
+
+	RenderShader* boundShaders[StageCount];
+
+	void Reset();
+	unsigned int GetBufferId(RenderBuffer* buffer);
+	unsigned int GetTextureId(RenderTexture* texture);
+	unsigned int GetSamplerId(RenderSampler* sampler);
+	unsigned int GetPipelineStateId(RenderPipelineState* state);
+	ShaderRecord* GetShaderRecord(RenderShader* shader);
+	void WriteConstants(RenderShader* shader);
+	void WriteBoundConstants();
+};
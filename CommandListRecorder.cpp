@@ -0,0 +1,96 @@
+#include "CommandListRecorder.h"
+
+// --------------------------------------------------------
+// Constructor - Creates the deferred contexts
+//
+// jobSystem    - Runs the recording jobs
+// contextCount - Most chunks that can be recorded at once,
+//                usually the job system's thread count
+// --------------------------------------------------------
+CommandListRecorder::CommandListRecorder(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	std::shared_ptr<JobSystem> jobSystem,
+	unsigned int contextCount)
+	:
+	jobSystem(jobSystem),
+	driverCommandLists(false)
+{
+	// Not required (the runtime emulates command lists otherwise), but nice to know
+	D3D11_FEATURE_DATA_THREADING threading = {};
+	if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_THREADING, &threading, sizeof(threading))))
+		driverCommandLists = threading.DriverCommandLists != FALSE;
+
+	for (unsigned int i = 0; i < contextCount; i++)
+	{
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> deferred;
+		if (FAILED(device->CreateDeferredContext(0, deferred.GetAddressOf())))
+			break;
+
+		Recorder recorder = {};
+		recorder.context = deferred;
+		recorder.cache = std::make_shared<StateCache>(std::make_shared<D3D11StateCacheBackend>(deferred));
+		recorders.push_back(recorder);
+	}
+}
+
+// --------------------------------------------------------
+// Records each chunk as a job on its own context, and waits
+// for all of them
+//
+// chunkCount - Number of chunks (extra contexts sit this frame out)
+// record     - Records a chunk through the given cache
+// --------------------------------------------------------
+void CommandListRecorder::Record(unsigned int chunkCount, RecordFunction record)
+{
+	if (chunkCount > recorders.size())
+		chunkCount = (unsigned int)recorders.size();
+
+	// Drop last frame's lists, so Execute() only sees this frame's
+	for (auto& r : recorders)
+		r.commandList.Reset();
+
+	jobSystem->ParallelFor(0, chunkCount, 1, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+			{
+				Recorder& recorder = recorders[i];
+				recorder.cache->BeginFrame();
+				record(recorder.cache, recorder.context.Get(), i);
+				recorder.context->FinishCommandList(FALSE, recorder.commandList.GetAddressOf());
+
+				// Finishing the list resets the deferred context to default state
+				recorder.cache->Invalidate();
+			}
+		});
+}
+
+// --------------------------------------------------------
+// Executes every recorded list, in chunk order
+// --------------------------------------------------------
+void CommandListRecorder::Execute(Microsoft::WRL::ComPtr<ID3D11DeviceContext> immediateContext)
+{
+	for (auto& r : recorders)
+	{
+		if (!r.commandList)
+			continue;
+
+		// Don't save/restore immediate state - it's about to be set again anyway
+		immediateContext->ExecuteCommandList(r.commandList.Get(), FALSE);
+		r.commandList.Reset();
+	}
+}
+
+// --------------------------------------------------------
+// Totals the contexts' bind counts from their last frame
+// --------------------------------------------------------
+StateCache::Stats CommandListRecorder::GetLastFrameStats()
+{
+	StateCache::Stats total = {};
+	for (auto& r : recorders)
+	{
+		StateCache::Stats stats = r.cache->GetLastFrameStats();
+		total.Issued += stats.Issued;
+		total.Filtered += stats.Filtered;
+	}
+	return total;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "D3D11StateCacheBackend.h"
+#include "JobSystem.h"
+
+// --------------------------------------------------------
+// Records draws on several threads at once
+//
+// - Each chunk of work gets its own deferred context (and a
+//   StateCache wrapping it), recorded into an ID3D11CommandList
+//   by a job - a context is only ever used by one job at a time
+// - The main thread then executes the lists in chunk order,
+//   so the result matches drawing everything serially
+// - Deferred contexts start every list with default state,
+//   and executing a list resets the immediate context, so
+//   the record function must set everything it relies on
+//   and callers must Invalidate() their own StateCache
+// --------------------------------------------------------
+class CommandListRecorder
+{
+public:
+	// Called from a job to record one chunk - through the cache, or the context for what it doesn't shadow
+	typedef std::function<void(std::shared_ptr<StateCache> cache, ID3D11DeviceContext* context, unsigned int chunkIndex)> RecordFunction;
+
+	CommandListRecorder(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		std::shared_ptr<JobSystem> jobSystem,
+		unsigned int contextCount);
+
+	// False if deferred contexts couldn't be created
+	bool IsSupported() { return !recorders.empty(); }
+
+	// Does the driver record command lists natively, or is the runtime emulating them?
+	bool HasDriverCommandLists() { return driverCommandLists; }
+
+	// How many chunks can be recorded at once
+	unsigned int GetContextCount() { return (unsigned int)recorders.size(); }
+
+	// Records chunks 0 to chunkCount-1 (at most one per context) as jobs, waiting until all are done
+	void Record(unsigned int chunkCount, RecordFunction record);
+
+	// Executes the recorded lists in order on the immediate context
+	void Execute(Microsoft::WRL::ComPtr<ID3D11DeviceContext> immediateContext);
+
+	// Binds issued and filtered by all contexts last frame
+	StateCache::Stats GetLastFrameStats();
+
+private:
+	struct Recorder
+	{
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+		std::shared_ptr<StateCache> cache;
+		Microsoft::WRL::ComPtr<ID3D11CommandList> commandList;
+	};
+	std::vector<Recorder> recorders;
+	std::shared_ptr<JobSystem> jobSystem;
+	bool driverCommandLists;
+};
+
@@ -0,0 +1,44 @@
+// --------------------------------------------------------
+// Entry point for replaying a command capture on its own,
+// for machines with no Windows and no GPU
+//
+// - Windows builds replay from the game with "-replay file"
+//   instead, so this is empty there
+// - Everything it needs is portable C++14, and
+//   CMakeLists.txt builds it as the CommandReplay target
+//
+// - Takes the same options as CommandReplayer.h lists, with
+//   "-replay" optional before the capture file
+// --------------------------------------------------------
+#ifndef _WIN32
+
+#include <stdio.h>
+#include <string>
+#include "CommandReplayer.h"
+
+int main(int argc, char* argv[])
+{
+	// A bare file name first is the capture
+	std::string commandLine = argc > 1 && argv[1][0] != '-' ? "-replay " : "";
+	for (int i = 1; i < argc; i++)
+	{
+		commandLine += argv[i];
+		commandLine += " ";
+	}
+
+	CommandReplayer::Settings settings;
+	if (!CommandReplayer::ParseCommandLine(commandLine.c_str(), &settings))
+	{
+		printf("Couldn't read the command line - see CommandReplayer.h for the options\n");
+		return 2;
+	}
+	if (!settings.Enabled)
+	{
+		printf("Usage: CommandReplay [-replay] file [-repeats N] [-results file]\n");
+		return 2;
+	}
+
+	return CommandReplayer::Run(settings);
+}
+
+#endif
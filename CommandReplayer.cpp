@@ -0,0 +1,640 @@
+#include "CommandReplayer.h"
+#include "NullRenderDevice.h"
+#include "FrameTimeStats.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+
+// Limits on what a capture can describe, so a damaged one can't ask for absurd allocations
+static const unsigned int MaxTextureSize = 16384;
+static const unsigned int MaxMipLevels = 15;
+static const unsigned int MaxArraySize = 2048;
+static const unsigned int MaxBufferSize = 256 * 1024 * 1024;
+
+// --------------------------------------------------------
+// Defaults, for when the command line leaves something out
+// --------------------------------------------------------
+CommandReplayer::Settings CommandReplayer::GetDefaultSettings()
+{
+	Settings settings = {};
+	settings.Enabled = false;
+	settings.Repeats = 100;
+	settings.ResultsFile = "ReplayResults.csv";
+	return settings;
+}
+
+// --------------------------------------------------------
+// Reads replay settings from the command line
+//
+// commandLine - Arguments only, as WinMain() gets them
+// settings    - Filled in from the defaults and the arguments
+// --------------------------------------------------------
+bool CommandReplayer::ParseCommandLine(const char* commandLine, Settings* settings)
+{
+	*settings = GetDefaultSettings();
+	if (!commandLine)
+		return true;
+
+	std::istringstream arguments(commandLine);
+	std::string argument;
+	bool enabled = false;
+	while (arguments >> argument)
+	{
+		if (argument == "-replay")
+		{
+			enabled = true;
+			arguments >> settings->File;
+		}
+		else if (argument == "-repeats")
+			arguments >> settings->Repeats;
+		else if (argument == "-results")
+			arguments >> settings->ResultsFile;
+
+		// A flag missing its value (or given a bad one)
+		if (arguments.fail())
+			return false;
+	}
+
+	if (enabled && settings->Repeats == 0)
+		return false;
+
+	settings->Enabled = enabled;
+	return true;
+}
+
+// --------------------------------------------------------
+// Replays a capture on the null backend: once to count what
+// each frame submits, then Repeats times, timing each frame
+// --------------------------------------------------------
+int CommandReplayer::Run(const Settings& settings)
+{
+	CommandReplayer replayer;
+	if (!replayer.Load(settings.File))
+	{
+		printf("Couldn't load %s\n", settings.File.c_str());
+		return 2;
+	}
+
+	NullRenderDevice device;
+	NullRenderContext* context = device.GetImmediateContext();
+	bool created = replayer.CreateResources(&device,
+		[context](const std::vector<unsigned int>& constantBufferSizes)
+		{
+			return std::make_shared<NullRenderShader>(context, constantBufferSizes);
+		});
+	if (!created)
+	{
+		printf("Couldn't create the resources %s uses\n", settings.File.c_str());
+		return 2;
+	}
+
+	// Counts, over every frame of one untimed replay
+	NullRenderContext::Stats totals = {};
+	auto addFrame = [&totals](const NullRenderContext::Stats& stats)
+	{
+		totals.Draws += stats.Draws;
+		totals.IndirectDraws += stats.IndirectDraws;
+		totals.Dispatches += stats.Dispatches;
+		totals.Indices += stats.Indices;
+		totals.Binds += stats.Binds;
+		totals.RedundantBinds += stats.RedundantBinds;
+		totals.BytesUploaded += stats.BytesUploaded;
+	};
+	replayer.Replay(context,
+		[&](unsigned int frame)
+		{
+			context->BeginFrame();
+			if (frame > 0)
+				addFrame(context->GetLastFrameStats());
+		});
+	context->BeginFrame();
+	addFrame(context->GetLastFrameStats());
+
+	// Timings, one per replayed frame
+	unsigned int frames = replayer.GetFrameCount();
+	FrameTimeStats frameTimes(frames * settings.Repeats > 0 ? frames * settings.Repeats : 1);
+	std::chrono::high_resolution_clock::time_point frameStart;
+	for (unsigned int r = 0; r < settings.Repeats && frames > 0; r++)
+	{
+		replayer.Replay(context,
+			[&](unsigned int frame)
+			{
+				std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+				if (frame > 0)
+					frameTimes.AddFrame(std::chrono::duration<double, std::milli>(now - frameStart).count());
+				frameStart = now;
+				context->BeginFrame();
+			});
+		std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+		frameTimes.AddFrame(std::chrono::duration<double, std::milli>(end - frameStart).count());
+	}
+
+	FrameTimeStats::Summary summary = frameTimes.GetRecentSummary();
+	double perFrame = frames > 0 ? 1.0 / frames : 0.0;
+	printf("%u frames, %.0f draws and %.0f binds (%.0f redundant) a frame: %.4f ms mean, %.4f ms p50, %.4f ms p99\n",
+		frames, totals.Draws * perFrame, totals.Binds * perFrame, totals.RedundantBinds * perFrame,
+		summary.Mean, summary.P50, summary.P99);
+
+	std::ofstream results(settings.ResultsFile);
+	if (results.is_open())
+	{
+		results << "name,value\n";
+		results << "frames," << frames << "\n";
+		results << "repeats," << settings.Repeats << "\n";
+		results << "commands," << replayer.GetCommandCount() << "\n";
+		results << "draws_per_frame," << totals.Draws * perFrame << "\n";
+		results << "indirect_draws_per_frame," << totals.IndirectDraws * perFrame << "\n";
+		results << "dispatches_per_frame," << totals.Dispatches * perFrame << "\n";
+		results << "indices_per_frame," << totals.Indices * perFrame << "\n";
+		results << "binds_per_frame," << totals.Binds * perFrame << "\n";
+		results << "redundant_binds_per_frame," << totals.RedundantBinds * perFrame << "\n";
+		results << "bytes_uploaded_per_frame," << totals.BytesUploaded * perFrame << "\n";
+		results << "mean_ms," << summary.Mean << "\n";
+		results << "p50_ms," << summary.P50 << "\n";
+		results << "p95_ms," << summary.P95 << "\n";
+		results << "p99_ms," << summary.P99 << "\n";
+		results << "max_ms," << summary.Max << "\n";
+		if (summary.Mean > 0.0)
+			results << "frames_per_s," << 1000.0 / summary.Mean << "\n";
+	}
+	else
+	{
+		printf("Couldn't write %s\n", settings.ResultsFile.c_str());
+	}
+
+	return 0;
+}
+
+CommandReplayer::CommandReplayer()
+	:
+	frameCount(0)
+{
+}
+
+// --------------------------------------------------------
+// Reads a whole capture, decoding every command
+// --------------------------------------------------------
+bool CommandReplayer::Load(const std::string& path)
+{
+	frameCount = 0;
+	resources.clear();
+	commands.clear();
+	commandIds.clear();
+	commandBytes.clear();
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	CommandStream::Header header = {};
+	file.read((char*)&header, sizeof(header));
+	if (!file.good() ||
+		header.Magic != CommandStream::Magic ||
+		header.Version != CommandStream::Version ||
+		header.CommandBytes > MaxBufferSize ||
+		header.ResourceCount > header.CommandBytes)
+		return false;
+
+	std::vector<unsigned char> stream((size_t)header.CommandBytes);
+	file.read((char*)stream.data(), stream.size());
+	if ((size_t)file.gcount() != stream.size() || file.peek() != EOF)
+		return false;
+
+	resources.resize((size_t)header.ResourceCount + 1);
+	for (Resource& resource : resources)
+		resource.Kind = NoResource;
+
+	CommandStream::Reader reader(stream.data(), stream.size());
+	if (!Decode(reader) || frameCount != header.FrameCount)
+	{
+		resources.clear();
+		commands.clear();
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Reads a resource id, which has to be null or one already
+// defined as the given kind
+// --------------------------------------------------------
+bool CommandReplayer::ReadId(CommandStream::Reader& reader, ResourceKind kind, unsigned int* id)
+{
+	*id = reader.ReadUInt();
+	if (reader.Failed() || *id >= resources.size())
+		return false;
+	return *id == 0 || resources[*id].Kind == kind;
+}
+
+// --------------------------------------------------------
+// Decodes the stream into commands and definitions, checking
+// everything as it goes
+// --------------------------------------------------------
+bool CommandReplayer::Decode(CommandStream::Reader& reader)
+{
+	while (true)
+	{
+		unsigned int op = reader.ReadUInt();
+		if (reader.Failed() || op >= CommandStream::OpCount)
+			return false;
+		if (op == CommandStream::End)
+			return reader.AtEnd();
+
+		// Definitions only fill in their resource
+		if (op >= CommandStream::DefineBuffer && op <= CommandStream::DefineShader)
+		{
+			unsigned int id = reader.ReadUInt();
+			if (reader.Failed() || id == 0 || id >= resources.size() || resources[id].Kind != NoResource)
+				return false;
+
+			Resource& resource = resources[id];
+			switch (op)
+			{
+			case CommandStream::DefineBuffer:
+			{
+				unsigned int type = reader.ReadUInt();
+				unsigned int access = reader.ReadUInt();
+				resource.Buffer.ByteWidth = reader.ReadUInt();
+				resource.Buffer.Stride = reader.ReadUInt();
+				if (type > RenderBufferDesc::IndirectArgsBuffer || access > RenderBufferDesc::Dynamic ||
+					resource.Buffer.ByteWidth == 0 || resource.Buffer.ByteWidth > MaxBufferSize)
+					return false;
+				resource.Buffer.Type = (RenderBufferDesc::Kind)type;
+				resource.Buffer.Access = (RenderBufferDesc::Usage)access;
+				resource.Kind = BufferResource;
+				break;
+			}
+			case CommandStream::DefineTexture:
+			{
+				RenderTextureDesc& desc = resource.Texture;
+				desc.Width = reader.ReadUInt();
+				desc.Height = reader.ReadUInt();
+				desc.MipLevels = reader.ReadUInt();
+				desc.ArraySize = reader.ReadUInt();
+				desc.Cube = reader.ReadUInt() != 0;
+				if (desc.Width == 0 || desc.Width > MaxTextureSize ||
+					desc.Height == 0 || desc.Height > MaxTextureSize ||
+					desc.MipLevels == 0 || desc.MipLevels > MaxMipLevels ||
+					desc.ArraySize == 0 || desc.ArraySize > MaxArraySize)
+					return false;
+				resource.Kind = TextureResource;
+				break;
+			}
+			case CommandStream::DefineSampler:
+			{
+				unsigned int filter = reader.ReadUInt();
+				unsigned int address = reader.ReadUInt();
+				resource.Sampler.MaxAnisotropy = reader.ReadUInt();
+				if (filter > RenderSamplerDesc::Anisotropic || address > RenderSamplerDesc::Clamp)
+					return false;
+				resource.Sampler.Filter = (RenderSamplerDesc::FilterMode)filter;
+				resource.Sampler.Address = (RenderSamplerDesc::AddressMode)address;
+				resource.Kind = SamplerResource;
+				break;
+			}
+			case CommandStream::DefinePipelineState:
+			{
+				unsigned int cull = reader.ReadUInt();
+				resource.PipelineState.DepthEnable = reader.ReadUInt() != 0;
+				resource.PipelineState.DepthWrite = reader.ReadUInt() != 0;
+				unsigned int depthTest = reader.ReadUInt();
+				if (cull > RenderPipelineStateDesc::CullBack || depthTest > RenderPipelineStateDesc::Always)
+					return false;
+				resource.PipelineState.Cull = (RenderPipelineStateDesc::CullMode)cull;
+				resource.PipelineState.DepthTest = (RenderPipelineStateDesc::DepthFunc)depthTest;
+				resource.Kind = PipelineStateResource;
+				break;
+			}
+			case CommandStream::DefineShader:
+			{
+				unsigned int count = reader.ReadUInt();
+				if (count > RenderConstantBufferRanges::MaxBuffers)
+					return false;
+				for (unsigned int i = 0; i < count; i++)
+				{
+					unsigned int size = reader.ReadUInt();
+					if (size > MaxBufferSize)
+						return false;
+					resource.ConstantBufferSizes.push_back(size);
+				}
+				resource.Kind = ShaderResource;
+				break;
+			}
+			}
+
+			if (reader.Failed())
+				return false;
+			continue;
+		}
+
+		Command command = {};
+		command.Op = (CommandStream::Op)op;
+		command.Stage = RenderContext::VertexStage;
+		bool valid = true;
+		switch (op)
+		{
+		case CommandStream::BeginFrame:
+			frameCount++;
+			break;
+
+		case CommandStream::SetPipelineState:
+			valid = ReadId(reader, PipelineStateResource, &command.Values[0]);
+			break;
+
+		case CommandStream::SetVertexBuffer:
+			valid = ReadId(reader, BufferResource, &command.Values[0]);
+			command.Values[1] = reader.ReadUInt();
+			command.Values[2] = reader.ReadUInt();
+			break;
+
+		case CommandStream::SetIndexBuffer:
+			valid = ReadId(reader, BufferResource, &command.Values[0]);
+			command.Values[1] = reader.ReadUInt();
+			break;
+
+		case CommandStream::SetShader:
+		case CommandStream::SetConstantBuffer:
+		case CommandStream::SetTextures:
+		case CommandStream::SetSamplers:
+		{
+			unsigned int stage = reader.ReadUInt();
+			if (stage >= StageCount)
+				return false;
+			command.Stage = (RenderContext::Stage)stage;
+
+			if (op == CommandStream::SetShader)
+			{
+				valid = ReadId(reader, ShaderResource, &command.Values[0]);
+			}
+			else if (op == CommandStream::SetConstantBuffer)
+			{
+				command.Values[0] = reader.ReadUInt();
+				valid = ReadId(reader, BufferResource, &command.Values[1]);
+			}
+			else
+			{
+				ResourceKind kind = op == CommandStream::SetTextures ? TextureResource : SamplerResource;
+				command.Values[0] = reader.ReadUInt();
+				command.Count = reader.ReadUInt();
+				command.Data = commandIds.size();
+				if (command.Count > MaxBindCount)
+					return false;
+				for (unsigned int i = 0; i < command.Count && valid; i++)
+				{
+					unsigned int id = 0;
+					valid = ReadId(reader, kind, &id);
+					commandIds.push_back(id);
+				}
+			}
+			break;
+		}
+
+		case CommandStream::SetConstants:
+		case CommandStream::UpdateBuffer:
+		{
+			unsigned int id = reader.ReadUInt();
+			if (reader.Failed() || id == 0 || id >= resources.size())
+				return false;
+			command.Values[0] = id;
+			if (op == CommandStream::SetConstants)
+			{
+				// The buffer has to exist, and the data has to fit it
+				command.Values[1] = reader.ReadUInt();
+				command.Count = reader.ReadUInt();
+				const Resource& shader = resources[id];
+				valid = shader.Kind == ShaderResource &&
+					command.Values[1] < shader.ConstantBufferSizes.size() &&
+					command.Count <= shader.ConstantBufferSizes[command.Values[1]];
+			}
+			else
+			{
+				command.Count = reader.ReadUInt();
+				valid = resources[id].Kind == BufferResource && command.Count <= resources[id].Buffer.ByteWidth;
+			}
+			if (!valid)
+				return false;
+
+			const unsigned char* bytes = reader.ReadBytes(command.Count);
+			if (!bytes)
+				return false;
+			command.Data = commandBytes.size();
+			commandBytes.insert(commandBytes.end(), bytes, bytes + command.Count);
+			break;
+		}
+
+		case CommandStream::DrawIndexed:
+			command.Values[0] = reader.ReadUInt();
+			command.Values[1] = reader.ReadUInt();
+			command.BaseVertex = (int)reader.ReadSigned();
+			break;
+
+		case CommandStream::DrawIndexedIndirect:
+			valid = ReadId(reader, BufferResource, &command.Values[0]);
+			command.Values[1] = reader.ReadUInt();
+			break;
+
+		case CommandStream::Dispatch:
+			command.Values[0] = reader.ReadUInt();
+			command.Values[1] = reader.ReadUInt();
+			command.Values[2] = reader.ReadUInt();
+			break;
+		}
+
+		if (!valid || reader.Failed())
+			return false;
+
+		// Commands before the first frame have nowhere to go
+		if (frameCount == 0)
+			return false;
+		commands.push_back(command);
+	}
+}
+
+// --------------------------------------------------------
+// Creates every defined resource and shader
+// - Buffers that need initial data, and all textures, are
+//   filled with zeros
+// --------------------------------------------------------
+bool CommandReplayer::CreateResources(RenderDevice* device, ShaderFactory shaderFactory)
+{
+	shaderDirty.assign(resources.size(), false);
+
+	std::vector<unsigned char> zeros;
+	std::vector<const void*> subresources;
+	for (Resource& resource : resources)
+	{
+		switch (resource.Kind)
+		{
+		case BufferResource:
+			if (resource.Buffer.Access == RenderBufferDesc::Immutable && zeros.size() < resource.Buffer.ByteWidth)
+				zeros.resize(resource.Buffer.ByteWidth, 0);
+			resource.CreatedBuffer = device->CreateBuffer(resource.Buffer,
+				resource.Buffer.Access == RenderBufferDesc::Immutable ? zeros.data() : 0);
+			if (!resource.CreatedBuffer)
+				return false;
+			break;
+
+		case TextureResource:
+		{
+			// Every subresource can share the top mip's zeros
+			size_t topMipBytes = (size_t)resource.Texture.Width * resource.Texture.Height * 4;
+			if (zeros.size() < topMipBytes)
+				zeros.resize(topMipBytes, 0);
+			subresources.assign((size_t)resource.Texture.MipLevels * resource.Texture.ArraySize, zeros.data());
+			resource.CreatedTexture = device->CreateTexture(resource.Texture, subresources.data());
+			if (!resource.CreatedTexture)
+				return false;
+			break;
+		}
+
+		case SamplerResource:
+			resource.CreatedSampler = device->CreateSampler(resource.Sampler);
+			if (!resource.CreatedSampler)
+				return false;
+			break;
+
+		case PipelineStateResource:
+			resource.CreatedPipelineState = device->CreatePipelineState(resource.PipelineState);
+			if (!resource.CreatedPipelineState)
+				return false;
+			break;
+
+		case ShaderResource:
+			resource.CreatedShader = shaderFactory(resource.ConstantBufferSizes);
+			if (!resource.CreatedShader)
+				return false;
+			break;
+
+		default:
+			break;
+		}
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies the constants of every shader that was given new
+// ones - shaders rebind their own constants if they're
+// bound when copied, so the new data is what gets drawn with
+// --------------------------------------------------------
+void CommandReplayer::CopyDirtyShaders()
+{
+	for (unsigned int id : dirtyShaders)
+	{
+		resources[id].CreatedShader->CopyAllBufferData();
+		shaderDirty[id] = false;
+	}
+	dirtyShaders.clear();
+}
+
+// --------------------------------------------------------
+// Submits every command, in order, as the app did
+// --------------------------------------------------------
+void CommandReplayer::Replay(RenderContext* context, FrameCallback beginFrame)
+{
+	RenderTexture* textures[MaxBindCount];
+	RenderSampler* samplers[MaxBindCount];
+	unsigned int frame = 0;
+	for (const Command& command : commands)
+	{
+		switch (command.Op)
+		{
+		case CommandStream::BeginFrame:
+			if (beginFrame)
+				beginFrame(frame);
+			frame++;
+			break;
+
+		case CommandStream::SetPipelineState:
+			context->SetPipelineState(resources[command.Values[0]].CreatedPipelineState.get());
+			break;
+
+		case CommandStream::SetVertexBuffer:
+			context->SetVertexBuffer(resources[command.Values[0]].CreatedBuffer.get(), command.Values[1], command.Values[2]);
+			break;
+
+		case CommandStream::SetIndexBuffer:
+			context->SetIndexBuffer(resources[command.Values[0]].CreatedBuffer.get(), command.Values[1]);
+			break;
+
+		case CommandStream::SetShader:
+		{
+			// New constants go up before the bind, as the app copied them
+			unsigned int id = command.Values[0];
+			RenderShader* shader = resources[id].CreatedShader.get();
+			if (id != 0 && shaderDirty[id])
+			{
+				shader->CopyAllBufferData();
+				shaderDirty[id] = false;
+				for (size_t i = 0; i < dirtyShaders.size(); i++)
+				{
+					if (dirtyShaders[i] == id)
+					{
+						dirtyShaders.erase(dirtyShaders.begin() + i);
+						break;
+					}
+				}
+			}
+			context->SetShader(command.Stage, shader, 0);
+			break;
+		}
+
+		case CommandStream::SetConstantBuffer:
+			context->SetConstantBuffer(command.Stage, command.Values[0], resources[command.Values[1]].CreatedBuffer.get());
+			break;
+
+		case CommandStream::SetTextures:
+			for (unsigned int i = 0; i < command.Count; i++)
+				textures[i] = resources[commandIds[command.Data + i]].CreatedTexture.get();
+			context->SetTextures(command.Stage, command.Values[0], command.Count, textures);
+			break;
+
+		case CommandStream::SetSamplers:
+			for (unsigned int i = 0; i < command.Count; i++)
+				samplers[i] = resources[commandIds[command.Data + i]].CreatedSampler.get();
+			context->SetSamplers(command.Stage, command.Values[0], command.Count, samplers);
+			break;
+
+		case CommandStream::SetConstants:
+		{
+			unsigned int id = command.Values[0];
+			resources[id].CreatedShader->SetConstantBufferData(command.Values[1], commandBytes.data() + command.Data, command.Count);
+			if (!shaderDirty[id])
+			{
+				shaderDirty[id] = true;
+				dirtyShaders.push_back(id);
+			}
+			break;
+		}
+
+		case CommandStream::UpdateBuffer:
+			context->UpdateBuffer(resources[command.Values[0]].CreatedBuffer.get(), commandBytes.data() + command.Data, command.Count);
+			break;
+
+		case CommandStream::DrawIndexed:
+			CopyDirtyShaders();
+			context->DrawIndexed(command.Values[0], command.Values[1], command.BaseVertex);
+			break;
+
+		case CommandStream::DrawIndexedIndirect:
+			CopyDirtyShaders();
+			context->DrawIndexedIndirect(resources[command.Values[0]].CreatedBuffer.get(), command.Values[1]);
+			break;
+
+		case CommandStream::Dispatch:
+			CopyDirtyShaders();
+			context->Dispatch(command.Values[0], command.Values[1], command.Values[2]);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	// Constants set after the last draw never reached one, so they're dropped
+	for (unsigned int id : dirtyShaders)
+		shaderDirty[id] = false;
+	dirtyShaders.clear();
+}
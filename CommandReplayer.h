@@ -0,0 +1,122 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "RenderDevice.h"
+#include "CommandStream.h"
+
+// --------------------------------------------------------
+// Replays frames captured by CommandCapture through any
+// RenderDevice and RenderContext
+//
+// - Load() reads and checks the whole capture up front, so
+//   replaying only submits - nothing is parsed or allocated
+//   while frames are being timed
+// - Resources are recreated from their descriptions, with
+//   blank textures, and shaders come from a factory that
+//   makes the backend's shader for each captured layout
+// - Indirect args were written on the GPU, so aren't in the
+//   capture - indirect draws are replayed with blank args
+// - Constants are only copied when the capture changed them,
+//   so uploads of unchanged data aren't repeated
+// - Run() is the standalone benchmark: it replays against
+//   the null backend, as fast as it can, to time submission
+//   on its own, with no GPU or driver involved
+// - Portable C++ - builds anywhere
+// --------------------------------------------------------
+class CommandReplayer
+{
+public:
+	struct Settings
+	{
+		bool Enabled;
+		std::string File;
+		unsigned int Repeats;			// Timed replays of every frame, after an untimed one
+		std::string ResultsFile;
+	};
+
+	// Makes a shader with constant buffers of the given sizes, in registers zero and up
+	typedef std::function<std::shared_ptr<RenderShader>(const std::vector<unsigned int>& constantBufferSizes)> ShaderFactory;
+
+	// Called before each frame is replayed, with its index in the capture
+	typedef std::function<void(unsigned int frame)> FrameCallback;
+
+	// Defaults, for when the command line leaves something out
+	static Settings GetDefaultSettings();
+
+	// Reads settings from a command line like:
+	//   -replay file [-repeats N] [-results file]
+	// - Enabled is only set if -replay is there
+	// - Returns false on anything it can't read
+	static bool ParseCommandLine(const char* commandLine, Settings* settings);
+
+	// Replays a capture against the null backend and writes its timings
+	// and counts to the results file
+	// - Returns 0 once done, or 2 if the capture couldn't be loaded
+	static int Run(const Settings& settings);
+
+	CommandReplayer();
+
+	// Returns false if the file isn't a capture this can read, or is damaged
+	bool Load(const std::string& path);
+	unsigned int GetFrameCount() { return frameCount; }
+	size_t GetCommandCount() { return commands.size(); }
+
+	// Creates everything the capture uses - call once, before replaying
+	// - Returns false if the device or factory refused anything
+	bool CreateResources(RenderDevice* device, ShaderFactory shaderFactory);
+
+	// Submits every captured frame in order
+	void Replay(RenderContext* context, FrameCallback beginFrame);
+
+private:
+	enum ResourceKind { NoResource, BufferResource, TextureResource, SamplerResource, PipelineStateResource, ShaderResource };
+
+	// A resource's definition, and what it became on the device
+	struct Resource
+	{
+		ResourceKind Kind;
+		RenderBufferDesc Buffer;
+		RenderTextureDesc Texture;
+		RenderSamplerDesc Sampler;
+		RenderPipelineStateDesc PipelineState;
+		std::vector<unsigned int> ConstantBufferSizes;
+
+		std::shared_ptr<RenderBuffer> CreatedBuffer;
+		std::shared_ptr<RenderTexture> CreatedTexture;
+		std::shared_ptr<RenderSampler> CreatedSampler;
+		std::shared_ptr<RenderPipelineState> CreatedPipelineState;
+		std::shared_ptr<RenderShader> CreatedShader;
+	};
+
+	// A decoded command - Data indexes ids (for texture and sampler
+	// lists) or bytes (for constants and buffer updates)
+	struct Command
+	{
+		CommandStream::Op Op;
+		RenderContext::Stage Stage;
+		unsigned int Values[3];
+		int BaseVertex;
+		size_t Data;
+		unsigned int Count;
+	};
+
+	static const unsigned int StageCount = 3;
+	static const unsigned int MaxBindCount = 128;
+
+	unsigned int frameCount;
+	std::vector<Resource> resources;	// By id - zero is null
+	std::vector<Command> commands;
+	std::vector<unsigned int> commandIds;
+	std::vector<unsigned char> commandBytes;
+
+	// Replay state
+	std::vector<unsigned int> dirtyShaders;	// Constants set but not yet copied
+	std::vector<bool> shaderDirty;			// By id
+
+	bool Decode(CommandStream::Reader& reader);
+	bool ReadId(CommandStream::Reader& reader, ResourceKind kind, unsigned int* id);
+	void CopyDirtyShaders();
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// --------------------------------------------------------
+// The file format CommandCapture writes and CommandReplayer
+// reads - captured frames of RenderContext commands
+//
+// - A Header, then a stream of commands until End
+// - Each command is an Op byte followed by its values, as
+//   variable-length unsigned integers (seven bits a byte,
+//   low bits first), so small ids and counts take one byte
+// - Resources are numbered from one (zero is null), and each
+//   is defined, from its description, just before the first
+//   command that uses it
+// - Constant data is written when it changes: before a shader
+//   is bound, and before each draw for the shaders bound then
+// - Portable C++ - builds anywhere
+// --------------------------------------------------------
+class CommandStream
+{
+public:
+	// "RCAP", read as a little endian integer
+	static const uint32_t Magic = 0x50414352;
+	static const uint32_t Version = 1;
+
+	struct Header
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t FrameCount;
+		uint32_t ResourceCount;
+		uint64_t CommandBytes;	// Everything after the header
+	};
+
+	// Values after each op are listed in order
+	enum Op
+	{
+		End,
+		BeginFrame,
+
+		DefineBuffer,			// id, type, access, byte width, stride
+		DefineTexture,			// id, width, height, mips, array size, cube
+		DefineSampler,			// id, filter, address, max anisotropy
+		DefinePipelineState,	// id, cull, depth enable, depth write, depth test
+		DefineShader,			// id, buffer count, then each buffer's size
+
+		SetPipelineState,		// id
+		SetVertexBuffer,		// id, stride, offset
+		SetIndexBuffer,			// id, offset
+		SetShader,				// stage, id
+		SetConstantBuffer,		// stage, slot, id
+		SetTextures,			// stage, start slot, count, then each id
+		SetSamplers,			// stage, start slot, count, then each id
+		SetConstants,			// shader id, buffer index, size, then the bytes
+		UpdateBuffer,			// id, size, then the bytes
+
+		DrawIndexed,			// index count, start index, base vertex (zigzagged)
+		DrawIndexedIndirect,	// args id, args offset
+		Dispatch,				// groups x, y, z
+
+		OpCount
+	};
+
+	static void WriteValue(std::vector<unsigned char>& stream, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			stream.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		stream.push_back((unsigned char)value);
+	}
+
+	// Signed values are zigzagged first, so small negatives stay small
+	static void WriteSigned(std::vector<unsigned char>& stream, int64_t value)
+	{
+		WriteValue(stream, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+	}
+
+	static void WriteBytes(std::vector<unsigned char>& stream, const void* data, unsigned int size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		stream.insert(stream.end(), bytes, bytes + size);
+	}
+
+	// --------------------------------------------------------
+	// Reads through a stream, failing (for good) rather than
+	// reading past its end
+	// --------------------------------------------------------
+	class Reader
+	{
+	public:
+		Reader(const unsigned char* data, size_t size) : data(data), size(size), position(0), failed(false) {}
+
+		uint64_t ReadValue()
+		{
+			uint64_t value = 0;
+			for (unsigned int shift = 0; shift < 64; shift += 7)
+			{
+				if (position >= size)
+					break;
+				unsigned char byte = data[position++];
+				value |= (uint64_t)(byte & 0x7F) << shift;
+				if (!(byte & 0x80))
+					return value;
+			}
+			failed = true;
+			return 0;
+		}
+
+		// Unsigned values that have to fit 32 bits
+		unsigned int ReadUInt()
+		{
+			uint64_t value = ReadValue();
+			if (value > 0xFFFFFFFF)
+				failed = true;
+			return (unsigned int)value;
+		}
+
+		int64_t ReadSigned()
+		{
+			uint64_t value = ReadValue();
+			return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+		}
+
+		// Returns the bytes in place, or null if there aren't enough
+		const unsigned char* ReadBytes(size_t count)
+		{
+			if (count > size - position)
+			{
+				failed = true;
+				return 0;
+			}
+			const unsigned char* bytes = data + position;
+			position += count;
+			return bytes;
+		}
+
+		bool Failed() { return failed; }
+		bool AtEnd() { return position == size; }
+
+	private:
+		const unsigned char* data;
+		size_t size;
+		size_t position;
+		bool failed;
+	};
+};
@@ -0,0 +1,148 @@
+#include "ConstantBufferRing.h"
+
+// --------------------------------------------------------
+// Constructor - Checks for offset binding support and
+// creates the shared dynamic buffer and frame fences
+//
+// sizeInBytes       - Total size of the ring
+// maxFramesInFlight - How many frames the CPU may run ahead of the GPU
+// --------------------------------------------------------
+ConstantBufferRing::ConstantBufferRing(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	unsigned int sizeInBytes,
+	unsigned int maxFramesInFlight)
+	:
+	allocator(sizeInBytes),
+	context(context),
+	frameNumber(1),
+	completedFrame(0),
+	supported(false),
+	needsDiscard(true),
+	discardCount(0)
+{
+	// Binding by offset and mapping constant buffers with NO_OVERWRITE
+	// both need a Direct3D 11.1 runtime and driver support
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	HRESULT hr = device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	if (FAILED(hr) || !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+		return;
+
+	// Create the ring itself
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = allocator.GetCapacity();
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	if (FAILED(device->CreateBuffer(&desc, 0, buffer.GetAddressOf())))
+		return;
+
+	// Event queries tell us when the GPU is done with a frame
+	D3D11_QUERY_DESC queryDesc = {};
+	queryDesc.Query = D3D11_QUERY_EVENT;
+	frameFences.resize(maxFramesInFlight < 1 ? 1 : maxFramesInFlight);
+	for (auto& q : frameFences)
+		device->CreateQuery(&queryDesc, q.GetAddressOf());
+
+	supported = true;
+}
+
+// --------------------------------------------------------
+// Reclaims slices from frames the GPU has finished
+// --------------------------------------------------------
+void ConstantBufferRing::BeginFrame()
+{
+	if (!supported) return;
+
+	// If every fence is in use we have to wait for the oldest one,
+	// otherwise this frame's fence would overwrite a pending query
+	bool wait = frameNumber - completedFrame > frameFences.size();
+	RetireCompletedFrames(wait);
+}
+
+// --------------------------------------------------------
+// Closes this frame's slices under a new fence
+// --------------------------------------------------------
+void ConstantBufferRing::EndFrame()
+{
+	if (!supported) return;
+
+	context->End(frameFences[frameNumber % frameFences.size()].Get());
+	allocator.EndFrame(frameNumber);
+	frameNumber++;
+}
+
+// --------------------------------------------------------
+// Polls the frame fences in order, retiring every frame
+// the GPU has completed.
+//
+// wait - Spin until at least the oldest pending frame is done
+// --------------------------------------------------------
+void ConstantBufferRing::RetireCompletedFrames(bool wait)
+{
+	while (completedFrame + 1 < frameNumber)
+	{
+		uint64_t frame = completedFrame + 1;
+		ID3D11Query* fence = frameFences[frame % frameFences.size()].Get();
+
+		BOOL done = FALSE;
+		HRESULT hr = context->GetData(fence, &done, sizeof(done), wait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH);
+		if (hr == S_FALSE)
+		{
+			if (wait) continue; // Keep spinning on this frame
+			break;
+		}
+
+		// Either finished or the query failed (device removed, etc.) - don't hang on it
+		completedFrame = frame;
+		allocator.RetireFrames(completedFrame);
+		wait = false;
+	}
+}
+
+// --------------------------------------------------------
+// Copies the given data into a new slice of the ring
+//
+// data          - Bytes to copy
+// size          - Number of bytes
+// firstConstant - Receives the offset of the slice, in 16-byte constants
+// numConstants  - Receives the size of the slice, in 16-byte constants
+//
+// Returns false if the ring isn't supported or mapping failed
+// --------------------------------------------------------
+bool ConstantBufferRing::Upload(const void* data, unsigned int size, unsigned int* firstConstant, unsigned int* numConstants)
+{
+	if (!supported) return false;
+
+	unsigned int offset = allocator.Allocate(size);
+	if (offset == ConstantBufferRingAllocator::InvalidOffset)
+	{
+		// Out of space: discard the whole buffer so the driver hands us
+		// fresh memory, leaving in-flight frames with the old contents
+		allocator.Reset();
+		needsDiscard = true;
+		offset = allocator.Allocate(size);
+		if (offset == ConstantBufferRingAllocator::InvalidOffset)
+			return false;
+	}
+
+	// The very first map of a dynamic buffer must be a discard
+	D3D11_MAP mapType = needsDiscard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(buffer.Get(), 0, mapType, 0, &mapped)))
+		return false;
+
+	memcpy((unsigned char*)mapped.pData + offset, data, size);
+	context->Unmap(buffer.Get(), 0);
+
+	if (needsDiscard)
+	{
+		needsDiscard = false;
+		discardCount++;
+	}
+
+	*firstConstant = offset / 16;
+	*numConstants = ConstantBufferRingAllocator::AlignSize(size) / 16;
+	return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <vector>
+#include "ConstantBufferRingAllocator.h"
+
+// --------------------------------------------------------
+// One large dynamic constant buffer shared by many draws
+//
+// - Each CopyBufferData() gets its own 256-byte-aligned slice,
+//   written with Map(NO_OVERWRITE) instead of UpdateSubresource()
+// - Slices are bound with the *SetConstantBuffers1() offset
+//   variants, so the driver never has to rename tiny buffers
+// - Event queries act as per-frame fences so slices are only
+//   reused once the GPU has finished the frame that read them
+// --------------------------------------------------------
+class ConstantBufferRing
+{
+public:
+	ConstantBufferRing(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		unsigned int sizeInBytes,
+		unsigned int maxFramesInFlight = 3);
+
+	// Does this device support binding constant buffers by offset?
+	// If not, shaders should keep using their own buffers
+	bool IsSupported() { return supported; }
+
+	// Frame boundaries - call once each per frame around all uploads
+	void BeginFrame();
+	void EndFrame();
+
+	// Copies data into a fresh slice, returning the slice in constants (16 bytes each)
+	// - If the ring fills up, the buffer is discarded and GetGeneration() changes:
+	//   slices from before then are gone, so anything not yet submitted that
+	//   binds them (like a deferred command list) would read the wrong data
+	bool Upload(const void* data, unsigned int size, unsigned int* firstConstant, unsigned int* numConstants);
+
+	ID3D11Buffer* GetBuffer() { return buffer.Get(); }
+
+	// Stats
+	unsigned int GetUsedBytes() { return allocator.GetUsedBytes(); }
+	unsigned int GetCapacity() { return allocator.GetCapacity(); }
+	unsigned int GetDiscardCount() { return discardCount; }
+	unsigned int GetGeneration() { return allocator.GetGeneration(); }
+
+private:
+	ConstantBufferRingAllocator allocator;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+
+	// One event query per frame that can be in flight
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> frameFences;
+	uint64_t frameNumber;
+	uint64_t completedFrame;
+
+	bool supported;
+	bool needsDiscard;
+	unsigned int discardCount;
+
+	void RetireCompletedFrames(bool wait);
+};
+
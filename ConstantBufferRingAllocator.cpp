@@ -0,0 +1,126 @@
+#include "ConstantBufferRingAllocator.h"
+
+// --------------------------------------------------------
+// Constructor
+//
+// capacity - Total bytes in the ring (rounded down to the alignment)
+// --------------------------------------------------------
+ConstantBufferRingAllocator::ConstantBufferRingAllocator(unsigned int capacity)
+	:
+	capacity(capacity & ~(Alignment - 1)),
+	head(0),
+	tail(0),
+	used(0),
+	frameBytes(0),
+	generation(0)
+{
+}
+
+// --------------------------------------------------------
+// Reserves an aligned slice of the ring
+//
+// size    - Bytes requested (rounded up to the alignment)
+// wrapped - Optional, set to true if the slice starts over at offset zero
+//
+// Returns the byte offset of the slice, or InvalidOffset if the
+// frames still in flight leave no room for it
+// --------------------------------------------------------
+unsigned int ConstantBufferRingAllocator::Allocate(unsigned int size, bool* wrapped)
+{
+	if (wrapped) *wrapped = false;
+
+	unsigned int alignedSize = AlignSize(size);
+	if (size == 0 || alignedSize > capacity || used + alignedSize > capacity)
+		return InvalidOffset;
+
+	// Empty ring?  Start from the front so we don't fragment
+	if (used == 0)
+	{
+		head = 0;
+		tail = 0;
+	}
+
+	unsigned int offset = InvalidOffset;
+	if (head >= tail)
+	{
+		// Free space is [head, capacity) followed by [0, tail)
+		if (capacity - head >= alignedSize)
+		{
+			offset = head;
+			head += alignedSize;
+			used += alignedSize;
+			frameBytes += alignedSize;
+		}
+		else if (tail >= alignedSize)
+		{
+			// Not enough room at the end - skip it and start over at the front
+			unsigned int wasted = capacity - head;
+			offset = 0;
+			head = alignedSize;
+			used += wasted + alignedSize;
+			frameBytes += wasted + alignedSize;
+			if (wrapped) *wrapped = true;
+		}
+	}
+	else if (tail - head >= alignedSize)
+	{
+		// Free space is the gap between head and tail
+		offset = head;
+		head += alignedSize;
+		used += alignedSize;
+		frameBytes += alignedSize;
+	}
+
+	// Keep the head in range when a slice ends exactly at the end
+	if (head == capacity)
+		head = 0;
+
+	return offset;
+}
+
+// --------------------------------------------------------
+// Closes the current frame
+//
+// fenceValue - The value that RetireFrames() will later receive
+//              once the GPU is finished with this frame
+// --------------------------------------------------------
+void ConstantBufferRingAllocator::EndFrame(uint64_t fenceValue)
+{
+	FrameMarker marker = {};
+	marker.FenceValue = fenceValue;
+	marker.Head = head;
+	marker.Bytes = frameBytes;
+	frames.push_back(marker);
+
+	frameBytes = 0;
+}
+
+// --------------------------------------------------------
+// Frees the space used by all frames up to and including
+// the given fence value, oldest first
+// --------------------------------------------------------
+void ConstantBufferRingAllocator::RetireFrames(uint64_t completedFenceValue)
+{
+	while (!frames.empty() && frames.front().FenceValue <= completedFenceValue)
+	{
+		tail = frames.front().Head;
+		used -= frames.front().Bytes;
+		frames.pop_front();
+	}
+}
+
+// --------------------------------------------------------
+// Drops every allocation, including those from frames that
+// haven't been retired.  Only safe if the underlying memory
+// has been replaced (for instance, with a DISCARD map), and
+// slices from earlier generations must not be bound again
+// --------------------------------------------------------
+void ConstantBufferRingAllocator::Reset()
+{
+	generation++;
+	head = 0;
+	tail = 0;
+	used = 0;
+	frameBytes = 0;
+	frames.clear();
+}
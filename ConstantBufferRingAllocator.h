@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// --------------------------------------------------------
+// Bookkeeping for a frame-scoped ring of constant buffer memory
+//
+// - Hands out aligned offsets into a fixed-size range of bytes
+// - Space is only reclaimed once the frame that used it has
+//   been retired, which is signalled by a fence value
+// - Knows nothing about Direct3D, so the same logic can back
+//   any API that binds constant buffers by offset
+// --------------------------------------------------------
+class ConstantBufferRingAllocator
+{
+public:
+	// Returned by Allocate() when there isn't enough free space
+	static const unsigned int InvalidOffset = 0xFFFFFFFF;
+
+	// Constant buffer offsets must be multiples of 16 constants (256 bytes)
+	static const unsigned int Alignment = 256;
+
+	ConstantBufferRingAllocator(unsigned int capacity);
+
+	// Reserves a slice of at least "size" bytes, or returns InvalidOffset
+	// - "wrapped" is set when the slice starts back at the front of the ring
+	unsigned int Allocate(unsigned int size, bool* wrapped = 0);
+
+	// Closes the current frame's allocations under the given fence value
+	void EndFrame(uint64_t fenceValue);
+
+	// Frees the space of every closed frame whose fence is <= the given value
+	void RetireFrames(uint64_t completedFenceValue);
+
+	// Forgets everything, including frames still in flight
+	// - Starts a new generation, so slices handed out before it can be told apart
+	void Reset();
+
+	// Getters
+	unsigned int GetCapacity() { return capacity; }
+	unsigned int GetUsedBytes() { return used; }
+	unsigned int GetFramesInFlight() { return (unsigned int)frames.size(); }
+	unsigned int GetGeneration() { return generation; }
+
+	static unsigned int AlignSize(unsigned int size) { return (size + Alignment - 1) & ~(Alignment - 1); }
+
+private:
+	// Where a closed frame ended, and how many bytes it consumed
+	struct FrameMarker
+	{
+		uint64_t FenceValue;
+		unsigned int Head;
+		unsigned int Bytes;
+	};
+
+	unsigned int capacity;
+	unsigned int head;			// Next free byte
+	unsigned int tail;			// Oldest byte still in use
+	unsigned int used;			// Bytes between tail and head (including any wasted at the end when wrapping)
+	unsigned int frameBytes;	// Bytes consumed by the frame that is still open
+	unsigned int generation;	// Resets so far
+	std::deque<FrameMarker> frames;
+};
+
@@ -0,0 +1,340 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <string.h>
+#include <thread>
+
+// The calling thread's ring, once it has one
+thread_local CpuProfiler::ThreadBuffer* CpuProfiler::threadBuffer = 0;
+
+// --------------------------------------------------------
+// Steady clock time, in nanoseconds
+// --------------------------------------------------------
+static int64_t SteadyNanoseconds()
+{
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// --------------------------------------------------------
+// Constructor - takes a quick first measurement of the
+// tick rate, which GetTicksPerSecond() refines over time
+// --------------------------------------------------------
+CpuProfiler::CpuProfiler()
+	:
+	frameStarts(),
+	frameCount(0),
+	calibrationTicks(Now()),
+	calibrationNanoseconds(SteadyNanoseconds()),
+	ticksPerSecond(1e9)
+{
+#if CPU_PROFILER_RDTSC
+	int64_t elapsed = 0;
+	while ((elapsed = SteadyNanoseconds() - calibrationNanoseconds) < 2000000)
+		std::this_thread::yield();
+	ticksPerSecond = (double)(Now() - calibrationTicks) * 1e9 / (double)elapsed;
+#endif
+}
+
+// --------------------------------------------------------
+// Ticks per second, from the longest span measured so far
+// --------------------------------------------------------
+double CpuProfiler::GetTicksPerSecond()
+{
+#if CPU_PROFILER_RDTSC
+	int64_t elapsed = SteadyNanoseconds() - calibrationNanoseconds;
+	if (elapsed > 100000000)
+		ticksPerSecond = (double)(Now() - calibrationTicks) * 1e9 / (double)elapsed;
+#endif
+	return ticksPerSecond;
+}
+
+// --------------------------------------------------------
+// Gives the calling thread a ring - one left behind by a
+// thread that has exited, if there is one
+// --------------------------------------------------------
+CpuProfiler::ThreadBuffer* CpuProfiler::RegisterThread()
+{
+	// Hands the ring back when the thread exits
+	struct Release
+	{
+		~Release()
+		{
+			if (threadBuffer)
+				threadBuffer->Active.store(false, std::memory_order_release);
+			threadBuffer = 0;
+		}
+	};
+	static thread_local Release release;
+
+	std::lock_guard<std::mutex> lock(registryLock);
+	ThreadBuffer* buffer = 0;
+	for (auto& t : threads)
+	{
+		if (!t->Active.load(std::memory_order_acquire))
+		{
+			buffer = t.get();
+			break;
+		}
+	}
+
+	if (!buffer)
+	{
+		threads.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+		buffer = threads.back().get();
+		buffer->Events.reset(new Event[EventsPerThread]());
+		buffer->WriteIndex.store(0, std::memory_order_relaxed);
+		buffer->Index = (unsigned int)threads.size() - 1;
+	}
+
+	buffer->Active.store(true, std::memory_order_relaxed);
+	buffer->Depth = 0;
+	buffer->Name = "Thread " + std::to_string(buffer->Index);
+	threadBuffer = buffer;
+	return buffer;
+}
+
+// --------------------------------------------------------
+// Marks the start of a frame
+// --------------------------------------------------------
+void CpuProfiler::BeginFrame()
+{
+	uint64_t frame = frameCount.load(std::memory_order_relaxed);
+	frameStarts[frame % FrameHistory] = Now();
+	frameCount.store(frame + 1, std::memory_order_release);
+}
+
+// --------------------------------------------------------
+// Names the calling thread
+// --------------------------------------------------------
+void CpuProfiler::SetThreadName(const char* name)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(registryLock);
+	buffer->Name = name;
+}
+
+// --------------------------------------------------------
+// Finds when a finished frame started and ended, in ticks
+// --------------------------------------------------------
+bool CpuProfiler::GetFrameRange(unsigned int framesAgo, uint64_t* start, uint64_t* end)
+{
+	// The newest frame is still going, and the oldest slot may be being overwritten
+	uint64_t count = GetFrameCount();
+	if (framesAgo == 0 || framesAgo >= count || framesAgo >= FrameHistory - 1)
+		return false;
+
+	uint64_t frame = count - 1 - framesAgo;
+	*start = frameStarts[frame % FrameHistory];
+	*end = frameStarts[(frame + 1) % FrameHistory];
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies a ring's events that started in [start, end)
+//
+// - Events are pushed as they close, so walking back from
+//   the newest until one closed before the range began
+//   finds everything that could be in it
+// - The writer never waits for us, so it may lap part of
+//   the ring while we copy - anything it could have reached
+//   is thrown away afterwards
+// --------------------------------------------------------
+void CpuProfiler::CopyEvents(ThreadBuffer& buffer, uint64_t start, uint64_t end, std::vector<Event>& events)
+{
+	const Event* ring = buffer.Events.get();
+	uint64_t last = buffer.WriteIndex.load(std::memory_order_acquire);
+	uint64_t first = last > EventsPerThread ? last - EventsPerThread : 0;
+	while (first < last && ring[(last - 1) & (EventsPerThread - 1)].Start >= end)
+		last--;
+
+	uint64_t from = last;
+	while (from > first && ring[(from - 1) & (EventsPerThread - 1)].End >= start)
+		from--;
+
+	size_t firstCopied = events.size();
+	for (uint64_t i = from; i < last; i++)
+		events.push_back(ring[i & (EventsPerThread - 1)]);
+
+	// Drop whatever the writer may have lapped
+	uint64_t now = buffer.WriteIndex.load(std::memory_order_acquire);
+	uint64_t safe = now >= EventsPerThread ? now - EventsPerThread + 1 : 0;
+	if (safe > from)
+	{
+		size_t lapped = (size_t)std::min<uint64_t>(safe - from, last - from);
+		events.erase(events.begin() + firstCopied, events.begin() + firstCopied + lapped);
+	}
+
+	// Only the ones that started in range
+	events.erase(std::remove_if(events.begin() + firstCopied, events.end(),
+		[start, end](const Event& e) { return e.Start < start || e.Start >= end; }), events.end());
+
+	// Pushed as scopes close, so parents come after their children
+	std::sort(events.begin() + firstCopied, events.end(),
+		[](const Event& a, const Event& b) { return a.Start != b.Start ? a.Start < b.Start : a.Depth < b.Depth; });
+}
+
+// --------------------------------------------------------
+// Sums up a finished frame, per thread
+//
+// A scope that repeats under the same parent (a draw call
+// per object, say) is merged into one line with a count,
+// and its children merge the same way
+// --------------------------------------------------------
+bool CpuProfiler::SummarizeFrame(unsigned int framesAgo, std::vector<ThreadSummary>& summaries, double* frameMilliseconds)
+{
+	summaries.clear();
+	uint64_t start = 0;
+	uint64_t end = 0;
+	if (!GetFrameRange(framesAgo, &start, &end))
+		return false;
+
+	double msPerTick = 1000.0 / GetTicksPerSecond();
+	if (frameMilliseconds)
+		*frameMilliseconds = (double)(end - start) * msPerTick;
+
+	std::lock_guard<std::mutex> lock(registryLock);
+	std::vector<Event> events;
+	for (auto& t : threads)
+	{
+		events.clear();
+		CopyEvents(*t, start, end, events);
+		if (events.empty())
+			continue;
+
+		ThreadSummary summary;
+		summary.Name = t->Name;
+
+		// The line each depth is currently adding to
+		std::vector<int> openLines;
+		for (const Event& e : events)
+		{
+			if (openLines.size() <= e.Depth)
+				openLines.resize(e.Depth + 1, -1);
+
+			int line = openLines[e.Depth];
+			if (line < 0 || strcmp(summary.Scopes[line].Name, e.Name) != 0)
+			{
+				ScopeSummary scope = {};
+				scope.Name = e.Name;
+				scope.Depth = e.Depth;
+				line = (int)summary.Scopes.size();
+				summary.Scopes.push_back(scope);
+				openLines[e.Depth] = line;
+
+				// A new parent starts new children
+				for (size_t d = e.Depth + 1; d < openLines.size(); d++)
+					openLines[d] = -1;
+			}
+
+			summary.Scopes[line].Count++;
+			summary.Scopes[line].Milliseconds += (double)(e.End - e.Start) * msPerTick;
+		}
+
+		summaries.push_back(summary);
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Escapes a name for a JSON string
+// --------------------------------------------------------
+static std::string EscapeJson(const char* text)
+{
+	std::string escaped;
+	for (const char* c = text; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			escaped += '\\';
+		if ((unsigned char)*c >= 0x20)
+			escaped += *c;
+	}
+	return escaped;
+}
+
+// --------------------------------------------------------
+// Writes finished frames as Chrome trace events
+//
+// - Every scope is a complete ("X") event, with times in
+//   microseconds from the start of the first frame
+// - Frame starts are instant events, and threads are named
+//   with metadata events
+// --------------------------------------------------------
+bool CpuProfiler::WriteChromeTrace(const std::string& path, unsigned int frameCount)
+{
+	uint64_t start = 0;
+	uint64_t end = 0;
+	uint64_t firstStart = 0;
+	if (frameCount == 0 || !GetFrameRange(1, &start, &end) || !GetFrameRange(frameCount, &firstStart, &start))
+		return false;
+
+	std::ofstream trace(path);
+	if (!trace.is_open())
+		return false;
+
+	double usPerTick = 1000000.0 / GetTicksPerSecond();
+	trace.precision(3);
+	trace << std::fixed << "{\"traceEvents\":[\n";
+
+	// Frame markers
+	bool first = true;
+	for (unsigned int f = frameCount; f >= 1; f--)
+	{
+		uint64_t frameStart = 0;
+		uint64_t frameEnd = 0;
+		GetFrameRange(f, &frameStart, &frameEnd);
+		trace << (first ? "" : ",\n") << "{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":"
+			<< (double)(frameStart - firstStart) * usPerTick << "}";
+		first = false;
+	}
+
+	std::lock_guard<std::mutex> lock(registryLock);
+	std::vector<Event> events;
+	for (auto& t : threads)
+	{
+		events.clear();
+		CopyEvents(*t, firstStart, end, events);
+		if (events.empty())
+			continue;
+
+		trace << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t->Index
+			<< ",\"args\":{\"name\":\"" << EscapeJson(t->Name.c_str()) << "\"}}";
+		for (const Event& e : events)
+		{
+			trace << ",\n{\"name\":\"" << EscapeJson(e.Name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << t->Index
+				<< ",\"ts\":" << (double)(e.Start - firstStart) * usPerTick
+				<< ",\"dur\":" << (double)(e.End - e.Start) * usPerTick << "}";
+		}
+	}
+
+	trace << "\n]}\n";
+	return trace.good();
+}
+
+// --------------------------------------------------------
+// Times empty scopes, including the clock reads and the
+// push, on a thread of their own so they don't push real
+// events out of anyone's ring
+// --------------------------------------------------------
+double CpuProfiler::MeasureScopeOverhead(unsigned int iterations)
+{
+	double nanoseconds = 0.0;
+	std::thread scratch([&]()
+		{
+			CPU_PROFILE_THREAD("Overhead test");
+			{
+				// Warm up the ring and the clock
+				for (unsigned int i = 0; i < 1000; i++)
+					CpuProfileScope scope("Warm up");
+			}
+
+			int64_t start = SteadyNanoseconds();
+			for (unsigned int i = 0; i < iterations; i++)
+				CpuProfileScope scope("Empty scope");
+			nanoseconds = (double)(SteadyNanoseconds() - start) / (iterations ? iterations : 1);
+		});
+	scratch.join();
+	return nanoseconds;
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define CPU_PROFILER_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CPU_PROFILER_RDTSC 1
+#else
+#include <chrono>
+#define CPU_PROFILER_RDTSC 0
+#endif
+
+// Define as 0 to compile every scope out
+#ifndef CPU_PROFILING
+#define CPU_PROFILING 1
+#endif
+
+#if CPU_PROFILING
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+#define CPU_PROFILE_SCOPE(name) CpuProfileScope CPU_PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+#define CPU_PROFILE_FUNCTION() CPU_PROFILE_SCOPE(__FUNCTION__)
+#define CPU_PROFILE_FRAME() CpuProfiler::GetInstance().BeginFrame()
+#define CPU_PROFILE_THREAD(name) CpuProfiler::GetInstance().SetThreadName(name)
+#else
+#define CPU_PROFILE_SCOPE(name)
+#define CPU_PROFILE_FUNCTION()
+#define CPU_PROFILE_FRAME()
+#define CPU_PROFILE_THREAD(name)
+#endif
+
+// --------------------------------------------------------
+// Hierarchical CPU timing, on every thread at once
+//
+// - Scopes (see the macros above) record one event each as
+//   they close, into a ring owned by the recording thread,
+//   so recording never locks or shares a cache line
+// - Readers copy a ring and then throw away anything the
+//   writer could have lapped while they copied
+// - Frames are marked by the main thread, and events are
+//   sorted into frames by their start times
+// - Names must be string literals (or otherwise outlive the
+//   profiler), since only the pointers are kept
+// - No platform dependencies beyond the timestamp counter
+// --------------------------------------------------------
+class CpuProfiler
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	// - Worker threads all register at once, so this relies on C++11's
+	//   thread-safe statics, and it's never deleted so threads that
+	//   outlive main() can still record
+	static CpuProfiler& GetInstance()
+	{
+		static CpuProfiler* instance = new CpuProfiler();
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	CpuProfiler(CpuProfiler const&) = delete;
+	void operator=(CpuProfiler const&) = delete;
+
+private:
+	CpuProfiler();
+#pragma endregion
+
+public:
+	static const unsigned int EventsPerThread = 1 << 15;	// Must be a power of two
+	static const unsigned int FrameHistory = 256;			// Frame starts remembered
+
+	// One closed scope
+	struct Event
+	{
+		const char* Name;
+		uint64_t Start;		// Ticks
+		uint64_t End;
+		unsigned int Depth;	// Scopes open on this thread when it opened
+	};
+
+	// One thread's ring - only its own thread writes to it
+	struct ThreadBuffer
+	{
+		std::unique_ptr<Event[]> Events;
+		std::atomic<uint64_t> WriteIndex;	// Events ever written
+		std::atomic<bool> Active;			// False once the thread exits, so another can take it over
+		unsigned int Depth;
+		unsigned int Index;
+		std::string Name;					// Guarded by the registry lock
+
+		void Push(const char* name, uint64_t start, uint64_t end, unsigned int depth)
+		{
+			uint64_t index = WriteIndex.load(std::memory_order_relaxed);
+			Event& e = Events[index & (EventsPerThread - 1)];
+			e.Name = name;
+			e.Start = start;
+			e.End = end;
+			e.Depth = depth;
+			WriteIndex.store(index + 1, std::memory_order_release);
+		}
+	};
+
+	// Consecutive calls to the same scope, under the same parent, as one line
+	struct ScopeSummary
+	{
+		const char* Name;
+		unsigned int Depth;
+		unsigned int Count;
+		double Milliseconds;	// Total
+	};
+
+	// One thread's part of a frame
+	struct ThreadSummary
+	{
+		std::string Name;
+		std::vector<ScopeSummary> Scopes;	// In order, children after their parents
+	};
+
+	// The current time, in ticks
+	static uint64_t Now()
+	{
+#if CPU_PROFILER_RDTSC
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// The calling thread's ring, created the first time it's needed
+	static ThreadBuffer* GetThreadBuffer()
+	{
+		ThreadBuffer* buffer = threadBuffer;
+		return buffer ? buffer : GetInstance().RegisterThread();
+	}
+
+	// Marks the start of a frame - call once a frame, from one thread
+	void BeginFrame();
+
+	// Names the calling thread in summaries and traces
+	void SetThreadName(const char* name);
+
+	// Sums up each thread's scopes over a finished frame
+	//
+	// framesAgo - 1 for the last finished frame
+	//
+	// Returns false if that frame isn't known (or not finished)
+	bool SummarizeFrame(unsigned int framesAgo, std::vector<ThreadSummary>& threads, double* frameMilliseconds);
+
+	// Writes the last frameCount finished frames as Chrome trace-event JSON
+	// (chrome://tracing or ui.perfetto.dev can open it)
+	bool WriteChromeTrace(const std::string& path, unsigned int frameCount);
+
+	// Times empty scopes on a scratch thread, in nanoseconds per scope
+	double MeasureScopeOverhead(unsigned int iterations);
+
+	// Getters
+	uint64_t GetFrameCount() { return frameCount.load(std::memory_order_acquire); }
+	double GetTicksPerSecond();
+
+private:
+	static thread_local ThreadBuffer* threadBuffer;
+
+	// Every thread's ring - the list only grows, under the lock
+	std::mutex registryLock;
+	std::vector<std::unique_ptr<ThreadBuffer>> threads;
+
+	// Frame starts, in ticks, written only by the thread calling BeginFrame()
+	uint64_t frameStarts[FrameHistory];
+	std::atomic<uint64_t> frameCount;
+
+	// Ticks to seconds, measured against the steady clock
+	uint64_t calibrationTicks;
+	int64_t calibrationNanoseconds;
+	double ticksPerSecond;
+
+	ThreadBuffer* RegisterThread();
+	bool GetFrameRange(unsigned int framesAgo, uint64_t* start, uint64_t* end);
+	void CopyEvents(ThreadBuffer& buffer, uint64_t start, uint64_t end, std::vector<Event>& events);
+};
+
+// --------------------------------------------------------
+// Times everything from its construction to the end of its
+// block - use CPU_PROFILE_SCOPE() rather than this directly
+// --------------------------------------------------------
+class CpuProfileScope
+{
+public:
+	CpuProfileScope(const char* name)
+		: buffer(CpuProfiler::GetThreadBuffer()), name(name), depth(buffer->Depth++), start(CpuProfiler::Now()) {}
+	~CpuProfileScope()
+	{
+		uint64_t end = CpuProfiler::Now();
+		buffer->Depth--;
+		buffer->Push(name, start, end, depth);
+	}
+
+private:
+	CpuProfiler::ThreadBuffer* buffer;
+	const char* name;
+	unsigned int depth;
+	uint64_t start;
+
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+};
@@ -0,0 +1,70 @@
+#include "D3D11GpuTimer.h"
+
+// --------------------------------------------------------
+// Constructor - Creates every query up front
+// --------------------------------------------------------
+D3D11GpuTimer::D3D11GpuTimer(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	unsigned int frameSlots,
+	unsigned int timestampsPerFrame)
+	:
+	context(context),
+	timestampsPerFrame(timestampsPerFrame),
+	supported(true),
+	disjointQueries(frameSlots),
+	timestampQueries(frameSlots * timestampsPerFrame)
+{
+	D3D11_QUERY_DESC disjointDesc = {};
+	disjointDesc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+	for (unsigned int i = 0; i < disjointQueries.size() && supported; i++)
+		supported = SUCCEEDED(device->CreateQuery(&disjointDesc, disjointQueries[i].GetAddressOf()));
+
+	D3D11_QUERY_DESC timestampDesc = {};
+	timestampDesc.Query = D3D11_QUERY_TIMESTAMP;
+	for (unsigned int i = 0; i < timestampQueries.size() && supported; i++)
+		supported = SUCCEEDED(device->CreateQuery(&timestampDesc, timestampQueries[i].GetAddressOf()));
+}
+
+void D3D11GpuTimer::BeginFrame(unsigned int slot)
+{
+	context->Begin(disjointQueries[slot].Get());
+}
+
+void D3D11GpuTimer::EndFrame(unsigned int slot)
+{
+	context->End(disjointQueries[slot].Get());
+}
+
+void D3D11GpuTimer::WriteTimestamp(unsigned int slot, unsigned int index)
+{
+	// Timestamps only have an end
+	context->End(timestampQueries[slot * timestampsPerFrame + index].Get());
+}
+
+// --------------------------------------------------------
+// Reads a slot's results, if the GPU has them
+// --------------------------------------------------------
+GpuTimerBackend::ReadResult D3D11GpuTimer::ReadFrame(unsigned int slot, unsigned int count, uint64_t* ticks, uint64_t* ticksPerSecond)
+{
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint = {};
+	HRESULT hr = context->GetData(disjointQueries[slot].Get(), &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+	if (hr == S_FALSE)
+		return NotReady;
+	if (FAILED(hr) || disjoint.Disjoint || disjoint.Frequency == 0)
+		return Invalid;
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		UINT64 value = 0;
+		hr = context->GetData(timestampQueries[slot * timestampsPerFrame + i].Get(), &value, sizeof(value), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+		if (hr == S_FALSE)
+			return NotReady;
+		if (FAILED(hr))
+			return Invalid;
+		ticks[i] = value;
+	}
+
+	*ticksPerSecond = disjoint.Frequency;
+	return Ready;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+#include "GpuTimerBackend.h"
+
+// --------------------------------------------------------
+// GpuTimerBackend for Direct3D 11 - a disjoint query per
+// frame slot, and a timestamp query per timestamp
+// --------------------------------------------------------
+class D3D11GpuTimer : public GpuTimerBackend
+{
+public:
+	D3D11GpuTimer(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		unsigned int frameSlots,
+		unsigned int timestampsPerFrame);
+
+	bool IsSupported() { return supported; }
+	void BeginFrame(unsigned int slot);
+	void EndFrame(unsigned int slot);
+	void WriteTimestamp(unsigned int slot, unsigned int index);
+	ReadResult ReadFrame(unsigned int slot, unsigned int count, uint64_t* ticks, uint64_t* ticksPerSecond);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	unsigned int timestampsPerFrame;
+	bool supported;
+
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> disjointQueries;	// Per slot
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> timestampQueries;	// Per slot, timestampsPerFrame each
+};
@@ -0,0 +1,361 @@
+#include "D3D11RenderDevice.h"
+#include "SimpleShader.h"
+#include <string.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Unwrappers - null handles become null D3D objects
+// --------------------------------------------------------
+static ID3D11Buffer* GetBuffer(RenderBuffer* buffer)
+{
+	return buffer ? static_cast<D3D11RenderBuffer*>(buffer)->GetBuffer() : 0;
+}
+
+static ID3D11ShaderResourceView* GetSRV(RenderTexture* texture)
+{
+	return texture ? static_cast<D3D11RenderTexture*>(texture)->GetSRV() : 0;
+}
+
+static ID3D11SamplerState* GetSampler(RenderSampler* sampler)
+{
+	return sampler ? static_cast<D3D11RenderSampler*>(sampler)->GetSampler() : 0;
+}
+
+static D3D11_COMPARISON_FUNC GetComparison(RenderPipelineStateDesc::DepthFunc func)
+{
+	switch (func)
+	{
+	case RenderPipelineStateDesc::LessEqual: return D3D11_COMPARISON_LESS_EQUAL;
+	case RenderPipelineStateDesc::Equal: return D3D11_COMPARISON_EQUAL;
+	case RenderPipelineStateDesc::Always: return D3D11_COMPARISON_ALWAYS;
+	default: return D3D11_COMPARISON_LESS;
+	}
+}
+
+
+D3D11RenderDevice::D3D11RenderDevice(Microsoft::WRL::ComPtr<ID3D11Device> device)
+	:
+	device(device)
+{
+}
+
+// --------------------------------------------------------
+// Creates a buffer, filled with initialData if given
+// --------------------------------------------------------
+std::shared_ptr<RenderBuffer> D3D11RenderDevice::CreateBuffer(const RenderBufferDesc& desc, const void* initialData)
+{
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = desc.ByteWidth;
+	switch (desc.Type)
+	{
+	case RenderBufferDesc::VertexBuffer: bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER; break;
+	case RenderBufferDesc::IndexBuffer: bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER; break;
+	case RenderBufferDesc::ConstantBuffer: bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER; break;
+	case RenderBufferDesc::IndirectArgsBuffer: bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS; break;
+	}
+	switch (desc.Access)
+	{
+	case RenderBufferDesc::Immutable: bufferDesc.Usage = D3D11_USAGE_IMMUTABLE; break;
+	case RenderBufferDesc::Default: bufferDesc.Usage = D3D11_USAGE_DEFAULT; break;
+	case RenderBufferDesc::Dynamic:
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		break;
+	}
+
+	D3D11_SUBRESOURCE_DATA data = {};
+	data.pSysMem = initialData;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	if (FAILED(device->CreateBuffer(&bufferDesc, initialData ? &data : 0, buffer.GetAddressOf())))
+		return 0;
+	return std::make_shared<D3D11RenderBuffer>(desc, buffer);
+}
+
+// --------------------------------------------------------
+// Creates an immutable RGBA8 texture (or cube map) and its
+// shader resource view
+// --------------------------------------------------------
+std::shared_ptr<RenderTexture> D3D11RenderDevice::CreateTexture(const RenderTextureDesc& desc, const void* const* data)
+{
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = desc.Width;
+	textureDesc.Height = desc.Height;
+	textureDesc.MipLevels = desc.MipLevels;
+	textureDesc.ArraySize = desc.ArraySize;
+	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	textureDesc.MiscFlags = desc.Cube ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+	// One entry per subresource, each mip half the size of the one before
+	std::vector<D3D11_SUBRESOURCE_DATA> subresources(desc.MipLevels * desc.ArraySize);
+	for (unsigned int slice = 0; slice < desc.ArraySize; slice++)
+	{
+		for (unsigned int mip = 0; mip < desc.MipLevels; mip++)
+		{
+			unsigned int width = desc.Width >> mip;
+			D3D11_SUBRESOURCE_DATA& subresource = subresources[slice * desc.MipLevels + mip];
+			subresource.pSysMem = data[slice * desc.MipLevels + mip];
+			subresource.SysMemPitch = (width > 0 ? width : 1) * 4;
+		}
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(device->CreateTexture2D(&textureDesc, subresources.data(), texture.GetAddressOf())))
+		return 0;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = textureDesc.Format;
+	if (desc.Cube)
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MipLevels = desc.MipLevels;
+	}
+	else if (desc.ArraySize > 1)
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MipLevels = desc.MipLevels;
+		srvDesc.Texture2DArray.ArraySize = desc.ArraySize;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = desc.MipLevels;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (FAILED(device->CreateShaderResourceView(texture.Get(), &srvDesc, srv.GetAddressOf())))
+		return 0;
+	return std::make_shared<D3D11RenderTexture>(desc, srv);
+}
+
+std::shared_ptr<RenderSampler> D3D11RenderDevice::CreateSampler(const RenderSamplerDesc& desc)
+{
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	switch (desc.Filter)
+	{
+	case RenderSamplerDesc::Point: samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT; break;
+	case RenderSamplerDesc::Linear: samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR; break;
+	case RenderSamplerDesc::Anisotropic: samplerDesc.Filter = D3D11_FILTER_ANISOTROPIC; break;
+	}
+	D3D11_TEXTURE_ADDRESS_MODE address = desc.Address == RenderSamplerDesc::Clamp ?
+		D3D11_TEXTURE_ADDRESS_CLAMP :
+		D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressU = address;
+	samplerDesc.AddressV = address;
+	samplerDesc.AddressW = address;
+	samplerDesc.MaxAnisotropy = desc.MaxAnisotropy;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
+	if (FAILED(device->CreateSamplerState(&samplerDesc, sampler.GetAddressOf())))
+		return 0;
+	return std::make_shared<D3D11RenderSampler>(desc, sampler);
+}
+
+std::shared_ptr<RenderPipelineState> D3D11RenderDevice::CreatePipelineState(const RenderPipelineStateDesc& desc)
+{
+	D3D11_RASTERIZER_DESC rasterizerDesc = {};
+	rasterizerDesc.FillMode = D3D11_FILL_SOLID;
+	switch (desc.Cull)
+	{
+	case RenderPipelineStateDesc::CullNone: rasterizerDesc.CullMode = D3D11_CULL_NONE; break;
+	case RenderPipelineStateDesc::CullFront: rasterizerDesc.CullMode = D3D11_CULL_FRONT; break;
+	case RenderPipelineStateDesc::CullBack: rasterizerDesc.CullMode = D3D11_CULL_BACK; break;
+	}
+	rasterizerDesc.DepthClipEnable = true;
+
+	D3D11_DEPTH_STENCIL_DESC depthStencilDesc = {};
+	depthStencilDesc.DepthEnable = desc.DepthEnable;
+	depthStencilDesc.DepthWriteMask = desc.DepthWrite ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+	depthStencilDesc.DepthFunc = GetComparison(desc.DepthTest);
+
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizer;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencil;
+	if (FAILED(device->CreateRasterizerState(&rasterizerDesc, rasterizer.GetAddressOf())) ||
+		FAILED(device->CreateDepthStencilState(&depthStencilDesc, depthStencil.GetAddressOf())))
+		return 0;
+	return std::make_shared<D3D11RenderPipelineState>(desc, rasterizer, depthStencil);
+}
+
+// --------------------------------------------------------
+// Wraps a texture's view, describing it from the 2D texture
+// underneath (anything else is described as empty)
+// --------------------------------------------------------
+std::shared_ptr<RenderTexture> D3D11RenderDevice::WrapTexture(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+{
+	RenderTextureDesc desc = {};
+	Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	srv->GetResource(resource.GetAddressOf());
+	if (SUCCEEDED(resource.As(&texture)))
+	{
+		D3D11_TEXTURE2D_DESC textureDesc = {};
+		texture->GetDesc(&textureDesc);
+		desc.Width = textureDesc.Width;
+		desc.Height = textureDesc.Height;
+		desc.MipLevels = textureDesc.MipLevels;
+		desc.ArraySize = textureDesc.ArraySize;
+		desc.Cube = (textureDesc.MiscFlags & D3D11_RESOURCE_MISC_TEXTURECUBE) != 0;
+	}
+	return std::make_shared<D3D11RenderTexture>(desc, srv);
+}
+
+std::shared_ptr<RenderSampler> D3D11RenderDevice::WrapSampler(Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
+{
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	sampler->GetDesc(&samplerDesc);
+
+	RenderSamplerDesc desc = {};
+	if (samplerDesc.Filter == D3D11_FILTER_ANISOTROPIC)
+		desc.Filter = RenderSamplerDesc::Anisotropic;
+	else if (samplerDesc.Filter == D3D11_FILTER_MIN_MAG_MIP_POINT)
+		desc.Filter = RenderSamplerDesc::Point;
+	else
+		desc.Filter = RenderSamplerDesc::Linear;
+	desc.Address = samplerDesc.AddressU == D3D11_TEXTURE_ADDRESS_CLAMP ? RenderSamplerDesc::Clamp : RenderSamplerDesc::Wrap;
+	desc.MaxAnisotropy = samplerDesc.MaxAnisotropy;
+	return std::make_shared<D3D11RenderSampler>(desc, sampler);
+}
+
+
+D3D11RenderContext::D3D11RenderContext(std::shared_ptr<StateCache> stateCache, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+	:
+	stateCache(stateCache),
+	context(context)
+{
+}
+
+void D3D11RenderContext::SetPipelineState(RenderPipelineState* state)
+{
+	D3D11RenderPipelineState* d3dState = static_cast<D3D11RenderPipelineState*>(state);
+	stateCache->RSSetState(d3dState ? d3dState->GetRasterizer() : 0);
+	stateCache->OMSetDepthStencilState(d3dState ? d3dState->GetDepthStencil() : 0, 0);
+}
+
+void D3D11RenderContext::SetVertexBuffer(RenderBuffer* buffer, unsigned int stride, unsigned int offset)
+{
+	ID3D11Buffer* d3dBuffer = GetBuffer(buffer);
+	stateCache->IASetVertexBuffers(0, 1, &d3dBuffer, &stride, &offset);
+}
+
+void D3D11RenderContext::SetIndexBuffer(RenderBuffer* buffer, unsigned int offset)
+{
+	stateCache->IASetIndexBuffer(GetBuffer(buffer), DXGI_FORMAT_R32_UINT, offset);
+}
+
+// --------------------------------------------------------
+// Shaders here are always SimpleShaders
+// - Compute shaders don't use the constant buffer ring, so
+//   they always bind their own buffers
+// --------------------------------------------------------
+void D3D11RenderContext::SetShader(Stage stage, RenderShader* shader, const RenderConstantBufferRanges* ranges)
+{
+	if (!shader)
+	{
+		switch (stage)
+		{
+		case VertexStage: stateCache->VSSetShader(0); break;
+		case PixelStage: stateCache->PSSetShader(0); break;
+		case ComputeStage: context->CSSetShader(0, 0, 0); break;
+		}
+		return;
+	}
+
+	ISimpleShader* simpleShader = static_cast<ISimpleShader*>(shader);
+	if (ranges && stage != ComputeStage)
+		simpleShader->SetShader(stateCache, *ranges);
+	else
+		simpleShader->SetShader();
+}
+
+void D3D11RenderContext::SetConstantBuffer(Stage stage, unsigned int slot, RenderBuffer* buffer)
+{
+	ID3D11Buffer* d3dBuffer = GetBuffer(buffer);
+	switch (stage)
+	{
+	case VertexStage: stateCache->VSSetConstantBuffers(slot, 1, &d3dBuffer); break;
+	case PixelStage: stateCache->PSSetConstantBuffers(slot, 1, &d3dBuffer); break;
+	case ComputeStage: context->CSSetConstantBuffers(slot, 1, &d3dBuffer); break;
+	}
+}
+
+void D3D11RenderContext::SetTextures(Stage stage, unsigned int startSlot, unsigned int count, RenderTexture* const* textures)
+{
+	ID3D11ShaderResourceView* srvs[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+	if (count > D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT)
+		count = D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+	for (unsigned int i = 0; i < count; i++)
+		srvs[i] = GetSRV(textures[i]);
+
+	switch (stage)
+	{
+	case VertexStage: stateCache->VSSetShaderResources(startSlot, count, srvs); break;
+	case PixelStage: stateCache->PSSetShaderResources(startSlot, count, srvs); break;
+	case ComputeStage: context->CSSetShaderResources(startSlot, count, srvs); break;
+	}
+}
+
+void D3D11RenderContext::SetSamplers(Stage stage, unsigned int startSlot, unsigned int count, RenderSampler* const* samplers)
+{
+	ID3D11SamplerState* d3dSamplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+	if (count > D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT)
+		count = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+	for (unsigned int i = 0; i < count; i++)
+		d3dSamplers[i] = GetSampler(samplers[i]);
+
+	switch (stage)
+	{
+	case VertexStage: stateCache->VSSetSamplers(startSlot, count, d3dSamplers); break;
+	case PixelStage: stateCache->PSSetSamplers(startSlot, count, d3dSamplers); break;
+	case ComputeStage: context->CSSetSamplers(startSlot, count, d3dSamplers); break;
+	}
+}
+
+// --------------------------------------------------------
+// Dynamic buffers are mapped and discarded, the rest updated
+// in place (constant buffers always as a whole)
+// --------------------------------------------------------
+void D3D11RenderContext::UpdateBuffer(RenderBuffer* buffer, const void* data, unsigned int size)
+{
+	const RenderBufferDesc& desc = buffer->GetDesc();
+	if (size > desc.ByteWidth)
+		size = desc.ByteWidth;
+
+	if (desc.Access == RenderBufferDesc::Dynamic)
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		if (SUCCEEDED(context->Map(GetBuffer(buffer), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		{
+			memcpy(mapped.pData, data, size);
+			context->Unmap(GetBuffer(buffer), 0);
+		}
+		return;
+	}
+
+	if (desc.Type == RenderBufferDesc::ConstantBuffer || size == desc.ByteWidth)
+	{
+		context->UpdateSubresource(GetBuffer(buffer), 0, 0, data, 0, 0);
+		return;
+	}
+
+	D3D11_BOX box = { 0, 0, 0, size, 1, 1 };
+	context->UpdateSubresource(GetBuffer(buffer), 0, &box, data, 0, 0);
+}
+
+void D3D11RenderContext::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	stateCache->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void D3D11RenderContext::DrawIndexedIndirect(RenderBuffer* argsBuffer, unsigned int argsOffset)
+{
+	stateCache->DrawIndexedInstancedIndirect(GetBuffer(argsBuffer), argsOffset);
+}
+
+void D3D11RenderContext::Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ)
+{
+	context->Dispatch(groupsX, groupsY, groupsZ);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include "RenderDevice.h"
+#include "StateCache.h"
+
+// --------------------------------------------------------
+// Direct3D 11 resources behind the RenderDevice handles
+//
+// - These can wrap resources created elsewhere (textures
+//   from the WIC loader, buffers a GPU pass writes), and are
+//   cheap enough to wrap on the stack for a single call
+// --------------------------------------------------------
+class D3D11RenderBuffer : public RenderBuffer
+{
+public:
+	D3D11RenderBuffer(const RenderBufferDesc& desc, Microsoft::WRL::ComPtr<ID3D11Buffer> buffer)
+		: RenderBuffer(desc), buffer(buffer) {}
+	ID3D11Buffer* GetBuffer() { return buffer.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+};
+
+class D3D11RenderTexture : public RenderTexture
+{
+public:
+	D3D11RenderTexture(const RenderTextureDesc& desc, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+		: RenderTexture(desc), srv(srv) {}
+	ID3D11ShaderResourceView* GetSRV() { return srv.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+};
+
+class D3D11RenderSampler : public RenderSampler
+{
+public:
+	D3D11RenderSampler(const RenderSamplerDesc& desc, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
+		: RenderSampler(desc), sampler(sampler) {}
+	ID3D11SamplerState* GetSampler() { return sampler.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler;
+};
+
+class D3D11RenderPipelineState : public RenderPipelineState
+{
+public:
+	D3D11RenderPipelineState(
+		const RenderPipelineStateDesc& desc,
+		Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizer,
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencil)
+		: RenderPipelineState(desc), rasterizer(rasterizer), depthStencil(depthStencil) {}
+	ID3D11RasterizerState* GetRasterizer() { return rasterizer.Get(); }
+	ID3D11DepthStencilState* GetDepthStencil() { return depthStencil.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizer;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencil;
+};
+
+// --------------------------------------------------------
+// RenderDevice for Direct3D 11
+//
+// - Shaders are SimpleShaders, which are RenderShaders too,
+//   so they're loaded the usual way rather than through here
+// - Creation returns null if the device refuses
+// --------------------------------------------------------
+class D3D11RenderDevice : public RenderDevice
+{
+public:
+	D3D11RenderDevice(Microsoft::WRL::ComPtr<ID3D11Device> device);
+
+	std::shared_ptr<RenderBuffer> CreateBuffer(const RenderBufferDesc& desc, const void* initialData);
+	std::shared_ptr<RenderTexture> CreateTexture(const RenderTextureDesc& desc, const void* const* data);
+	std::shared_ptr<RenderSampler> CreateSampler(const RenderSamplerDesc& desc);
+	std::shared_ptr<RenderPipelineState> CreatePipelineState(const RenderPipelineStateDesc& desc);
+
+	// Adopts resources created outside of the device, describing them
+	// as closely as the interface can (formats other than RGBA8 and
+	// filters other than the three it knows are approximated)
+	static std::shared_ptr<RenderTexture> WrapTexture(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	static std::shared_ptr<RenderSampler> WrapSampler(Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+};
+
+// --------------------------------------------------------
+// RenderContext for Direct3D 11
+//
+// - Binds through a StateCache, so redundant binds are
+//   dropped exactly as they are for the rest of the frame,
+//   on whichever context (immediate or deferred) it wraps
+// - Cheap to create, so recording jobs can make one around
+//   their own cache
+// - Compute binds go straight to the context, since the
+//   cache only shadows the vertex and pixel stages
+// - A shader bound without ranges binds its constants
+//   through the cache it was set up with (the immediate
+//   one), as SimpleShader always has
+// --------------------------------------------------------
+class D3D11RenderContext : public RenderContext
+{
+public:
+	// context - The one stateCache binds through, for what the cache doesn't shadow
+	D3D11RenderContext(std::shared_ptr<StateCache> stateCache, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	void SetPipelineState(RenderPipelineState* state);
+	void SetVertexBuffer(RenderBuffer* buffer, unsigned int stride, unsigned int offset);
+	void SetIndexBuffer(RenderBuffer* buffer, unsigned int offset);
+	void SetShader(Stage stage, RenderShader* shader, const RenderConstantBufferRanges* ranges);
+	void SetConstantBuffer(Stage stage, unsigned int slot, RenderBuffer* buffer);
+	void SetTextures(Stage stage, unsigned int startSlot, unsigned int count, RenderTexture* const* textures);
+	void SetSamplers(Stage stage, unsigned int startSlot, unsigned int count, RenderSampler* const* samplers);
+	void UpdateBuffer(RenderBuffer* buffer, const void* data, unsigned int size);
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void DrawIndexedIndirect(RenderBuffer* argsBuffer, unsigned int argsOffset);
+	void Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
+
+	std::shared_ptr<StateCache> GetStateCache() { return stateCache; }
+
+private:
+	std::shared_ptr<StateCache> stateCache;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+};
@@ -0,0 +1,107 @@
+#include "D3D11StateCacheBackend.h"
+
+// --------------------------------------------------------
+// Keeps a reference to each object bound in a range of
+// slots, for the slots the cache shadows
+// --------------------------------------------------------
+template<typename T, unsigned int Count>
+static void Hold(Microsoft::WRL::ComPtr<T> (&held)[Count], unsigned int startSlot, unsigned int count, T* const* objects)
+{
+	for (unsigned int i = 0; i < count && startSlot + i < Count; i++)
+		held[startSlot + i] = objects ? objects[i] : 0;
+}
+
+D3D11StateCacheBackend::D3D11StateCacheBackend(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+	:
+	context(context)
+{
+	context.As(&context1);
+}
+
+void D3D11StateCacheBackend::SetInputLayout(ID3D11InputLayout* layout)
+{
+	inputLayout = layout;
+	context->IASetInputLayout(layout);
+}
+
+void D3D11StateCacheBackend::SetPrimitiveTopology(unsigned int topology)
+{
+	context->IASetPrimitiveTopology((D3D11_PRIMITIVE_TOPOLOGY)topology);
+}
+
+void D3D11StateCacheBackend::SetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* strides, const unsigned int* offsets)
+{
+	Hold(vertexBuffers, startSlot, numBuffers, buffers);
+	context->IASetVertexBuffers(startSlot, numBuffers, buffers, strides, offsets);
+}
+
+void D3D11StateCacheBackend::SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset)
+{
+	indexBuffer = buffer;
+	context->IASetIndexBuffer(buffer, (DXGI_FORMAT)format, offset);
+}
+
+void D3D11StateCacheBackend::SetVertexShader(ID3D11VertexShader* shader)
+{
+	vertexShader = shader;
+	context->VSSetShader(shader, 0, 0);
+}
+
+void D3D11StateCacheBackend::SetPixelShader(ID3D11PixelShader* shader)
+{
+	pixelShader = shader;
+	context->PSSetShader(shader, 0, 0);
+}
+
+void D3D11StateCacheBackend::SetConstantBuffers(Stage stage, unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* firstConstants, const unsigned int* numConstants)
+{
+	Hold(stages[stage].ConstantBuffers, startSlot, numBuffers, buffers);
+
+	bool ranged = firstConstants && numConstants && context1;
+	if (stage == VertexStage)
+	{
+		if (ranged) context1->VSSetConstantBuffers1(startSlot, numBuffers, buffers, firstConstants, numConstants);
+		else context->VSSetConstantBuffers(startSlot, numBuffers, buffers);
+	}
+	else
+	{
+		if (ranged) context1->PSSetConstantBuffers1(startSlot, numBuffers, buffers, firstConstants, numConstants);
+		else context->PSSetConstantBuffers(startSlot, numBuffers, buffers);
+	}
+}
+
+void D3D11StateCacheBackend::SetShaderResources(Stage stage, unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView* const* views)
+{
+	Hold(stages[stage].ShaderResources, startSlot, numViews, views);
+	if (stage == VertexStage) context->VSSetShaderResources(startSlot, numViews, views);
+	else context->PSSetShaderResources(startSlot, numViews, views);
+}
+
+void D3D11StateCacheBackend::SetSamplers(Stage stage, unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState* const* samplers)
+{
+	Hold(stages[stage].Samplers, startSlot, numSamplers, samplers);
+	if (stage == VertexStage) context->VSSetSamplers(startSlot, numSamplers, samplers);
+	else context->PSSetSamplers(startSlot, numSamplers, samplers);
+}
+
+void D3D11StateCacheBackend::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	rasterizerState = state;
+	context->RSSetState(state);
+}
+
+void D3D11StateCacheBackend::SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef)
+{
+	depthStencilState = state;
+	context->OMSetDepthStencilState(state, stencilRef);
+}
+
+void D3D11StateCacheBackend::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	context->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void D3D11StateCacheBackend::DrawIndexedInstancedIndirect(ID3D11Buffer* argsBuffer, unsigned int argsOffset)
+{
+	context->DrawIndexedInstancedIndirect(argsBuffer, argsOffset);
+}
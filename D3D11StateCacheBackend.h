@@ -0,0 +1,60 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include "StateCache.h"
+
+// --------------------------------------------------------
+// StateCacheBackend for Direct3D 11 - passes each call to
+// a device context (immediate or deferred)
+//
+// - Holds a reference to everything it binds in the slots
+//   a StateCache shadows, until that slot is bound again -
+//   the context's own references are dropped by things like
+//   FinishCommandList(), and the cache must never remember
+//   an address that could be reused
+// - Offset binds (for the constant buffer ring) need the
+//   11.1 context interface
+// --------------------------------------------------------
+class D3D11StateCacheBackend : public StateCacheBackend
+{
+public:
+	D3D11StateCacheBackend(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	void SetInputLayout(ID3D11InputLayout* layout);
+	void SetPrimitiveTopology(unsigned int topology);
+	void SetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* strides, const unsigned int* offsets);
+	void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset);
+	void SetVertexShader(ID3D11VertexShader* shader);
+	void SetPixelShader(ID3D11PixelShader* shader);
+	void SetConstantBuffers(Stage stage, unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* firstConstants, const unsigned int* numConstants);
+	void SetShaderResources(Stage stage, unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView* const* views);
+	void SetSamplers(Stage stage, unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState* const* samplers);
+	void SetRasterizerState(ID3D11RasterizerState* state);
+	void SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef);
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void DrawIndexedInstancedIndirect(ID3D11Buffer* argsBuffer, unsigned int argsOffset);
+
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> GetContext() { return context; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> context1;
+
+	// What's bound in each shadowed slot, kept alive
+	struct StageReferences
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffers[StateCache::MaxConstantBuffers];
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ShaderResources[StateCache::MaxShaderResources];
+		Microsoft::WRL::ComPtr<ID3D11SamplerState> Samplers[StateCache::MaxSamplers];
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffers[StateCache::MaxVertexBuffers];
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> pixelShader;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerState;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilState;
+	StageReferences stages[2];
+};
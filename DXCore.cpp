@@ -1,5 +1,6 @@
 #include "DXCore.h"
 #include "Input.h"
+#include "CpuProfiler.h"
 
 #include <WindowsX.h>
 #include <sstream>
@@ -46,12 +47,23 @@ DXCore::DXCore(
 	fpsTimeElapsed(0),
 	fpsFrameCount(0),
 	previousTime(0),
+	fixedTimeStep(0),
+	fixedTotalTime(0),
 	currentTime(0),
 	hasFocus(true),
 	deltaTime(0),
 	startTime(0),
 	totalTime(0),
-	hWnd(0)
+	hWnd(0),
+	framePipeliningRequested(false),
+	framePipelineDepth(2),
+	lastPipelineStats(),
+	headless(false),
+	headlessFrameLimit(0),
+	quitRequested(false),
+	frameReadbackDepth(0),
+	framesPresented(0),
+	frameTimes()
 {
 	// Save a static reference to this object.
 	//  - Since the OS-level message function must be a non-member (global) function, 
@@ -75,15 +87,50 @@ DXCore::~DXCore()
 	// - If we weren't using smart pointers, we'd need to call
 	//   Release() on each Direct3D object created in DXCore
 
+	// Run() normally stops the render thread already
+	StopFramePipeline();
+
 	// Delete input manager singleton
 	delete& Input::GetInstance();
 }
 
+// --------------------------------------------------------
+// Switches to rendering offscreen, with no window at all
+//
+// frameLimit - Frames to run before stopping, or 0 to run
+//              until Quit() is called
+// --------------------------------------------------------
+void DXCore::EnableHeadless(unsigned int frameLimit)
+{
+	headless = true;
+	headlessFrameLimit = frameLimit;
+	titleBarStats = false;
+}
+
+// --------------------------------------------------------
+// Reads every presented frame back to the CPU
+//
+// depth - Frames that can be in flight before a capture has
+//         to wait for the GPU (at least one)
+// --------------------------------------------------------
+void DXCore::EnableFrameReadback(unsigned int depth)
+{
+	frameReadbackDepth = depth < 1 ? 1 : depth;
+}
+
 // --------------------------------------------------------
 // Creates the actual window for our application
 // --------------------------------------------------------
 HRESULT DXCore::InitWindow()
 {
+	// No window when headless - input still needs its
+	// key arrays, though they'll never see a key press
+	if (headless)
+	{
+		Input::GetInstance().Initialize(0);
+		return S_OK;
+	}
+
 	// Start window creation by filling out the
 	// appropriate window class struct
 	WNDCLASS wndClass		= {}; // Zero out the memory
@@ -200,23 +247,58 @@ HRESULT DXCore::InitDirect3D()
 	// Result variable for below function calls
 	HRESULT hr = S_OK;
 
-	// Attempt to initialize Direct3D
-	hr = D3D11CreateDeviceAndSwapChain(
-		0,							// Video adapter (physical GPU) to use, or null for default
-		D3D_DRIVER_TYPE_HARDWARE,	// We want to use the hardware (GPU)
-		0,							// Used when doing software rendering
-		deviceFlags,				// Any special options
-		0,							// Optional array of possible verisons we want as fallbacks
-		0,							// The number of fallbacks in the above param
-		D3D11_SDK_VERSION,			// Current version of the SDK
-		&swapDesc,					// Address of swap chain options
-		swapChain.GetAddressOf(),	// Pointer to our Swap Chain pointer
-		device.GetAddressOf(),		// Pointer to our Device pointer
-		&dxFeatureLevel,			// This will hold the actual feature level the app will use
-		context.GetAddressOf());	// Pointer to our Device Context pointer
-	if (FAILED(hr)) return hr;
+	// Headless runs have just a device, and draw into a texture of their own
+	if (headless)
+	{
+		hr = D3D11CreateDevice(
+			0,
+			D3D_DRIVER_TYPE_HARDWARE,
+			0,
+			deviceFlags,
+			0,
+			0,
+			D3D11_SDK_VERSION,
+			device.GetAddressOf(),
+			&dxFeatureLevel,
+			context.GetAddressOf());
+		if (FAILED(hr)) return hr;
+
+		// Same format as the swap chain would have, so the output matches
+		D3D11_TEXTURE2D_DESC targetDesc = {};
+		targetDesc.Width = windowWidth;
+		targetDesc.Height = windowHeight;
+		targetDesc.MipLevels = 1;
+		targetDesc.ArraySize = 1;
+		targetDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		targetDesc.Usage = D3D11_USAGE_DEFAULT;
+		targetDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+		targetDesc.SampleDesc.Count = 1;
+		hr = device->CreateTexture2D(&targetDesc, 0, offscreenTarget.GetAddressOf());
+		if (FAILED(hr)) return hr;
+
+		device->CreateRenderTargetView(offscreenTarget.Get(), 0, backBufferRTV.GetAddressOf());
+	}
+	else
+	{
+		// Attempt to initialize Direct3D
+		hr = D3D11CreateDeviceAndSwapChain(
+			0,							// Video adapter (physical GPU) to use, or null for default
+			D3D_DRIVER_TYPE_HARDWARE,	// We want to use the hardware (GPU)
+			0,							// Used when doing software rendering
+			deviceFlags,				// Any special options
+			0,							// Optional array of possible verisons we want as fallbacks
+			0,							// The number of fallbacks in the above param
+			D3D11_SDK_VERSION,			// Current version of the SDK
+			&swapDesc,					// Address of swap chain options
+			swapChain.GetAddressOf(),	// Pointer to our Swap Chain pointer
+			device.GetAddressOf(),		// Pointer to our Device pointer
+			&dxFeatureLevel,			// This will hold the actual feature level the app will use
+			context.GetAddressOf());	// Pointer to our Device Context pointer
+		if (FAILED(hr)) return hr;
+	}
 
 	// Create the Render Target View for the back buffer render target
+	if (swapChain)
 	{
 		// The above function created the back buffer texture for us
 		// but we need to get a reference to it for the next step
@@ -280,6 +362,16 @@ HRESULT DXCore::InitDirect3D()
 	viewport.MaxDepth	= 1.0f;
 	context->RSSetViewports(1, &viewport);
 
+	// Frames come back through the ring on whichever thread draws them
+	if (frameReadbackDepth > 0)
+	{
+		frameReadback = std::make_unique<FrameReadback>(device, frameReadbackDepth,
+			[this](uint64_t frame, const unsigned char* pixels, unsigned int rowPitch, unsigned int width, unsigned int height)
+			{
+				OnFrameReadback(frame, pixels, rowPitch, width, height);
+			});
+	}
+
 	// Return the "everything is ok" HRESULT value
 	return S_OK;
 }
@@ -294,6 +386,10 @@ HRESULT DXCore::InitDirect3D()
 // --------------------------------------------------------
 void DXCore::OnResize()
 {
+	// The render thread may still be drawing to the old buffers - wait for it
+	if (framePipeline)
+		framePipeline->Flush();
+
 	// Resize the buffers that must match the window size
 	{
 		// Release the views before resizing the swap chain,
@@ -389,11 +485,15 @@ HRESULT DXCore::Run()
 	Init();
 
 	// Our overall game and message loop
+	CPU_PROFILE_THREAD("Main");
+	bool firstFrame = true;
+	unsigned int framesRun = 0;
 	MSG msg = {};
-	while (msg.message != WM_QUIT)
+	while (msg.message != WM_QUIT && !quitRequested)
 	{
 		// Determine if there is a message waiting
-		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+		// - Headless runs have no window, so nothing to pump
+		if (!headless && PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 		{
 			// Translate and dispatch the message
 			// to our custom WindowProc function
@@ -402,38 +502,215 @@ HRESULT DXCore::Run()
 		}
 		else
 		{
+			// Everything from here until the next frame counts as this one
+			CPU_PROFILE_FRAME();
+
+			// Switch between serial and pipelined frames, if asked to
+			ApplyFramePipelining();
+
 			// Update timer and title bar (if necessary)
+			// - The first frame's time includes Init(), so it isn't counted
 			UpdateTimer();
+			if (!firstFrame)
+				frameTimes.AddFrame(deltaTime * 1000.0);
+			firstFrame = false;
 			if(titleBarStats)
 				UpdateTitleBarStats();
 
 			// Update the input manager
-			Input::GetInstance().Update();
+			if (!headless)
+				Input::GetInstance().Update();
 
 			// The game loop
-			Update(deltaTime, totalTime);
-			Draw(deltaTime, totalTime);
+			// - A fixed time step stands in for the clock, so the simulation
+			//   is the same every run (frame times above still use the clock)
+			float frameDelta = deltaTime;
+			float frameTotal = totalTime;
+			if (fixedTimeStep > 0.0f)
+			{
+				fixedTotalTime += fixedTimeStep;
+				frameDelta = fixedTimeStep;
+				frameTotal = fixedTotalTime;
+			}
+			std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+			Update(frameDelta, frameTotal);
+			if (framePipeline)
+			{
+				// Hand this frame to the render thread, waiting if it's too far behind
+				unsigned int slot = 0;
+				{
+					CPU_PROFILE_SCOPE("Wait for render thread");
+					slot = framePipeline->BeginWrite();
+				}
+				CaptureFrame(slot, frameDelta, frameTotal);
+				framePipeline->EndWrite(slot, frameStart);
+			}
+			else
+			{
+				Draw(frameDelta, frameTotal);
+			}
 
 			// Frame is over, notify the input manager
 			Input::GetInstance().EndOfFrame();
+
+			// Headless runs can stop themselves after a set number of frames
+			framesRun++;
+			if (headless && headlessFrameLimit > 0 && framesRun >= headlessFrameLimit)
+				quitRequested = true;
 		}
 	}
 
+	// Let the render thread finish its queued frames
+	StopFramePipeline();
+
+	// Hand back any frames still being read back
+	if (frameReadback)
+		frameReadback->Flush(context);
+	OnLoopExit();
+
+	// Leave a record of how the frames were paced
+	frameTimes.WriteCsv("FrameTimes.csv");
+
 	// We'll end up here once we get a WM_QUIT message,
 	// which usually comes from the user closing the window
 	return (HRESULT)msg.wParam;
 }
 
 
+// --------------------------------------------------------
+// Requests pipelined (or serial) frames.  The switch happens
+// at the start of the next frame, so it's safe to call from
+// inside Update().
+//
+// enabled - Run Update() and drawing on separate threads?
+// depth   - Packets in flight between them (at least one)
+// --------------------------------------------------------
+void DXCore::SetFramePipelining(bool enabled, unsigned int depth)
+{
+	framePipeliningRequested = enabled;
+	framePipelineDepth = depth < 1 ? 1 : depth;
+}
+
+// --------------------------------------------------------
+// Latency and throughput of the current (or last) pipeline
+// --------------------------------------------------------
+FramePipeline::Stats DXCore::GetFramePipelineStats()
+{
+	if (framePipeline)
+		return framePipeline->GetStats();
+	return lastPipelineStats;
+}
+
+// --------------------------------------------------------
+// Starts or stops the render thread to match the request
+// --------------------------------------------------------
+void DXCore::ApplyFramePipelining()
+{
+	bool running = framePipeline != 0;
+	if (running == framePipeliningRequested &&
+		(!running || framePipeline->GetDepth() == framePipelineDepth))
+		return;
+
+	// Changing depth means starting over with a new pipeline
+	StopFramePipeline();
+	if (!framePipeliningRequested)
+		return;
+
+	// Packets must exist before the render thread can read them
+	CreateFramePackets(framePipelineDepth);
+	framePipeline = std::make_unique<FramePipeline>(framePipelineDepth);
+	renderThread = std::thread(&DXCore::RenderThreadLoop, this);
+}
+
+// --------------------------------------------------------
+// Lets the render thread draw whatever is queued, then
+// joins it.  Afterwards this thread owns the context again.
+// --------------------------------------------------------
+void DXCore::StopFramePipeline()
+{
+	if (!framePipeline)
+		return;
+
+	framePipeline->Stop();
+	if (renderThread.joinable())
+		renderThread.join();
+
+	lastPipelineStats = framePipeline->GetStats();
+	framePipeline.reset();
+}
+
+// --------------------------------------------------------
+// The render thread draws packets in order until stopped
+// --------------------------------------------------------
+void DXCore::RenderThreadLoop()
+{
+	CPU_PROFILE_THREAD("Render");
+	while (true)
+	{
+		unsigned int slot = framePipeline->BeginRead();
+		if (slot == FramePipeline::Stopped)
+			break;
+
+		DrawFrame(slot);
+		framePipeline->EndRead(slot);
+	}
+}
+
 // --------------------------------------------------------
 // Sends an OS-level window close message to our process, which
 // will be handled by our message processing function
 // --------------------------------------------------------
 void DXCore::Quit()
 {
+	// Headless runs have no window to close, so the loop checks for this instead
+	if (!hWnd)
+	{
+		quitRequested = true;
+		return;
+	}
+
 	PostMessage(this->hWnd, WM_CLOSE, NULL, NULL);
 }
 
+// --------------------------------------------------------
+// Ends a frame's drawing: copies it into the readback ring
+// (if there is one) and presents it (if there's a window)
+// - Called on whichever thread is drawing
+// --------------------------------------------------------
+void DXCore::PresentFrame()
+{
+	if (frameReadback)
+	{
+		CPU_PROFILE_SCOPE("Frame readback");
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> backBuffer = GetBackBuffer();
+		frameReadback->Capture(context, backBuffer.Get(), framesPresented);
+		frameReadback->Poll(context);
+	}
+	framesPresented++;
+
+	if (swapChain)
+	{
+		CPU_PROFILE_SCOPE("Present");
+		swapChain->Present(vsync ? 1 : 0, 0);
+	}
+}
+
+// --------------------------------------------------------
+// The texture frames are drawn into - the swap chain's back
+// buffer, or the offscreen target when headless
+// - Don't hold on to it: the swap chain can't resize while
+//   anything still references its buffers
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11Texture2D> DXCore::GetBackBuffer()
+{
+	if (!swapChain)
+		return offscreenTarget;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> backBuffer;
+	swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (void**)backBuffer.GetAddressOf());
+	return backBuffer;
+}
+
 
 // --------------------------------------------------------
 // Uses high resolution time stamps to get very accurate
@@ -475,17 +752,18 @@ void DXCore::UpdateTitleBarStats()
 	if (timeDiff < 1.0f)
 		return;
 
-	// How long did each frame take?  (Approx)
-	float mspf = 1000.0f / (float)fpsFrameCount;
+	// How long did this second's frames take?  Percentiles show
+	// stutters that an average would hide
+	FrameTimeStats::Summary frames = frameTimes.GetRecentSummary(fpsFrameCount);
 
 	// Quick and dirty title bar text (mostly for debugging)
 	std::wostringstream output;
-	output.precision(6);
-	output << titleBarText <<
+	output.precision(3);
+	output << std::fixed << titleBarText <<
 		"    Width: "		<< windowWidth <<
 		"    Height: "		<< windowHeight <<
 		"    FPS: "			<< fpsFrameCount <<
-		"    Frame Time: "	<< mspf << "ms";
+		"    Frame Time p50/p99/max: " << frames.P50 << " / " << frames.P99 << " / " << frames.Max << "ms";
 
 	// Append the version of Direct3D the app is using
 	switch (dxFeatureLevel)
@@ -3,7 +3,12 @@
 #include <Windows.h>
 #include <d3d11.h>
 #include <string>
+#include <memory>
+#include <thread>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
+#include "FramePipeline.h"
+#include "FrameTimeStats.h"
+#include "FrameReadback.h"
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_win32.h"
 #include "ImGui/imgui_impl_dx11.h"
@@ -36,6 +41,16 @@ public:
 	// Internal method for message handling
 	LRESULT ProcessMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
+	// Headless runs render offscreen, with no window, swap chain or
+	// message pump, and stop on Quit() or after frameLimit frames (if
+	// it isn't zero) - call before InitWindow()
+	void EnableHeadless(unsigned int frameLimit);
+
+	// Reads every frame back to the CPU through a ring of this many
+	// staging textures, handing each to OnFrameReadback() a few frames
+	// later - call before InitDirect3D()
+	void EnableFrameReadback(unsigned int depth);
+
 	// Initialization and game-loop related methods
 	HRESULT InitWindow();
 	HRESULT InitDirect3D();
@@ -48,6 +63,22 @@ public:
 	virtual void Update(float deltaTime, float totalTime) = 0;
 	virtual void Draw(float deltaTime, float totalTime) = 0;
 
+	// Pipelined frames (optional)
+	// - Update() still runs on this thread, then CaptureFrame() copies
+	//   everything needed to draw into a packet slot, which a render
+	//   thread hands to DrawFrame() while the next Update() runs
+	// - Draw() isn't called at all while pipelined
+	virtual void CreateFramePackets(unsigned int count) { }
+	virtual void CaptureFrame(unsigned int slot, float deltaTime, float totalTime) { }
+	virtual void DrawFrame(unsigned int slot) { }
+
+	// Called once the loop has ended and every queued frame has been drawn
+	virtual void OnLoopExit() { }
+
+	// Gets each frame's pixels (RGBA8) once they're read back, on whichever
+	// thread is drawing - frame counts presented frames, from zero
+	virtual void OnFrameReadback(uint64_t frame, const unsigned char* pixels, unsigned int rowPitch, unsigned int width, unsigned int height) { }
+
 protected:
 	HINSTANCE		hInstance;		// The handle to the application
 	HWND			hWnd;			// The handle to the window itself
@@ -66,6 +97,10 @@ protected:
 	// of the monitor (true) or run as fast as possible (false)?
 	bool vsync;
 
+	// Every frame's time, for percentiles and stutter tracking
+	// - Written to FrameTimes.csv when the loop exits
+	FrameTimeStats frameTimes;
+
 	// DirectX related objects and variables
 	D3D_FEATURE_LEVEL		dxFeatureLevel;
 	Microsoft::WRL::ComPtr<IDXGISwapChain>		swapChain;
@@ -75,10 +110,50 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> backBufferRTV;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthBufferDSV;
 
+	// Reads the frame back (if asked to), then presents it (if there's
+	// a window) - call once at the very end of every frame's drawing
+	void PresentFrame();
+
+	// The swap chain's back buffer, or the offscreen target when headless
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> GetBackBuffer();
+
+	bool IsHeadless() { return headless; }
+	bool HasFrameReadback() { return frameReadback != 0; }
+
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
 
+	// Requests pipelined (or serial) frames - applied between frames
+	// depth - How many packets can be in flight between the threads
+	void SetFramePipelining(bool enabled, unsigned int depth);
+	bool IsFramePipelined() { return framePipeline != 0; }
+	FramePipeline::Stats GetFramePipelineStats();
+
+	// Simulates every frame as this many seconds, whatever the clock
+	// says, so runs are repeatable - 0 goes back to the clock
+	void SetFixedTimeStep(float seconds) { fixedTimeStep = seconds > 0.0f ? seconds : 0.0f; }
+
 private:
+	// Pipelined frames - only the render thread touches the context while these run
+	std::unique_ptr<FramePipeline> framePipeline;
+	std::thread renderThread;
+	bool framePipeliningRequested;
+	unsigned int framePipelineDepth;
+	FramePipeline::Stats lastPipelineStats;
+
+	// Headless runs, and reading frames back
+	bool headless;
+	unsigned int headlessFrameLimit;
+	bool quitRequested;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> offscreenTarget;
+	std::unique_ptr<FrameReadback> frameReadback;
+	unsigned int frameReadbackDepth;
+	uint64_t framesPresented;
+
+	void ApplyFramePipelining();
+	void StopFramePipeline();
+	void RenderThreadLoop();
+
 	// Timing related data
 	double perfCounterSeconds;
 	float totalTime;
@@ -87,6 +162,10 @@ private:
 	__int64 currentTime;
 	__int64 previousTime;
 
+	// Simulated time, while a fixed time step is set
+	float fixedTimeStep;
+	float fixedTotalTime;
+
 	// FPS calculation
 	int fpsFrameCount;
 	float fpsTimeElapsed;
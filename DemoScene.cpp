@@ -0,0 +1,215 @@
+#include "DemoScene.h"
+#include "RenderQueue.h"
+
+DemoScene::DemoScene(
+	std::shared_ptr<RenderDevice> device,
+	std::shared_ptr<JobSystem> jobSystem,
+	std::shared_ptr<TextureManager> textureManager,
+	std::shared_ptr<SamplerManager> samplerManager,
+	const Shaders& shaders,
+	const std::string& assetFolder)
+{
+	// Create a sampler state that holds our texture sampling options
+	// - The sky samples just like the materials do, so it shares it
+	RenderSamplerDesc sampDesc = {};
+	sampDesc.Filter = RenderSamplerDesc::Anisotropic;
+	sampDesc.Address = RenderSamplerDesc::Wrap;
+	sampDesc.MaxAnisotropy = 8;
+	std::shared_ptr<RenderSampler> sampState = samplerManager->Get(sampDesc);
+
+	CreateMaterials(textureManager.get(), sampState, shaders, assetFolder + "Textures/");
+	CreateGeometry(device.get(), jobSystem.get(), assetFolder + "Models/");
+	CreateSky(device.get(), textureManager.get(), sampState, shaders, assetFolder + "Textures/Sky/");
+	CreateRenderables();
+	SetupTransforms();
+}
+
+// --------------------------------------------------------
+// Starts loading textures in the background, and creates
+// materials that use stand-ins until they arrive
+// --------------------------------------------------------
+void DemoScene::CreateMaterials(TextureManager* textureManager, std::shared_ptr<RenderSampler> sampler, const Shaders& shaders, const std::string& textureFolder)
+{
+	// Create materials
+	// High roughness is a matte surface, low roughness is shiny
+	mat1 = std::make_shared<Material>(DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), shaders.VS, shaders.PS);
+	mat2 = std::make_shared<Material>(DirectX::XMFLOAT4(1.0f, 0.7f, 0.7f, 1.0f), shaders.VS, shaders.PS);
+
+	// Assign textures to materials
+	// - Each material's maps share a name, like "cobblestone_albedo.png"
+	// - Each map starts out as a 1x1 texture of a neutral value (a flat normal,
+	//   a mid grey surface), which stays if its file can't be loaded
+	struct TextureMap
+	{
+		const char* ShaderName;
+		const char* FileSuffix;
+		unsigned char Fallback[4];
+	};
+	const TextureMap maps[] =
+	{
+		{ "AlbedoMap",		"albedo",		{ 128, 128, 128, 255 } },
+		{ "NormalMap",		"normals",		{ 128, 128, 255, 255 } },
+		{ "RoughnessMap",	"roughness",	{ 128, 128, 128, 255 } },
+		{ "MetalnessMap",	"metal",		{ 0, 0, 0, 255 } },
+	};
+	const std::pair<std::shared_ptr<Material>, const char*> materialFiles[] =
+	{
+		{ mat1, "cobblestone_" },
+		{ mat2, "scratched_" },
+	};
+	for (const std::pair<std::shared_ptr<Material>, const char*>& materialFile : materialFiles)
+	{
+		for (const TextureMap& map : maps)
+		{
+			std::shared_ptr<Material> material = materialFile.first;
+			std::string shaderName = map.ShaderName;
+			material->AddTexture(shaderName, textureManager->GetSolidTexture(
+				map.Fallback[0], map.Fallback[1], map.Fallback[2], map.Fallback[3]));
+			textureManager->LoadAsync(textureFolder + materialFile.second + map.FileSuffix + ".png",
+				[material, shaderName](std::shared_ptr<RenderTexture> texture) { material->AddTexture(shaderName, texture); });
+		}
+	}
+	mat1->AddSampler("BasicSampler", sampler);
+	mat2->AddSampler("BasicSampler", sampler);
+}
+
+// --------------------------------------------------------
+// Loads the meshes from, then constructs them from, files
+// - After this step, the geometry can be reused and drawn over and over by renderables without any more mathematics
+// --------------------------------------------------------
+void DemoScene::CreateGeometry(RenderDevice* device, JobSystem* jobSystem, const std::string& modelFolder)
+{
+	// Positions in the meshes array - keep these in order, renderables rely on them
+	const char* meshFiles[] =
+	{
+		"cube.obj",					// 0
+		"cylinder.obj",				// 1
+		"helix.obj",				// 2
+		"quad.obj",					// 3
+		"quad_double_sided.obj",	// 4
+		"sphere.obj",				// 5
+		"torus.obj",				// 6
+	};
+	unsigned int meshCount = sizeof(meshFiles) / sizeof(meshFiles[0]);
+
+	// Parse and create each mesh as its own job
+	// - Creating buffers only needs the device, which is free-threaded
+	// - Each job writes only its own slot, so the order is unchanged
+	meshes.resize(meshCount);
+	jobSystem->ParallelFor(0, meshCount, 1,
+		[&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+			{
+				meshes[i] = std::make_shared<Mesh>(modelFolder + meshFiles[i], device);
+			}
+		});
+}
+
+// --------------------------------------------------------
+// Creates the sky box, with a solid stand-in until its
+// cube map has loaded
+// --------------------------------------------------------
+void DemoScene::CreateSky(RenderDevice* device, TextureManager* textureManager, std::shared_ptr<RenderSampler> sampler, const Shaders& shaders, const std::string& skyFolder)
+{
+	sky = std::make_shared<Sky>(
+		device,
+		meshes[0], // Skybox is a cube
+		shaders.SkyVS,
+		shaders.SkyPS,
+		sampler,
+		textureManager->GetSolidTexture(102, 153, 191, 255, true) // Close to the clear color, until it loads
+		);
+
+	// Then load the real cube map from all six given file paths
+	std::shared_ptr<Sky> loadingSky = sky;
+	textureManager->LoadCubeAsync(
+		skyFolder + "right.png",
+		skyFolder + "left.png",
+		skyFolder + "up.png",
+		skyFolder + "down.png",
+		skyFolder + "front.png",
+		skyFolder + "back.png",
+		[loadingSky](std::shared_ptr<RenderTexture> texture) { loadingSky->SetCubeMap(texture); }
+		);
+}
+
+// --------------------------------------------------------
+// Fills the renderables array
+// - Assembles the renderables inside from meshes and materials
+// --------------------------------------------------------
+void DemoScene::CreateRenderables()
+{
+	// At position 0: the cube
+	renderables.push_back(std::make_shared<Renderable>(meshes[0], mat1));
+	// At position 1: the cylinder
+	renderables.push_back(std::make_shared<Renderable>(meshes[1], mat2));
+	// At position 2: the helix
+	renderables.push_back(std::make_shared<Renderable>(meshes[2], mat1));
+	// At position 3: the quad
+	renderables.push_back(std::make_shared<Renderable>(meshes[3], mat2));
+	// At position 4: the double sided quad
+	renderables.push_back(std::make_shared<Renderable>(meshes[4], mat1));
+	// At position 5: the sphere
+	renderables.push_back(std::make_shared<Renderable>(meshes[5], mat2));
+	// At position 6: the torus
+	renderables.push_back(std::make_shared<Renderable>(meshes[6], mat1));
+
+	// The simple, solid shapes make cheap occluders
+	renderables[0]->SetOccluder(true);
+	renderables[1]->SetOccluder(true);
+	renderables[3]->SetOccluder(true);
+	renderables[4]->SetOccluder(true);
+
+	// Sort keys group renderables by shaders, then material, then mesh
+	// - Ids are just each thing's position in a list of the unique ones
+	std::vector<void*> pixelShaders;
+	std::vector<void*> vertexShaders;
+	std::vector<void*> uniqueMaterials;
+	std::vector<void*> uniqueMeshes;
+	auto idOf = [](std::vector<void*>& list, void* thing)
+		{
+			for (unsigned int i = 0; i < list.size(); i++)
+				if (list[i] == thing) return i;
+			list.push_back(thing);
+			return (unsigned int)list.size() - 1;
+		};
+	for (auto& r : renderables)
+	{
+		std::shared_ptr<Material> material = r->GetMaterial();
+		unsigned int pipelineId = idOf(pixelShaders, material->GetPS().get()) << 8;
+		pipelineId |= idOf(vertexShaders, material->GetVS().get());
+		unsigned int materialId = idOf(uniqueMaterials, material.get());
+		unsigned int meshId = idOf(uniqueMeshes, r->GetMesh().get());
+		sortKeys.push_back(RenderQueue::MakeSortKey(pipelineId, materialId, meshId));
+	}
+
+	// Renderables sharing both a mesh and a material share an indirect draw
+	for (unsigned int i = 0; i < renderables.size(); i++)
+	{
+		unsigned int bucket = 0;
+		while (bucket < bucketRenderables.size() &&
+			(renderables[bucketRenderables[bucket]]->GetMesh() != renderables[i]->GetMesh() ||
+			renderables[bucketRenderables[bucket]]->GetMaterial() != renderables[i]->GetMaterial()))
+		{
+			bucket++;
+		}
+		if (bucket == bucketRenderables.size())
+			bucketRenderables.push_back(i);
+		buckets.push_back(bucket);
+	}
+}
+
+// --------------------------------------------------------
+// Lines the renderables up along the x axis
+// --------------------------------------------------------
+void DemoScene::SetupTransforms()
+{
+	renderables[0]->GetTransform()->SetPosition(-9.0, 0.0, 0.0);
+	renderables[1]->GetTransform()->SetPosition(-6.0, 0.0, 0.0);
+	renderables[2]->GetTransform()->SetPosition(-3.0, 0.0, 0.0);
+	renderables[3]->GetTransform()->SetPosition(0.0, 0.0, 0.0);
+	renderables[4]->GetTransform()->SetPosition(3.0, 0.0, 0.0);
+	renderables[5]->GetTransform()->SetPosition(6.0, 0.0, 0.0);
+	renderables[6]->GetTransform()->SetPosition(9.0, 0.0, 0.0);
+}
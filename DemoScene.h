@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "RenderDevice.h"
+#include "JobSystem.h"
+#include "TextureManager.h"
+#include "SamplerManager.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "Renderable.h"
+#include "Sky.h"
+
+// --------------------------------------------------------
+// The demo scene: a row of seven shapes in two textured
+// materials, under a sky box
+//
+// - Everything is made through RenderDevice, so the game
+//   builds it on D3D11 and the tests on NullRenderDevice
+// - Textures load in the background through the texture
+//   manager, with solid stand-ins until they arrive
+// --------------------------------------------------------
+class DemoScene
+{
+public:
+	// The scene's shaders, which only the caller knows how to load
+	struct Shaders
+	{
+		std::shared_ptr<RenderShader> VS;
+		std::shared_ptr<RenderShader> PS;
+		std::shared_ptr<RenderShader> SkyVS;
+		std::shared_ptr<RenderShader> SkyPS;
+	};
+
+	// - assetFolder holds the Models and Textures folders, and ends with a slash
+	DemoScene(
+		std::shared_ptr<RenderDevice> device,
+		std::shared_ptr<JobSystem> jobSystem,
+		std::shared_ptr<TextureManager> textureManager,
+		std::shared_ptr<SamplerManager> samplerManager,
+		const Shaders& shaders,
+		const std::string& assetFolder);
+
+	const std::vector<std::shared_ptr<Mesh>>& GetMeshes() { return meshes; }
+	const std::vector<std::shared_ptr<Renderable>>& GetRenderables() { return renderables; }
+	std::shared_ptr<Sky> GetSky() { return sky; }
+
+	// Per renderable - groups them by shaders, then material, then mesh (see RenderQueue)
+	const std::vector<uint64_t>& GetSortKeys() { return sortKeys; }
+
+	// Renderables sharing both a mesh and a material share a bucket, and an indirect draw
+	const std::vector<unsigned int>& GetBuckets() { return buckets; }					// Per renderable
+	const std::vector<unsigned int>& GetBucketRenderables() { return bucketRenderables; }	// Per bucket, the first renderable in it
+
+private:
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	std::shared_ptr<Material> mat1;
+	std::shared_ptr<Material> mat2;
+	std::vector<std::shared_ptr<Renderable>> renderables;
+	std::shared_ptr<Sky> sky;
+	std::vector<uint64_t> sortKeys;
+	std::vector<unsigned int> buckets;
+	std::vector<unsigned int> bucketRenderables;
+
+	void CreateMaterials(TextureManager* textureManager, std::shared_ptr<RenderSampler> sampler, const Shaders& shaders, const std::string& textureFolder);
+	void CreateGeometry(RenderDevice* device, JobSystem* jobSystem, const std::string& modelFolder);
+	void CreateSky(RenderDevice* device, TextureManager* textureManager, std::shared_ptr<RenderSampler> sampler, const Shaders& shaders, const std::string& skyFolder);
+	void CreateRenderables();
+	void SetupTransforms();
+};
@@ -0,0 +1,84 @@
+#include "FramePacket.h"
+
+// --------------------------------------------------------
+// Constructor
+// --------------------------------------------------------
+FramePacket::FramePacket()
+	:
+	DeltaTime(0.0f),
+	TotalTime(0.0f),
+	Camera(),
+	AmbientLight(0.0f, 0.0f, 0.0f),
+	ParallelRecording(false),
+	OcclusionCulling(false),
+	GpuDrivenDraws(false),
+	DepthPrepass(false),
+	GpuClusterCulling(true),
+	ValidateClusters(false),
+	ShadowCascadeCount(0),
+	ShadowDistance(0.0f),
+	ShadowSplitLambda(0.0f),
+	ShadowFilterRadius(0),
+	CasterVersion(0),
+	StaticCasterVersion(0),
+	ShadowCaching(false),
+	CaptureScreenshot(false),
+	RenderStats(),
+	guiSource(0)
+{
+}
+
+// --------------------------------------------------------
+// Destructor - frees any copied ImGui draw lists
+// --------------------------------------------------------
+FramePacket::~FramePacket()
+{
+	ReleaseGui();
+}
+
+// --------------------------------------------------------
+// Captures this frame's ImGui output
+//
+// drawData - From ImGui::GetDrawData(), after ImGui::Render()
+// copy     - Deep copy the draw lists, so the data stays valid
+//            after ImGui starts its next frame
+// --------------------------------------------------------
+void FramePacket::CaptureGui(ImDrawData* drawData, bool copy)
+{
+	ReleaseGui();
+	if (!drawData || !drawData->Valid)
+		return;
+
+	if (!copy)
+	{
+		guiSource = drawData;
+		return;
+	}
+
+	for (int i = 0; i < drawData->CmdListsCount; i++)
+		guiLists.push_back(drawData->CmdLists[i]->CloneOutput());
+
+	guiCopy = *drawData;
+	guiCopy.CmdLists = guiLists.empty() ? 0 : guiLists.data();
+	guiSource = &guiCopy;
+}
+
+// --------------------------------------------------------
+// Returns the captured draw data, or null if there is none
+// --------------------------------------------------------
+ImDrawData* FramePacket::GetGuiDrawData()
+{
+	return guiSource;
+}
+
+// --------------------------------------------------------
+// Frees any lists copied by the last capture
+// --------------------------------------------------------
+void FramePacket::ReleaseGui()
+{
+	for (ImDrawList* list : guiLists)
+		IM_DELETE(list);
+	guiLists.clear();
+	guiCopy.Clear();
+	guiSource = 0;
+}
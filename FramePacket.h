@@ -0,0 +1,108 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include <stdint.h>
+#include "Light.h"
+#include "FrameView.h"
+#include "StateCache.h"
+#include "GpuProfiler.h"
+#include "ImGui/imgui.h"
+
+// --------------------------------------------------------
+// Numbers the render side reports back to the simulation
+// side, for the UI
+// --------------------------------------------------------
+struct FrameRenderStats
+{
+	StateCache::Stats Binds;
+	StateCache::Stats WorkerBinds;
+
+	// Lights
+	unsigned int LightCapacity;			// Lights the GPU buffer holds, after this frame's upload
+
+	// Clustered light culling
+	double ClusterCullTime;				// CPU culling, in ms (zero if it didn't run)
+	unsigned int ClusterOverflows;		// Clusters with more lights than slots (from the CPU cull)
+	unsigned int ClusterMismatches;		// Clusters where the GPU and CPU lists differ (if validated)
+	bool ClusterValidated;
+
+	// Shadows
+	unsigned int ShadowDraws;			// Caster draws, over every cascade
+	unsigned int ShadowCulled;			// Casters skipped for not reaching a cascade
+	bool ShadowsReused;					// Nothing changed, so last frame's cascades were kept
+	bool ShadowCacheRebuilt;			// The static casters were redrawn into their cache
+	unsigned int AtlasLights;			// Point and spot lights that got atlas tiles
+	unsigned int AtlasTiles;
+	unsigned int AtlasDraws;			// Caster draws, over every tile
+	unsigned int AtlasCulled;			// Casters skipped for being outside a tile's frustum
+
+	// Software occlusion culling
+	double OcclusionTime;				// Rasterizing and testing, in ms (zero if it didn't run)
+	unsigned int OccluderTriangles;		// Triangles that made it into the depth buffer
+	unsigned int OcclusionCulled;		// Draw items hidden (or off screen)
+
+	// GPU-driven drawing
+	unsigned int IndirectDraws;			// One per mesh/material bucket
+	unsigned int IndirectInstances;		// Before the GPU culls them
+
+	// GPU time per pass, from a few frames back
+	GpuProfiler::Results GpuProfile;
+};
+
+// --------------------------------------------------------
+// Everything needed to draw one frame, captured at the end
+// of Update() so drawing never reads live game state
+//
+// - In pipelined mode the render thread draws one packet
+//   while the simulation thread updates and fills the next
+// - Meshes, materials and shaders are shared and never
+//   change after loading, so only indices are captured
+// --------------------------------------------------------
+class FramePacket
+{
+public:
+	FramePacket();
+	~FramePacket();
+
+	float DeltaTime;
+	float TotalTime;
+	FrameCamera Camera;
+	std::vector<FrameDrawItem> DrawItems;
+	DirectX::XMFLOAT3 AmbientLight;
+	std::vector<Light> Lights;
+	bool ParallelRecording;
+	bool OcclusionCulling;
+	bool GpuDrivenDraws;
+	bool DepthPrepass;
+	bool GpuClusterCulling;
+	bool ValidateClusters;
+	unsigned int ShadowCascadeCount;
+	float ShadowDistance;
+	float ShadowSplitLambda;
+	int ShadowFilterRadius;
+	uint64_t CasterVersion;			// Changes whenever any renderable's transform does
+	uint64_t StaticCasterVersion;	// Changes whenever a static caster does, or the static set does
+	bool ShadowCaching;
+	bool CaptureScreenshot;			// A benchmark's final frame - its image and GPU timings are kept
+
+	// Filled in by the render side once the packet is drawn
+	FrameRenderStats RenderStats;
+
+	// ImGui's draw data is only valid until the next NewFrame(), so
+	// pipelined frames need their own copy.  Serial frames can just
+	// point at ImGui's.
+	void CaptureGui(ImDrawData* drawData, bool copy);
+	ImDrawData* GetGuiDrawData();
+
+private:
+	// Packets own ImGui allocations, so they can't be copied
+	FramePacket(const FramePacket&) = delete;
+	FramePacket& operator=(const FramePacket&) = delete;
+
+	ImDrawData* guiSource;
+	ImDrawData guiCopy;
+	std::vector<ImDrawList*> guiLists;
+	void ReleaseGui();
+};
+
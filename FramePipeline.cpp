@@ -0,0 +1,144 @@
+#include "FramePipeline.h"
+
+// --------------------------------------------------------
+// Constructor
+//
+// depth - Number of slots (at least one)
+// --------------------------------------------------------
+FramePipeline::FramePipeline(unsigned int depth)
+	:
+	writeIndex(0),
+	readIndex(0),
+	stopped(false),
+	stats()
+{
+	Slot slot = {};
+	slot.State = Free;
+	slots.resize(depth < 1 ? 1 : depth, slot);
+}
+
+// --------------------------------------------------------
+// Waits for the next slot in order to be free, then claims
+// it for writing
+// --------------------------------------------------------
+unsigned int FramePipeline::BeginWrite()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto waitStart = std::chrono::steady_clock::now();
+	slotFreed.wait(lock, [this] { return slots[writeIndex].State == Free; });
+	Accumulate(stats.WriterWait, Milliseconds(std::chrono::steady_clock::now() - waitStart));
+
+	unsigned int slot = writeIndex;
+	slots[slot].State = Writing;
+	writeIndex = (writeIndex + 1) % slots.size();
+	return slot;
+}
+
+// --------------------------------------------------------
+// Publishes a written slot to the reader
+//
+// frameStart - When this frame's simulation started, for latency
+// --------------------------------------------------------
+void FramePipeline::EndWrite(unsigned int slot, std::chrono::steady_clock::time_point frameStart)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		slots[slot].State = Ready;
+		slots[slot].FrameStart = frameStart;
+		stats.FramesWritten++;
+	}
+	slotReady.notify_one();
+}
+
+// --------------------------------------------------------
+// Waits for the oldest written slot, then claims it for
+// reading.  Returns Stopped if the pipeline was stopped
+// and there's nothing left to read.
+// --------------------------------------------------------
+unsigned int FramePipeline::BeginRead()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto waitStart = std::chrono::steady_clock::now();
+	slotReady.wait(lock, [this] { return stopped || slots[readIndex].State == Ready; });
+	if (slots[readIndex].State != Ready)
+		return Stopped;
+	Accumulate(stats.ReaderWait, Milliseconds(std::chrono::steady_clock::now() - waitStart));
+
+	unsigned int slot = readIndex;
+	slots[slot].State = Reading;
+	readIndex = (readIndex + 1) % slots.size();
+	return slot;
+}
+
+// --------------------------------------------------------
+// Hands a read slot back to the writer
+// --------------------------------------------------------
+void FramePipeline::EndRead(unsigned int slot)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto now = std::chrono::steady_clock::now();
+		Accumulate(stats.Latency, Milliseconds(now - slots[slot].FrameStart));
+		if (stats.FramesRead > 0)
+			Accumulate(stats.FrameInterval, Milliseconds(now - lastReadEnd));
+		lastReadEnd = now;
+
+		slots[slot].State = Free;
+		stats.FramesRead++;
+	}
+
+	// Flush() waits on this too, so wake everyone
+	slotFreed.notify_all();
+}
+
+// --------------------------------------------------------
+// Waits until the reader has finished every slot written
+// so far - afterwards the reader is idle in BeginRead()
+// --------------------------------------------------------
+void FramePipeline::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	slotFreed.wait(lock, [this]
+		{
+			for (auto& s : slots)
+				if (s.State == Ready || s.State == Reading)
+					return false;
+			return true;
+		});
+}
+
+// --------------------------------------------------------
+// Lets the reader finish what's queued, then return Stopped
+// --------------------------------------------------------
+void FramePipeline::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+	}
+	slotReady.notify_all();
+}
+
+// --------------------------------------------------------
+// Returns a copy of the counters
+// --------------------------------------------------------
+FramePipeline::Stats FramePipeline::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+double FramePipeline::Milliseconds(std::chrono::steady_clock::duration d)
+{
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// --------------------------------------------------------
+// Exponential moving average - roughly the last 30 samples
+// --------------------------------------------------------
+void FramePipeline::Accumulate(double& average, double sample)
+{
+	average += (sample - average) / 30.0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Hands frames from a simulation thread to a render thread
+// through a fixed number of packet slots
+//
+// - The writer fills a slot between BeginWrite() and EndWrite(),
+//   and the reader draws it between BeginRead() and EndRead()
+// - Slots are read in the order they were written
+// - Depth is how many slots there are.  With a depth of 2, the
+//   simulation can build frame N+1 while frame N is drawn.
+//   Deeper pipelines smooth out spikes but add latency.
+// - This only tracks slot indices; the packets themselves
+//   live wherever the caller keeps them
+// --------------------------------------------------------
+class FramePipeline
+{
+public:
+	// Returned by BeginRead() once Stop() has been called and nothing is left
+	static const unsigned int Stopped = 0xFFFFFFFF;
+
+	// Latency and throughput, as running averages (milliseconds)
+	struct Stats
+	{
+		uint64_t FramesWritten;
+		uint64_t FramesRead;
+		double Latency;			// Start of a frame's simulation to the end of its drawing
+		double FrameInterval;	// Between consecutive frames finishing on the reader
+		double WriterWait;		// Writer blocked because every slot was full
+		double ReaderWait;		// Reader blocked because nothing was ready
+	};
+
+	FramePipeline(unsigned int depth);
+
+	unsigned int GetDepth() { return (unsigned int)slots.size(); }
+
+	// Writer side - BeginWrite() blocks until a slot is free
+	unsigned int BeginWrite();
+	void EndWrite(unsigned int slot, std::chrono::steady_clock::time_point frameStart);
+
+	// Reader side - BeginRead() blocks until a slot is ready, or returns Stopped
+	unsigned int BeginRead();
+	void EndRead(unsigned int slot);
+
+	// Blocks until every written slot has been read
+	void Flush();
+
+	// Wakes the reader for good once it has read everything
+	void Stop();
+
+	Stats GetStats();
+
+private:
+	enum SlotState { Free, Writing, Ready, Reading };
+	struct Slot
+	{
+		SlotState State;
+		std::chrono::steady_clock::time_point FrameStart;
+	};
+	std::vector<Slot> slots;
+	unsigned int writeIndex;
+	unsigned int readIndex;
+	bool stopped;
+
+	std::mutex mutex;
+	std::condition_variable slotFreed;
+	std::condition_variable slotReady;
+
+	Stats stats;
+	std::chrono::steady_clock::time_point lastReadEnd;
+
+	static double Milliseconds(std::chrono::steady_clock::duration d);
+	static void Accumulate(double& average, double sample);
+};
+
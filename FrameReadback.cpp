@@ -0,0 +1,122 @@
+#include "FrameReadback.h"
+
+// --------------------------------------------------------
+// Constructor - staging textures are made on first capture,
+// once the source's size and format are known
+//
+// depth    - Staging textures in the ring (at least one)
+// callback - Gets each frame's pixels as it comes back
+// --------------------------------------------------------
+FrameReadback::FrameReadback(Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int depth, Callback callback)
+	:
+	device(device),
+	callback(callback),
+	slots(depth > 0 ? depth : 1),
+	firstPending(0),
+	pendingCount(0),
+	framesRead(0),
+	stalls(0)
+{
+}
+
+// --------------------------------------------------------
+// Copies a finished frame into the next staging texture
+//
+// source - The texture to read back, usually the back buffer
+// frame  - Passed back to the callback with the pixels
+// --------------------------------------------------------
+void FrameReadback::Capture(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ID3D11Texture2D* source, uint64_t frame)
+{
+	if (!source)
+		return;
+
+	// Every slot is in flight - the oldest has to come back first
+	if (pendingCount == slots.size())
+	{
+		stalls++;
+		ReadOldest(context, true);
+	}
+
+	Slot& slot = slots[(firstPending + pendingCount) % slots.size()];
+
+	// (Re)create the staging texture if the source has changed size
+	D3D11_TEXTURE2D_DESC sourceDesc = {};
+	source->GetDesc(&sourceDesc);
+	D3D11_TEXTURE2D_DESC stagingDesc = {};
+	if (slot.Staging)
+		slot.Staging->GetDesc(&stagingDesc);
+	if (!slot.Staging ||
+		stagingDesc.Width != sourceDesc.Width ||
+		stagingDesc.Height != sourceDesc.Height ||
+		stagingDesc.Format != sourceDesc.Format)
+	{
+		stagingDesc = sourceDesc;
+		stagingDesc.MipLevels = 1;
+		stagingDesc.ArraySize = 1;
+		stagingDesc.SampleDesc.Count = 1;
+		stagingDesc.SampleDesc.Quality = 0;
+		stagingDesc.Usage = D3D11_USAGE_STAGING;
+		stagingDesc.BindFlags = 0;
+		stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		stagingDesc.MiscFlags = 0;
+		slot.Staging.Reset();
+		if (FAILED(device->CreateTexture2D(&stagingDesc, 0, slot.Staging.GetAddressOf())))
+			return;
+	}
+
+	context->CopySubresourceRegion(slot.Staging.Get(), 0, 0, 0, 0, source, 0, 0);
+	slot.Frame = frame;
+	pendingCount++;
+}
+
+// --------------------------------------------------------
+// Hands back every frame that's ready, stopping at the first
+// one the GPU is still working on
+// --------------------------------------------------------
+void FrameReadback::Poll(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	while (pendingCount > 0 && ReadOldest(context, false))
+	{
+	}
+}
+
+// --------------------------------------------------------
+// Waits for everything still in flight
+// --------------------------------------------------------
+void FrameReadback::Flush(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	while (pendingCount > 0)
+	{
+		// A failed map still frees the slot, so this always finishes
+		ReadOldest(context, true);
+	}
+}
+
+// --------------------------------------------------------
+// Maps the oldest pending frame and hands it to the callback
+//
+// wait - Block until the GPU is done with it?  Otherwise
+//        returns false if it isn't ready yet
+// --------------------------------------------------------
+bool FrameReadback::ReadOldest(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, bool wait)
+{
+	Slot& slot = slots[firstPending];
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	HRESULT hr = context->Map(slot.Staging.Get(), 0, D3D11_MAP_READ, wait ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+	if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+		return false;
+
+	if (SUCCEEDED(hr))
+	{
+		D3D11_TEXTURE2D_DESC desc = {};
+		slot.Staging->GetDesc(&desc);
+		if (callback)
+			callback(slot.Frame, (const unsigned char*)mapped.pData, mapped.RowPitch, desc.Width, desc.Height);
+		context->Unmap(slot.Staging.Get(), 0);
+		framesRead++;
+	}
+
+	firstPending = (firstPending + 1) % slots.size();
+	pendingCount--;
+	return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <d3d11.h>
+#include <functional>
+#include <stdint.h>
+#include <vector>
+#include <wrl/client.h>
+
+// --------------------------------------------------------
+// Reads finished frames back to the CPU without stalling
+//
+// - Each frame is copied into the next staging texture in a
+//   ring, and mapped a few frames later once the GPU is done
+//   with it, so the CPU never waits for the copy
+// - Only if every staging texture is still busy does a
+//   capture have to wait for the oldest one
+// - Frames come back in the order they were captured, on
+//   the thread that owns the context
+// - Pixels are whatever format the source is in (four bytes
+//   a pixel for the back buffers here)
+// --------------------------------------------------------
+class FrameReadback
+{
+public:
+	typedef std::function<void(
+		uint64_t frame,
+		const unsigned char* pixels,
+		unsigned int rowPitch,
+		unsigned int width,
+		unsigned int height)> Callback;
+
+	// depth    - Staging textures in the ring (how many frames can be in flight)
+	// callback - Gets each frame's pixels, which are only valid during the call
+	FrameReadback(Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int depth, Callback callback);
+
+	// Copies a finished frame into the ring, waiting for the
+	// oldest one first if every staging texture is busy
+	void Capture(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, ID3D11Texture2D* source, uint64_t frame);
+
+	// Hands back every frame the GPU has finished copying
+	void Poll(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	// Waits for and hands back everything still in flight
+	void Flush(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	// Getters
+	unsigned int GetDepth() { return (unsigned int)slots.size(); }
+	uint64_t GetFramesRead() { return framesRead; }
+	uint64_t GetStalls() { return stalls; }
+
+private:
+	struct Slot
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Staging;
+		uint64_t Frame;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Callback callback;
+	std::vector<Slot> slots;
+
+	// Captured but not yet read back, oldest first - slots
+	// are used in order, so these are always consecutive
+	unsigned int firstPending;
+	unsigned int pendingCount;
+
+	uint64_t framesRead;
+	uint64_t stalls;	// Captures that had to wait for the GPU
+
+	bool ReadOldest(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, bool wait);
+};
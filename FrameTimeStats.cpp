@@ -0,0 +1,230 @@
+#include "FrameTimeStats.h"
+
+#include <algorithm>
+#include <fstream>
+#include <math.h>
+
+// Frames past this land in the lifetime histogram's last bucket
+static const double LifetimeRange = 500.0;
+
+// --------------------------------------------------------
+// Nearest-rank percentile of sorted frame times
+// --------------------------------------------------------
+static double SortedPercentile(const std::vector<float>& sorted, double percentile)
+{
+	if (sorted.empty())
+		return 0.0;
+
+	size_t rank = (size_t)ceil(percentile * sorted.size());
+	return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+// --------------------------------------------------------
+// Constructor
+//
+// windowSize         - Recent frames kept for exact percentiles
+// budgetMilliseconds - Frames slower than this are flagged
+// histogramRange     - Milliseconds covered by the display histogram
+// --------------------------------------------------------
+FrameTimeStats::FrameTimeStats(unsigned int windowSize, double budgetMilliseconds, double histogramRange)
+	:
+	budget(budgetMilliseconds),
+	histogramRange(histogramRange > 0.0 ? histogramRange : 50.0),
+	window(windowSize > 0 ? windowSize : 1, 0.0f),
+	frameCount(0),
+	lifetimeBuckets((size_t)(LifetimeRange * LifetimeBucketsPerMs) + 1, 0),
+	lifetimeOverBudget(0),
+	lifetimeTotal(0.0),
+	lifetimeMax(0.0),
+	spikes(),
+	spikeCount(0)
+{
+}
+
+// --------------------------------------------------------
+// Records one frame's time
+// --------------------------------------------------------
+void FrameTimeStats::AddFrame(double milliseconds)
+{
+	if (milliseconds < 0.0)
+		milliseconds = 0.0;
+
+	window[frameCount % window.size()] = (float)milliseconds;
+
+	size_t bucket = (size_t)(milliseconds * LifetimeBucketsPerMs);
+	lifetimeBuckets[std::min(bucket, lifetimeBuckets.size() - 1)]++;
+	lifetimeTotal += milliseconds;
+	lifetimeMax = std::max(lifetimeMax, milliseconds);
+
+	if (milliseconds > budget)
+	{
+		lifetimeOverBudget++;
+		Spike& spike = spikes[spikeCount % MaxSpikes];
+		spike.Frame = frameCount;
+		spike.Milliseconds = milliseconds;
+		spikeCount++;
+	}
+
+	frameCount++;
+}
+
+// --------------------------------------------------------
+// Which display histogram bucket a frame time falls in
+// --------------------------------------------------------
+unsigned int FrameTimeStats::GetHistogramBucket(double milliseconds)
+{
+	double bucket = milliseconds / histogramRange * (HistogramBuckets - 1);
+	return bucket < HistogramBuckets - 1 ? (unsigned int)bucket : HistogramBuckets - 1;
+}
+
+// --------------------------------------------------------
+// Exact stats over the most recent frames
+//
+// count - How many of the newest frames (0 for all that
+//         the window holds)
+// --------------------------------------------------------
+FrameTimeStats::Summary FrameTimeStats::GetRecentSummary(unsigned int count)
+{
+	Summary summary = {};
+	uint64_t available = std::min<uint64_t>(frameCount, window.size());
+	if (count == 0 || count > available)
+		count = (unsigned int)available;
+	if (count == 0)
+		return summary;
+
+	std::vector<float> sorted(count);
+	double total = 0.0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float milliseconds = window[(frameCount - count + i) % window.size()];
+		sorted[i] = milliseconds;
+		total += milliseconds;
+		summary.Histogram[GetHistogramBucket(milliseconds)]++;
+		if (milliseconds > budget)
+			summary.OverBudget++;
+	}
+	std::sort(sorted.begin(), sorted.end());
+
+	summary.Frames = count;
+	summary.Mean = total / count;
+	summary.P50 = SortedPercentile(sorted, 0.50);
+	summary.P95 = SortedPercentile(sorted, 0.95);
+	summary.P99 = SortedPercentile(sorted, 0.99);
+	summary.Max = sorted.back();
+	return summary;
+}
+
+// --------------------------------------------------------
+// Nearest-rank percentile from the lifetime histogram - the
+// top of the bucket it lands in, so it never under-reports
+// --------------------------------------------------------
+double FrameTimeStats::GetLifetimePercentile(double percentile)
+{
+	uint64_t rank = (uint64_t)ceil(percentile * frameCount);
+	if (rank == 0)
+		rank = 1;
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < lifetimeBuckets.size(); i++)
+	{
+		seen += lifetimeBuckets[i];
+		if (seen >= rank)
+			return std::min((double)(i + 1) / LifetimeBucketsPerMs, lifetimeMax);
+	}
+	return lifetimeMax;
+}
+
+// --------------------------------------------------------
+// Stats over every frame since startup
+// --------------------------------------------------------
+FrameTimeStats::Summary FrameTimeStats::GetLifetimeSummary()
+{
+	Summary summary = {};
+	if (frameCount == 0)
+		return summary;
+
+	summary.Frames = frameCount;
+	summary.OverBudget = lifetimeOverBudget;
+	summary.Mean = lifetimeTotal / frameCount;
+	summary.P50 = GetLifetimePercentile(0.50);
+	summary.P95 = GetLifetimePercentile(0.95);
+	summary.P99 = GetLifetimePercentile(0.99);
+	summary.Max = lifetimeMax;
+
+	// Fold the fine buckets into the display ones, by their middles
+	for (size_t i = 0; i < lifetimeBuckets.size(); i++)
+	{
+		if (lifetimeBuckets[i] == 0)
+			continue;
+		double middle = (i + 0.5) / LifetimeBucketsPerMs;
+		bool past = i == lifetimeBuckets.size() - 1;
+		summary.Histogram[past ? HistogramBuckets - 1 : GetHistogramBucket(middle)] += (float)lifetimeBuckets[i];
+	}
+	return summary;
+}
+
+// --------------------------------------------------------
+// Most recent over-budget frames, oldest first
+// --------------------------------------------------------
+std::vector<FrameTimeStats::Spike> FrameTimeStats::GetSpikes()
+{
+	std::vector<Spike> recent;
+	uint64_t first = spikeCount > MaxSpikes ? spikeCount - MaxSpikes : 0;
+	for (uint64_t i = first; i < spikeCount; i++)
+		recent.push_back(spikes[i % MaxSpikes]);
+	return recent;
+}
+
+// --------------------------------------------------------
+// Recent frame times, oldest first, for graphing
+// --------------------------------------------------------
+void FrameTimeStats::GetRecentFrames(std::vector<float>& milliseconds)
+{
+	uint64_t count = std::min<uint64_t>(frameCount, window.size());
+	milliseconds.resize((size_t)count);
+	for (uint64_t i = 0; i < count; i++)
+		milliseconds[(size_t)i] = window[(frameCount - count + i) % window.size()];
+}
+
+// --------------------------------------------------------
+// Writes everything as comma separated tables, separated by
+// blank lines:
+//  - Lifetime and recent stats side by side
+//  - The histogram, one row per bucket
+//  - The remembered over-budget frames
+// --------------------------------------------------------
+bool FrameTimeStats::WriteCsv(const std::string& path)
+{
+	std::ofstream csv(path);
+	if (!csv.is_open())
+		return false;
+
+	Summary lifetime = GetLifetimeSummary();
+	Summary recent = GetRecentSummary();
+
+	csv << "statistic,lifetime,recent\n";
+	csv << "frames," << lifetime.Frames << "," << recent.Frames << "\n";
+	csv << "budget_ms," << budget << "," << budget << "\n";
+	csv << "over_budget," << lifetime.OverBudget << "," << recent.OverBudget << "\n";
+	csv << "mean_ms," << lifetime.Mean << "," << recent.Mean << "\n";
+	csv << "p50_ms," << lifetime.P50 << "," << recent.P50 << "\n";
+	csv << "p95_ms," << lifetime.P95 << "," << recent.P95 << "\n";
+	csv << "p99_ms," << lifetime.P99 << "," << recent.P99 << "\n";
+	csv << "max_ms," << lifetime.Max << "," << recent.Max << "\n";
+
+	csv << "\nbucket_start_ms,bucket_end_ms,lifetime_frames,recent_frames\n";
+	double bucketWidth = histogramRange / (HistogramBuckets - 1);
+	for (unsigned int i = 0; i < HistogramBuckets; i++)
+	{
+		csv << i * bucketWidth << ",";
+		if (i < HistogramBuckets - 1)
+			csv << (i + 1) * bucketWidth;
+		csv << "," << (uint64_t)lifetime.Histogram[i] << "," << (uint64_t)recent.Histogram[i] << "\n";
+	}
+
+	csv << "\nspike_frame,spike_ms\n";
+	for (const Spike& spike : GetSpikes())
+		csv << spike.Frame << "," << spike.Milliseconds << "\n";
+
+	return csv.good();
+}
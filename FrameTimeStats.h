@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Frame pacing statistics - percentiles instead of averages
+//
+// - Recent frame times live in a ring, so percentiles over
+//   them are exact
+// - Every frame since startup also lands in a fine-grained
+//   histogram (0.05 ms buckets), so the run as a whole gets
+//   percentiles too, at that resolution
+// - Frames over the budget are counted, and the most recent
+//   ones remembered, since one bad frame is a visible hitch
+//   no matter how good the average is
+// - Not thread safe: add frames and read results from the
+//   same thread
+// --------------------------------------------------------
+class FrameTimeStats
+{
+public:
+	static const unsigned int HistogramBuckets = 64;	// For display - the last one counts everything past the range
+	static const unsigned int MaxSpikes = 32;			// Over-budget frames remembered
+
+	struct Summary
+	{
+		uint64_t Frames;
+		uint64_t OverBudget;
+		double Mean;		// Milliseconds
+		double P50;
+		double P95;
+		double P99;
+		double Max;
+		float Histogram[HistogramBuckets];	// Frames per bucket, floats so ImGui can plot them
+	};
+
+	// One frame that went over budget
+	struct Spike
+	{
+		uint64_t Frame;		// Counted from the first frame added
+		double Milliseconds;
+	};
+
+	// windowSize         - Recent frames kept for exact percentiles
+	// budgetMilliseconds - Frames slower than this are flagged
+	// histogramRange     - Milliseconds covered by the display histogram
+	FrameTimeStats(
+		unsigned int windowSize = 1024,
+		double budgetMilliseconds = 1000.0 / 60.0,
+		double histogramRange = 50.0);
+
+	void AddFrame(double milliseconds);
+
+	// Stats over the most recent frames (0 for the whole window)
+	Summary GetRecentSummary(unsigned int count = 0);
+
+	// Stats over every frame since startup
+	// - Over-budget counts use whatever the budget was at the time
+	Summary GetLifetimeSummary();
+
+	// Most recent over-budget frames, oldest first
+	std::vector<Spike> GetSpikes();
+
+	// Writes the lifetime and recent summaries, the histogram and
+	// the remembered spikes, as comma separated tables
+	bool WriteCsv(const std::string& path);
+
+	// Recent frame times, oldest first, for graphing
+	void GetRecentFrames(std::vector<float>& milliseconds);
+
+	// Getters & setters
+	void SetBudget(double milliseconds) { budget = milliseconds; }
+	double GetBudget() { return budget; }
+	double GetHistogramRange() { return histogramRange; }
+	uint64_t GetFrameCount() { return frameCount; }
+
+private:
+	static const unsigned int LifetimeBucketsPerMs = 20;
+
+	double budget;
+	double histogramRange;
+
+	// Recent frames
+	std::vector<float> window;
+	uint64_t frameCount;
+
+	// Every frame - the last bucket counts everything past the range
+	std::vector<uint64_t> lifetimeBuckets;
+	uint64_t lifetimeOverBudget;
+	double lifetimeTotal;
+	double lifetimeMax;
+
+	Spike spikes[MaxSpikes];
+	uint64_t spikeCount;
+
+	unsigned int GetHistogramBucket(double milliseconds);
+	double GetLifetimePercentile(double percentile);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// The parts of a frame packet (see FramePacket.h) that
+// drawing a single renderable reads
+//
+// - Kept apart so the scene classes don't pull in the rest
+//   of the frame (lights, UI, profiling) along with them
+// --------------------------------------------------------
+
+// --------------------------------------------------------
+// The camera, as seen by the frame being drawn
+// --------------------------------------------------------
+struct FrameCamera
+{
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 Projection;
+	DirectX::XMFLOAT3 Position;
+
+	// What the projection was built from
+	float FieldOfView;
+	float AspectRatio;
+	float NearClip;
+	float FarClip;
+};
+
+// --------------------------------------------------------
+// One renderable, as of the end of the frame's update
+// --------------------------------------------------------
+struct FrameDrawItem
+{
+	unsigned int RenderableIndex;
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInvTrans;
+	bool DynamicCaster;		// Moved recently, so not part of the static shadow cache
+};
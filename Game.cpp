@@ -4,6 +4,7 @@
 #include "Helpers.h"
 #include "Mesh.h"
 #include "Transform.h"
+#include "ImageWriter.h"
 
 // Did you know you can press ctrl twice in VS2022 to reveal inline hints? They are pretty useful.
 
@@ -11,6 +12,15 @@
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
 
+// For rand(), used to scatter extra lights
+#include <stdlib.h>
+
+// For timing light culling
+#include <chrono>
+
+// For std::replace, when naming benchmark results
+#include <algorithm>
+
 // For the DirectX Math library
 using namespace DirectX;
 
@@ -29,18 +39,48 @@ Game::Game(HINSTANCE hInstance)
 		1280,				// Width of the window's client area
 		720,				// Height of the window's client area
 		false,				// Sync the framerate to the monitor refresh? (lock framerate)
-		true)				// Show extra stats (fps) in title bar?
+		true),				// Show extra stats (fps) in title bar?
+	parallelRecording(false),
+	occlusionCulling(true),
+	gpuDrivenDraws(false),
+	depthPrepass(false),
+	cpuTraceFrames(60),
+	cpuScopeOverhead(0.0f),
+	pipelineFrames(false),
+	pipelineDepth(2),
+	screenshotHash(0),
+	screenshotCaptured(false),
+	benchmarkGpuProfile(),
+	recordingCameraPath(false),
+	cameraPathTime(0.0f),
+	captureSettings(CommandCapture::GetDefaultSettings()),
+	capturedFrameIndex(0),
+	latestRenderStats(),
+	lightBufferSlot(0),
+	pointLightTarget(2),
+	clusterProjection(0.0f, 0.0f, 0.0f, 0.0f),
+	directionalLightCount(0),
+	clusterCountSlot(0),
+	clusterIndexSlot(0),
+	gpuClusterCulling(true),
+	validateClusters(false),
+	shadowLightIndex(-1),
+	shadowMapSlot(0),
+	shadowSamplerSlot(0),
+	shadowAtlasSlot(0),
+	shadowTileSlot(0),
+	shadowCascadeCount(4),
+	shadowDistance(40.0f),
+	shadowSplitLambda(0.6f),
+	shadowFilterRadius(1),
+	animateObjects(true),
+	shadowCaching(true)
 {
 #if defined(DEBUG) || defined(_DEBUG)
 	// Do we want a console window?  Probably only in debug mode
 	CreateConsoleWindow(500, 120, 32, 120);
 	// Initialize all the member variables to appease C++
 	ambientLight = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
-	dir1 = {};
-	dir2 = {};
-	dir3 = {};
-	pl1 = {};
-	pl2 = {};
 	printf("Console window created successfully.  Feel free to printf() here.\n");
 #endif
 	//trf = new Transform();
@@ -59,7 +99,8 @@ Game::~Game()
 
 	// ImGui clean up (as requested above <3)
 	ImGui_ImplDX11_Shutdown();
-	ImGui_ImplWin32_Shutdown();
+	if (hWnd)
+		ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
 
 	// Call Release() on any Direct3D objects made within this class
@@ -75,7 +116,8 @@ void Game::Init()
 	// Initialize ImGui itself and platform/renderer backends
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
-	ImGui_ImplWin32_Init(hWnd);
+	if (hWnd)
+		ImGui_ImplWin32_Init(hWnd);
 	ImGui_ImplDX11_Init(device.Get(), context.Get());
 
 	// Pick a style (uncomment one of these 3)
@@ -94,14 +136,51 @@ void Game::Init()
 		1.0f
 	);
 
+	// Serial frames always use the first packet
+	CreateFramePackets(1);
+
+	// All of our binding goes through the state cache, so set it up before anything needs it
+	stateCache = std::make_shared<StateCache>(std::make_shared<D3D11StateCacheBackend>(context));
+
+	// Scene objects create and draw through the render device, which binds through that same cache
+	renderDevice = std::make_shared<D3D11RenderDevice>(device);
+	renderContext = std::make_shared<D3D11RenderContext>(stateCache, context);
+
+	// Captures sit between everything and the real context, passing it all through
+	if (captureSettings.Enabled)
+	{
+		commandCapture = std::make_shared<CommandCapture>(renderContext);
+		renderContext = commandCapture;
+	}
+
+	// One worker thread per core, minus this one (which helps out whenever it waits)
+	jobSystem = std::make_shared<JobSystem>();
+
+	// Deferred contexts for recording draws in parallel - one per thread that can run a job
+	commandListRecorder = std::make_shared<CommandListRecorder>(device, jobSystem, jobSystem->GetWorkerCount() + 1);
+
 	// Loads the shaders, then creates our materials
 	LoadShaders();
-	LoadTexturesAndCreateMaterials();
-	CreateGeometry();
-	CreateRenderables();
-	SetupTransforms();
+	CreateScene();
+	CreateShadowMapResources();
 	InitLighting();
 
+	// Benchmarks and headless runs compare what they draw, so they can't
+	// start until every texture is in - everything else starts right away
+	if (benchmark || IsHeadless())
+		textureManager->WaitForLoads();
+
+	// After a depth prepass, the main pass keeps only the fragments that
+	// land exactly on the prepass's depth, and doesn't write depth again
+	D3D11_DEPTH_STENCIL_DESC depthEqualDesc = {};
+	depthEqualDesc.DepthEnable = true;
+	depthEqualDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	depthEqualDesc.DepthFunc = D3D11_COMPARISON_EQUAL;
+	device->CreateDepthStencilState(&depthEqualDesc, depthEqualState.GetAddressOf());
+
+	gpuProfiler = std::make_shared<GpuProfiler>(std::make_shared<D3D11GpuTimer>(
+		device, context, GpuProfiler::FrameLatency, GpuProfiler::MaxScopes * 2));
+
 	// Set initial graphics API state
 	//  - These settings persist until we change them
 	//  - Some of these, like the primitive topology & input layout, probably won't change
@@ -110,7 +189,7 @@ void Game::Init()
 		// Tell the input assembler (IA) stage of the pipeline what kind of
 		// geometric primitives (points, lines or triangles) we want to draw.  
 		// Essentially: "What kind of shape should the GPU draw with our vertices?"
-		context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		stateCache->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	}
 }
 
@@ -130,302 +209,98 @@ void Game::LoadShaders()
 		skyVS = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"SkyVertexShader.cso").c_str());
 		skyPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"SkyPixelShader.cso").c_str());
 		shadowVS = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"ShadowVS.cso").c_str());
+		clusterCullCS = std::make_shared<SimpleComputeShader>(device, context, FixPath(L"ClusterCullCS.cso").c_str());
+		indirectVS = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"IndirectVS.cso").c_str());
+		instanceCullCS = std::make_shared<SimpleComputeShader>(device, context, FixPath(L"InstanceCullCS.cso").c_str());
+	}
+
+	// Per-draw constants all go into one big dynamic buffer, bound by offset,
+	// instead of each shader updating its own small buffers every draw
+	// - If the device can't bind by offset, the shaders simply keep their own buffers
+	constantBufferRing = std::make_shared<ConstantBufferRing>(device, context, 1024 * 1024);
+	if (constantBufferRing->IsSupported())
+	{
+		vs->SetConstantBufferRing(constantBufferRing);
+		ps->SetConstantBufferRing(constantBufferRing);
+		fps->SetConstantBufferRing(constantBufferRing);
+		skyVS->SetConstantBufferRing(constantBufferRing);
+		skyPS->SetConstantBufferRing(constantBufferRing);
+		shadowVS->SetConstantBufferRing(constantBufferRing);
+		indirectVS->SetConstantBufferRing(constantBufferRing);
 	}
+
+	// The lit pixel shader reads every light from one structured buffer,
+	// and the point lights through its cluster's list
+	const SimpleSRV* lightsInfo = ps->GetShaderResourceViewInfo("Lights");
+	if (lightsInfo)
+		lightBufferSlot = lightsInfo->BindIndex;
+	const SimpleSRV* countsInfo = ps->GetShaderResourceViewInfo("ClusterLightCounts");
+	if (countsInfo)
+		clusterCountSlot = countsInfo->BindIndex;
+	const SimpleSRV* indicesInfo = ps->GetShaderResourceViewInfo("ClusterLightIndices");
+	if (indicesInfo)
+		clusterIndexSlot = indicesInfo->BindIndex;
+	clusterCuller = std::make_shared<ClusterLightCuller>(device, clusterCullCS);
+	const SimpleSRV* shadowMapInfo = ps->GetShaderResourceViewInfo("ShadowMap");
+	if (shadowMapInfo)
+		shadowMapSlot = shadowMapInfo->BindIndex;
+	const SimpleSampler* shadowSamplerInfo = ps->GetSamplerInfo("ShadowSampler");
+	if (shadowSamplerInfo)
+		shadowSamplerSlot = shadowSamplerInfo->BindIndex;
+	const SimpleSRV* shadowAtlasInfo = ps->GetShaderResourceViewInfo("ShadowAtlas");
+	if (shadowAtlasInfo)
+		shadowAtlasSlot = shadowAtlasInfo->BindIndex;
+	const SimpleSRV* shadowTilesInfo = ps->GetShaderResourceViewInfo("ShadowTiles");
+	if (shadowTilesInfo)
+		shadowTileSlot = shadowTilesInfo->BindIndex;
+
+	// Shaders bind through the state cache too
+	vs->SetStateCache(stateCache);
+	ps->SetStateCache(stateCache);
+	fps->SetStateCache(stateCache);
+	skyVS->SetStateCache(stateCache);
+	skyPS->SetStateCache(stateCache);
+	shadowVS->SetStateCache(stateCache);
+	indirectVS->SetStateCache(stateCache);
+
+	indirectRenderer = std::make_shared<IndirectRenderer>(device, instanceCullCS);
 }
 
 // --------------------------------------------------------
-// Loads textures with the CreateWICTextureFromFile() function
+// Creates the demo scene (see DemoScene.h), whose textures
+// load in the background and replace stand-ins as they arrive
 // --------------------------------------------------------
-void Game::LoadTexturesAndCreateMaterials()
+void Game::CreateScene()
 {
-	// Create a sampler state that holds our texture sampling options
-	Microsoft::WRL::ComPtr<ID3D11SamplerState> sampState;
-	
-	D3D11_SAMPLER_DESC sampDesc = {};
-	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.Filter = D3D11_FILTER_ANISOTROPIC;
-	sampDesc.MaxAnisotropy = 8;
-	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-
-	device->CreateSamplerState(&sampDesc, sampState.GetAddressOf());
-
-	// Load textures
-
-#pragma region Cobblestone
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleAlbedoSRV;
-	CreateWICTextureFromFile(
-		device.Get(),
-		context.Get(),
-		FixPath(L"../../Assets/Textures/cobblestone_albedo.png").c_str(),
-		nullptr,
-		cobbleAlbedoSRV.GetAddressOf()
-	);
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleNormalSRV;
-	CreateWICTextureFromFile(
-		device.Get(),
-		context.Get(),
-		FixPath(L"../../Assets/Textures/cobblestone_normals.png").c_str(),
-		nullptr,
-		cobbleNormalSRV.GetAddressOf()
-	);
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleRoughnessSRV;
-	CreateWICTextureFromFile(
-		device.Get(),
-		context.Get(),
-		FixPath(L"../../Assets/Textures/cobblestone_roughness.png").c_str(),
-		nullptr,
-		cobbleRoughnessSRV.GetAddressOf()
-	);
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobbleMetalnessSRV;
-	CreateWICTextureFromFile(
-		device.Get(),
-		context.Get(),
-		FixPath(L"../../Assets/Textures/cobblestone_metal.png").c_str(),
-		nullptr,
-		cobbleMetalnessSRV.GetAddressOf()
-	);
-#pragma endregion
-
-#pragma region Cobblestone
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchAlbedoSRV;
-	CreateWICTextureFromFile(
-		device.Get(),
-		context.Get(),
-		FixPath(L"../../Assets/Textures/scratched_albedo.png").c_str(),
-		nullptr,
-		scratchAlbedoSRV.GetAddressOf()
-	);
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchNormalSRV;
-	CreateWICTextureFromFile(
-		device.Get(),
-		context.Get(),
-		FixPath(L"../../Assets/Textures/scratched_normals.png").c_str(),
-		nullptr,
-		scratchNormalSRV.GetAddressOf()
-	);
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchRoughnessSRV;
-	CreateWICTextureFromFile(
-		device.Get(),
-		context.Get(),
-		FixPath(L"../../Assets/Textures/scratched_roughness.png").c_str(),
-		nullptr,
-		scratchRoughnessSRV.GetAddressOf()
-	);
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> scratchMetalnessSRV;
-	CreateWICTextureFromFile(
-		device.Get(),
-		context.Get(),
-		FixPath(L"../../Assets/Textures/scratched_metal.png").c_str(),
-		nullptr,
-		scratchMetalnessSRV.GetAddressOf()
-	);
-#pragma endregion
-
-	// Create materials
-	// High roughness is a matte surface, low roughness is shiny
-	mat1 = std::make_shared<Material>(DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vs, ps);
-	mat2 = std::make_shared<Material>(DirectX::XMFLOAT4(1.0f, 0.7f, 0.7f, 1.0f), vs, ps);
-
-	// Assign textures to materials
-	mat1->AddTextureSRV("AlbedoMap",		cobbleAlbedoSRV);
-	mat1->AddTextureSRV("NormalMap",		cobbleNormalSRV);
-	mat1->AddTextureSRV("RoughnessMap",		cobbleRoughnessSRV);
-	mat1->AddTextureSRV("MetalnessMap",		cobbleMetalnessSRV);
-	mat1->AddTextureSampler("BasicSampler", sampState);
-
-	mat2->AddTextureSRV("AlbedoMap",		scratchAlbedoSRV);
-	mat2->AddTextureSRV("NormalMap",		scratchNormalSRV);
-	mat2->AddTextureSRV("RoughnessMap",		scratchRoughnessSRV);
-	mat2->AddTextureSRV("MetalnessMap",		scratchMetalnessSRV);
-	mat2->AddTextureSampler("BasicSampler", sampState);
-}
-
-// --------------------------------------------------------
-// Loads the meshes from, then constructs them from, files
-// - After this step, the geometry can be reused and drawn over and over by renderables without any more mathematics
-// --------------------------------------------------------
-void Game::CreateGeometry()
-{
-	// At position 0: the cube
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cube.obj").c_str(), device, context));
-	// At position 1: the cylinder
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cylinder.obj").c_str(), device, context));
-	// At position 2: the helix
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/helix.obj").c_str(), device, context));
-	// At position 3: the quad
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/quad.obj").c_str(), device, context));
-	// At position 4: the double sided quad
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/quad_double_sided.obj").c_str(), device, context));
-	// At position 5: the sphere
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/sphere.obj").c_str(), device, context));
-	// At position 6: the torus
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/torus.obj").c_str(), device, context));
-
-	Microsoft::WRL::ComPtr<ID3D11SamplerState> skySampState;
-
-	D3D11_SAMPLER_DESC sampDesc = {};
-	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-	sampDesc.Filter = D3D11_FILTER_ANISOTROPIC;
-	sampDesc.MaxAnisotropy = 8;
-	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-
-	device->CreateSamplerState(&sampDesc, skySampState.GetAddressOf());
-
-	// Now that the meshes are loaded in we can create the sky-
-	sky = std::make_shared<Sky>(
-		device.Get(),
-		context.Get(),
-		meshes[0], // Skybox is a cube
-		skyVS,
-		skyPS,
-		skySampState.Get(),
-		FixPath(L"../../Assets/Textures/Sky/right.png").c_str(),
-		FixPath(L"../../Assets/Textures/Sky/left.png").c_str(),
-		FixPath(L"../../Assets/Textures/Sky/up.png").c_str(),
-		FixPath(L"../../Assets/Textures/Sky/down.png").c_str(),
-		FixPath(L"../../Assets/Textures/Sky/front.png").c_str(),
-		FixPath(L"../../Assets/Textures/Sky/back.png").c_str()
-		);
-}
-
-// --------------------------------------------------------
-// Fills the renderables array
-// - Assembles the renderables inside from meshes and materials
-// --------------------------------------------------------
-void Game::CreateRenderables()
-{
-	// At position 0: the cube
-	renderables.push_back(std::make_shared<Renderable>(meshes[0], mat1));
-	// At position 1: the cylinder
-	renderables.push_back(std::make_shared<Renderable>(meshes[1], mat2));
-	// At position 2: the helix
-	renderables.push_back(std::make_shared<Renderable>(meshes[2], mat1));
-	// At position 3: the quad
-	renderables.push_back(std::make_shared<Renderable>(meshes[3], mat2));
-	// At position 4: the double sided quad
-	renderables.push_back(std::make_shared<Renderable>(meshes[4], mat1));
-	// At position 5: the sphere
-	renderables.push_back(std::make_shared<Renderable>(meshes[5], mat2));
-	// At position 6: the torus
-	renderables.push_back(std::make_shared<Renderable>(meshes[6], mat1));
-}
-
-// --------------------------------------------------------
-// Fills the transforms array
-// - Also gives the space to adjust transforms before the game starts
-// --------------------------------------------------------
-void Game::SetupTransforms()
-{
-	for (int i = 0; i < renderables.size(); i++)
-	{
-		// Remember that transforms (the array) is all pointers, no real transforms
-		transforms.push_back(renderables[i]->GetTransform());
-	}
-
-	// Now we can adjust them before the game begins if needed
-	transforms[0]->SetPosition(-9.0, 0.0, 0.0);
-	transforms[1]->SetPosition(-6.0, 0.0, 0.0);
-	transforms[2]->SetPosition(-3.0, 0.0, 0.0);
-	transforms[3]->SetPosition(0.0, 0.0, 0.0);
-	transforms[4]->SetPosition(3.0, 0.0, 0.0);
-	transforms[5]->SetPosition(6.0, 0.0, 0.0);
-	transforms[6]->SetPosition(9.0, 0.0, 0.0);
+	textureManager = std::make_shared<TextureManager>(renderDevice, jobSystem);
+	samplerManager = std::make_shared<SamplerManager>(renderDevice);
+
+	DemoScene::Shaders shaders;
+	shaders.VS = vs;
+	shaders.PS = ps;
+	shaders.SkyVS = skyVS;
+	shaders.SkyPS = skyPS;
+	scene = std::make_shared<DemoScene>(renderDevice, jobSystem, textureManager, samplerManager,
+		shaders, WideToNarrow(FixPath(L"../../Assets/")));
+
+	// Drawing reads these every frame, so keep them to hand
+	renderables = scene->GetRenderables();
+	sky = scene->GetSky();
+	renderableSortKeys = scene->GetSortKeys();
+	renderableBuckets = scene->GetBuckets();
+	bucketRenderables = scene->GetBucketRenderables();
+
+	occlusionCuller = std::make_shared<OcclusionCuller>(256, 128);
 }
 
+// --------------------------------------------------------
+// Creates the cascaded shadow map
+// - The cascades themselves are fit to the camera every frame
+// --------------------------------------------------------
 void Game::CreateShadowMapResources()
 {
-	// Create shadow requirements ------------------------------------------
-	shadowMapResolution = 1024;
-	shadowProjectionSize = 10.0f;
-
-	// Create the actual texture that will be the shadow map
-	D3D11_TEXTURE2D_DESC shadowDesc = {};
-	shadowDesc.Width = shadowMapResolution;
-	shadowDesc.Height = shadowMapResolution;
-	shadowDesc.ArraySize = 1;
-	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
-	shadowDesc.CPUAccessFlags = 0;
-	shadowDesc.Format = DXGI_FORMAT_R32_TYPELESS;
-	shadowDesc.MipLevels = 1;
-	shadowDesc.MiscFlags = 0;
-	shadowDesc.SampleDesc.Count = 1;
-	shadowDesc.SampleDesc.Quality = 0;
-	shadowDesc.Usage = D3D11_USAGE_DEFAULT;
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
-	device->CreateTexture2D(&shadowDesc, 0, shadowTexture.GetAddressOf());
-
-	// Create the depth/stencil
-	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
-	shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	shadowDSDesc.Texture2D.MipSlice = 0;
-	device->CreateDepthStencilView(shadowTexture.Get(), &shadowDSDesc, shadowDSV.GetAddressOf());
-
-	// Create the SRV for the shadow map
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	device->CreateShaderResourceView(shadowTexture.Get(), &srvDesc, shadowSRV.GetAddressOf());
-
-	// Create the special "comparison" sampler state for shadows
-	D3D11_SAMPLER_DESC shadowSampDesc = {};
-	shadowSampDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR; // COMPARISON filter!
-	shadowSampDesc.ComparisonFunc = D3D11_COMPARISON_LESS;
-	shadowSampDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
-	shadowSampDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
-	shadowSampDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
-	shadowSampDesc.BorderColor[0] = 1.0f;
-	shadowSampDesc.BorderColor[1] = 1.0f;
-	shadowSampDesc.BorderColor[2] = 1.0f;
-	shadowSampDesc.BorderColor[3] = 1.0f;
-	device->CreateSamplerState(&shadowSampDesc, &shadowSampler);
-
-	// Create a rasterizer state
-	D3D11_RASTERIZER_DESC shadowRastDesc = {};
-	shadowRastDesc.FillMode = D3D11_FILL_SOLID;
-	shadowRastDesc.CullMode = D3D11_CULL_BACK;
-	shadowRastDesc.DepthClipEnable = true;
-	shadowRastDesc.DepthBias = 1000; // Multiplied by (smallest possible positive value storable in the depth buffer)
-	shadowRastDesc.DepthBiasClamp = 0.0f;
-	shadowRastDesc.SlopeScaledDepthBias = 1.0f;
-	device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
-
-	// Create the "camera" matrices for the shadow map rendering
-
-	// View
-	XMMATRIX shView = XMMatrixLookAtLH(
-		XMVectorSet(0, 20, -20, 0),
-		XMVectorSet(0, 0, 0, 0),
-		XMVectorSet(0, 1, 0, 0));
-	XMStoreFloat4x4(&shadowViewMatrix, shView);
-
-	// Projection - we want ORTHOGRAPHIC for directional light shadows
-	// NOTE: This particular projection is set up to be SMALLER than
-	// the overall "scene", to show what happens when objects go
-	// outside the shadow area.  In a game, you'd never want the
-	// user to see this edge, but I'm specifically making the projection
-	// small in this demo to show you that it CAN happen.
-	//
-	// Ideally, the first two parameters below would be adjusted to
-	// fit the scene (or however much of the scene the user can see
-	// at a time).  More advanced techniques, like cascaded shadow maps,
-	// would use multiple (usually 4) shadow maps with increasingly larger
-	// projections to ensure large open world games have shadows "everywhere"
-	XMMATRIX shProj = XMMatrixOrthographicLH(shadowProjectionSize, shadowProjectionSize, 0.1f, 100.0f);
-	XMStoreFloat4x4(&shadowProjectionMatrix, shProj);
-
+	shadowMap = std::make_shared<CascadedShadowMap>(device, 2048);
+	shadowAtlas = std::make_shared<ShadowAtlas>(device, 4096);
 }
 
 // --------------------------------------------------------
@@ -436,82 +311,707 @@ void Game::InitLighting()
 {
 	ambientLight = DirectX::XMFLOAT3(0.0f, 0.0f, 0.24f);
 	
+	// Any number of lights can be added - the buffer grows to fit
+	lightManager = std::make_shared<LightManager>(device);
+
 	// Directional Light 1
-	dir1 = {};
+	Light dir1 = {};
 	dir1.Type = LIGHT_TYPE_DIRECTIONAL;
 	dir1.Direction = DirectX::XMFLOAT3(1.0f, 0.0f, 0.0f);
 	dir1.Color = DirectX::XMFLOAT3(0.13f, 0.05f, 0.65f);
 	dir1.Intensity = 1.0f;
+	lightManager->AddLight(dir1);
 
 	// Directional Light 2
-	dir2= {};
+	Light dir2 = {};
 	dir2.Type = LIGHT_TYPE_DIRECTIONAL;
 	dir2.Direction = DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f);
 	dir2.Color = DirectX::XMFLOAT3(0.0f, 0.8f, 0.2f);
 	dir2.Intensity = 1.0f;
+	lightManager->AddLight(dir2);
 
 	// Directional Light 3
-	dir3= {};
+	Light dir3 = {};
 	dir3.Type = LIGHT_TYPE_DIRECTIONAL;
 	dir3.Direction = DirectX::XMFLOAT3(0.0f, -1.0f, 0.0f);
 	dir3.Color = DirectX::XMFLOAT3(0.8f, 0.02f, 0.13f);
 	dir3.Intensity = 1.0f;
+	dir3.CastsShadow = 1;
+	lightManager->AddLight(dir3);
 
 	// Point Light 1
-	pl1 = {};
+	Light pl1 = {};
 	pl1.Type = LIGHT_TYPE_POINT;
-	pl1.Position = DirectX::XMFLOAT3(0.1, -1, 0.2);
+	pl1.Position = DirectX::XMFLOAT3(0.1f, -1.0f, 0.2f);
 	pl1.Range = 18.0f;
 	pl1.Color = DirectX::XMFLOAT3(0.87f, 0.95f, 0.935f);
 	pl1.Intensity = 1.0f;
+	pl1.CastsShadow = 1;
+	lightManager->AddLight(pl1);
 
 	// Point Light 2
-	pl2 = {};
+	Light pl2 = {};
 	pl2.Type = LIGHT_TYPE_POINT;
-	pl2.Position = DirectX::XMFLOAT3(0.9, -1.6, 4.0);
+	pl2.Position = DirectX::XMFLOAT3(0.9f, -1.6f, 4.0f);
 	pl2.Range = 45.0f;
-	pl2.Color = DirectX::XMFLOAT3(0.954f, 0.85f, 1.0);
+	pl2.Color = DirectX::XMFLOAT3(0.954f, 0.85f, 1.0f);
 	pl2.Intensity = 1.0f;
+	lightManager->AddLight(pl2);
 }
 
 // --------------------------------------------------------
-// Renders the shadow map from the light's point of view
+// Every renderable's pixel shader gets the same lights
+// --------------------------------------------------------
+void Game::SetLightData(std::shared_ptr<RenderShader> shader, const FramePacket& frame)
+{
+	// Game's shaders are all SimpleShaders, and the lights need more than the RenderShader interface
+	SimplePixelShader* pixelShader = static_cast<SimplePixelShader*>(shader.get());
+
+	// All the renderables get the ambient light cast onto their pixel shader
+	pixelShader->SetFloat3("ambientLight", frame.AmbientLight);
+	// The lights themselves are already in the light buffer - the shader needs to know
+	// which are directional, and how to find a pixel's cluster for the rest
+	pixelShader->SetInt("directionalLightCount", (int)directionalLightCount);
+	pixelShader->SetFloat2("clusterTileScale", DirectX::XMFLOAT2(
+		(float)ClusterGrid::TilesX / windowWidth,
+		(float)ClusterGrid::TilesY / windowHeight));
+	pixelShader->SetFloat2("clusterNearFar", DirectX::XMFLOAT2(clusterGrid.GetNearZ(), clusterGrid.GetFarZ()));
+	pixelShader->SetFloat("clusterDepthScale", clusterGrid.GetDepthScale());
+	pixelShader->SetFloat("clusterDepthBias", clusterGrid.GetDepthBias());
+
+	// Shadows
+	XMFLOAT4X4 cascadeMatrices[CascadedShadowMap::MaxCascades] = {};
+	XMFLOAT4 cascadeSplits(0.0f, 0.0f, 0.0f, 0.0f);
+	for (unsigned int i = 0; i < shadowMap->GetCascadeCount(); i++)
+	{
+		cascadeMatrices[i] = shadowMap->GetCascade(i).ViewProjection;
+		(&cascadeSplits.x)[i] = shadowMap->GetCascade(i).SplitFar;
+	}
+	pixelShader->SetData("shadowViewProjection", cascadeMatrices, sizeof(cascadeMatrices));
+	pixelShader->SetFloat4("cascadeSplits", cascadeSplits);
+	pixelShader->SetInt("shadowLightIndex", shadowLightIndex);
+	pixelShader->SetInt("cascadeCount", (int)shadowMap->GetCascadeCount());
+	pixelShader->SetInt("shadowFilterRadius", frame.ShadowFilterRadius);
+	pixelShader->SetFloat("shadowMapSize", (float)shadowMap->GetResolution());
+	pixelShader->SetFloat("shadowAtlasSize", (float)shadowAtlas->GetResolution());
+}
+
+// --------------------------------------------------------
+// Uploads the frame's lights and builds each cluster's
+// list of point lights, on the GPU or the CPU
+// - BindLightBuffers() binds the results for drawing
+// --------------------------------------------------------
+void Game::CullLights(FramePacket& frame)
+{
+	CPU_PROFILE_FUNCTION();
+
+	// Directional lights go first, so the shader can loop over them without a list
+	renderLights.clear();
+	for (const Light& light : frame.Lights)
+	{
+		if (light.Type == LIGHT_TYPE_DIRECTIONAL)
+			renderLights.push_back(light);
+	}
+	directionalLightCount = (unsigned int)renderLights.size();
+	for (const Light& light : frame.Lights)
+	{
+		if (light.Type != LIGHT_TYPE_DIRECTIONAL)
+			renderLights.push_back(light);
+	}
+
+	// Shadowed local lights need to know their atlas tiles before they're uploaded
+	shadowAtlas->Update(context, renderLights, directionalLightCount, frame.Camera.Position, frame.Camera.FieldOfView);
+	lightManager->Upload(context, renderLights);
+	frame.RenderStats.LightCapacity = lightManager->GetCapacity();
+
+	// The clusters only change with the projection
+	const FrameCamera& cam = frame.Camera;
+	if (cam.FieldOfView != clusterProjection.x ||
+		cam.AspectRatio != clusterProjection.y ||
+		cam.NearClip != clusterProjection.z ||
+		cam.FarClip != clusterProjection.w)
+	{
+		clusterProjection = XMFLOAT4(cam.FieldOfView, cam.AspectRatio, cam.NearClip, cam.FarClip);
+		clusterGrid.SetProjection(cam.FieldOfView, cam.AspectRatio, cam.NearClip, cam.FarClip);
+		clusterCuller->UploadBounds(context, clusterGrid);
+	}
+
+	// Point and spot lights, as view space spheres - spot lights
+	// are culled by their full range, which is conservative
+	XMMATRIX view = XMLoadFloat4x4(&cam.View);
+	clusterGrid.ClearLights();
+	for (unsigned int i = directionalLightCount; i < renderLights.size(); i++)
+	{
+		if (renderLights[i].Type != LIGHT_TYPE_POINT && renderLights[i].Type != LIGHT_TYPE_SPOT)
+			continue;
+
+		XMFLOAT3 viewPosition;
+		XMStoreFloat3(&viewPosition, XMVector3TransformCoord(XMLoadFloat3(&renderLights[i].Position), view));
+		clusterGrid.AddLight(&viewPosition.x, renderLights[i].Range, i);
+	}
+
+	// The lists can't be bound for reading while they're being written
+	ID3D11ShaderResourceView* nullSRV = 0;
+	stateCache->PSSetShaderResources(clusterCountSlot, 1, &nullSRV);
+	stateCache->PSSetShaderResources(clusterIndexSlot, 1, &nullSRV);
+
+	// The CPU version runs when it's in use, or when checking the GPU against it
+	frame.RenderStats.ClusterCullTime = 0.0;
+	frame.RenderStats.ClusterOverflows = 0;
+	frame.RenderStats.ClusterMismatches = 0;
+	frame.RenderStats.ClusterValidated = false;
+	if (!frame.GpuClusterCulling || frame.ValidateClusters)
+	{
+		auto cullStart = std::chrono::steady_clock::now();
+		clusterGrid.Cull(jobSystem.get());
+		frame.RenderStats.ClusterCullTime =
+			std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+		frame.RenderStats.ClusterOverflows = clusterGrid.GetOverflowCount();
+	}
+
+	if (frame.GpuClusterCulling)
+	{
+		clusterCuller->CullOnGpu(context, clusterGrid);
+		if (frame.ValidateClusters)
+		{
+			frame.RenderStats.ClusterMismatches = clusterCuller->Validate(context, clusterGrid);
+			frame.RenderStats.ClusterValidated = true;
+		}
+	}
+	else
+	{
+		clusterCuller->UploadCpuResults(context, clusterGrid);
+	}
+}
+
+// --------------------------------------------------------
+// Binds everything the pixel shader reads lighting from
+// (lights, cluster lists and shadows) through the given cache
+// --------------------------------------------------------
+void Game::BindLightBuffers(std::shared_ptr<StateCache> cache)
+{
+	ID3D11ShaderResourceView* lightSRV = lightManager->GetSRV();
+	ID3D11ShaderResourceView* countSRV = clusterCuller->GetLightCountSRV();
+	ID3D11ShaderResourceView* indexSRV = clusterCuller->GetLightIndexSRV();
+	ID3D11ShaderResourceView* shadowSRV = shadowMap->GetSRV();
+	ID3D11SamplerState* shadowSampler = shadowMap->GetSampler();
+	ID3D11ShaderResourceView* atlasSRV = shadowAtlas->GetSRV();
+	ID3D11ShaderResourceView* tileSRV = shadowAtlas->GetTileSRV();
+	cache->PSSetShaderResources(lightBufferSlot, 1, &lightSRV);
+	cache->PSSetShaderResources(clusterCountSlot, 1, &countSRV);
+	cache->PSSetShaderResources(clusterIndexSlot, 1, &indexSRV);
+	cache->PSSetShaderResources(shadowMapSlot, 1, &shadowSRV);
+	cache->PSSetSamplers(shadowSamplerSlot, 1, &shadowSampler);
+	cache->PSSetShaderResources(shadowAtlasSlot, 1, &atlasSRV);
+	cache->PSSetShaderResources(shadowTileSlot, 1, &tileSRV);
+}
+
+// --------------------------------------------------------
+// Draws the sorted render queue on the immediate context
+// --------------------------------------------------------
+void Game::DrawRenderablesSerial(const FramePacket& frame)
+{
+	CPU_PROFILE_FUNCTION();
+
+	for (unsigned int i = 0; i < renderQueue.GetCount(); i++)
+	{
+		const FrameDrawItem& item = frame.DrawItems[renderQueue[i].Index];
+		std::shared_ptr<Renderable> r = renderables[item.RenderableIndex];
+		SetLightData(r->GetMaterial()->GetPS(), frame);
+		r->Draw(renderContext.get(), frame.Camera, item, frame.TotalTime);
+	}
+}
+
+// --------------------------------------------------------
+// Records the sorted render queue on the worker threads'
+// deferred contexts, then executes the lists in order
+//
+// Returns false (having drawn nothing) if this isn't
+// possible, so the caller can draw serially instead
 // --------------------------------------------------------
-void Game::RenderShadowMap()
+bool Game::DrawRenderablesParallel(const FramePacket& frame)
 {
-	// Initial pipeline setup - No RTV necessary - Clear shadow map
-	context->OMSetRenderTargets(0, 0, shadowDSV.Get());
-	context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-	context->RSSetState(shadowRasterizer.Get());
+	CPU_PROFILE_FUNCTION();
 
-	// Set the shadow-specific vertex shader
-	shadowVS->SetShader();
-	shadowVS->SetMatrix4x4("view", shadowViewMatrix);
-	shadowVS->SetMatrix4x4("projection", shadowProjectionMatrix);
-	context->PSSetShader(0, 0, 0); // No pixel shader
+	if (!commandListRecorder->IsSupported() || !constantBufferRing->IsSupported())
+		return false;
 
-	// Need to create a viewport that matches the shadow map resolution
+	// Upload every draw's constants here, in queue order, and remember
+	// where each landed - the workers only bind those slices
+	unsigned int ringGeneration = constantBufferRing->GetGeneration();
+	drawRecords.resize(renderQueue.GetCount());
+	for (unsigned int i = 0; i < renderQueue.GetCount(); i++)
+	{
+		const FrameDrawItem& item = frame.DrawItems[renderQueue[i].Index];
+		std::shared_ptr<Renderable> r = renderables[item.RenderableIndex];
+		SetLightData(r->GetMaterial()->GetPS(), frame);
+
+		drawRecords[i].Object = r.get();
+		if (!r->CopyConstants(frame.Camera, item, frame.TotalTime, &drawRecords[i].VSRanges, &drawRecords[i].PSRanges))
+			return false;
+	}
+
+	// The ring filled up and was discarded, taking the earlier draws' slices with it -
+	// the lists would run after the discard, so draw serially (uploading again) instead
+	if (constantBufferRing->GetGeneration() != ringGeneration)
+		return false;
+
+	// Deferred contexts start from default state, so each list needs the targets and viewport
 	D3D11_VIEWPORT viewport = {};
-	viewport.TopLeftX = 0.0f;
-	viewport.TopLeftY = 0.0f;
-	viewport.Width = (float)shadowMapResolution;
-	viewport.Height = (float)shadowMapResolution;
-	viewport.MinDepth = 0.0f;
-	viewport.MaxDepth = 1.0f;
+	unsigned int viewportCount = 1;
+	context->RSGetViewports(&viewportCount, &viewport);
+
+	renderQueue.Partition(commandListRecorder->GetContextCount(), 1, drawChunks);
+	commandListRecorder->Record((unsigned int)drawChunks.size(),
+		[&](std::shared_ptr<StateCache> cache, ID3D11DeviceContext* deferred, unsigned int chunkIndex)
+		{
+			deferred->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthBufferDSV.Get());
+			deferred->RSSetViewports(1, &viewport);
+			cache->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			cache->RSSetState(0);
+			cache->OMSetDepthStencilState(frame.DepthPrepass ? depthEqualState.Get() : 0, 0);
+			BindLightBuffers(cache);
+
+			D3D11RenderContext workerContext(cache, deferred);
+			const RenderQueueChunk& chunk = drawChunks[chunkIndex];
+			for (unsigned int i = chunk.First; i < chunk.First + chunk.Count; i++)
+			{
+				drawRecords[i].Object->Record(&workerContext, drawRecords[i].VSRanges, drawRecords[i].PSRanges);
+			}
+		});
+	commandListRecorder->Execute(context);
+
+	// Executing the lists reset the immediate context to default state
+	stateCache->Invalidate();
+	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthBufferDSV.Get());
 	context->RSSetViewports(1, &viewport);
+	stateCache->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	stateCache->RSSetState(0);
+	stateCache->OMSetDepthStencilState(frame.DepthPrepass ? depthEqualState.Get() : 0, 0);
+	BindLightBuffers(stateCache);
+	return true;
+}
+
+// --------------------------------------------------------
+// Uploads every item and has the GPU cull them, ready for
+// one indirect draw per mesh/material bucket
+//
+// - The CPU only gathers transforms and bounds - which
+//   instances survive, and how many, stays on the GPU
+// - Needs the occlusion culler's Hi-Z, so call after
+//   CullOccludedItems()
+// --------------------------------------------------------
+void Game::PrepareIndirectDraws(FramePacket& frame)
+{
+	CPU_PROFILE_FUNCTION();
+
+	// Count each bucket's instances, then lay the buckets out back to back
+	indirectBuckets.assign(bucketRenderables.size(), IndirectRenderer::Bucket());
+	for (const FrameDrawItem& item : frame.DrawItems)
+		indirectBuckets[renderableBuckets[item.RenderableIndex]].InstanceCount++;
+
+	unsigned int firstInstance = 0;
+	for (unsigned int b = 0; b < indirectBuckets.size(); b++)
+	{
+		indirectBuckets[b].IndexCount = renderables[bucketRenderables[b]]->GetMesh()->GetIndexCount();
+		indirectBuckets[b].FirstInstance = firstInstance;
+		firstInstance += indirectBuckets[b].InstanceCount;
+	}
+
+	indirectInstances.resize(frame.DrawItems.size());
+	for (unsigned int i = 0; i < frame.DrawItems.size(); i++)
+	{
+		const FrameDrawItem& item = frame.DrawItems[i];
+		const BoundingBox& bounds = renderables[item.RenderableIndex]->GetMesh()->GetBounds();
+		IndirectRenderer::Instance& instance = indirectInstances[i];
+		instance.World = item.World;
+		instance.WorldInvTrans = item.WorldInvTrans;
+		instance.BoundsCenter = bounds.Center;
+		instance.BoundsExtents = bounds.Extents;
+		instance.Bucket = renderableBuckets[item.RenderableIndex];
+		instance.BucketOffset = indirectBuckets[instance.Bucket].FirstInstance;
+	}
+
+	// The visible list is about to be written, so it can't stay bound for reading
+	indirectVS->SetShaderResourceView("VisibleInstances", 0);
+
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMLoadFloat4x4(&frame.Camera.View) * XMLoadFloat4x4(&frame.Camera.Projection));
+	indirectRenderer->Upload(context, indirectInstances, indirectBuckets);
+	if (frame.OcclusionCulling)
+		indirectRenderer->UploadHiZ(context, *occlusionCuller);
+	indirectRenderer->Cull(context, viewProjection, frame.OcclusionCulling);
+
+	frame.RenderStats.IndirectDraws = 0;
+	frame.RenderStats.IndirectInstances = indirectRenderer->GetInstanceCount();
+	indirectVS->SetShaderResourceView("Instances", indirectRenderer->GetInstanceSRV());
+	indirectVS->SetShaderResourceView("VisibleInstances", indirectRenderer->GetVisibleSRV());
+	indirectVS->SetMatrix4x4("view", frame.Camera.View);
+	indirectVS->SetMatrix4x4("projection", frame.Camera.Projection);
+}
+
+// --------------------------------------------------------
+// Issues the indirect draws PrepareIndirectDraws() set up
+// --------------------------------------------------------
+void Game::DrawRenderablesIndirect(FramePacket& frame)
+{
+	CPU_PROFILE_FUNCTION();
+
+	if (indirectRenderer->GetInstanceCount() == 0)
+		return;
+
+	// The args buffer is recreated as the buckets grow, so wrap whichever one is current
+	RenderBufferDesc argsDesc = { RenderBufferDesc::IndirectArgsBuffer, RenderBufferDesc::Default,
+		(unsigned int)indirectBuckets.size() * IndirectRenderer::ArgsStride, 0 };
+	D3D11RenderBuffer args(argsDesc, indirectRenderer->GetArgsBuffer());
+
+	for (unsigned int b = 0; b < indirectBuckets.size(); b++)
+	{
+		if (indirectBuckets[b].InstanceCount == 0)
+			continue;
+
+		std::shared_ptr<Renderable> r = renderables[bucketRenderables[b]];
+		std::shared_ptr<Material> material = r->GetMaterial();
+		std::shared_ptr<SimplePixelShader> pixelShader = std::static_pointer_cast<SimplePixelShader>(material->GetPS());
+
+		indirectVS->SetInt("bucketOffset", (int)indirectBuckets[b].FirstInstance);
+		indirectVS->CopyAllBufferData();
+		renderContext->SetShader(RenderContext::VertexStage, indirectVS.get(), 0);
+
+		SetLightData(pixelShader, frame);
+		pixelShader->SetFloat4("colorTint", material->GetColorTint());
+		pixelShader->SetFloat3("cameraPosition", frame.Camera.Position);
+		pixelShader->SetFloat("totalTime", frame.TotalTime);
+		pixelShader->CopyAllBufferData();
+		material->PreparePixelStage(renderContext.get());
+
+		r->GetMesh()->DrawIndirect(renderContext.get(), &args, b * IndirectRenderer::ArgsStride);
+		frame.RenderStats.IndirectDraws++;
+	}
+}
+
+// --------------------------------------------------------
+// Draws everything the main pass will, depth only
+//
+// - No pixel shader, so overdraw here is cheap, and the
+//   main pass (depth EQUAL, no writes) then shades each
+//   pixel once
+// - The position-only shadow vertex shader computes the
+//   position exactly as VertexShader does (both are marked
+//   precise), so depths match bit for bit.  Indirect draws
+//   just use IndirectVS for both passes.
+// --------------------------------------------------------
+void Game::DrawDepthPrepass(const FramePacket& frame)
+{
+	CPU_PROFILE_FUNCTION();
+
+	renderContext->SetShader(RenderContext::PixelStage, 0, 0);
+
+	if (frame.GpuDrivenDraws)
+	{
+		if (indirectRenderer->GetInstanceCount() == 0)
+			return;
+
+		// The args buffer is recreated as the buckets grow, so wrap whichever one is current
+		RenderBufferDesc argsDesc = { RenderBufferDesc::IndirectArgsBuffer, RenderBufferDesc::Default,
+			(unsigned int)indirectBuckets.size() * IndirectRenderer::ArgsStride, 0 };
+		D3D11RenderBuffer args(argsDesc, indirectRenderer->GetArgsBuffer());
+
+		for (unsigned int b = 0; b < indirectBuckets.size(); b++)
+		{
+			if (indirectBuckets[b].InstanceCount == 0)
+				continue;
+
+			indirectVS->SetInt("bucketOffset", (int)indirectBuckets[b].FirstInstance);
+			indirectVS->CopyAllBufferData();
+			renderContext->SetShader(RenderContext::VertexStage, indirectVS.get(), 0);
+			renderables[bucketRenderables[b]]->GetMesh()->DrawIndirect(
+				renderContext.get(), &args, b * IndirectRenderer::ArgsStride);
+		}
+		return;
+	}
 
-	// Loop and draw all entities
-	for (auto& e : renderables)
+	renderContext->SetShader(RenderContext::VertexStage, shadowVS.get(), 0);
+	shadowVS->SetMatrix4x4("view", frame.Camera.View);
+	shadowVS->SetMatrix4x4("projection", frame.Camera.Projection);
+	for (unsigned int i = 0; i < renderQueue.GetCount(); i++)
 	{
-		shadowVS->SetMatrix4x4("world", e->GetTransform()->GetWorldMatrix());
+		const FrameDrawItem& item = frame.DrawItems[renderQueue[i].Index];
+		shadowVS->SetMatrix4x4("world", item.World);
 		shadowVS->CopyAllBufferData();
+		renderables[item.RenderableIndex]->GetMesh()->Draw(renderContext.get());
+	}
+}
+
+// --------------------------------------------------------
+// Renders each shadow cascade from the light's point of view
+// - Only casters that reach a cascade are drawn into it
+// - With caching on, static casters come from a cache that
+//   is only redrawn when the cascades or static set change
+// - Needs the render side's lights, so call after CullLights()
+// --------------------------------------------------------
+void Game::RenderShadowMap(FramePacket& frame)
+{
+	CPU_PROFILE_FUNCTION();
 
-		// Draw the mesh
-		e->GetMesh()->Draw();
+	frame.RenderStats.ShadowDraws = 0;
+	frame.RenderStats.ShadowCulled = 0;
+	frame.RenderStats.ShadowsReused = false;
+	frame.RenderStats.ShadowCacheRebuilt = false;
+
+	// The first directional light that asks for shadows gets them
+	shadowLightIndex = -1;
+	for (unsigned int i = 0; i < directionalLightCount; i++)
+	{
+		if (renderLights[i].CastsShadow)
+		{
+			shadowLightIndex = (int)i;
+			break;
+		}
+	}
+	if (shadowLightIndex < 0)
+		return;
+
+	shadowMap->Fit(
+		frame.Camera.View,
+		frame.Camera.FieldOfView,
+		frame.Camera.AspectRatio,
+		frame.Camera.NearClip,
+		renderLights[shadowLightIndex].Direction,
+		frame.ShadowCascadeCount,
+		fminf(frame.ShadowDistance, frame.Camera.FarClip),
+		frame.ShadowSplitLambda,
+		50.0f);
+
+	// If the cascades landed exactly where they did last time, and nothing
+	// that casts into them has moved, the map already holds this frame's shadows
+	if (!shadowMap->NeedsRender(frame.CasterVersion))
+	{
+		frame.RenderStats.ShadowsReused = true;
+		return;
+	}
+
+	// The map can't be bound for reading while it's drawn to
+	ID3D11ShaderResourceView* nullSRV = 0;
+	stateCache->PSSetShaderResources(shadowMapSlot, 1, &nullSRV);
+
+	// Need a viewport that matches the shadow map resolution
+	D3D11_VIEWPORT mainViewport = {};
+	unsigned int viewportCount = 1;
+	context->RSGetViewports(&viewportCount, &mainViewport);
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)shadowMap->GetResolution();
+	viewport.Height = (float)shadowMap->GetResolution();
+	viewport.MaxDepth = 1.0f;
+	context->RSSetViewports(1, &viewport);
+
+	// Depth only - no pixel shader
+	stateCache->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	stateCache->RSSetState(shadowMap->GetRasterizer());
+	stateCache->OMSetDepthStencilState(0, 0);
+	renderContext->SetShader(RenderContext::VertexStage, shadowVS.get(), 0);
+	renderContext->SetShader(RenderContext::PixelStage, 0, 0);
+
+	if (frame.ShadowCaching)
+	{
+		// Redraw the static casters only when the cascades moved
+		// or a static caster changed
+		if (shadowMap->NeedsStaticRender(frame.StaticCasterVersion))
+		{
+			for (unsigned int c = 0; c < shadowMap->GetCascadeCount(); c++)
+			{
+				ID3D11DepthStencilView* dsv = shadowMap->GetStaticDSV(c);
+				context->OMSetRenderTargets(0, 0, dsv);
+				context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH, 1.0f, 0);
+				DrawShadowCasters(frame, c, true, false);
+			}
+			context->OMSetRenderTargets(0, 0, 0);
+			shadowMap->MarkStaticRendered(frame.StaticCasterVersion);
+			frame.RenderStats.ShadowCacheRebuilt = true;
+		}
+
+		// Start from the static depth, then add the dynamic casters on top
+		shadowMap->RestoreStatic(context.Get());
+		for (unsigned int c = 0; c < shadowMap->GetCascadeCount(); c++)
+		{
+			context->OMSetRenderTargets(0, 0, shadowMap->GetDSV(c));
+			DrawShadowCasters(frame, c, false, true);
+		}
+	}
+	else
+	{
+		for (unsigned int c = 0; c < shadowMap->GetCascadeCount(); c++)
+		{
+			ID3D11DepthStencilView* dsv = shadowMap->GetDSV(c);
+			context->OMSetRenderTargets(0, 0, dsv);
+			context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH, 1.0f, 0);
+			DrawShadowCasters(frame, c, true, true);
+		}
+	}
+
+	shadowMap->MarkRendered(frame.CasterVersion);
+
+	// Put everything back
+	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthBufferDSV.Get());
+	context->RSSetViewports(1, &mainViewport);
+}
+
+// --------------------------------------------------------
+// Renders every point and spot light tile in the shadow
+// atlas, placed earlier by CullLights()
+// - Each tile (so each cube face) culls casters against its
+//   own frustum
+// --------------------------------------------------------
+void Game::RenderShadowAtlas(FramePacket& frame)
+{
+	CPU_PROFILE_FUNCTION();
+
+	frame.RenderStats.AtlasLights = shadowAtlas->GetShadowedLightCount();
+	frame.RenderStats.AtlasTiles = shadowAtlas->GetTileCount();
+	frame.RenderStats.AtlasDraws = 0;
+	frame.RenderStats.AtlasCulled = 0;
+	if (shadowAtlas->GetTileCount() == 0)
+		return;
+
+	// The atlas can't be bound for reading while it's drawn to
+	ID3D11ShaderResourceView* nullSRV = 0;
+	stateCache->PSSetShaderResources(shadowAtlasSlot, 1, &nullSRV);
+
+	D3D11_VIEWPORT mainViewport = {};
+	unsigned int viewportCount = 1;
+	context->RSGetViewports(&viewportCount, &mainViewport);
+
+	context->OMSetRenderTargets(0, 0, shadowAtlas->GetDSV());
+	context->ClearDepthStencilView(shadowAtlas->GetDSV(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+	// Depth only - no pixel shader
+	stateCache->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	stateCache->RSSetState(shadowAtlas->GetRasterizer());
+	stateCache->OMSetDepthStencilState(0, 0);
+	renderContext->SetShader(RenderContext::VertexStage, shadowVS.get(), 0);
+	renderContext->SetShader(RenderContext::PixelStage, 0, 0);
+
+	for (unsigned int t = 0; t < shadowAtlas->GetTileCount(); t++)
+	{
+		const ShadowAtlas::TileView& tile = shadowAtlas->GetTileView(t);
+		context->RSSetViewports(1, &tile.Viewport);
+		shadowVS->SetMatrix4x4("view", tile.View);
+		shadowVS->SetMatrix4x4("projection", tile.Projection);
+
+		for (const FrameDrawItem& item : frame.DrawItems)
+		{
+			std::shared_ptr<Mesh> mesh = renderables[item.RenderableIndex]->GetMesh();
+			BoundingBox worldBounds;
+			mesh->GetBounds().Transform(worldBounds, XMLoadFloat4x4(&item.World));
+			if (!tile.Frustum.Intersects(worldBounds))
+			{
+				frame.RenderStats.AtlasCulled++;
+				continue;
+			}
+
+			shadowVS->SetMatrix4x4("world", item.World);
+			shadowVS->CopyAllBufferData();
+			mesh->Draw(renderContext.get());
+			frame.RenderStats.AtlasDraws++;
+		}
 	}
 
 	// Put everything back
 	context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthBufferDSV.Get());
+	context->RSSetViewports(1, &mainViewport);
+}
+
+// --------------------------------------------------------
+// Rasterizes the occluders into the software depth buffer
+// (across the job system), then tests every draw item's
+// bounds against its Hi-Z chain
+// - Fills itemVisible, which is all ones if culling is off
+// --------------------------------------------------------
+void Game::CullOccludedItems(FramePacket& frame)
+{
+	CPU_PROFILE_FUNCTION();
+
+	itemVisible.assign(frame.DrawItems.size(), 1);
+	frame.RenderStats.OcclusionTime = 0.0;
+	frame.RenderStats.OccluderTriangles = 0;
+	frame.RenderStats.OcclusionCulled = 0;
+	if (!frame.OcclusionCulling)
+		return;
+
+	auto start = std::chrono::steady_clock::now();
+
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMLoadFloat4x4(&frame.Camera.View) * XMLoadFloat4x4(&frame.Camera.Projection));
+	occlusionCuller->BeginFrame(&viewProjection._11);
+	for (const FrameDrawItem& item : frame.DrawItems)
+	{
+		std::shared_ptr<Renderable> r = renderables[item.RenderableIndex];
+		if (!r->IsOccluder())
+			continue;
+
+		std::shared_ptr<Mesh> mesh = r->GetMesh();
+		if (mesh->GetPositions().empty())
+			continue;
+		occlusionCuller->AddOccluder(
+			&mesh->GetPositions()[0].x,
+			(unsigned int)mesh->GetPositions().size(),
+			mesh->GetIndices().data(),
+			(unsigned int)mesh->GetIndices().size(),
+			&item.World._11);
+	}
+	occlusionCuller->Rasterize(jobSystem.get());
+
+	// The GPU-driven path tests the boxes itself, against the same Hi-Z chain
+	for (unsigned int i = 0; i < frame.DrawItems.size() && !frame.GpuDrivenDraws; i++)
+	{
+		const FrameDrawItem& item = frame.DrawItems[i];
+		const BoundingBox& bounds = renderables[item.RenderableIndex]->GetMesh()->GetBounds();
+		XMFLOAT3 boxMin(bounds.Center.x - bounds.Extents.x, bounds.Center.y - bounds.Extents.y, bounds.Center.z - bounds.Extents.z);
+		XMFLOAT3 boxMax(bounds.Center.x + bounds.Extents.x, bounds.Center.y + bounds.Extents.y, bounds.Center.z + bounds.Extents.z);
+		if (!occlusionCuller->IsVisible(&boxMin.x, &boxMax.x, &item.World._11))
+		{
+			itemVisible[i] = 0;
+			frame.RenderStats.OcclusionCulled++;
+		}
+	}
+
+	frame.RenderStats.OccluderTriangles = occlusionCuller->GetTrianglesRasterized();
+	frame.RenderStats.OcclusionTime =
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Draws the casters that reach one cascade into whatever
+// depth view is currently bound
+//
+// drawStatic, drawDynamic - Which kinds of caster to draw
+// --------------------------------------------------------
+void Game::DrawShadowCasters(FramePacket& frame, unsigned int cascadeIndex, bool drawStatic, bool drawDynamic)
+{
+	const CascadedShadowMap::Cascade& cascade = shadowMap->GetCascade(cascadeIndex);
+	shadowVS->SetMatrix4x4("view", cascade.View);
+	shadowVS->SetMatrix4x4("projection", cascade.Projection);
+
+	for (const FrameDrawItem& item : frame.DrawItems)
+	{
+		if (item.DynamicCaster ? !drawDynamic : !drawStatic)
+			continue;
+
+		// Skip anything that can't cast into this cascade
+		std::shared_ptr<Mesh> mesh = renderables[item.RenderableIndex]->GetMesh();
+		BoundingBox worldBounds;
+		mesh->GetBounds().Transform(worldBounds, XMLoadFloat4x4(&item.World));
+		if (!cascade.Bounds.Intersects(worldBounds))
+		{
+			frame.RenderStats.ShadowCulled++;
+			continue;
+		}
+
+		shadowVS->SetMatrix4x4("world", item.World);
+		shadowVS->CopyAllBufferData();
+		mesh->Draw(renderContext.get());
+		frame.RenderStats.ShadowDraws++;
+	}
 }
 
 // -dir3-------------------------------------------------------
@@ -548,8 +1048,13 @@ ImGuiIO Game::PrepImGui(float deltaTime)
 	input.GetKeyArray(io.KeysDown, 256);
 
 	// Reset the frame
+	// - Headless runs have no window for the Win32 backend, and ImGui
+	//   refuses a frame that takes no time, which only the backend fixes
 	ImGui_ImplDX11_NewFrame();
-	ImGui_ImplWin32_NewFrame();
+	if (hWnd)
+		ImGui_ImplWin32_NewFrame();
+	else if (io.DeltaTime <= 0.0f)
+		io.DeltaTime = 1.0f / 60.0f;
 	ImGui::NewFrame();
 
 	// Determine new input capture (youll uncomment later)
@@ -569,12 +1074,171 @@ ImGuiIO Game::PrepImGui(float deltaTime)
 // --------------------------------------------------------
 void Game::UpdateImGui(ImGuiIO frameIO)
 {
-	float framerate = frameIO.Framerate;
+	CPU_PROFILE_FUNCTION();
 
 	ImGui::Begin("Stats"); // Everything after is part of the window
-	ImGui::Text("ms/frame: %.3f - FPS: %.1f", 1000.0f / framerate, framerate);
+
+	// Percentiles over the recent frames, rather than a smoothed average that hides stutters
+	FrameTimeStats::Summary frames = frameTimes.GetRecentSummary();
+	ImGui::Text("ms/frame p50: %.2f - p95: %.2f - p99: %.2f - max: %.2f", frames.P50, frames.P95, frames.P99, frames.Max);
+	ImGui::Text("Over budget: %llu of the last %llu frames",
+		(unsigned long long)frames.OverBudget,
+		(unsigned long long)frames.Frames);
+	if (ImGui::CollapsingHeader("Frame times"))
+	{
+		float budget = (float)frameTimes.GetBudget();
+		if (ImGui::SliderFloat("Budget (ms)", &budget, 4.0f, 50.0f, "%.2f"))
+			frameTimes.SetBudget(budget);
+
+		// Every recent frame, then how they're spread out
+		frameTimes.GetRecentFrames(recentFrameTimes);
+		float graphScale = (float)frames.Max > budget * 2.0f ? (float)frames.Max : budget * 2.0f;
+		ImGui::PlotLines("Recent", recentFrameTimes.data(), (int)recentFrameTimes.size(),
+			0, 0, 0.0f, graphScale, ImVec2(0.0f, 60.0f));
+		ImGui::PlotHistogram("Histogram", frames.Histogram, (int)FrameTimeStats::HistogramBuckets,
+			0, 0, 0.0f, FLT_MAX, ImVec2(0.0f, 60.0f));
+		ImGui::Text("Histogram covers 0 - %.0f ms, the last bar is everything slower", frameTimes.GetHistogramRange());
+
+		// Saved for benchmark runs to play back (-benchmark -camerapath CameraPath.txt)
+		if (ImGui::Checkbox("Record camera path (CameraPath.txt)", &recordingCameraPath))
+		{
+			if (recordingCameraPath)
+			{
+				recordedCameraPath.Clear();
+				cameraPathTime = 0.0f;
+			}
+			else
+			{
+				recordedCameraPath.SaveToFile("CameraPath.txt");
+			}
+		}
+
+		// Newest first
+		std::vector<FrameTimeStats::Spike> spikes = frameTimes.GetSpikes();
+		for (unsigned int i = 0; i < spikes.size() && i < 8; i++)
+		{
+			const FrameTimeStats::Spike& spike = spikes[spikes.size() - 1 - i];
+			ImGui::Text("Frame %llu: %.2f ms", (unsigned long long)spike.Frame, spike.Milliseconds);
+		}
+	}
 	ImGui::Text("display size X: %.0f", frameIO.DisplaySize.x);
 	ImGui::Text("display size Y: %.0f", frameIO.DisplaySize.y);
+
+	// GPU time per pass, indented by nesting, each with a rolling graph
+	// - Graphs share the frame's peak as their scale, so they compare at a glance
+	const GpuProfiler::Results& gpuProfile = latestRenderStats.GpuProfile;
+	if (gpuProfile.ScopeCount > 0 && ImGui::CollapsingHeader("GPU timings", ImGuiTreeNodeFlags_DefaultOpen))
+	{
+		float graphScale = gpuProfile.Scopes[0].Peak > 0.0f ? gpuProfile.Scopes[0].Peak : 1.0f;
+		for (unsigned int i = 0; i < gpuProfile.ScopeCount; i++)
+		{
+			const GpuProfiler::ScopeStats& scope = gpuProfile.Scopes[i];
+			ImGui::PushID((int)i);
+			ImGui::Text("%*s%s: %.3f ms - avg %.3f - peak %.3f",
+				(int)scope.Depth * 2, "", scope.Name, scope.Latest, scope.Average, scope.Peak);
+			ImGui::PlotLines("##history", scope.History, (int)GpuProfiler::HistoryLength, (int)gpuProfile.HistoryOffset,
+				0, 0.0f, graphScale, ImVec2(0.0f, 30.0f));
+			ImGui::PopID();
+		}
+		ImGui::Text("GPU frames resolved: %u - dropped: %u", gpuProfile.FramesResolved, gpuProfile.FramesDropped);
+	}
+
+	// CPU time per scope over the last finished frame, one tree per thread
+	// - Repeated scopes under the same parent show up once, with a count
+	if (ImGui::CollapsingHeader("CPU timings"))
+	{
+		CpuProfiler& cpuProfiler = CpuProfiler::GetInstance();
+		double frameMilliseconds = 0.0;
+		if (cpuProfiler.SummarizeFrame(1, cpuProfile, &frameMilliseconds))
+		{
+			ImGui::Text("Frame: %.3f ms", frameMilliseconds);
+			for (unsigned int t = 0; t < cpuProfile.size(); t++)
+			{
+				ImGui::PushID((int)t);
+				if (ImGui::TreeNode(cpuProfile[t].Name.c_str()))
+				{
+					for (const CpuProfiler::ScopeSummary& scope : cpuProfile[t].Scopes)
+					{
+						ImGui::Text("%*s%s x%u: %.3f ms", (int)scope.Depth * 2, "", scope.Name, scope.Count, scope.Milliseconds);
+					}
+					ImGui::TreePop();
+				}
+				ImGui::PopID();
+			}
+		}
+
+		if (ImGui::Button("Measure scope overhead"))
+			cpuScopeOverhead = (float)cpuProfiler.MeasureScopeOverhead(1000000);
+		if (cpuScopeOverhead > 0.0f)
+		{
+			ImGui::SameLine();
+			ImGui::Text("%.1f ns per scope", cpuScopeOverhead);
+		}
+
+		ImGui::SliderInt("Frames to dump", &cpuTraceFrames, 1, (int)CpuProfiler::FrameHistory - 2);
+		if (ImGui::Button("Dump to Chrome trace (CpuTrace.json)"))
+			cpuProfiler.WriteChromeTrace("CpuTrace.json", (unsigned int)cpuTraceFrames);
+	}
+
+	// What every loaded texture costs, and how often loads were shared instead
+	if (ImGui::CollapsingHeader("Textures"))
+	{
+		TextureManager::Stats textureStats = textureManager->GetStats();
+		ImGui::Text("Textures: %u - %.2f MB", textureStats.Textures, textureStats.Bytes / (1024.0 * 1024.0));
+		ImGui::Text("Files loaded: %u - shared: %u - failed: %u - still loading: %u",
+			textureStats.Loads, textureStats.Hits, textureStats.Failures, textureStats.Pending);
+		ImGui::Text("Decoding: %.1f ms over all jobs - created in %u batches", textureStats.DecodeMilliseconds, textureStats.Batches);
+		ImGui::Text("Samplers: %u - shared: %u", samplerManager->GetSamplerCount(), samplerManager->GetHits());
+
+		std::vector<TextureManager::TextureInfo> textureInfo = textureManager->GetTextureInfo();
+		for (const TextureManager::TextureInfo& texture : textureInfo)
+		{
+			size_t nameStart = texture.Path.find_last_of("/\\");
+			ImGui::Text("%s%s: %ux%u, %u mips - %.0f KB - %u refs",
+				texture.Path.c_str() + (nameStart == std::string::npos ? 0 : nameStart + 1),
+				texture.Desc.Cube ? " (cube)" : "",
+				texture.Desc.Width, texture.Desc.Height, texture.Desc.MipLevels,
+				texture.Bytes / 1024.0,
+				texture.References);
+		}
+	}
+	// Render-side numbers come back through the frame packets, since drawing may be on another thread
+	StateCache::Stats stateStats = latestRenderStats.Binds;
+	ImGui::Text("State binds issued: %u - filtered: %u", stateStats.Issued, stateStats.Filtered);
+	ImGui::Text("Job workers: %u - jobs run: %llu - stolen: %llu",
+		jobSystem->GetWorkerCount(),
+		(unsigned long long)jobSystem->GetJobsRun(),
+		(unsigned long long)jobSystem->GetJobsStolen());
+	if (commandListRecorder->IsSupported())
+	{
+		ImGui::Checkbox("Record draws on worker threads", &parallelRecording);
+		ImGui::Text("Recording contexts: %u - driver command lists: %s",
+			commandListRecorder->GetContextCount(),
+			commandListRecorder->HasDriverCommandLists() ? "yes" : "no");
+		if (parallelRecording)
+		{
+			StateCache::Stats workerStats = latestRenderStats.WorkerBinds;
+			ImGui::Text("Worker binds issued: %u - filtered: %u", workerStats.Issued, workerStats.Filtered);
+		}
+	}
+
+	// Update and drawing can overlap on separate threads, with this many frames in flight
+	bool pipelineChanged = ImGui::Checkbox("Pipelined update/render threads", &pipelineFrames);
+	pipelineChanged |= ImGui::SliderInt("Pipeline depth", &pipelineDepth, 1, 4);
+	if (pipelineChanged)
+	{
+		SetFramePipelining(pipelineFrames, (unsigned int)pipelineDepth);
+	}
+	FramePipeline::Stats pipelineStats = GetFramePipelineStats();
+	if (pipelineFrames && pipelineStats.FrameInterval > 0.0)
+	{
+		ImGui::Text("Latency: %.2f ms - render throughput: %.1f frames/s",
+			pipelineStats.Latency,
+			1000.0 / pipelineStats.FrameInterval);
+		ImGui::Text("Update waited %.2f ms - render waited %.2f ms",
+			pipelineStats.WriterWait,
+			pipelineStats.ReaderWait);
+	}
 	ImGui::End(); // Ends the current window
 
 	//ImGui::Begin("Camera Editor"); // Everything after is part of the window
@@ -586,19 +1250,135 @@ void Game::UpdateImGui(ImGuiIO frameIO)
 	//ImGui::End(); // Ends the current window
 
 	ImGui::Begin("Light Editor");
-	ImGui::Text("Point Light Positions");
-	ImGui::SliderFloat3("Point Light Position 1", &pl1.Position.x, -10.0f, 10.0f);
-	ImGui::SliderFloat3("Point Light Position 2", &pl2.Position.x, -10.0f, 10.0f);
-	ImGui::Text("Point Light Colors");
-	ImGui::SliderFloat3("Point Light Color 1", &pl1.Color.x, 0.0f, 1.0f);
-	ImGui::SliderFloat3("Point Light Color 2", &pl2.Color.x, 0.0f, 1.0f);
-	ImGui::Text("Point Light Ranges");
-	ImGui::SliderFloat("Point Light 1", &pl1.Range, 0.0f, 100.0f);
-	ImGui::SliderFloat("Point Light 2", &pl2.Range, 0.0f, 100.0f);
-	ImGui::Text("Directional Light Colors");
-	ImGui::SliderFloat3("Directional Light Color 1", &dir1.Color.x, 0.0f, 1.0f);
-	ImGui::SliderFloat3("Directional Light Color 2", &dir2.Color.x, 0.0f, 1.0f);
-	ImGui::SliderFloat3("Directional Light Color 3", &dir3.Color.x, 0.0f, 1.0f);
+	ImGui::Text("Lights: %u (buffer holds %u)", lightManager->GetLightCount(), latestRenderStats.LightCapacity);
+
+	// Scatter (or remove) point lights to see how culling scales
+	if (ImGui::SliderInt("Point lights", &pointLightTarget, 0, 4096, "%d", ImGuiSliderFlags_Logarithmic))
+	{
+		unsigned int pointLights = 0;
+		for (unsigned int i = 0; i < lightManager->GetLightCount(); i++)
+		{
+			if (lightManager->GetLight(i).Type == LIGHT_TYPE_POINT)
+				pointLights++;
+		}
+		for (unsigned int i = lightManager->GetLightCount(); i > 0 && pointLights > (unsigned int)pointLightTarget; i--)
+		{
+			if (lightManager->GetLight(i - 1).Type == LIGHT_TYPE_POINT)
+			{
+				lightManager->RemoveLight(i - 1);
+				pointLights--;
+			}
+		}
+		for (; pointLights < (unsigned int)pointLightTarget; pointLights++)
+		{
+			Light light = {};
+			light.Type = LIGHT_TYPE_POINT;
+			light.Position = DirectX::XMFLOAT3(
+				(float)rand() / RAND_MAX * 20.0f - 10.0f,
+				(float)rand() / RAND_MAX * 10.0f - 5.0f,
+				(float)rand() / RAND_MAX * 20.0f - 10.0f);
+			light.Range = 2.0f;
+			light.Color = DirectX::XMFLOAT3(
+				(float)rand() / RAND_MAX,
+				(float)rand() / RAND_MAX,
+				(float)rand() / RAND_MAX);
+			light.Intensity = 1.0f;
+			lightManager->AddLight(light);
+		}
+	}
+
+	// Culling
+	ImGui::Checkbox("Software occlusion culling", &occlusionCulling);
+	if (occlusionCulling)
+	{
+		ImGui::Text("Occlusion: %u items culled - %u occluder triangles - %.3f ms",
+			latestRenderStats.OcclusionCulled,
+			latestRenderStats.OccluderTriangles,
+			latestRenderStats.OcclusionTime);
+	}
+	ImGui::Checkbox("GPU-driven culling and indirect draws", &gpuDrivenDraws);
+	if (gpuDrivenDraws)
+	{
+		ImGui::Text("Indirect: %u draws for %u instances",
+			latestRenderStats.IndirectDraws,
+			latestRenderStats.IndirectInstances);
+	}
+	ImGui::Checkbox("Depth prepass", &depthPrepass);
+	ImGui::Checkbox("Cull lights on the GPU", &gpuClusterCulling);
+	if (gpuClusterCulling)
+		ImGui::Checkbox("Validate against the CPU (stalls)", &validateClusters);
+	if (latestRenderStats.ClusterCullTime > 0.0)
+	{
+		ImGui::Text("CPU cull: %.3f ms on %u threads - overfull clusters: %u",
+			latestRenderStats.ClusterCullTime,
+			jobSystem->GetWorkerCount() + 1,
+			latestRenderStats.ClusterOverflows);
+	}
+	if (latestRenderStats.ClusterValidated)
+		ImGui::Text("Clusters differing from the CPU: %u", latestRenderStats.ClusterMismatches);
+
+	// Shadows
+	ImGui::SliderInt("Shadow cascades", &shadowCascadeCount, 2, CascadedShadowMap::MaxCascades);
+	ImGui::SliderFloat("Shadow distance", &shadowDistance, 5.0f, 100.0f);
+	ImGui::SliderFloat("Cascade split (uniform - log)", &shadowSplitLambda, 0.0f, 1.0f);
+	const char* filterNames[] = { "Bilinear (2x2)", "3x3 PCF (gather)", "5x5 PCF (gather)" };
+	ImGui::Combo("Shadow filter", &shadowFilterRadius, filterNames, IM_ARRAYSIZE(filterNames));
+	ImGui::Checkbox("Animate objects", &animateObjects);
+	ImGui::Checkbox("Cache static shadow casters", &shadowCaching);
+	if (latestRenderStats.ShadowsReused)
+	{
+		ImGui::Text("Shadows unchanged - last frame's cascades reused");
+	}
+	else
+	{
+		ImGui::Text("Shadow casters drawn: %u - culled: %u%s",
+			latestRenderStats.ShadowDraws,
+			latestRenderStats.ShadowCulled,
+			latestRenderStats.ShadowCacheRebuilt ? " (static cache rebuilt)" : "");
+	}
+	ImGui::Text("Shadow atlas: %u lights, %u tiles - casters drawn: %u - culled: %u",
+		latestRenderStats.AtlasLights,
+		latestRenderStats.AtlasTiles,
+		latestRenderStats.AtlasDraws,
+		latestRenderStats.AtlasCulled);
+
+	// Editing a few thousand lights by hand isn't practical, so only list the first few
+	const unsigned int maxEditableLights = 32;
+	for (unsigned int i = 0; i < lightManager->GetLightCount() && i < maxEditableLights; i++)
+	{
+		Light& light = lightManager->GetLight(i);
+		ImGui::PushID(i);
+		if (light.Type == LIGHT_TYPE_DIRECTIONAL)
+		{
+			if (ImGui::TreeNode("Light", "Directional Light %u", i))
+			{
+				ImGui::SliderFloat3("Direction", &light.Direction.x, -1.0f, 1.0f);
+				ImGui::SliderFloat3("Color", &light.Color.x, 0.0f, 1.0f);
+				ImGui::SliderFloat("Intensity", &light.Intensity, 0.0f, 10.0f);
+				bool castsShadow = light.CastsShadow != 0;
+				if (ImGui::Checkbox("Casts shadow", &castsShadow))
+					light.CastsShadow = castsShadow ? 1 : 0;
+				ImGui::TreePop();
+			}
+		}
+		else if (ImGui::TreeNode("Light", light.Type == LIGHT_TYPE_SPOT ? "Spot Light %u" : "Point Light %u", i))
+		{
+			ImGui::SliderFloat3("Position", &light.Position.x, -10.0f, 10.0f);
+			if (light.Type == LIGHT_TYPE_SPOT)
+			{
+				ImGui::SliderFloat3("Direction", &light.Direction.x, -1.0f, 1.0f);
+				ImGui::SliderFloat("Falloff", &light.SpotFalloff, 1.0f, 128.0f);
+			}
+			ImGui::SliderFloat3("Color", &light.Color.x, 0.0f, 1.0f);
+			ImGui::SliderFloat("Range", &light.Range, 0.0f, 100.0f);
+			ImGui::SliderFloat("Intensity", &light.Intensity, 0.0f, 10.0f);
+			bool castsShadow = light.CastsShadow != 0;
+			if (ImGui::Checkbox("Casts shadow", &castsShadow))
+				light.CastsShadow = castsShadow ? 1 : 0;
+			ImGui::TreePop();
+		}
+		ImGui::PopID();
+	}
 	ImGui::End();
 }
 
@@ -618,21 +1398,47 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	CPU_PROFILE_FUNCTION();
+
 	// This next line following must be done at the very top of Update(),
 	// so that the UI has fresh input data and it knows
 	// a new frame has started!
 	ImGuiIO frameIO = PrepImGui(deltaTime);
 
 	// Actually put the gui on screen
-	UpdateImGui(frameIO);
+	// - Benchmark runs leave it out, so it isn't timed or in the screenshot
+	if (!benchmark)
+		UpdateImGui(frameIO);
 
 	// Update the camera :)
-	camera->Update(deltaTime);
-
-	for (int i = 0; i < renderables.size(); i++)
+	// - Benchmarks follow their path instead of input
+	if (benchmark)
 	{
-		renderables[i]->GetTransform()->Rotate(0.0f, deltaTime * 0.1f, 0.0f);
+		benchmark->BeginFrame();
+		if (benchmark->JustFinished())
+			Quit();
+
+		float position[3];
+		float rotation[3];
+		benchmark->GetCameraPose(position, rotation);
+		camera->SetPose(XMFLOAT3(position), XMFLOAT3(rotation));
 	}
+	else
+	{
+		camera->Update(deltaTime);
+		RecordCameraPath(deltaTime);
+	}
+
+	// Every transform is independent, so spread them over the workers
+	// - Small batches aren't worth a job, so a handful of renderables just run here
+	if (animateObjects) jobSystem->ParallelFor(0, (unsigned int)renderables.size(), 64,
+		[&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+			{
+				renderables[i]->GetTransform()->Rotate(0.0f, deltaTime * 0.1f, 0.0f);
+			}
+		});
 
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::GetInstance().KeyDown(VK_ESCAPE))
@@ -641,16 +1447,257 @@ void Game::Update(float deltaTime, float totalTime)
 		//trf = nullptr;
 		Quit();
 	}
+	// Finish the UI for this frame, so its draw data can be captured with everything else
+	ImGui::Render();
 }
 
 // --------------------------------------------------------
-// Clear the screen, redraw everything, present to the user
+// Runs a repeatable benchmark instead of taking input
+// - Call before Run(), so the first frame is already scripted
+// --------------------------------------------------------
+void Game::EnableBenchmark(const Benchmark::Settings& settings)
+{
+	benchmark = std::make_unique<Benchmark>(settings);
+	SetFixedTimeStep(settings.TimeStep);
+}
+
+// --------------------------------------------------------
+// Captures frames of draw commands to replay later
+// - Call before Run(), so the context is wrapped from the start
+// --------------------------------------------------------
+void Game::EnableCapture(const CommandCapture::Settings& settings)
+{
+	captureSettings = settings;
+}
+
+// --------------------------------------------------------
+// Adds a key to the recorded camera path every quarter
+// second, while recording
+// --------------------------------------------------------
+void Game::RecordCameraPath(float deltaTime)
+{
+	if (!recordingCameraPath)
+		return;
+
+	if (recordedCameraPath.GetKeyCount() == 0 || cameraPathTime >= recordedCameraPath.GetDuration() + 0.25f)
+	{
+		Transform cameraTransform = camera->GetTransform();
+		XMFLOAT3 position = cameraTransform.GetPosition();
+		XMFLOAT3 rotation = cameraTransform.GetPitchYawRoll();
+
+		CameraPath::Key key = {};
+		key.Time = cameraPathTime;
+		key.Position[0] = position.x;
+		key.Position[1] = position.y;
+		key.Position[2] = position.z;
+		key.Rotation[0] = rotation.x;
+		key.Rotation[1] = rotation.y;
+		key.Rotation[2] = rotation.z;
+		recordedCameraPath.AddKey(key);
+	}
+	cameraPathTime += deltaTime;
+}
+
+// --------------------------------------------------------
+// Hashes the benchmark's final frame and saves it as an
+// image, for comparing runs
+// --------------------------------------------------------
+void Game::SaveScreenshot(const unsigned char* pixels, unsigned int rowPitch, unsigned int width, unsigned int height)
+{
+	// Row by row, since rows can be padded (four bytes a pixel, as the back buffer is RGBA8)
+	screenshotHash = Benchmark::HashSeed;
+	for (unsigned int y = 0; y < height; y++)
+		screenshotHash = Benchmark::Hash(pixels + (size_t)y * rowPitch, (size_t)width * 4, screenshotHash);
+	screenshotCaptured = true;
+
+	WritePpm(benchmark->GetSettings().ScreenshotFile, pixels, rowPitch, width, height);
+}
+
+// --------------------------------------------------------
+// Reads the back buffer right away, through a staging copy
+// - Stalls until the GPU is done, so only for benchmarks
+//   that aren't reading frames back already
+// --------------------------------------------------------
+void Game::ReadBackBuffer()
+{
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> backBuffer = GetBackBuffer();
+	if (!backBuffer)
+		return;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	backBuffer->GetDesc(&desc);
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	desc.MiscFlags = 0;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> staging;
+	if (FAILED(device->CreateTexture2D(&desc, 0, staging.GetAddressOf())))
+		return;
+
+	context->CopyResource(staging.Get(), backBuffer.Get());
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(staging.Get(), 0, D3D11_MAP_READ, 0, &mapped)))
+		return;
+
+	SaveScreenshot((const unsigned char*)mapped.pData, mapped.RowPitch, desc.Width, desc.Height);
+	context->Unmap(staging.Get(), 0);
+}
+
+// --------------------------------------------------------
+// Frames read back through DXCore's ring - the benchmark's
+// final frame is the only one kept
+// --------------------------------------------------------
+void Game::OnFrameReadback(uint64_t frame, const unsigned char* pixels, unsigned int rowPitch, unsigned int width, unsigned int height)
+{
+	if (!benchmark)
+		return;
+
+	const Benchmark::Settings& settings = benchmark->GetSettings();
+	if (frame == (uint64_t)settings.WarmUpFrames + settings.Frames - 1)
+		SaveScreenshot(pixels, rowPitch, width, height);
+}
+
+// --------------------------------------------------------
+// Writes the benchmark's results once every frame is drawn
+// --------------------------------------------------------
+void Game::OnLoopExit()
+{
+	if (!benchmark)
+		return;
+
+	// GPU time per pass, averaged over the last frames measured
+	for (unsigned int i = 0; i < benchmarkGpuProfile.ScopeCount; i++)
+	{
+		std::string name = "gpu_" + std::string(benchmarkGpuProfile.Scopes[i].Name) + "_ms";
+		std::replace(name.begin(), name.end(), ' ', '_');
+		benchmark->AddResult(name, benchmarkGpuProfile.Scopes[i].Average);
+	}
+
+	benchmark->WriteResults(screenshotHash, screenshotCaptured);
+}
+
+// --------------------------------------------------------
+// Makes room for the frame packets the pipeline cycles through
+// - Called before the render thread starts, so nothing is reading them
+// --------------------------------------------------------
+void Game::CreateFramePackets(unsigned int count)
+{
+	while (framePackets.size() < count)
+	{
+		framePackets.push_back(std::make_unique<FramePacket>());
+	}
+}
+
+// --------------------------------------------------------
+// Copies everything drawing needs out of the live game
+// state, at the end of Update()
+// --------------------------------------------------------
+void Game::CaptureFrame(unsigned int slot, float deltaTime, float totalTime)
+{
+	CPU_PROFILE_FUNCTION();
+
+	FramePacket& frame = *framePackets[slot];
+
+	// This slot was drawn (and handed back) before we got it, so its stats are complete
+	latestRenderStats = frame.RenderStats;
+
+	frame.DeltaTime = deltaTime;
+	frame.TotalTime = totalTime;
+	frame.ParallelRecording = parallelRecording && !commandCapture;	// Captures read constants serially
+	frame.OcclusionCulling = occlusionCulling;
+	frame.GpuDrivenDraws = gpuDrivenDraws;
+	frame.DepthPrepass = depthPrepass;
+	frame.GpuClusterCulling = gpuClusterCulling;
+	frame.ValidateClusters = validateClusters;
+	frame.ShadowCascadeCount = (unsigned int)shadowCascadeCount;
+	frame.ShadowDistance = shadowDistance;
+	frame.ShadowSplitLambda = shadowSplitLambda;
+	frame.ShadowFilterRadius = shadowFilterRadius;
+	frame.ShadowCaching = shadowCaching;
+
+	// Camera
+	frame.Camera.View = camera->GetView();
+	frame.Camera.Projection = camera->GetProjection();
+	frame.Camera.Position = camera->GetTransform().GetPosition();
+	frame.Camera.FieldOfView = *camera->GetFOV();
+	frame.Camera.AspectRatio = *camera->GetAspectRatio();
+	frame.Camera.NearClip = camera->GetNearClip();
+	frame.Camera.FarClip = camera->GetFarClip();
+
+	// Renderables - anything that moved recently counts as a dynamic caster
+	// - A renderable that settles joins the static set after StaticCasterFrames
+	// - New renderables start out dynamic
+	casterVersions.resize(renderables.size(), 0);
+	casterRestFrames.resize(renderables.size(), 0);
+	frame.DrawItems.resize(renderables.size());
+	for (unsigned int i = 0; i < renderables.size(); i++)
+	{
+		unsigned int version = renderables[i]->GetTransform()->GetVersion();
+		if (version != casterVersions[i])
+		{
+			casterVersions[i] = version;
+			casterRestFrames[i] = 0;
+		}
+		else if (casterRestFrames[i] < StaticCasterFrames)
+		{
+			casterRestFrames[i]++;
+		}
+
+		FrameDrawItem& item = frame.DrawItems[i];
+		item.RenderableIndex = i;
+		item.World = renderables[i]->GetTransform()->GetWorldMatrix();
+		item.WorldInvTrans = renderables[i]->GetTransform()->GetWorldInverseTransposeMatrix();
+		item.DynamicCaster = casterRestFrames[i] < StaticCasterFrames;
+	}
+
+	// Versions only ever go up, so the sum changes whenever any transform does
+	// - The count is folded in too, in case renderables come or go
+	// - The static version hashes which renderables are static (and their
+	//   versions), so joining or leaving the static set changes it too
+	frame.CasterVersion = (uint64_t)renderables.size() << 48;
+	frame.StaticCasterVersion = 14695981039346656037ull;
+	for (unsigned int i = 0; i < renderables.size(); i++)
+	{
+		frame.CasterVersion += casterVersions[i];
+		if (!frame.DrawItems[i].DynamicCaster)
+		{
+			frame.StaticCasterVersion = (frame.StaticCasterVersion ^ i) * 1099511628211ull;
+			frame.StaticCasterVersion = (frame.StaticCasterVersion ^ casterVersions[i]) * 1099511628211ull;
+		}
+	}
+
+	// Lights
+	frame.AmbientLight = ambientLight;
+	frame.Lights = lightManager->GetLights();
+
+	// The UI - a pipelined frame outlives ImGui's draw data, so it needs a copy
+	frame.CaptureGui(benchmark ? 0 : ImGui::GetDrawData(), IsFramePipelined());
+	frame.CaptureScreenshot = benchmark && benchmark->IsFinalFrame();
+}
+
+// --------------------------------------------------------
+// Draws a frame right after updating it (not pipelined)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	CaptureFrame(0, deltaTime, totalTime);
+	DrawFrame(0);
+}
+
+// --------------------------------------------------------
+// Clear the screen, redraw everything, present to the user
+// - Only reads the frame packet and things that don't change
+//   after loading, so this can run on the render thread
+// --------------------------------------------------------
+void Game::DrawFrame(unsigned int slot)
+{
+	CPU_PROFILE_FUNCTION();
+
+	FramePacket& frame = *framePackets[slot];
+
 	// Frame START
 	// - These things should happen ONCE PER FRAME
-	// - At the beginning of Game::Draw() before drawing *anything*
+	// - At the beginning of Game::DrawFrame() before drawing *anything*
 	{
 		// Clear the back buffer (erases what's on the screen)
 		const float bgColor[4] = { 0.4f, 0.6f, 0.75f, 1.0f }; // Cornflower Blue
@@ -658,56 +1705,154 @@ void Game::Draw(float deltaTime, float totalTime)
 
 		// Clear the depth buffer (resets per-pixel occlusion information)
 		context->ClearDepthStencilView(depthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+
+		// Textures that finished decoding go up together, and replace their stand-ins
+		textureManager->CreatePendingTextures();
+
+		// Reclaim constant buffer space from frames the GPU has finished
+		constantBufferRing->BeginFrame();
+
+		// Start counting this frame's state changes
+		stateCache->BeginFrame();
+
+		// Start timing this frame's passes
+		gpuProfiler->BeginFrame();
+
+		// Capture this frame if it's in the captured range
+		if (commandCapture &&
+			capturedFrameIndex >= captureSettings.FirstFrame &&
+			capturedFrameIndex < captureSettings.FirstFrame + captureSettings.Frames)
+			commandCapture->BeginFrame();
 	}
 
-	for (int i = 0; i < renderables.size(); i++)
-	{
-		// All the renderables get the ambient light cast onto their pixel shader
-		renderables[i]->GetMaterial()->GetPS()->SetFloat3("ambientLight", ambientLight);
-		// They also get the directional light
-		renderables[i]->GetMaterial()->GetPS()->SetData(
-			"directionalLight1",
-			&dir1,
-			sizeof(Light)
-		);
-		renderables[i]->GetMaterial()->GetPS()->SetData(
-			"directionalLight2",
-			&dir2,
-			sizeof(Light)
-		);
-		renderables[i]->GetMaterial()->GetPS()->SetData(
-			"directionalLight3",
-			&dir3,
-			sizeof(Light)
-		);
-		renderables[i]->GetMaterial()->GetPS()->SetData(
-			"pointLight1",
-			&pl1,
-			sizeof(Light)
-		);
-		renderables[i]->GetMaterial()->GetPS()->SetData(
-			"pointLight2",
-			&pl2,
-			sizeof(Light)
-		);
-		renderables[i]->Draw(context, camera, totalTime);
-	}
-
-	sky->Draw(context, camera);
+	// Every light goes up in one upload, then gets sorted into clusters
+	{
+		GpuProfileScope scope(*gpuProfiler, "Light culling");
+		CullLights(frame);
+	}
+
+	// Shadows for the light that casts them
+	{
+		GpuProfileScope scope(*gpuProfiler, "Shadows");
+		{
+			GpuProfileScope cascadeScope(*gpuProfiler, "Cascades");
+			RenderShadowMap(frame);
+		}
+		{
+			GpuProfileScope atlasScope(*gpuProfiler, "Atlas");
+			RenderShadowAtlas(frame);
+		}
+	}
+
+	// Default render states for the main pass
+	// - Other passes (like the sky) leave their own states bound
+	stateCache->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	stateCache->RSSetState(0);
+	stateCache->OMSetDepthStencilState(0, 0);
+
+	// Lights, cluster lists and shadows stay bound for the whole pass
+	BindLightBuffers(stateCache);
+
+	// Sort what we're drawing, then draw it on this thread or record it on the workers
+	// - Anything hidden behind the occluders is left out
+	CullOccludedItems(frame);
+	if (frame.GpuDrivenDraws)
+	{
+		PrepareIndirectDraws(frame);
+	}
+	else
+	{
+		renderQueue.Clear();
+		for (unsigned int i = 0; i < frame.DrawItems.size(); i++)
+		{
+			if (itemVisible[i])
+				renderQueue.Add(renderableSortKeys[frame.DrawItems[i].RenderableIndex], i);
+		}
+		renderQueue.Sort();
+	}
+
+	// Lay down depth first, so the main pass only shades what ends up on screen
+	if (frame.DepthPrepass)
+	{
+		GpuProfileScope scope(*gpuProfiler, "Depth prepass");
+		DrawDepthPrepass(frame);
+		stateCache->OMSetDepthStencilState(depthEqualState.Get(), 0);
+	}
+
+	{
+		GpuProfileScope scope(*gpuProfiler, "Main pass");
+		if (frame.GpuDrivenDraws)
+		{
+			DrawRenderablesIndirect(frame);
+		}
+		else if (!frame.ParallelRecording || !DrawRenderablesParallel(frame))
+		{
+			DrawRenderablesSerial(frame);
+		}
+	}
+
+	{
+		GpuProfileScope scope(*gpuProfiler, "Sky");
+		sky->Draw(renderContext.get(), frame.Camera.View, frame.Camera.Projection);
+	}
 
 	// The GUI should be the LAST thing drawn before ending the frame!
-	// Draw ImGui
-	ImGui::Render();
-	ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+	// Draw ImGui (ImGui::Render() already happened at the end of Update())
+	if (frame.GetGuiDrawData())
+	{
+		GpuProfileScope scope(*gpuProfiler, "ImGui");
+		ImGui_ImplDX11_RenderDrawData(frame.GetGuiDrawData());
+	}
+
+	// End the capture - ImGui drew straight through D3D11, so it isn't in it
+	if (commandCapture && commandCapture->IsCapturing())
+	{
+		commandCapture->EndFrame();
+		if (capturedFrameIndex + 1 == captureSettings.FirstFrame + captureSettings.Frames)
+		{
+			unsigned int frames = commandCapture->GetFrameCount();
+			size_t bytes = commandCapture->GetCaptureSize();
+			if (commandCapture->Save(captureSettings.File))
+				printf("Captured %u frames (%zu bytes) to %s\n", frames, bytes, captureSettings.File.c_str());
+			else
+				printf("Couldn't write capture to %s\n", captureSettings.File.c_str());
+		}
+	}
+	if (commandCapture)
+		capturedFrameIndex++;
+
+	// Report back before the cache forgets this frame's counts
+	frame.RenderStats.Binds = stateCache->GetFrameStats();
+	frame.RenderStats.WorkerBinds = commandListRecorder->GetLastFrameStats();
+
+	// GPU times come from a few frames back, whenever they're ready
+	gpuProfiler->EndFrame();
+	frame.RenderStats.GpuProfile = gpuProfiler->GetResults();
+
+	// ImGui binds its own state directly on the context
+	stateCache->Invalidate();
 
 	// Frame END
 	// - These should happen exactly ONCE PER FRAME
 	// - At the very end of the frame (after drawing *everything*)
 	{
+		// Fence off this frame's constant buffer slices
+		constantBufferRing->EndFrame();
+
+		// Benchmarks check what the final frame looks like, before
+		// presenting discards it - unless it's being read back anyway
+		if (frame.CaptureScreenshot)
+		{
+			if (!HasFrameReadback())
+				ReadBackBuffer();
+			benchmarkGpuProfile = frame.RenderStats.GpuProfile;
+		}
+
 		// Present the back buffer to the user
 		//  - Puts the results of what we've drawn onto the window
 		//  - Without this, the user never sees anything
-		swapChain->Present(vsync ? 1 : 0, 0);
+		//  - Also reads it back, if DXCore was asked to
+		PresentFrame();
 
 		// Must re-bind buffers after presenting, as they become unbound
 		context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthBufferDSV.Get());
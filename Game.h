@@ -10,10 +10,33 @@
 #include "Renderable.h"
 #include "Camera.h"
 #include "SimpleShader.h"
+#include "ConstantBufferRing.h"
+#include "StateCache.h"
+#include "D3D11StateCacheBackend.h"
+#include "D3D11RenderDevice.h"
+#include "RenderQueue.h"
+#include "CommandListRecorder.h"
+#include "JobSystem.h"
+#include "FramePacket.h"
 #include "Material.h"
 #include "Light.h"
-#include "WICTextureLoader.h"
+#include "LightManager.h"
+#include "ClusterGrid.h"
+#include "ClusterLightCuller.h"
+#include "CascadedShadowMap.h"
+#include "ShadowAtlas.h"
+#include "OcclusionCuller.h"
+#include "IndirectRenderer.h"
+#include "GpuProfiler.h"
+#include "D3D11GpuTimer.h"
+#include "CpuProfiler.h"
+#include "TextureManager.h"
+#include "SamplerManager.h"
 #include "Sky.h"
+#include "DemoScene.h"
+#include "Benchmark.h"
+#include "CameraPath.h"
+#include "CommandCapture.h"
 // Not including the ImGui headers here because they are in DXCore.h,
 // which this includes and inherits from <3.
 
@@ -32,24 +55,50 @@ public:
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 
+	// Pipelined frames - see DXCore
+	void CreateFramePackets(unsigned int count);
+	void CaptureFrame(unsigned int slot, float deltaTime, float totalTime);
+	void DrawFrame(unsigned int slot);
+	void OnLoopExit();
+	void OnFrameReadback(uint64_t frame, const unsigned char* pixels, unsigned int rowPitch, unsigned int width, unsigned int height);
+
+	// Runs a fixed, repeatable benchmark instead of taking input - call before Run()
+	void EnableBenchmark(const Benchmark::Settings& settings);
+
+	// Writes a few frames of draw commands to a file for replaying - call before Run()
+	void EnableCapture(const CommandCapture::Settings& settings);
+
 private:
 
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
 	void LoadShaders(); 
-	void LoadTexturesAndCreateMaterials();
-	void CreateGeometry();
-	void CreateRenderables();
-	void SetupTransforms();
+	void CreateScene();
 	void CreateShadowMapResources();
 	void InitLighting();
 
 	// Other helper methods
-	void RenderShadowMap();
+	void RenderShadowMap(FramePacket& frame);
+	void DrawShadowCasters(FramePacket& frame, unsigned int cascadeIndex, bool drawStatic, bool drawDynamic);
+	void RenderShadowAtlas(FramePacket& frame);
+	void CullOccludedItems(FramePacket& frame);
+	void SetLightData(std::shared_ptr<RenderShader> shader, const FramePacket& frame);
+	void CullLights(FramePacket& frame);
+	void BindLightBuffers(std::shared_ptr<StateCache> cache);
+	void DrawRenderablesSerial(const FramePacket& frame);
+	bool DrawRenderablesParallel(const FramePacket& frame);
+	void PrepareIndirectDraws(FramePacket& frame);
+	void DrawRenderablesIndirect(FramePacket& frame);
+	void DrawDepthPrepass(const FramePacket& frame);
 
 	// ImGui helper methods
 	ImGuiIO PrepImGui(float deltaTime);
 	void UpdateImGui(ImGuiIO frameIO);
 
+	// Benchmark helpers
+	void RecordCameraPath(float deltaTime);
+	void ReadBackBuffer();
+	void SaveScreenshot(const unsigned char* pixels, unsigned int rowPitch, unsigned int width, unsigned int height);
+
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
 	//     Component Object Model, which DirectX objects do
@@ -65,47 +114,150 @@ private:
 	std::shared_ptr<SimplePixelShader> fps;
 	std::shared_ptr<SimpleVertexShader> skyVS;
 	std::shared_ptr<SimplePixelShader> skyPS;
+	std::shared_ptr<SimpleComputeShader> clusterCullCS;
+	std::shared_ptr<SimpleVertexShader> indirectVS;
+	std::shared_ptr<SimpleComputeShader> instanceCullCS;
+
+	// Shared dynamic buffer that all of the above upload their constants into
+	std::shared_ptr<ConstantBufferRing> constantBufferRing;
+
+	// Worker threads for updating, loading and recording in parallel
+	std::shared_ptr<JobSystem> jobSystem;
+
+	// Everything we draw binds its state through this, so redundant binds are dropped
+	std::shared_ptr<StateCache> stateCache;
+
+	// Meshes, materials and the sky create and draw through these rather than D3D11 directly
+	std::shared_ptr<D3D11RenderDevice> renderDevice;
+	std::shared_ptr<RenderContext> renderContext;
+
+	// Captures go between the two, so everything drawn through the context is written down
+	std::shared_ptr<CommandCapture> commandCapture;
+	CommandCapture::Settings captureSettings;
+	unsigned int capturedFrameIndex;
+
+	// Renderables are drawn in sorted order, optionally recorded on worker threads
+	// - Each draw's constants are uploaded on this thread first, and the workers
+	//   only bind the captured ring slices, so they never touch shader data
+	struct DrawRecord
+	{
+		Renderable* Object;
+		RenderConstantBufferRanges VSRanges;
+		RenderConstantBufferRanges PSRanges;
+	};
+	RenderQueue renderQueue;
+	std::vector<uint64_t> renderableSortKeys;
+	std::vector<DrawRecord> drawRecords;
+	std::vector<RenderQueueChunk> drawChunks;
+	std::shared_ptr<CommandListRecorder> commandListRecorder;
+	bool parallelRecording;
+
+	// Software occlusion culling - occluders are rasterized on the CPU,
+	// and draw items hidden behind them never make it into the queue
+	std::shared_ptr<OcclusionCuller> occlusionCuller;
+	std::vector<unsigned char> itemVisible; // Per draw item, this frame
+	bool occlusionCulling;
+
+	// GPU-driven drawing - the GPU culls every instance against the frustum (and
+	// the occlusion culler's Hi-Z), then each mesh/material bucket is one indirect draw
+	std::shared_ptr<IndirectRenderer> indirectRenderer;
+	std::vector<unsigned int> renderableBuckets;	// Per renderable
+	std::vector<unsigned int> bucketRenderables;	// Per bucket, the first renderable in it
+	std::vector<IndirectRenderer::Instance> indirectInstances;
+	std::vector<IndirectRenderer::Bucket> indirectBuckets;
+	bool gpuDrivenDraws;
+
+	// Depth prepass - everything is drawn depth only first, then the
+	// main pass only shades the pixels whose depth matches exactly
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthEqualState;
+	bool depthPrepass;
+
+	// Times each pass on the GPU, through scopes in DrawFrame()
+	std::shared_ptr<GpuProfiler> gpuProfiler;
+
+	// CPU scopes from every thread (see CpuProfiler.h), summed up for the UI
+	std::vector<CpuProfiler::ThreadSummary> cpuProfile;
+	std::vector<float> recentFrameTimes;
+	int cpuTraceFrames;
+	float cpuScopeOverhead;
+
+	// Frame packets - drawing only ever reads from these, never from live game state
+	std::vector<std::unique_ptr<FramePacket>> framePackets;
+	FrameRenderStats latestRenderStats;
+	bool pipelineFrames;
+	int pipelineDepth;
 
 	// Camera (The)
 	std::shared_ptr<Camera> camera;
+
+	// Benchmark runs - the screenshot and GPU timings come from the
+	// final measured frame, which may be drawn on the render thread
+	std::unique_ptr<Benchmark> benchmark;
+	uint64_t screenshotHash;
+	bool screenshotCaptured;
+	GpuProfiler::Results benchmarkGpuProfile;
+
+	// Recording a camera path for benchmarks to play back
+	CameraPath recordedCameraPath;
+	bool recordingCameraPath;
+	float cameraPathTime;
 	
+	// The scene's meshes, materials, renderables and sky (see DemoScene.h)
+	std::shared_ptr<DemoScene> scene;
+
 	// Sky (The)
 	std::shared_ptr<Sky> sky;
 
-	// Meshes
-	std::vector<std::shared_ptr<Mesh>> meshes;
-
 	// Materials
 	std::vector<std::shared_ptr<Material>> materials;
-	std::shared_ptr<Material> mat1;
-	std::shared_ptr<Material> mat2;
-	//std::shared_ptr<Material> mat3;
-	//std::shared_ptr<Material> mat4;
+	// Every file and sampler is loaded once, and shared by whatever uses it
+	// - Textures decode on the job system, and are swapped in as they arrive
+	std::shared_ptr<TextureManager> textureManager;
+	std::shared_ptr<SamplerManager> samplerManager;
 
 	// Renderables
 	std::vector<std::shared_ptr<Renderable>> renderables;
 
-	// Transforms
-	// - This is uniquely a vector of plain pointers, because renderables return pointers to their transforms
-	std::vector<Transform*> transforms;
-
 	// Lighting
 	DirectX::XMFLOAT3 ambientLight;
-	Light dir1;
-	Light dir2;
-	Light dir3;
-	Light pl1;
-	Light pl2;
-
-	// Shadows
-	int shadowMapResolution;
-	float shadowProjectionSize;
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowSRV;
-	Microsoft::WRL::ComPtr<ID3D11SamplerState> shadowSampler;
-	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowRasterizer;
-	DirectX::XMFLOAT4X4 shadowViewMatrix;
-	DirectX::XMFLOAT4X4 shadowProjectionMatrix;
+	std::shared_ptr<LightManager> lightManager;
+	unsigned int lightBufferSlot;
+	int pointLightTarget;
+
+	// Clustered light culling - point lights are only shaded by the clusters they reach
+	// - The render side reorders the lights so directional ones come first
+	ClusterGrid clusterGrid;
+	std::shared_ptr<ClusterLightCuller> clusterCuller;
+	DirectX::XMFLOAT4 clusterProjection; // FOV, aspect, near, far the grid was built for
+	std::vector<Light> renderLights;
+	unsigned int directionalLightCount;
+	unsigned int clusterCountSlot;
+	unsigned int clusterIndexSlot;
+	bool gpuClusterCulling;
+	bool validateClusters;
+
+	// Shadows - cascades for the first directional light that casts them
+	std::shared_ptr<CascadedShadowMap> shadowMap;
 	std::shared_ptr<SimpleVertexShader> shadowVS;
+	int shadowLightIndex; // In the render side's light order, or -1
+	unsigned int shadowMapSlot;
+	unsigned int shadowSamplerSlot;
+	int shadowCascadeCount;
+	float shadowDistance;
+	float shadowSplitLambda;
+	int shadowFilterRadius;
+	bool animateObjects;
+
+	// Shadows for point and spot lights, packed into one atlas
+	std::shared_ptr<ShadowAtlas> shadowAtlas;
+	unsigned int shadowAtlasSlot;
+	unsigned int shadowTileSlot;
+
+	// Shadow caching - casters that haven't moved for a while are
+	// drawn once into a cache, and only the rest are drawn each frame
+	static const unsigned int StaticCasterFrames = 30;
+	bool shadowCaching;
+	std::vector<unsigned int> casterVersions;	// Per renderable, as of the last capture
+	std::vector<unsigned int> casterRestFrames;	// Per renderable, captures since it last moved
 };
 
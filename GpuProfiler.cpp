@@ -0,0 +1,241 @@
+#include "GpuProfiler.h"
+
+#include <string.h>
+
+// --------------------------------------------------------
+// Constructor
+//
+// backend - Must have FrameLatency slots of MaxScopes * 2
+//           timestamps each
+// --------------------------------------------------------
+GpuProfiler::GpuProfiler(std::shared_ptr<GpuTimerBackend> backend)
+	:
+	backend(backend),
+	frames(),
+	writeSlot(0),
+	depth(0),
+	frameScope(-1),
+	inFrame(false),
+	results()
+{
+}
+
+// --------------------------------------------------------
+// Starts a frame in the next slot of the ring
+//
+// If that slot's frame still isn't back, it's given up on,
+// since its queries are about to be reused
+// --------------------------------------------------------
+void GpuProfiler::BeginFrame()
+{
+	if (!IsSupported() || inFrame)
+		return;
+
+	FrameRecord& frame = frames[writeSlot];
+	if (frame.Pending)
+	{
+		frame.Pending = false;
+		results.FramesDropped++;
+	}
+
+	frame.ScopeCount = 0;
+	frame.TimestampCount = 0;
+	depth = 0;
+	inFrame = true;
+	backend->BeginFrame(writeSlot);
+	frameScope = BeginScope("Frame");
+}
+
+// --------------------------------------------------------
+// Ends the frame (and any scopes left open), then reads
+// back every frame the GPU has finished since last time
+// --------------------------------------------------------
+void GpuProfiler::EndFrame()
+{
+	if (!inFrame)
+		return;
+
+	// Innermost first, so the depths unwind properly
+	FrameRecord& frame = frames[writeSlot];
+	for (int s = (int)frame.ScopeCount - 1; s >= 0; s--)
+	{
+		if (!frame.Scopes[s].Ended)
+			EndScope(s);
+	}
+
+	backend->EndFrame(writeSlot);
+	frame.Pending = true;
+	inFrame = false;
+	frameScope = -1;
+	writeSlot = (writeSlot + 1) % FrameLatency;
+
+	ReadBackFinished();
+}
+
+// --------------------------------------------------------
+// Opens a scope, nested inside whichever are open
+// --------------------------------------------------------
+int GpuProfiler::BeginScope(const char* name)
+{
+	if (!inFrame)
+		return -1;
+
+	FrameRecord& frame = frames[writeSlot];
+	if (frame.ScopeCount == MaxScopes)
+		return -1;
+
+	FrameScope& scope = frame.Scopes[frame.ScopeCount];
+	scope.Name = name;
+	scope.Depth = depth++;
+	scope.BeginTimestamp = frame.TimestampCount++;
+	scope.EndTimestamp = scope.BeginTimestamp;
+	scope.Ended = false;
+	backend->WriteTimestamp(writeSlot, scope.BeginTimestamp);
+	return (int)frame.ScopeCount++;
+}
+
+// --------------------------------------------------------
+// Closes a scope BeginScope() opened
+// --------------------------------------------------------
+void GpuProfiler::EndScope(int scope)
+{
+	if (!inFrame || scope < 0)
+		return;
+
+	FrameRecord& frame = frames[writeSlot];
+	if ((unsigned int)scope >= frame.ScopeCount || frame.Scopes[scope].Ended)
+		return;
+
+	FrameScope& ended = frame.Scopes[scope];
+	ended.EndTimestamp = frame.TimestampCount++;
+	ended.Ended = true;
+	depth--;
+	backend->WriteTimestamp(writeSlot, ended.EndTimestamp);
+}
+
+// --------------------------------------------------------
+// Reads back pending frames, oldest first, stopping at the
+// first one the GPU hasn't finished (later ones won't be
+// finished either)
+// --------------------------------------------------------
+void GpuProfiler::ReadBackFinished()
+{
+	uint64_t ticks[MaxScopes * 2];
+	for (unsigned int i = 0; i < FrameLatency; i++)
+	{
+		unsigned int slot = (writeSlot + i) % FrameLatency;
+		FrameRecord& frame = frames[slot];
+		if (!frame.Pending)
+			continue;
+
+		uint64_t ticksPerSecond = 0;
+		GpuTimerBackend::ReadResult result = backend->ReadFrame(slot, frame.TimestampCount, ticks, &ticksPerSecond);
+		if (result == GpuTimerBackend::NotReady)
+			return;
+
+		frame.Pending = false;
+		if (result == GpuTimerBackend::Ready && ticksPerSecond > 0)
+		{
+			Resolve(frame, ticks, ticksPerSecond);
+			results.FramesResolved++;
+		}
+		else
+		{
+			results.FramesDropped++;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Adds one finished frame to the results
+//
+// - Scopes are matched by name and depth, and a scope that
+//   appears several times in a frame adds up its times
+// - Scopes missing from the frame get a zero sample, and
+//   are forgotten once their whole history is zero
+// - The results are reordered to follow this frame
+// --------------------------------------------------------
+void GpuProfiler::Resolve(const FrameRecord& frame, const uint64_t* ticks, uint64_t ticksPerSecond)
+{
+	double msPerTick = 1000.0 / (double)ticksPerSecond;
+
+	Results previous = results;
+	bool used[MaxScopes] = {};
+	results.ScopeCount = 0;
+
+	// This frame's scopes first, in order, carrying over their histories
+	for (unsigned int s = 0; s < frame.ScopeCount; s++)
+	{
+		const FrameScope& scope = frame.Scopes[s];
+		double ms = 0.0;
+		if (scope.Ended && ticks[scope.EndTimestamp] > ticks[scope.BeginTimestamp])
+			ms = (double)(ticks[scope.EndTimestamp] - ticks[scope.BeginTimestamp]) * msPerTick;
+
+		// Already seen in this frame?
+		ScopeStats* stats = 0;
+		for (unsigned int r = 0; r < results.ScopeCount && !stats; r++)
+		{
+			if (results.Scopes[r].Depth == scope.Depth && strcmp(results.Scopes[r].Name, scope.Name) == 0)
+				stats = &results.Scopes[r];
+		}
+		if (stats)
+		{
+			stats->Latest += (float)ms;
+			continue;
+		}
+
+		stats = &results.Scopes[results.ScopeCount++];
+		*stats = ScopeStats();
+		for (unsigned int p = 0; p < previous.ScopeCount; p++)
+		{
+			if (!used[p] && previous.Scopes[p].Depth == scope.Depth && strcmp(previous.Scopes[p].Name, scope.Name) == 0)
+			{
+				*stats = previous.Scopes[p];
+				used[p] = true;
+				break;
+			}
+		}
+		stats->Name = scope.Name;
+		stats->Depth = scope.Depth;
+		stats->Latest = (float)ms;
+	}
+
+	// Then whatever wasn't in this frame, while there's room
+	unsigned int presentCount = results.ScopeCount;
+	for (unsigned int p = 0; p < previous.ScopeCount && results.ScopeCount < MaxScopes; p++)
+	{
+		if (used[p])
+			continue;
+		results.Scopes[results.ScopeCount] = previous.Scopes[p];
+		results.Scopes[results.ScopeCount].Latest = 0.0f;
+		results.ScopeCount++;
+	}
+
+	// Add the samples, then update each history's stats
+	unsigned int newest = results.HistoryOffset;
+	results.HistoryOffset = (results.HistoryOffset + 1) % HistoryLength;
+	if (results.HistoryCount < HistoryLength)
+		results.HistoryCount++;
+
+	unsigned int kept = 0;
+	for (unsigned int r = 0; r < results.ScopeCount; r++)
+	{
+		ScopeStats& stats = results.Scopes[r];
+		stats.History[newest] = stats.Latest;
+
+		float sum = 0.0f;
+		stats.Peak = 0.0f;
+		for (unsigned int i = 0; i < results.HistoryCount; i++)
+		{
+			float sample = stats.History[(newest + HistoryLength - i) % HistoryLength];
+			sum += sample;
+			if (sample > stats.Peak)
+				stats.Peak = sample;
+		}
+		stats.Average = sum / results.HistoryCount;
+
+		if (stats.Peak > 0.0f || r < presentCount)
+			results.Scopes[kept++] = stats;
+	}
+	results.ScopeCount = kept;
+}
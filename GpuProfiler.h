@@ -0,0 +1,111 @@
+#pragma once
+
+#include <memory>
+#include "GpuTimerBackend.h"
+
+// --------------------------------------------------------
+// Times nested scopes of GPU work, frame after frame
+//
+// - Every scope writes a timestamp at each end, into a ring
+//   of FrameLatency frame slots, so results are read back a
+//   few frames late instead of stalling
+// - Each resolved frame adds a sample to every scope's
+//   rolling history, for averages, peaks and graphs
+// - The whole frame is the outermost scope
+// - Scope names must be string literals (or otherwise
+//   outlive the profiler), since only the pointers are kept
+// - Talks to the GPU only through a GpuTimerBackend
+// --------------------------------------------------------
+class GpuProfiler
+{
+public:
+	static const unsigned int FrameLatency = 4;
+	static const unsigned int MaxScopes = 16;		// Per frame, including the frame itself
+	static const unsigned int HistoryLength = 120;
+
+	// One scope's numbers, in milliseconds
+	struct ScopeStats
+	{
+		const char* Name;
+		unsigned int Depth;				// 0 for the whole frame
+		float Latest;
+		float Average;					// Over the history
+		float Peak;
+		float History[HistoryLength];	// A ring - the oldest sample is at Results::HistoryOffset
+	};
+
+	// Everything known so far, in the order the latest frame opened its scopes
+	struct Results
+	{
+		ScopeStats Scopes[MaxScopes];
+		unsigned int ScopeCount;
+		unsigned int HistoryOffset;
+		unsigned int HistoryCount;		// Samples in the history so far
+		unsigned int FramesResolved;
+		unsigned int FramesDropped;		// Not back in time, or unreliable
+	};
+
+	GpuProfiler(std::shared_ptr<GpuTimerBackend> backend);
+
+	// Bracket everything drawn in a frame
+	void BeginFrame();
+	void EndFrame();
+
+	// Bracket a scope - prefer GpuProfileScope, which can't forget to end it
+	// - Returns -1 (which EndScope() ignores) outside a frame or once the frame is full
+	int BeginScope(const char* name);
+	void EndScope(int scope);
+
+	// Getters
+	const Results& GetResults() { return results; }
+	bool IsSupported() { return backend && backend->IsSupported(); }
+
+private:
+	// One scope, as recorded in one frame
+	struct FrameScope
+	{
+		const char* Name;
+		unsigned int Depth;
+		unsigned int BeginTimestamp;
+		unsigned int EndTimestamp;
+		bool Ended;
+	};
+
+	// One slot of the ring
+	struct FrameRecord
+	{
+		FrameScope Scopes[MaxScopes];
+		unsigned int ScopeCount;
+		unsigned int TimestampCount;
+		bool Pending;		// Issued, not yet read back
+	};
+
+	std::shared_ptr<GpuTimerBackend> backend;
+	FrameRecord frames[FrameLatency];
+	unsigned int writeSlot;
+	unsigned int depth;
+	int frameScope;
+	bool inFrame;
+	Results results;
+
+	void ReadBackFinished();
+	void Resolve(const FrameRecord& frame, const uint64_t* ticks, uint64_t ticksPerSecond);
+};
+
+// --------------------------------------------------------
+// Times everything from its construction to the end of
+// its block
+// --------------------------------------------------------
+class GpuProfileScope
+{
+public:
+	GpuProfileScope(GpuProfiler& profiler, const char* name) : profiler(profiler), scope(profiler.BeginScope(name)) {}
+	~GpuProfileScope() { profiler.EndScope(scope); }
+
+private:
+	GpuProfiler& profiler;
+	int scope;
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+// --------------------------------------------------------
+// What GpuProfiler needs from a graphics API to time work
+//
+// - A fixed number of frame slots, each holding a fixed
+//   number of timestamps, reused round robin
+// - Only tick values and the tick rate cross this line, so
+//   the profiler's bookkeeping doesn't depend on any API
+//   (and can run against a fake backend)
+// --------------------------------------------------------
+class GpuTimerBackend
+{
+public:
+	enum ReadResult { Ready, NotReady, Invalid };
+
+	virtual ~GpuTimerBackend() {}
+
+	virtual bool IsSupported() = 0;
+
+	// Brackets everything timed in a slot
+	virtual void BeginFrame(unsigned int slot) = 0;
+	virtual void EndFrame(unsigned int slot) = 0;
+
+	// Records the GPU's clock once everything before it is done
+	virtual void WriteTimestamp(unsigned int slot, unsigned int index) = 0;
+
+	// Reads a finished slot's first count timestamps without waiting
+	//
+	// Returns NotReady if the GPU isn't done with it yet, and
+	// Invalid if its timestamps can't be trusted (the clock
+	// changed mid-frame, for instance)
+	virtual ReadResult ReadFrame(unsigned int slot, unsigned int count, uint64_t* ticks, uint64_t* ticksPerSecond) = 0;
+};
@@ -0,0 +1,548 @@
+#include "ImageReader.h"
+
+#include <fstream>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --------------------------------------------------------
+// Reads a whole file into memory
+// --------------------------------------------------------
+static bool ReadWholeFile(const std::string& path, std::vector<unsigned char>* data)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+
+	std::streamoff size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	data->resize((size_t)size);
+	file.seekg(0);
+	file.read((char*)data->data(), size);
+	return file.good();
+}
+
+// --------------------------------------------------------
+// Inflate (RFC 1951) - just enough to unpack PNG image data
+//
+// - Huffman codes up to FastBits long decode with a single
+//   table lookup; longer ones walk the canonical code
+// - Reading past the end of the input gives zero bits, and
+//   is caught (as a failure) by Overran()
+// --------------------------------------------------------
+static const unsigned int FastBits = 9;
+
+struct BitReader
+{
+	const unsigned char* Data;
+	size_t Size;
+	size_t Position;	// Next byte to load into Bits
+	uint32_t Bits;		// Loaded but not yet used, lowest bit first
+	unsigned int BitCount;
+};
+
+struct Huffman
+{
+	uint16_t Fast[1 << FastBits];	// (symbol << 4) | code length, or zero for longer codes
+	uint16_t Counts[16];			// Codes of each length
+	uint16_t Symbols[288];			// Ordered by code
+};
+
+static void Refill(BitReader& reader)
+{
+	while (reader.BitCount <= 24)
+	{
+		uint32_t byte = reader.Position < reader.Size ? reader.Data[reader.Position] : 0;
+		reader.Bits |= byte << reader.BitCount;
+		reader.Position++;
+		reader.BitCount += 8;
+	}
+}
+
+static bool Overran(const BitReader& reader)
+{
+	return reader.Position * 8 - reader.BitCount > reader.Size * 8;
+}
+
+static uint32_t GetBits(BitReader& reader, unsigned int count)
+{
+	Refill(reader);
+	uint32_t value = reader.Bits & ((1u << count) - 1);
+	reader.Bits >>= count;
+	reader.BitCount -= count;
+	return value;
+}
+
+// --------------------------------------------------------
+// Builds a decoding table from each symbol's code length
+// - Returns false for lengths that can't make a valid code
+// --------------------------------------------------------
+static bool BuildHuffman(Huffman& huffman, const unsigned char* lengths, unsigned int symbolCount)
+{
+	memset(huffman.Counts, 0, sizeof(huffman.Counts));
+	memset(huffman.Fast, 0, sizeof(huffman.Fast));
+	for (unsigned int s = 0; s < symbolCount; s++)
+		huffman.Counts[lengths[s]]++;
+	huffman.Counts[0] = 0;
+
+	// Too many codes of some length (too few is allowed, for single code trees)
+	int left = 1;
+	for (unsigned int length = 1; length < 16; length++)
+	{
+		left <<= 1;
+		left -= huffman.Counts[length];
+		if (left < 0)
+			return false;
+	}
+
+	// Symbols in code order, and the first code of each length
+	uint16_t offsets[16];
+	uint32_t nextCode[16];
+	offsets[1] = 0;
+	nextCode[1] = 0;
+	for (unsigned int length = 1; length < 15; length++)
+	{
+		offsets[length + 1] = offsets[length] + huffman.Counts[length];
+		nextCode[length + 1] = (nextCode[length] + huffman.Counts[length]) << 1;
+	}
+
+	for (unsigned int s = 0; s < symbolCount; s++)
+	{
+		unsigned int length = lengths[s];
+		if (length == 0)
+			continue;
+		huffman.Symbols[offsets[length]++] = (uint16_t)s;
+
+		// Codes are stored first bit first, so the table is indexed by the reversed code
+		uint32_t code = nextCode[length]++;
+		if (length > FastBits)
+			continue;
+		uint32_t reversed = 0;
+		for (unsigned int b = 0; b < length; b++)
+			reversed |= ((code >> b) & 1) << (length - 1 - b);
+		for (uint32_t fill = reversed; fill < (1u << FastBits); fill += 1u << length)
+			huffman.Fast[fill] = (uint16_t)((s << 4) | length);
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Reads one symbol - returns -1 if no code matches
+// --------------------------------------------------------
+static int Decode(BitReader& reader, const Huffman& huffman)
+{
+	Refill(reader);
+	uint16_t entry = huffman.Fast[reader.Bits & ((1u << FastBits) - 1)];
+	if (entry)
+	{
+		unsigned int length = entry & 15;
+		reader.Bits >>= length;
+		reader.BitCount -= length;
+		return entry >> 4;
+	}
+
+	// Longer codes, a bit at a time (Refill() left at least 25 bits)
+	int code = 0;
+	int first = 0;
+	int index = 0;
+	uint32_t bits = reader.Bits;
+	for (unsigned int length = 1; length < 16; length++)
+	{
+		code |= bits & 1;
+		bits >>= 1;
+		int count = huffman.Counts[length];
+		if (code - count < first)
+		{
+			reader.Bits >>= length;
+			reader.BitCount -= length;
+			return huffman.Symbols[index + (code - first)];
+		}
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+static const uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint16_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint16_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// --------------------------------------------------------
+// Reads the code lengths at the start of a dynamic block
+// --------------------------------------------------------
+static bool ReadDynamicTables(BitReader& reader, Huffman& literals, Huffman& distances)
+{
+	static const unsigned char order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	unsigned int literalCount = GetBits(reader, 5) + 257;
+	unsigned int distanceCount = GetBits(reader, 5) + 1;
+	unsigned int lengthCodeCount = GetBits(reader, 4) + 4;
+	if (literalCount > 286 || distanceCount > 30)
+		return false;
+
+	unsigned char lengths[286 + 30] = {};
+	for (unsigned int i = 0; i < lengthCodeCount; i++)
+		lengths[order[i]] = (unsigned char)GetBits(reader, 3);
+
+	Huffman lengthCodes;
+	if (!BuildHuffman(lengthCodes, lengths, 19))
+		return false;
+
+	memset(lengths, 0, sizeof(lengths));
+	unsigned int count = 0;
+	while (count < literalCount + distanceCount)
+	{
+		int symbol = Decode(reader, lengthCodes);
+		if (symbol < 0 || Overran(reader))
+			return false;
+
+		if (symbol < 16)
+		{
+			lengths[count++] = (unsigned char)symbol;
+			continue;
+		}
+
+		// Runs of the previous length, or of zeros
+		unsigned char value = 0;
+		unsigned int repeat = 0;
+		if (symbol == 16)
+		{
+			if (count == 0)
+				return false;
+			value = lengths[count - 1];
+			repeat = 3 + GetBits(reader, 2);
+		}
+		else if (symbol == 17)
+			repeat = 3 + GetBits(reader, 3);
+		else
+			repeat = 11 + GetBits(reader, 7);
+
+		if (count + repeat > literalCount + distanceCount)
+			return false;
+		while (repeat--)
+			lengths[count++] = value;
+	}
+
+	// A block with no end code could never finish
+	if (lengths[256] == 0)
+		return false;
+
+	return
+		BuildHuffman(literals, lengths, literalCount) &&
+		BuildHuffman(distances, lengths + literalCount, distanceCount);
+}
+
+// --------------------------------------------------------
+// Unpacks a zlib stream into exactly expectedSize bytes
+// - Fails on anything malformed, or any other size
+// --------------------------------------------------------
+static bool Inflate(const unsigned char* data, size_t size, std::vector<unsigned char>* output, size_t expectedSize)
+{
+	// zlib header: deflate, no preset dictionary (the Adler-32 at the end isn't checked)
+	if (size < 2 || (data[0] & 15) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 32))
+		return false;
+
+	BitReader reader = { data + 2, size - 2, 0, 0, 0 };
+	output->resize(expectedSize);
+	unsigned char* out = output->data();
+	size_t written = 0;
+
+	Huffman literals;
+	Huffman distances;
+	bool last = false;
+	while (!last)
+	{
+		last = GetBits(reader, 1) != 0;
+		unsigned int type = GetBits(reader, 2);
+
+		if (type == 0)
+		{
+			// Stored - skip to the next byte boundary
+			GetBits(reader, reader.BitCount & 7);
+			unsigned int length = GetBits(reader, 16);
+			unsigned int inverse = GetBits(reader, 16);
+			if ((length ^ 0xFFFF) != inverse || written + length > expectedSize)
+				return false;
+			for (unsigned int i = 0; i < length; i++)
+				out[written++] = (unsigned char)GetBits(reader, 8);
+			if (Overran(reader))
+				return false;
+			continue;
+		}
+
+		if (type == 1)
+		{
+			// Fixed codes
+			unsigned char lengths[288 + 30];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			memset(lengths + 288, 5, 30);
+			BuildHuffman(literals, lengths, 288);
+			BuildHuffman(distances, lengths + 288, 30);
+		}
+		else if (type != 2 || !ReadDynamicTables(reader, literals, distances))
+		{
+			return false;
+		}
+
+		while (true)
+		{
+			int symbol = Decode(reader, literals);
+			if (symbol < 0 || Overran(reader))
+				return false;
+
+			if (symbol < 256)
+			{
+				if (written == expectedSize)
+					return false;
+				out[written++] = (unsigned char)symbol;
+				continue;
+			}
+			if (symbol == 256)
+				break;
+
+			// A copy from earlier in the output, which may overlap itself
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			size_t length = LengthBase[symbol] + GetBits(reader, LengthExtra[symbol]);
+
+			int distanceSymbol = Decode(reader, distances);
+			if (distanceSymbol < 0 || distanceSymbol >= 30)
+				return false;
+			size_t distance = DistanceBase[distanceSymbol] + GetBits(reader, DistanceExtra[distanceSymbol]);
+			if (distance > written || written + length > expectedSize)
+				return false;
+
+			const unsigned char* from = out + written - distance;
+			for (size_t i = 0; i < length; i++)
+				out[written + i] = from[i];
+			written += length;
+		}
+	}
+
+	return written == expectedSize;
+}
+
+// --------------------------------------------------------
+// PNG's Paeth predictor
+// --------------------------------------------------------
+static unsigned char Paeth(int a, int b, int c)
+{
+	int p = a + b - c;
+	int pa = p > a ? p - a : a - p;
+	int pb = p > b ? p - b : b - p;
+	int pc = p > c ? p - c : c - p;
+	if (pa <= pb && pa <= pc)
+		return (unsigned char)a;
+	return (unsigned char)(pb <= pc ? b : c);
+}
+
+static uint32_t ReadBigEndian(const unsigned char* bytes)
+{
+	return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+// --------------------------------------------------------
+// Reads a PNG into RGBA8 pixels
+//
+// - Chunk CRCs aren't checked; a damaged file fails to
+//   inflate or unfilter instead
+// - 16 bit, sub-byte and interlaced images are rejected
+// --------------------------------------------------------
+bool ReadPng(const std::string& path, std::vector<unsigned char>* pixels, unsigned int* width, unsigned int* height)
+{
+	std::vector<unsigned char> file;
+	if (!ReadWholeFile(path, &file))
+		return false;
+
+	static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	if (file.size() < 8 || memcmp(file.data(), signature, 8) != 0)
+		return false;
+
+	uint32_t imageWidth = 0;
+	uint32_t imageHeight = 0;
+	unsigned int colorType = 0;
+	unsigned char palette[256][4] = {};
+	unsigned int paletteSize = 0;
+	std::vector<unsigned char> compressed;
+
+	size_t position = 8;
+	bool ended = false;
+	while (!ended && position + 12 <= file.size())
+	{
+		uint32_t length = ReadBigEndian(&file[position]);
+		const unsigned char* type = &file[position + 4];
+		const unsigned char* data = &file[position + 8];
+		if (length > file.size() - position - 12)
+			return false;
+
+		if (memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length < 13)
+				return false;
+			imageWidth = ReadBigEndian(data);
+			imageHeight = ReadBigEndian(data + 4);
+			unsigned int bitDepth = data[8];
+			colorType = data[9];
+			unsigned int interlace = data[12];
+			if (bitDepth != 8 || interlace != 0 || data[10] != 0 || data[11] != 0)
+				return false;
+			if (colorType != 0 && colorType != 2 && colorType != 3 && colorType != 4 && colorType != 6)
+				return false;
+		}
+		else if (memcmp(type, "PLTE", 4) == 0)
+		{
+			paletteSize = length / 3 < 256 ? length / 3 : 256;
+			for (unsigned int i = 0; i < paletteSize; i++)
+			{
+				palette[i][0] = data[i * 3 + 0];
+				palette[i][1] = data[i * 3 + 1];
+				palette[i][2] = data[i * 3 + 2];
+				palette[i][3] = 255;
+			}
+		}
+		else if (memcmp(type, "tRNS", 4) == 0 && colorType == 3)
+		{
+			for (unsigned int i = 0; i < length && i < 256; i++)
+				palette[i][3] = data[i];
+		}
+		else if (memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), data, data + length);
+		}
+		else if (memcmp(type, "IEND", 4) == 0)
+		{
+			ended = true;
+		}
+
+		position += 12 + (size_t)length;
+	}
+
+	// Sizes big enough to overflow the maths below aren't real textures
+	if (imageWidth == 0 || imageHeight == 0 || imageWidth > (1u << 16) || imageHeight > (1u << 16))
+		return false;
+	if (colorType == 3 && paletteSize == 0)
+		return false;
+
+	static const unsigned int channelCounts[7] = { 1, 0, 3, 1, 2, 0, 4 };
+	unsigned int channels = channelCounts[colorType];
+	size_t stride = (size_t)imageWidth * channels;
+
+	// Each row starts with its filter type
+	std::vector<unsigned char> filtered;
+	if (!Inflate(compressed.data(), compressed.size(), &filtered, (stride + 1) * imageHeight))
+		return false;
+
+	// Unfilter in place - "up" is the row above, already unfiltered
+	std::vector<unsigned char> zeroRow(stride, 0);
+	for (uint32_t y = 0; y < imageHeight; y++)
+	{
+		unsigned char* row = &filtered[y * (stride + 1) + 1];
+		const unsigned char* up = y > 0 ? row - (stride + 1) : zeroRow.data();
+		unsigned int filter = row[-1];
+		for (size_t i = 0; i < stride; i++)
+		{
+			int a = i >= channels ? row[i - channels] : 0;
+			int b = up[i];
+			int c = i >= channels ? up[i - channels] : 0;
+			switch (filter)
+			{
+			case 0: break;
+			case 1: row[i] = (unsigned char)(row[i] + a); break;
+			case 2: row[i] = (unsigned char)(row[i] + b); break;
+			case 3: row[i] = (unsigned char)(row[i] + ((a + b) >> 1)); break;
+			case 4: row[i] = (unsigned char)(row[i] + Paeth(a, b, c)); break;
+			default: return false;
+			}
+		}
+	}
+
+	pixels->resize((size_t)imageWidth * imageHeight * 4);
+	for (uint32_t y = 0; y < imageHeight; y++)
+	{
+		const unsigned char* row = &filtered[y * (stride + 1) + 1];
+		unsigned char* dest = pixels->data() + (size_t)y * imageWidth * 4;
+		for (uint32_t x = 0; x < imageWidth; x++, dest += 4)
+		{
+			const unsigned char* source = row + (size_t)x * channels;
+			switch (colorType)
+			{
+			case 0: dest[0] = dest[1] = dest[2] = source[0]; dest[3] = 255; break;
+			case 2: dest[0] = source[0]; dest[1] = source[1]; dest[2] = source[2]; dest[3] = 255; break;
+			case 3: memcpy(dest, palette[source[0]], 4); break;
+			case 4: dest[0] = dest[1] = dest[2] = source[0]; dest[3] = source[1]; break;
+			case 6: memcpy(dest, source, 4); break;
+			}
+		}
+	}
+
+	*width = imageWidth;
+	*height = imageHeight;
+	return true;
+}
+
+// --------------------------------------------------------
+// Reads a binary PPM, like the ones WritePpm() makes
+// --------------------------------------------------------
+bool ReadPpm(const std::string& path, std::vector<unsigned char>* pixels, unsigned int* width, unsigned int* height)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	// The header is four whitespace separated values, and may have comments
+	std::string values[4];
+	for (int i = 0; i < 4; i++)
+	{
+		while (true)
+		{
+			int c = file.peek();
+			if (c == '#')
+				file.ignore(1 << 16, '\n');
+			else if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+				file.get();
+			else
+				break;
+		}
+		file >> values[i];
+	}
+	if (!file.good() || values[0] != "P6")
+		return false;
+
+	unsigned int imageWidth = (unsigned int)strtoul(values[1].c_str(), 0, 10);
+	unsigned int imageHeight = (unsigned int)strtoul(values[2].c_str(), 0, 10);
+	if (imageWidth == 0 || imageHeight == 0 || imageWidth > (1u << 16) || imageHeight > (1u << 16) || values[3] != "255")
+		return false;
+
+	// Exactly one whitespace character before the pixels
+	file.get();
+
+	std::vector<unsigned char> row((size_t)imageWidth * 3);
+	pixels->resize((size_t)imageWidth * imageHeight * 4);
+	for (unsigned int y = 0; y < imageHeight; y++)
+	{
+		file.read((char*)row.data(), row.size());
+		unsigned char* dest = pixels->data() + (size_t)y * imageWidth * 4;
+		for (unsigned int x = 0; x < imageWidth; x++)
+		{
+			dest[x * 4 + 0] = row[x * 3 + 0];
+			dest[x * 4 + 1] = row[x * 3 + 1];
+			dest[x * 4 + 2] = row[x * 3 + 2];
+			dest[x * 4 + 3] = 255;
+		}
+	}
+	if (!file.good())
+		return false;
+
+	*width = imageWidth;
+	*height = imageHeight;
+	return true;
+}
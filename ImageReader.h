@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Readers for the image files the assets and reference images use
+// - Pixels come back as 8 bit RGBA, rows top to bottom, tightly packed
+// - No graphics (or OS) dependencies, so textures can be loaded where
+//   WIC isn't available, like the software renderer on build agents
+
+// PNG - 8 bit grey, grey + alpha, RGB, RGBA and palette images, not interlaced
+// - Grey is copied into red, green and blue; missing alpha is 255
+bool ReadPng(const std::string& path, std::vector<unsigned char>* pixels, unsigned int* width, unsigned int* height);
+
+// Binary PPM (P6), 8 bit - alpha is always 255
+bool ReadPpm(const std::string& path, std::vector<unsigned char>* pixels, unsigned int* width, unsigned int* height);
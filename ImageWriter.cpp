@@ -0,0 +1,30 @@
+#include "ImageWriter.h"
+
+#include <fstream>
+#include <vector>
+
+// --------------------------------------------------------
+// Writes RGBA8 pixels as a binary PPM, one row at a time
+// --------------------------------------------------------
+bool WritePpm(const std::string& path, const unsigned char* pixels, unsigned int rowPitch, unsigned int width, unsigned int height)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	std::vector<unsigned char> row((size_t)width * 3);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const unsigned char* source = pixels + (size_t)y * rowPitch;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			row[x * 3 + 0] = source[x * 4 + 0];
+			row[x * 3 + 1] = source[x * 4 + 1];
+			row[x * 3 + 2] = source[x * 4 + 2];
+		}
+		file.write((const char*)row.data(), row.size());
+	}
+	return file.good();
+}
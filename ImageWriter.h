@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+// Writers for simple, uncompressed images that any viewer or diff tool can read
+// - Pixels are 8 bit RGBA, rows top to bottom, each row rowPitch bytes
+//   apart (which may include padding)
+// - No graphics dependencies
+
+// Binary PPM (P6) - alpha is dropped
+bool WritePpm(const std::string& path, const unsigned char* pixels, unsigned int rowPitch, unsigned int width, unsigned int height);
@@ -0,0 +1,236 @@
+#include "IndirectRenderer.h"
+
+#include <string.h>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Constructor - Buffers are created on first use, sized to
+// whatever the scene needs
+// --------------------------------------------------------
+IndirectRenderer::IndirectRenderer(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	std::shared_ptr<SimpleComputeShader> cullShader)
+	:
+	device(device),
+	cullShader(cullShader),
+	instanceCount(0),
+	instanceCapacity(0),
+	bucketCapacity(0)
+{
+}
+
+// --------------------------------------------------------
+// (Re)creates the instance buffer and the visible list,
+// which always have the same capacity
+// --------------------------------------------------------
+void IndirectRenderer::CreateInstanceBuffers(unsigned int capacity)
+{
+	instanceBuffer.Reset();
+	instanceSRV.Reset();
+	visibleBuffer.Reset();
+	visibleSRV.Reset();
+	visibleUAV.Reset();
+	instanceCapacity = 0;
+
+	// Rewritten every frame
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = sizeof(Instance) * capacity;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	desc.StructureByteStride = sizeof(Instance);
+	if (FAILED(device->CreateBuffer(&desc, 0, instanceBuffer.GetAddressOf())))
+		return;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = capacity;
+	if (FAILED(device->CreateShaderResourceView(instanceBuffer.Get(), &srvDesc, instanceSRV.GetAddressOf())))
+		return;
+
+	// Only ever written by the culling shader
+	desc.ByteWidth = sizeof(unsigned int) * capacity;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	desc.CPUAccessFlags = 0;
+	desc.StructureByteStride = sizeof(unsigned int);
+	if (FAILED(device->CreateBuffer(&desc, 0, visibleBuffer.GetAddressOf())))
+		return;
+	if (FAILED(device->CreateShaderResourceView(visibleBuffer.Get(), &srvDesc, visibleSRV.GetAddressOf())))
+		return;
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.FirstElement = 0;
+	uavDesc.Buffer.NumElements = capacity;
+	if (FAILED(device->CreateUnorderedAccessView(visibleBuffer.Get(), &uavDesc, visibleUAV.GetAddressOf())))
+		return;
+
+	instanceCapacity = capacity;
+}
+
+// --------------------------------------------------------
+// (Re)creates the argument buffer - a plain buffer of uints,
+// so the culling shader can bump the counts atomically
+// --------------------------------------------------------
+void IndirectRenderer::CreateArgsBuffer(unsigned int capacity)
+{
+	argsBuffer.Reset();
+	argsUAV.Reset();
+	bucketCapacity = 0;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = ArgsStride * capacity;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+	if (FAILED(device->CreateBuffer(&desc, 0, argsBuffer.GetAddressOf())))
+		return;
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_R32_UINT;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.FirstElement = 0;
+	uavDesc.Buffer.NumElements = ArgsStride / sizeof(unsigned int) * capacity;
+	if (FAILED(device->CreateUnorderedAccessView(argsBuffer.Get(), &uavDesc, argsUAV.GetAddressOf())))
+		return;
+
+	bucketCapacity = capacity;
+	args.assign(capacity, D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS());
+}
+
+// --------------------------------------------------------
+// Creates a texture for the culler's Hi-Z chain
+//
+// The chain halves each level rounding up, and textures
+// round down, so they only line up for power of two
+// sizes - otherwise there's no texture, and culling falls
+// back to the frustum alone
+// --------------------------------------------------------
+void IndirectRenderer::CreateHiZTexture(OcclusionCuller& culler)
+{
+	for (unsigned int mip = 0; mip < culler.GetMipCount(); mip++)
+	{
+		unsigned int textureWidth = culler.GetWidth() >> mip;
+		unsigned int textureHeight = culler.GetHeight() >> mip;
+		if (culler.GetMipWidth(mip) != (textureWidth > 0 ? textureWidth : 1) ||
+			culler.GetMipHeight(mip) != (textureHeight > 0 ? textureHeight : 1))
+		{
+			return;
+		}
+	}
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = culler.GetWidth();
+	desc.Height = culler.GetHeight();
+	desc.MipLevels = culler.GetMipCount();
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R32_FLOAT;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	if (FAILED(device->CreateTexture2D(&desc, 0, hiZTexture.GetAddressOf())))
+		return;
+	if (FAILED(device->CreateShaderResourceView(hiZTexture.Get(), 0, hiZSRV.GetAddressOf())))
+		hiZTexture.Reset();
+}
+
+// --------------------------------------------------------
+// Copies this frame's instances and resets the draws
+//
+// Each bucket's arguments start with zero instances, and
+// the culling shader counts up from there
+// --------------------------------------------------------
+void IndirectRenderer::Upload(
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const std::vector<Instance>& instances,
+	const std::vector<Bucket>& buckets)
+{
+	instanceCount = 0;
+
+	// Grow by doubling, like the other per-frame buffers
+	unsigned int count = (unsigned int)instances.size();
+	if (count > instanceCapacity || !instanceBuffer)
+	{
+		unsigned int newCapacity = instanceCapacity < 64 ? 64 : instanceCapacity;
+		while (newCapacity < count)
+			newCapacity *= 2;
+		CreateInstanceBuffers(newCapacity);
+	}
+	if (buckets.size() > bucketCapacity || !argsBuffer)
+	{
+		unsigned int newCapacity = bucketCapacity < 16 ? 16 : bucketCapacity;
+		while (newCapacity < buckets.size())
+			newCapacity *= 2;
+		CreateArgsBuffer(newCapacity);
+	}
+	if (instanceCapacity == 0 || bucketCapacity == 0)
+		return;
+
+	for (unsigned int b = 0; b < bucketCapacity; b++)
+	{
+		args[b] = {};
+		if (b < buckets.size())
+			args[b].IndexCountPerInstance = buckets[b].IndexCount;
+	}
+	context->UpdateSubresource(argsBuffer.Get(), 0, 0, args.data(), 0, 0);
+
+	if (count == 0)
+		return;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+	memcpy(mapped.pData, instances.data(), sizeof(Instance) * count);
+	context->Unmap(instanceBuffer.Get(), 0);
+	instanceCount = count;
+}
+
+// --------------------------------------------------------
+// Copies every level of the culler's Hi-Z chain
+// --------------------------------------------------------
+void IndirectRenderer::UploadHiZ(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, OcclusionCuller& culler)
+{
+	if (!hiZTexture)
+		CreateHiZTexture(culler);
+	if (!hiZTexture)
+		return;
+
+	for (unsigned int mip = 0; mip < culler.GetMipCount(); mip++)
+	{
+		context->UpdateSubresource(hiZTexture.Get(), mip, 0, culler.GetMip(mip),
+			sizeof(float) * culler.GetMipWidth(mip), 0);
+	}
+}
+
+// --------------------------------------------------------
+// Dispatches the culling shader - one thread per instance
+// --------------------------------------------------------
+void IndirectRenderer::Cull(
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const XMFLOAT4X4& viewProjection,
+	bool useHiZ)
+{
+	if (instanceCount == 0)
+		return;
+
+	cullShader->SetMatrix4x4("viewProjection", viewProjection);
+	cullShader->SetInt("instanceCount", (int)instanceCount);
+	cullShader->SetInt("useHiZ", useHiZ && hiZSRV ? 1 : 0);
+	cullShader->SetShaderResourceView("Instances", instanceSRV);
+	cullShader->SetShaderResourceView("HiZ", hiZSRV);
+	cullShader->SetUnorderedAccessView("VisibleInstances", visibleUAV);
+	cullShader->SetUnorderedAccessView("DrawArgs", argsUAV);
+	cullShader->SetShader();
+	cullShader->CopyAllBufferData();
+	cullShader->DispatchByThreads(instanceCount, 1, 1);
+
+	// Unbind the outputs so they can be drawn with
+	cullShader->SetUnorderedAccessView("VisibleInstances", 0);
+	cullShader->SetUnorderedAccessView("DrawArgs", 0);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+#include "OcclusionCuller.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// GPU-driven culling and indirect drawing
+//
+// - Every instance's transform and bounds go up in one
+//   structured buffer, grouped into buckets that share a
+//   mesh and material
+// - InstanceCullCS tests each instance against the frustum
+//   (and the software occlusion culler's Hi-Z chain), lists
+//   the survivors per bucket and counts them straight into
+//   that bucket's DrawIndexedInstancedIndirect() arguments
+// - So the CPU issues one draw per bucket however many
+//   instances there are, and never learns how many survived
+// --------------------------------------------------------
+class IndirectRenderer
+{
+public:
+	// One instance - must match InstanceData in InstanceHeader.hlsli
+	struct Instance
+	{
+		DirectX::XMFLOAT4X4 World;
+		DirectX::XMFLOAT4X4 WorldInvTrans;
+		DirectX::XMFLOAT3 BoundsCenter;		// Object space
+		unsigned int Bucket;
+		DirectX::XMFLOAT3 BoundsExtents;
+		unsigned int BucketOffset;			// The bucket's FirstInstance
+	};
+
+	// One indirect draw's worth of instances
+	struct Bucket
+	{
+		unsigned int IndexCount;	// Of the bucket's mesh
+		unsigned int FirstInstance;	// Slots [FirstInstance, FirstInstance + InstanceCount) are the bucket's
+		unsigned int InstanceCount;	// Before culling
+	};
+
+	// Bytes per bucket in the argument buffer
+	static const unsigned int ArgsStride = sizeof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS);
+
+	IndirectRenderer(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		std::shared_ptr<SimpleComputeShader> cullShader);
+
+	// Copies this frame's instances and resets every bucket's draw to zero instances
+	void Upload(
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		const std::vector<Instance>& instances,
+		const std::vector<Bucket>& buckets);
+
+	// Copies the culler's Hi-Z chain - call after it rasterizes
+	void UploadHiZ(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, OcclusionCuller& culler);
+
+	// Culls the uploaded instances and fills in the draws' instance counts
+	//
+	// useHiZ - Test against the last uploaded Hi-Z chain, not just the frustum
+	//
+	// The visible list must not be bound to the vertex shader while this runs
+	void Cull(
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		const DirectX::XMFLOAT4X4& viewProjection,
+		bool useHiZ);
+
+	// Getters
+	ID3D11Buffer* GetArgsBuffer() { return argsBuffer.Get(); }
+	ID3D11ShaderResourceView* GetInstanceSRV() { return instanceSRV.Get(); }
+	ID3D11ShaderResourceView* GetVisibleSRV() { return visibleSRV.Get(); }
+	unsigned int GetInstanceCount() { return instanceCount; }
+	bool HasHiZ() { return hiZSRV != 0; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	std::shared_ptr<SimpleComputeShader> cullShader;
+	unsigned int instanceCount;
+
+	// Inputs, grown as needed
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> instanceSRV;
+	unsigned int instanceCapacity;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> hiZTexture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> hiZSRV;
+
+	// Outputs, also grown as needed
+	Microsoft::WRL::ComPtr<ID3D11Buffer> visibleBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> visibleSRV;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> visibleUAV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> argsBuffer;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> argsUAV;
+	unsigned int bucketCapacity;
+	std::vector<D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS> args;
+
+	void CreateInstanceBuffers(unsigned int capacity);
+	void CreateArgsBuffer(unsigned int capacity);
+	void CreateHiZTexture(OcclusionCuller& culler);
+};
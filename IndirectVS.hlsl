@@ -0,0 +1,35 @@
+#include "structs.hlsli"
+#include "InstanceHeader.hlsli"
+
+cbuffer ExternalData : register(b0)
+{
+	matrix view;
+	matrix projection;
+	uint bucketOffset;		// Where this draw's slots start in the visible list
+}
+
+// Filled by InstanceCullCS
+StructuredBuffer<InstanceData> Instances	: register(t0);
+StructuredBuffer<uint> VisibleInstances		: register(t1);
+
+// --------------------------------------------------------
+// The same as VertexShader, but the world matrices come
+// from whichever instance the culling pass put in this
+// draw's slot, instead of from constants set per draw
+//
+// - SV_InstanceID doesn't include the draw's start
+//   instance, hence the offset from the constant buffer
+// --------------------------------------------------------
+VertexToPixel main(VertexShaderInput input, uint instanceID : SV_InstanceID)
+{
+	InstanceData instance = Instances[VisibleInstances[bucketOffset + instanceID]];
+
+	VertexToPixel output;
+	float4 worldPosition = mul(instance.World, float4(input.localPosition, 1.0f));
+	output.screenPosition = mul(projection, mul(view, worldPosition));
+	output.uv = input.uv;
+	output.normal = mul((float3x3)instance.WorldInvTrans, input.normal);
+	output.worldPosition = worldPosition.xyz;
+	output.tangent = mul((float3x3)instance.World, input.tangent);
+	return output;
+}
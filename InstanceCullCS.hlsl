@@ -0,0 +1,117 @@
+#include "InstanceHeader.hlsli"
+
+#define GROUP_SIZE 64
+
+cbuffer externalData : register(b0)
+{
+	matrix viewProjection;
+	uint instanceCount;
+	uint useHiZ;
+}
+
+// Inputs
+StructuredBuffer<InstanceData> Instances	: register(t0);
+Texture2D<float> HiZ						: register(t1); // OcclusionCuller's depth chain, farthest depth per texel
+
+// Outputs - each visible instance's index goes into its draw's slots,
+// and the draw's instance count is how many slots got filled
+RWStructuredBuffer<uint> VisibleInstances	: register(u0);
+RWBuffer<uint> DrawArgs						: register(u1);
+
+// --------------------------------------------------------
+// Tests a box against the frustum and, optionally, the
+// Hi-Z chain
+//
+// - The same steps as OcclusionCuller::IsVisible() on the
+//   CPU, so both paths hide the same things
+// --------------------------------------------------------
+bool IsVisible(InstanceData instance)
+{
+	matrix worldViewProjection = mul(viewProjection, instance.World);
+
+	float2 ndcMin = 1.0f;
+	float2 ndcMax = -1.0f;
+	float nearestZ = 1.0f;
+	[unroll]
+	for (uint corner = 0; corner < 8; corner++)
+	{
+		float3 sign = float3(
+			(corner & 1) ? 1.0f : -1.0f,
+			(corner & 2) ? 1.0f : -1.0f,
+			(corner & 4) ? 1.0f : -1.0f);
+		float4 clip = mul(worldViewProjection, float4(instance.BoundsCenter + sign * instance.BoundsExtents, 1.0f));
+
+		// Crossing the near plane - assume the worst
+		if (clip.w < 1e-4f || clip.z < 0.0f)
+			return true;
+
+		float3 ndc = clip.xyz / clip.w;
+		ndcMin = min(ndcMin, ndc.xy);
+		ndcMax = max(ndcMax, ndc.xy);
+		nearestZ = min(nearestZ, ndc.z);
+	}
+
+	// Entirely off screen, or past the far plane
+	if (any(ndcMax < -1.0f) || any(ndcMin > 1.0f) || nearestZ > 1.0f)
+		return false;
+	if (!useHiZ)
+		return true;
+
+	// To texels (y flips), clamped to the chain's top level
+	uint width, height, mipCount;
+	HiZ.GetDimensions(0, width, height, mipCount);
+	float left = max((ndcMin.x * 0.5f + 0.5f) * width, 0.0f);
+	float right = min((ndcMax.x * 0.5f + 0.5f) * width, width - 1.0f);
+	float top = max((ndcMax.y * -0.5f + 0.5f) * height, 0.0f);
+	float bottom = min((ndcMin.y * -0.5f + 0.5f) * height, height - 1.0f);
+
+	// The first mip where the rectangle spans no more than two texels each way
+	uint mip = 0;
+	float span = max(right - left, bottom - top);
+	while (span > 2.0f && mip + 1 < mipCount)
+	{
+		span *= 0.5f;
+		mip++;
+	}
+
+	uint mipWidth, mipHeight;
+	HiZ.GetDimensions(mip, mipWidth, mipHeight, mipCount);
+	uint x0 = (uint)left >> mip;
+	uint x1 = min((uint)right >> mip, mipWidth - 1);
+	uint y0 = (uint)top >> mip;
+	uint y1 = min((uint)bottom >> mip, mipHeight - 1);
+
+	for (uint y = y0; y <= y1; y++)
+	{
+		for (uint x = x0; x <= x1; x++)
+		{
+			if (nearestZ <= HiZ.Load(int3(x, y, mip)))
+				return true;
+		}
+	}
+	return false;
+}
+
+// --------------------------------------------------------
+// One thread per instance
+//
+// - Survivors claim the next slot of their draw by bumping
+//   its instance count, so no separate append pass or
+//   counter readback is needed
+// - Slot order within a draw varies from frame to frame,
+//   which is fine, since nothing here depends on it
+// --------------------------------------------------------
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	if (id.x >= instanceCount)
+		return;
+
+	InstanceData instance = Instances[id.x];
+	if (!IsVisible(instance))
+		return;
+
+	uint slot;
+	InterlockedAdd(DrawArgs[instance.Bucket * INDIRECT_ARGS_STRIDE + INDIRECT_ARGS_INSTANCES], 1, slot);
+	VisibleInstances[instance.BucketOffset + slot] = id.x;
+}
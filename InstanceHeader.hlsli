@@ -0,0 +1,22 @@
+#ifndef __GGP_INSTANCE_HEADER__
+#define __GGP_INSTANCE_HEADER__
+
+// One drawable instance for the GPU-driven path
+// - Must match IndirectRenderer::Instance
+// - The bounds are in object space
+struct InstanceData
+{
+	matrix World;
+	matrix WorldInvTrans;
+	float3 BoundsCenter;
+	uint Bucket;			// Which indirect draw this instance belongs to
+	float3 BoundsExtents;
+	uint BucketOffset;		// Where that draw's slots start in the visible list
+};
+
+// Each indirect draw's arguments are five uints, as
+// DrawIndexedInstancedIndirect() reads them
+#define INDIRECT_ARGS_STRIDE		5
+#define INDIRECT_ARGS_INSTANCES		1
+
+#endif
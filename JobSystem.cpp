@@ -0,0 +1,313 @@
+#include "JobSystem.h"
+#include "CpuProfiler.h"
+
+// Which worker (of which job system) the current thread is, if any
+static thread_local JobSystem* currentJobSystem = 0;
+static thread_local int currentWorkerIndex = -1;
+
+// --------------------------------------------------------
+// Constructor - Starts the worker threads
+// --------------------------------------------------------
+JobSystem::JobSystem(unsigned int workerCount)
+	:
+	queuedJobs(0),
+	sleepingWorkers(0),
+	quit(false),
+	jobsRun(0),
+	jobsStolen(0)
+{
+	if (workerCount == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		workerCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.push_back(std::make_unique<Worker>());
+
+	// Start the threads only once the worker array is final
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers[i]->thread = std::thread(&JobSystem::WorkerLoop, this, i);
+}
+
+// --------------------------------------------------------
+// Destructor - Finishes queued jobs, then joins the workers
+// --------------------------------------------------------
+JobSystem::~JobSystem()
+{
+	// Anything still queued gets run by this thread
+	while (true)
+	{
+		Job* job = FindJob(-1);
+		if (!job)
+			job = FindBackgroundJob(0);
+		if (!job)
+			break;
+		Execute(job);
+	}
+
+	quit.store(true);
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_all();
+
+	for (auto& w : workers)
+	{
+		if (w->thread.joinable())
+			w->thread.join();
+	}
+}
+
+// --------------------------------------------------------
+// Queues a job
+//
+// job     - The work to do
+// counter - Optional, incremented now and decremented when
+//           the job finishes
+// --------------------------------------------------------
+void JobSystem::Run(JobFunction job, JobCounter* counter)
+{
+	Job* j = new Job();
+	j->Function = job;
+	j->Counter = counter;
+	if (counter)
+		counter->count.fetch_add(1, std::memory_order_relaxed);
+
+	// Workers push onto their own deque, everyone else into the injection queue
+	int index = GetWorkerIndex();
+	if (index >= 0)
+	{
+		if (!workers[index]->deque.Push(j))
+		{
+			// Deque is full - just do it now
+			Execute(j);
+			return;
+		}
+	}
+	else
+	{
+		std::lock_guard<std::mutex> lock(injectionMutex);
+		injectionQueue.push_back(j);
+	}
+
+	queuedJobs.fetch_add(1);
+	WakeWorker();
+}
+
+// --------------------------------------------------------
+// Queues a low priority job
+//
+// job     - The work to do
+// counter - Optional, incremented now and decremented when
+//           the job finishes
+// --------------------------------------------------------
+void JobSystem::RunBackground(JobFunction job, JobCounter* counter)
+{
+	Job* j = new Job();
+	j->Function = job;
+	j->Counter = counter;
+	if (counter)
+		counter->count.fetch_add(1, std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(backgroundMutex);
+		backgroundQueue.push_back(j);
+	}
+
+	queuedJobs.fetch_add(1);
+	WakeWorker();
+}
+
+// --------------------------------------------------------
+// Helps run jobs until the given counter hits zero
+//
+// - Background jobs only if they're counted by this same
+//   counter, so waiting on frame work never means sitting
+//   through somebody else's file load
+// --------------------------------------------------------
+void JobSystem::Wait(JobCounter* counter)
+{
+	int index = GetWorkerIndex();
+	while (!counter->IsDone())
+	{
+		Job* job = FindJob(index);
+		if (!job)
+			job = FindBackgroundJob(counter);
+		if (job)
+			Execute(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+// --------------------------------------------------------
+// Splits a range into jobs and waits for them
+//
+// begin, end - The range of indices [begin, end)
+// grainSize  - Roughly how many indices each job handles;
+//              big enough that a job outweighs its overhead
+// body       - Called with each sub-range
+// --------------------------------------------------------
+void JobSystem::ParallelFor(unsigned int begin, unsigned int end, unsigned int grainSize, RangeFunction body)
+{
+	if (end <= begin)
+		return;
+	if (grainSize == 0)
+		grainSize = 1;
+
+	// Not worth splitting?
+	if (end - begin <= grainSize)
+	{
+		body(begin, end);
+		return;
+	}
+
+	JobCounter counter;
+	for (unsigned int first = begin; first < end; first += grainSize)
+	{
+		unsigned int last = end - first > grainSize ? first + grainSize : end;
+		Run([&body, first, last]() { body(first, last); }, &counter);
+	}
+	Wait(&counter);
+}
+
+// --------------------------------------------------------
+// Each worker runs jobs until there are none, then sleeps
+// until more are queued
+// --------------------------------------------------------
+void JobSystem::WorkerLoop(unsigned int index)
+{
+	currentJobSystem = this;
+	currentWorkerIndex = (int)index;
+	CPU_PROFILE_THREAD("Worker");
+
+	while (!quit.load())
+	{
+		// Background work only once everything else is taken
+		Job* job = FindJob((int)index);
+		if (!job)
+			job = FindBackgroundJob(0);
+		if (job)
+		{
+			Execute(job);
+			continue;
+		}
+
+		// Nothing anywhere - sleep.  Run() bumps queuedJobs before checking
+		// sleepingWorkers, and we do the opposite, so a wakeup can't be missed
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWorkers.fetch_add(1);
+		wake.wait(lock, [this] { return quit.load() || queuedJobs.load() > 0; });
+		sleepingWorkers.fetch_sub(1);
+	}
+}
+
+// --------------------------------------------------------
+// Returns this thread's worker index in this job system,
+// or -1 if it isn't one of our workers
+// --------------------------------------------------------
+int JobSystem::GetWorkerIndex()
+{
+	return currentJobSystem == this ? currentWorkerIndex : -1;
+}
+
+// --------------------------------------------------------
+// Looks for a job: our own deque first (newest work, which
+// is likely still in cache), then the injection queue, then
+// steals the oldest work from the other workers
+// - Never background jobs, see FindBackgroundJob()
+// --------------------------------------------------------
+JobSystem::Job* JobSystem::FindJob(int workerIndex)
+{
+	Job* job = 0;
+	if (workerIndex >= 0)
+		job = workers[workerIndex]->deque.Pop();
+
+	if (!job)
+	{
+		std::lock_guard<std::mutex> lock(injectionMutex);
+		if (!injectionQueue.empty())
+		{
+			job = injectionQueue.front();
+			injectionQueue.pop_front();
+		}
+	}
+
+	if (!job)
+	{
+		// Start with the next worker along, so thieves spread out
+		unsigned int count = (unsigned int)workers.size();
+		unsigned int start = workerIndex >= 0 ? workerIndex + 1 : 0;
+		for (unsigned int i = 0; i < count && !job; i++)
+		{
+			unsigned int victim = (start + i) % count;
+			if ((int)victim == workerIndex)
+				continue;
+
+			job = workers[victim]->deque.Steal();
+			if (job)
+				jobsStolen.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	if (job)
+		queuedJobs.fetch_sub(1);
+	return job;
+}
+
+// --------------------------------------------------------
+// Takes the oldest background job - or, given a counter,
+// the oldest one that counter is counting
+// --------------------------------------------------------
+JobSystem::Job* JobSystem::FindBackgroundJob(JobCounter* counter)
+{
+	Job* job = 0;
+	{
+		std::lock_guard<std::mutex> lock(backgroundMutex);
+		for (auto it = backgroundQueue.begin(); it != backgroundQueue.end(); ++it)
+		{
+			if (!counter || (*it)->Counter == counter)
+			{
+				job = *it;
+				backgroundQueue.erase(it);
+				break;
+			}
+		}
+	}
+
+	if (job)
+		queuedJobs.fetch_sub(1);
+	return job;
+}
+
+// --------------------------------------------------------
+// Runs a job, then releases its counter
+// --------------------------------------------------------
+void JobSystem::Execute(Job* job)
+{
+	{
+		CPU_PROFILE_SCOPE("Job");
+		job->Function();
+	}
+	if (job->Counter)
+		job->Counter->count.fetch_sub(1, std::memory_order_release);
+	delete job;
+
+	jobsRun.fetch_add(1, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+// Wakes one sleeping worker, if there are any
+// --------------------------------------------------------
+void JobSystem::WakeWorker()
+{
+	if (sleepingWorkers.load() == 0)
+		return;
+
+	// Taking the lock means the sleeper is either waiting or hasn't checked yet
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_one();
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "WorkStealingDeque.h"
+
+// --------------------------------------------------------
+// Counts outstanding jobs, so work can wait on (or depend
+// on) a group of jobs finishing
+//
+// - Run() increments it, and it's decremented as each job
+//   finishes, so zero means "everything is done"
+// - A counter must outlive the jobs that use it
+// --------------------------------------------------------
+class JobCounter
+{
+public:
+	JobCounter() : count(0) {}
+
+	bool IsDone() { return count.load(std::memory_order_acquire) == 0; }
+	unsigned int GetCount() { return count.load(std::memory_order_acquire); }
+
+private:
+	friend class JobSystem;
+	std::atomic<unsigned int> count;
+};
+
+// --------------------------------------------------------
+// A work-stealing job scheduler
+//
+// - Each worker thread owns a Chase-Lev deque: it pushes and
+//   pops its own jobs at one end, while idle workers steal
+//   from the other
+// - Threads that aren't workers (like the main thread) submit
+//   into a shared, locked injection queue instead
+// - Wait() runs other jobs while it waits, so it's fine to
+//   call from inside a job, and the waiting thread helps out
+// - Background jobs (like file loads) have their own queue,
+//   which workers only turn to when there's nothing else, and
+//   which Wait() only helps with for its own counter - so a
+//   frame's ParallelFor() never gets stuck behind a decode
+// - Jobs must not block on anything but Wait()
+// --------------------------------------------------------
+class JobSystem
+{
+public:
+	typedef std::function<void()> JobFunction;
+	typedef std::function<void(unsigned int begin, unsigned int end)> RangeFunction;
+
+	// workerCount - Worker threads to start; zero means one per core, minus the calling thread
+	JobSystem(unsigned int workerCount = 0);
+	~JobSystem();
+
+	// Queues a job, optionally counted by (and waitable through) a counter
+	void Run(JobFunction job, JobCounter* counter = 0);
+
+	// Queues a long, low priority job, optionally counted by a counter
+	// - Don't share a counter between Run() and RunBackground() jobs
+	void RunBackground(JobFunction job, JobCounter* counter = 0);
+
+	// Runs other jobs until the counter reaches zero
+	// - Of the background jobs, only ones counted by this counter are run
+	void Wait(JobCounter* counter);
+
+	// Splits [begin, end) into ranges of about grainSize items, runs them
+	// as jobs and waits for all of them.  The calling thread helps.
+	void ParallelFor(unsigned int begin, unsigned int end, unsigned int grainSize, RangeFunction body);
+
+	unsigned int GetWorkerCount() { return (unsigned int)workers.size(); }
+
+	// Stats
+	uint64_t GetJobsRun() { return jobsRun.load(std::memory_order_relaxed); }
+	uint64_t GetJobsStolen() { return jobsStolen.load(std::memory_order_relaxed); }
+
+private:
+	struct Job
+	{
+		JobFunction Function;
+		JobCounter* Counter;
+	};
+
+	struct Worker
+	{
+		WorkStealingDeque<Job> deque;
+		std::thread thread;
+	};
+	std::vector<std::unique_ptr<Worker>> workers;
+
+	// Jobs from threads that don't own a deque
+	std::mutex injectionMutex;
+	std::deque<Job*> injectionQueue;
+
+	// Low priority jobs, from any thread, oldest first
+	std::mutex backgroundMutex;
+	std::deque<Job*> backgroundQueue;
+
+	// Sleeping when there's nothing to do
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<unsigned int> queuedJobs;
+	std::atomic<unsigned int> sleepingWorkers;
+	std::atomic<bool> quit;
+
+	std::atomic<uint64_t> jobsRun;
+	std::atomic<uint64_t> jobsStolen;
+
+	void WorkerLoop(unsigned int index);
+	int GetWorkerIndex();
+	Job* FindJob(int workerIndex);
+	Job* FindBackgroundJob(JobCounter* counter);
+	void Execute(Job* job);
+	void WakeWorker();
+};
+
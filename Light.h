@@ -14,5 +14,7 @@ struct Light
 	float Intensity;
 	DirectX::XMFLOAT3 Color;
 	float SpotFalloff;
-	DirectX::XMFLOAT3 Padding;
+	int CastsShadow;				// Only the first directional light with this set gets one
+	int ShadowTileIndex;			// First shadow atlas tile, set by the renderer (-1 for none)
+	unsigned int Id;				// Set by LightManager - unlike its index, stays the same while the light exists
 };
@@ -22,7 +22,9 @@ struct Light
 	float Intensity;
 	float3 Color;
 	float SpotFalloff;
-	float3 Padding;
+	int CastsShadow;
+	int ShadowTileIndex;	// Point lights use this and the five tiles after it
+	uint Id;
 };
 
 float3 NormDirToDirLight(Light light)
@@ -198,4 +200,23 @@ float3 PointLight(
 	return ((balancedDiff * ((float3) surfaceColor * (float3)colorTint) + spec) * light.Intensity * light.Color) * attenuation;
 }
 
+float3 SpotLight(
+	Light light,
+	float3 normal,
+	float roughness,
+	float metalness,
+	float3 specColor,
+	float4 surfaceColor,
+	float4 colorTint,
+	float3 view,
+	float3 worldPos
+)
+{
+	// A point light, narrowed to a cone around its direction
+	float cosAngle = saturate(dot(normalize(worldPos - light.Position), normalize(light.Direction)));
+	float spotAmount = pow(cosAngle, light.SpotFalloff);
+
+	return PointLight(light, normal, roughness, metalness, specColor, surfaceColor, colorTint, view, worldPos) * spotAmount;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "LightManager.h"
+
+#include <string.h>
+
+// --------------------------------------------------------
+// Constructor - Creates the GPU buffer up front, so there's
+// always something to bind even with no lights
+//
+// initialCapacity - Lights the buffer holds before it first grows
+// --------------------------------------------------------
+LightManager::LightManager(Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int initialCapacity)
+	:
+	nextId(1),
+	device(device),
+	capacity(0)
+{
+	CreateBuffer(initialCapacity < 1 ? 1 : initialCapacity);
+}
+
+// --------------------------------------------------------
+// Adds a light, returning its index
+// - Ids start at one, so zero never matches a real light
+// --------------------------------------------------------
+unsigned int LightManager::AddLight(const Light& light)
+{
+	lights.push_back(light);
+	lights.back().Id = nextId++;
+	return (unsigned int)lights.size() - 1;
+}
+
+// --------------------------------------------------------
+// Removes a light - indices after it shift down by one
+// --------------------------------------------------------
+void LightManager::RemoveLight(unsigned int index)
+{
+	if (index < lights.size())
+		lights.erase(lights.begin() + index);
+}
+
+// --------------------------------------------------------
+// Removes every light
+// --------------------------------------------------------
+void LightManager::ClearLights()
+{
+	lights.clear();
+}
+
+// --------------------------------------------------------
+// Copies the lights for this frame to the GPU
+//
+// frameLights - The lights to draw with, which may be a copy
+//               of this manager's lights captured earlier
+// --------------------------------------------------------
+void LightManager::Upload(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const std::vector<Light>& frameLights)
+{
+	unsigned int count = (unsigned int)frameLights.size();
+	if (count > capacity)
+	{
+		unsigned int newCapacity = capacity;
+		while (newCapacity < count)
+			newCapacity *= 2;
+		CreateBuffer(newCapacity);
+	}
+
+	if (count == 0)
+		return;
+
+	// Discarding gives us fresh memory, so frames still in flight keep their lights
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+	memcpy(mapped.pData, frameLights.data(), sizeof(Light) * count);
+	context->Unmap(buffer.Get(), 0);
+}
+
+// --------------------------------------------------------
+// (Re)creates the structured buffer and its SRV
+// --------------------------------------------------------
+void LightManager::CreateBuffer(unsigned int newCapacity)
+{
+	buffer.Reset();
+	srv.Reset();
+	capacity = 0;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = sizeof(Light) * newCapacity;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	desc.StructureByteStride = sizeof(Light);
+	if (FAILED(device->CreateBuffer(&desc, 0, buffer.GetAddressOf())))
+		return;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = newCapacity;
+	if (FAILED(device->CreateShaderResourceView(buffer.Get(), &srvDesc, srv.GetAddressOf())))
+		return;
+
+	capacity = newCapacity;
+}
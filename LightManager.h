@@ -0,0 +1,54 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+#include "Light.h"
+
+// --------------------------------------------------------
+// Owns the scene's lights, and the structured buffer the
+// pixel shaders read them from
+//
+// - The light array can grow without limit; the GPU buffer
+//   grows (doubling) to match when it's next uploaded
+// - Everything is uploaded once per frame with a single
+//   Map(DISCARD), instead of per object through cbuffers
+// - Game code edits the lights; drawing uploads whatever
+//   array it's given (usually a frame packet's copy), so
+//   the two sides can be on different threads
+// --------------------------------------------------------
+class LightManager
+{
+public:
+	LightManager(Microsoft::WRL::ComPtr<ID3D11Device> device, unsigned int initialCapacity = 16);
+
+	// Editing the lights
+	// - AddLight() gives the light a new Id, which it keeps even as others are removed
+	unsigned int AddLight(const Light& light);
+	void RemoveLight(unsigned int index);
+	void ClearLights();
+	Light& GetLight(unsigned int index) { return lights[index]; }
+	unsigned int GetLightCount() { return (unsigned int)lights.size(); }
+	const std::vector<Light>& GetLights() { return lights; }
+
+	// Copies the given lights into the GPU buffer, growing it if needed
+	void Upload(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const std::vector<Light>& frameLights);
+
+	// For binding to StructuredBuffer<Light> in a shader
+	ID3D11ShaderResourceView* GetSRV() { return srv.Get(); }
+
+	// Only for the thread that calls Upload() - others should read it from the frame's stats
+	unsigned int GetCapacity() { return capacity; }
+
+private:
+	std::vector<Light> lights;
+	unsigned int nextId;
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	unsigned int capacity;
+
+	void CreateBuffer(unsigned int newCapacity);
+};
+
@@ -1,6 +1,34 @@
 
 #include <Windows.h>
+#include <sstream>
 #include "Game.h"
+#include "Helpers.h"
+#include "SoftwareReference.h"
+#include "CommandReplayer.h"
+
+// --------------------------------------------------------
+// Reads the options that change how DXCore itself runs:
+//   -headless [-maxframes N]   Render offscreen, with no window
+//   -readback N                Read frames back through N staging textures
+// --------------------------------------------------------
+static bool ParseCoreOptions(const char* commandLine, bool* headless, unsigned int* maxFrames, unsigned int* readbackDepth)
+{
+	std::istringstream arguments(commandLine ? commandLine : "");
+	std::string argument;
+	while (arguments >> argument)
+	{
+		if (argument == "-headless")
+			*headless = true;
+		else if (argument == "-maxframes")
+			arguments >> *maxFrames;
+		else if (argument == "-readback")
+			arguments >> *readbackDepth;
+
+		if (arguments.fail())
+			return false;
+	}
+	return true;
+}
 
 // --------------------------------------------------------
 // Entry point for a graphical (non-console) Windows application
@@ -18,10 +46,60 @@ int WINAPI WinMain(
 	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
 #endif
 
+	// "-software" renders the scene on the CPU instead, for machines
+	// with no GPU, and never opens a window (see SoftwareReference.h
+	// for the other options)
+	SoftwareReference::Settings softwareSettings;
+	if (!SoftwareReference::ParseCommandLine(lpCmdLine, &softwareSettings))
+		return E_INVALIDARG;
+	if (softwareSettings.Enabled)
+	{
+		if (softwareSettings.AssetPath.empty())
+			softwareSettings.AssetPath = WideToNarrow(FixPath(L"../../Assets"));
+		SoftwareReference reference(softwareSettings);
+		return reference.Run();
+	}
+
+	// "-replay" times a capture (see -capture below) through the null
+	// backend, with no window or GPU, and writes its results to a file
+	// (see CommandReplayer.h for the other options)
+	CommandReplayer::Settings replaySettings;
+	if (!CommandReplayer::ParseCommandLine(lpCmdLine, &replaySettings))
+		return E_INVALIDARG;
+	if (replaySettings.Enabled)
+		return CommandReplayer::Run(replaySettings);
+
 	// Create the Game object using
 	// the app handle we got from WinMain
 	Game dxGame(hInstance);
 
+	// Headless runs (for build agents with no desktop) skip the window entirely
+	bool headless = false;
+	unsigned int maxFrames = 0;
+	unsigned int readbackDepth = 0;
+	if (!ParseCoreOptions(lpCmdLine, &headless, &maxFrames, &readbackDepth))
+		return E_INVALIDARG;
+	if (headless)
+		dxGame.EnableHeadless(maxFrames);
+	if (readbackDepth > 0)
+		dxGame.EnableFrameReadback(readbackDepth);
+
+	// "-benchmark" runs a fixed, repeatable flythrough and writes
+	// its results to a file (see Benchmark.h for the other options)
+	Benchmark::Settings benchmarkSettings;
+	if (!Benchmark::ParseCommandLine(lpCmdLine, &benchmarkSettings))
+		return E_INVALIDARG;
+	if (benchmarkSettings.Enabled)
+		dxGame.EnableBenchmark(benchmarkSettings);
+
+	// "-capture" writes a few frames of draw commands to a file, for
+	// -replay to time later (see CommandCapture.h for the other options)
+	CommandCapture::Settings captureSettings;
+	if (!CommandCapture::ParseCommandLine(lpCmdLine, &captureSettings))
+		return E_INVALIDARG;
+	if (captureSettings.Enabled)
+		dxGame.EnableCapture(captureSettings);
+
 	// Result variable for function calls below
 	HRESULT hr = S_OK;
 
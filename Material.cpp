@@ -1,14 +1,18 @@
 #include "Material.h"
+#include <climits>
 
 Material::Material(
     DirectX::XMFLOAT4 colorTint,
-    std::shared_ptr<SimpleVertexShader> vs,
-    std::shared_ptr<SimplePixelShader> ps)
+    std::shared_ptr<RenderShader> vs,
+    std::shared_ptr<RenderShader> ps)
     :
     colorTint(colorTint),
     vs(vs),
-    ps(ps)
+    ps(ps),
+    textureStartSlot(0),
+    samplerStartSlot(0)
 {
+    ResolveBindTables();
 }
 
 DirectX::XMFLOAT4 Material::GetColorTint()
@@ -16,12 +20,12 @@ DirectX::XMFLOAT4 Material::GetColorTint()
     return colorTint;
 }
 
-std::shared_ptr<SimpleVertexShader> Material::GetVS()
+std::shared_ptr<RenderShader> Material::GetVS()
 {
     return vs;
 }
 
-std::shared_ptr<SimplePixelShader> Material::GetPS()
+std::shared_ptr<RenderShader> Material::GetPS()
 {
     return ps;
 }
@@ -32,42 +36,136 @@ DirectX::XMFLOAT4 Material::SetColorTint(DirectX::XMFLOAT4 newColorTint)
     return colorTint;
 }
 
-std::shared_ptr<SimpleVertexShader> Material::SetVS(std::shared_ptr<SimpleVertexShader> newVS)
+std::shared_ptr<RenderShader> Material::SetVS(std::shared_ptr<RenderShader> newVS)
 {
     vs = newVS;
     return vs;
 }
 
-std::shared_ptr<SimplePixelShader> Material::SetPS(std::shared_ptr<SimplePixelShader> newPS)
+std::shared_ptr<RenderShader> Material::SetPS(std::shared_ptr<RenderShader> newPS)
 {
     ps = newPS;
+    ResolveBindTables();
     return ps;
 }
 
 /// <summary>
 /// Send all of the data we need for this material down to the GPU
 /// </summary>
-void Material::PrepareMaterial()
+void Material::PrepareMaterial(RenderContext* context)
 {
-    vs->SetShader();
-    ps->SetShader();
-    // Assigning SRVs and sampler state to the pixel shader in a loop, because there can be more than one.
-    for (auto& t : textureSRVs)
+    context->SetShader(RenderContext::VertexStage, vs.get(), 0);
+    context->SetShader(RenderContext::PixelStage, ps.get(), 0);
+    BindTextures(context);
+}
+
+/// <summary>
+/// Same as above, but binds the shaders with constant buffer slices captured earlier, so this can
+/// be recorded on a deferred context while the shaders' own data moves on to the next draw
+/// </summary>
+void Material::PrepareMaterial(
+    RenderContext* context,
+    const RenderConstantBufferRanges& vsRanges,
+    const RenderConstantBufferRanges& psRanges)
+{
+    context->SetShader(RenderContext::VertexStage, vs.get(), &vsRanges);
+    context->SetShader(RenderContext::PixelStage, ps.get(), &psRanges);
+    BindTextures(context);
+}
+
+/// <summary>
+/// Binds just the pixel shader and its textures, leaving the vertex shader to the caller
+/// </summary>
+void Material::PreparePixelStage(RenderContext* context)
+{
+    context->SetShader(RenderContext::PixelStage, ps.get(), 0);
+    BindTextures(context);
+}
+
+/// <summary>
+/// Binds the resolved texture and sampler tables
+/// </summary>
+void Material::BindTextures(RenderContext* context)
+{
+    // Slots were resolved when the pixel shader was assigned, so every texture goes down in one call, and every sampler in another
+    if (!textureTable.empty())
     {
-        ps->SetShaderResourceView(t.first.c_str(), t.second);
+        context->SetTextures(RenderContext::PixelStage, textureStartSlot, (unsigned int)textureTable.size(), textureTable.data());
     }
-    for (auto& s : textureSamplers)
+    if (!samplerTable.empty())
     {
-        ps->SetSamplerState(s.first.c_str(), s.second);
+        context->SetSamplers(RenderContext::PixelStage, samplerStartSlot, (unsigned int)samplerTable.size(), samplerTable.data());
     }
 }
 
-void Material::AddTextureSRV(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
+void Material::AddTexture(std::string shaderName, std::shared_ptr<RenderTexture> texture)
+{
+    textures[shaderName] = texture;
+    ResolveBindTables();
+}
+
+void Material::AddSampler(std::string shaderName, std::shared_ptr<RenderSampler> sampler)
 {
-    textureSRVs.insert({ shaderName, srv });
+    samplers[shaderName] = sampler;
+    ResolveBindTables();
 }
 
-void Material::AddTextureSampler(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampState)
+/// <summary>
+/// Looks up the register of each named texture and sampler in the pixel shader, and lays them out
+/// in arrays covering the lowest to highest register used.  Registers in between that this material
+/// doesn't set are bound to null.  Names the shader doesn't have are skipped, just like SimpleShader does.
+/// </summary>
+void Material::ResolveBindTables()
 {
-    textureSamplers.insert({ shaderName, sampState });
+    textureStartSlot = 0;
+    textureTable.clear();
+    samplerStartSlot = 0;
+    samplerTable.clear();
+    if (!ps)
+    {
+        return;
+    }
+
+    // Find the range of registers first, then fill it in
+    unsigned int first = UINT_MAX;
+    unsigned int last = 0;
+    for (auto& t : textures)
+    {
+        int slot = ps->GetTextureSlot(t.first);
+        if (slot < 0) continue;
+        if ((unsigned int)slot < first) first = slot;
+        if ((unsigned int)slot > last) last = slot;
+    }
+    if (first != UINT_MAX)
+    {
+        textureStartSlot = first;
+        textureTable.resize(last - first + 1, 0);
+        for (auto& t : textures)
+        {
+            int slot = ps->GetTextureSlot(t.first);
+            if (slot < 0) continue;
+            textureTable[slot - first] = t.second.get();
+        }
+    }
+
+    first = UINT_MAX;
+    last = 0;
+    for (auto& s : samplers)
+    {
+        int slot = ps->GetSamplerSlot(s.first);
+        if (slot < 0) continue;
+        if ((unsigned int)slot < first) first = slot;
+        if ((unsigned int)slot > last) last = slot;
+    }
+    if (first != UINT_MAX)
+    {
+        samplerStartSlot = first;
+        samplerTable.resize(last - first + 1, 0);
+        for (auto& s : samplers)
+        {
+            int slot = ps->GetSamplerSlot(s.first);
+            if (slot < 0) continue;
+            samplerTable[slot - first] = s.second.get();
+        }
+    }
 }
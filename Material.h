@@ -1,36 +1,58 @@
 #pragma once
 
-#include "SimpleShader.h"
+#include <DirectXMath.h>
+#include "RenderDevice.h"
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 class Material
 {
 public:
 	Material(
 		DirectX::XMFLOAT4 colorTint,
-		std::shared_ptr<SimpleVertexShader> vs,
-		std::shared_ptr<SimplePixelShader> ps
+		std::shared_ptr<RenderShader> vs,
+		std::shared_ptr<RenderShader> ps
 	);
 	
 	DirectX::XMFLOAT4 GetColorTint();
-	std::shared_ptr<SimpleVertexShader> GetVS();
-	std::shared_ptr<SimplePixelShader> GetPS();
+	std::shared_ptr<RenderShader> GetVS();
+	std::shared_ptr<RenderShader> GetPS();
 
 	DirectX::XMFLOAT4 SetColorTint(DirectX::XMFLOAT4 newColorTint);
-	std::shared_ptr<SimpleVertexShader> SetVS(std::shared_ptr<SimpleVertexShader> newVS);
-	std::shared_ptr<SimplePixelShader> SetPS(std::shared_ptr<SimplePixelShader> newPS);
+	std::shared_ptr<RenderShader> SetVS(std::shared_ptr<RenderShader> newVS);
+	std::shared_ptr<RenderShader> SetPS(std::shared_ptr<RenderShader> newPS);
 
-	void PrepareMaterial();
+	void PrepareMaterial(RenderContext* context);
+	void PrepareMaterial(
+		RenderContext* context,
+		const RenderConstantBufferRanges& vsRanges,
+		const RenderConstantBufferRanges& psRanges);
 
-	void AddTextureSRV(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
-	void AddTextureSampler(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampState);
+	// Only the pixel shader and textures, for draws that bring their own vertex shader
+	void PreparePixelStage(RenderContext* context);
+
+	// Adding one under a name that's already there replaces it
+	void AddTexture(std::string shaderName, std::shared_ptr<RenderTexture> texture);
+	void AddSampler(std::string shaderName, std::shared_ptr<RenderSampler> sampler);
 
 private:
 	DirectX::XMFLOAT4 colorTint;
-	std::shared_ptr<SimpleVertexShader> vs;
-	std::shared_ptr<SimplePixelShader> ps;
-	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
-	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> textureSamplers;
+	std::shared_ptr<RenderShader> vs;
+	std::shared_ptr<RenderShader> ps;
+	std::unordered_map<std::string, std::shared_ptr<RenderTexture>> textures;
+	std::unordered_map<std::string, std::shared_ptr<RenderSampler>> samplers;
+
+	// Bind tables resolved against the current pixel shader, indexed by register
+	// from the start slot, so each can be bound in a single call.  The raw
+	// pointers are kept alive by the shared_ptrs in the maps above.
+	unsigned int textureStartSlot;
+	std::vector<RenderTexture*> textureTable;
+	unsigned int samplerStartSlot;
+	std::vector<RenderSampler*> samplerTable;
+
+	void ResolveBindTables();
+	void BindTextures(RenderContext* context);
 };
 
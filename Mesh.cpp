@@ -1,23 +1,29 @@
 #include "Mesh.h"
+#include "CpuProfiler.h"
+
+// sscanf_s is Microsoft's - with only numbers to read, plain sscanf does the same
+#ifndef _WIN32
+#define sscanf_s sscanf
+#endif
 
 Mesh::Mesh(
 	Vertex* vertices,
 	int numVertices,
 	unsigned int* indices,
 	int numIndices,
-	Microsoft::WRL::ComPtr<ID3D11Device> device,
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context
+	RenderDevice* device
 )
 {
-	CreateBuffers(vertices, numVertices, indices, numIndices, device, context);
+	CreateBuffers(vertices, numVertices, indices, numIndices, device);
 }
 
 Mesh::Mesh(
-	const std::wstring& objFile,
-	Microsoft::WRL::ComPtr<ID3D11Device> device,
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context
+	const std::string& objFile,
+	RenderDevice* device
 )
 {
+	CPU_PROFILE_SCOPE("Mesh::Mesh (OBJ)");
+
 	// Author: Chris Cascioli
 	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
 	// 
@@ -40,7 +46,7 @@ Mesh::Mesh(
 	std::vector<DirectX::XMFLOAT3> normals;		// Normals from the file
 	std::vector<DirectX::XMFLOAT2> uvs;		// UVs from the file
 	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
+	std::vector<unsigned int> indices;		// Indices of these verts
 	int vertCounter = 0;			// Count of vertices
 	int indexCounter = 0;			// Count of indices
 	char chars[100];			// String for line reading
@@ -238,19 +244,19 @@ Mesh::Mesh(
 	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
 
 	// Run CreateBuffers
-	CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter, device, context);
+	CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter, device);
 }
 
 Mesh::~Mesh()
 {
 }
 
-Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer()
+std::shared_ptr<RenderBuffer> Mesh::GetVertexBuffer()
 {
 	return vertexBuffer;
 }
 
-Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer()
+std::shared_ptr<RenderBuffer> Mesh::GetIndexBuffer()
 {
 	return indexBuffer;
 }
@@ -260,21 +266,21 @@ int Mesh::GetIndexCount()
 	return indexCount;
 }
 
-void Mesh::Draw()
+void Mesh::Draw(RenderContext* context)
 {
 	// DRAW geometry
 	// - These steps are generally repeated for EACH object you draw
 	// - Other Direct3D calls will also be necessary to do more complex things
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
 
 	// Set buffers in the input assembler (IA) stage
 		//  - Do this ONCE PER OBJECT, since each object may have different geometry
 		//  - For this demo, this step *could* simply be done once during Init()
 		//  - However, this needs to be done between EACH DrawIndexed() call
 		//     when drawing different geometry, so it's here as an example
-	deviceContext->IASetVertexBuffers(0, 1, this->GetVertexBuffer().GetAddressOf(), &stride, &offset);
-	deviceContext->IASetIndexBuffer(this->GetIndexBuffer().Get(), DXGI_FORMAT_R32_UINT, 0);
+	//  - With the D3D11 backend these go through the state cache, so drawing
+	//     the same mesh several times in a row only binds its buffers once
+	context->SetVertexBuffer(vertexBuffer.get(), sizeof(Vertex), 0);
+	context->SetIndexBuffer(indexBuffer.get(), 0);
 
 	// Tell Direct3D to draw
 	//  - Begins the rendering pipeline on the GPU
@@ -282,50 +288,57 @@ void Mesh::Draw()
 	//  - This will use all currently set Direct3D resources (shaders, buffers, etc)
 	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
 	//     vertices in the currently set VERTEX BUFFER
-	deviceContext->DrawIndexed(
+	context->DrawIndexed(
 		indexCount,     // The number of indices to use (we could draw a subset if we wanted)
 		0,     // Offset to the first index we want to use
 		0);    // Offset to add to each index when looking up vertices
 }
 
+void Mesh::DrawIndirect(RenderContext* context, RenderBuffer* argsBuffer, unsigned int argsOffset)
+{
+	// Same buffers as Draw(), but the index and instance counts come from the GPU
+	context->SetVertexBuffer(vertexBuffer.get(), sizeof(Vertex), 0);
+	context->SetIndexBuffer(indexBuffer.get(), 0);
+	context->DrawIndexedIndirect(argsBuffer, argsOffset);
+}
+
 void Mesh::CreateBuffers(
 	Vertex* vertices,
 	int numVertices,
 	unsigned int* indices,
 	int numIndices,
-	Microsoft::WRL::ComPtr<ID3D11Device> device,
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context
+	RenderDevice* device
 )
 {
-	// Set the reference to the context and index count
-	deviceContext = context;
+	// Remember the index count for drawing
 	indexCount = numIndices;
 
+	// And the bounds, for culling
+	DirectX::BoundingBox::CreateFromPoints(bounds, numVertices, &vertices[0].Position, sizeof(Vertex));
+
+	// Keep the bare triangles on the CPU too, for occlusion culling
+	positions.resize(numVertices);
+	for (int i = 0; i < numVertices; i++)
+		positions[i] = vertices[i].Position;
+	cpuIndices.assign(indices, indices + numIndices);
+
 // Create a VERTEX BUFFER
 // - This holds the vertex data of triangles for a single object
 // - This buffer is created on the GPU, which is where the data needs to
 //    be if we want the GPU to act on it (as in: draw it to the screen)
 	{
-		// First, we need to describe the buffer we want Direct3D to make on the GPU
+		// First, we need to describe the buffer we want the device to make on the GPU
 		//  - Note that this variable is created on the stack since we only need it once
 		//  - After the buffer is created, this description variable is unnecessary
-		D3D11_BUFFER_DESC vbd = {};
-		vbd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
+		RenderBufferDesc vbd = {};
+		vbd.Type = RenderBufferDesc::VertexBuffer;	// Tells the device this is a vertex buffer
+		vbd.Access = RenderBufferDesc::Immutable;	// Will NEVER change
 		vbd.ByteWidth = sizeof(Vertex) * numVertices;       // Number of vertices in the buffer
-		vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells Direct3D this is a vertex buffer
-		vbd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-		vbd.MiscFlags = 0;
-		vbd.StructureByteStride = 0;
-
-		// Create the proper struct to hold the initial vertex data
-		// - This is how we initially fill the buffer with data
-		// - Essentially, we're specifying a pointer to the data to copy
-		D3D11_SUBRESOURCE_DATA initialVertexData = {};
-		initialVertexData.pSysMem = vertices; // pSysMem = Pointer to System Memory
+		vbd.Stride = sizeof(Vertex);
 
 		// Actually create the buffer on the GPU with the initial data
 		// - Once we do this, we'll NEVER CHANGE DATA IN THE BUFFER AGAIN
-		device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
+		vertexBuffer = device->CreateBuffer(vbd, vertices);
 	}
 
 	// Create an INDEX BUFFER
@@ -336,22 +349,15 @@ void Mesh::CreateBuffers(
 	{
 		// Describe the buffer, as we did above, with two major differences
 		//  - Byte Width (3 unsigned integers vs. 3 whole vertices)
-		//  - Bind Flag (used as an index buffer instead of a vertex buffer) 
-		D3D11_BUFFER_DESC ibd = {};
-		ibd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
+		//  - Type (used as an index buffer instead of a vertex buffer) 
+		RenderBufferDesc ibd = {};
+		ibd.Type = RenderBufferDesc::IndexBuffer;	// Tells the device this is an index buffer
+		ibd.Access = RenderBufferDesc::Immutable;	// Will NEVER change
 		ibd.ByteWidth = sizeof(unsigned int) * numIndices;	// Number of indices in the buffer
-		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	// Tells Direct3D this is an index buffer
-		ibd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-		ibd.MiscFlags = 0;
-		ibd.StructureByteStride = 0;
-
-		// Specify the initial data for this buffer, similar to above
-		D3D11_SUBRESOURCE_DATA initialIndexData = {};
-		initialIndexData.pSysMem = indices; // pSysMem = Pointer to System Memory
 
 		// Actually create the buffer with the initial data
 		// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-		device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
+		indexBuffer = device->CreateBuffer(ibd, indices);
 	}
 }
 
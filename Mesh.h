@@ -1,11 +1,12 @@
 #pragma once
 
-#include <d3d11.h>
-#include <wrl/client.h>
+#include <DirectXCollision.h>
 #include "Vertex.h"
+#include "RenderDevice.h"
 #include <string>
 #include <fstream>
 #include <vector>
+#include <memory>
 
 class Mesh
 {
@@ -15,30 +16,41 @@ public:
 		int numVertices,
 		unsigned int* indices,
 		int numIndices,
-		Microsoft::WRL::ComPtr<ID3D11Device> device,
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context
+		RenderDevice* device
 	);
 
+	// Loads an OBJ file (positions, uvs and normals)
 	Mesh(
-		const std::wstring& objFile,
-		Microsoft::WRL::ComPtr<ID3D11Device> device,
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context
+		const std::string& objFile,
+		RenderDevice* device
 	);
 
 	~Mesh();
 
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
-	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
+	std::shared_ptr<RenderBuffer> GetVertexBuffer();
+	std::shared_ptr<RenderBuffer> GetIndexBuffer();
 	int GetIndexCount();
+	const DirectX::BoundingBox& GetBounds() { return bounds; } // Object space
+
+	// CPU copies of the triangles, for software rasterizing
+	const std::vector<DirectX::XMFLOAT3>& GetPositions() { return positions; }
+	const std::vector<unsigned int>& GetIndices() { return cpuIndices; }
 	
 	// Callable methods
-	void Draw();
+	// - Meshes don't hold on to a context, so they can be drawn on
+	//   whichever one is given (immediate, deferred or null)
+	void Draw(RenderContext* context);
+
+	// Draws with arguments the GPU wrote, at the given byte offset into the buffer
+	void DrawIndirect(RenderContext* context, RenderBuffer* argsBuffer, unsigned int argsOffset);
 private:
 	// Core data
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
+	std::shared_ptr<RenderBuffer> vertexBuffer;
+	std::shared_ptr<RenderBuffer> indexBuffer;
 	int indexCount;
+	DirectX::BoundingBox bounds;
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<unsigned int> cpuIndices;
 
 	// Helper methods
 	void CreateBuffers(
@@ -46,8 +58,7 @@ private:
 		int numVertices,
 		unsigned int* indices,
 		int numIndices,
-		Microsoft::WRL::ComPtr<ID3D11Device> device,
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context
+		RenderDevice* device
 	);
 
 	void CalculateTangents(
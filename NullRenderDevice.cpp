@@ -0,0 +1,438 @@
+#include "NullRenderDevice.h"
+#include <string.h>
+
+// --------------------------------------------------------
+// The null backend's resources - nothing but their sizes
+// --------------------------------------------------------
+class NullRenderBuffer : public RenderBuffer
+{
+public:
+	NullRenderBuffer(const RenderBufferDesc& desc, unsigned int id) : RenderBuffer(desc), Id(id) {}
+	unsigned int Id;
+};
+
+class NullRenderTexture : public RenderTexture
+{
+public:
+	NullRenderTexture(const RenderTextureDesc& desc, unsigned int id) : RenderTexture(desc), Id(id) {}
+	unsigned int Id;
+};
+
+class NullRenderSampler : public RenderSampler
+{
+public:
+	NullRenderSampler(const RenderSamplerDesc& desc, unsigned int id) : RenderSampler(desc), Id(id) {}
+	unsigned int Id;
+};
+
+class NullRenderPipelineState : public RenderPipelineState
+{
+public:
+	NullRenderPipelineState(const RenderPipelineStateDesc& desc, unsigned int id) : RenderPipelineState(desc), Id(id) {}
+	unsigned int Id;
+};
+
+// A pointer value no real object can have, used to mark unknown bindings
+static const void* const UnknownBinding = reinterpret_cast<const void*>(~(uintptr_t)0);
+static const unsigned int UnknownValue = 0xFFFFFFFF;
+
+// Constant buffer ring slices start on 256 byte boundaries, as in D3D11.1
+static const unsigned int RingAlignment = 256;
+
+
+NullRenderDevice::NullRenderDevice()
+	:
+	immediateContext(new NullRenderContext()),
+	nextId(1),
+	buffers(0),
+	textures(0),
+	samplers(0),
+	pipelineStates(0),
+	bufferBytes(0),
+	textureBytes(0)
+{
+}
+
+NullRenderDevice::~NullRenderDevice()
+{
+}
+
+std::shared_ptr<RenderBuffer> NullRenderDevice::CreateBuffer(const RenderBufferDesc& desc, const void* initialData)
+{
+	if (desc.ByteWidth == 0 || (desc.Access == RenderBufferDesc::Immutable && !initialData))
+		return 0;
+
+	buffers++;
+	bufferBytes += desc.ByteWidth;
+	return std::make_shared<NullRenderBuffer>(desc, nextId++);
+}
+
+std::shared_ptr<RenderTexture> NullRenderDevice::CreateTexture(const RenderTextureDesc& desc, const void* const* data)
+{
+	if (desc.Width == 0 || desc.Height == 0 || desc.MipLevels == 0 || desc.ArraySize == 0 || !data)
+		return 0;
+
+	// Every mip of every slice, each at least a pixel on a side
+	uint64_t bytes = 0;
+	for (unsigned int mip = 0; mip < desc.MipLevels; mip++)
+	{
+		uint64_t width = desc.Width >> mip;
+		uint64_t height = desc.Height >> mip;
+		bytes += (width > 0 ? width : 1) * (height > 0 ? height : 1) * 4;
+	}
+
+	textures++;
+	textureBytes += bytes * desc.ArraySize;
+	return std::make_shared<NullRenderTexture>(desc, nextId++);
+}
+
+std::shared_ptr<RenderSampler> NullRenderDevice::CreateSampler(const RenderSamplerDesc& desc)
+{
+	samplers++;
+	return std::make_shared<NullRenderSampler>(desc, nextId++);
+}
+
+std::shared_ptr<RenderPipelineState> NullRenderDevice::CreatePipelineState(const RenderPipelineStateDesc& desc)
+{
+	pipelineStates++;
+	return std::make_shared<NullRenderPipelineState>(desc, nextId++);
+}
+
+NullRenderDevice::Stats NullRenderDevice::GetStats()
+{
+	Stats stats = {};
+	stats.Buffers = buffers;
+	stats.Textures = textures;
+	stats.Samplers = samplers;
+	stats.PipelineStates = pipelineStates;
+	stats.BufferBytes = bufferBytes;
+	stats.TextureBytes = textureBytes;
+	return stats;
+}
+
+
+// --------------------------------------------------------
+// Lays out the shader's constant buffer and registers
+//
+// - HLSL packs constants into 16 byte registers, and starts
+//   a new register for anything that would straddle one
+// --------------------------------------------------------
+NullRenderShader::NullRenderShader(
+	NullRenderContext* context,
+	const std::vector<Variable>& variableList,
+	const std::vector<std::string>& textureList,
+	const std::vector<std::string>& samplerList)
+	:
+	context(context)
+{
+	unsigned int offset = 0;
+	for (const Variable& variable : variableList)
+	{
+		if (offset % 16 + variable.Size > 16)
+			offset = (offset + 15) & ~15u;
+		variables[variable.Name] = { offset, variable.Size };
+		offset += variable.Size;
+	}
+	if (offset > 0)
+		AddConstantBuffer((offset + 15) & ~15u);
+
+	for (unsigned int i = 0; i < textureList.size(); i++)
+		textureSlots[textureList[i]] = (int)i;
+	for (unsigned int i = 0; i < samplerList.size(); i++)
+		samplerSlots[samplerList[i]] = (int)i;
+}
+
+// --------------------------------------------------------
+// A shader that's only raw constant buffers, in registers
+// zero and up (for replaying captured ones)
+// --------------------------------------------------------
+NullRenderShader::NullRenderShader(NullRenderContext* context, const std::vector<unsigned int>& constantBufferSizes)
+	:
+	context(context)
+{
+	for (unsigned int size : constantBufferSizes)
+		AddConstantBuffer((size + 15) & ~15u);
+}
+
+void NullRenderShader::AddConstantBuffer(unsigned int size)
+{
+	ConstantBuffer buffer = {};
+	buffer.LocalData.assign(size, 0);
+	constantBuffers.push_back(buffer);
+}
+
+int NullRenderShader::GetTextureSlot(const std::string& name)
+{
+	std::unordered_map<std::string, int>::iterator it = textureSlots.find(name);
+	return it == textureSlots.end() ? -1 : it->second;
+}
+
+int NullRenderShader::GetSamplerSlot(const std::string& name)
+{
+	std::unordered_map<std::string, int>::iterator it = samplerSlots.find(name);
+	return it == samplerSlots.end() ? -1 : it->second;
+}
+
+// --------------------------------------------------------
+// Copies into the local constant data, as SimpleShader does
+// - Fails for unknown names and data bigger than the variable
+// --------------------------------------------------------
+bool NullRenderShader::SetData(std::string name, const void* data, unsigned int size)
+{
+	std::unordered_map<std::string, VariableInfo>::iterator it = variables.find(name);
+	if (it == variables.end() || size > it->second.Size)
+		return false;
+
+	memcpy(&constantBuffers[0].LocalData[it->second.Offset], data, size);
+	return true;
+}
+
+void NullRenderShader::CopyAllBufferData()
+{
+	for (ConstantBuffer& buffer : constantBuffers)
+	{
+		buffer.RingFirstConstant = context->UploadConstants((unsigned int)buffer.LocalData.size());
+		buffer.Copied = true;
+	}
+	context->RebindConstants(this);
+}
+
+// --------------------------------------------------------
+// Each constant buffer's ring slice, once they've been copied
+// --------------------------------------------------------
+bool NullRenderShader::GetConstantBufferRanges(RenderConstantBufferRanges* ranges)
+{
+	ranges->Count = 0;
+	for (unsigned int i = 0; i < constantBuffers.size(); i++)
+	{
+		if (!constantBuffers[i].Copied || ranges->Count == RenderConstantBufferRanges::MaxBuffers)
+			return false;
+
+		ranges->BindIndex[ranges->Count] = i;
+		ranges->FirstConstant[ranges->Count] = constantBuffers[i].RingFirstConstant;
+		ranges->NumConstants[ranges->Count] = (unsigned int)constantBuffers[i].LocalData.size() / 16;
+		ranges->Count++;
+	}
+	return true;
+}
+
+unsigned int NullRenderShader::GetConstantBufferSize(unsigned int index)
+{
+	return index < constantBuffers.size() ? (unsigned int)constantBuffers[index].LocalData.size() : 0;
+}
+
+const void* NullRenderShader::GetConstantBufferData(unsigned int index)
+{
+	return index < constantBuffers.size() ? constantBuffers[index].LocalData.data() : 0;
+}
+
+bool NullRenderShader::SetConstantBufferData(unsigned int index, const void* data, unsigned int size)
+{
+	if (index >= constantBuffers.size() || size > constantBuffers[index].LocalData.size())
+		return false;
+
+	memcpy(constantBuffers[index].LocalData.data(), data, size);
+	return true;
+}
+
+
+NullRenderContext::NullRenderContext()
+	:
+	ringOffset(0),
+	current(),
+	lastFrame()
+{
+	Invalidate();
+}
+
+void NullRenderContext::BeginFrame()
+{
+	lastFrame = current;
+	current = {};
+}
+
+// --------------------------------------------------------
+// Forgets all shadowed state, so the next bind of
+// everything counts as a change
+// --------------------------------------------------------
+void NullRenderContext::Invalidate()
+{
+	pipelineState = UnknownBinding;
+	vertexBuffer = UnknownBinding;
+	vertexStride = UnknownValue;
+	vertexOffset = UnknownValue;
+	indexBuffer = UnknownBinding;
+	indexOffset = UnknownValue;
+	for (StageState& stage : stages)
+	{
+		stage.Shader = UnknownBinding;
+		for (unsigned int i = 0; i < MaxConstantBuffers; i++)
+			stage.ConstantBuffers[i] = { UnknownBinding, UnknownValue, UnknownValue };
+		for (unsigned int i = 0; i < MaxTextures; i++)
+			stage.Textures[i] = UnknownBinding;
+		for (unsigned int i = 0; i < MaxSamplers; i++)
+			stage.Samplers[i] = UnknownBinding;
+	}
+}
+
+void NullRenderContext::Count(bool changed)
+{
+	current.Binds++;
+	if (!changed)
+		current.RedundantBinds++;
+}
+
+void NullRenderContext::BindConstants(StageState& stage, unsigned int slot, const void* buffer, unsigned int firstConstant, unsigned int numConstants)
+{
+	if (slot >= MaxConstantBuffers)
+	{
+		Count(true);
+		return;
+	}
+
+	ConstantBufferBinding& bound = stage.ConstantBuffers[slot];
+	bool changed = bound.Buffer != buffer || bound.FirstConstant != firstConstant || bound.NumConstants != numConstants;
+	bound = { buffer, firstConstant, numConstants };
+	Count(changed);
+}
+
+// --------------------------------------------------------
+// Takes the next aligned slice of the ring, wrapping when
+// it runs out
+//
+// Returns the slice's first 16 byte constant
+// --------------------------------------------------------
+unsigned int NullRenderContext::UploadConstants(unsigned int size)
+{
+	unsigned int alignedSize = (size + RingAlignment - 1) & ~(RingAlignment - 1);
+	if (ringOffset + alignedSize > RingSize)
+		ringOffset = 0;
+
+	unsigned int first = ringOffset / 16;
+	ringOffset += alignedSize;
+	current.BytesUploaded += size;
+	return first;
+}
+
+// --------------------------------------------------------
+// Binds a shader's latest constants on every stage it's
+// bound to, as a copied SimpleShader does
+// --------------------------------------------------------
+void NullRenderContext::RebindConstants(RenderShader* shader)
+{
+	for (StageState& state : stages)
+	{
+		if (state.Shader != shader)
+			continue;
+
+		RenderConstantBufferRanges ranges;
+		if (!shader->GetConstantBufferRanges(&ranges))
+			continue;
+		for (unsigned int i = 0; i < ranges.Count; i++)
+			BindConstants(state, ranges.BindIndex[i], &ringOffset, ranges.FirstConstant[i], ranges.NumConstants[i]);
+	}
+}
+
+void NullRenderContext::SetPipelineState(RenderPipelineState* state)
+{
+	Count(pipelineState != state);
+	pipelineState = state;
+}
+
+void NullRenderContext::SetVertexBuffer(RenderBuffer* buffer, unsigned int stride, unsigned int offset)
+{
+	Count(vertexBuffer != buffer || vertexStride != stride || vertexOffset != offset);
+	vertexBuffer = buffer;
+	vertexStride = stride;
+	vertexOffset = offset;
+}
+
+void NullRenderContext::SetIndexBuffer(RenderBuffer* buffer, unsigned int offset)
+{
+	Count(indexBuffer != buffer || indexOffset != offset);
+	indexBuffer = buffer;
+	indexOffset = offset;
+}
+
+// --------------------------------------------------------
+// Binds the shader, then each of its constant ranges, as
+// separate binds (as a ring-backed SimpleShader does)
+// --------------------------------------------------------
+void NullRenderContext::SetShader(Stage stage, RenderShader* shader, const RenderConstantBufferRanges* ranges)
+{
+	StageState& state = stages[stage];
+	Count(state.Shader != shader);
+	state.Shader = shader;
+	if (!shader)
+		return;
+
+	RenderConstantBufferRanges latest;
+	if (!ranges)
+	{
+		if (!shader->GetConstantBufferRanges(&latest))
+			return;
+		ranges = &latest;
+	}
+
+	// The ring is the only constant buffer that can't be a real buffer's address
+	for (unsigned int i = 0; i < ranges->Count; i++)
+		BindConstants(state, ranges->BindIndex[i], &ringOffset, ranges->FirstConstant[i], ranges->NumConstants[i]);
+}
+
+void NullRenderContext::SetConstantBuffer(Stage stage, unsigned int slot, RenderBuffer* buffer)
+{
+	BindConstants(stages[stage], slot, buffer, 0, UnknownValue - 1);
+}
+
+void NullRenderContext::SetTextures(Stage stage, unsigned int startSlot, unsigned int count, RenderTexture* const* textures)
+{
+	StageState& state = stages[stage];
+	bool changed = startSlot + count > MaxTextures;
+	for (unsigned int i = 0; i < count && startSlot + i < MaxTextures; i++)
+	{
+		if (state.Textures[startSlot + i] != textures[i])
+		{
+			state.Textures[startSlot + i] = textures[i];
+			changed = true;
+		}
+	}
+	Count(changed);
+}
+
+void NullRenderContext::SetSamplers(Stage stage, unsigned int startSlot, unsigned int count, RenderSampler* const* samplers)
+{
+	StageState& state = stages[stage];
+	bool changed = startSlot + count > MaxSamplers;
+	for (unsigned int i = 0; i < count && startSlot + i < MaxSamplers; i++)
+	{
+		if (state.Samplers[startSlot + i] != samplers[i])
+		{
+			state.Samplers[startSlot + i] = samplers[i];
+			changed = true;
+		}
+	}
+	Count(changed);
+}
+
+void NullRenderContext::UpdateBuffer(RenderBuffer* buffer, const void* /*data*/, unsigned int size)
+{
+	unsigned int byteWidth = buffer->GetDesc().ByteWidth;
+	current.BytesUploaded += size < byteWidth ? size : byteWidth;
+}
+
+void NullRenderContext::DrawIndexed(unsigned int indexCount, unsigned int /*startIndex*/, int /*baseVertex*/)
+{
+	current.Draws++;
+	current.Indices += indexCount;
+}
+
+void NullRenderContext::DrawIndexedIndirect(RenderBuffer* /*argsBuffer*/, unsigned int /*argsOffset*/)
+{
+	current.Draws++;
+	current.IndirectDraws++;
+}
+
+void NullRenderContext::Dispatch(unsigned int /*groupsX*/, unsigned int /*groupsY*/, unsigned int /*groupsZ*/)
+{
+	current.Dispatches++;
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "RenderDevice.h"
+
+class NullRenderContext;
+
+// --------------------------------------------------------
+// A RenderDevice with no GPU behind it
+//
+// - Resources are just ids and sizes, and nothing is drawn
+// - Everything is counted instead: resources and bytes
+//   created here, and draws, binds (issued and redundant)
+//   and bytes uploaded on each NullRenderContext
+// - So scene and submission code can be run, and its CPU
+//   cost and redundant state measured, without a GPU or
+//   any graphics API
+// - Portable C++ - builds anywhere
+// --------------------------------------------------------
+class NullRenderDevice : public RenderDevice
+{
+public:
+	// Totals since the device was made
+	struct Stats
+	{
+		unsigned int Buffers;
+		unsigned int Textures;
+		unsigned int Samplers;
+		unsigned int PipelineStates;
+		uint64_t BufferBytes;
+		uint64_t TextureBytes;
+	};
+
+	NullRenderDevice();
+	~NullRenderDevice();
+
+	std::shared_ptr<RenderBuffer> CreateBuffer(const RenderBufferDesc& desc, const void* initialData);
+	std::shared_ptr<RenderTexture> CreateTexture(const RenderTextureDesc& desc, const void* const* data);
+	std::shared_ptr<RenderSampler> CreateSampler(const RenderSamplerDesc& desc);
+	std::shared_ptr<RenderPipelineState> CreatePipelineState(const RenderPipelineStateDesc& desc);
+
+	// The context shaders upload their constants through
+	NullRenderContext* GetImmediateContext() { return immediateContext.get(); }
+
+	Stats GetStats();
+
+private:
+	std::unique_ptr<NullRenderContext> immediateContext;
+	std::atomic<unsigned int> nextId;
+	std::atomic<unsigned int> buffers;
+	std::atomic<unsigned int> textures;
+	std::atomic<unsigned int> samplers;
+	std::atomic<unsigned int> pipelineStates;
+	std::atomic<uint64_t> bufferBytes;
+	std::atomic<uint64_t> textureBytes;
+};
+
+// --------------------------------------------------------
+// A RenderShader described by hand rather than compiled
+//
+// - Variables are packed into one constant buffer (register
+//   zero) by HLSL's rules, in the order given, and textures
+//   and samplers take registers in the order given
+// - Or it can be just raw constant buffers of given sizes,
+//   as captured from another shader
+// - Copying its data "uploads" it into the immediate
+//   context's constant ring, counting the bytes, and rebinds
+//   it if it's bound there, so it costs what a real
+//   ring-backed shader does
+// --------------------------------------------------------
+class NullRenderShader : public RenderShader
+{
+public:
+	struct Variable
+	{
+		std::string Name;
+		unsigned int Size;	// In bytes
+	};
+
+	NullRenderShader(
+		NullRenderContext* context,
+		const std::vector<Variable>& variables,
+		const std::vector<std::string>& textures,
+		const std::vector<std::string>& samplers);
+	NullRenderShader(NullRenderContext* context, const std::vector<unsigned int>& constantBufferSizes);
+
+	int GetTextureSlot(const std::string& name);
+	int GetSamplerSlot(const std::string& name);
+	bool SetData(std::string name, const void* data, unsigned int size);
+	void CopyAllBufferData();
+	bool GetConstantBufferRanges(RenderConstantBufferRanges* ranges);
+
+	unsigned int GetConstantBufferCount() { return (unsigned int)constantBuffers.size(); }
+	unsigned int GetConstantBufferSize(unsigned int index);
+	const void* GetConstantBufferData(unsigned int index);
+	bool SetConstantBufferData(unsigned int index, const void* data, unsigned int size);
+
+private:
+	struct VariableInfo
+	{
+		unsigned int Offset;
+		unsigned int Size;
+	};
+
+	struct ConstantBuffer
+	{
+		std::vector<unsigned char> LocalData;
+		bool Copied;
+		unsigned int RingFirstConstant;
+	};
+
+	NullRenderContext* context;
+	std::unordered_map<std::string, VariableInfo> variables;	// All in the first buffer
+	std::unordered_map<std::string, int> textureSlots;
+	std::unordered_map<std::string, int> samplerSlots;
+	std::vector<ConstantBuffer> constantBuffers;
+
+	void AddConstantBuffer(unsigned int size);
+};
+
+// --------------------------------------------------------
+// A RenderContext that counts instead of drawing
+//
+// - Shadows the bound state the way StateCache does, so a
+//   bind that changes nothing counts as redundant (but is
+//   still counted as issued - nothing is dropped here)
+// - Only takes resources and shaders from the null backend
+// --------------------------------------------------------
+class NullRenderContext : public RenderContext
+{
+public:
+	// Per frame, like StateCache's
+	struct Stats
+	{
+		unsigned int Draws;
+		unsigned int IndirectDraws;
+		unsigned int Dispatches;
+		uint64_t Indices;
+		unsigned int Binds;				// Every bind call
+		unsigned int RedundantBinds;	// Calls that changed nothing
+		uint64_t BytesUploaded;			// Buffer updates and shader constants
+	};
+
+	// How many slots of each kind are shadowed - binds outside of these always count as changes
+	static const unsigned int MaxConstantBuffers = 8;
+	static const unsigned int MaxTextures = 16;
+	static const unsigned int MaxSamplers = 8;
+	static const unsigned int StageCount = 3;
+
+	// Shader constants wrap around a ring of this many bytes
+	static const unsigned int RingSize = 1024 * 1024;
+
+	NullRenderContext();
+
+	void SetPipelineState(RenderPipelineState* state);
+	void SetVertexBuffer(RenderBuffer* buffer, unsigned int stride, unsigned int offset);
+	void SetIndexBuffer(RenderBuffer* buffer, unsigned int offset);
+	void SetShader(Stage stage, RenderShader* shader, const RenderConstantBufferRanges* ranges);
+	void SetConstantBuffer(Stage stage, unsigned int slot, RenderBuffer* buffer);
+	void SetTextures(Stage stage, unsigned int startSlot, unsigned int count, RenderTexture* const* textures);
+	void SetSamplers(Stage stage, unsigned int startSlot, unsigned int count, RenderSampler* const* samplers);
+	void UpdateBuffer(RenderBuffer* buffer, const void* data, unsigned int size);
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void DrawIndexedIndirect(RenderBuffer* argsBuffer, unsigned int argsOffset);
+	void Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
+
+	// Frame boundaries and state invalidation, as in StateCache
+	void BeginFrame();
+	void Invalidate();
+
+	Stats GetFrameStats() { return current; }
+	Stats GetLastFrameStats() { return lastFrame; }
+
+	// Where a shader's constants went in the ring, and rebinding them
+	// wherever the shader's bound after a copy (for NullRenderShader)
+	unsigned int UploadConstants(unsigned int size);
+	void RebindConstants(RenderShader* shader);
+
+private:
+	// A constant buffer binding - the ring is buffer zero
+	struct ConstantBufferBinding
+	{
+		const void* Buffer;
+		unsigned int FirstConstant;
+		unsigned int NumConstants;
+	};
+
+	struct StageState
+	{
+		const void* Shader;
+		ConstantBufferBinding ConstantBuffers[MaxConstantBuffers];
+		const void* Textures[MaxTextures];
+		const void* Samplers[MaxSamplers];
+	};
+
+	// Shadow copies of the bound state - pointers are only compared
+	const void* pipelineState;
+	const void* vertexBuffer;
+	unsigned int vertexStride;
+	unsigned int vertexOffset;
+	const void* indexBuffer;
+	unsigned int indexOffset;
+	StageState stages[StageCount];
+
+	unsigned int ringOffset;
+
+	Stats current;
+	Stats lastFrame;
+
+	void Count(bool changed);
+	void BindConstants(StageState& stage, unsigned int slot, const void* buffer, unsigned int firstConstant, unsigned int numConstants);
+};
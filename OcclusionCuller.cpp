@@ -0,0 +1,419 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+
+#include <chrono>
+#include <emmintrin.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+// Anything closer than this (in clip space w) counts as behind the camera
+static const float MinClipW = 0.0001f;
+
+// --------------------------------------------------------
+// Is a clip space point in front of the near plane (or
+// behind the camera)?
+// --------------------------------------------------------
+static bool IsNearClipped(const float clip[4])
+{
+	return clip[3] < MinClipW || clip[2] < 0.0f;
+}
+
+// --------------------------------------------------------
+// out = a * b, for row-major 4x4 matrices
+// --------------------------------------------------------
+static void MultiplyMatrices(const float a[16], const float b[16], float out[16])
+{
+	for (int row = 0; row < 4; row++)
+	{
+		for (int col = 0; col < 4; col++)
+		{
+			out[row * 4 + col] =
+				a[row * 4 + 0] * b[0 * 4 + col] +
+				a[row * 4 + 1] * b[1 * 4 + col] +
+				a[row * 4 + 2] * b[2 * 4 + col] +
+				a[row * 4 + 3] * b[3 * 4 + col];
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Transforms a point (w = 1) by a row-major matrix, giving
+// clip space x, y, z and w
+// --------------------------------------------------------
+static void TransformPoint(const float p[3], const float m[16], float out[4])
+{
+	for (int col = 0; col < 4; col++)
+		out[col] = p[0] * m[col] + p[1] * m[4 + col] + p[2] * m[8 + col] + m[12 + col];
+}
+
+// --------------------------------------------------------
+// Constructor - allocates the depth buffer and Hi-Z chain
+//
+// width, height - Depth buffer size, in pixels
+// --------------------------------------------------------
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height)
+	:
+	width((width + 3) & ~3u),
+	height(height < 1 ? 1 : height),
+	viewProjection(),
+	trianglesRasterized(0),
+	rasterizeTime(0.0),
+	hiZTime(0.0)
+{
+	depth.resize(this->width * this->height, 1.0f);
+
+	// Mips round up, so odd sizes never drop a row or column, and
+	// go all the way down to a single texel
+	unsigned int total = 0;
+	unsigned int w = this->width;
+	unsigned int h = this->height;
+	while (true)
+	{
+		mipOffsets.push_back(total);
+		mipWidths.push_back(w);
+		mipHeights.push_back(h);
+		total += w * h;
+		if (w == 1 && h == 1)
+			break;
+		w = (w + 1) / 2;
+		h = (h + 1) / 2;
+	}
+	hiZ.resize(total, 1.0f);
+}
+
+// --------------------------------------------------------
+// Forgets last frame's occluders
+// --------------------------------------------------------
+void OcclusionCuller::BeginFrame(const float viewProjection[16])
+{
+	memcpy(this->viewProjection, viewProjection, sizeof(this->viewProjection));
+	occluders.clear();
+	trianglesRasterized = 0;
+}
+
+// --------------------------------------------------------
+// Queues one occluder for Rasterize()
+// --------------------------------------------------------
+void OcclusionCuller::AddOccluder(
+	const float* positions,
+	unsigned int vertexCount,
+	const unsigned int* indices,
+	unsigned int indexCount,
+	const float world[16])
+{
+	Occluder occluder = {};
+	occluder.Positions = positions;
+	occluder.VertexCount = vertexCount;
+	occluder.Indices = indices;
+	occluder.IndexCount = indexCount - indexCount % 3;
+	MultiplyMatrices(world, viewProjection, occluder.WorldViewProjection);
+	occluders.push_back(occluder);
+}
+
+// --------------------------------------------------------
+// Sets up every triangle, rasterizes them band by band,
+// then builds the Hi-Z chain
+// --------------------------------------------------------
+void OcclusionCuller::Rasterize(JobSystem* jobSystem)
+{
+	// Each occluder's triangles go in their own range, so setup can run in any order
+	unsigned int triangleCount = 0;
+	for (Occluder& occluder : occluders)
+	{
+		occluder.FirstTriangle = triangleCount;
+		triangleCount += occluder.IndexCount / 3;
+	}
+	triangles.resize(triangleCount);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::fill(depth.begin(), depth.end(), 1.0f);
+
+	unsigned int occluderCount = (unsigned int)occluders.size();
+	unsigned int bandCount = (height + BandHeight - 1) / BandHeight;
+	if (jobSystem)
+	{
+		jobSystem->ParallelFor(0, occluderCount, 1,
+			[&](unsigned int begin, unsigned int end) { SetupTriangles(begin, end); });
+
+		// Each band is written by one job only, and every band sees
+		// the triangles in the same order, so the result never changes
+		jobSystem->ParallelFor(0, bandCount, 1,
+			[&](unsigned int begin, unsigned int end) { RasterizeBand(begin * BandHeight, end * BandHeight); });
+	}
+	else
+	{
+		SetupTriangles(0, occluderCount);
+		RasterizeBand(0, bandCount * BandHeight);
+	}
+
+	trianglesRasterized = 0;
+	for (const ScreenTriangle& triangle : triangles)
+	{
+		if (triangle.Valid)
+			trianglesRasterized++;
+	}
+
+	std::chrono::steady_clock::time_point rasterized = std::chrono::steady_clock::now();
+	BuildHiZ();
+	rasterizeTime = std::chrono::duration<double, std::milli>(rasterized - start).count();
+	hiZTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - rasterized).count();
+}
+
+// --------------------------------------------------------
+// Transforms a range of occluders' triangles into pixels,
+// dropping any that face away, cross the near plane or
+// miss the buffer entirely
+// --------------------------------------------------------
+void OcclusionCuller::SetupTriangles(unsigned int firstOccluder, unsigned int endOccluder)
+{
+	for (unsigned int o = firstOccluder; o < endOccluder; o++)
+	{
+		const Occluder& occluder = occluders[o];
+		for (unsigned int t = 0; t < occluder.IndexCount / 3; t++)
+		{
+			ScreenTriangle& triangle = triangles[occluder.FirstTriangle + t];
+			triangle.Valid = false;
+
+			bool clipped = false;
+			for (int v = 0; v < 3; v++)
+			{
+				unsigned int index = occluder.Indices[t * 3 + v];
+				if (index >= occluder.VertexCount)
+				{
+					clipped = true;
+					break;
+				}
+
+				// The part in front of the near plane would never be drawn,
+				// so it mustn't hide anything either
+				float clip[4];
+				TransformPoint(&occluder.Positions[index * 3], occluder.WorldViewProjection, clip);
+				if (IsNearClipped(clip))
+				{
+					clipped = true;
+					break;
+				}
+
+				// NDC to pixels, with y going down
+				float invW = 1.0f / clip[3];
+				triangle.X[v] = (clip[0] * invW * 0.5f + 0.5f) * width;
+				triangle.Y[v] = (clip[1] * invW * -0.5f + 0.5f) * height;
+				triangle.Z[v] = clip[2] * invW;
+			}
+			if (clipped)
+				continue;
+
+			// Front faces wind clockwise on screen, which is positive here
+			float area =
+				(triangle.X[1] - triangle.X[0]) * (triangle.Y[2] - triangle.Y[0]) -
+				(triangle.X[2] - triangle.X[0]) * (triangle.Y[1] - triangle.Y[0]);
+			if (area <= 0.0f)
+				continue;
+
+			// Pixel bounds, by the pixel centers the triangle could cover
+			float minX = fminf(triangle.X[0], fminf(triangle.X[1], triangle.X[2]));
+			float maxX = fmaxf(triangle.X[0], fmaxf(triangle.X[1], triangle.X[2]));
+			float minY = fminf(triangle.Y[0], fminf(triangle.Y[1], triangle.Y[2]));
+			float maxY = fmaxf(triangle.Y[0], fmaxf(triangle.Y[1], triangle.Y[2]));
+			if (maxX < 0.0f || maxY < 0.0f || minX >= (float)width || minY >= (float)height)
+				continue;
+
+			// A little loose is fine - the edge tests do the real work
+			triangle.MinX = (int)fmaxf(minX - 0.5f, 0.0f);
+			triangle.MinY = (int)fmaxf(minY - 0.5f, 0.0f);
+			triangle.MaxX = (int)fminf(fmaxf(maxX - 0.5f, 0.0f), width - 1.0f);
+			triangle.MaxY = (int)fminf(fmaxf(maxY - 0.5f, 0.0f), height - 1.0f);
+
+			triangle.Valid = true;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Rasterizes every triangle's share of a range of rows
+//
+// Edge functions and depth are evaluated for four pixels
+// at once, and depth keeps the nearest value per pixel
+// --------------------------------------------------------
+void OcclusionCuller::RasterizeBand(unsigned int firstRow, unsigned int endRow)
+{
+	if (endRow > height)
+		endRow = height;
+
+	const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for (const ScreenTriangle& triangle : triangles)
+	{
+		if (!triangle.Valid || triangle.MaxY < (int)firstRow || triangle.MinY >= (int)endRow)
+			continue;
+
+		int rowStart = triangle.MinY > (int)firstRow ? triangle.MinY : (int)firstRow;
+		int rowEnd = triangle.MaxY < (int)endRow - 1 ? triangle.MaxY : (int)endRow - 1;
+
+		// Edge (a -> b) is (xb - xa) * (py - ya) - (yb - ya) * (px - xa),
+		// which is non-negative inside a clockwise triangle
+		const float* x = triangle.X;
+		const float* y = triangle.Y;
+		float edgeDX[3], edgeDY[3], edgeC[3];
+		for (int e = 0; e < 3; e++)
+		{
+			int a = (e + 1) % 3;
+			int b = (e + 2) % 3;
+			edgeDX[e] = -(y[b] - y[a]);
+			edgeDY[e] = x[b] - x[a];
+			edgeC[e] = -(edgeDX[e] * x[a] + edgeDY[e] * y[a]);
+		}
+
+		// Depth as a plane over the screen, from the barycentric weights
+		// (edge e is opposite vertex e)
+		float area = edgeC[0] + edgeDX[0] * x[0] + edgeDY[0] * y[0];
+		float invArea = 1.0f / area;
+		float zDX = (edgeDX[0] * triangle.Z[0] + edgeDX[1] * triangle.Z[1] + edgeDX[2] * triangle.Z[2]) * invArea;
+		float zDY = (edgeDY[0] * triangle.Z[0] + edgeDY[1] * triangle.Z[1] + edgeDY[2] * triangle.Z[2]) * invArea;
+		float zC = (edgeC[0] * triangle.Z[0] + edgeC[1] * triangle.Z[1] + edgeC[2] * triangle.Z[2]) * invArea;
+
+		// Whole groups of four - width is a multiple of four, so these stay in bounds
+		int columnStart = triangle.MinX & ~3;
+		int columnEnd = triangle.MaxX;
+
+		for (int row = rowStart; row <= rowEnd; row++)
+		{
+			float py = row + 0.5f;
+			float* depthRow = &depth[row * width];
+			for (int column = columnStart; column <= columnEnd; column += 4)
+			{
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)column), pixelOffsets);
+
+				__m128 inside = _mm_cmpge_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeDX[0]), px), _mm_set1_ps(edgeDY[0] * py + edgeC[0])), zero);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeDX[1]), px), _mm_set1_ps(edgeDY[1] * py + edgeC[1])), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeDX[2]), px), _mm_set1_ps(edgeDY[2] * py + edgeC[2])), zero));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+
+				__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zDX), px), _mm_set1_ps(zDY * py + zC));
+				__m128 current = _mm_loadu_ps(depthRow + column);
+				__m128 nearest = _mm_min_ps(current, z);
+				_mm_storeu_ps(depthRow + column, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Reduces the depth buffer into the Hi-Z chain - each texel
+// holds the farthest depth of the 2x2 texels below it
+// (fewer along an odd edge)
+// --------------------------------------------------------
+void OcclusionCuller::BuildHiZ()
+{
+	memcpy(hiZ.data(), depth.data(), depth.size() * sizeof(float));
+
+	for (unsigned int mip = 1; mip < mipOffsets.size(); mip++)
+	{
+		const float* source = hiZ.data() + mipOffsets[mip - 1];
+		float* dest = hiZ.data() + mipOffsets[mip];
+		unsigned int sourceWidth = mipWidths[mip - 1];
+		unsigned int sourceHeight = mipHeights[mip - 1];
+		unsigned int destWidth = mipWidths[mip];
+		unsigned int destHeight = mipHeights[mip];
+
+		for (unsigned int y = 0; y < destHeight; y++)
+		{
+			const float* row0 = source + (y * 2) * sourceWidth;
+			const float* row1 = y * 2 + 1 < sourceHeight ? row0 + sourceWidth : row0;
+			for (unsigned int x = 0; x < destWidth; x++)
+			{
+				unsigned int x0 = x * 2;
+				unsigned int x1 = x0 + 1 < sourceWidth ? x0 + 1 : x0;
+				dest[y * destWidth + x] = fmaxf(
+					fmaxf(row0[x0], row0[x1]),
+					fmaxf(row1[x0], row1[x1]));
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Tests a box against the Hi-Z chain
+//
+// The box's screen rectangle picks the mip where it spans
+// at most a couple of texels each way.  It's visible if
+// its nearest point is in front of the farthest occluder
+// depth in any of those texels.
+// --------------------------------------------------------
+bool OcclusionCuller::IsVisible(const float boxMin[3], const float boxMax[3], const float world[16])
+{
+	float worldViewProjection[16];
+	MultiplyMatrices(world, viewProjection, worldViewProjection);
+
+	float minX = 1.0f, minY = 1.0f, maxX = -1.0f, maxY = -1.0f;
+	float nearestZ = 1.0f;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		float p[3] =
+		{
+			(corner & 1) ? boxMax[0] : boxMin[0],
+			(corner & 2) ? boxMax[1] : boxMin[1],
+			(corner & 4) ? boxMax[2] : boxMin[2]
+		};
+		float clip[4];
+		TransformPoint(p, worldViewProjection, clip);
+
+		// Crossing the near plane - assume the worst
+		if (IsNearClipped(clip))
+			return true;
+
+		float invW = 1.0f / clip[3];
+		float ndcX = clip[0] * invW;
+		float ndcY = clip[1] * invW;
+		minX = fminf(minX, ndcX);
+		maxX = fmaxf(maxX, ndcX);
+		minY = fminf(minY, ndcY);
+		maxY = fmaxf(maxY, ndcY);
+		nearestZ = fminf(nearestZ, clip[2] * invW);
+	}
+
+	// Entirely off screen, or past the far plane
+	if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f || nearestZ > 1.0f)
+		return false;
+
+	// To pixels (y flips), clamped to the buffer
+	float left = fmaxf((minX * 0.5f + 0.5f) * width, 0.0f);
+	float right = fminf((maxX * 0.5f + 0.5f) * width, width - 1.0f);
+	float top = fmaxf((maxY * -0.5f + 0.5f) * height, 0.0f);
+	float bottom = fminf((minY * -0.5f + 0.5f) * height, height - 1.0f);
+
+	// The first mip where the rectangle spans no more than two texels each way
+	unsigned int mip = 0;
+	float span = fmaxf(right - left, bottom - top);
+	while (span > 2.0f && mip + 1 < mipOffsets.size())
+	{
+		span *= 0.5f;
+		mip++;
+	}
+
+	unsigned int mipWidth = mipWidths[mip];
+	unsigned int mipHeight = mipHeights[mip];
+	unsigned int x0 = (unsigned int)left >> mip;
+	unsigned int x1 = (unsigned int)right >> mip;
+	unsigned int y0 = (unsigned int)top >> mip;
+	unsigned int y1 = (unsigned int)bottom >> mip;
+	if (x1 >= mipWidth) x1 = mipWidth - 1;
+	if (y1 >= mipHeight) y1 = mipHeight - 1;
+
+	const float* texels = hiZ.data() + mipOffsets[mip];
+	for (unsigned int y = y0; y <= y1; y++)
+	{
+		for (unsigned int x = x0; x <= x1; x++)
+		{
+			if (nearestZ <= texels[y * mipWidth + x])
+				return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+
+class JobSystem;
+
+// --------------------------------------------------------
+// Software occlusion culling on the CPU
+//
+// - A handful of occluder meshes are rasterized, depth only,
+//   into a small buffer (256x128 by default) using SSE, four
+//   pixels at a time
+// - Rasterizing is split into bands of rows, one job each,
+//   so every band is written by exactly one thread
+// - The depth buffer is reduced into a Hi-Z mip chain, each
+//   texel keeping the farthest depth of the four below it,
+//   so a bounding box can be tested against a few texels at
+//   whatever level its screen rectangle fits
+// - Everything is conservative: triangles crossing the near
+//   plane are dropped as occluders, and boxes crossing it
+//   are always visible
+// - Matrices are row-major, for row vectors (as DirectXMath
+//   stores them), and there are no graphics dependencies,
+//   so it can run (and be measured) anywhere
+// --------------------------------------------------------
+class OcclusionCuller
+{
+public:
+	// width must be a multiple of four
+	OcclusionCuller(unsigned int width = 256, unsigned int height = 128);
+
+	// Starts a new frame from the camera's view * projection
+	void BeginFrame(const float viewProjection[16]);
+
+	// Queues an occluder - the arrays must stay valid until Rasterize()
+	//
+	// positions - Three floats per vertex, in object space
+	// world     - The occluder's world matrix
+	void AddOccluder(
+		const float* positions,
+		unsigned int vertexCount,
+		const unsigned int* indices,
+		unsigned int indexCount,
+		const float world[16]);
+
+	// Draws the queued occluders and builds the Hi-Z chain,
+	// across the job system's threads if one is given
+	void Rasterize(JobSystem* jobSystem);
+
+	// Could any part of this object space box be visible?
+	bool IsVisible(const float boxMin[3], const float boxMax[3], const float world[16]);
+
+	// Getters
+	unsigned int GetWidth() { return width; }
+	unsigned int GetHeight() { return height; }
+	unsigned int GetMipCount() { return (unsigned int)mipOffsets.size(); }
+	unsigned int GetMipWidth(unsigned int mip) { return mipWidths[mip]; }
+	unsigned int GetMipHeight(unsigned int mip) { return mipHeights[mip]; }
+	const float* GetMip(unsigned int mip) { return hiZ.data() + mipOffsets[mip]; }
+	const float* GetDepth() { return depth.data(); }
+	unsigned int GetTrianglesRasterized() { return trianglesRasterized; }
+
+	// How long the last Rasterize() spent drawing, then building the Hi-Z chain, in ms
+	double GetRasterizeTime() { return rasterizeTime; }
+	double GetHiZTime() { return hiZTime; }
+
+	// Rows per rasterizing job
+	static const unsigned int BandHeight = 16;
+
+private:
+	struct Occluder
+	{
+		const float* Positions;
+		unsigned int VertexCount;
+		const unsigned int* Indices;
+		unsigned int IndexCount;
+		float WorldViewProjection[16];
+		unsigned int FirstTriangle;
+	};
+
+	// A triangle ready to rasterize, in pixels
+	struct ScreenTriangle
+	{
+		float X[3];
+		float Y[3];
+		float Z[3];
+		int MinX, MinY, MaxX, MaxY;	// Inclusive pixel bounds, already clipped to the buffer
+		bool Valid;					// False if culled during setup
+	};
+
+	unsigned int width;
+	unsigned int height;
+	float viewProjection[16];
+
+	std::vector<Occluder> occluders;
+	std::vector<ScreenTriangle> triangles;
+	std::vector<float> depth;
+	std::vector<float> hiZ;				// Every mip, one after another - mip 0 is a copy of depth
+	std::vector<unsigned int> mipOffsets;
+	std::vector<unsigned int> mipWidths;
+	std::vector<unsigned int> mipHeights;
+	unsigned int trianglesRasterized;
+	double rasterizeTime;
+	double hiZTime;
+
+	void SetupTriangles(unsigned int firstOccluder, unsigned int endOccluder);
+	void RasterizeBand(unsigned int firstRow, unsigned int endRow);
+	void BuildHiZ();
+};
@@ -1,5 +1,7 @@
 #include "structs.hlsli"
 #include "LightHeader.hlsli"
+#include "ClusterHeader.hlsli"
+#include "ShadowHeader.hlsli"
 #include "TextureFunctions.hlsli"
 
 // The texture set
@@ -9,16 +11,38 @@ Texture2D RoughnessMap		: register(t2);
 Texture2D MetalnessMap		: register(t3);
 SamplerState BasicSampler	: register(s0);	// "s" registers for samplers
 
+// Cascaded shadows for one directional light
+Texture2DArray ShadowMap				: register(t7);
+SamplerComparisonState ShadowSampler	: register(s1);
+
+// Point and spot light shadows, all in one atlas
+Texture2D ShadowAtlas						: register(t8);
+StructuredBuffer<ShadowTile> ShadowTiles	: register(t9);
+
+// Every light in the scene, uploaded once per frame by the LightManager
+// - Directional lights come first, and light every pixel
+// - The rest are only looked at through the pixel's cluster
+StructuredBuffer<Light> Lights					: register(t4);
+StructuredBuffer<uint> ClusterLightCounts		: register(t5);
+StructuredBuffer<uint> ClusterLightIndices		: register(t6);
+
 // Big External Data cbuffer
 cbuffer externalData		: register(b0) // b0 means the first buffer register
 {
 	float4 colorTint;
 	float3 cameraPosition;
-	Light directionalLight1;
-	Light directionalLight2;
-	Light directionalLight3;
-	Light pointLight1;
-	Light pointLight2;
+	uint directionalLightCount;
+	float2 clusterTileScale;
+	float2 clusterNearFar;
+	float clusterDepthScale;
+	float clusterDepthBias;
+	matrix shadowViewProjection[MAX_SHADOW_CASCADES];
+	float4 cascadeSplits;	// Far edge of each cascade, in view space depth
+	int shadowLightIndex;	// -1 if no light casts shadows
+	uint cascadeCount;
+	int shadowFilterRadius;	// 0 for one bilinear comparison, 1 for 3x3 PCF, 2 for 5x5
+	float shadowMapSize;
+	float shadowAtlasSize;
 }
 
 // --------------------------------------------------------
@@ -50,12 +74,41 @@ float4 main(VertexToPixel input) : SV_TARGET
 	float3 specColor = GetSpecularColor(surfaceColor, metalness);
 
 	// Add light toghether
-	float3 returnedLight =
-		DirectionalLight(directionalLight1, normal, roughness, metalness, specColor, surfaceColor, colorTint, view) +
-		DirectionalLight(directionalLight2, normal, roughness, metalness, specColor, surfaceColor, colorTint, view) +
-		DirectionalLight(directionalLight3, normal, roughness, metalness, specColor, surfaceColor, colorTint, view) +
-		PointLight(pointLight1, normal, roughness, metalness, specColor, surfaceColor, colorTint, view, input.worldPosition) +
-		PointLight(pointLight2, normal, roughness, metalness, specColor, surfaceColor, colorTint, view, input.worldPosition);
+	float viewZ = GetViewDepth(input.screenPosition.z, clusterNearFar);
+	float3 returnedLight = float3(0, 0, 0);
+	for (uint i = 0; i < directionalLightCount; i++)
+	{
+		float3 lightAmount = DirectionalLight(Lights[i], normal, roughness, metalness, specColor, surfaceColor, colorTint, view);
+		if ((int)i == shadowLightIndex)
+		{
+			uint cascade = GetShadowCascade(viewZ, cascadeSplits, cascadeCount);
+			lightAmount *= SampleCascadedShadow(ShadowMap, ShadowSampler, shadowViewProjection[min(cascade, MAX_SHADOW_CASCADES - 1)], cascade, input.worldPosition, shadowFilterRadius, shadowMapSize);
+		}
+		returnedLight += lightAmount;
+	}
+
+	// Only the point and spot lights that reach this pixel's cluster
+	uint cluster = GetClusterIndex(input.screenPosition, viewZ, clusterTileScale, clusterDepthScale, clusterDepthBias);
+	uint clusterLightCount = ClusterLightCounts[cluster];
+	uint firstIndex = cluster * MAX_LIGHTS_PER_CLUSTER;
+	for (uint j = 0; j < clusterLightCount; j++)
+	{
+		Light light = Lights[ClusterLightIndices[firstIndex + j]];
+		float3 lightAmount = light.Type == LIGHT_TYPE_SPOT ?
+			SpotLight(light, normal, roughness, metalness, specColor, surfaceColor, colorTint, view, input.worldPosition) :
+			PointLight(light, normal, roughness, metalness, specColor, surfaceColor, colorTint, view, input.worldPosition);
+
+		[branch]
+		if (light.ShadowTileIndex >= 0)
+		{
+			// Point lights have one tile per cube face
+			uint tileIndex = light.ShadowTileIndex;
+			if (light.Type == LIGHT_TYPE_POINT)
+				tileIndex += GetCubeFace(input.worldPosition - light.Position);
+			lightAmount *= SampleAtlasShadow(ShadowAtlas, ShadowSampler, ShadowTiles[tileIndex], input.worldPosition, shadowAtlasSize);
+		}
+		returnedLight += lightAmount;
+	}
 
 	// Just return the input color
 	// - This color (like most values passing through the rasterizer) is 
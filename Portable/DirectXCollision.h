@@ -0,0 +1,96 @@
+#pragma once
+
+#include "DirectXMath.h"
+#include <float.h>
+
+// --------------------------------------------------------
+// A plain C++ stand-in for the parts of DirectXCollision
+// the scene classes use (see DirectXMath.h in this folder)
+// --------------------------------------------------------
+namespace DirectX
+{
+	// --------------------------------------------------------
+	// An axis-aligned box, as a center and half-sizes
+	// --------------------------------------------------------
+	struct BoundingBox
+	{
+		XMFLOAT3 Center;
+		XMFLOAT3 Extents;
+
+		BoundingBox() : Center(0, 0, 0), Extents(1, 1, 1) {}
+		BoundingBox(const XMFLOAT3& center, const XMFLOAT3& extents) : Center(center), Extents(extents) {}
+
+		// Bounds the eight corners once they're transformed
+		void Transform(BoundingBox& out, FXMMATRIX m) const
+		{
+			XMVECTOR center = XMLoadFloat3(&Center);
+			XMVECTOR extents = XMLoadFloat3(&Extents);
+			XMVECTOR lo = XMVectorReplicate(FLT_MAX);
+			XMVECTOR hi = XMVectorReplicate(-FLT_MAX);
+			for (int i = 0; i < 8; i++)
+			{
+				XMVECTOR corner = XMVectorSet(
+					(i & 1) ? 1.0f : -1.0f,
+					(i & 2) ? 1.0f : -1.0f,
+					(i & 4) ? 1.0f : -1.0f,
+					0);
+				corner = XMVector3TransformCoord(XMVectorAdd(center, XMVectorMultiply(corner, extents)), m);
+				lo = XMVectorMin(lo, corner);
+				hi = XMVectorMax(hi, corner);
+			}
+			XMStoreFloat3(&out.Center, XMVectorScale(XMVectorAdd(lo, hi), 0.5f));
+			XMStoreFloat3(&out.Extents, XMVectorScale(XMVectorSubtract(hi, lo), 0.5f));
+		}
+
+		// Points are stride bytes apart, so they can be read straight out of vertices
+		static void CreateFromPoints(BoundingBox& out, size_t count, const XMFLOAT3* points, size_t stride)
+		{
+			XMVECTOR lo = XMVectorReplicate(FLT_MAX);
+			XMVECTOR hi = XMVectorReplicate(-FLT_MAX);
+			const unsigned char* bytes = reinterpret_cast<const unsigned char*>(points);
+			for (size_t i = 0; i < count; i++)
+			{
+				XMVECTOR point = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(bytes + i * stride));
+				lo = XMVectorMin(lo, point);
+				hi = XMVectorMax(hi, point);
+			}
+			XMStoreFloat3(&out.Center, XMVectorScale(XMVectorAdd(lo, hi), 0.5f));
+			XMStoreFloat3(&out.Extents, XMVectorScale(XMVectorSubtract(hi, lo), 0.5f));
+		}
+	};
+
+	// --------------------------------------------------------
+	// A box rotated by a quaternion, as a center and half-sizes
+	// --------------------------------------------------------
+	struct BoundingOrientedBox
+	{
+		XMFLOAT3 Center;
+		XMFLOAT3 Extents;
+		XMFLOAT4 Orientation;
+
+		BoundingOrientedBox() : Center(0, 0, 0), Extents(1, 1, 1), Orientation(0, 0, 0, 1) {}
+		BoundingOrientedBox(const XMFLOAT3& center, const XMFLOAT3& extents, const XMFLOAT4& orientation) :
+			Center(center), Extents(extents), Orientation(orientation) {}
+
+		// The matrix may rotate, translate and scale, but not shear
+		void Transform(BoundingOrientedBox& out, FXMMATRIX m) const
+		{
+			XMMATRIX rotation = m;
+			for (int i = 0; i < 3; i++)
+				rotation.r[i] = XMVector3Normalize(m.r[i]);
+			rotation.r[3] = XMVectorSet(0, 0, 0, 1);
+
+			XMVECTOR orientation = XMQuaternionMultiply(XMLoadFloat4(&Orientation), XMQuaternionRotationMatrix(rotation));
+			XMVECTOR center = XMVector3Transform(XMLoadFloat3(&Center), m);
+			XMVECTOR scale = XMVectorSet(
+				XMVectorGetX(XMVector3Length(m.r[0])),
+				XMVectorGetX(XMVector3Length(m.r[1])),
+				XMVectorGetX(XMVector3Length(m.r[2])),
+				0);
+
+			XMStoreFloat3(&out.Center, center);
+			XMStoreFloat3(&out.Extents, XMVectorMultiply(XMLoadFloat3(&Extents), scale));
+			XMStoreFloat4(&out.Orientation, orientation);
+		}
+	};
+}
@@ -0,0 +1,532 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// --------------------------------------------------------
+// A plain C++ stand-in for the parts of DirectXMath the
+// scene classes use, for building them without Windows
+//
+// - Only CMakeLists.txt puts this folder on the include
+//   path, and only where there's no Windows SDK - the game
+//   always builds against the real DirectXMath
+// - Same names, layouts and conventions (row vectors,
+//   left-handed matrices), all scalar, so the same code
+//   gives the same answers to within float rounding
+// - Anything missing here is missing on purpose: add it
+//   when portable code needs it, matching DirectXMath's
+//   definition
+// --------------------------------------------------------
+namespace DirectX
+{
+	const float XM_PI = 3.141592654f;
+	const float XM_2PI = 6.283185307f;
+	const float XM_PIDIV2 = 1.570796327f;
+	const float XM_PIDIV4 = 0.785398163f;
+
+	const uint32_t XM_SELECT_0 = 0x00000000;
+	const uint32_t XM_SELECT_1 = 0xFFFFFFFF;
+
+	inline float XMConvertToRadians(float degrees) { return degrees * (XM_PI / 180.0f); }
+	inline float XMConvertToDegrees(float radians) { return radians * (180.0f / XM_PI); }
+
+	// --------------------------------------------------------
+	// Register types
+	// --------------------------------------------------------
+	struct XMVECTOR
+	{
+		union
+		{
+			float f[4];
+			uint32_t u[4];
+		};
+	};
+
+	struct XMMATRIX
+	{
+		XMVECTOR r[4];
+	};
+
+	typedef const XMVECTOR FXMVECTOR;
+	typedef const XMVECTOR GXMVECTOR;
+	typedef const XMVECTOR HXMVECTOR;
+	typedef const XMVECTOR& CXMVECTOR;
+	typedef const XMMATRIX FXMMATRIX;
+	typedef const XMMATRIX& CXMMATRIX;
+
+	// --------------------------------------------------------
+	// Storage types
+	// --------------------------------------------------------
+	struct XMFLOAT2
+	{
+		float x;
+		float y;
+
+		XMFLOAT2() = default;
+		constexpr XMFLOAT2(float x, float y) : x(x), y(y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x;
+		float y;
+		float z;
+
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float x, float y, float z) : x(x), y(y), z(z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x;
+		float y;
+		float z;
+		float w;
+
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	};
+
+	struct XMFLOAT4X4
+	{
+		union
+		{
+			struct
+			{
+				float _11, _12, _13, _14;
+				float _21, _22, _23, _24;
+				float _31, _32, _33, _34;
+				float _41, _42, _43, _44;
+			};
+			float m[4][4];
+		};
+
+		XMFLOAT4X4() = default;
+		XMFLOAT4X4(
+			float m00, float m01, float m02, float m03,
+			float m10, float m11, float m12, float m13,
+			float m20, float m21, float m22, float m23,
+			float m30, float m31, float m32, float m33) :
+			_11(m00), _12(m01), _13(m02), _14(m03),
+			_21(m10), _22(m11), _23(m12), _24(m13),
+			_31(m20), _32(m21), _33(m22), _34(m23),
+			_41(m30), _42(m31), _43(m32), _44(m33) {}
+		float operator() (size_t row, size_t column) const { return m[row][column]; }
+		float& operator() (size_t row, size_t column) { return m[row][column]; }
+	};
+
+	// --------------------------------------------------------
+	// Loading and storing
+	// --------------------------------------------------------
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w)
+	{
+		XMVECTOR v;
+		v.f[0] = x; v.f[1] = y; v.f[2] = z; v.f[3] = w;
+		return v;
+	}
+
+	inline XMVECTOR XMVectorReplicate(float value) { return XMVectorSet(value, value, value, value); }
+	inline XMVECTOR XMVectorZero() { return XMVectorSet(0, 0, 0, 0); }
+	inline XMVECTOR XMVectorSplatX(FXMVECTOR v) { return XMVectorReplicate(v.f[0]); }
+	inline float XMVectorGetX(FXMVECTOR v) { return v.f[0]; }
+	inline float XMVectorGetY(FXMVECTOR v) { return v.f[1]; }
+	inline float XMVectorGetZ(FXMVECTOR v) { return v.f[2]; }
+	inline float XMVectorGetW(FXMVECTOR v) { return v.f[3]; }
+
+	inline XMVECTOR XMLoadFloat2(const XMFLOAT2* source) { return XMVectorSet(source->x, source->y, 0, 0); }
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source) { return XMVectorSet(source->x, source->y, source->z, 0); }
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4* source) { return XMVectorSet(source->x, source->y, source->z, source->w); }
+
+	inline void XMStoreFloat2(XMFLOAT2* destination, FXMVECTOR v) { destination->x = v.f[0]; destination->y = v.f[1]; }
+	inline void XMStoreFloat3(XMFLOAT3* destination, FXMVECTOR v) { destination->x = v.f[0]; destination->y = v.f[1]; destination->z = v.f[2]; }
+	inline void XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v) { destination->x = v.f[0]; destination->y = v.f[1]; destination->z = v.f[2]; destination->w = v.f[3]; }
+
+	inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* source)
+	{
+		XMMATRIX m;
+		for (int i = 0; i < 4; i++)
+			m.r[i] = XMVectorSet(source->m[i][0], source->m[i][1], source->m[i][2], source->m[i][3]);
+		return m;
+	}
+
+	inline void XMStoreFloat4x4(XMFLOAT4X4* destination, FXMMATRIX m)
+	{
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				destination->m[i][j] = m.r[i].f[j];
+	}
+
+	// --------------------------------------------------------
+	// Component-wise vector operations
+	// --------------------------------------------------------
+	inline XMVECTOR XMVectorAdd(FXMVECTOR a, FXMVECTOR b) { return XMVectorSet(a.f[0] + b.f[0], a.f[1] + b.f[1], a.f[2] + b.f[2], a.f[3] + b.f[3]); }
+	inline XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) { return XMVectorSet(a.f[0] - b.f[0], a.f[1] - b.f[1], a.f[2] - b.f[2], a.f[3] - b.f[3]); }
+	inline XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return XMVectorSet(a.f[0] * b.f[0], a.f[1] * b.f[1], a.f[2] * b.f[2], a.f[3] * b.f[3]); }
+	inline XMVECTOR XMVectorDivide(FXMVECTOR a, FXMVECTOR b) { return XMVectorSet(a.f[0] / b.f[0], a.f[1] / b.f[1], a.f[2] / b.f[2], a.f[3] / b.f[3]); }
+	inline XMVECTOR XMVectorScale(FXMVECTOR v, float scale) { return XMVectorSet(v.f[0] * scale, v.f[1] * scale, v.f[2] * scale, v.f[3] * scale); }
+	inline XMVECTOR XMVectorNegate(FXMVECTOR v) { return XMVectorSet(-v.f[0], -v.f[1], -v.f[2], -v.f[3]); }
+	inline XMVECTOR XMVectorMin(FXMVECTOR a, FXMVECTOR b) { return XMVectorSet(fminf(a.f[0], b.f[0]), fminf(a.f[1], b.f[1]), fminf(a.f[2], b.f[2]), fminf(a.f[3], b.f[3])); }
+	inline XMVECTOR XMVectorMax(FXMVECTOR a, FXMVECTOR b) { return XMVectorSet(fmaxf(a.f[0], b.f[0]), fmaxf(a.f[1], b.f[1]), fmaxf(a.f[2], b.f[2]), fmaxf(a.f[3], b.f[3])); }
+	inline XMVECTOR XMVectorAbs(FXMVECTOR v) { return XMVectorSet(fabsf(v.f[0]), fabsf(v.f[1]), fabsf(v.f[2]), fabsf(v.f[3])); }
+	inline XMVECTOR XMVectorFloor(FXMVECTOR v) { return XMVectorSet(floorf(v.f[0]), floorf(v.f[1]), floorf(v.f[2]), floorf(v.f[3])); }
+
+	// Rounds halves to even, as DirectXMath does
+	inline XMVECTOR XMVectorRound(FXMVECTOR v) { return XMVectorSet(nearbyintf(v.f[0]), nearbyintf(v.f[1]), nearbyintf(v.f[2]), nearbyintf(v.f[3])); }
+
+	inline XMVECTOR XMVectorSelectControl(uint32_t i0, uint32_t i1, uint32_t i2, uint32_t i3)
+	{
+		XMVECTOR control;
+		control.u[0] = i0 ? XM_SELECT_1 : XM_SELECT_0;
+		control.u[1] = i1 ? XM_SELECT_1 : XM_SELECT_0;
+		control.u[2] = i2 ? XM_SELECT_1 : XM_SELECT_0;
+		control.u[3] = i3 ? XM_SELECT_1 : XM_SELECT_0;
+		return control;
+	}
+
+	// Takes each bit from b where the control's is set, and from a where it isn't
+	inline XMVECTOR XMVectorSelect(FXMVECTOR a, FXMVECTOR b, FXMVECTOR control)
+	{
+		XMVECTOR v;
+		for (int i = 0; i < 4; i++)
+			v.u[i] = (a.u[i] & ~control.u[i]) | (b.u[i] & control.u[i]);
+		return v;
+	}
+
+	// --------------------------------------------------------
+	// 3D vector operations
+	// - Results that are scalars come back in every component
+	// --------------------------------------------------------
+	inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorReplicate(a.f[0] * b.f[0] + a.f[1] * b.f[1] + a.f[2] * b.f[2]);
+	}
+
+	inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorSet(
+			a.f[1] * b.f[2] - a.f[2] * b.f[1],
+			a.f[2] * b.f[0] - a.f[0] * b.f[2],
+			a.f[0] * b.f[1] - a.f[1] * b.f[0],
+			0);
+	}
+
+	inline XMVECTOR XMVector3LengthSq(FXMVECTOR v) { return XMVector3Dot(v, v); }
+	inline XMVECTOR XMVector3Length(FXMVECTOR v) { return XMVectorReplicate(sqrtf(XMVectorGetX(XMVector3Dot(v, v)))); }
+
+	// Zero length stays zero, as in DirectXMath
+	inline XMVECTOR XMVector3Normalize(FXMVECTOR v)
+	{
+		float length = XMVectorGetX(XMVector3Length(v));
+		if (length > 0)
+			length = 1.0f / length;
+		return XMVectorScale(v, length);
+	}
+
+	// Row vector times matrix, with w taken as one and divided back out
+	inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v, FXMMATRIX m)
+	{
+		float out[4];
+		for (int i = 0; i < 4; i++)
+			out[i] = v.f[0] * m.r[0].f[i] + v.f[1] * m.r[1].f[i] + v.f[2] * m.r[2].f[i] + m.r[3].f[i];
+		float invW = 1.0f / out[3];
+		return XMVectorSet(out[0] * invW, out[1] * invW, out[2] * invW, 1.0f);
+	}
+
+	// Row vector times matrix, with w taken as one and kept
+	inline XMVECTOR XMVector3Transform(FXMVECTOR v, FXMMATRIX m)
+	{
+		float out[4];
+		for (int i = 0; i < 4; i++)
+			out[i] = v.f[0] * m.r[0].f[i] + v.f[1] * m.r[1].f[i] + v.f[2] * m.r[2].f[i] + m.r[3].f[i];
+		return XMVectorSet(out[0], out[1], out[2], out[3]);
+	}
+
+	// Row vector times matrix, with w taken as zero (directions)
+	inline XMVECTOR XMVector3TransformNormal(FXMVECTOR v, FXMMATRIX m)
+	{
+		float out[4];
+		for (int i = 0; i < 4; i++)
+			out[i] = v.f[0] * m.r[0].f[i] + v.f[1] * m.r[1].f[i] + v.f[2] * m.r[2].f[i];
+		return XMVectorSet(out[0], out[1], out[2], out[3]);
+	}
+
+	// --------------------------------------------------------
+	// Quaternions - (x, y, z) is the axis part, w the angle part
+	// --------------------------------------------------------
+
+	// Rolls around z, then pitches around x, then yaws around y
+	inline XMVECTOR XMQuaternionRotationRollPitchYaw(float pitch, float yaw, float roll)
+	{
+		float sp = sinf(pitch * 0.5f), cp = cosf(pitch * 0.5f);
+		float sy = sinf(yaw * 0.5f), cy = cosf(yaw * 0.5f);
+		float sr = sinf(roll * 0.5f), cr = cosf(roll * 0.5f);
+		return XMVectorSet(
+			sp * cy * cr + cp * sy * sr,
+			cp * sy * cr - sp * cy * sr,
+			cp * cy * sr - sp * sy * cr,
+			cp * cy * cr + sp * sy * sr);
+	}
+
+	inline XMVECTOR XMQuaternionRotationRollPitchYawFromVector(FXMVECTOR angles)
+	{
+		return XMQuaternionRotationRollPitchYaw(angles.f[0], angles.f[1], angles.f[2]);
+	}
+
+	// Rotates by q1, then by q2
+	inline XMVECTOR XMQuaternionMultiply(FXMVECTOR q1, FXMVECTOR q2)
+	{
+		return XMVectorSet(
+			q2.f[3] * q1.f[0] + q2.f[0] * q1.f[3] + q2.f[1] * q1.f[2] - q2.f[2] * q1.f[1],
+			q2.f[3] * q1.f[1] - q2.f[0] * q1.f[2] + q2.f[1] * q1.f[3] + q2.f[2] * q1.f[0],
+			q2.f[3] * q1.f[2] + q2.f[0] * q1.f[1] - q2.f[1] * q1.f[0] + q2.f[2] * q1.f[3],
+			q2.f[3] * q1.f[3] - q2.f[0] * q1.f[0] - q2.f[1] * q1.f[1] - q2.f[2] * q1.f[2]);
+	}
+
+	// The rotation in the top left 3x3 of m, which has to be a pure rotation
+	inline XMVECTOR XMQuaternionRotationMatrix(FXMMATRIX m)
+	{
+		const XMVECTOR* r = m.r;
+		float r22 = r[2].f[2];
+		if (r22 <= 0.0f)
+		{
+			float dif10 = r[1].f[1] - r[0].f[0];
+			float omr22 = 1.0f - r22;
+			if (dif10 <= 0.0f)
+			{
+				float fourXSqr = omr22 - dif10;
+				float inv4x = 0.5f / sqrtf(fourXSqr);
+				return XMVectorSet(fourXSqr * inv4x, (r[0].f[1] + r[1].f[0]) * inv4x, (r[0].f[2] + r[2].f[0]) * inv4x, (r[1].f[2] - r[2].f[1]) * inv4x);
+			}
+			float fourYSqr = omr22 + dif10;
+			float inv4y = 0.5f / sqrtf(fourYSqr);
+			return XMVectorSet((r[0].f[1] + r[1].f[0]) * inv4y, fourYSqr * inv4y, (r[1].f[2] + r[2].f[1]) * inv4y, (r[2].f[0] - r[0].f[2]) * inv4y);
+		}
+
+		float sum10 = r[1].f[1] + r[0].f[0];
+		float opr22 = 1.0f + r22;
+		if (sum10 <= 0.0f)
+		{
+			float fourZSqr = opr22 - sum10;
+			float inv4z = 0.5f / sqrtf(fourZSqr);
+			return XMVectorSet((r[0].f[2] + r[2].f[0]) * inv4z, (r[1].f[2] + r[2].f[1]) * inv4z, fourZSqr * inv4z, (r[0].f[1] - r[1].f[0]) * inv4z);
+		}
+		float fourWSqr = opr22 + sum10;
+		float inv4w = 0.5f / sqrtf(fourWSqr);
+		return XMVectorSet((r[1].f[2] - r[2].f[1]) * inv4w, (r[2].f[0] - r[0].f[2]) * inv4w, (r[0].f[1] - r[1].f[0]) * inv4w, fourWSqr * inv4w);
+	}
+
+	inline XMVECTOR XMVector3Rotate(FXMVECTOR v, FXMVECTOR q)
+	{
+		// v + 2w(u x v) + 2u x (u x v), for the unit quaternion (u, w)
+		XMVECTOR u = XMVectorSet(q.f[0], q.f[1], q.f[2], 0);
+		XMVECTOR uv = XMVector3Cross(u, v);
+		XMVECTOR uuv = XMVector3Cross(u, uv);
+		XMVECTOR result = XMVectorAdd(v, XMVectorScale(uv, 2.0f * q.f[3]));
+		result = XMVectorAdd(result, XMVectorScale(uuv, 2.0f));
+		result.f[3] = 0;
+		return result;
+	}
+
+	// --------------------------------------------------------
+	// Matrices - row vectors, so transforms apply left to right
+	// --------------------------------------------------------
+	inline XMMATRIX XMMatrixSet(
+		float m00, float m01, float m02, float m03,
+		float m10, float m11, float m12, float m13,
+		float m20, float m21, float m22, float m23,
+		float m30, float m31, float m32, float m33)
+	{
+		XMMATRIX m;
+		m.r[0] = XMVectorSet(m00, m01, m02, m03);
+		m.r[1] = XMVectorSet(m10, m11, m12, m13);
+		m.r[2] = XMVectorSet(m20, m21, m22, m23);
+		m.r[3] = XMVectorSet(m30, m31, m32, m33);
+		return m;
+	}
+
+	inline XMMATRIX XMMatrixIdentity()
+	{
+		return XMMatrixSet(
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, 1, 0,
+			0, 0, 0, 1);
+	}
+
+	inline XMMATRIX XMMatrixMultiply(FXMMATRIX a, CXMMATRIX b)
+	{
+		XMMATRIX m;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				m.r[i].f[j] =
+					a.r[i].f[0] * b.r[0].f[j] +
+					a.r[i].f[1] * b.r[1].f[j] +
+					a.r[i].f[2] * b.r[2].f[j] +
+					a.r[i].f[3] * b.r[3].f[j];
+		return m;
+	}
+
+	inline XMMATRIX XMMatrixTranspose(FXMMATRIX m)
+	{
+		XMMATRIX t;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				t.r[i].f[j] = m.r[j].f[i];
+		return t;
+	}
+
+	// Fills in the determinant if asked, and gives back all infinities
+	// (or NaNs) for a singular matrix rather than checking
+	inline XMMATRIX XMMatrixInverse(XMVECTOR* determinant, FXMMATRIX m)
+	{
+		float a[16];
+		for (int i = 0; i < 16; i++)
+			a[i] = m.r[i / 4].f[i % 4];
+
+		// Cofactors, by 2x2 sub-determinants of the top and bottom halves
+		float s0 = a[0] * a[5] - a[4] * a[1];
+		float s1 = a[0] * a[6] - a[4] * a[2];
+		float s2 = a[0] * a[7] - a[4] * a[3];
+		float s3 = a[1] * a[6] - a[5] * a[2];
+		float s4 = a[1] * a[7] - a[5] * a[3];
+		float s5 = a[2] * a[7] - a[6] * a[3];
+		float c5 = a[10] * a[15] - a[14] * a[11];
+		float c4 = a[9] * a[15] - a[13] * a[11];
+		float c3 = a[9] * a[14] - a[13] * a[10];
+		float c2 = a[8] * a[15] - a[12] * a[11];
+		float c1 = a[8] * a[14] - a[12] * a[10];
+		float c0 = a[8] * a[13] - a[12] * a[9];
+
+		float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+		if (determinant)
+			*determinant = XMVectorReplicate(det);
+		float invDet = 1.0f / det;
+
+		return XMMatrixSet(
+			(a[5] * c5 - a[6] * c4 + a[7] * c3) * invDet,
+			(-a[1] * c5 + a[2] * c4 - a[3] * c3) * invDet,
+			(a[13] * s5 - a[14] * s4 + a[15] * s3) * invDet,
+			(-a[9] * s5 + a[10] * s4 - a[11] * s3) * invDet,
+
+			(-a[4] * c5 + a[6] * c2 - a[7] * c1) * invDet,
+			(a[0] * c5 - a[2] * c2 + a[3] * c1) * invDet,
+			(-a[12] * s5 + a[14] * s2 - a[15] * s1) * invDet,
+			(a[8] * s5 - a[10] * s2 + a[11] * s1) * invDet,
+
+			(a[4] * c4 - a[5] * c2 + a[7] * c0) * invDet,
+			(-a[0] * c4 + a[1] * c2 - a[3] * c0) * invDet,
+			(a[12] * s4 - a[13] * s2 + a[15] * s0) * invDet,
+			(-a[8] * s4 + a[9] * s2 - a[11] * s0) * invDet,
+
+			(-a[4] * c3 + a[5] * c1 - a[6] * c0) * invDet,
+			(a[0] * c3 - a[1] * c1 + a[2] * c0) * invDet,
+			(-a[12] * s3 + a[13] * s1 - a[14] * s0) * invDet,
+			(a[8] * s3 - a[9] * s1 + a[10] * s0) * invDet);
+	}
+
+	inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+	{
+		return XMMatrixSet(
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, 1, 0,
+			x, y, z, 1);
+	}
+
+	inline XMMATRIX XMMatrixTranslationFromVector(FXMVECTOR offset) { return XMMatrixTranslation(offset.f[0], offset.f[1], offset.f[2]); }
+
+	inline XMMATRIX XMMatrixScaling(float x, float y, float z)
+	{
+		return XMMatrixSet(
+			x, 0, 0, 0,
+			0, y, 0, 0,
+			0, 0, z, 0,
+			0, 0, 0, 1);
+	}
+
+	inline XMMATRIX XMMatrixScalingFromVector(FXMVECTOR scale) { return XMMatrixScaling(scale.f[0], scale.f[1], scale.f[2]); }
+
+	// Rolls around z, then pitches around x, then yaws around y
+	inline XMMATRIX XMMatrixRotationRollPitchYaw(float pitch, float yaw, float roll)
+	{
+		float sp = sinf(pitch), cp = cosf(pitch);
+		float sy = sinf(yaw), cy = cosf(yaw);
+		float sr = sinf(roll), cr = cosf(roll);
+		return XMMatrixSet(
+			cr * cy + sr * sp * sy, sr * cp, sr * sp * cy - cr * sy, 0,
+			cr * sp * sy - sr * cy, cr * cp, sr * sy + cr * sp * cy, 0,
+			cp * sy, -sp, cp * cy, 0,
+			0, 0, 0, 1);
+	}
+
+	inline XMMATRIX XMMatrixRotationRollPitchYawFromVector(FXMVECTOR angles)
+	{
+		return XMMatrixRotationRollPitchYaw(angles.f[0], angles.f[1], angles.f[2]);
+	}
+
+	inline XMMATRIX XMMatrixLookToLH(FXMVECTOR eye, FXMVECTOR direction, FXMVECTOR up)
+	{
+		XMVECTOR r2 = XMVector3Normalize(direction);
+		XMVECTOR r0 = XMVector3Normalize(XMVector3Cross(up, r2));
+		XMVECTOR r1 = XMVector3Cross(r2, r0);
+		XMVECTOR negEye = XMVectorNegate(eye);
+		return XMMatrixSet(
+			r0.f[0], r1.f[0], r2.f[0], 0,
+			r0.f[1], r1.f[1], r2.f[1], 0,
+			r0.f[2], r1.f[2], r2.f[2], 0,
+			XMVectorGetX(XMVector3Dot(r0, negEye)),
+			XMVectorGetX(XMVector3Dot(r1, negEye)),
+			XMVectorGetX(XMVector3Dot(r2, negEye)),
+			1);
+	}
+
+	inline XMMATRIX XMMatrixLookAtLH(FXMVECTOR eye, FXMVECTOR focus, FXMVECTOR up)
+	{
+		return XMMatrixLookToLH(eye, XMVectorSubtract(focus, eye), up);
+	}
+
+	inline XMMATRIX XMMatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+	{
+		float height = 1.0f / tanf(fovAngleY * 0.5f);
+		float width = height / aspectRatio;
+		float range = farZ / (farZ - nearZ);
+		return XMMatrixSet(
+			width, 0, 0, 0,
+			0, height, 0, 0,
+			0, 0, range, 1,
+			0, 0, -range * nearZ, 0);
+	}
+
+	inline XMMATRIX XMMatrixOrthographicOffCenterLH(float left, float right, float bottom, float top, float nearZ, float farZ)
+	{
+		float width = 1.0f / (right - left);
+		float height = 1.0f / (top - bottom);
+		float range = 1.0f / (farZ - nearZ);
+		return XMMatrixSet(
+			width + width, 0, 0, 0,
+			0, height + height, 0, 0,
+			0, 0, range, 0,
+			-(left + right) * width, -(top + bottom) * height, -range * nearZ, 1);
+	}
+
+	// --------------------------------------------------------
+	// Operators, as DirectXMath defines them
+	// --------------------------------------------------------
+	inline XMVECTOR operator+ (FXMVECTOR v) { return v; }
+	inline XMVECTOR operator- (FXMVECTOR v) { return XMVectorNegate(v); }
+	inline XMVECTOR operator+ (FXMVECTOR a, FXMVECTOR b) { return XMVectorAdd(a, b); }
+	inline XMVECTOR operator- (FXMVECTOR a, FXMVECTOR b) { return XMVectorSubtract(a, b); }
+	inline XMVECTOR operator* (FXMVECTOR a, FXMVECTOR b) { return XMVectorMultiply(a, b); }
+	inline XMVECTOR operator/ (FXMVECTOR a, FXMVECTOR b) { return XMVectorDivide(a, b); }
+	inline XMVECTOR operator* (FXMVECTOR v, float s) { return XMVectorScale(v, s); }
+	inline XMVECTOR operator* (float s, FXMVECTOR v) { return XMVectorScale(v, s); }
+	inline XMVECTOR operator/ (FXMVECTOR v, float s) { return XMVectorScale(v, 1.0f / s); }
+	inline XMVECTOR& operator+= (XMVECTOR& a, FXMVECTOR b) { a = XMVectorAdd(a, b); return a; }
+	inline XMVECTOR& operator-= (XMVECTOR& a, FXMVECTOR b) { a = XMVectorSubtract(a, b); return a; }
+	inline XMVECTOR& operator*= (XMVECTOR& a, FXMVECTOR b) { a = XMVectorMultiply(a, b); return a; }
+	inline XMVECTOR& operator*= (XMVECTOR& v, float s) { v = XMVectorScale(v, s); return v; }
+
+	inline XMMATRIX operator* (FXMMATRIX a, CXMMATRIX b) { return XMMatrixMultiply(a, b); }
+	inline XMMATRIX& operator*= (XMMATRIX& a, CXMMATRIX b) { a = XMMatrixMultiply(a, b); return a; }
+}
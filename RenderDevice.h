@@ -0,0 +1,214 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+// --------------------------------------------------------
+// A thin rendering interface (RHI) that scene code draws
+// through, so it doesn't depend on any one graphics API
+//
+// - RenderDevice creates resources and RenderContext binds
+//   them and draws, much like D3D11's device and context
+// - Resources are opaque handles that each backend
+//   subclasses, and a backend only accepts its own
+// - Backends: D3D11RenderDevice (the game's, which binds
+//   through a StateCache) and NullRenderDevice (no GPU at
+//   all - it only counts draws, binds and uploads, so
+//   submission can be measured anywhere)
+// - No graphics headers here, so this builds on any platform
+// --------------------------------------------------------
+
+// --------------------------------------------------------
+// Where a shader's constant buffers currently sit in its
+// backend's constant buffer ring, so the shader can be bound
+// later (on any context) even after its data has moved on
+// --------------------------------------------------------
+struct RenderConstantBufferRanges
+{
+	static const unsigned int MaxBuffers = 4;
+	unsigned int Count = 0;
+	unsigned int BindIndex[MaxBuffers] = {};
+	unsigned int FirstConstant[MaxBuffers] = {};	// In 16 byte constants
+	unsigned int NumConstants[MaxBuffers] = {};
+};
+
+struct RenderBufferDesc
+{
+	enum Kind { VertexBuffer, IndexBuffer, ConstantBuffer, IndirectArgsBuffer };
+	enum Usage { Immutable, Default, Dynamic };
+
+	Kind Type;
+	Usage Access;
+	unsigned int ByteWidth;
+	unsigned int Stride;	// Vertex buffers only
+};
+
+// RGBA8 (UNORM) textures, optionally cube maps
+struct RenderTextureDesc
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int MipLevels;
+	unsigned int ArraySize;	// Six for a cube map
+	bool Cube;
+};
+
+struct RenderSamplerDesc
+{
+	enum FilterMode { Point, Linear, Anisotropic };
+	enum AddressMode { Wrap, Clamp };
+
+	FilterMode Filter;
+	AddressMode Address;	// For all three coordinates
+	unsigned int MaxAnisotropy;
+};
+
+// The fixed function state a draw needs beyond its shaders
+struct RenderPipelineStateDesc
+{
+	enum CullMode { CullNone, CullFront, CullBack };
+	enum DepthFunc { Less, LessEqual, Equal, Always };
+
+	CullMode Cull;
+	bool DepthEnable;
+	bool DepthWrite;
+	DepthFunc DepthTest;
+};
+
+// --------------------------------------------------------
+// Resource handles - backends subclass these, and only
+// ever see their own
+//
+// - Each keeps the description it was made from, so it can
+//   be recreated elsewhere (see CommandCapture.h)
+// --------------------------------------------------------
+class RenderBuffer
+{
+public:
+	virtual ~RenderBuffer() {}
+	const RenderBufferDesc& GetDesc() { return desc; }
+
+protected:
+	RenderBuffer(const RenderBufferDesc& desc) : desc(desc) {}
+	RenderBufferDesc desc;
+};
+
+class RenderTexture
+{
+public:
+	virtual ~RenderTexture() {}
+	const RenderTextureDesc& GetDesc() { return desc; }
+
+protected:
+	RenderTexture(const RenderTextureDesc& desc) : desc(desc) {}
+	RenderTextureDesc desc;
+};
+
+class RenderSampler
+{
+public:
+	virtual ~RenderSampler() {}
+	const RenderSamplerDesc& GetDesc() { return desc; }
+
+protected:
+	RenderSampler(const RenderSamplerDesc& desc) : desc(desc) {}
+	RenderSamplerDesc desc;
+};
+
+class RenderPipelineState
+{
+public:
+	virtual ~RenderPipelineState() {}
+	const RenderPipelineStateDesc& GetDesc() { return desc; }
+
+protected:
+	RenderPipelineState(const RenderPipelineStateDesc& desc) : desc(desc) {}
+	RenderPipelineStateDesc desc;
+};
+
+// --------------------------------------------------------
+// A compiled shader and its constant data
+//
+// - Variables are set by name into the shader's local copy
+//   of its constant buffers, then CopyAllBufferData() sends
+//   them to the GPU (binding them right away if the shader
+//   is the one currently bound)
+// - GetConstantBufferRanges() captures where that data went,
+//   so a context can bind it later from another thread
+// - The local copies can also be read and written whole, by
+//   index, for capturing and replaying them
+// --------------------------------------------------------
+class RenderShader
+{
+public:
+	virtual ~RenderShader() {}
+
+	// Registers of named resources, or -1 if the shader doesn't have one
+	virtual int GetTextureSlot(const std::string& name) = 0;
+	virtual int GetSamplerSlot(const std::string& name) = 0;
+
+	// Returns false if the shader has no such variable
+	virtual bool SetData(std::string name, const void* data, unsigned int size) = 0;
+	virtual void CopyAllBufferData() = 0;
+	virtual bool GetConstantBufferRanges(RenderConstantBufferRanges* ranges) = 0;
+
+	// Raw local constant data (in bytes, a multiple of 16 each)
+	virtual unsigned int GetConstantBufferCount() = 0;
+	virtual unsigned int GetConstantBufferSize(unsigned int index) = 0;
+	virtual const void* GetConstantBufferData(unsigned int index) = 0;
+	virtual bool SetConstantBufferData(unsigned int index, const void* data, unsigned int size) = 0;
+};
+
+// --------------------------------------------------------
+// Creates resources - may be called from any thread
+// --------------------------------------------------------
+class RenderDevice
+{
+public:
+	virtual ~RenderDevice() {}
+
+	// initialData may be null unless the buffer is Immutable
+	virtual std::shared_ptr<RenderBuffer> CreateBuffer(const RenderBufferDesc& desc, const void* initialData) = 0;
+
+	// data - One tightly packed RGBA8 image per subresource: every mip of
+	//        the first array slice, then every mip of the next, and so on
+	virtual std::shared_ptr<RenderTexture> CreateTexture(const RenderTextureDesc& desc, const void* const* data) = 0;
+
+	virtual std::shared_ptr<RenderSampler> CreateSampler(const RenderSamplerDesc& desc) = 0;
+	virtual std::shared_ptr<RenderPipelineState> CreatePipelineState(const RenderPipelineStateDesc& desc) = 0;
+};
+
+// --------------------------------------------------------
+// Binds resources and draws - each context belongs to one
+// thread at a time
+// --------------------------------------------------------
+class RenderContext
+{
+public:
+	enum Stage { VertexStage, PixelStage, ComputeStage };
+
+	virtual ~RenderContext() {}
+
+	// Null for the default state (back face culling, depth less, written)
+	virtual void SetPipelineState(RenderPipelineState* state) = 0;
+
+	// Indices are always 32 bit, and primitives are always triangle lists
+	virtual void SetVertexBuffer(RenderBuffer* buffer, unsigned int stride, unsigned int offset) = 0;
+	virtual void SetIndexBuffer(RenderBuffer* buffer, unsigned int offset) = 0;
+
+	// Binds a shader (or nothing, if null) to a stage, along with its constants
+	// - With ranges, the constants are the ones captured then
+	// - Without, they're whatever the shader last copied
+	virtual void SetShader(Stage stage, RenderShader* shader, const RenderConstantBufferRanges* ranges) = 0;
+
+	virtual void SetConstantBuffer(Stage stage, unsigned int slot, RenderBuffer* buffer) = 0;
+	virtual void SetTextures(Stage stage, unsigned int startSlot, unsigned int count, RenderTexture* const* textures) = 0;
+	virtual void SetSamplers(Stage stage, unsigned int startSlot, unsigned int count, RenderSampler* const* samplers) = 0;
+
+	// Replaces a Default or Dynamic buffer's contents, from the start
+	virtual void UpdateBuffer(RenderBuffer* buffer, const void* data, unsigned int size) = 0;
+
+	virtual void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) = 0;
+	virtual void DrawIndexedIndirect(RenderBuffer* argsBuffer, unsigned int argsOffset) = 0;
+	virtual void Dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ) = 0;
+};
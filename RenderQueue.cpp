@@ -0,0 +1,82 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+// --------------------------------------------------------
+// Packs the ids into a key, most significant first
+// --------------------------------------------------------
+uint64_t RenderQueue::MakeSortKey(unsigned int pipelineId, unsigned int materialId, unsigned int meshId)
+{
+	return
+		((uint64_t)(pipelineId & 0xFFFF) << 32) |
+		((uint64_t)(materialId & 0xFFFF) << 16) |
+		((uint64_t)(meshId & 0xFFFF));
+}
+
+// --------------------------------------------------------
+// Empties the queue, keeping its memory for next frame
+// --------------------------------------------------------
+void RenderQueue::Clear()
+{
+	items.clear();
+}
+
+// --------------------------------------------------------
+// Adds an item to the (unsorted) queue
+// --------------------------------------------------------
+void RenderQueue::Add(uint64_t sortKey, unsigned int index)
+{
+	Item item = {};
+	item.SortKey = sortKey;
+	item.Index = index;
+	items.push_back(item);
+}
+
+// --------------------------------------------------------
+// Sorts by key, breaking ties by index so the order is
+// identical every frame (and for every thread count)
+// --------------------------------------------------------
+void RenderQueue::Sort()
+{
+	std::sort(items.begin(), items.end(), [](const Item& a, const Item& b)
+		{
+			if (a.SortKey != b.SortKey)
+				return a.SortKey < b.SortKey;
+			return a.Index < b.Index;
+		});
+}
+
+// --------------------------------------------------------
+// Splits the sorted queue into in-order chunks
+//
+// maxChunks        - Usually the number of recording threads
+// minItemsPerChunk - Below this, a chunk isn't worth a command list
+// chunks           - Receives the chunks, in draw order
+// --------------------------------------------------------
+void RenderQueue::Partition(unsigned int maxChunks, unsigned int minItemsPerChunk, std::vector<RenderQueueChunk>& chunks)
+{
+	chunks.clear();
+
+	unsigned int count = GetCount();
+	if (count == 0 || maxChunks == 0)
+		return;
+
+	// How many chunks can we make without any getting too small?
+	if (minItemsPerChunk == 0) minItemsPerChunk = 1;
+	unsigned int chunkCount = count / minItemsPerChunk;
+	if (chunkCount < 1) chunkCount = 1;
+	if (chunkCount > maxChunks) chunkCount = maxChunks;
+
+	// Spread the remainder over the first few chunks
+	unsigned int baseSize = count / chunkCount;
+	unsigned int remainder = count % chunkCount;
+	unsigned int first = 0;
+	for (unsigned int i = 0; i < chunkCount; i++)
+	{
+		RenderQueueChunk chunk = {};
+		chunk.First = first;
+		chunk.Count = baseSize + (i < remainder ? 1 : 0);
+		chunks.push_back(chunk);
+		first += chunk.Count;
+	}
+}
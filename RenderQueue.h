@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// --------------------------------------------------------
+// A contiguous run of queue items, recorded together
+// --------------------------------------------------------
+struct RenderQueueChunk
+{
+	unsigned int First;
+	unsigned int Count;
+};
+
+// --------------------------------------------------------
+// A sorted list of things to draw this frame
+//
+// - Items are just a sort key and an index into whatever
+//   array the caller draws from, so this has no graphics
+//   dependencies at all
+// - Sorting groups items that share shaders, materials and
+//   meshes, so fewer state changes survive the StateCache
+// - Partition() splits the sorted queue into in-order chunks
+//   for recording in parallel; executing the chunks in order
+//   gives the same result as drawing the whole queue serially
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	struct Item
+	{
+		uint64_t SortKey;
+		unsigned int Index;
+	};
+
+	// Builds a key that sorts by pipeline first, then material, then mesh
+	// - Each id must fit in 16 bits
+	static uint64_t MakeSortKey(unsigned int pipelineId, unsigned int materialId, unsigned int meshId);
+
+	void Clear();
+	void Add(uint64_t sortKey, unsigned int index);
+	void Sort();
+
+	// Splits the queue into at most maxChunks contiguous chunks of
+	// nearly equal size, never making one smaller than minItemsPerChunk
+	// (unless there are fewer items than that to begin with)
+	void Partition(unsigned int maxChunks, unsigned int minItemsPerChunk, std::vector<RenderQueueChunk>& chunks);
+
+	unsigned int GetCount() { return (unsigned int)items.size(); }
+	const Item& operator[](unsigned int i) { return items[i]; }
+
+private:
+	std::vector<Item> items;
+};
+
@@ -1,6 +1,8 @@
 #include "Renderable.h"
 
 Renderable::Renderable()
+	:
+	occluder(false)
 {
 	trf = Transform();
 }
@@ -8,7 +10,8 @@ Renderable::Renderable()
 Renderable::Renderable(std::shared_ptr<Mesh> meshToUse, std::shared_ptr<Material> material)
 	:
 	mesh(meshToUse),
-	material(material)
+	material(material),
+	occluder(false)
 {
 	trf = Transform();
 }
@@ -29,34 +32,67 @@ Transform* Renderable::GetTransform()
 }
 
 void Renderable::Draw(
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
-	std::shared_ptr<Camera> camera,
+	RenderContext* context,
+	const FrameCamera& camera,
+	const FrameDrawItem& item,
 	float totalTime
 )
+{
+	CopyShaderData(camera, item, totalTime);
+
+	// Prep the material so its shaders are ready
+	material->PrepareMaterial(context);
+
+	// Drawing the meshes!
+	mesh->Draw(context);
+}
+
+bool Renderable::CopyConstants(
+	const FrameCamera& camera,
+	const FrameDrawItem& item,
+	float totalTime,
+	RenderConstantBufferRanges* vsRanges,
+	RenderConstantBufferRanges* psRanges
+)
+{
+	CopyShaderData(camera, item, totalTime);
+
+	// Remember where the data landed, since the next renderable sharing these shaders will overwrite it
+	return
+		material->GetVS()->GetConstantBufferRanges(vsRanges) &&
+		material->GetPS()->GetConstantBufferRanges(psRanges);
+}
+
+void Renderable::Record(
+	RenderContext* context,
+	const RenderConstantBufferRanges& vsRanges,
+	const RenderConstantBufferRanges& psRanges
+)
+{
+	material->PrepareMaterial(context, vsRanges, psRanges);
+	mesh->Draw(context);
+}
+
+void Renderable::CopyShaderData(const FrameCamera& camera, const FrameDrawItem& item, float totalTime)
 {
 	// Do Simple Shader's stuff here
-	std::shared_ptr<SimpleVertexShader> vs = material->GetVS();
-	std::shared_ptr<SimplePixelShader> ps = material->GetPS();
+	std::shared_ptr<RenderShader> vs = material->GetVS();
+	std::shared_ptr<RenderShader> ps = material->GetPS();
 
 	// Setting all the values in the vertex shader to updated current values, BEFORE telling the material to prepare
-	vs->SetMatrix4x4("world", trf.GetWorldMatrix());
-	vs->SetMatrix4x4("view", camera->GetView());
-	vs->SetMatrix4x4("projection", camera->GetProjection());
-	vs->SetMatrix4x4("worldInvTrans", trf.GetWorldInverseTransposeMatrix());
+	vs->SetData("world", &item.World, sizeof(item.World));
+	vs->SetData("view", &camera.View, sizeof(camera.View));
+	vs->SetData("projection", &camera.Projection, sizeof(camera.Projection));
+	vs->SetData("worldInvTrans", &item.WorldInvTrans, sizeof(item.WorldInvTrans));
 	
 	// Setting all the values in the pixel shader too
-	ps->SetFloat4("colorTint", material->GetColorTint()); // Every pixel shader has a tint
-	ps->SetFloat3("cameraPosition", camera->GetTransform().GetPosition()); // And specular needs the camera position
-	// Extra values!! if a variable doesn't exist in our material's pixel shader, SimpleShader simply skips it
-	ps->SetFloat("totalTime", totalTime); // Only some pixel shaders have time
+	DirectX::XMFLOAT4 colorTint = material->GetColorTint();
+	ps->SetData("colorTint", &colorTint, sizeof(colorTint)); // Every pixel shader has a tint
+	ps->SetData("cameraPosition", &camera.Position, sizeof(camera.Position)); // And specular needs the camera position
+	// Extra values!! if a variable doesn't exist in our material's pixel shader, SetData simply skips it
+	ps->SetData("totalTime", &totalTime, sizeof(totalTime)); // Only some pixel shaders have time
 
 	// Now send it over, then tell it go!
 	vs->CopyAllBufferData();
 	ps->CopyAllBufferData();
-
-	// Prep the material so its shaders are ready
-	material->PrepareMaterial();
-
-	// Drawing the meshes!
-	mesh->Draw();
 }
@@ -4,9 +4,9 @@
 #include "Transform.h"
 #include "Mesh.h"
 #include <memory>
-#include <wrl/client.h>
-#include "Camera.h"
 #include "Material.h"
+#include "RenderDevice.h"
+#include "FrameView.h"
 
 class Renderable
 {
@@ -25,16 +25,44 @@ public:
 	std::shared_ptr<Material> GetMaterial();
 	Transform* GetTransform();
 
+	// Occluders are drawn into the software depth buffer that the
+	// rest of the scene is occlusion culled against
+	bool IsOccluder() { return occluder; }
+	void SetOccluder(bool isOccluder) { occluder = isOccluder; }
+
 	// Draw
+	// - Takes the camera and this renderable's matrices as captured in a
+	//   frame packet, so drawing never reads the live transform or camera
 	void Draw(
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
-		std::shared_ptr<Camera> camera,
+		RenderContext* context,
+		const FrameCamera& camera,
+		const FrameDrawItem& item,
 		float totalTime
 	);
 
+	// Split version of Draw() for recording on worker threads
+	// - CopyConstants() uploads this frame's shader data and captures where it
+	//   went; it touches the shaders' shared data, so call it on the main thread
+	// - Record() only binds and draws, through whichever context it's given
+	bool CopyConstants(
+		const FrameCamera& camera,
+		const FrameDrawItem& item,
+		float totalTime,
+		RenderConstantBufferRanges* vsRanges,
+		RenderConstantBufferRanges* psRanges
+	);
+	void Record(
+		RenderContext* context,
+		const RenderConstantBufferRanges& vsRanges,
+		const RenderConstantBufferRanges& psRanges
+	);
+
 private:
 	Transform trf;
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<Material> material;
+	bool occluder;
+
+	void CopyShaderData(const FrameCamera& camera, const FrameDrawItem& item, float totalTime);
 };
 
@@ -0,0 +1,47 @@
+#include "SamplerManager.h"
+
+SamplerManager::SamplerManager(std::shared_ptr<RenderDevice> device) :
+	device(device),
+	hits(0)
+{
+}
+
+std::shared_ptr<RenderSampler> SamplerManager::Get(const RenderSamplerDesc& desc)
+{
+	unsigned long long key = GetKey(desc);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::unordered_map<unsigned long long, std::shared_ptr<RenderSampler>>::iterator found = samplers.find(key);
+	if (found != samplers.end())
+	{
+		hits++;
+		return found->second;
+	}
+
+	std::shared_ptr<RenderSampler> sampler = device->CreateSampler(desc);
+	if (sampler)
+		samplers[key] = sampler;
+	return sampler;
+}
+
+unsigned int SamplerManager::GetSamplerCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return (unsigned int)samplers.size();
+}
+
+unsigned int SamplerManager::GetHits()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return hits;
+}
+
+unsigned long long SamplerManager::GetKey(const RenderSamplerDesc& desc)
+{
+	// The modes are small enums, so a byte each leaves the rest for the anisotropy
+	return
+		(unsigned long long)desc.Filter |
+		((unsigned long long)desc.Address << 8) |
+		((unsigned long long)desc.MaxAnisotropy << 16);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "RenderDevice.h"
+
+// --------------------------------------------------------
+// One sampler per distinct description, shared by everything
+// that samples the same way
+//
+// - Descriptions are packed into a key, so asking for one
+//   that already exists just returns it
+// - Samplers are tiny and there are only a few kinds, so
+//   they're kept for as long as the manager is
+// - Safe to call from any thread
+// - Portable C++ - builds anywhere
+// --------------------------------------------------------
+class SamplerManager
+{
+public:
+	SamplerManager(std::shared_ptr<RenderDevice> device);
+
+	// Returns null if the device refuses the description
+	std::shared_ptr<RenderSampler> Get(const RenderSamplerDesc& desc);
+
+	unsigned int GetSamplerCount();
+	unsigned int GetHits();
+
+	// Every field packed into one value, so equal descriptions share a key
+	static unsigned long long GetKey(const RenderSamplerDesc& desc);
+
+private:
+	std::shared_ptr<RenderDevice> device;
+	std::mutex mutex;
+	std::unordered_map<unsigned long long, std::shared_ptr<RenderSampler>> samplers;
+	unsigned int hits;
+};
@@ -0,0 +1,260 @@
+#include "ShadowAtlas.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Constructor - Creates the atlas texture, its views, the
+// rasterizer state for drawing it and the tile buffer
+//
+// atlasSize         - Width and height of the whole atlas
+// minTileSize       - Smallest tile a light can get
+// maxTileSize       - Tile size for a light that covers the screen
+// maxShadowedLights - How many local lights get shadows at most
+// --------------------------------------------------------
+ShadowAtlas::ShadowAtlas(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	unsigned int atlasSize,
+	unsigned int minTileSize,
+	unsigned int maxTileSize,
+	unsigned int maxShadowedLights)
+	:
+	device(device),
+	allocator(atlasSize, minTileSize),
+	maxTileSize(maxTileSize),
+	maxShadowedLights(maxShadowedLights),
+	shadowedLightCount(0),
+	tileCapacity(0)
+{
+	// Typeless, so it can be both a depth buffer and a texture
+	D3D11_TEXTURE2D_DESC atlasDesc = {};
+	atlasDesc.Width = allocator.GetAtlasSize();
+	atlasDesc.Height = allocator.GetAtlasSize();
+	atlasDesc.ArraySize = 1;
+	atlasDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	atlasDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	atlasDesc.MipLevels = 1;
+	atlasDesc.SampleDesc.Count = 1;
+	atlasDesc.Usage = D3D11_USAGE_DEFAULT;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> atlasTexture;
+	if (SUCCEEDED(device->CreateTexture2D(&atlasDesc, 0, atlasTexture.GetAddressOf())))
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+		dsvDesc.Texture2D.MipSlice = 0;
+		device->CreateDepthStencilView(atlasTexture.Get(), &dsvDesc, dsv.GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = 1;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		device->CreateShaderResourceView(atlasTexture.Get(), &srvDesc, srv.GetAddressOf());
+	}
+
+	// Perspective tiles keep depth clipping, unlike the cascades
+	D3D11_RASTERIZER_DESC rastDesc = {};
+	rastDesc.FillMode = D3D11_FILL_SOLID;
+	rastDesc.CullMode = D3D11_CULL_BACK;
+	rastDesc.DepthClipEnable = true;
+	rastDesc.DepthBias = 1000; // Multiplied by (smallest possible positive value storable in the depth buffer)
+	rastDesc.DepthBiasClamp = 0.0f;
+	rastDesc.SlopeScaledDepthBias = 2.0f;
+	device->CreateRasterizerState(&rastDesc, rasterizer.GetAddressOf());
+
+	// Always have something to bind, even with no shadowed lights
+	CreateTileBuffer(16);
+}
+
+// --------------------------------------------------------
+// Picks the shadowed lights, places their tiles and
+// uploads what the pixel shader needs to find them
+// --------------------------------------------------------
+void ShadowAtlas::Update(
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::vector<Light>& lights,
+	unsigned int firstLocalLight,
+	XMFLOAT3 cameraPosition,
+	float fieldOfView)
+{
+	allocator.BeginFrame();
+	tileData.clear();
+	tileViews.clear();
+	shadowedLightCount = 0;
+
+	// How much of the screen's height each shadowed light can cover - a
+	// light the camera is inside of could cover all of it
+	struct Candidate
+	{
+		unsigned int LightIndex;	// Where it is this frame - the lights are re-sorted every frame
+		float Coverage;
+	};
+	std::vector<Candidate> candidates;
+	float tanHalfFov = tanf(fieldOfView * 0.5f);
+	for (unsigned int i = 0; i < lights.size(); i++)
+	{
+		lights[i].ShadowTileIndex = -1;
+		if (i < firstLocalLight || !lights[i].CastsShadow)
+			continue;
+		if (lights[i].Type != LIGHT_TYPE_POINT && lights[i].Type != LIGHT_TYPE_SPOT)
+			continue;
+
+		XMVECTOR toLight = XMLoadFloat3(&lights[i].Position) - XMLoadFloat3(&cameraPosition);
+		float distance = XMVectorGetX(XMVector3Length(toLight));
+		float coverage = distance <= lights[i].Range ? 1.0f : lights[i].Range / (distance * tanHalfFov);
+
+		Candidate candidate = {};
+		candidate.LightIndex = i;
+		candidate.Coverage = coverage > 1.0f ? 1.0f : coverage;
+		candidates.push_back(candidate);
+	}
+
+	// Most important first, so they get first pick of the atlas
+	std::stable_sort(candidates.begin(), candidates.end(),
+		[](const Candidate& a, const Candidate& b) { return a.Coverage > b.Coverage; });
+	if (candidates.size() > maxShadowedLights)
+		candidates.resize(maxShadowedLights);
+
+	// The six cube faces, in the order GetCubeFace() in ShadowHeader.hlsli picks them
+	static const XMFLOAT3 faceDirections[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	static const XMFLOAT3 faceUps[6] = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, 1, 0 }, { 0, 1, 0 } };
+
+	for (const Candidate& candidate : candidates)
+	{
+		Light& light = lights[candidate.LightIndex];
+		unsigned int size = allocator.RoundTileSize((unsigned int)(candidate.Coverage * maxTileSize));
+		if (size > maxTileSize)
+			size = maxTileSize;
+
+		// Place every tile the light needs before using any of them,
+		// so a light never ends up with only some of its faces
+		bool isPoint = light.Type == LIGHT_TYPE_POINT;
+		unsigned int faceCount = isPoint ? 6 : 1;
+		// - Tiles are keyed by the light's Id, not its index, so they stay put
+		//   while other lights come, go and change order
+		ShadowAtlasAllocator::Tile tiles[6] = {};
+		unsigned int placed = 0;
+		for (; placed < faceCount; placed++)
+		{
+			if (!allocator.Allocate((uint64_t)light.Id * 6 + placed, size, &tiles[placed]))
+				break;
+		}
+		if (placed < faceCount)
+		{
+			for (unsigned int f = 0; f < placed; f++)
+				allocator.Release((uint64_t)light.Id * 6 + f);
+			continue;
+		}
+
+		light.ShadowTileIndex = (int)tileData.size();
+		shadowedLightCount++;
+
+		float nearZ = fmaxf(light.Range * 0.01f, 0.01f);
+		XMVECTOR position = XMLoadFloat3(&light.Position);
+		if (isPoint)
+		{
+			XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, nearZ, light.Range);
+			for (unsigned int f = 0; f < 6; f++)
+			{
+				XMMATRIX view = XMMatrixLookToLH(position, XMLoadFloat3(&faceDirections[f]), XMLoadFloat3(&faceUps[f]));
+				AddTile(tiles[f], view, projection);
+			}
+		}
+		else
+		{
+			// Spot lights fade as pow(cos(angle), falloff) - cover the cone
+			// out to where that drops below 1%
+			float cosEdge = powf(0.01f, 1.0f / fmaxf(light.SpotFalloff, 0.001f));
+			float fov = fminf(fmaxf(2.0f * acosf(cosEdge), XMConvertToRadians(10.0f)), XMConvertToRadians(120.0f));
+
+			XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&light.Direction));
+			XMVECTOR up = fabsf(XMVectorGetY(direction)) > 0.99f ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(0, 1, 0, 0);
+			XMMATRIX view = XMMatrixLookToLH(position, direction, up);
+			XMMATRIX projection = XMMatrixPerspectiveFovLH(fov, 1.0f, nearZ, light.Range);
+			AddTile(tiles[0], view, projection);
+		}
+	}
+
+	// Upload, growing the buffer if needed
+	unsigned int count = (unsigned int)tileData.size();
+	if (count > tileCapacity)
+	{
+		unsigned int newCapacity = tileCapacity < 1 ? 1 : tileCapacity;
+		while (newCapacity < count)
+			newCapacity *= 2;
+		CreateTileBuffer(newCapacity);
+	}
+
+	if (count == 0)
+		return;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (FAILED(context->Map(tileBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return;
+	memcpy(mapped.pData, tileData.data(), sizeof(TileData) * count);
+	context->Unmap(tileBuffer.Get(), 0);
+}
+
+// --------------------------------------------------------
+// Records one placed tile, for both drawing and sampling
+// --------------------------------------------------------
+void ShadowAtlas::AddTile(const ShadowAtlasAllocator::Tile& tile, FXMMATRIX view, CXMMATRIX projection)
+{
+	float atlasSize = (float)allocator.GetAtlasSize();
+
+	TileData data = {};
+	XMStoreFloat4x4(&data.ViewProjection, view * projection);
+	data.AtlasRect = XMFLOAT4(
+		tile.Size / atlasSize,
+		tile.Size / atlasSize,
+		tile.X / atlasSize,
+		tile.Y / atlasSize);
+	tileData.push_back(data);
+
+	TileView tileView = {};
+	XMStoreFloat4x4(&tileView.View, view);
+	XMStoreFloat4x4(&tileView.Projection, projection);
+	BoundingFrustum::CreateFromMatrix(tileView.Frustum, projection);
+	tileView.Frustum.Transform(tileView.Frustum, XMMatrixInverse(0, view));
+	tileView.Viewport.TopLeftX = (float)tile.X;
+	tileView.Viewport.TopLeftY = (float)tile.Y;
+	tileView.Viewport.Width = (float)tile.Size;
+	tileView.Viewport.Height = (float)tile.Size;
+	tileView.Viewport.MinDepth = 0.0f;
+	tileView.Viewport.MaxDepth = 1.0f;
+	tileViews.push_back(tileView);
+}
+
+// --------------------------------------------------------
+// (Re)creates the structured buffer of tiles and its SRV
+// --------------------------------------------------------
+void ShadowAtlas::CreateTileBuffer(unsigned int capacity)
+{
+	tileBuffer.Reset();
+	tileSRV.Reset();
+	tileCapacity = 0;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = sizeof(TileData) * capacity;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	desc.StructureByteStride = sizeof(TileData);
+	if (FAILED(device->CreateBuffer(&desc, 0, tileBuffer.GetAddressOf())))
+		return;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = capacity;
+	if (FAILED(device->CreateShaderResourceView(tileBuffer.Get(), &srvDesc, tileSRV.GetAddressOf())))
+		return;
+
+	tileCapacity = capacity;
+}
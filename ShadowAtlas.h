@@ -0,0 +1,97 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+#include "Light.h"
+#include "ShadowAtlasAllocator.h"
+
+// --------------------------------------------------------
+// Shadows for point and spot lights, all sharing one big
+// depth texture
+//
+// - Each shadowed spot light gets one tile, and each point
+//   light gets six (one per cube face), sized by how much
+//   of the screen the light can cover
+// - Tiles are placed by a ShadowAtlasAllocator, most
+//   important lights first, so when the atlas runs out it's
+//   the least important lights that shrink or go without
+// - Each tile keeps its light-space frustum, so callers can
+//   cull casters per tile (and per cube face)
+// --------------------------------------------------------
+class ShadowAtlas
+{
+public:
+	// What the pixel shader reads per tile
+	// - Must match ShadowTile in ShadowHeader.hlsli
+	struct TileData
+	{
+		DirectX::XMFLOAT4X4 ViewProjection;
+		DirectX::XMFLOAT4 AtlasRect; // Scale (xy) and offset (zw) from tile uv to atlas uv
+	};
+
+	// What drawing a tile needs
+	struct TileView
+	{
+		DirectX::XMFLOAT4X4 View;
+		DirectX::XMFLOAT4X4 Projection;
+		DirectX::BoundingFrustum Frustum; // World space
+		D3D11_VIEWPORT Viewport;
+	};
+
+	ShadowAtlas(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		unsigned int atlasSize = 4096,
+		unsigned int minTileSize = 64,
+		unsigned int maxTileSize = 1024,
+		unsigned int maxShadowedLights = 32);
+
+	// Picks which local lights get shadows this frame, places
+	// their tiles and uploads the tile data
+	//
+	// lights          - The render side's lights - each one's ShadowTileIndex is set (-1 for none),
+	//                   and each one's Id (from LightManager) keeps its tiles in place between frames
+	// firstLocalLight - Index of the first non-directional light
+	// cameraPosition, fieldOfView - Used to judge how big each light is on screen
+	void Update(
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		std::vector<Light>& lights,
+		unsigned int firstLocalLight,
+		DirectX::XMFLOAT3 cameraPosition,
+		float fieldOfView);
+
+	// Getters
+	unsigned int GetTileCount() { return (unsigned int)tileViews.size(); }
+	const TileView& GetTileView(unsigned int index) { return tileViews[index]; }
+	unsigned int GetShadowedLightCount() { return shadowedLightCount; }
+	unsigned int GetResolution() { return allocator.GetAtlasSize(); }
+	ShadowAtlasAllocator& GetAllocator() { return allocator; }
+	ID3D11DepthStencilView* GetDSV() { return dsv.Get(); }
+	ID3D11ShaderResourceView* GetSRV() { return srv.Get(); }
+	ID3D11ShaderResourceView* GetTileSRV() { return tileSRV.Get(); }
+	ID3D11RasterizerState* GetRasterizer() { return rasterizer.Get(); }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	ShadowAtlasAllocator allocator;
+	unsigned int maxTileSize;
+	unsigned int maxShadowedLights;
+	unsigned int shadowedLightCount;
+
+	std::vector<TileData> tileData;
+	std::vector<TileView> tileViews;
+
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> dsv;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizer;
+
+	// Tile data for the pixel shader, grown as needed
+	Microsoft::WRL::ComPtr<ID3D11Buffer> tileBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> tileSRV;
+	unsigned int tileCapacity;
+
+	void CreateTileBuffer(unsigned int capacity);
+	void AddTile(const ShadowAtlasAllocator::Tile& tile, DirectX::FXMMATRIX view, DirectX::CXMMATRIX projection);
+};
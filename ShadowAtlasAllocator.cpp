@@ -0,0 +1,235 @@
+#include "ShadowAtlasAllocator.h"
+
+// --------------------------------------------------------
+// Rounds up to the next power of two
+// --------------------------------------------------------
+static unsigned int NextPowerOfTwo(unsigned int value)
+{
+	unsigned int result = 1;
+	while (result < value)
+		result <<= 1;
+	return result;
+}
+
+// --------------------------------------------------------
+// Constructor - the whole atlas starts as one free block
+//
+// atlasSize   - Width and height of the atlas, in texels
+// minTileSize - Smallest tile ever handed out
+// --------------------------------------------------------
+ShadowAtlasAllocator::ShadowAtlasAllocator(unsigned int atlasSize, unsigned int minTileSize)
+	:
+	atlasSize(NextPowerOfTwo(atlasSize)),
+	minTileSize(NextPowerOfTwo(minTileSize)),
+	levelCount(1),
+	frame(0),
+	evictionCount(0),
+	usedArea(0)
+{
+	if (this->minTileSize > this->atlasSize)
+		this->minTileSize = this->atlasSize;
+
+	for (unsigned int size = this->atlasSize; size > this->minTileSize; size >>= 1)
+		levelCount++;
+
+	Clear();
+}
+
+// --------------------------------------------------------
+// Starts a new frame
+// --------------------------------------------------------
+void ShadowAtlasAllocator::BeginFrame()
+{
+	frame++;
+}
+
+// --------------------------------------------------------
+// Finds a tile for the given key
+//
+// - A key that already has a tile of the requested size
+//   keeps it, so its place in the atlas is stable
+// - Otherwise the old tile (if any) is freed first, then
+//   stale tiles are evicted and the size is halved as
+//   needed until something fits
+// --------------------------------------------------------
+bool ShadowAtlasAllocator::Allocate(uint64_t key, unsigned int size, Tile* tile)
+{
+	size = RoundTileSize(size);
+
+	auto existing = allocations.find(key);
+	if (existing != allocations.end())
+	{
+		if (existing->second.Placement.Size == size)
+		{
+			existing->second.LastUsedFrame = frame;
+			*tile = existing->second.Placement;
+			return true;
+		}
+
+		Release(key);
+	}
+
+	Block block = {};
+	while (!AllocateBlock(GetLevel(size), &block))
+	{
+		if (EvictLeastRecentlyUsed())
+			continue;
+		if (size <= minTileSize)
+			return false;
+		size >>= 1;
+	}
+
+	Allocation allocation = {};
+	allocation.Placement.X = block.X;
+	allocation.Placement.Y = block.Y;
+	allocation.Placement.Size = size;
+	allocation.LastUsedFrame = frame;
+	allocations[key] = allocation;
+	usedArea += (uint64_t)size * size;
+
+	*tile = allocation.Placement;
+	return true;
+}
+
+// --------------------------------------------------------
+// Frees a key's tile
+// --------------------------------------------------------
+void ShadowAtlasAllocator::Release(uint64_t key)
+{
+	auto existing = allocations.find(key);
+	if (existing == allocations.end())
+		return;
+
+	const Tile& tile = existing->second.Placement;
+	Block block = { tile.X, tile.Y };
+	FreeBlock(GetLevel(tile.Size), block);
+	usedArea -= (uint64_t)tile.Size * tile.Size;
+	allocations.erase(existing);
+}
+
+// --------------------------------------------------------
+// Frees every tile at once
+// --------------------------------------------------------
+void ShadowAtlasAllocator::Clear()
+{
+	allocations.clear();
+	freeBlocks.assign(levelCount, std::vector<Block>());
+	freeBlocks[0].push_back(Block());
+	usedArea = 0;
+}
+
+// --------------------------------------------------------
+// Clamps and rounds a requested tile size
+// --------------------------------------------------------
+unsigned int ShadowAtlasAllocator::RoundTileSize(unsigned int size)
+{
+	size = NextPowerOfTwo(size);
+	if (size < minTileSize) return minTileSize;
+	if (size > atlasSize) return atlasSize;
+	return size;
+}
+
+// --------------------------------------------------------
+// The quadtree level holding blocks of the given size
+// --------------------------------------------------------
+unsigned int ShadowAtlasAllocator::GetLevel(unsigned int size)
+{
+	unsigned int level = 0;
+	for (unsigned int blockSize = atlasSize; blockSize > size; blockSize >>= 1)
+		level++;
+	return level;
+}
+
+// --------------------------------------------------------
+// Takes a free block from the given level, splitting a
+// larger one if that level is empty
+// --------------------------------------------------------
+bool ShadowAtlasAllocator::AllocateBlock(unsigned int level, Block* block)
+{
+	std::vector<Block>& list = freeBlocks[level];
+	if (!list.empty())
+	{
+		*block = list.back();
+		list.pop_back();
+		return true;
+	}
+
+	Block parent = {};
+	if (level == 0 || !AllocateBlock(level - 1, &parent))
+		return false;
+
+	// Keep the first quarter, free the other three
+	unsigned int size = atlasSize >> level;
+	list.push_back({ parent.X + size, parent.Y + size });
+	list.push_back({ parent.X, parent.Y + size });
+	list.push_back({ parent.X + size, parent.Y });
+	*block = parent;
+	return true;
+}
+
+// --------------------------------------------------------
+// Returns a block to its level, merging it with its three
+// siblings whenever they're all free
+// --------------------------------------------------------
+void ShadowAtlasAllocator::FreeBlock(unsigned int level, Block block)
+{
+	std::vector<Block>& list = freeBlocks[level];
+	if (level > 0)
+	{
+		unsigned int size = atlasSize >> level;
+		unsigned int parentX = block.X & ~(size * 2 - 1);
+		unsigned int parentY = block.Y & ~(size * 2 - 1);
+
+		// Find the free siblings
+		unsigned int siblings[3] = {};
+		unsigned int found = 0;
+		for (unsigned int i = 0; i < list.size() && found < 3; i++)
+		{
+			if ((list[i].X & ~(size * 2 - 1)) == parentX &&
+				(list[i].Y & ~(size * 2 - 1)) == parentY)
+			{
+				siblings[found++] = i;
+			}
+		}
+
+		if (found == 3)
+		{
+			// Remove from the back so the earlier indices stay valid
+			for (int i = 2; i >= 0; i--)
+			{
+				list[siblings[i]] = list.back();
+				list.pop_back();
+			}
+			FreeBlock(level - 1, { parentX, parentY });
+			return;
+		}
+	}
+
+	list.push_back(block);
+}
+
+// --------------------------------------------------------
+// Frees the tile that's gone the longest without being
+// asked for, as long as it wasn't asked for this frame
+//
+// Returns false if there was nothing to evict
+// --------------------------------------------------------
+bool ShadowAtlasAllocator::EvictLeastRecentlyUsed()
+{
+	auto oldest = allocations.end();
+	for (auto it = allocations.begin(); it != allocations.end(); ++it)
+	{
+		if (it->second.LastUsedFrame < frame &&
+			(oldest == allocations.end() || it->second.LastUsedFrame < oldest->second.LastUsedFrame))
+		{
+			oldest = it;
+		}
+	}
+
+	if (oldest == allocations.end())
+		return false;
+
+	Release(oldest->first);
+	evictionCount++;
+	return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+// --------------------------------------------------------
+// Packs square, power-of-two shadow tiles into one square
+// atlas
+//
+// - A quadtree ("buddy") allocator: blocks split into four
+//   to make smaller tiles and merge back once all four are
+//   free, so the atlas never fragments into odd shapes
+// - Tiles belong to a caller-chosen key (a light and a cube
+//   face, for instance) and keep their place between frames
+//   for as long as the key keeps asking for the same size
+// - When full, tiles not asked for this frame are evicted,
+//   least recently used first.  If that still isn't enough
+//   the request is halved until it fits, so callers should
+//   ask in order of importance.
+// - Has no graphics dependencies, so it can run anywhere
+// --------------------------------------------------------
+class ShadowAtlasAllocator
+{
+public:
+	// A tile's corner and size, in texels
+	struct Tile
+	{
+		unsigned int X;
+		unsigned int Y;
+		unsigned int Size;
+	};
+
+	// atlasSize, minTileSize - Both rounded up to powers of two
+	ShadowAtlasAllocator(unsigned int atlasSize, unsigned int minTileSize);
+
+	// Starts a new frame - tiles not asked for since the last one become evictable
+	void BeginFrame();
+
+	// Finds (or keeps) a tile for the given key
+	//
+	// key  - Identifies the tile's owner
+	// size - Requested size in texels, rounded up to a power of two
+	// tile - Receives the tile, which may be smaller than requested
+	//
+	// Returns false if not even the smallest tile would fit
+	bool Allocate(uint64_t key, unsigned int size, Tile* tile);
+
+	// Gives a key's tile back, if it has one
+	void Release(uint64_t key);
+
+	// Frees everything
+	void Clear();
+
+	// Rounds a size up to a power of two in [minTileSize, atlasSize]
+	unsigned int RoundTileSize(unsigned int size);
+
+	// Getters
+	unsigned int GetAtlasSize() { return atlasSize; }
+	unsigned int GetMinTileSize() { return minTileSize; }
+	unsigned int GetAllocationCount() { return (unsigned int)allocations.size(); }
+	unsigned int GetEvictionCount() { return evictionCount; }
+	uint64_t GetUsedArea() { return usedArea; }
+
+private:
+	struct Block
+	{
+		unsigned int X;
+		unsigned int Y;
+	};
+
+	struct Allocation
+	{
+		Tile Placement;
+		uint64_t LastUsedFrame;
+	};
+
+	unsigned int atlasSize;
+	unsigned int minTileSize;
+	unsigned int levelCount; // Level 0 is the whole atlas, each level after halves the size
+
+	std::vector<std::vector<Block>> freeBlocks; // Per level
+	std::unordered_map<uint64_t, Allocation> allocations;
+
+	uint64_t frame;
+	unsigned int evictionCount;
+	uint64_t usedArea;
+
+	unsigned int GetLevel(unsigned int size);
+	bool AllocateBlock(unsigned int level, Block* block);
+	void FreeBlock(unsigned int level, Block block);
+	bool EvictLeastRecentlyUsed();
+};
@@ -0,0 +1,157 @@
+#include "ShadowCascades.h"
+
+#include <math.h>
+
+using namespace DirectX;
+
+ShadowCascades::ShadowCascades(unsigned int resolution)
+	:
+	resolution(resolution),
+	cascades(),
+	placement(),
+	fitted(false)
+{
+}
+
+// --------------------------------------------------------
+// Practical split scheme - blends a logarithmic split
+// (even texel density) with a uniform one (less crowding
+// of the first cascade right at the camera)
+// --------------------------------------------------------
+float ShadowCascades::GetSplitDistance(unsigned int split, unsigned int cascadeCount, float nearZ, float farZ, float splitLambda)
+{
+	float t = (float)split / cascadeCount;
+	float logSplit = nearZ * powf(farZ / nearZ, t);
+	float uniformSplit = nearZ + (farZ - nearZ) * t;
+	return splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+}
+
+// --------------------------------------------------------
+// Fits every cascade to its slice of the camera's frustum
+// --------------------------------------------------------
+void ShadowCascades::Fit(
+	const XMFLOAT4X4& view,
+	float fieldOfView,
+	float aspectRatio,
+	float nearClip,
+	XMFLOAT3 lightDirection,
+	unsigned int cascadeCount,
+	float shadowDistance,
+	float splitLambda,
+	float casterDistance)
+{
+	Placement next = {};
+	next.CascadeCount = cascadeCount < 1 ? 1 : (cascadeCount > MaxCascades ? MaxCascades : cascadeCount);
+	next.CasterDistance = casterDistance;
+
+	// A light pointing straight up or down needs a different up vector
+	XMVECTOR lightDir = XMVector3Normalize(XMLoadFloat3(&lightDirection));
+	XMStoreFloat3(&next.LightDirection, lightDir);
+	XMVECTOR up = XMVectorSet(0, 1, 0, 0);
+	if (fabsf(XMVectorGetX(XMVector3Dot(lightDir, up))) > 0.99f)
+		up = XMVectorSet(0, 0, 1, 0);
+
+	// The light's axes, with no translation - cascade centers are measured along these
+	XMMATRIX lightRotation = XMMatrixLookToLH(XMVectorZero(), lightDir, up);
+
+	// Centers from last time only mean something along the same axes
+	bool sameAxes =
+		fitted &&
+		placement.CascadeCount == next.CascadeCount &&
+		placement.LightDirection.x == next.LightDirection.x &&
+		placement.LightDirection.y == next.LightDirection.y &&
+		placement.LightDirection.z == next.LightDirection.z &&
+		placement.CasterDistance == next.CasterDistance;
+
+	XMMATRIX invView = XMMatrixInverse(0, XMLoadFloat4x4(&view));
+	float tanY = tanf(fieldOfView * 0.5f);
+	float tanX = tanY * aspectRatio;
+
+	for (unsigned int c = 0; c < next.CascadeCount; c++)
+	{
+		Cascade& cascade = cascades[c];
+		cascade.SplitNear = GetSplitDistance(c, next.CascadeCount, nearClip, shadowDistance, splitLambda);
+		cascade.SplitFar = GetSplitDistance(c + 1, next.CascadeCount, nearClip, shadowDistance, splitLambda);
+
+		// Bounding sphere of the slice, worked out in view space - the slice is symmetric
+		// around the view direction, so the radius only depends on its shape, and the
+		// cascade's scale never changes as the camera moves or turns
+		float centerZ = (cascade.SplitNear + cascade.SplitFar) * 0.5f;
+		float radius = 0.0f;
+		float depths[2] = { cascade.SplitNear, cascade.SplitFar };
+		for (float z : depths)
+		{
+			float x = tanX * z;
+			float y = tanY * z;
+			radius = fmaxf(radius, sqrtf(x * x + y * y + (z - centerZ) * (z - centerZ)));
+		}
+		radius = ceilf(radius * 16.0f) / 16.0f;
+		next.Radius[c] = radius;
+
+		// Pad the cascade by the slack - which is measured in texels of the padded size
+		float extent = radius / (1.0f - 2.0f * SnapSlack / resolution);
+		float texel = extent * 2.0f / resolution;
+
+		// Where the slice's center is, in texels along the light's axes
+		XMVECTOR worldCenter = XMVector3TransformCoord(XMVectorSet(0, 0, centerZ, 1), invView);
+		float center[3];
+		XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(center), XMVectorScale(XMVector3TransformCoord(worldCenter, lightRotation), 1.0f / texel));
+
+		// Stay put until the slice drifts further than the padding covers, then center on it
+		bool follow = !sameAxes || placement.Radius[c] != radius;
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			if (fabsf(center[axis] - placement.Center[c][axis]) > SnapSlack)
+				follow = true;
+		}
+		for (unsigned int axis = 0; axis < 3; axis++)
+			next.Center[c][axis] = follow ? (int32_t)lroundf(center[axis]) : placement.Center[c][axis];
+
+		// Look down the light from far enough back to catch casters outside the cascade
+		// - Built only from the placement, so the same placement always gives the same matrices
+		float depth = extent * 2.0f + casterDistance;
+		XMMATRIX lightView = lightRotation * XMMatrixTranslation(
+			-next.Center[c][0] * texel,
+			-next.Center[c][1] * texel,
+			-next.Center[c][2] * texel + extent + casterDistance);
+		XMMATRIX lightProj = XMMatrixOrthographicOffCenterLH(-extent, extent, -extent, extent, 0.0f, depth);
+
+		XMStoreFloat4x4(&cascade.View, lightView);
+		XMStoreFloat4x4(&cascade.Projection, lightProj);
+		XMStoreFloat4x4(&cascade.ViewProjection, lightView * lightProj);
+
+		// The volume this cascade sees, from the light's side to the far side
+		BoundingOrientedBox lightSpaceBox(
+			XMFLOAT3(0.0f, 0.0f, depth * 0.5f),
+			XMFLOAT3(extent, extent, depth * 0.5f),
+			XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f));
+		lightSpaceBox.Transform(cascade.Bounds, XMMatrixInverse(0, lightView));
+	}
+
+	placement = next;
+	fitted = true;
+}
+
+// --------------------------------------------------------
+// Compares only the cascades in use, so leftovers from a
+// higher cascade count don't count
+// --------------------------------------------------------
+bool ShadowCascades::SamePlacement(const Placement& a, const Placement& b)
+{
+	if (a.CascadeCount != b.CascadeCount ||
+		a.LightDirection.x != b.LightDirection.x ||
+		a.LightDirection.y != b.LightDirection.y ||
+		a.LightDirection.z != b.LightDirection.z ||
+		a.CasterDistance != b.CasterDistance)
+		return false;
+
+	for (unsigned int c = 0; c < a.CascadeCount; c++)
+	{
+		if (a.Radius[c] != b.Radius[c] ||
+			a.Center[c][0] != b.Center[c][0] ||
+			a.Center[c][1] != b.Center[c][1] ||
+			a.Center[c][2] != b.Center[c][2])
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <stdint.h>
+
+// --------------------------------------------------------
+// Places a directional light's shadow cascades around the
+// camera - the part of CascadedShadowMap with no GPU work
+//
+// - Each cascade covers a depth slice of the camera's view
+//   frustum, with slices split "practically" (a blend of
+//   logarithmic and uniform)
+// - Cascades are fit to a bounding sphere of their slice,
+//   so their size never changes as the camera turns
+// - Each cascade's center sits on whole shadow map texels
+//   along all three of the light's axes, so edges don't
+//   shimmer and depths don't creep as the camera moves
+// - A cascade only follows its slice once the slice has
+//   drifted SnapSlack texels away, and is padded by that
+//   much, so small camera moves leave every cascade exactly
+//   where it was
+// - Where the cascades are is summed up in a Placement,
+//   which is everything their matrices are built from, so
+//   callers can compare it to tell if a map drawn earlier
+//   still lines up
+// - Portable C++ - builds anywhere
+// --------------------------------------------------------
+class ShadowCascades
+{
+public:
+	static const unsigned int MaxCascades = 4;
+
+	// How far (in texels) a slice can drift before its cascade follows it
+	static const int SnapSlack = 8;
+
+	struct Cascade
+	{
+		DirectX::XMFLOAT4X4 View;
+		DirectX::XMFLOAT4X4 Projection;
+		DirectX::XMFLOAT4X4 ViewProjection;
+		DirectX::BoundingOrientedBox Bounds; // World space volume that can cast into this cascade
+		float SplitNear;
+		float SplitFar;
+	};
+
+	// Everything the cascades' matrices are built from
+	struct Placement
+	{
+		unsigned int CascadeCount;
+		DirectX::XMFLOAT3 LightDirection;	// Normalized
+		float CasterDistance;
+		float Radius[MaxCascades];			// Of each slice's bounding sphere
+		int32_t Center[MaxCascades][3];		// In texels along the light's axes
+	};
+
+	ShadowCascades(unsigned int resolution);
+
+	// Fits the cascades to the camera's view for this frame
+	//
+	// view, fieldOfView, aspectRatio, nearClip - The camera
+	// lightDirection  - The direction the light travels
+	// cascadeCount    - How many cascades to use (clamped to MaxCascades)
+	// shadowDistance  - How far from the camera shadows reach
+	// splitLambda     - 0 for uniform splits, 1 for logarithmic
+	// casterDistance  - How far behind each cascade (towards the light) casters are still drawn
+	void Fit(
+		const DirectX::XMFLOAT4X4& view,
+		float fieldOfView,
+		float aspectRatio,
+		float nearClip,
+		DirectX::XMFLOAT3 lightDirection,
+		unsigned int cascadeCount,
+		float shadowDistance,
+		float splitLambda,
+		float casterDistance);
+
+	// Forgets where the cascades were, so the next fit centers them exactly
+	void Reset() { fitted = false; }
+
+	// Where the given split falls, between nearZ and farZ
+	static float GetSplitDistance(unsigned int split, unsigned int cascadeCount, float nearZ, float farZ, float splitLambda);
+
+	// Do two placements give the same cascades?
+	static bool SamePlacement(const Placement& a, const Placement& b);
+
+	// Getters
+	unsigned int GetCascadeCount() { return placement.CascadeCount; }
+	const Cascade& GetCascade(unsigned int index) { return cascades[index]; }
+	const Placement& GetPlacement() { return placement; }
+	unsigned int GetResolution() { return resolution; }
+
+private:
+	unsigned int resolution;
+	Cascade cascades[MaxCascades];
+	Placement placement;
+	bool fitted;
+};
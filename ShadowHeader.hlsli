@@ -0,0 +1,148 @@
+#ifndef __GGP_SHADOW_HEADER__
+#define __GGP_SHADOW_HEADER__
+
+// Must match CascadedShadowMap::MaxCascades
+#define MAX_SHADOW_CASCADES 4
+
+// Picks the cascade a pixel falls in, by its view space depth
+//
+// Returns MAX_SHADOW_CASCADES if the pixel is past the last one
+uint GetShadowCascade(float viewZ, float4 cascadeSplits, uint cascadeCount)
+{
+	for (uint i = 0; i < cascadeCount; i++)
+	{
+		if (viewZ <= cascadeSplits[i])
+			return i;
+	}
+	return MAX_SHADOW_CASCADES;
+}
+
+// Percentage-closer filtering over a (2 * radius + 1) square of
+// bilinear comparisons, built from GatherCmp() instead of
+// SampleCmp() - each gather returns four raw comparisons, which
+// are weighted here so the result matches the bilinear version
+//
+// texel  - The sample position, in texels (already offset by -0.5)
+// radius - 1 for 3x3, 2 for 5x5
+float GatherPCF(
+	Texture2DArray shadowMap,
+	SamplerComparisonState shadowSampler,
+	float2 texel,
+	float slice,
+	float depth,
+	float mapSize,
+	int radius)
+{
+	float2 base = floor(texel);
+	float2 f = texel - base;
+
+	// A bilinear box of width (2r + 1) touches texels -r to r + 1 on each
+	// axis: the outer two are weighted by the fraction, the rest fully
+	float lit = 0.0f;
+	for (int y = -radius; y <= radius + 1; y += 2)
+	{
+		for (int x = -radius; x <= radius + 1; x += 2)
+		{
+			// Gather the 2x2 texels starting at (x, y) - its uv is their shared corner
+			float2 uv = (base + float2(x, y) + 1.0f) / mapSize;
+			float4 c = shadowMap.GatherCmp(shadowSampler, float3(uv, slice), depth);
+
+			// Gather order is (0,1), (1,1), (1,0), (0,0)
+			float2 w0 = float2(
+				x == -radius ? 1.0f - f.x : 1.0f,
+				y == -radius ? 1.0f - f.y : 1.0f);
+			float2 w1 = float2(
+				x + 1 == radius + 1 ? f.x : 1.0f,
+				y + 1 == radius + 1 ? f.y : 1.0f);
+			lit +=
+				c.w * w0.x * w0.y +
+				c.z * w1.x * w0.y +
+				c.x * w0.x * w1.y +
+				c.y * w1.x * w1.y;
+		}
+	}
+
+	float width = radius * 2.0f + 1.0f;
+	return lit / (width * width);
+}
+
+// How lit a pixel is by the shadowed light (0 to 1)
+//
+// shadowMap      - One slice per cascade
+// viewProjection - The cascade's light view * projection
+// cascade        - From GetShadowCascade()
+// filterRadius   - 0 for a single bilinear comparison, 1 for 3x3, 2 for 5x5
+// mapSize        - Width (and height) of each cascade, in texels
+float SampleCascadedShadow(
+	Texture2DArray shadowMap,
+	SamplerComparisonState shadowSampler,
+	matrix viewProjection,
+	uint cascade,
+	float3 worldPos,
+	int filterRadius,
+	float mapSize)
+{
+	if (cascade >= MAX_SHADOW_CASCADES)
+		return 1.0f;
+
+	// Into the cascade's map - flip Y, since texture space goes down
+	float4 shadowPos = mul(viewProjection, float4(worldPos, 1.0f));
+	float2 uv = shadowPos.xy * float2(0.5f, -0.5f) + 0.5f;
+
+	[branch]
+	if (filterRadius <= 0)
+		return shadowMap.SampleCmpLevelZero(shadowSampler, float3(uv, cascade), shadowPos.z);
+
+	return GatherPCF(shadowMap, shadowSampler, uv * mapSize - 0.5f, cascade, shadowPos.z, mapSize, filterRadius);
+}
+
+// One tile of the local light shadow atlas
+// - Must match ShadowAtlas::TileData
+struct ShadowTile
+{
+	matrix ViewProjection;
+	float4 AtlasRect;	// Scale (xy) and offset (zw) from the tile's uv to the atlas
+};
+
+// Which face of a point light's cube a direction falls on,
+// in the order +X, -X, +Y, -Y, +Z, -Z
+//
+// lightToPixel - From the light to the pixel (needn't be normalized)
+uint GetCubeFace(float3 lightToPixel)
+{
+	float3 a = abs(lightToPixel);
+	if (a.x >= a.y && a.x >= a.z)
+		return lightToPixel.x >= 0.0f ? 0 : 1;
+	if (a.y >= a.z)
+		return lightToPixel.y >= 0.0f ? 2 : 3;
+	return lightToPixel.z >= 0.0f ? 4 : 5;
+}
+
+// How lit a pixel is by a light with a tile in the shadow atlas (0 to 1)
+//
+// tile      - The light's tile (or its cube face's tile)
+// atlasSize - Width (and height) of the atlas, in texels
+float SampleAtlasShadow(
+	Texture2D shadowAtlas,
+	SamplerComparisonState shadowSampler,
+	ShadowTile tile,
+	float3 worldPos,
+	float atlasSize)
+{
+	float4 shadowPos = mul(tile.ViewProjection, float4(worldPos, 1.0f));
+	shadowPos.xyz /= shadowPos.w;
+	float2 uv = shadowPos.xy * float2(0.5f, -0.5f) + 0.5f;
+
+	// Outside the tile's frustum isn't shadowed by it
+	if (any(uv < 0.0f) || any(uv > 1.0f) || shadowPos.z > 1.0f)
+		return 1.0f;
+
+	// Keep the bilinear footprint from reaching into the neighbouring tiles
+	float2 atlasUV = uv * tile.AtlasRect.xy + tile.AtlasRect.zw;
+	float halfTexel = 0.5f / atlasSize;
+	atlasUV = clamp(atlasUV, tile.AtlasRect.zw + halfTexel, tile.AtlasRect.zw + tile.AtlasRect.xy - halfTexel);
+
+	return shadowAtlas.SampleCmpLevelZero(shadowSampler, atlasUV, shadowPos.z);
+}
+
+#endif
\ No newline at end of file
@@ -28,8 +28,11 @@ VertexToPixel main(VertexShaderInput input)
 	VertexToPixel output;
 
 	// Calculate the screen position of this pixel
+	// - Precise, and exactly as VertexShader does it, since this also
+	//   draws the depth prepass the main pass tests against for equality
 	matrix wvp = mul(projection, mul(view, world));
-	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+	precise float4 screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+	output.screenPosition = screenPosition;
 	
 	// Whatever we return will make its way through the pipeline to the
 	// next programmable stage we're using (the pixel shader for now)
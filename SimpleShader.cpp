@@ -1,4 +1,5 @@
 #include "SimpleShader.h"
+#include "CpuProfiler.h"
 
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
@@ -80,6 +81,8 @@ void ISimpleShader::CleanUp()
 // --------------------------------------------------------
 bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 {
+	CPU_PROFILE_FUNCTION();
+
 	// Load the shader to a blob and ensure it worked
 	HRESULT hr = D3DReadFileToBlob(shaderFile, shaderBlob.GetAddressOf());
 	if (hr != S_OK)
@@ -342,6 +345,8 @@ void ISimpleShader::SetShader()
 // --------------------------------------------------------
 void ISimpleShader::CopyAllBufferData()
 {
+	CPU_PROFILE_FUNCTION();
+
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
@@ -349,9 +354,7 @@ void ISimpleShader::CopyAllBufferData()
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
 		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		UploadConstantBuffer(&constantBuffers[i]);
 	}
 }
 
@@ -380,9 +383,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0,
-		cb->LocalDataBuffer, 0, 0);
+	UploadConstantBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -402,11 +403,133 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
+	UploadConstantBuffer(cb);
+}
+
+
+// --------------------------------------------------------
+// Copies a buffer's local data to the GPU
+//
+// With a ConstantBufferRing, the data goes into a fresh slice
+// of the ring, which is bound right away since the slice (and
+// therefore the binding) changes with every copy.  Otherwise
+// the shader's own buffer is updated in place.
+// --------------------------------------------------------
+void ISimpleShader::UploadConstantBuffer(SimpleConstantBuffer* cb)
+{
+	if (constantBufferRing && cb->Type == D3D11_CT_CBUFFER)
+	{
+		cb->RingSliceValid = constantBufferRing->Upload(
+			cb->LocalDataBuffer,
+			cb->Size,
+			&cb->RingFirstConstant,
+			&cb->RingNumConstants);
+
+		if (cb->RingSliceValid)
+		{
+			SetConstantBufferRange(cb);
+			return;
+		}
+	}
+
 	deviceContext->UpdateSubresource(
 		cb->ConstantBuffer.Get(), 0, 0,
 		cb->LocalDataBuffer, 0, 0);
+
+	// The slot may still hold an older ring slice, so point it back at this buffer
+	if (constantBufferRing && cb->Type == D3D11_CT_CBUFFER)
+		SetConstantBufferRange(cb);
+}
+
+// --------------------------------------------------------
+// Where a constant buffer's latest data is, for binding by
+// offset: its ring slice, or all of its own buffer
+// --------------------------------------------------------
+void ISimpleShader::GetConstantBufferBinding(SimpleConstantBuffer* cb, ID3D11Buffer** buffer, unsigned int* firstConstant, unsigned int* numConstants)
+{
+	if (cb->RingSliceValid)
+	{
+		*buffer = constantBufferRing->GetBuffer();
+		*firstConstant = cb->RingFirstConstant;
+		*numConstants = cb->RingNumConstants;
+		return;
+	}
+
+	// Ranges have to be whole multiples of 16 constants, so round the buffer up
+	*buffer = cb->ConstantBuffer.Get();
+	*firstConstant = 0;
+	*numConstants = (cb->Size / 16 + 15) & ~15u;
+}
+
+// --------------------------------------------------------
+// Routes this shader's constant buffer uploads through a
+// shared ring (or back to its own buffers, if ring is null)
+//
+// Returns true if the ring will be used
+// --------------------------------------------------------
+bool ISimpleShader::SetConstantBufferRing(std::shared_ptr<ConstantBufferRing> ring)
+{
+	constantBufferRing.reset();
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+		constantBuffers[i].RingSliceValid = false;
+
+	if (!ring || !ring->IsSupported() || !SupportsConstantBufferRing())
+		return false;
+
+	// Binding by offset requires the 11.1 version of the context
+	if (FAILED(deviceContext.As(&deviceContext1)))
+		return false;
+
+	constantBufferRing = ring;
+	return true;
 }
 
+// --------------------------------------------------------
+// Captures where each of this shader's constant buffers
+// last went in the ring
+//
+// ranges - Receives one entry per constant buffer
+//
+// Returns false if there's no ring, or if any buffer hasn't
+// been copied into it (those would need this shader's own
+// buffers, which only the immediate context should touch)
+// --------------------------------------------------------
+bool ISimpleShader::GetConstantBufferRanges(SimpleConstantBufferRanges* ranges)
+{
+	ranges->Count = 0;
+	if (!shaderValid || !constantBufferRing)
+		return false;
+
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		// Skip "buffers" that aren't true constant buffers
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+			continue;
+
+		if (!constantBuffers[i].RingSliceValid || ranges->Count == SimpleConstantBufferRanges::MaxBuffers)
+			return false;
+
+		ranges->BindIndex[ranges->Count] = constantBuffers[i].BindIndex;
+		ranges->FirstConstant[ranges->Count] = constantBuffers[i].RingFirstConstant;
+		ranges->NumConstants[ranges->Count] = constantBuffers[i].RingNumConstants;
+		ranges->Count++;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets the shader and previously captured ring slices
+// through the given cache, which may wrap any context.
+// Nothing here touches this shader's own context or local
+// data, so it's safe to call from a worker thread.
+// --------------------------------------------------------
+void ISimpleShader::SetShader(std::shared_ptr<StateCache> cache, const SimpleConstantBufferRanges& ranges)
+{
+	// Ensure the shader is valid
+	if (!shaderValid) return;
+
+	SetShaderAndRanges(cache.get(), ranges);
+}
 
 // --------------------------------------------------------
 // Sets a variable by name with arbitrary data of the specified size
@@ -603,6 +726,16 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 }
 
 
+// --------------------------------------------------------
+// Gets the register of a named SRV, or -1 if there's none
+// --------------------------------------------------------
+int ISimpleShader::GetTextureSlot(const std::string& name)
+{
+	const SimpleSRV* info = GetShaderResourceViewInfo(name);
+	return info ? (int)info->BindIndex : -1;
+}
+
+
 // --------------------------------------------------------
 // Gets info about a sampler in the shader (or null)
 // 
@@ -637,6 +770,16 @@ const SimpleSampler* ISimpleShader::GetSamplerInfo(unsigned int index)
 }
 
 
+// --------------------------------------------------------
+// Gets the register of a named sampler, or -1 if there's none
+// --------------------------------------------------------
+int ISimpleShader::GetSamplerSlot(const std::string& name)
+{
+	const SimpleSampler* info = GetSamplerInfo(name);
+	return info ? (int)info->BindIndex : -1;
+}
+
+
 // --------------------------------------------------------
 // Gets the number of constant buffers in this shader
 // --------------------------------------------------------
@@ -680,6 +823,40 @@ const SimpleConstantBuffer* ISimpleShader::GetBufferInfo(unsigned int index)
 	return &constantBuffers[index];
 }
 
+// --------------------------------------------------------
+// Gets the size of a constant buffer's local data, or zero
+// if there's no such buffer
+// --------------------------------------------------------
+unsigned int ISimpleShader::GetConstantBufferSize(unsigned int index)
+{
+	return index < constantBufferCount ? constantBuffers[index].Size : 0;
+}
+
+// --------------------------------------------------------
+// Gets a constant buffer's local data, or null
+// --------------------------------------------------------
+const void* ISimpleShader::GetConstantBufferData(unsigned int index)
+{
+	return index < constantBufferCount ? constantBuffers[index].LocalDataBuffer : 0;
+}
+
+// --------------------------------------------------------
+// Overwrites a constant buffer's local data from the start,
+// as if each of its variables had been set
+//
+// index - the index of the constant buffer
+// data  - the new data
+// size  - bytes of data, no more than the buffer's size
+// --------------------------------------------------------
+bool ISimpleShader::SetConstantBufferData(unsigned int index, const void* data, unsigned int size)
+{
+	if (index >= constantBufferCount || size > constantBuffers[index].Size)
+		return false;
+
+	memcpy(constantBuffers[index].LocalDataBuffer, data, size);
+	return true;
+}
+
 
 
 
@@ -869,8 +1046,16 @@ void SimpleVertexShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout.Get());
-	deviceContext->VSSetShader(shader.Get(), 0, 0);
+	if (stateCache)
+	{
+		stateCache->IASetInputLayout(inputLayout.Get());
+		stateCache->VSSetShader(shader.Get());
+	}
+	else
+	{
+		deviceContext->IASetInputLayout(inputLayout.Get());
+		deviceContext->VSSetShader(shader.Get(), 0, 0);
+	}
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -879,7 +1064,20 @@ void SimpleVertexShader::SetShaderAndCBs()
 		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
 			continue;
 
+		// Was this buffer's data last copied into a ring?
+		if (constantBufferRing && constantBuffers[i].RingSliceValid)
+		{
+			SetConstantBufferRange(&constantBuffers[i]);
+			continue;
+		}
+
 		// This is a real constant buffer, so set it
+		if (stateCache)
+		{
+			stateCache->VSSetConstantBuffers(constantBuffers[i].BindIndex, 1, constantBuffers[i].ConstantBuffer.GetAddressOf());
+			continue;
+		}
+
 		deviceContext->VSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
@@ -887,6 +1085,44 @@ void SimpleVertexShader::SetShaderAndCBs()
 	}
 }
 
+// --------------------------------------------------------
+// Binds the ring slice holding a constant buffer's latest data,
+// or the shader's own buffer if the data had to go there
+// --------------------------------------------------------
+void SimpleVertexShader::SetConstantBufferRange(SimpleConstantBuffer* cb)
+{
+	ID3D11Buffer* buffer = 0;
+	unsigned int firstConstant = 0;
+	unsigned int numConstants = 0;
+	GetConstantBufferBinding(cb, &buffer, &firstConstant, &numConstants);
+	if (stateCache)
+	{
+		stateCache->VSSetConstantBuffers1(cb->BindIndex, 1, &buffer, &firstConstant, &numConstants);
+		return;
+	}
+
+	deviceContext1->VSSetConstantBuffers1(
+		cb->BindIndex,
+		1,
+		&buffer,
+		&firstConstant,
+		&numConstants);
+}
+
+// --------------------------------------------------------
+// Sets the vertex shader, input layout and captured ring
+// slices through the given cache
+// --------------------------------------------------------
+void SimpleVertexShader::SetShaderAndRanges(StateCache* cache, const SimpleConstantBufferRanges& ranges)
+{
+	cache->IASetInputLayout(inputLayout.Get());
+	cache->VSSetShader(shader.Get());
+
+	ID3D11Buffer* ring = constantBufferRing ? constantBufferRing->GetBuffer() : 0;
+	for (unsigned int i = 0; i < ranges.Count; i++)
+		cache->VSSetConstantBuffers1(ranges.BindIndex[i], 1, &ring, &ranges.FirstConstant[i], &ranges.NumConstants[i]);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the vertex shader stage
 //
@@ -911,7 +1147,10 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (stateCache)
+		stateCache->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	else
+		deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -941,7 +1180,10 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (stateCache)
+		stateCache->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	else
+		deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1012,7 +1254,10 @@ void SimplePixelShader::SetShaderAndCBs()
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->PSSetShader(shader.Get(), 0, 0);
+	if (stateCache)
+		stateCache->PSSetShader(shader.Get());
+	else
+		deviceContext->PSSetShader(shader.Get(), 0, 0);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
@@ -1021,7 +1266,20 @@ void SimplePixelShader::SetShaderAndCBs()
 		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
 			continue;
 
+		// Was this buffer's data last copied into a ring?
+		if (constantBufferRing && constantBuffers[i].RingSliceValid)
+		{
+			SetConstantBufferRange(&constantBuffers[i]);
+			continue;
+		}
+
 		// This is a real constant buffer, so set it
+		if (stateCache)
+		{
+			stateCache->PSSetConstantBuffers(constantBuffers[i].BindIndex, 1, constantBuffers[i].ConstantBuffer.GetAddressOf());
+			continue;
+		}
+
 		deviceContext->PSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
@@ -1029,6 +1287,43 @@ void SimplePixelShader::SetShaderAndCBs()
 	}
 }
 
+// --------------------------------------------------------
+// Binds the ring slice holding a constant buffer's latest data,
+// or the shader's own buffer if the data had to go there
+// --------------------------------------------------------
+void SimplePixelShader::SetConstantBufferRange(SimpleConstantBuffer* cb)
+{
+	ID3D11Buffer* buffer = 0;
+	unsigned int firstConstant = 0;
+	unsigned int numConstants = 0;
+	GetConstantBufferBinding(cb, &buffer, &firstConstant, &numConstants);
+	if (stateCache)
+	{
+		stateCache->PSSetConstantBuffers1(cb->BindIndex, 1, &buffer, &firstConstant, &numConstants);
+		return;
+	}
+
+	deviceContext1->PSSetConstantBuffers1(
+		cb->BindIndex,
+		1,
+		&buffer,
+		&firstConstant,
+		&numConstants);
+}
+
+// --------------------------------------------------------
+// Sets the pixel shader and captured ring slices through
+// the given cache
+// --------------------------------------------------------
+void SimplePixelShader::SetShaderAndRanges(StateCache* cache, const SimpleConstantBufferRanges& ranges)
+{
+	cache->PSSetShader(shader.Get());
+
+	ID3D11Buffer* ring = constantBufferRing ? constantBufferRing->GetBuffer() : 0;
+	for (unsigned int i = 0; i < ranges.Count; i++)
+		cache->PSSetConstantBuffers1(ranges.BindIndex[i], 1, &ring, &ranges.FirstConstant[i], &ranges.NumConstants[i]);
+}
+
 // --------------------------------------------------------
 // Sets a shader resource view in the pixel shader stage
 //
@@ -1053,7 +1348,10 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (stateCache)
+		stateCache->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	else
+		deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1083,7 +1381,10 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (stateCache)
+		stateCache->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	else
+		deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -10,6 +10,11 @@
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <memory>
+
+#include "ConstantBufferRing.h"
+#include "RenderDevice.h"
+#include "StateCache.h"
 
 
 // --------------------------------------------------------
@@ -37,8 +42,19 @@ struct SimpleConstantBuffer
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
 	std::vector<SimpleShaderVariable> Variables;
+
+	// Where this buffer's data last went in a ConstantBufferRing (if one is in use)
+	bool RingSliceValid = false;
+	unsigned int RingFirstConstant = 0;
+	unsigned int RingNumConstants = 0;
 };
 
+// --------------------------------------------------------
+// Where a shader's constant buffers currently sit in the
+// ConstantBufferRing (see RenderDevice.h)
+// --------------------------------------------------------
+typedef RenderConstantBufferRanges SimpleConstantBufferRanges;
+
 // --------------------------------------------------------
 // Contains info about a single SRV in a shader
 // --------------------------------------------------------
@@ -59,8 +75,9 @@ struct SimpleSampler
 
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
+// - Also the Direct3D 11 backend's RenderShader
 // --------------------------------------------------------
-class ISimpleShader
+class ISimpleShader : public RenderShader
 {
 public:
 	ISimpleShader(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
@@ -109,15 +126,39 @@ public:
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
 	size_t GetSamplerCount() { return samplerTable.size(); }
 
+	// Registers by name, or -1 (for RenderShader)
+	int GetTextureSlot(const std::string& name);
+	int GetSamplerSlot(const std::string& name);
+
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
 	unsigned int GetBufferSize(unsigned int index);
 	const SimpleConstantBuffer* GetBufferInfo(std::string name);
 	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
 
+	// Whole local constant buffers by index (for RenderShader)
+	unsigned int GetConstantBufferCount() { return constantBufferCount; }
+	unsigned int GetConstantBufferSize(unsigned int index);
+	const void* GetConstantBufferData(unsigned int index);
+	bool SetConstantBufferData(unsigned int index, const void* data, unsigned int size);
+
 	// Misc getters
 	Microsoft::WRL::ComPtr<ID3DBlob> GetShaderBlob() { return shaderBlob; }
 
+	// Optionally upload constant buffers into a shared ring instead of
+	// this shader's own buffers.  Returns false if this shader type or
+	// the device can't bind constant buffers by offset
+	bool SetConstantBufferRing(std::shared_ptr<ConstantBufferRing> ring);
+
+	// Optionally bind through a StateCache so redundant binds are dropped
+	void SetStateCache(std::shared_ptr<StateCache> cache) { stateCache = cache; }
+
+	// Recording on other contexts (deferred contexts on worker threads)
+	// - Capture the ring slices right after CopyAllBufferData(), on the thread that copies
+	// - Then bind the shader with those slices through any context's StateCache
+	bool GetConstantBufferRanges(SimpleConstantBufferRanges* ranges);
+	void SetShader(std::shared_ptr<StateCache> cache, const SimpleConstantBufferRanges& ranges);
+
 	// Error reporting
 	static bool ReportErrors;
 	static bool ReportWarnings;
@@ -129,6 +170,13 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
 
+	// Constant buffer ring (optional) and the 11.1 context needed to bind from it
+	std::shared_ptr<ConstantBufferRing> constantBufferRing;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> deviceContext1;
+
+	// State cache (optional) that VS and PS binds go through
+	std::shared_ptr<StateCache> stateCache;
+
 	// Resource counts
 	unsigned int constantBufferCount;
 
@@ -148,6 +196,15 @@ protected:
 	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob) = 0;
 	virtual void SetShaderAndCBs() = 0;
 
+	// Ring support - only stages that override these can use a ConstantBufferRing
+	virtual bool SupportsConstantBufferRing() { return false; }
+	virtual void SetConstantBufferRange(SimpleConstantBuffer* cb) { }
+	virtual void SetShaderAndRanges(StateCache* cache, const SimpleConstantBufferRanges& ranges) { }
+	void GetConstantBufferBinding(SimpleConstantBuffer* cb, ID3D11Buffer** buffer, unsigned int* firstConstant, unsigned int* numConstants);
+
+	// Copies a buffer's local data to the GPU, through the ring if there is one
+	void UploadConstantBuffer(SimpleConstantBuffer* cb);
+
 	virtual void CleanUp();
 
 	// Helpers for finding data by name
@@ -187,6 +244,9 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11VertexShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	bool SupportsConstantBufferRing() { return true; }
+	void SetConstantBufferRange(SimpleConstantBuffer* cb);
+	void SetShaderAndRanges(StateCache* cache, const SimpleConstantBufferRanges& ranges);
 	void CleanUp();
 };
 
@@ -208,6 +268,9 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	bool SupportsConstantBufferRing() { return true; }
+	void SetConstantBufferRange(SimpleConstantBuffer* cb);
+	void SetShaderAndRanges(StateCache* cache, const SimpleConstantBufferRanges& ranges);
 	void CleanUp();
 };
 
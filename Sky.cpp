@@ -1,158 +1,66 @@
 #include "Sky.h"
 
 Sky::Sky(
-	Microsoft::WRL::ComPtr<ID3D11Device> device,
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	RenderDevice* device,
 	std::shared_ptr<Mesh> skyGeometry,
-	std::shared_ptr<SimpleVertexShader> skyVS,
-	std::shared_ptr<SimplePixelShader> skyPS,
-	Microsoft::WRL::ComPtr<ID3D11SamplerState> skySampler,
-	const wchar_t* right,
-	const wchar_t* left,
-	const wchar_t* up,
-	const wchar_t* down,
-	const wchar_t* front,
-	const wchar_t* back)
+	std::shared_ptr<RenderShader> skyVS,
+	std::shared_ptr<RenderShader> skyPS,
+	std::shared_ptr<RenderSampler> skySampler,
+	std::shared_ptr<RenderTexture> cubeMap)
 	:
 	skyGeometry(skyGeometry),
 	skyVS(skyVS),
 	skyPS(skyPS),
-	skySampler(skySampler)
+	skySampler(skySampler),
+	cubeMap(cubeMap)
 {
-	// Start by creating the cube SRV from all six given file paths
-	skySRV = CreateCubemap(
-		device, context,
-		right, left, up, down, front, back
-	);
+	// Look up the registers once, rather than every frame
+	cubeSlot = skyPS->GetTextureSlot("SkyCube");
+	samplerSlot = skyPS->GetSamplerSlot("SkySampler");
 
 	// Initialize the render states
 	InitRenderStates(device);
 }
 
-// --------------------------------------------------------
-// Loads six individual textures (the six faces of a cube map), then
-// creates a blank cube map and copies each of the six textures to
-// another face.  Afterwards, creates a shader resource view for
-// the cube map and cleans up all of the temporary resources.
-// --------------------------------------------------------
-Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap (
-	Microsoft::WRL::ComPtr<ID3D11Device> device,
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
-	const wchar_t* right,
-	const wchar_t* left,
-	const wchar_t* up,
-	const wchar_t* down,
-	const wchar_t* front,
-	const wchar_t* back)
+void Sky::InitRenderStates(RenderDevice* device)
 {
-	// Load the 6 textures into an array.
-	// - We need references to the TEXTURES, not SHADER RESOURCE VIEWS!
-	// - Explicitly NOT generating mipmaps, as we don't need them for the sky!
-	// - Order matters here!  +X, -X, +Y, -Y, +Z, -Z
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> textures[6] = {};
-	DirectX::CreateWICTextureFromFile(device.Get(), right, (ID3D11Resource**)textures[0].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(device.Get(), left, (ID3D11Resource**)textures[1].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(device.Get(), up, (ID3D11Resource**)textures[2].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(device.Get(), down, (ID3D11Resource**)textures[3].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(device.Get(), front, (ID3D11Resource**)textures[4].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(device.Get(), back, (ID3D11Resource**)textures[5].GetAddressOf(), 0);
-
-	// We'll assume all of the textures are the same color format and resolution,
-	// so get the description of the first shader resource view
-	D3D11_TEXTURE2D_DESC faceDesc = {};
-	textures[0]->GetDesc(&faceDesc);
-
-	// Describe the resource for the cube map, which is simply 
-	// a "texture 2d array" with the TEXTURECUBE flag set.  
-	// This is a special GPU resource format, NOT just a 
-	// C++ array of textures!!!
-	D3D11_TEXTURE2D_DESC cubeDesc = {};
-	cubeDesc.ArraySize = 6;            // Cube map!
-	cubeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE; // We'll be using as a texture in a shader
-	cubeDesc.CPUAccessFlags = 0;       // No read back
-	cubeDesc.Format = faceDesc.Format; // Match the loaded texture's color format
-	cubeDesc.Width = faceDesc.Width;   // Match the size
-	cubeDesc.Height = faceDesc.Height; // Match the size
-	cubeDesc.MipLevels = 1;            // Only need 1
-	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE; // This should be treated as a CUBE, not 6 separate textures
-	cubeDesc.Usage = D3D11_USAGE_DEFAULT; // Standard usage
-	cubeDesc.SampleDesc.Count = 1;
-	cubeDesc.SampleDesc.Quality = 0;
-
-	// Create the final texture resource to hold the cube map
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> cubeMapTexture;
-	device->CreateTexture2D(&cubeDesc, 0, cubeMapTexture.GetAddressOf());
-
-	// Loop through the individual face textures and copy them,
-	// one at a time, to the cube map texure
-	for (int i = 0; i < 6; i++)
-	{
-		// Calculate the subresource position to copy into
-		unsigned int subresource = D3D11CalcSubresource(
-			0,  // Which mip (zero, since there's only one)
-			i,  // Which array element?
-			1); // How many mip levels are in the texture?
-
-		// Copy from one resource (texture) to another
-		context->CopySubresourceRegion(
-			cubeMapTexture.Get(),  // Destination resource
-			subresource,           // Dest subresource index (one of the array elements)
-			0, 0, 0,               // XYZ location of copy
-			textures[i].Get(),     // Source resource
-			0,                     // Source subresource index (we're assuming there's only one)
-			0);                    // Source subresource "box" of data to copy (zero means the whole thing)
-	}
-
-	// At this point, all of the faces have been copied into the 
-	// cube map texture, so we can describe a shader resource view for it
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = cubeDesc.Format;         // Same format as texture
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE; // Treat this as a cube!
-	srvDesc.TextureCube.MipLevels = 1;        // Only need access to 1 mip
-	srvDesc.TextureCube.MostDetailedMip = 0;  // Index of the first mip we want to see
-
-	// Make the SRV
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cubeSRV;
-	device->CreateShaderResourceView(cubeMapTexture.Get(), &srvDesc, cubeSRV.GetAddressOf());
-
-	// Send back the SRV, which is what we need for our shaders
-	return cubeSRV;
+	// Special rasterizer that reverses the cull side so you draw the insides of the cube,
+	// and a depth test that accepts pixels with a depth of 1 or less (but ours will be at exactly 1)
+	RenderPipelineStateDesc stateDesc = {};
+	stateDesc.Cull = RenderPipelineStateDesc::CullFront;
+	stateDesc.DepthEnable = true;
+	stateDesc.DepthWrite = true;
+	stateDesc.DepthTest = RenderPipelineStateDesc::LessEqual;
+	skyPipelineState = device->CreatePipelineState(stateDesc);
 }
 
-void Sky::InitRenderStates(Microsoft::WRL::ComPtr<ID3D11Device> device)
-{
-	// Special rasterizer that reverses the cull side so you draw the insides of the cube
-	D3D11_RASTERIZER_DESC rasterOptionsDesc = {};
-	rasterOptionsDesc.FillMode = D3D11_FILL_SOLID;
-	rasterOptionsDesc.CullMode = D3D11_CULL_FRONT;
-	rasterOptionsDesc.DepthClipEnable = true;
-	device->CreateRasterizerState(&rasterOptionsDesc, skyRasterizerState.GetAddressOf());
-
-	// Special depth state to accept pixels with a depth of 1 or less (but ours will be at exactly 1)
-	D3D11_DEPTH_STENCIL_DESC depthStencilDesc = {};
-	depthStencilDesc.DepthEnable = true;
-	depthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-	depthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-	device->CreateDepthStencilState(&depthStencilDesc, skyDepthStencilState.GetAddressOf());
-}
-
-void Sky::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera)
+// --------------------------------------------------------
+// Draws the sky box with its special render states
+// - The states are left bound afterwards; whoever draws next
+//   sets the ones they need (which the cache filters if unchanged)
+// --------------------------------------------------------
+void Sky::Draw(RenderContext* context, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection)
 {
-	context->RSSetState(skyRasterizerState.Get());
-	context->OMSetDepthStencilState(skyDepthStencilState.Get(), 0);
+	context->SetPipelineState(skyPipelineState.get());
 
-	skyVS->SetShader();
-	skyPS->SetShader();
-
-	skyVS->SetMatrix4x4("view", camera->GetView());
-	skyVS->SetMatrix4x4("projection", camera->GetProjection());
+	// Copy the constants before binding, so the bind picks up this frame's
+	skyVS->SetData("view", &view, sizeof(view));
+	skyVS->SetData("projection", &projection, sizeof(projection));
 	skyVS->CopyAllBufferData();
 
-	skyPS->SetShaderResourceView("SkyCube", skySRV);
-	skyPS->SetSamplerState("SkySampler", skySampler);
+	context->SetShader(RenderContext::VertexStage, skyVS.get(), 0);
+	context->SetShader(RenderContext::PixelStage, skyPS.get(), 0);
 
-	skyGeometry->Draw();
+	if (cubeSlot >= 0)
+	{
+		RenderTexture* texture = cubeMap.get();
+		context->SetTextures(RenderContext::PixelStage, cubeSlot, 1, &texture);
+	}
+	if (samplerSlot >= 0)
+	{
+		RenderSampler* sampler = skySampler.get();
+		context->SetSamplers(RenderContext::PixelStage, samplerSlot, 1, &sampler);
+	}
 
-	context->RSSetState(0);
-	context->OMSetDepthStencilState(0, 0);
+	skyGeometry->Draw(context);
 }
@@ -1,66 +1,39 @@
 #pragma once
 
-#include <d3d11.h>
-#include <wrl/client.h>
 #include <memory>
 #include "Mesh.h"
-#include "SimpleShader.h"
-#include "Camera.h"
-#include "WICTextureLoader.h"
+#include "RenderDevice.h"
 
 class Sky
 {
 public:
+	// - cubeMap is a six-slice cube texture (see TextureManager::LoadCubeAsync)
 	Sky(
-		Microsoft::WRL::ComPtr<ID3D11Device> device,
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		RenderDevice* device,
 		std::shared_ptr<Mesh> skyGeometry,
-		std::shared_ptr<SimpleVertexShader> skyVS,
-		std::shared_ptr<SimplePixelShader> skyPS,
-		Microsoft::WRL::ComPtr<ID3D11SamplerState> skySampler,
-		const wchar_t* right,
-		const wchar_t* left,
-		const wchar_t* up,
-		const wchar_t* down,
-		const wchar_t* front,
-		const wchar_t* back
+		std::shared_ptr<RenderShader> skyVS,
+		std::shared_ptr<RenderShader> skyPS,
+		std::shared_ptr<RenderSampler> skySampler,
+		std::shared_ptr<RenderTexture> cubeMap
 	);
 
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<Camera> camera);
+	void Draw(RenderContext* context, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
+
+	// Swaps in a new cube map, like the real one once it has loaded
+	void SetCubeMap(std::shared_ptr<RenderTexture> newCubeMap) { cubeMap = newCubeMap; }
 
 private:
 	std::shared_ptr<Mesh> skyGeometry;
-	std::shared_ptr<SimpleVertexShader> skyVS;
-	std::shared_ptr<SimplePixelShader> skyPS;
-	Microsoft::WRL::ComPtr<ID3D11SamplerState> skySampler;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> skySRV;
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> skyDepthStencilState;
-	Microsoft::WRL::ComPtr<ID3D11RasterizerState> skyRasterizerState;
+	std::shared_ptr<RenderShader> skyVS;
+	std::shared_ptr<RenderShader> skyPS;
+	std::shared_ptr<RenderSampler> skySampler;
+	std::shared_ptr<RenderTexture> cubeMap;
+	std::shared_ptr<RenderPipelineState> skyPipelineState;
 
-	// --------------------------------------------------------
-	// Author: Chris Cascioli
-	// Purpose: Creates a cube map on the GPU from 6 individual textures
-	// 
-	// - You are allowed to directly copy/paste this into your code base
-	//   for assignments, given that you clearly cite that this is not
-	//   code of your own design.
-	//
-	// - Note: This code assumes youre putting the function in Game.cpp, 
-	//   youve included WICTextureLoader.h and you have an ID3D11Device 
-	//   ComPtr called device.  Make any adjustments necessary for
-	//   your own implementation.
-	// --------------------------------------------------------
-	// Helper for creating a cubemap from 6 individual textures
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCubemap(
-		Microsoft::WRL::ComPtr<ID3D11Device> device,
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
-		const wchar_t* right,
-		const wchar_t* left,
-		const wchar_t* up,
-		const wchar_t* down,
-		const wchar_t* front,
-		const wchar_t* back);
+	// Where the sky pixel shader wants its cube and sampler (-1 if it doesn't)
+	int cubeSlot;
+	int samplerSlot;
 
-	void InitRenderStates(Microsoft::WRL::ComPtr<ID3D11Device> device);
+	void InitRenderStates(RenderDevice* device);
 };
 
@@ -0,0 +1,409 @@
+#include "SoftwareReference.h"
+#include "Benchmark.h"
+#include "CameraPath.h"
+#include "CpuProfiler.h"
+#include "FrameTimeStats.h"
+#include "ImageReader.h"
+#include "ImageWriter.h"
+#include "JobSystem.h"
+
+#include <fstream>
+#include <math.h>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+// --------------------------------------------------------
+// Defaults, for when the command line leaves something out
+// - The size and camera settings are the game's
+// --------------------------------------------------------
+SoftwareReference::Settings SoftwareReference::GetDefaultSettings()
+{
+	Settings settings = {};
+	settings.Enabled = false;
+	settings.Width = 1280;
+	settings.Height = 720;
+	settings.Views = 4;
+	settings.Repeats = 5;
+	settings.Threads = 0;
+	settings.TileSize = 32;
+	settings.OutputPrefix = "SoftwareReference";
+	settings.Tolerance = 1.0f;
+	settings.ResultsFile = "SoftwareReferenceResults.csv";
+	settings.Sky = true;
+	return settings;
+}
+
+// --------------------------------------------------------
+// Reads software reference settings from the command line
+//
+// commandLine - Arguments only, as WinMain() gets them
+// settings    - Filled in from the defaults and the arguments
+// --------------------------------------------------------
+bool SoftwareReference::ParseCommandLine(const char* commandLine, Settings* settings)
+{
+	*settings = GetDefaultSettings();
+	if (!commandLine)
+		return true;
+
+	std::istringstream arguments(commandLine);
+	std::string argument;
+	while (arguments >> argument)
+	{
+		if (argument == "-software")
+			settings->Enabled = true;
+		else if (argument == "-assets")
+			arguments >> settings->AssetPath;
+		else if (argument == "-width")
+			arguments >> settings->Width;
+		else if (argument == "-height")
+			arguments >> settings->Height;
+		else if (argument == "-views")
+			arguments >> settings->Views;
+		else if (argument == "-repeats")
+			arguments >> settings->Repeats;
+		else if (argument == "-threads")
+			arguments >> settings->Threads;
+		else if (argument == "-tile")
+			arguments >> settings->TileSize;
+		else if (argument == "-output")
+			arguments >> settings->OutputPrefix;
+		else if (argument == "-golden")
+			arguments >> settings->GoldenPrefix;
+		else if (argument == "-tolerance")
+			arguments >> settings->Tolerance;
+		else if (argument == "-results")
+			arguments >> settings->ResultsFile;
+		else if (argument == "-nosky")
+			settings->Sky = false;
+
+		// A flag missing its value (or given a bad one)
+		if (arguments.fail())
+			return false;
+	}
+
+	return settings->Width > 0 && settings->Height > 0 && settings->Views > 0;
+}
+
+// --------------------------------------------------------
+// Constructor - starts the job system, unless it's meant
+// to run on just this thread
+// --------------------------------------------------------
+SoftwareReference::SoftwareReference(const Settings& settings)
+	:
+	settings(settings)
+{
+	if (settings.Threads != 1)
+		jobSystem = std::make_unique<JobSystem>(settings.Threads > 1 ? settings.Threads - 1 : 0);
+}
+
+SoftwareReference::~SoftwareReference()
+{
+}
+
+// --------------------------------------------------------
+// Builds the scene Game does, from the same asset files
+//
+// Missing textures are left null (and sample as zero), as a
+// texture that fails to load on the GPU is left unbound -
+// anything else missing fails the whole run
+// --------------------------------------------------------
+bool SoftwareReference::LoadScene()
+{
+	CPU_PROFILE_SCOPE("SoftwareReference::LoadScene");
+
+	// Same order as Game::CreateGeometry()
+	const char* meshFiles[] =
+	{
+		"Models/cube.obj",
+		"Models/cylinder.obj",
+		"Models/helix.obj",
+		"Models/quad.obj",
+		"Models/quad_double_sided.obj",
+		"Models/sphere.obj",
+		"Models/torus.obj",
+	};
+	const unsigned int meshCount = sizeof(meshFiles) / sizeof(meshFiles[0]);
+
+	// The two materials' textures, then the sky's faces
+	const char* textureFiles[] =
+	{
+		"Textures/cobblestone_albedo.png",
+		"Textures/cobblestone_normals.png",
+		"Textures/cobblestone_roughness.png",
+		"Textures/cobblestone_metal.png",
+		"Textures/scratched_albedo.png",
+		"Textures/scratched_normals.png",
+		"Textures/scratched_roughness.png",
+		"Textures/scratched_metal.png",
+		"Textures/Sky/right.png",
+		"Textures/Sky/left.png",
+		"Textures/Sky/up.png",
+		"Textures/Sky/down.png",
+		"Textures/Sky/front.png",
+		"Textures/Sky/back.png",
+	};
+	const unsigned int materialTextureCount = 8;
+	const unsigned int textureCount = settings.Sky ? materialTextureCount + 6 : materialTextureCount;
+
+	// Everything loads as its own job, each into its own slot
+	std::vector<std::shared_ptr<SoftwareRenderer::Mesh>> meshes(meshCount);
+	std::vector<std::shared_ptr<SoftwareRenderer::Texture>> textures(textureCount);
+	auto load = [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+			{
+				if (i < meshCount)
+				{
+					std::shared_ptr<SoftwareRenderer::Mesh> mesh = std::make_shared<SoftwareRenderer::Mesh>();
+					if (SoftwareRenderer::LoadObj(settings.AssetPath + "/" + meshFiles[i], mesh.get()))
+						meshes[i] = mesh;
+				}
+				else
+				{
+					std::shared_ptr<SoftwareRenderer::Texture> texture = std::make_shared<SoftwareRenderer::Texture>();
+					if (SoftwareRenderer::LoadTexture(settings.AssetPath + "/" + textureFiles[i - meshCount], texture.get()))
+						textures[i - meshCount] = texture;
+				}
+			}
+		};
+	if (jobSystem)
+		jobSystem->ParallelFor(0, meshCount + textureCount, 1, load);
+	else
+		load(0, meshCount + textureCount);
+
+	bool loaded = true;
+	for (unsigned int i = 0; i < meshCount; i++)
+	{
+		if (!meshes[i])
+		{
+			printf("Couldn't load %s/%s\n", settings.AssetPath.c_str(), meshFiles[i]);
+			loaded = false;
+		}
+	}
+	for (unsigned int i = 0; i < textureCount; i++)
+	{
+		if (!textures[i])
+			printf("Couldn't load %s/%s - carrying on without it\n", settings.AssetPath.c_str(), textureFiles[i]);
+	}
+	if (!loaded)
+		return false;
+
+	// Game::LoadTexturesAndCreateMaterials()
+	std::shared_ptr<SoftwareRenderer::Material> materials[2];
+	const float tints[2][4] = { { 1.0f, 1.0f, 1.0f, 1.0f }, { 1.0f, 0.7f, 0.7f, 1.0f } };
+	for (int m = 0; m < 2; m++)
+	{
+		materials[m] = std::make_shared<SoftwareRenderer::Material>();
+		memcpy(materials[m]->ColorTint, tints[m], sizeof(tints[m]));
+		materials[m]->Albedo = textures[m * 4 + 0];
+		materials[m]->Normal = textures[m * 4 + 1];
+		materials[m]->Roughness = textures[m * 4 + 2];
+		materials[m]->Metalness = textures[m * 4 + 3];
+	}
+	for (int f = 0; f < 6; f++)
+		skyFaces[f] = settings.Sky ? textures[materialTextureCount + f] : 0;
+
+	// Game::CreateRenderables() and SetupTransforms() - alternating
+	// materials, three units apart along X
+	objects.clear();
+	for (unsigned int i = 0; i < meshCount; i++)
+	{
+		SoftwareRenderer::Object object = {};
+		object.Mesh = meshes[i];
+		object.Material = materials[i % 2];
+		object.World[0] = object.World[5] = object.World[10] = object.World[15] = 1.0f;
+		object.World[12] = -9.0f + 3.0f * i;
+		objects.push_back(object);
+	}
+
+	// Game::InitLighting()
+	lights.clear();
+	SoftwareRenderer::Light light = {};
+	light.Type = SoftwareRenderer::LightTypeDirectional;
+	light.Intensity = 1.0f;
+	light.Direction[0] = 1.0f;
+	light.Color[0] = 0.13f; light.Color[1] = 0.05f; light.Color[2] = 0.65f;
+	lights.push_back(light);
+
+	light.Direction[0] = 0.0f; light.Direction[1] = 1.0f;
+	light.Color[0] = 0.0f; light.Color[1] = 0.8f; light.Color[2] = 0.2f;
+	lights.push_back(light);
+
+	light.Direction[1] = -1.0f;
+	light.Color[0] = 0.8f; light.Color[1] = 0.02f; light.Color[2] = 0.13f;
+	lights.push_back(light);
+
+	light = SoftwareRenderer::Light();
+	light.Type = SoftwareRenderer::LightTypePoint;
+	light.Intensity = 1.0f;
+	light.Position[0] = 0.1f; light.Position[1] = -1.0f; light.Position[2] = 0.2f;
+	light.Range = 18.0f;
+	light.Color[0] = 0.87f; light.Color[1] = 0.95f; light.Color[2] = 0.935f;
+	lights.push_back(light);
+
+	light.Position[0] = 0.9f; light.Position[1] = -1.6f; light.Position[2] = 4.0f;
+	light.Range = 45.0f;
+	light.Color[0] = 0.954f; light.Color[1] = 0.85f; light.Color[2] = 1.0f;
+	lights.push_back(light);
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Compares pixels against a golden image of the same size
+// --------------------------------------------------------
+bool SoftwareReference::CompareToGolden(const std::string& path, const unsigned char* pixels, float* rms, unsigned int* maxDifference)
+{
+	std::vector<unsigned char> golden;
+	unsigned int goldenWidth = 0;
+	unsigned int goldenHeight = 0;
+	if (!ReadPpm(path, &golden, &goldenWidth, &goldenHeight) ||
+		goldenWidth != settings.Width ||
+		goldenHeight != settings.Height)
+	{
+		return false;
+	}
+
+	double sumSquares = 0.0;
+	unsigned int largest = 0;
+	size_t pixelCount = (size_t)settings.Width * settings.Height;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			int difference = (int)pixels[i * 4 + c] - (int)golden[i * 4 + c];
+			unsigned int magnitude = (unsigned int)(difference < 0 ? -difference : difference);
+			sumSquares += (double)difference * difference;
+			if (magnitude > largest)
+				largest = magnitude;
+		}
+	}
+
+	*rms = (float)sqrt(sumSquares / (pixelCount * 3));
+	*maxDifference = largest;
+	return true;
+}
+
+// --------------------------------------------------------
+// Renders every view: once untimed (which also warms the
+// caches), then Repeats times under the clock, then saves
+// and checks the image
+// --------------------------------------------------------
+int SoftwareReference::Run()
+{
+	if (!LoadScene())
+		return 2;
+
+	SoftwareRenderer renderer(settings.Width, settings.Height, settings.TileSize);
+	renderer.SetSky(skyFaces);
+
+	// The benchmark's default path, and the game camera's lens
+	CameraPath path = CameraPath::CreateOrbit(15.0f, 2.5f, 20.0f);
+	const float fieldOfView = 3.14159265f / 4.0f;
+	const float nearClip = 0.01f;
+	const float farClip = 100.0f;
+
+	FrameTimeStats frameTimes(settings.Views * settings.Repeats > 0 ? settings.Views * settings.Repeats : 1);
+	double vertexMs = 0.0;
+	double setupMs = 0.0;
+	double tileMs = 0.0;
+	unsigned int timedRenders = 0;
+
+	std::vector<std::pair<std::string, std::string>> viewResults;
+	bool allMatched = true;
+	for (unsigned int view = 0; view < settings.Views; view++)
+	{
+		SoftwareRenderer::Camera camera = {};
+		float rotation[3];
+		path.Evaluate(view * path.GetDuration() / settings.Views, camera.Position, rotation);
+		SoftwareRenderer::MakeView(camera.Position, rotation, camera.View);
+		SoftwareRenderer::MakeProjection(fieldOfView, (float)settings.Width / settings.Height, nearClip, farClip, camera.Projection);
+
+		renderer.Render(objects, lights, camera, jobSystem.get());
+		for (unsigned int r = 0; r < settings.Repeats; r++)
+		{
+			renderer.Render(objects, lights, camera, jobSystem.get());
+			const SoftwareRenderer::Stats& stats = renderer.GetStats();
+			frameTimes.AddFrame(stats.TotalMs);
+			vertexMs += stats.VertexMs;
+			setupMs += stats.SetupMs;
+			tileMs += stats.TileMs;
+			timedRenders++;
+		}
+
+		std::string name = "view" + std::to_string(view);
+		const SoftwareRenderer::Stats& stats = renderer.GetStats();
+		viewResults.push_back(std::make_pair(name + "_triangles_binned", std::to_string(stats.TrianglesBinned)));
+		viewResults.push_back(std::make_pair(name + "_pixels_shaded", std::to_string(stats.PixelsShaded)));
+
+		std::string imagePath = settings.OutputPrefix + "_" + std::to_string(view) + ".ppm";
+		if (!WritePpm(imagePath, renderer.GetPixels(), settings.Width * 4, settings.Width, settings.Height))
+			printf("Couldn't write %s\n", imagePath.c_str());
+
+		uint64_t hash = Benchmark::HashSeed;
+		hash = Benchmark::Hash(renderer.GetPixels(), (size_t)settings.Width * settings.Height * 4, hash);
+		char hashText[17];
+		snprintf(hashText, sizeof(hashText), "%016llx", (unsigned long long)hash);
+		viewResults.push_back(std::make_pair(name + "_hash", hashText));
+
+		if (!settings.GoldenPrefix.empty())
+		{
+			std::string goldenPath = settings.GoldenPrefix + "_" + std::to_string(view) + ".ppm";
+			float rms = 0.0f;
+			unsigned int maxDifference = 0;
+			bool compared = CompareToGolden(goldenPath, renderer.GetPixels(), &rms, &maxDifference);
+			bool matched = compared && rms <= settings.Tolerance;
+			allMatched = allMatched && matched;
+
+			if (compared)
+			{
+				viewResults.push_back(std::make_pair(name + "_rms", std::to_string(rms)));
+				viewResults.push_back(std::make_pair(name + "_max_difference", std::to_string(maxDifference)));
+				printf("%s: rms %.3f, max difference %u - %s\n", imagePath.c_str(), rms, maxDifference, matched ? "matches" : "DOESN'T MATCH");
+			}
+			else
+			{
+				printf("%s: couldn't compare against %s\n", imagePath.c_str(), goldenPath.c_str());
+			}
+			viewResults.push_back(std::make_pair(name + "_golden", matched ? "match" : "mismatch"));
+		}
+	}
+
+	FrameTimeStats::Summary summary = frameTimes.GetRecentSummary();
+	unsigned int threads = jobSystem ? jobSystem->GetWorkerCount() + 1 : 1;
+	double perRender = timedRenders > 0 ? 1.0 / timedRenders : 0.0;
+	printf("%ux%u, %u threads, %u triangles: %.2f ms mean, %.2f ms p50, %.2f ms p99\n",
+		settings.Width, settings.Height, threads, renderer.GetStats().Triangles, summary.Mean, summary.P50, summary.P99);
+
+	std::ofstream results(settings.ResultsFile);
+	if (results.is_open())
+	{
+		results << "name,value\n";
+		results << "width," << settings.Width << "\n";
+		results << "height," << settings.Height << "\n";
+		results << "threads," << threads << "\n";
+		results << "tile_size," << renderer.GetTileSize() << "\n";
+		results << "views," << settings.Views << "\n";
+		results << "repeats," << settings.Repeats << "\n";
+		results << "triangles," << renderer.GetStats().Triangles << "\n";
+		results << "mean_ms," << summary.Mean << "\n";
+		results << "p50_ms," << summary.P50 << "\n";
+		results << "p95_ms," << summary.P95 << "\n";
+		results << "p99_ms," << summary.P99 << "\n";
+		results << "max_ms," << summary.Max << "\n";
+		results << "vertex_ms," << vertexMs * perRender << "\n";
+		results << "setup_ms," << setupMs * perRender << "\n";
+		results << "tile_ms," << tileMs * perRender << "\n";
+		if (summary.Mean > 0.0f)
+			results << "megapixels_per_s," << (double)settings.Width * settings.Height / (summary.Mean * 1000.0) << "\n";
+		for (const std::pair<std::string, std::string>& result : viewResults)
+			results << result.first << "," << result.second << "\n";
+	}
+	else
+	{
+		printf("Couldn't write %s\n", settings.ResultsFile.c_str());
+	}
+
+	return allMatched ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "SoftwareRenderer.h"
+
+class JobSystem;
+
+// --------------------------------------------------------
+// Renders the game's demo scene with the SoftwareRenderer,
+// for build agents that have no GPU
+//
+// - The scene is built the way Game builds it: the same seven
+//   meshes, two materials, five lights, sky and camera
+// - Views are spread around the benchmark's default orbit, so
+//   they cover the same ground a GPU benchmark run does
+// - Each view is written as a PPM and, given golden images,
+//   compared against its golden one
+// - Each view is rendered a few times to time it, and the
+//   timings go in a name,value results file like the
+//   benchmark's
+// --------------------------------------------------------
+class SoftwareReference
+{
+public:
+	struct Settings
+	{
+		bool Enabled;
+		std::string AssetPath;			// The Assets folder - empty for the caller to fill in
+		unsigned int Width;
+		unsigned int Height;
+		unsigned int Views;
+		unsigned int Repeats;			// Timed renders of each view, after an untimed one
+		unsigned int Threads;			// Zero for one per core
+		unsigned int TileSize;
+		std::string OutputPrefix;		// Views are written to <prefix>_<view>.ppm
+		std::string GoldenPrefix;		// Compared against <prefix>_<view>.ppm - empty for no comparison
+		float Tolerance;				// Largest RMS difference (0-255) that still matches
+		std::string ResultsFile;
+		bool Sky;
+	};
+
+	// Defaults, for when the command line leaves something out
+	static Settings GetDefaultSettings();
+
+	// Reads settings from a command line like:
+	//   -software [-assets folder] [-width N] [-height N] [-views N]
+	//             [-repeats N] [-threads N] [-tile N] [-output prefix]
+	//             [-golden prefix] [-tolerance rms] [-results file] [-nosky]
+	// - Enabled is only set if -software is there
+	// - Returns false on anything it can't read
+	static bool ParseCommandLine(const char* commandLine, Settings* settings);
+
+	SoftwareReference(const Settings& settings);
+	~SoftwareReference();
+
+	// Loads the scene, then renders, saves, checks and times every view
+	// - Returns 0 if every view matched its golden image (or there
+	//   were none), 1 if any didn't, and 2 if the scene didn't load
+	int Run();
+
+private:
+	Settings settings;
+	std::unique_ptr<JobSystem> jobSystem;
+
+	std::vector<SoftwareRenderer::Object> objects;
+	std::vector<SoftwareRenderer::Light> lights;
+	std::shared_ptr<SoftwareRenderer::Texture> skyFaces[6];
+
+	bool LoadScene();
+
+	// RMS and largest per-channel difference against a golden image,
+	// or false if it couldn't be read or is the wrong size
+	bool CompareToGolden(const std::string& path, const unsigned char* pixels, float* rms, unsigned int* maxDifference);
+};
@@ -0,0 +1,44 @@
+// --------------------------------------------------------
+// Entry point for the software reference renderer on its
+// own, for machines with no Windows and no GPU
+//
+// - Windows builds run it from the game with "-software"
+//   instead, so this is empty there
+// - Everything it needs is portable C++14 plus SSE2, and
+//   CMakeLists.txt builds it as the SoftwareReference target,
+//   with a ctest comparing the demo scene against the golden
+//   images in Tests/Golden
+//
+// - Takes the same options as SoftwareReference.h lists
+//   ("-software" itself is optional here), with the Assets
+//   folder defaulting to ./Assets
+// --------------------------------------------------------
+#ifndef _WIN32
+
+#include <stdio.h>
+#include <string>
+#include "SoftwareReference.h"
+
+int main(int argc, char* argv[])
+{
+	std::string commandLine;
+	for (int i = 1; i < argc; i++)
+	{
+		commandLine += argv[i];
+		commandLine += " ";
+	}
+
+	SoftwareReference::Settings settings;
+	if (!SoftwareReference::ParseCommandLine(commandLine.c_str(), &settings))
+	{
+		printf("Couldn't read the command line - see SoftwareReference.h for the options\n");
+		return 2;
+	}
+	if (settings.AssetPath.empty())
+		settings.AssetPath = "Assets";
+
+	SoftwareReference reference(settings);
+	return reference.Run();
+}
+
+#endif
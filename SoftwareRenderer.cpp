@@ -0,0 +1,1288 @@
+#include "SoftwareRenderer.h"
+#include "CpuProfiler.h"
+#include "ImageReader.h"
+#include "JobSystem.h"
+
+#include <emmintrin.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <utility>
+
+// The game builds with SDL checks, which reject plain sscanf - with only
+// numbers to read, sscanf_s is the same thing, and is only Microsoft's
+#ifndef _WIN32
+#define sscanf_s sscanf
+#endif
+
+// Vertices are snapped to this many steps per pixel, as D3D11 does
+static const float SubPixelSteps = 256.0f;
+
+// Triangles are clipped to this many screens' width around the
+// screen (as well as the near and far planes), which keeps
+// pixel coordinates small enough for exact edge tests
+static const float GuardBand = 8.0f;
+
+// The anisotropy the game's sampler allows
+static const float MaxAnisotropy = 8.0f;
+
+// --------------------------------------------------------
+// out = a * b, for row-major 4x4 matrices
+// --------------------------------------------------------
+static void MultiplyMatrices(const float a[16], const float b[16], float out[16])
+{
+	for (int row = 0; row < 4; row++)
+	{
+		for (int col = 0; col < 4; col++)
+		{
+			out[row * 4 + col] =
+				a[row * 4 + 0] * b[0 * 4 + col] +
+				a[row * 4 + 1] * b[1 * 4 + col] +
+				a[row * 4 + 2] * b[2 * 4 + col] +
+				a[row * 4 + 3] * b[3 * 4 + col];
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Transforms a point (w = 1) by a row-major matrix
+// --------------------------------------------------------
+static void TransformPoint(const float p[3], const float m[16], float out[4])
+{
+	for (int col = 0; col < 4; col++)
+		out[col] = p[0] * m[col] + p[1] * m[4 + col] + p[2] * m[8 + col] + m[12 + col];
+}
+
+// --------------------------------------------------------
+// Transforms a direction by a row-major 3x3 matrix, stored
+// in the top left of a 4x4 one
+// --------------------------------------------------------
+static void TransformVector(const float v[3], const float m[16], float out[3])
+{
+	for (int col = 0; col < 3; col++)
+		out[col] = v[0] * m[col] + v[1] * m[4 + col] + v[2] * m[8 + col];
+}
+
+static float Dot(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static void Cross(const float a[3], const float b[3], float out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Like HLSL's normalize() - a zero vector gives NaNs
+static void Normalize(float v[3])
+{
+	float invLength = 1.0f / sqrtf(Dot(v, v));
+	v[0] *= invLength;
+	v[1] *= invLength;
+	v[2] *= invLength;
+}
+
+static float Saturate(float value)
+{
+	return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+// --------------------------------------------------------
+// Float to 8 bit UNORM the way D3D converts render target
+// output: clamped, rounded, and NaN becomes zero
+// --------------------------------------------------------
+static unsigned char ToUnorm(float value)
+{
+	if (!(value > 0.0f))
+		return 0;
+	if (value >= 1.0f)
+		return 255;
+	return (unsigned char)(value * 255.0f + 0.5f);
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Bilinear sample of one mip, wrapping at the edges
+// --------------------------------------------------------
+static void SampleBilinear(const SoftwareRenderer::Texture& texture, unsigned int mip, float u, float v, float out[4])
+{
+	int width = (int)texture.Widths[mip];
+	int height = (int)texture.Heights[mip];
+	const unsigned char* texels = texture.Mips[mip].data();
+
+	// Texel centers are at half texels
+	float x = (u - floorf(u)) * width - 0.5f;
+	float y = (v - floorf(v)) * height - 0.5f;
+	float x0f = floorf(x);
+	float y0f = floorf(y);
+	float fx = x - x0f;
+	float fy = y - y0f;
+
+	int x0 = (int)x0f;
+	int y0 = (int)y0f;
+	if (x0 < 0) x0 += width;
+	if (y0 < 0) y0 += height;
+	if (x0 >= width) x0 -= width;
+	if (y0 >= height) y0 -= height;
+	int x1 = x0 + 1 < width ? x0 + 1 : 0;
+	int y1 = y0 + 1 < height ? y0 + 1 : 0;
+
+	const unsigned char* t00 = texels + ((size_t)y0 * width + x0) * 4;
+	const unsigned char* t10 = texels + ((size_t)y0 * width + x1) * 4;
+	const unsigned char* t01 = texels + ((size_t)y1 * width + x0) * 4;
+	const unsigned char* t11 = texels + ((size_t)y1 * width + x1) * 4;
+	for (int c = 0; c < 4; c++)
+	{
+		float top = t00[c] + (t10[c] - t00[c]) * fx;
+		float bottom = t01[c] + (t11[c] - t01[c]) * fx;
+		out[c] = (top + (bottom - top) * fy) * (1.0f / 255.0f);
+	}
+}
+
+// --------------------------------------------------------
+// Anisotropic sample, given the UV's screen derivatives
+//
+// Up to MaxAnisotropy trilinear taps are spread along the
+// longer axis of the pixel's footprint, and the mip is
+// picked by the footprint's width across that axis - close
+// to what GPUs do, if not to the bit
+// --------------------------------------------------------
+static void SampleTexture(const SoftwareRenderer::Texture* texture, const float uv[2], const float ddx[2], const float ddy[2], float out[4])
+{
+	// Unbound textures sample as zero
+	if (!texture || texture->Mips.empty())
+	{
+		out[0] = out[1] = out[2] = out[3] = 0.0f;
+		return;
+	}
+
+	float width = (float)texture->Widths[0];
+	float height = (float)texture->Heights[0];
+	float lengthX = sqrtf(ddx[0] * width * ddx[0] * width + ddx[1] * height * ddx[1] * height);
+	float lengthY = sqrtf(ddy[0] * width * ddy[0] * width + ddy[1] * height * ddy[1] * height);
+	float major = fmaxf(lengthX, lengthY);
+	float minor = fminf(lengthX, lengthY);
+	const float* axis = lengthX >= lengthY ? ddx : ddy;
+
+	float taps = 1.0f;
+	if (major > 0.0f)
+		taps = minor > 0.0f ? fminf(ceilf(major / minor), MaxAnisotropy) : MaxAnisotropy;
+	int tapCount = (int)taps;
+
+	float lod = log2f(major / taps);
+	float maxLod = (float)(texture->Mips.size() - 1);
+	if (!(lod > 0.0f))
+		lod = 0.0f;
+	if (lod > maxLod)
+		lod = maxLod;
+	unsigned int mip = (unsigned int)lod;
+	float mipBlend = lod - mip;
+
+	out[0] = out[1] = out[2] = out[3] = 0.0f;
+	for (int t = 0; t < tapCount; t++)
+	{
+		float offset = (t + 0.5f) / tapCount - 0.5f;
+		float u = uv[0] + axis[0] * offset;
+		float v = uv[1] + axis[1] * offset;
+
+		float tap[4];
+		SampleBilinear(*texture, mip, u, v, tap);
+		if (mipBlend > 0.0f)
+		{
+			float next[4];
+			SampleBilinear(*texture, mip + 1, u, v, next);
+			for (int c = 0; c < 4; c++)
+				tap[c] += (next[c] - tap[c]) * mipBlend;
+		}
+		for (int c = 0; c < 4; c++)
+			out[c] += tap[c];
+	}
+	for (int c = 0; c < 4; c++)
+		out[c] /= tapCount;
+}
+
+// --------------------------------------------------------
+// The BRDF and lights from LightHeader.hlsli, and the
+// material helpers from TextureFunctions.hlsli, kept as close
+// to the HLSL as C++ allows (float3s are float[3]s)
+// --------------------------------------------------------
+static const float MinRoughness = 0.0000001f;
+static const float Pi = 3.14159265359f;
+static const float F0NonMetal = 0.04f;
+
+static float SpecDistribution(const float n[3], const float h[3], float roughness)
+{
+	float NdotH = Saturate(Dot(n, h));
+	float NdotHSq = NdotH * NdotH;
+	float a = roughness * roughness;
+	float a2 = fmaxf(a * a, MinRoughness);
+	float denomToSquare = NdotHSq * (a2 - 1) + 1;
+	return a2 / (Pi * denomToSquare * denomToSquare);
+}
+
+static void Fresnel(const float v[3], const float h[3], const float f0[3], float out[3])
+{
+	float VdotH = Saturate(Dot(v, h));
+	float power = powf(1 - VdotH, 5);
+	for (int c = 0; c < 3; c++)
+		out[c] = f0[c] + (1 - f0[c]) * power;
+}
+
+static float GeometricShadowing(const float n[3], const float v[3], float roughness)
+{
+	float k = powf(roughness + 1, 2) / 8.0f;
+	float NdotV = Saturate(Dot(n, v));
+	return NdotV / (NdotV * (1 - k) + k);
+}
+
+static void MicrofacetBRDF(const float n[3], const float l[3], const float v[3], float roughness, const float specColor[3], float out[3])
+{
+	float h[3] = { v[0] + l[0], v[1] + l[1], v[2] + l[2] };
+	Normalize(h);
+
+	float D = SpecDistribution(n, h, roughness);
+	float F[3];
+	Fresnel(v, h, specColor, F);
+	float G = GeometricShadowing(n, v, roughness) * GeometricShadowing(n, l, roughness);
+
+	// Same operator order as the HLSL, including where the max() ends up
+	float scale = fmaxf(Dot(n, v), Dot(n, l));
+	for (int c = 0; c < 3; c++)
+		out[c] = (D * F[c] * G) / 4 * scale;
+}
+
+// --------------------------------------------------------
+// One light's contribution, for any light type - the shared
+// tail of DirectionalLight(), PointLight() and SpotLight()
+// --------------------------------------------------------
+static void ShadeLight(
+	const SoftwareRenderer::Light& light,
+	const float normal[3],
+	float roughness,
+	float metalness,
+	const float specColor[3],
+	const float surfaceColor[4],
+	const float colorTint[4],
+	const float view[3],
+	const float worldPos[3],
+	float out[3])
+{
+	float toLight[3];
+	float scale = light.Intensity;
+	if (light.Type == SoftwareRenderer::LightTypeDirectional)
+	{
+		// NormDirToDirLight()
+		toLight[0] = -light.Direction[0];
+		toLight[1] = -light.Direction[1];
+		toLight[2] = -light.Direction[2];
+		Normalize(toLight);
+	}
+	else
+	{
+		// NormDirToPointLight() - which points from the light, as the HLSL does
+		float fromLight[3] =
+		{
+			worldPos[0] - light.Position[0],
+			worldPos[1] - light.Position[1],
+			worldPos[2] - light.Position[2]
+		};
+		toLight[0] = fromLight[0];
+		toLight[1] = fromLight[1];
+		toLight[2] = fromLight[2];
+		Normalize(toLight);
+
+		// Attenuate()
+		float dist = sqrtf(Dot(fromLight, fromLight));
+		float att = Saturate(1.0f - (dist * dist / (light.Range * light.Range)));
+		float attenuation = att * att;
+
+		float spotAmount = 1.0f;
+		if (light.Type == SoftwareRenderer::LightTypeSpot)
+		{
+			float direction[3] = { light.Direction[0], light.Direction[1], light.Direction[2] };
+			Normalize(direction);
+			float cosAngle = Saturate(Dot(toLight, direction));
+			spotAmount = powf(cosAngle, light.SpotFalloff);
+		}
+		scale = light.Intensity * attenuation * spotAmount;
+	}
+
+	float diff = Saturate(Dot(normal, toLight));
+	float spec[3];
+	MicrofacetBRDF(normal, toLight, view, roughness, specColor, spec);
+
+	for (int c = 0; c < 3; c++)
+	{
+		// DiffuseEnergyConserve()
+		float balancedDiff = diff * ((1 - Saturate(spec[c])) * (1 - metalness));
+		out[c] = (balancedDiff * (surfaceColor[c] * colorTint[c]) + spec[c]) * scale * light.Color[c];
+	}
+}
+
+// --------------------------------------------------------
+// Constructor - allocates the color buffer
+//
+// width, height - Image size, in pixels
+// tileSize      - Pixels on each side of a tile
+// --------------------------------------------------------
+SoftwareRenderer::SoftwareRenderer(unsigned int width, unsigned int height, unsigned int tileSize)
+	:
+	width(width < 1 ? 1 : width),
+	height(height < 1 ? 1 : height),
+	tileSize(tileSize < 4 ? 4 : (tileSize + 3) & ~3u),
+	objects(0),
+	lights(0),
+	camera(),
+	viewProjection(),
+	stats()
+{
+	tilesX = (this->width + this->tileSize - 1) / this->tileSize;
+	tilesY = (this->height + this->tileSize - 1) / this->tileSize;
+	pixels.resize((size_t)this->width * this->height * 4);
+
+	// The game's clear color
+	clearColor[0] = 0.4f;
+	clearColor[1] = 0.6f;
+	clearColor[2] = 0.75f;
+	clearColor[3] = 1.0f;
+}
+
+// --------------------------------------------------------
+// Loads an OBJ into vertices and indices
+//
+// The same parsing and fix-ups as Mesh's OBJ constructor, so
+// both renderers see identical triangles: Z and the normals'
+// Z are negated, V is flipped and the winding is reversed
+// --------------------------------------------------------
+bool SoftwareRenderer::LoadObj(const std::string& path, Mesh* mesh)
+{
+	CPU_PROFILE_SCOPE("SoftwareRenderer::LoadObj");
+
+	std::ifstream obj(path);
+	if (!obj.is_open())
+		return false;
+
+	std::vector<float> positions;
+	std::vector<float> normals;
+	std::vector<float> uvs;
+	mesh->Vertices.clear();
+	mesh->Indices.clear();
+
+	std::string line;
+	while (std::getline(obj, line))
+	{
+		const char* chars = line.c_str();
+		if (chars[0] == 'v' && chars[1] == 'n')
+		{
+			float n[3] = {};
+			sscanf_s(chars, "vn %f %f %f", &n[0], &n[1], &n[2]);
+			normals.insert(normals.end(), n, n + 3);
+		}
+		else if (chars[0] == 'v' && chars[1] == 't')
+		{
+			float uv[2] = {};
+			sscanf_s(chars, "vt %f %f", &uv[0], &uv[1]);
+			uvs.insert(uvs.end(), uv, uv + 2);
+		}
+		else if (chars[0] == 'v')
+		{
+			float p[3] = {};
+			sscanf_s(chars, "v %f %f %f", &p[0], &p[1], &p[2]);
+			positions.insert(positions.end(), p, p + 3);
+		}
+		else if (chars[0] == 'f')
+		{
+			unsigned int i[12] = {};
+			int numbersRead = sscanf_s(
+				chars,
+				"f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u",
+				&i[0], &i[1], &i[2],
+				&i[3], &i[4], &i[5],
+				&i[6], &i[7], &i[8],
+				&i[9], &i[10], &i[11]);
+
+			// No UVs - every vertex gets (0, 0)
+			if (numbersRead == 1)
+			{
+				numbersRead = sscanf_s(
+					chars,
+					"f %u//%u %u//%u %u//%u %u//%u",
+					&i[0], &i[2],
+					&i[3], &i[5],
+					&i[6], &i[8],
+					&i[9], &i[11]);
+				i[1] = i[4] = i[7] = i[10] = 1;
+				if (uvs.empty())
+					uvs.insert(uvs.end(), 2, 0.0f);
+			}
+
+			// Corners of the face, three or four of them
+			unsigned int corners = (numbersRead == 12 || numbersRead == 8) ? 4 : 3;
+			Vertex v[4];
+			for (unsigned int c = 0; c < corners; c++)
+			{
+				// OBJ indices start at one
+				unsigned int p = i[c * 3 + 0] - 1;
+				unsigned int t = i[c * 3 + 1] - 1;
+				unsigned int n = i[c * 3 + 2] - 1;
+				if (p >= positions.size() / 3 || t >= uvs.size() / 2 || n >= normals.size() / 3)
+					return false;
+
+				v[c].Position[0] = positions[p * 3 + 0];
+				v[c].Position[1] = positions[p * 3 + 1];
+				v[c].Position[2] = -positions[p * 3 + 2];
+				v[c].UV[0] = uvs[t * 2 + 0];
+				v[c].UV[1] = 1.0f - uvs[t * 2 + 1];
+				v[c].Normal[0] = normals[n * 3 + 0];
+				v[c].Normal[1] = normals[n * 3 + 1];
+				v[c].Normal[2] = -normals[n * 3 + 2];
+			}
+
+			// Reversed winding, as Mesh does it
+			const unsigned int order[6] = { 0, 2, 1, 0, 3, 2 };
+			for (unsigned int k = 0; k < (corners == 4 ? 6u : 3u); k++)
+			{
+				mesh->Indices.push_back((unsigned int)mesh->Vertices.size());
+				mesh->Vertices.push_back(v[order[k]]);
+			}
+		}
+	}
+
+	if (mesh->Vertices.empty())
+		return false;
+
+	// Tangents, the same way Mesh::CalculateTangents() does them
+	for (Vertex& vertex : mesh->Vertices)
+		vertex.Tangent[0] = vertex.Tangent[1] = vertex.Tangent[2] = 0.0f;
+
+	for (size_t i = 0; i + 2 < mesh->Indices.size(); i += 3)
+	{
+		Vertex* v1 = &mesh->Vertices[mesh->Indices[i + 0]];
+		Vertex* v2 = &mesh->Vertices[mesh->Indices[i + 1]];
+		Vertex* v3 = &mesh->Vertices[mesh->Indices[i + 2]];
+
+		float x1 = v2->Position[0] - v1->Position[0];
+		float y1 = v2->Position[1] - v1->Position[1];
+		float z1 = v2->Position[2] - v1->Position[2];
+		float x2 = v3->Position[0] - v1->Position[0];
+		float y2 = v3->Position[1] - v1->Position[1];
+		float z2 = v3->Position[2] - v1->Position[2];
+
+		float s1 = v2->UV[0] - v1->UV[0];
+		float t1 = v2->UV[1] - v1->UV[1];
+		float s2 = v3->UV[0] - v1->UV[0];
+		float t2 = v3->UV[1] - v1->UV[1];
+
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+		float tangent[3] =
+		{
+			(t2 * x1 - t1 * x2) * r,
+			(t2 * y1 - t1 * y2) * r,
+			(t2 * z1 - t1 * z2) * r
+		};
+		for (int c = 0; c < 3; c++)
+		{
+			v1->Tangent[c] += tangent[c];
+			v2->Tangent[c] += tangent[c];
+			v3->Tangent[c] += tangent[c];
+		}
+	}
+
+	// Gram-Schmidt against the normal - a zero result stays zero, as XMVector3Normalize() leaves it
+	for (Vertex& vertex : mesh->Vertices)
+	{
+		float d = Dot(vertex.Normal, vertex.Tangent);
+		float t[3] =
+		{
+			vertex.Tangent[0] - vertex.Normal[0] * d,
+			vertex.Tangent[1] - vertex.Normal[1] * d,
+			vertex.Tangent[2] - vertex.Normal[2] * d
+		};
+		float length = sqrtf(Dot(t, t));
+		for (int c = 0; c < 3; c++)
+			vertex.Tangent[c] = length > 0.0f ? t[c] / length : 0.0f;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Loads a PNG and box filters it down to a single texel
+// --------------------------------------------------------
+bool SoftwareRenderer::LoadTexture(const std::string& path, Texture* texture)
+{
+	CPU_PROFILE_SCOPE("SoftwareRenderer::LoadTexture");
+
+	std::vector<unsigned char> top;
+	unsigned int width = 0;
+	unsigned int height = 0;
+	if (!ReadPng(path, &top, &width, &height))
+		return false;
+
+	texture->Widths.assign(1, width);
+	texture->Heights.assign(1, height);
+	texture->Mips.clear();
+	texture->Mips.push_back(std::move(top));
+
+	while (width > 1 || height > 1)
+	{
+		const std::vector<unsigned char>& source = texture->Mips.back();
+		unsigned int sourceWidth = width;
+		unsigned int sourceHeight = height;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+
+		std::vector<unsigned char> mip((size_t)width * height * 4);
+		for (unsigned int y = 0; y < height; y++)
+		{
+			unsigned int y0 = y * 2 < sourceHeight ? y * 2 : sourceHeight - 1;
+			unsigned int y1 = y * 2 + 1 < sourceHeight ? y * 2 + 1 : y0;
+			for (unsigned int x = 0; x < width; x++)
+			{
+				unsigned int x0 = x * 2 < sourceWidth ? x * 2 : sourceWidth - 1;
+				unsigned int x1 = x * 2 + 1 < sourceWidth ? x * 2 + 1 : x0;
+				for (int c = 0; c < 4; c++)
+				{
+					unsigned int sum =
+						source[((size_t)y0 * sourceWidth + x0) * 4 + c] +
+						source[((size_t)y0 * sourceWidth + x1) * 4 + c] +
+						source[((size_t)y1 * sourceWidth + x0) * 4 + c] +
+						source[((size_t)y1 * sourceWidth + x1) * 4 + c];
+					mip[((size_t)y * width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+
+		texture->Widths.push_back(width);
+		texture->Heights.push_back(height);
+		texture->Mips.push_back(std::move(mip));
+	}
+	return true;
+}
+
+void SoftwareRenderer::SetSky(const std::shared_ptr<Texture> faces[6])
+{
+	for (int i = 0; i < 6; i++)
+		sky[i] = faces ? faces[i] : 0;
+}
+
+void SoftwareRenderer::SetClearColor(const float color[4])
+{
+	memcpy(clearColor, color, sizeof(clearColor));
+}
+
+// --------------------------------------------------------
+// Builds the view matrix Camera does, from the pose Camera
+// and CameraPath use
+//
+// Forward is +Z rotated by roll, then pitch, then yaw (as
+// XMQuaternionRotationRollPitchYaw() orders them), which
+// leaves roll out of it entirely
+// --------------------------------------------------------
+void SoftwareRenderer::MakeView(const float position[3], const float pitchYawRoll[3], float view[16])
+{
+	float pitch = pitchYawRoll[0];
+	float yaw = pitchYawRoll[1];
+	float zAxis[3] = { cosf(pitch) * sinf(yaw), -sinf(pitch), cosf(pitch) * cosf(yaw) };
+	Normalize(zAxis);
+
+	// XMMatrixLookToLH()
+	float up[3] = { 0.0f, 1.0f, 0.0f };
+	float xAxis[3];
+	Cross(up, zAxis, xAxis);
+	Normalize(xAxis);
+	float yAxis[3];
+	Cross(zAxis, xAxis, yAxis);
+
+	for (int row = 0; row < 3; row++)
+	{
+		view[row * 4 + 0] = xAxis[row];
+		view[row * 4 + 1] = yAxis[row];
+		view[row * 4 + 2] = zAxis[row];
+		view[row * 4 + 3] = 0.0f;
+	}
+	view[12] = -Dot(xAxis, position);
+	view[13] = -Dot(yAxis, position);
+	view[14] = -Dot(zAxis, position);
+	view[15] = 1.0f;
+}
+
+// --------------------------------------------------------
+// XMMatrixPerspectiveFovLH()
+// --------------------------------------------------------
+void SoftwareRenderer::MakeProjection(float fieldOfView, float aspectRatio, float nearClip, float farClip, float projection[16])
+{
+	float yScale = 1.0f / tanf(fieldOfView * 0.5f);
+	float xScale = yScale / aspectRatio;
+	float range = farClip / (farClip - nearClip);
+
+	memset(projection, 0, sizeof(float) * 16);
+	projection[0] = xScale;
+	projection[5] = yScale;
+	projection[10] = range;
+	projection[11] = 1.0f;
+	projection[14] = -range * nearClip;
+}
+
+// --------------------------------------------------------
+// Draws a frame: vertices per object, then triangle setup
+// and binning per chunk, then raster and shading per tile,
+// each stage spread across the job system
+// --------------------------------------------------------
+void SoftwareRenderer::Render(
+	const std::vector<Object>& objects,
+	const std::vector<Light>& lights,
+	const Camera& camera,
+	JobSystem* jobSystem)
+{
+	CPU_PROFILE_SCOPE("SoftwareRenderer::Render");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	this->objects = &objects;
+	this->lights = &lights;
+	this->camera = camera;
+	MultiplyMatrices(camera.View, camera.Projection, viewProjection);
+	stats = Stats();
+
+	// Runs a range of work on the job system, or right here without one
+	auto parallelFor = [jobSystem](unsigned int count, JobSystem::RangeFunction body)
+		{
+			if (jobSystem)
+				jobSystem->ParallelFor(0, count, 1, body);
+			else
+				body(0, count);
+		};
+
+	// Vertices
+	std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
+	{
+		CPU_PROFILE_SCOPE("Software vertices");
+		shadedVertices.resize(objects.size());
+		parallelFor((unsigned int)objects.size(),
+			[&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int o = begin; o < end; o++)
+					ShadeVertices(o);
+			});
+	}
+	stats.VertexMs = MillisecondsSince(stageStart);
+
+	// Triangle setup and binning, a chunk of each object's triangles at a time
+	stageStart = std::chrono::steady_clock::now();
+	{
+		CPU_PROFILE_SCOPE("Software setup");
+		unsigned int chunkCount = 0;
+		for (unsigned int o = 0; o < objects.size(); o++)
+		{
+			if (!objects[o].Mesh || !objects[o].Material)
+				continue;
+			unsigned int indexCount = (unsigned int)objects[o].Mesh->Indices.size() / 3 * 3;
+			stats.Triangles += indexCount / 3;
+			for (unsigned int first = 0; first < indexCount; first += ChunkSize * 3)
+			{
+				if (chunks.size() <= chunkCount)
+					chunks.resize(chunkCount + 1);
+				Chunk& chunk = chunks[chunkCount++];
+				chunk.Object = o;
+				chunk.FirstIndex = first;
+				chunk.IndexCount = std::min(ChunkSize * 3, indexCount - first);
+			}
+		}
+		chunks.resize(chunkCount);
+
+		parallelFor(chunkCount,
+			[&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int c = begin; c < end; c++)
+					SetupChunk(chunks[c]);
+			});
+
+		for (const Chunk& chunk : chunks)
+		{
+			stats.TrianglesBinned += (unsigned int)chunk.Triangles.size();
+			for (const std::vector<unsigned int>& bin : chunk.Bins)
+				stats.TileTriangles += (unsigned int)bin.size();
+		}
+	}
+	stats.SetupMs = MillisecondsSince(stageStart);
+
+	// Tiles
+	stageStart = std::chrono::steady_clock::now();
+	{
+		CPU_PROFILE_SCOPE("Software tiles");
+		unsigned int tileCount = tilesX * tilesY;
+		std::vector<unsigned int> shaded(tileCount, 0);
+		parallelFor(tileCount,
+			[&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int t = begin; t < end; t++)
+					shaded[t] = RenderTile(t);
+			});
+		for (unsigned int count : shaded)
+			stats.PixelsShaded += count;
+	}
+	stats.TileMs = MillisecondsSince(stageStart);
+	stats.TotalMs = MillisecondsSince(start);
+}
+
+// --------------------------------------------------------
+// VertexShader.hlsl for one object's vertices
+// --------------------------------------------------------
+void SoftwareRenderer::ShadeVertices(unsigned int object)
+{
+	const Object& o = (*objects)[object];
+	std::vector<ShadedVertex>& shaded = shadedVertices[object];
+	if (!o.Mesh)
+	{
+		shaded.clear();
+		return;
+	}
+
+	float worldViewProjection[16];
+	MultiplyMatrices(o.World, viewProjection, worldViewProjection);
+
+	// Normals go through the inverse transpose of the world matrix,
+	// which is the 3x3's cofactor matrix over its determinant
+	const float* w = o.World;
+	float normalMatrix[16] = {};
+	normalMatrix[0] = w[5] * w[10] - w[6] * w[9];
+	normalMatrix[1] = w[6] * w[8] - w[4] * w[10];
+	normalMatrix[2] = w[4] * w[9] - w[5] * w[8];
+	normalMatrix[4] = w[2] * w[9] - w[1] * w[10];
+	normalMatrix[5] = w[0] * w[10] - w[2] * w[8];
+	normalMatrix[6] = w[1] * w[8] - w[0] * w[9];
+	normalMatrix[8] = w[1] * w[6] - w[2] * w[5];
+	normalMatrix[9] = w[2] * w[4] - w[0] * w[6];
+	normalMatrix[10] = w[0] * w[5] - w[1] * w[4];
+	float determinant = w[0] * normalMatrix[0] + w[1] * normalMatrix[1] + w[2] * normalMatrix[2];
+	float invDeterminant = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+	for (int i = 0; i < 11; i++)
+		normalMatrix[i] *= invDeterminant;
+
+	const std::vector<Vertex>& vertices = o.Mesh->Vertices;
+	shaded.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		const Vertex& in = vertices[i];
+		ShadedVertex& out = shaded[i];
+		TransformPoint(in.Position, worldViewProjection, out.Clip);
+		float world[4];
+		TransformPoint(in.Position, o.World, world);
+		memcpy(out.World, world, sizeof(out.World));
+		TransformVector(in.Normal, normalMatrix, out.Normal);
+		TransformVector(in.Tangent, o.World, out.Tangent);
+		out.UV[0] = in.UV[0];
+		out.UV[1] = in.UV[1];
+	}
+}
+
+// --------------------------------------------------------
+// Clips, culls and bins one chunk's triangles
+// --------------------------------------------------------
+void SoftwareRenderer::SetupChunk(Chunk& chunk)
+{
+	chunk.Triangles.clear();
+	chunk.Bins.resize(tilesX * tilesY);
+	for (std::vector<unsigned int>& bin : chunk.Bins)
+		bin.clear();
+
+	const Object& object = (*objects)[chunk.Object];
+	const std::vector<ShadedVertex>& vertices = shadedVertices[chunk.Object];
+	const std::vector<unsigned int>& indices = object.Mesh->Indices;
+	const Material* material = object.Material.get();
+
+	for (unsigned int i = chunk.FirstIndex; i < chunk.FirstIndex + chunk.IndexCount; i += 3)
+	{
+		if (indices[i] >= vertices.size() || indices[i + 1] >= vertices.size() || indices[i + 2] >= vertices.size())
+			continue;
+		const ShadedVertex* corners[3] = { &vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]] };
+
+		// Distance inside each clip plane: near, far, then the guard band's sides
+		float distances[3][6];
+		unsigned int outside[3] = {};
+		for (int v = 0; v < 3; v++)
+		{
+			const float* clip = corners[v]->Clip;
+			distances[v][0] = clip[2];
+			distances[v][1] = clip[3] - clip[2];
+			distances[v][2] = GuardBand * clip[3] + clip[0];
+			distances[v][3] = GuardBand * clip[3] - clip[0];
+			distances[v][4] = GuardBand * clip[3] + clip[1];
+			distances[v][5] = GuardBand * clip[3] - clip[1];
+			for (int p = 0; p < 6; p++)
+			{
+				if (distances[v][p] < 0.0f)
+					outside[v] |= 1u << p;
+			}
+		}
+
+		// Entirely outside one plane, or entirely inside all of them
+		if (outside[0] & outside[1] & outside[2])
+			continue;
+		if ((outside[0] | outside[1] | outside[2]) == 0)
+		{
+			AddTriangle(chunk, corners, material);
+			continue;
+		}
+
+		// Clip the polygon against each plane it crosses (up to nine corners)
+		ShadedVertex polygon[2][9];
+		unsigned int count = 3;
+		for (int v = 0; v < 3; v++)
+			polygon[0][v] = *corners[v];
+		int current = 0;
+		for (int p = 0; p < 6 && count >= 3; p++)
+		{
+			if (((outside[0] | outside[1] | outside[2]) & (1u << p)) == 0)
+				continue;
+
+			const ShadedVertex* in = polygon[current];
+			ShadedVertex* out = polygon[1 - current];
+			unsigned int outCount = 0;
+			for (unsigned int v = 0; v < count; v++)
+			{
+				const ShadedVertex& a = in[v];
+				const ShadedVertex& b = in[(v + 1) % count];
+
+				// Plane distances are linear in clip space, so they can be recomputed
+				auto distance = [p](const ShadedVertex& vertex)
+					{
+						const float* clip = vertex.Clip;
+						switch (p)
+						{
+						case 0: return clip[2];
+						case 1: return clip[3] - clip[2];
+						case 2: return GuardBand * clip[3] + clip[0];
+						case 3: return GuardBand * clip[3] - clip[0];
+						case 4: return GuardBand * clip[3] + clip[1];
+						default: return GuardBand * clip[3] - clip[1];
+						}
+					};
+				float da = distance(a);
+				float db = distance(b);
+				if (da >= 0.0f)
+					out[outCount++] = a;
+				if ((da >= 0.0f) != (db >= 0.0f))
+				{
+					// Every attribute lerps the same way
+					float t = da / (da - db);
+					const float* fa = (const float*)&a;
+					const float* fb = (const float*)&b;
+					float* fo = (float*)&out[outCount++];
+					for (size_t f = 0; f < sizeof(ShadedVertex) / sizeof(float); f++)
+						fo[f] = fa[f] + (fb[f] - fa[f]) * t;
+				}
+			}
+			count = outCount;
+			current = 1 - current;
+		}
+
+		// A fan of triangles from the first corner
+		for (unsigned int v = 1; v + 1 < count; v++)
+		{
+			const ShadedVertex* fan[3] = { &polygon[current][0], &polygon[current][v], &polygon[current][v + 1] };
+			AddTriangle(chunk, fan, material);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Projects a (clipped) triangle to pixels and, if it faces
+// the camera and lands on screen, bins it
+// --------------------------------------------------------
+void SoftwareRenderer::AddTriangle(Chunk& chunk, const ShadedVertex* vertices[3], const Material* material)
+{
+	Triangle triangle;
+	for (int v = 0; v < 3; v++)
+	{
+		const float* clip = vertices[v]->Clip;
+		float invW = 1.0f / clip[3];
+
+		// NDC to pixels, with y going down, snapped to the sub-pixel grid
+		float x = (clip[0] * invW * 0.5f + 0.5f) * width;
+		float y = (clip[1] * invW * -0.5f + 0.5f) * height;
+		triangle.X[v] = floorf(x * SubPixelSteps + 0.5f) / SubPixelSteps;
+		triangle.Y[v] = floorf(y * SubPixelSteps + 0.5f) / SubPixelSteps;
+		triangle.Z[v] = clip[2] * invW;
+		triangle.InvW[v] = invW;
+		triangle.Vertices[v] = *vertices[v];
+	}
+
+	// Front faces wind clockwise on screen, which is positive here
+	float area =
+		(triangle.X[1] - triangle.X[0]) * (triangle.Y[2] - triangle.Y[0]) -
+		(triangle.X[2] - triangle.X[0]) * (triangle.Y[1] - triangle.Y[0]);
+	if (!(area > 0.0f))
+		return;
+
+	// Pixel bounds, by the pixel centers the triangle could cover
+	float minX = fminf(triangle.X[0], fminf(triangle.X[1], triangle.X[2]));
+	float maxX = fmaxf(triangle.X[0], fmaxf(triangle.X[1], triangle.X[2]));
+	float minY = fminf(triangle.Y[0], fminf(triangle.Y[1], triangle.Y[2]));
+	float maxY = fmaxf(triangle.Y[0], fmaxf(triangle.Y[1], triangle.Y[2]));
+	if (maxX < 0.0f || maxY < 0.0f || minX >= (float)width || minY >= (float)height)
+		return;
+
+	triangle.MinX = (int)fmaxf(ceilf(minX - 0.5f), 0.0f);
+	triangle.MinY = (int)fmaxf(ceilf(minY - 0.5f), 0.0f);
+	triangle.MaxX = (int)fminf(floorf(maxX - 0.5f), width - 1.0f);
+	triangle.MaxY = (int)fminf(floorf(maxY - 0.5f), height - 1.0f);
+	if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+		return;
+
+	triangle.Material = material;
+	unsigned int index = (unsigned int)chunk.Triangles.size();
+	chunk.Triangles.push_back(triangle);
+
+	for (unsigned int ty = triangle.MinY / tileSize; ty <= triangle.MaxY / tileSize; ty++)
+	{
+		for (unsigned int tx = triangle.MinX / tileSize; tx <= triangle.MaxX / tileSize; tx++)
+			chunk.Bins[ty * tilesX + tx].push_back(index);
+	}
+}
+
+// --------------------------------------------------------
+// Rasterizes every triangle binned to a tile into its depth
+// and visibility buffers, then shades each covered pixel
+// once (and the sky behind the rest)
+//
+// Edge functions and depth are evaluated for four pixels at
+// once.  Returns the number of pixels shaded.
+// --------------------------------------------------------
+unsigned int SoftwareRenderer::RenderTile(unsigned int tile)
+{
+	int tileX = (int)((tile % tilesX) * tileSize);
+	int tileY = (int)((tile / tilesX) * tileSize);
+	int tileEndX = std::min(tileX + (int)tileSize, (int)width);
+	int tileEndY = std::min(tileY + (int)tileSize, (int)height);
+
+	std::vector<float> depth(tileSize * tileSize, 1.0f);
+	std::vector<const Triangle*> visible(tileSize * tileSize, (const Triangle*)0);
+
+	const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 columnLimit = _mm_set1_ps((float)tileEndX);
+
+	// Chunks in order, each chunk's triangles in order, so the
+	// nearest of two equal depths is always the same one
+	for (const Chunk& chunk : chunks)
+	{
+		for (unsigned int index : chunk.Bins[tile])
+		{
+			const Triangle& triangle = chunk.Triangles[index];
+
+			int rowStart = std::max(triangle.MinY, tileY);
+			int rowEnd = std::min(triangle.MaxY, tileEndY - 1);
+			int columnStart = tileX + ((std::max(triangle.MinX, tileX) - tileX) & ~3);
+			int columnEnd = std::min(triangle.MaxX, tileEndX - 1);
+
+			// Edge (a -> b) is (xb - xa) * (py - ya) - (yb - ya) * (px - xa),
+			// positive inside a clockwise triangle.  Pixels exactly on an edge
+			// are only in if it's a top or left edge.
+			const float* x = triangle.X;
+			const float* y = triangle.Y;
+			__m128 edgeDX[3];
+			float edgeDY[3];
+			float edgeX[3];
+			float edgeY[3];
+			bool topLeft[3];
+			for (int e = 0; e < 3; e++)
+			{
+				int a = (e + 1) % 3;
+				int b = (e + 2) % 3;
+				edgeDX[e] = _mm_set1_ps(-(y[b] - y[a]));
+				edgeDY[e] = x[b] - x[a];
+				edgeX[e] = x[a];
+				edgeY[e] = y[a];
+				topLeft[e] = (y[b] < y[a]) || (y[b] == y[a] && x[b] > x[a]);
+			}
+
+			// Depth as a plane over the screen, from the barycentric weights
+			float area =
+				(x[1] - x[0]) * (y[2] - y[0]) -
+				(x[2] - x[0]) * (y[1] - y[0]);
+			float invArea = 1.0f / area;
+			float zDX = 0.0f, zDY = 0.0f;
+			for (int e = 0; e < 3; e++)
+			{
+				int a = (e + 1) % 3;
+				int b = (e + 2) % 3;
+				zDX += -(y[b] - y[a]) * triangle.Z[e];
+				zDY += (x[b] - x[a]) * triangle.Z[e];
+			}
+			zDX *= invArea;
+			zDY *= invArea;
+			float zC = triangle.Z[0] - zDX * x[0] - zDY * y[0];
+
+			for (int row = rowStart; row <= rowEnd; row++)
+			{
+				float py = row + 0.5f;
+				float rowTerms[3];
+				for (int e = 0; e < 3; e++)
+					rowTerms[e] = edgeDY[e] * (py - edgeY[e]);
+
+				float* depthRow = &depth[(row - tileY) * tileSize];
+				const Triangle** visibleRow = &visible[(row - tileY) * tileSize];
+				for (int column = columnStart; column <= columnEnd; column += 4)
+				{
+					__m128 px = _mm_add_ps(_mm_set1_ps((float)column), pixelOffsets);
+
+					__m128 inside = _mm_cmplt_ps(px, columnLimit);
+					for (int e = 0; e < 3; e++)
+					{
+						__m128 edge = _mm_add_ps(
+							_mm_mul_ps(edgeDX[e], _mm_sub_ps(px, _mm_set1_ps(edgeX[e]))),
+							_mm_set1_ps(rowTerms[e]));
+						inside = _mm_and_ps(inside, topLeft[e] ? _mm_cmpge_ps(edge, zero) : _mm_cmpgt_ps(edge, zero));
+					}
+					if (_mm_movemask_ps(inside) == 0)
+						continue;
+
+					int local = column - tileX;
+					__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zDX), px), _mm_set1_ps(zDY * py + zC));
+					__m128 current = _mm_loadu_ps(depthRow + local);
+					__m128 passed = _mm_and_ps(inside, _mm_cmplt_ps(z, current));
+					int mask = _mm_movemask_ps(passed);
+					if (mask == 0)
+						continue;
+
+					_mm_storeu_ps(depthRow + local, _mm_or_ps(_mm_and_ps(passed, z), _mm_andnot_ps(passed, current)));
+					for (int lane = 0; lane < 4; lane++)
+					{
+						if (mask & (1 << lane))
+							visibleRow[local + lane] = &triangle;
+					}
+				}
+			}
+		}
+	}
+
+	// Shade what ended up on top
+	unsigned int shadedCount = 0;
+	for (int row = tileY; row < tileEndY; row++)
+	{
+		unsigned char* out = &pixels[((size_t)row * width + tileX) * 4];
+		const Triangle** visibleRow = &visible[(row - tileY) * tileSize];
+		for (int column = tileX; column < tileEndX; column++, out += 4)
+		{
+			const Triangle* triangle = visibleRow[column - tileX];
+			if (triangle)
+			{
+				ShadePixel(*triangle, column + 0.5f, row + 0.5f, out);
+				shadedCount++;
+			}
+			else
+			{
+				ShadeSky(column + 0.5f, row + 0.5f, out);
+			}
+		}
+	}
+	return shadedCount;
+}
+
+// --------------------------------------------------------
+// PixelShader.hlsl for one pixel of a triangle
+//
+// Attributes are interpolated with perspective correct
+// barycentrics.  The UVs' screen derivatives come from the
+// same interpolation one pixel right and one pixel down,
+// where the GPU would difference a 2x2 quad.
+// --------------------------------------------------------
+void SoftwareRenderer::ShadePixel(const Triangle& triangle, float px, float py, unsigned char out[4])
+{
+	const float* x = triangle.X;
+	const float* y = triangle.Y;
+	float invArea = 1.0f / (
+		(x[1] - x[0]) * (y[2] - y[0]) -
+		(x[2] - x[0]) * (y[1] - y[0]));
+
+	auto barycentrics = [&](float sx, float sy, float weights[3])
+		{
+			float sum = 0.0f;
+			for (int e = 0; e < 3; e++)
+			{
+				int a = (e + 1) % 3;
+				int b = (e + 2) % 3;
+				float edge = (x[b] - x[a]) * (sy - y[a]) - (y[b] - y[a]) * (sx - x[a]);
+				weights[e] = edge * invArea * triangle.InvW[e];
+				sum += weights[e];
+			}
+			for (int e = 0; e < 3; e++)
+				weights[e] /= sum;
+		};
+	auto interpolate = [&](const float weights[3], size_t offset, int count, float* result)
+		{
+			for (int c = 0; c < count; c++)
+			{
+				result[c] = 0.0f;
+				for (int v = 0; v < 3; v++)
+					result[c] += weights[v] * ((const float*)&triangle.Vertices[v])[offset / sizeof(float) + c];
+			}
+		};
+
+	float weights[3];
+	float weightsRight[3];
+	float weightsDown[3];
+	barycentrics(px, py, weights);
+	barycentrics(px + 1.0f, py, weightsRight);
+	barycentrics(px, py + 1.0f, weightsDown);
+
+	float uv[2], uvRight[2], uvDown[2];
+	float inputNormal[3], inputTangent[3], worldPosition[3];
+	interpolate(weights, offsetof(ShadedVertex, UV), 2, uv);
+	interpolate(weightsRight, offsetof(ShadedVertex, UV), 2, uvRight);
+	interpolate(weightsDown, offsetof(ShadedVertex, UV), 2, uvDown);
+	interpolate(weights, offsetof(ShadedVertex, Normal), 3, inputNormal);
+	interpolate(weights, offsetof(ShadedVertex, Tangent), 3, inputTangent);
+	interpolate(weights, offsetof(ShadedVertex, World), 3, worldPosition);
+	float ddx[2] = { uvRight[0] - uv[0], uvRight[1] - uv[1] };
+	float ddy[2] = { uvDown[0] - uv[0], uvDown[1] - uv[1] };
+
+	const Material& material = *triangle.Material;
+
+	// SampleAlbedo()
+	float albedo[4];
+	SampleTexture(material.Albedo.get(), uv, ddx, ddy, albedo);
+	float surfaceColor[4] = { powf(albedo[0], 2.2f), powf(albedo[1], 2.2f), powf(albedo[2], 2.2f), 1.0f };
+
+	// SampleNormal() and GetTBN()
+	float normalSample[4];
+	SampleTexture(material.Normal.get(), uv, ddx, ddy, normalSample);
+	float N[3] = { inputNormal[0], inputNormal[1], inputNormal[2] };
+	Normalize(N);
+	float T[3] = { inputTangent[0], inputTangent[1], inputTangent[2] };
+	Normalize(T);
+	float TdotN = Dot(T, N);
+	for (int c = 0; c < 3; c++)
+		T[c] -= N[c] * TdotN;
+	Normalize(T);
+	float B[3];
+	Cross(T, N, B);
+	float normal[3];
+	for (int c = 0; c < 3; c++)
+	{
+		normal[c] =
+			(normalSample[0] * 2 - 1) * T[c] +
+			(normalSample[1] * 2 - 1) * B[c] +
+			(normalSample[2] * 2 - 1) * N[c];
+	}
+
+	// SampleMetalnessRoughness()
+	float roughnessSample[4];
+	float metalnessSample[4];
+	SampleTexture(material.Roughness.get(), uv, ddx, ddy, roughnessSample);
+	SampleTexture(material.Metalness.get(), uv, ddx, ddy, metalnessSample);
+	float roughness = roughnessSample[0];
+	float metalness = metalnessSample[0];
+
+	float view[3] =
+	{
+		camera.Position[0] - worldPosition[0],
+		camera.Position[1] - worldPosition[1],
+		camera.Position[2] - worldPosition[2]
+	};
+	Normalize(view);
+
+	// GetSpecularColor()
+	float specColor[3];
+	for (int c = 0; c < 3; c++)
+		specColor[c] = F0NonMetal + (surfaceColor[c] - F0NonMetal) * metalness;
+
+	// Directional lights first, then the rest, as the shader adds them up
+	float returnedLight[3] = {};
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (const Light& light : *lights)
+		{
+			if ((light.Type == LightTypeDirectional) != (pass == 0))
+				continue;
+			float lightAmount[3];
+			ShadeLight(light, normal, roughness, metalness, specColor, surfaceColor, material.ColorTint, view, worldPosition, lightAmount);
+			for (int c = 0; c < 3; c++)
+				returnedLight[c] += lightAmount[c];
+		}
+	}
+
+	for (int c = 0; c < 3; c++)
+		out[c] = ToUnorm(powf(returnedLight[c], 1.0f / 2.2f));
+	out[3] = 255;
+}
+
+// --------------------------------------------------------
+// SkyPixelShader.hlsl for a pixel nothing covered - the
+// direction through the pixel picks a cube face and texel
+// the way D3D addresses cube maps (at the top mip)
+// --------------------------------------------------------
+void SoftwareRenderer::ShadeSky(float px, float py, unsigned char out[4])
+{
+	// The view space direction through the pixel, rotated to world space
+	float ndcX = px / width * 2.0f - 1.0f;
+	float ndcY = 1.0f - py / height * 2.0f;
+	float viewDirection[3] = { ndcX / camera.Projection[0], ndcY / camera.Projection[5], 1.0f };
+	float d[3];
+	for (int c = 0; c < 3; c++)
+	{
+		d[c] =
+			viewDirection[0] * camera.View[c * 4 + 0] +
+			viewDirection[1] * camera.View[c * 4 + 1] +
+			viewDirection[2] * camera.View[c * 4 + 2];
+	}
+
+	float ax = fabsf(d[0]);
+	float ay = fabsf(d[1]);
+	float az = fabsf(d[2]);
+	int face;
+	float sc, tc, ma;
+	if (ax >= ay && ax >= az)
+	{
+		face = d[0] >= 0.0f ? 0 : 1;
+		sc = d[0] >= 0.0f ? -d[2] : d[2];
+		tc = -d[1];
+		ma = ax;
+	}
+	else if (ay >= az)
+	{
+		face = d[1] >= 0.0f ? 2 : 3;
+		sc = d[0];
+		tc = d[1] >= 0.0f ? d[2] : -d[2];
+		ma = ay;
+	}
+	else
+	{
+		face = d[2] >= 0.0f ? 4 : 5;
+		sc = d[2] >= 0.0f ? d[0] : -d[0];
+		tc = -d[1];
+		ma = az;
+	}
+
+	const Texture* texture = sky[face].get();
+	if (!texture || texture->Mips.empty())
+	{
+		for (int c = 0; c < 4; c++)
+			out[c] = ToUnorm(clearColor[c]);
+		return;
+	}
+
+	// Clamped to the face, rather than wrapping onto the far side of it
+	float u = (sc / ma + 1.0f) * 0.5f;
+	float v = (tc / ma + 1.0f) * 0.5f;
+	float halfTexelU = 0.5f / texture->Widths[0];
+	float halfTexelV = 0.5f / texture->Heights[0];
+	u = fminf(fmaxf(u, halfTexelU), 1.0f - halfTexelU);
+	v = fminf(fmaxf(v, halfTexelV), 1.0f - halfTexelV);
+
+	float color[4];
+	SampleBilinear(*texture, 0, u, v, color);
+	for (int c = 0; c < 3; c++)
+		out[c] = ToUnorm(color[c]);
+	out[3] = 255;
+}
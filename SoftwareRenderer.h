@@ -0,0 +1,211 @@
+#pragma once
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// --------------------------------------------------------
+// A reference renderer that runs entirely on the CPU
+//
+// - Draws the same things the GPU path does - meshes from the
+//   same OBJ files, the same four texture material, the same
+//   lights and sky - with the shading from PixelShader.hlsl
+//   (LightHeader.hlsli and TextureFunctions.hlsli) ported line
+//   for line, so build agents without a GPU can check it
+// - Triangles are set up and binned into screen tiles in
+//   chunks, then each tile is rasterized (SSE, four pixels at
+//   a time, with a depth test) and shaded by one job, so every
+//   pixel is written by exactly one thread and the image is
+//   the same for any number of threads
+// - Tiles rasterize into a visibility buffer first, so each
+//   pixel is shaded once no matter how much overdraw there is
+// - Follows D3D11's rules where they change the image: clip
+//   space z from 0 to w, clockwise front faces with back
+//   faces culled, 8 bits of sub-pixel precision, the top-left
+//   fill rule, a less-than depth test and wrapped, filtered,
+//   mipmapped textures (a texture that's missing samples as
+//   zero, like an unbound shader resource)
+// - Not included: shadows (every light is unshadowed) and the
+//   clustered light lists, which only skip lights that would
+//   add nothing
+// - Matrices are row-major, for row vectors (as DirectXMath
+//   stores them), and there are no graphics dependencies
+// --------------------------------------------------------
+class SoftwareRenderer
+{
+public:
+	// Same layout as Vertex in Vertex.h
+	struct Vertex
+	{
+		float Position[3];
+		float UV[2];
+		float Normal[3];
+		float Tangent[3];
+	};
+
+	struct Mesh
+	{
+		std::vector<Vertex> Vertices;
+		std::vector<unsigned int> Indices;
+	};
+
+	// RGBA8 with a full mip chain, each mip half the size of the last
+	struct Texture
+	{
+		std::vector<unsigned int> Widths;
+		std::vector<unsigned int> Heights;
+		std::vector<std::vector<unsigned char>> Mips;
+	};
+
+	// The textures the pixel shader reads - any may be null
+	struct Material
+	{
+		float ColorTint[4];
+		std::shared_ptr<Texture> Albedo;
+		std::shared_ptr<Texture> Normal;
+		std::shared_ptr<Texture> Roughness;
+		std::shared_ptr<Texture> Metalness;
+	};
+
+	struct Object
+	{
+		std::shared_ptr<SoftwareRenderer::Mesh> Mesh;
+		std::shared_ptr<SoftwareRenderer::Material> Material;
+		float World[16];
+	};
+
+	// Same fields and type values as Light in Light.h (minus the shadow ones)
+	struct Light
+	{
+		int Type;
+		float Direction[3];
+		float Range;
+		float Position[3];
+		float Intensity;
+		float Color[3];
+		float SpotFalloff;
+	};
+	static const int LightTypeDirectional = 0;
+	static const int LightTypePoint = 1;
+	static const int LightTypeSpot = 2;
+
+	struct Camera
+	{
+		float Position[3];
+		float View[16];
+		float Projection[16];
+	};
+
+	// Counts and timings from the last Render()
+	struct Stats
+	{
+		unsigned int Triangles;			// Submitted
+		unsigned int TrianglesBinned;	// After clipping and culling
+		unsigned int TileTriangles;		// Summed over every tile they touch
+		uint64_t PixelsShaded;
+		double VertexMs;				// Transforming vertices
+		double SetupMs;					// Clipping, culling and binning triangles
+		double TileMs;					// Rasterizing and shading tiles
+		double TotalMs;
+	};
+
+	// tileSize - Pixels on each side of a tile, rounded up to a multiple of four
+	SoftwareRenderer(unsigned int width, unsigned int height, unsigned int tileSize = 32);
+
+	// Loads an OBJ the way Mesh does: flipped to left-handed, with
+	// flipped V and tangents calculated from the UVs
+	static bool LoadObj(const std::string& path, Mesh* mesh);
+
+	// Loads a PNG and builds its mips with a box filter
+	static bool LoadTexture(const std::string& path, Texture* texture);
+
+	// The sky's faces, in the order +X, -X, +Y, -Y, +Z, -Z (right,
+	// left, up, down, front, back) - null or empty faces clear to
+	// the clear color instead
+	void SetSky(const std::shared_ptr<Texture> faces[6]);
+	void SetClearColor(const float color[4]);
+
+	// Matches Camera: LookTo with a world up of +Y, and a left-handed
+	// perspective projection
+	static void MakeView(const float position[3], const float pitchYawRoll[3], float view[16]);
+	static void MakeProjection(float fieldOfView, float aspectRatio, float nearClip, float farClip, float projection[16]);
+
+	// Draws a frame, across the job system's threads if one is given
+	void Render(
+		const std::vector<Object>& objects,
+		const std::vector<Light>& lights,
+		const Camera& camera,
+		JobSystem* jobSystem);
+
+	// RGBA8, rows top to bottom, GetWidth() * 4 bytes apart
+	const unsigned char* GetPixels() { return pixels.data(); }
+	unsigned int GetWidth() { return width; }
+	unsigned int GetHeight() { return height; }
+	unsigned int GetTileSize() { return tileSize; }
+	const Stats& GetStats() { return stats; }
+
+	// Triangles set up (and binned) by one job
+	static const unsigned int ChunkSize = 1024;
+
+private:
+	// A vertex after the vertex shader
+	struct ShadedVertex
+	{
+		float Clip[4];
+		float World[3];
+		float Normal[3];
+		float Tangent[3];
+		float UV[2];
+	};
+
+	// A triangle ready to rasterize, in pixels
+	struct Triangle
+	{
+		ShadedVertex Vertices[3];
+		float X[3];
+		float Y[3];
+		float Z[3];
+		float InvW[3];
+		const SoftwareRenderer::Material* Material;
+		int MinX, MinY, MaxX, MaxY;
+	};
+
+	// A run of triangles from one object, set up and binned together
+	struct Chunk
+	{
+		unsigned int Object;
+		unsigned int FirstIndex;
+		unsigned int IndexCount;
+		std::vector<Triangle> Triangles;
+		std::vector<std::vector<unsigned int>> Bins;	// Triangles touching each tile, in order
+	};
+
+	unsigned int width;
+	unsigned int height;
+	unsigned int tileSize;
+	unsigned int tilesX;
+	unsigned int tilesY;
+
+	std::vector<unsigned char> pixels;
+	float clearColor[4];
+	std::shared_ptr<Texture> sky[6];
+
+	// This frame's work
+	const std::vector<Object>* objects;
+	const std::vector<Light>* lights;
+	Camera camera;
+	float viewProjection[16];
+	std::vector<std::vector<ShadedVertex>> shadedVertices;	// One list per object
+	std::vector<Chunk> chunks;
+	Stats stats;
+
+	void ShadeVertices(unsigned int object);
+	void SetupChunk(Chunk& chunk);
+	void AddTriangle(Chunk& chunk, const ShadedVertex* vertices[3], const Material* material);
+	unsigned int RenderTile(unsigned int tile);
+	void ShadePixel(const Triangle& triangle, float px, float py, unsigned char out[4]);
+	void ShadeSky(float px, float py, unsigned char out[4]);
+};
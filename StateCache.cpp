@@ -0,0 +1,314 @@
+#include "StateCache.h"
+
+#include <stdint.h>
+
+// A pointer value no real object can have, used to mark unknown bindings
+template<typename T>
+static T* UnknownPtr() { return reinterpret_cast<T*>(~(uintptr_t)0); }
+
+static const unsigned int UnknownValue = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// Constructor - nothing is known about the pipeline yet
+// --------------------------------------------------------
+StateCache::StateCache(std::shared_ptr<StateCacheBackend> backend)
+	:
+	backend(backend),
+	current(),
+	lastFrame()
+{
+	Invalidate();
+}
+
+// --------------------------------------------------------
+// Starts a new frame of stats
+// --------------------------------------------------------
+void StateCache::BeginFrame()
+{
+	lastFrame = current;
+	current = {};
+}
+
+// --------------------------------------------------------
+// Forgets all shadowed state, so the next bind of
+// everything is issued.  Call this after anything else
+// has touched the context directly.
+// --------------------------------------------------------
+void StateCache::Invalidate()
+{
+	inputLayout = UnknownPtr<ID3D11InputLayout>();
+	topology = UnknownValue;
+	for (unsigned int i = 0; i < MaxVertexBuffers; i++)
+	{
+		vertexBuffers[i] = UnknownPtr<ID3D11Buffer>();
+		vertexStrides[i] = UnknownValue;
+		vertexOffsets[i] = UnknownValue;
+	}
+	indexBuffer = UnknownPtr<ID3D11Buffer>();
+	indexFormat = UnknownValue;
+	indexOffset = UnknownValue;
+	vertexShader = UnknownPtr<ID3D11VertexShader>();
+	pixelShader = UnknownPtr<ID3D11PixelShader>();
+	rasterizerState = UnknownPtr<ID3D11RasterizerState>();
+	depthStencilState = UnknownPtr<ID3D11DepthStencilState>();
+	stencilRef = UnknownValue;
+
+	StageState* stages[] = { &vs, &ps };
+	for (StageState* stage : stages)
+	{
+		for (unsigned int i = 0; i < MaxConstantBuffers; i++)
+			stage->ConstantBuffers[i] = { UnknownPtr<ID3D11Buffer>(), UnknownValue, UnknownValue };
+		for (unsigned int i = 0; i < MaxShaderResources; i++)
+			stage->ShaderResources[i] = UnknownPtr<ID3D11ShaderResourceView>();
+		for (unsigned int i = 0; i < MaxSamplers; i++)
+			stage->Samplers[i] = UnknownPtr<ID3D11SamplerState>();
+	}
+}
+
+// --------------------------------------------------------
+// Bumps the issued or filtered counter
+//
+// Returns the given value so callers can write "if (Count(changed))"
+// --------------------------------------------------------
+bool StateCache::Count(bool issue)
+{
+	if (issue) current.Issued++;
+	else current.Filtered++;
+	return issue;
+}
+
+// --------------------------------------------------------
+// Compares and updates a range of constant buffer bindings
+//
+// firstConstants/numConstants - Null for whole-buffer binds
+//
+// Returns true if anything in the range changed (or is untracked)
+// --------------------------------------------------------
+bool StateCache::FilterConstantBuffers(
+	StageState& stage,
+	unsigned int startSlot,
+	unsigned int numBuffers,
+	ID3D11Buffer* const* buffers,
+	const unsigned int* firstConstants,
+	const unsigned int* numConstants)
+{
+	bool changed = startSlot + numBuffers > MaxConstantBuffers;
+	for (unsigned int i = 0; i < numBuffers && startSlot + i < MaxConstantBuffers; i++)
+	{
+		// A whole-buffer bind is recorded as an "unknown" range, since
+		// the number of constants it covers depends on the buffer's size
+		ConstantBufferBinding binding = {};
+		binding.Buffer = buffers ? buffers[i] : 0;
+		binding.FirstConstant = firstConstants ? firstConstants[i] : 0;
+		binding.NumConstants = numConstants ? numConstants[i] : UnknownValue - 1;
+
+		ConstantBufferBinding& bound = stage.ConstantBuffers[startSlot + i];
+		if (bound.Buffer != binding.Buffer ||
+			bound.FirstConstant != binding.FirstConstant ||
+			bound.NumConstants != binding.NumConstants)
+		{
+			bound = binding;
+			changed = true;
+		}
+	}
+	return Count(changed);
+}
+
+// --------------------------------------------------------
+// Compares and updates a range of SRV bindings
+// --------------------------------------------------------
+bool StateCache::FilterShaderResources(StageState& stage, unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView* const* views)
+{
+	bool changed = startSlot + numViews > MaxShaderResources;
+	for (unsigned int i = 0; i < numViews && startSlot + i < MaxShaderResources; i++)
+	{
+		ID3D11ShaderResourceView* view = views ? views[i] : 0;
+		if (stage.ShaderResources[startSlot + i] != view)
+		{
+			stage.ShaderResources[startSlot + i] = view;
+			changed = true;
+		}
+	}
+	return Count(changed);
+}
+
+// --------------------------------------------------------
+// Compares and updates a range of sampler bindings
+// --------------------------------------------------------
+bool StateCache::FilterSamplers(StageState& stage, unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState* const* samplers)
+{
+	bool changed = startSlot + numSamplers > MaxSamplers;
+	for (unsigned int i = 0; i < numSamplers && startSlot + i < MaxSamplers; i++)
+	{
+		ID3D11SamplerState* sampler = samplers ? samplers[i] : 0;
+		if (stage.Samplers[startSlot + i] != sampler)
+		{
+			stage.Samplers[startSlot + i] = sampler;
+			changed = true;
+		}
+	}
+	return Count(changed);
+}
+
+
+// --------------------------------------------------------
+// Input assembler
+// --------------------------------------------------------
+void StateCache::IASetInputLayout(ID3D11InputLayout* layout)
+{
+	if (Count(inputLayout != layout))
+	{
+		inputLayout = layout;
+		backend->SetInputLayout(layout);
+	}
+}
+
+void StateCache::IASetPrimitiveTopology(unsigned int newTopology)
+{
+	if (Count(topology != newTopology))
+	{
+		topology = newTopology;
+		backend->SetPrimitiveTopology(newTopology);
+	}
+}
+
+void StateCache::IASetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* strides, const unsigned int* offsets)
+{
+	bool changed = startSlot + numBuffers > MaxVertexBuffers;
+	for (unsigned int i = 0; i < numBuffers && startSlot + i < MaxVertexBuffers; i++)
+	{
+		unsigned int slot = startSlot + i;
+		if (vertexBuffers[slot] != buffers[i] || vertexStrides[slot] != strides[i] || vertexOffsets[slot] != offsets[i])
+		{
+			vertexBuffers[slot] = buffers[i];
+			vertexStrides[slot] = strides[i];
+			vertexOffsets[slot] = offsets[i];
+			changed = true;
+		}
+	}
+
+	if (Count(changed))
+		backend->SetVertexBuffers(startSlot, numBuffers, buffers, strides, offsets);
+}
+
+void StateCache::IASetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset)
+{
+	if (Count(indexBuffer != buffer || indexFormat != format || indexOffset != offset))
+	{
+		indexBuffer = buffer;
+		indexFormat = format;
+		indexOffset = offset;
+		backend->SetIndexBuffer(buffer, format, offset);
+	}
+}
+
+
+// --------------------------------------------------------
+// Vertex shader stage
+// --------------------------------------------------------
+void StateCache::VSSetShader(ID3D11VertexShader* shader)
+{
+	if (Count(vertexShader != shader))
+	{
+		vertexShader = shader;
+		backend->SetVertexShader(shader);
+	}
+}
+
+void StateCache::VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers)
+{
+	if (FilterConstantBuffers(vs, startSlot, numBuffers, buffers, 0, 0))
+		backend->SetConstantBuffers(StateCacheBackend::VertexStage, startSlot, numBuffers, buffers, 0, 0);
+}
+
+void StateCache::VSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* firstConstants, const unsigned int* numConstants)
+{
+	if (FilterConstantBuffers(vs, startSlot, numBuffers, buffers, firstConstants, numConstants))
+		backend->SetConstantBuffers(StateCacheBackend::VertexStage, startSlot, numBuffers, buffers, firstConstants, numConstants);
+}
+
+void StateCache::VSSetShaderResources(unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView* const* views)
+{
+	if (FilterShaderResources(vs, startSlot, numViews, views))
+		backend->SetShaderResources(StateCacheBackend::VertexStage, startSlot, numViews, views);
+}
+
+void StateCache::VSSetSamplers(unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState* const* samplers)
+{
+	if (FilterSamplers(vs, startSlot, numSamplers, samplers))
+		backend->SetSamplers(StateCacheBackend::VertexStage, startSlot, numSamplers, samplers);
+}
+
+
+// --------------------------------------------------------
+// Pixel shader stage
+// --------------------------------------------------------
+void StateCache::PSSetShader(ID3D11PixelShader* shader)
+{
+	if (Count(pixelShader != shader))
+	{
+		pixelShader = shader;
+		backend->SetPixelShader(shader);
+	}
+}
+
+void StateCache::PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers)
+{
+	if (FilterConstantBuffers(ps, startSlot, numBuffers, buffers, 0, 0))
+		backend->SetConstantBuffers(StateCacheBackend::PixelStage, startSlot, numBuffers, buffers, 0, 0);
+}
+
+void StateCache::PSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* firstConstants, const unsigned int* numConstants)
+{
+	if (FilterConstantBuffers(ps, startSlot, numBuffers, buffers, firstConstants, numConstants))
+		backend->SetConstantBuffers(StateCacheBackend::PixelStage, startSlot, numBuffers, buffers, firstConstants, numConstants);
+}
+
+void StateCache::PSSetShaderResources(unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView* const* views)
+{
+	if (FilterShaderResources(ps, startSlot, numViews, views))
+		backend->SetShaderResources(StateCacheBackend::PixelStage, startSlot, numViews, views);
+}
+
+void StateCache::PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState* const* samplers)
+{
+	if (FilterSamplers(ps, startSlot, numSamplers, samplers))
+		backend->SetSamplers(StateCacheBackend::PixelStage, startSlot, numSamplers, samplers);
+}
+
+
+// --------------------------------------------------------
+// Fixed function state
+// --------------------------------------------------------
+void StateCache::RSSetState(ID3D11RasterizerState* state)
+{
+	if (Count(rasterizerState != state))
+	{
+		rasterizerState = state;
+		backend->SetRasterizerState(state);
+	}
+}
+
+void StateCache::OMSetDepthStencilState(ID3D11DepthStencilState* state, unsigned int newStencilRef)
+{
+	if (Count(depthStencilState != state || stencilRef != newStencilRef))
+	{
+		depthStencilState = state;
+		stencilRef = newStencilRef;
+		backend->SetDepthStencilState(state, newStencilRef);
+	}
+}
+
+
+// --------------------------------------------------------
+// Draws always go straight through
+// --------------------------------------------------------
+void StateCache::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	backend->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void StateCache::DrawIndexedInstancedIndirect(ID3D11Buffer* argsBuffer, unsigned int argsOffset)
+{
+	backend->DrawIndexedInstancedIndirect(argsBuffer, argsOffset);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <memory>
+#include "StateCacheBackend.h"
+
+// --------------------------------------------------------
+// Sits between our rendering code and a device context and
+// remembers what is currently bound to the pipeline
+//
+// - Calls that would bind what's already bound are dropped
+// - Only tracks the state we actually use (IA, VS, PS, RS, OM)
+// - Anything that binds state behind its back (ImGui, for
+//   instance) must be followed by a call to Invalidate()
+// - Whatever survives goes to a StateCacheBackend - usually
+//   a D3D11StateCacheBackend around a device context
+// - Portable C++ - builds anywhere
+// --------------------------------------------------------
+class StateCache
+{
+public:
+	// Issued vs. filtered calls, per frame
+	struct Stats
+	{
+		unsigned int Issued;
+		unsigned int Filtered;
+	};
+
+	// How many slots of each kind we shadow - binds outside of these are always issued
+	static const unsigned int MaxVertexBuffers = 4;
+	static const unsigned int MaxConstantBuffers = 8;
+	static const unsigned int MaxShaderResources = 16;
+	static const unsigned int MaxSamplers = 8;
+
+	StateCache(std::shared_ptr<StateCacheBackend> backend);
+
+	// Frame boundaries and state invalidation
+	void BeginFrame();
+	void Invalidate();
+
+	// Input assembler
+	void IASetInputLayout(ID3D11InputLayout* layout);
+	void IASetPrimitiveTopology(unsigned int topology);	// A D3D11_PRIMITIVE_TOPOLOGY
+	void IASetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* strides, const unsigned int* offsets);
+	void IASetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset);	// A DXGI_FORMAT
+
+	// Vertex shader stage
+	void VSSetShader(ID3D11VertexShader* shader);
+	void VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers);
+	void VSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* firstConstants, const unsigned int* numConstants);
+	void VSSetShaderResources(unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView* const* views);
+	void VSSetSamplers(unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState* const* samplers);
+
+	// Pixel shader stage
+	void PSSetShader(ID3D11PixelShader* shader);
+	void PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers);
+	void PSSetConstantBuffers1(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* firstConstants, const unsigned int* numConstants);
+	void PSSetShaderResources(unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView* const* views);
+	void PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState* const* samplers);
+
+	// Fixed function state
+	void RSSetState(ID3D11RasterizerState* state);
+	void OMSetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef);
+
+	// Draws aren't filtered, but go through here so the cache sees everything
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void DrawIndexedInstancedIndirect(ID3D11Buffer* argsBuffer, unsigned int argsOffset);
+
+	// Getters
+	std::shared_ptr<StateCacheBackend> GetBackend() { return backend; }
+	Stats GetFrameStats() { return current; }
+	Stats GetLastFrameStats() { return lastFrame; }
+
+private:
+	std::shared_ptr<StateCacheBackend> backend;
+
+	// A constant buffer binding, which may be a range of a larger buffer
+	struct ConstantBufferBinding
+	{
+		ID3D11Buffer* Buffer;
+		unsigned int FirstConstant;
+		unsigned int NumConstants;
+	};
+
+	// Per-stage shadow state
+	struct StageState
+	{
+		ConstantBufferBinding ConstantBuffers[MaxConstantBuffers];
+		ID3D11ShaderResourceView* ShaderResources[MaxShaderResources];
+		ID3D11SamplerState* Samplers[MaxSamplers];
+	};
+
+	// Shadow copies of the bound state
+	// - Raw pointers are only ever compared, never dereferenced, and
+	//   the backend holds a reference to each, so none can be freed
+	//   (and its address reused) while we still remember it
+	// - After Invalidate() everything holds an "unknown" value that
+	//   never matches a real binding, so the next bind is always issued
+	ID3D11InputLayout* inputLayout;
+	unsigned int topology;
+	ID3D11Buffer* vertexBuffers[MaxVertexBuffers];
+	unsigned int vertexStrides[MaxVertexBuffers];
+	unsigned int vertexOffsets[MaxVertexBuffers];
+	ID3D11Buffer* indexBuffer;
+	unsigned int indexFormat;
+	unsigned int indexOffset;
+	ID3D11VertexShader* vertexShader;
+	ID3D11PixelShader* pixelShader;
+	ID3D11RasterizerState* rasterizerState;
+	ID3D11DepthStencilState* depthStencilState;
+	unsigned int stencilRef;
+	StageState vs;
+	StageState ps;
+
+	// Counters
+	Stats current;
+	Stats lastFrame;
+
+	// Helpers shared by both shader stages - return true if the call must be issued
+	bool FilterConstantBuffers(StageState& stage, unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* firstConstants, const unsigned int* numConstants);
+	bool FilterShaderResources(StageState& stage, unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView* const* views);
+	bool FilterSamplers(StageState& stage, unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState* const* samplers);
+	bool Count(bool issue);
+};
+
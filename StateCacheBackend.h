@@ -0,0 +1,55 @@
+#pragma once
+
+// Only pointers to these cross this line, so no Direct3D headers are needed
+struct ID3D11Buffer;
+struct ID3D11InputLayout;
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11ShaderResourceView;
+struct ID3D11SamplerState;
+struct ID3D11RasterizerState;
+struct ID3D11DepthStencilState;
+
+// --------------------------------------------------------
+// What StateCache binds through - the calls that survive
+// its filtering, and nothing else
+//
+// - Mirrors the ID3D11DeviceContext calls the cache shadows,
+//   with topologies and formats passed as plain values, so
+//   the cache's bookkeeping doesn't depend on any API (and
+//   can run against a recording fake)
+// - A backend must keep a reference to everything bound
+//   through it until that slot is bound again, since the
+//   cache remembers objects by address - otherwise a freed
+//   object's address could be reused by a new one, and
+//   binding the new one would be wrongly filtered out
+// --------------------------------------------------------
+class StateCacheBackend
+{
+public:
+	enum Stage { VertexStage, PixelStage };
+
+	virtual ~StateCacheBackend() {}
+
+	// Input assembler
+	virtual void SetInputLayout(ID3D11InputLayout* layout) = 0;
+	virtual void SetPrimitiveTopology(unsigned int topology) = 0;
+	virtual void SetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* strides, const unsigned int* offsets) = 0;
+	virtual void SetIndexBuffer(ID3D11Buffer* buffer, unsigned int format, unsigned int offset) = 0;
+
+	// Shader stages
+	// - firstConstants and numConstants are null for whole-buffer binds
+	virtual void SetVertexShader(ID3D11VertexShader* shader) = 0;
+	virtual void SetPixelShader(ID3D11PixelShader* shader) = 0;
+	virtual void SetConstantBuffers(Stage stage, unsigned int startSlot, unsigned int numBuffers, ID3D11Buffer* const* buffers, const unsigned int* firstConstants, const unsigned int* numConstants) = 0;
+	virtual void SetShaderResources(Stage stage, unsigned int startSlot, unsigned int numViews, ID3D11ShaderResourceView* const* views) = 0;
+	virtual void SetSamplers(Stage stage, unsigned int startSlot, unsigned int numSamplers, ID3D11SamplerState* const* samplers) = 0;
+
+	// Fixed function state
+	virtual void SetRasterizerState(ID3D11RasterizerState* state) = 0;
+	virtual void SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef) = 0;
+
+	// Draws
+	virtual void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) = 0;
+	virtual void DrawIndexedInstancedIndirect(ID3D11Buffer* argsBuffer, unsigned int argsOffset) = 0;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+// --------------------------------------------------------
+// Times work for the portable benchmarks (see CMakeLists.txt)
+//
+// - A warm-up run first, so caches, page faults and thread
+//   start-up aren't measured
+// - Reports the best of several runs, which is the most
+//   repeatable number on a machine that's doing other things
+// --------------------------------------------------------
+class BenchmarkTimer
+{
+public:
+	// The fastest of runs timed calls, in milliseconds
+	static double Best(unsigned int runs, const std::function<void()>& work)
+	{
+		work();
+
+		double best = 0.0;
+		for (unsigned int i = 0; i < runs; i++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			work();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (i == 0 || ms < best)
+				best = ms;
+		}
+		return best;
+	}
+};
@@ -0,0 +1,47 @@
+#include "ClusterGrid.h"
+#include "JobSystem.h"
+#include "BenchmarkTimer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// --------------------------------------------------------
+// How building the CPU cluster lists scales with the
+// number of point lights
+//
+// - Lights are spread through the view frustum the way the
+//   demo scene's are, all with the same range, so only the
+//   count changes between rows
+// - Each count is culled serially and across the job system
+// --------------------------------------------------------
+
+static float Random(float low, float high)
+{
+	return low + (high - low) * (float)rand() / RAND_MAX;
+}
+
+int main()
+{
+	const unsigned int lightCounts[] = { 8, 64, 512, 4096 };
+	JobSystem jobs;
+
+	printf("%8s %14s %14s %12s\n", "Lights", "Serial (ms)", "Jobs (ms)", "Overflows");
+	for (unsigned int lightCount : lightCounts)
+	{
+		ClusterGrid grid;
+		grid.SetProjection(1.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+
+		srand(1);
+		for (unsigned int i = 0; i < lightCount; i++)
+		{
+			float z = Random(0.5f, 100.0f);
+			float position[3] = { Random(-1.0f, 1.0f) * z, Random(-0.6f, 0.6f) * z, z };
+			grid.AddLight(position, 5.0f, i);
+		}
+
+		double serial = BenchmarkTimer::Best(10, [&]() { grid.Cull(0); });
+		double parallel = BenchmarkTimer::Best(10, [&]() { grid.Cull(&jobs); });
+		printf("%8u %14.3f %14.3f %12u\n", lightCount, serial, parallel, grid.GetOverflowCount());
+	}
+	return 0;
+}
@@ -0,0 +1,171 @@
+#include "TestFramework.h"
+#include "ClusterGrid.h"
+#include "JobSystem.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// What ClusterCullCS.hlsl does: every cluster walks every light, in order
+static void CullBruteForce(ClusterGrid& grid, std::vector<unsigned int>& counts, std::vector<unsigned int>& indices, unsigned int* overflows)
+{
+	counts.assign(ClusterGrid::ClusterCount, 0);
+	indices.assign(ClusterGrid::ClusterCount * ClusterGrid::MaxLightsPerCluster, 0);
+	*overflows = 0;
+	for (unsigned int c = 0; c < ClusterGrid::ClusterCount; c++)
+	{
+		bool overflowed = false;
+		for (const ClusterCullLight& light : grid.GetLights())
+		{
+			if (!ClusterGrid::SphereIntersectsCluster(grid.GetBounds()[c], light))
+				continue;
+			if (counts[c] < ClusterGrid::MaxLightsPerCluster)
+				indices[c * ClusterGrid::MaxLightsPerCluster + counts[c]++] = light.LightIndex;
+			else
+				overflowed = true;
+		}
+		*overflows += overflowed;
+	}
+}
+
+static float Random(float low, float high)
+{
+	return low + (high - low) * (float)rand() / RAND_MAX;
+}
+
+// Lights all over (and outside) the frustum, with a tight cluster to overflow some lists
+static void AddRandomLights(ClusterGrid& grid, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float position[3];
+		if (i % 4 == 0)
+		{
+			position[0] = Random(-1.0f, 1.0f);
+			position[1] = Random(-1.0f, 1.0f);
+			position[2] = Random(4.0f, 6.0f);
+		}
+		else
+		{
+			position[0] = Random(-60.0f, 60.0f);
+			position[1] = Random(-40.0f, 40.0f);
+			position[2] = Random(-10.0f, 110.0f);
+		}
+		grid.AddLight(position, Random(0.5f, 12.0f), i);
+	}
+}
+
+// Compares the culled lists, slot by slot, only up to each count
+static unsigned int CountMismatches(ClusterGrid& grid, const std::vector<unsigned int>& counts, const std::vector<unsigned int>& indices)
+{
+	unsigned int mismatches = 0;
+	for (unsigned int c = 0; c < ClusterGrid::ClusterCount; c++)
+	{
+		if (grid.GetLightCounts()[c] != counts[c])
+		{
+			mismatches++;
+			continue;
+		}
+		for (unsigned int i = 0; i < counts[c]; i++)
+		{
+			unsigned int slot = c * ClusterGrid::MaxLightsPerCluster + i;
+			if (grid.GetLightIndices()[slot] != indices[slot])
+			{
+				mismatches++;
+				break;
+			}
+		}
+	}
+	return mismatches;
+}
+
+TEST(CulledListsMatchTheShadersBruteForce)
+{
+	srand(7);
+	JobSystem jobs(3);
+	for (int round = 0; round < 4; round++)
+	{
+		ClusterGrid grid;
+		grid.SetProjection(Random(0.6f, 1.6f), Random(1.0f, 2.4f), 0.1f, 100.0f);
+		AddRandomLights(grid, 200 + round * 300);
+
+		std::vector<unsigned int> counts;
+		std::vector<unsigned int> indices;
+		unsigned int overflows = 0;
+		CullBruteForce(grid, counts, indices, &overflows);
+
+		grid.Cull(0);
+		CHECK(CountMismatches(grid, counts, indices) == 0);
+		CHECK(grid.GetOverflowCount() == overflows);
+
+		// Any split across threads gives the same lists
+		grid.Cull(&jobs);
+		CHECK(CountMismatches(grid, counts, indices) == 0);
+		CHECK(grid.GetOverflowCount() == overflows);
+	}
+}
+
+TEST(DenseLightsOverflowInLightOrder)
+{
+	ClusterGrid grid;
+	grid.SetProjection(1.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+	float center[3] = { 0.0f, 0.0f, 5.0f };
+	for (unsigned int i = 0; i < ClusterGrid::MaxLightsPerCluster + 10; i++)
+		grid.AddLight(center, 1.0f, i);
+	grid.Cull(0);
+
+	unsigned int c = ClusterGrid::GetClusterIndex(ClusterGrid::TilesX / 2, ClusterGrid::TilesY / 2, grid.GetSlice(5.0f));
+	CHECK(grid.GetLightCounts()[c] == ClusterGrid::MaxLightsPerCluster);
+	CHECK(grid.GetLightIndices()[c * ClusterGrid::MaxLightsPerCluster] == 0);
+	CHECK(grid.GetLightIndices()[(c + 1) * ClusterGrid::MaxLightsPerCluster - 1] == ClusterGrid::MaxLightsPerCluster - 1);
+	CHECK(grid.GetOverflowCount() > 0);
+}
+
+TEST(SlicesCoverTheDepthRangeInOrder)
+{
+	ClusterGrid grid;
+	grid.SetProjection(1.0f, 1.5f, 0.5f, 200.0f);
+	const std::vector<ClusterBounds>& bounds = grid.GetBounds();
+
+	CHECK(fabsf(bounds[ClusterGrid::GetClusterIndex(0, 0, 0)].Min[2] - 0.5f) < 1e-5f);
+	CHECK(fabsf(bounds[ClusterGrid::GetClusterIndex(0, 0, ClusterGrid::Slices - 1)].Max[2] - 200.0f) < 1e-3f);
+	for (unsigned int z = 0; z < ClusterGrid::Slices; z++)
+	{
+		const ClusterBounds& b = bounds[ClusterGrid::GetClusterIndex(0, 0, z)];
+		if (z > 0)
+			CHECK(fabsf(bounds[ClusterGrid::GetClusterIndex(0, 0, z - 1)].Max[2] - b.Min[2]) < 1e-3f);
+
+		// The middle of each slice (by ratio) maps back to it
+		CHECK(grid.GetSlice(sqrtf(b.Min[2] * b.Max[2])) == z);
+	}
+	CHECK(grid.GetSlice(0.01f) == 0);
+	CHECK(grid.GetSlice(1000.0f) == ClusterGrid::Slices - 1);
+}
+
+TEST(PointsInTheFrustumLieInTheirCluster)
+{
+	const float fov = 1.2f;
+	const float aspect = 16.0f / 9.0f;
+	ClusterGrid grid;
+	grid.SetProjection(fov, aspect, 0.1f, 100.0f);
+
+	srand(11);
+	unsigned int outside = 0;
+	for (int i = 0; i < 10000; i++)
+	{
+		// A point given by its screen position and depth
+		float ndcX = Random(-0.999f, 0.999f);
+		float ndcY = Random(-0.999f, 0.999f);
+		float z = Random(0.11f, 99.0f);
+		float x = ndcX * tanf(fov * 0.5f) * aspect * z;
+		float y = ndcY * tanf(fov * 0.5f) * z;
+
+		unsigned int tileX = (unsigned int)((ndcX * 0.5f + 0.5f) * ClusterGrid::TilesX);
+		unsigned int tileY = (unsigned int)((0.5f - ndcY * 0.5f) * ClusterGrid::TilesY);
+		const ClusterBounds& b = grid.GetBounds()[ClusterGrid::GetClusterIndex(tileX, tileY, grid.GetSlice(z))];
+
+		const float e = 1e-3f;
+		if (x < b.Min[0] - e || x > b.Max[0] + e || y < b.Min[1] - e || y > b.Max[1] + e || z < b.Min[2] - e || z > b.Max[2] + e)
+			outside++;
+	}
+	CHECK(outside == 0);
+}
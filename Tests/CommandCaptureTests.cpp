@@ -0,0 +1,241 @@
+#include "TestFramework.h"
+#include "CommandCapture.h"
+#include "CommandReplayer.h"
+#include "NullRenderDevice.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// --------------------------------------------------------
+// A null context that also writes down every draw, with
+// the constants each stage's shader held at the time
+// --------------------------------------------------------
+class DrawLog : public NullRenderContext
+{
+public:
+	struct Draw
+	{
+		unsigned int IndexCount;
+		unsigned int StartIndex;
+		int BaseVertex;
+		std::vector<unsigned char> Constants[StageCount];
+	};
+
+	std::vector<Draw> Draws;
+	std::vector<NullRenderContext::Stats> Frames;
+
+	DrawLog() : shaders() {}
+
+	void NextFrame()
+	{
+		BeginFrame();
+		Frames.push_back(GetLastFrameStats());
+	}
+
+	void SetShader(Stage stage, RenderShader* shader, const RenderConstantBufferRanges* ranges)
+	{
+		shaders[stage] = shader;
+		NullRenderContext::SetShader(stage, shader, ranges);
+	}
+
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+	{
+		Draw draw;
+		draw.IndexCount = indexCount;
+		draw.StartIndex = startIndex;
+		draw.BaseVertex = baseVertex;
+		for (unsigned int s = 0; s < StageCount; s++)
+		{
+			RenderShader* shader = shaders[s];
+			for (unsigned int b = 0; shader && b < shader->GetConstantBufferCount(); b++)
+			{
+				const unsigned char* data = (const unsigned char*)shader->GetConstantBufferData(b);
+				draw.Constants[s].insert(draw.Constants[s].end(), data, data + shader->GetConstantBufferSize(b));
+			}
+		}
+		Draws.push_back(draw);
+		NullRenderContext::DrawIndexed(indexCount, startIndex, baseVertex);
+	}
+
+private:
+	RenderShader* shaders[StageCount];
+};
+
+static bool SameStats(const NullRenderContext::Stats& a, const NullRenderContext::Stats& b)
+{
+	return
+		a.Draws == b.Draws &&
+		a.IndirectDraws == b.IndirectDraws &&
+		a.Dispatches == b.Dispatches &&
+		a.Indices == b.Indices &&
+		a.Binds == b.Binds &&
+		a.RedundantBinds == b.RedundantBinds;
+}
+
+static bool SameDraws(const std::vector<DrawLog::Draw>& a, const std::vector<DrawLog::Draw>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].IndexCount != b[i].IndexCount || a[i].StartIndex != b[i].StartIndex || a[i].BaseVertex != b[i].BaseVertex)
+			return false;
+		for (unsigned int s = 0; s < NullRenderContext::StageCount; s++)
+		{
+			if (a[i].Constants[s] != b[i].Constants[s])
+				return false;
+		}
+	}
+	return true;
+}
+
+TEST(CapturedFramesReplayTheSameBindsConstantsAndDraws)
+{
+	NullRenderDevice device;
+	std::shared_ptr<DrawLog> original = std::make_shared<DrawLog>();
+	CommandCapture capture(original);
+
+	RenderBufferDesc vertexDesc = { RenderBufferDesc::VertexBuffer, RenderBufferDesc::Default, 4096, 32 };
+	RenderBufferDesc indexDesc = { RenderBufferDesc::IndexBuffer, RenderBufferDesc::Default, 1024, 4 };
+	RenderBufferDesc constantDesc = { RenderBufferDesc::ConstantBuffer, RenderBufferDesc::Dynamic, 64, 0 };
+	RenderBufferDesc argsDesc = { RenderBufferDesc::IndirectArgsBuffer, RenderBufferDesc::Default, 20, 0 };
+	std::shared_ptr<RenderBuffer> vertices = device.CreateBuffer(vertexDesc, 0);
+	std::shared_ptr<RenderBuffer> indices = device.CreateBuffer(indexDesc, 0);
+	std::shared_ptr<RenderBuffer> constants = device.CreateBuffer(constantDesc, 0);
+	std::shared_ptr<RenderBuffer> args = device.CreateBuffer(argsDesc, 0);
+
+	RenderTextureDesc textureDesc = { 64, 64, 1, 1, false };
+	std::shared_ptr<RenderTexture> albedo = device.CreateTexture(textureDesc, 0);
+	std::shared_ptr<RenderTexture> normals = device.CreateTexture(textureDesc, 0);
+	RenderSamplerDesc samplerDesc = {};
+	samplerDesc.MaxAnisotropy = 16;
+	std::shared_ptr<RenderSampler> sampler = device.CreateSampler(samplerDesc);
+	RenderPipelineStateDesc stateDesc = {};
+	std::shared_ptr<RenderPipelineState> state = device.CreatePipelineState(stateDesc);
+
+	std::vector<NullRenderShader::Variable> vsVariables = { { "world", 64 }, { "tint", 16 } };
+	std::vector<NullRenderShader::Variable> psVariables = { { "color", 16 } };
+	std::shared_ptr<NullRenderShader> vs = std::make_shared<NullRenderShader>(original.get(), vsVariables, std::vector<std::string>(), std::vector<std::string>());
+	std::shared_ptr<NullRenderShader> ps = std::make_shared<NullRenderShader>(original.get(), psVariables,
+		std::vector<std::string>{ "Albedo", "Normals" }, std::vector<std::string>{ "Sampler" });
+
+	// Three frames, each drawing a few objects with their own constants
+	const unsigned int frames = 3;
+	for (unsigned int f = 0; f < frames; f++)
+	{
+		capture.BeginFrame();
+		capture.SetPipelineState(state.get());
+		capture.SetVertexBuffer(vertices.get(), 32, 0);
+		capture.SetIndexBuffer(indices.get(), 0);
+		capture.SetConstantBuffer(RenderContext::VertexStage, 1, constants.get());
+		RenderSampler* samplers[1] = { sampler.get() };
+		capture.SetSamplers(RenderContext::PixelStage, 0, 1, samplers);
+
+		unsigned char perFrame[64];
+		memset(perFrame, (int)f, sizeof(perFrame));
+		capture.UpdateBuffer(constants.get(), perFrame, sizeof(perFrame));
+
+		for (unsigned int o = 0; o < 4; o++)
+		{
+			float world[16] = {};
+			world[0] = world[5] = world[10] = world[15] = 1.0f;
+			world[12] = (float)o;
+			world[13] = (float)f;
+			float tint[4] = { 1.0f, 0.5f, (float)o, 1.0f };
+			float color[4] = { (float)f, (float)o, 0.25f, 1.0f };
+			vs->SetData("world", world, sizeof(world));
+			vs->SetData("tint", tint, sizeof(tint));
+			ps->SetData("color", color, sizeof(color));
+			vs->CopyAllBufferData();
+			ps->CopyAllBufferData();
+
+			// The same shaders every time, so every bind after the first is redundant
+			capture.SetShader(RenderContext::VertexStage, vs.get(), 0);
+			capture.SetShader(RenderContext::PixelStage, ps.get(), 0);
+			RenderTexture* textures[2] = { albedo.get(), o % 2 ? normals.get() : albedo.get() };
+			capture.SetTextures(RenderContext::PixelStage, 0, 2, textures);
+			capture.DrawIndexed(36 + o * 3, o * 36, -(int)o);
+		}
+		capture.DrawIndexedIndirect(args.get(), 0);
+		capture.Dispatch(8, 4, 1);
+		capture.EndFrame();
+		original->NextFrame();
+	}
+
+	const char* path = "CommandCaptureTests.rcap";
+	CHECK(capture.GetFrameCount() == frames);
+	CHECK(capture.Save(path));
+
+	CommandReplayer replayer;
+	bool loaded = replayer.Load(path);
+	remove(path);
+	CHECK(loaded);
+	CHECK(replayer.GetFrameCount() == frames);
+
+	NullRenderDevice replayDevice;
+	std::shared_ptr<DrawLog> replayed = std::make_shared<DrawLog>();
+	bool created = replayer.CreateResources(&replayDevice,
+		[&](const std::vector<unsigned int>& constantBufferSizes)
+		{
+			return std::make_shared<NullRenderShader>(replayed.get(), constantBufferSizes);
+		});
+	CHECK(created);
+
+	replayer.Replay(replayed.get(),
+		[&](unsigned int frame)
+		{
+			if (frame > 0)
+				replayed->NextFrame();
+		});
+	replayed->NextFrame();
+
+	// Every frame submits what it did, bind for bind, with the same constants at every draw
+	CHECK(replayed->Frames.size() == frames);
+	bool statsMatch = replayed->Frames.size() == original->Frames.size();
+	for (size_t f = 0; statsMatch && f < original->Frames.size(); f++)
+		statsMatch = SameStats(original->Frames[f], replayed->Frames[f]);
+	CHECK(statsMatch);
+	CHECK(original->Frames[0].Draws == 5);	// Indirect draws count as draws too
+	CHECK(original->Frames[0].IndirectDraws == 1);
+	CHECK(original->Frames[0].Dispatches == 1);
+	CHECK(original->Frames[0].RedundantBinds > 0);
+
+	CHECK(original->Draws.size() == frames * 4);
+	CHECK(SameDraws(original->Draws, replayed->Draws));
+
+	// The constants really were compared - the vertex shader's buffer and the pixel shader's
+	CHECK(original->Draws[5].Constants[RenderContext::VertexStage].size() == 80);
+	CHECK(original->Draws[5].Constants[RenderContext::PixelStage].size() == 16);
+}
+
+TEST(DamagedCapturesAreRejected)
+{
+	NullRenderDevice device;
+	std::shared_ptr<NullRenderContext> target = std::make_shared<NullRenderContext>();
+	CommandCapture capture(target);
+	capture.BeginFrame();
+	capture.DrawIndexed(3, 0, 0);
+	capture.EndFrame();
+
+	const char* path = "CommandCaptureTestsDamaged.rcap";
+	CHECK(capture.Save(path));
+
+	// Cut short, partway through the commands
+	FILE* file = fopen(path, "rb");
+	std::vector<unsigned char> bytes(4096);
+	size_t size = file ? fread(bytes.data(), 1, bytes.size(), file) : 0;
+	if (file)
+		fclose(file);
+	file = fopen(path, "wb");
+	if (file)
+	{
+		fwrite(bytes.data(), 1, size - 1, file);
+		fclose(file);
+	}
+
+	CommandReplayer replayer;
+	CHECK(size > sizeof(CommandStream::Header));
+	CHECK(!replayer.Load(path));
+	CHECK(!replayer.Load("NoSuchCapture.rcap"));
+	remove(path);
+}
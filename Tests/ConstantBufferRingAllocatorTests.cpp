@@ -0,0 +1,161 @@
+#include "TestFramework.h"
+#include "ConstantBufferRingAllocator.h"
+
+static const unsigned int Invalid = ConstantBufferRingAllocator::InvalidOffset;
+
+TEST(AllocationsAreAlignedAndPacked)
+{
+	ConstantBufferRingAllocator ring(1024);
+	CHECK(ring.Allocate(1) == 0);
+	CHECK(ring.Allocate(256) == 256);
+	CHECK(ring.Allocate(257) == 512);
+	CHECK(ring.GetUsedBytes() == 1024);
+	CHECK(ring.Allocate(16) == Invalid);
+}
+
+TEST(RejectsEmptyAndOversizedRequests)
+{
+	ConstantBufferRingAllocator ring(1000);
+	CHECK(ring.GetCapacity() == 768);
+	CHECK(ring.Allocate(0) == Invalid);
+	CHECK(ring.Allocate(769) == Invalid);
+	CHECK(ring.GetUsedBytes() == 0);
+}
+
+TEST(FramesRetireOldestFirst)
+{
+	ConstantBufferRingAllocator ring(1024);
+	ring.Allocate(256);
+	ring.EndFrame(1);
+	ring.Allocate(512);
+	ring.EndFrame(2);
+	CHECK(ring.GetFramesInFlight() == 2);
+	CHECK(ring.GetUsedBytes() == 768);
+
+	// Nothing is freed until its fence has passed
+	ring.RetireFrames(0);
+	CHECK(ring.GetFramesInFlight() == 2);
+	CHECK(ring.Allocate(512) == Invalid);
+
+	ring.RetireFrames(1);
+	CHECK(ring.GetFramesInFlight() == 1);
+	CHECK(ring.GetUsedBytes() == 512);
+
+	// A fence past several frames frees them all
+	ring.Allocate(256);
+	ring.EndFrame(3);
+	ring.RetireFrames(3);
+	CHECK(ring.GetFramesInFlight() == 0);
+	CHECK(ring.GetUsedBytes() == 0);
+}
+
+TEST(InFlightSpaceIsNeverHandedOut)
+{
+	ConstantBufferRingAllocator ring(1024);
+	unsigned int first = ring.Allocate(512);
+	ring.EndFrame(1);
+	unsigned int second = ring.Allocate(512);
+	CHECK(first == 0);
+	CHECK(second == 512);
+
+	// The ring is full until frame one retires, and then only its half comes back
+	CHECK(ring.Allocate(256) == Invalid);
+	ring.RetireFrames(1);
+	CHECK(ring.Allocate(512) == 0);
+	CHECK(ring.Allocate(256) == Invalid);
+}
+
+TEST(WrapsAroundWhenTheEndIsTooSmall)
+{
+	ConstantBufferRingAllocator ring(1024);
+	ring.Allocate(512);
+	ring.EndFrame(1);
+	ring.Allocate(256);
+	ring.EndFrame(2);
+	ring.RetireFrames(1);
+
+	// 256 bytes left at the end isn't enough, so the slice starts over at the front
+	bool wrapped = false;
+	CHECK(ring.Allocate(512, &wrapped) == 0);
+	CHECK(wrapped);
+
+	// The skipped end counts as used until this frame retires
+	CHECK(ring.GetUsedBytes() == 1024);
+	CHECK(ring.Allocate(16) == Invalid);
+	ring.EndFrame(3);
+
+	ring.RetireFrames(2);
+	CHECK(ring.GetUsedBytes() == 768);
+	ring.RetireFrames(3);
+	CHECK(ring.GetUsedBytes() == 0);
+
+	// Empty again, so allocation starts from the front without wrapping
+	CHECK(ring.Allocate(1024, &wrapped) == 0);
+	CHECK(!wrapped);
+}
+
+TEST(SliceEndingAtTheEndWrapsTheHead)
+{
+	ConstantBufferRingAllocator ring(1024);
+	ring.Allocate(256);
+	ring.EndFrame(1);
+	CHECK(ring.Allocate(768) == 256);
+	ring.EndFrame(2);
+	ring.RetireFrames(1);
+
+	bool wrapped = true;
+	CHECK(ring.Allocate(256, &wrapped) == 0);
+	CHECK(!wrapped);
+}
+
+TEST(ResetAfterOverflowStartsOver)
+{
+	// What ConstantBufferRing does when it runs out: discard the buffer and forget everything
+	ConstantBufferRingAllocator ring(1024);
+	ring.Allocate(512);
+	ring.EndFrame(1);
+	ring.Allocate(512);
+	CHECK(ring.Allocate(256) == Invalid);
+
+	ring.Reset();
+	CHECK(ring.GetUsedBytes() == 0);
+	CHECK(ring.GetFramesInFlight() == 0);
+	CHECK(ring.Allocate(1024) == 0);
+
+	// Fences from before the reset no longer free anything
+	ring.EndFrame(2);
+	ring.RetireFrames(1);
+	CHECK(ring.GetUsedBytes() == 1024);
+	ring.RetireFrames(2);
+	CHECK(ring.GetUsedBytes() == 0);
+}
+
+TEST(OverflowWhileRangesAreOutstanding)
+{
+	// Slices uploaded for draws that haven't been submitted yet, as a frame
+	// recorded on deferred contexts holds them until the lists execute
+	ConstantBufferRingAllocator ring(1024);
+	unsigned int generation = ring.GetGeneration();
+	unsigned int outstanding[4];
+	for (unsigned int i = 0; i < 4; i++)
+		outstanding[i] = ring.Allocate(256);
+	CHECK(outstanding[3] == 768);
+
+	// The next upload overflows, so ConstantBufferRing resets and starts over
+	unsigned int offset = ring.Allocate(256);
+	CHECK(offset == Invalid);
+	ring.Reset();
+	offset = ring.Allocate(256);
+
+	// The new slice lands on one still outstanding, and the generation says so
+	CHECK(offset == outstanding[0]);
+	CHECK(ring.GetGeneration() != generation);
+
+	// Without an overflow the generation holds, so the outstanding slices are still good
+	generation = ring.GetGeneration();
+	ring.Allocate(256);
+	ring.EndFrame(1);
+	ring.RetireFrames(1);
+	ring.Allocate(512);
+	CHECK(ring.GetGeneration() == generation);
+}
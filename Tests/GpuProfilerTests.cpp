@@ -0,0 +1,267 @@
+#include "TestFramework.h"
+#include "GpuProfiler.h"
+
+#include <math.h>
+#include <string.h>
+
+// --------------------------------------------------------
+// Stands in for the GPU - timestamps read a clock the test
+// moves by hand, at a millisecond a tick, and each slot
+// answers however the test says
+// --------------------------------------------------------
+class FakeGpuTimer : public GpuTimerBackend
+{
+public:
+	uint64_t Now;
+	bool Supported;
+	ReadResult Answers[GpuProfiler::FrameLatency];
+	uint64_t Ticks[GpuProfiler::FrameLatency][GpuProfiler::MaxScopes * 2];
+	unsigned int Written[GpuProfiler::FrameLatency];
+
+	FakeGpuTimer() : Now(0), Supported(true), Ticks(), Written()
+	{
+		SetAnswers(Ready);
+	}
+
+	void SetAnswers(ReadResult answer)
+	{
+		for (unsigned int i = 0; i < GpuProfiler::FrameLatency; i++)
+			Answers[i] = answer;
+	}
+
+	bool IsSupported() override { return Supported; }
+	void BeginFrame(unsigned int slot) override { Written[slot] = 0; }
+	void EndFrame(unsigned int) override {}
+
+	void WriteTimestamp(unsigned int slot, unsigned int index) override
+	{
+		Ticks[slot][index] = Now;
+		Written[slot]++;
+	}
+
+	ReadResult ReadFrame(unsigned int slot, unsigned int count, uint64_t* ticks, uint64_t* ticksPerSecond) override
+	{
+		if (Answers[slot] != Ready)
+			return Answers[slot];
+		for (unsigned int i = 0; i < count; i++)
+			ticks[i] = Ticks[slot][i];
+		*ticksPerSecond = 1000;
+		return Ready;
+	}
+};
+
+static const GpuProfiler::ScopeStats* FindScope(GpuProfiler& profiler, const char* name, unsigned int depth)
+{
+	const GpuProfiler::Results& results = profiler.GetResults();
+	for (unsigned int s = 0; s < results.ScopeCount; s++)
+	{
+		if (results.Scopes[s].Depth == depth && strcmp(results.Scopes[s].Name, name) == 0)
+			return &results.Scopes[s];
+	}
+	return 0;
+}
+
+static bool Near(float a, float b)
+{
+	return fabsf(a - b) < 1e-4f;
+}
+
+// A frame of the given length with one scope of its own in the middle
+static void RunFrame(GpuProfiler& profiler, FakeGpuTimer& gpu, const char* scopeName, uint64_t scopeTicks)
+{
+	profiler.BeginFrame();
+	gpu.Now += 1;
+	if (scopeName)
+	{
+		int scope = profiler.BeginScope(scopeName);
+		gpu.Now += scopeTicks;
+		profiler.EndScope(scope);
+	}
+	gpu.Now += 1;
+	profiler.EndFrame();
+}
+
+TEST(NestedScopesKeepTheirDepthsAndTimes)
+{
+	std::shared_ptr<FakeGpuTimer> gpu = std::make_shared<FakeGpuTimer>();
+	GpuProfiler profiler(gpu);
+
+	profiler.BeginFrame();
+	gpu->Now += 1;
+	{
+		GpuProfileScope shadows(profiler, "Shadows");
+		gpu->Now += 2;
+		{
+			GpuProfileScope cascade(profiler, "Cascade");
+			gpu->Now += 3;
+		}
+		gpu->Now += 1;
+	}
+	int opaque = profiler.BeginScope("Opaque");
+	gpu->Now += 4;
+	profiler.EndScope(opaque);
+	profiler.EndFrame();
+
+	// Every scope writes both ends, and the frame resolves as soon as it's ready
+	const GpuProfiler::Results& results = profiler.GetResults();
+	CHECK(gpu->Written[0] == 8);
+	CHECK(results.FramesResolved == 1);
+	CHECK(results.FramesDropped == 0);
+	CHECK(results.ScopeCount == 4);
+
+	// In the order they were opened
+	CHECK(strcmp(results.Scopes[0].Name, "Frame") == 0 && results.Scopes[0].Depth == 0);
+	CHECK(strcmp(results.Scopes[1].Name, "Shadows") == 0 && results.Scopes[1].Depth == 1);
+	CHECK(strcmp(results.Scopes[2].Name, "Cascade") == 0 && results.Scopes[2].Depth == 2);
+	CHECK(strcmp(results.Scopes[3].Name, "Opaque") == 0 && results.Scopes[3].Depth == 1);
+
+	CHECK(Near(results.Scopes[0].Latest, 11.0f));
+	CHECK(Near(results.Scopes[1].Latest, 6.0f));
+	CHECK(Near(results.Scopes[2].Latest, 3.0f));
+	CHECK(Near(results.Scopes[3].Latest, 4.0f));
+}
+
+TEST(RepeatedScopesAddUpByNameAndDepth)
+{
+	std::shared_ptr<FakeGpuTimer> gpu = std::make_shared<FakeGpuTimer>();
+	GpuProfiler profiler(gpu);
+
+	profiler.BeginFrame();
+	for (uint64_t ticks = 1; ticks <= 3; ticks++)
+	{
+		int draw = profiler.BeginScope("Draw");
+		gpu->Now += ticks;
+		profiler.EndScope(draw);
+	}
+
+	// The same name deeper down is a different scope
+	int pass = profiler.BeginScope("Pass");
+	int nested = profiler.BeginScope("Draw");
+	gpu->Now += 5;
+	profiler.EndScope(nested);
+	profiler.EndScope(pass);
+	profiler.EndFrame();
+
+	const GpuProfiler::Results& results = profiler.GetResults();
+	CHECK(results.ScopeCount == 4);
+	CHECK(FindScope(profiler, "Draw", 1) && Near(FindScope(profiler, "Draw", 1)->Latest, 6.0f));
+	CHECK(FindScope(profiler, "Draw", 2) && Near(FindScope(profiler, "Draw", 2)->Latest, 5.0f));
+	CHECK(FindScope(profiler, "Pass", 1) && Near(FindScope(profiler, "Pass", 1)->Latest, 5.0f));
+
+	// Across frames, the history averages and peaks
+	RunFrame(profiler, *gpu, "Draw", 2);
+	const GpuProfiler::ScopeStats* draw = FindScope(profiler, "Draw", 1);
+	CHECK(draw && Near(draw->Latest, 2.0f));
+	CHECK(draw && Near(draw->Average, 4.0f));
+	CHECK(draw && Near(draw->Peak, 6.0f));
+	CHECK(results.HistoryCount == 2);
+}
+
+TEST(ScopesMissingFromFramesExpireWithTheirHistory)
+{
+	std::shared_ptr<FakeGpuTimer> gpu = std::make_shared<FakeGpuTimer>();
+	GpuProfiler profiler(gpu);
+
+	RunFrame(profiler, *gpu, "Bloom", 2);
+	CHECK(FindScope(profiler, "Bloom", 1) != 0);
+
+	// Kept, with zero samples, while its one real sample is in the history
+	for (unsigned int i = 0; i < GpuProfiler::HistoryLength - 1; i++)
+		RunFrame(profiler, *gpu, 0, 0);
+	const GpuProfiler::ScopeStats* bloom = FindScope(profiler, "Bloom", 1);
+	CHECK(bloom && bloom->Latest == 0.0f);
+	CHECK(bloom && Near(bloom->Peak, 2.0f));
+
+	// Listed after the frame's own scopes
+	CHECK(strcmp(profiler.GetResults().Scopes[0].Name, "Frame") == 0);
+
+	// Then gone once it's rolled out
+	RunFrame(profiler, *gpu, 0, 0);
+	CHECK(FindScope(profiler, "Bloom", 1) == 0);
+	CHECK(profiler.GetResults().ScopeCount == 1);
+	CHECK(profiler.GetResults().HistoryCount == GpuProfiler::HistoryLength);
+
+	// And starts afresh if it comes back
+	RunFrame(profiler, *gpu, "Bloom", 3);
+	bloom = FindScope(profiler, "Bloom", 1);
+	CHECK(bloom && Near(bloom->Peak, 3.0f));
+}
+
+TEST(LateFramesWaitAndLostFramesAreDropped)
+{
+	std::shared_ptr<FakeGpuTimer> gpu = std::make_shared<FakeGpuTimer>();
+	GpuProfiler profiler(gpu);
+	const GpuProfiler::Results& results = profiler.GetResults();
+
+	// Nothing back yet - every slot is waiting
+	gpu->SetAnswers(GpuTimerBackend::NotReady);
+	for (unsigned int i = 0; i < GpuProfiler::FrameLatency; i++)
+		RunFrame(profiler, *gpu, "Work", 1);
+	CHECK(results.FramesResolved == 0);
+	CHECK(results.FramesDropped == 0);
+
+	// The ring wraps, so the oldest frame's queries get reused
+	RunFrame(profiler, *gpu, "Work", 1);
+	CHECK(results.FramesResolved == 0);
+	CHECK(results.FramesDropped == 1);
+
+	// Once the GPU catches up, everything still pending resolves - though
+	// the next frame's slot was given up on before anything was read
+	gpu->SetAnswers(GpuTimerBackend::Ready);
+	RunFrame(profiler, *gpu, "Work", 1);
+	CHECK(results.FramesResolved == GpuProfiler::FrameLatency);
+	CHECK(results.FramesDropped == 2);
+
+	// Readback stops at the first frame that isn't done, even if later ones are
+	gpu->Answers[2] = GpuTimerBackend::NotReady;
+	RunFrame(profiler, *gpu, "Work", 1);	// Slot 2
+	RunFrame(profiler, *gpu, "Work", 1);	// Slot 3
+	CHECK(results.FramesResolved == GpuProfiler::FrameLatency);
+	gpu->Answers[2] = GpuTimerBackend::Ready;
+	RunFrame(profiler, *gpu, "Work", 1);	// Slot 0
+	CHECK(results.FramesResolved == GpuProfiler::FrameLatency + 3);
+
+	// Frames that can't be trusted are dropped, not averaged in
+	unsigned int history = results.HistoryCount;
+	gpu->SetAnswers(GpuTimerBackend::Invalid);
+	RunFrame(profiler, *gpu, "Work", 1);
+	CHECK(results.FramesResolved == GpuProfiler::FrameLatency + 3);
+	CHECK(results.FramesDropped == 3);
+	CHECK(results.HistoryCount == history);
+}
+
+TEST(ScopesOutsideFramesOrPastTheLimitAreIgnored)
+{
+	std::shared_ptr<FakeGpuTimer> gpu = std::make_shared<FakeGpuTimer>();
+	GpuProfiler profiler(gpu);
+
+	CHECK(profiler.BeginScope("Outside") == -1);
+	profiler.EndScope(-1);
+	profiler.EndFrame();
+	CHECK(profiler.GetResults().FramesResolved == 0);
+
+	// The frame takes one scope, so MaxScopes - 1 are left
+	profiler.BeginFrame();
+	int last = -1;
+	for (unsigned int i = 0; i < GpuProfiler::MaxScopes - 1; i++)
+		last = profiler.BeginScope("Deep");
+	CHECK(last == (int)GpuProfiler::MaxScopes - 1);
+	CHECK(profiler.BeginScope("TooMany") == -1);
+
+	// Left open - EndFrame() closes them, innermost first
+	gpu->Now += 2;
+	profiler.EndFrame();
+	CHECK(gpu->Written[0] == GpuProfiler::MaxScopes * 2);
+	CHECK(profiler.GetResults().ScopeCount == GpuProfiler::MaxScopes);
+	CHECK(FindScope(profiler, "Deep", GpuProfiler::MaxScopes - 1) != 0);
+	CHECK(FindScope(profiler, "TooMany", GpuProfiler::MaxScopes) == 0);
+
+	// Without timestamp support nothing is recorded at all
+	std::shared_ptr<FakeGpuTimer> unsupported = std::make_shared<FakeGpuTimer>();
+	unsupported->Supported = false;
+	GpuProfiler idle(unsupported);
+	RunFrame(idle, *unsupported, "Work", 1);
+	CHECK(!idle.IsSupported());
+	CHECK(unsupported->Written[0] == 0);
+	CHECK(idle.GetResults().FramesResolved == 0);
+}
@@ -0,0 +1,105 @@
+#include "JobSystem.h"
+#include "BenchmarkTimer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// How the job system scales from one thread to every core
+//
+// - Each workload runs serially first, as the one-thread
+//   baseline, then on job systems of 1 to N - 1 workers
+//   (the calling thread helps, so that's 2 to N threads)
+// - Usage: JobSystemBenchmark [maxThreads]
+// --------------------------------------------------------
+
+// Enough arithmetic per item that the split, not memory, is what's measured
+static float Work(unsigned int i)
+{
+	float x = (float)i;
+	for (int k = 0; k < 32; k++)
+		x = sqrtf(x * 1.0001f + 1.0f) + sinf(x);
+	return x;
+}
+
+struct Workload
+{
+	const char* Name;
+	std::function<void()> Serial;
+	std::function<void(JobSystem&)> Parallel;
+};
+
+int main(int argc, char* argv[])
+{
+	unsigned int maxThreads = std::thread::hardware_concurrency();
+	if (argc > 1)
+		maxThreads = (unsigned int)atoi(argv[1]);
+	if (maxThreads < 1)
+		maxThreads = 1;
+
+	const unsigned int itemCount = 1 << 18;
+	const unsigned int jobCount = 20000;
+	std::vector<float> results(itemCount);
+
+	std::vector<Workload> workloads;
+
+	// One big, even loop - the frame's culling and animation look like this
+	workloads.push_back({ "ParallelFor",
+		[&]() { for (unsigned int i = 0; i < itemCount; i++) results[i] = Work(i); },
+		[&](JobSystem& jobs)
+		{
+			jobs.ParallelFor(0, itemCount, 1024, [&](unsigned int begin, unsigned int end)
+				{
+					for (unsigned int i = begin; i < end; i++)
+						results[i] = Work(i);
+				});
+		} });
+
+	// Many small jobs from the main thread, through the injection queue
+	workloads.push_back({ "Small jobs",
+		[&]() { for (unsigned int i = 0; i < jobCount; i++) results[i] = Work(i); },
+		[&](JobSystem& jobs)
+		{
+			JobCounter counter;
+			for (unsigned int i = 0; i < jobCount; i++)
+				jobs.Run([&results, i]() { results[i] = Work(i); }, &counter);
+			jobs.Wait(&counter);
+		} });
+
+	// Jobs spawning jobs, so workers push to their own deques and steal from each other
+	workloads.push_back({ "Nested ParallelFor",
+		[&]() { for (unsigned int i = 0; i < itemCount; i++) results[i] = Work(i); },
+		[&](JobSystem& jobs)
+		{
+			jobs.ParallelFor(0, 64, 1, [&](unsigned int begin, unsigned int end)
+				{
+					for (unsigned int o = begin; o < end; o++)
+					{
+						unsigned int first = o * (itemCount / 64);
+						jobs.ParallelFor(first, first + itemCount / 64, 256, [&](unsigned int b, unsigned int e)
+							{
+								for (unsigned int i = b; i < e; i++)
+									results[i] = Work(i);
+							});
+					}
+				});
+		} });
+
+	printf("%-20s %8s %12s %8s\n", "Workload", "Threads", "Best (ms)", "Speedup");
+	for (Workload& workload : workloads)
+	{
+		double serial = BenchmarkTimer::Best(5, workload.Serial);
+		printf("%-20s %8u %12.3f %8.2f\n", workload.Name, 1u, serial, 1.0);
+
+		for (unsigned int threads = 2; threads <= maxThreads; threads++)
+		{
+			JobSystem jobs(threads - 1);
+			double ms = BenchmarkTimer::Best(5, [&]() { workload.Parallel(jobs); });
+			printf("%-20s %8u %12.3f %8.2f\n", workload.Name, threads, ms, serial / ms);
+		}
+	}
+	return 0;
+}
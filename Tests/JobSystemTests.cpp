@@ -0,0 +1,147 @@
+#include "TestFramework.h"
+#include "JobSystem.h"
+
+#include <thread>
+
+TEST(EveryQueuedJobRunsOnce)
+{
+	JobSystem jobs(4);
+	const unsigned int jobCount = 100000;
+	std::vector<std::atomic<unsigned int>> runs(jobCount);
+	for (auto& r : runs)
+		r.store(0);
+
+	JobCounter counter;
+	for (unsigned int i = 0; i < jobCount; i++)
+		jobs.Run([&runs, i]() { runs[i].fetch_add(1); }, &counter);
+	jobs.Wait(&counter);
+
+	unsigned int wrong = 0;
+	for (auto& r : runs)
+		wrong += r.load() != 1;
+	CHECK(wrong == 0);
+	CHECK(counter.IsDone());
+}
+
+TEST(NestedParallelForsCoverEveryIndexOnce)
+{
+	// Workers push, pop and steal from each other's deques all at once
+	JobSystem jobs(4);
+	const unsigned int outer = 64;
+	const unsigned int inner = 2000;
+	std::vector<std::atomic<unsigned int>> runs(outer * inner);
+	for (auto& r : runs)
+		r.store(0);
+
+	for (int pass = 0; pass < 10; pass++)
+	{
+		jobs.ParallelFor(0, outer, 1, [&](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int o = begin; o < end; o++)
+				{
+					jobs.ParallelFor(0, inner, 16, [&, o](unsigned int b, unsigned int e)
+						{
+							for (unsigned int i = b; i < e; i++)
+								runs[o * inner + i].fetch_add(1);
+						});
+				}
+			});
+	}
+
+	unsigned int wrong = 0;
+	for (auto& r : runs)
+		wrong += r.load() != 10;
+	CHECK(wrong == 0);
+}
+
+TEST(JobsSpawnedPastAFullDequeStillRun)
+{
+	// More jobs than a worker's deque holds, pushed from inside a job
+	JobSystem jobs(2);
+	std::atomic<unsigned int> runs(0);
+	JobCounter counter;
+	jobs.Run([&]()
+		{
+			for (unsigned int i = 0; i < 20000; i++)
+				jobs.Run([&]() { runs.fetch_add(1); }, &counter);
+		}, &counter);
+	jobs.Wait(&counter);
+	CHECK(runs.load() == 20000);
+}
+
+TEST(FrameWaitsNeverRunBackgroundJobs)
+{
+	JobSystem jobs(2);
+	std::thread::id mainThread = std::this_thread::get_id();
+	std::atomic<bool> inParallelFor(false);
+	std::atomic<unsigned int> ranDuringParallelFor(0);
+	std::atomic<unsigned int> backgroundRuns(0);
+
+	JobCounter loads;
+	for (unsigned int i = 0; i < 200; i++)
+	{
+		jobs.RunBackground([&]()
+			{
+				if (std::this_thread::get_id() == mainThread && inParallelFor.load())
+					ranDuringParallelFor.fetch_add(1);
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+				backgroundRuns.fetch_add(1);
+			}, &loads);
+	}
+
+	std::atomic<unsigned int> sum(0);
+	inParallelFor.store(true);
+	for (int pass = 0; pass < 50; pass++)
+		jobs.ParallelFor(0, 1000, 10, [&](unsigned int begin, unsigned int end) { sum.fetch_add(end - begin); });
+	inParallelFor.store(false);
+
+	// Waiting on the loads themselves may help with them
+	jobs.Wait(&loads);
+	CHECK(ranDuringParallelFor.load() == 0);
+	CHECK(backgroundRuns.load() == 200);
+	CHECK(sum.load() == 50000);
+}
+
+TEST(WaitHelpsOnlyWithItsOwnBackgroundJobs)
+{
+	// One worker, kept busy, so only the waiting thread can run anything
+	JobSystem jobs(1);
+	std::atomic<bool> started(false);
+	std::atomic<bool> release(false);
+	JobCounter blocker;
+	jobs.RunBackground([&]()
+		{
+			started.store(true);
+			while (!release.load())
+				std::this_thread::yield();
+		}, &blocker);
+	while (!started.load())
+		std::this_thread::yield();
+
+	std::atomic<bool> otherRan(false);
+	std::atomic<bool> mineRan(false);
+	JobCounter other;
+	JobCounter mine;
+	jobs.RunBackground([&]() { otherRan.store(true); }, &other);
+	jobs.RunBackground([&]() { mineRan.store(true); }, &mine);
+
+	jobs.Wait(&mine);
+	CHECK(mineRan.load());
+	CHECK(!otherRan.load());
+
+	release.store(true);
+	jobs.Wait(&other);
+	jobs.Wait(&blocker);
+	CHECK(otherRan.load());
+}
+
+TEST(DestructorFinishesBackgroundJobs)
+{
+	std::atomic<unsigned int> runs(0);
+	{
+		JobSystem jobs(1);
+		for (unsigned int i = 0; i < 100; i++)
+			jobs.RunBackground([&]() { runs.fetch_add(1); });
+	}
+	CHECK(runs.load() == 100);
+}
@@ -0,0 +1,69 @@
+#include "TestFramework.h"
+#include "NullRenderDevice.h"
+
+static std::shared_ptr<RenderBuffer> MakeBuffer(NullRenderDevice& device, RenderBufferDesc::Kind kind, unsigned int byteWidth)
+{
+	RenderBufferDesc desc = {};
+	desc.Type = kind;
+	desc.Access = RenderBufferDesc::Default;
+	desc.ByteWidth = byteWidth;
+	desc.Stride = 16;
+	return device.CreateBuffer(desc, 0);
+}
+
+TEST(ResourcesAndBytesAreCounted)
+{
+	NullRenderDevice device;
+	MakeBuffer(device, RenderBufferDesc::VertexBuffer, 256);
+	MakeBuffer(device, RenderBufferDesc::IndexBuffer, 64);
+
+	NullRenderDevice::Stats stats = device.GetStats();
+	CHECK(stats.Buffers == 2);
+	CHECK(stats.BufferBytes == 320);
+}
+
+TEST(RepeatedBindsCountAsRedundant)
+{
+	NullRenderDevice device;
+	NullRenderContext* context = device.GetImmediateContext();
+	std::shared_ptr<RenderBuffer> a = MakeBuffer(device, RenderBufferDesc::VertexBuffer, 256);
+	std::shared_ptr<RenderBuffer> b = MakeBuffer(device, RenderBufferDesc::VertexBuffer, 256);
+
+	context->BeginFrame();
+	context->SetVertexBuffer(a.get(), 16, 0);
+	context->SetVertexBuffer(a.get(), 16, 0);
+	context->SetVertexBuffer(a.get(), 16, 32);
+	context->SetVertexBuffer(b.get(), 16, 32);
+
+	NullRenderContext::Stats stats = context->GetFrameStats();
+	CHECK(stats.Binds == 4);
+	CHECK(stats.RedundantBinds == 1);
+
+	// Invalidating makes the next bind a change even if it matches
+	context->Invalidate();
+	context->SetVertexBuffer(b.get(), 16, 32);
+	CHECK(context->GetFrameStats().RedundantBinds == 1);
+}
+
+TEST(DrawsAndUploadsMoveToLastFrame)
+{
+	NullRenderDevice device;
+	NullRenderContext* context = device.GetImmediateContext();
+	std::shared_ptr<RenderBuffer> buffer = MakeBuffer(device, RenderBufferDesc::ConstantBuffer, 64);
+	unsigned char data[128] = {};
+
+	context->BeginFrame();
+	context->DrawIndexed(36, 0, 0);
+	context->DrawIndexedIndirect(buffer.get(), 0);
+	context->Dispatch(8, 8, 1);
+	context->UpdateBuffer(buffer.get(), data, sizeof(data));	// Clamped to the buffer's size
+	context->BeginFrame();
+
+	NullRenderContext::Stats last = context->GetLastFrameStats();
+	CHECK(last.Draws == 2);
+	CHECK(last.IndirectDraws == 1);
+	CHECK(last.Dispatches == 1);
+	CHECK(last.Indices == 36);
+	CHECK(last.BytesUploaded == 64);
+	CHECK(context->GetFrameStats().Draws == 0);
+}
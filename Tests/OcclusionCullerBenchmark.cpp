@@ -0,0 +1,152 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include "BenchmarkTimer.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Times the software occlusion culler on a dense scene: a
+// city block grid of buildings as occluders, seen from
+// street level, and thousands of boxes among them to test
+//
+// - Rasterizing (triangle setup and drawing) and building
+//   the Hi-Z chain are reported apart, serially and across
+//   the job system
+// - Usage: OcclusionCullerBenchmark [width height]
+// --------------------------------------------------------
+
+static float Random(float low, float high)
+{
+	return low + (high - low) * (float)rand() / RAND_MAX;
+}
+
+// out = a * b, for row-major 4x4 matrices
+static void Multiply(const float a[16], const float b[16], float out[16])
+{
+	for (int row = 0; row < 4; row++)
+	{
+		for (int col = 0; col < 4; col++)
+		{
+			out[row * 4 + col] = 0.0f;
+			for (int k = 0; k < 4; k++)
+				out[row * 4 + col] += a[row * 4 + k] * b[k * 4 + col];
+		}
+	}
+}
+
+static void Translation(float x, float y, float z, float out[16])
+{
+	float m[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, x, y, z, 1 };
+	memcpy(out, m, sizeof(m));
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int width = 256;
+	unsigned int height = 128;
+	if (argc > 2)
+	{
+		width = (unsigned int)atoi(argv[1]);
+		height = (unsigned int)atoi(argv[2]);
+	}
+
+	// A unit cube, wound clockwise from outside - every building is one, scaled
+	const float cube[24] =
+	{
+		-1, -1, -1,  -1, 1, -1,  1, 1, -1,  1, -1, -1,
+		-1, -1, 1,   -1, 1, 1,   1, 1, 1,   1, -1, 1
+	};
+	const unsigned int cubeIndices[36] =
+	{
+		0, 1, 2, 0, 2, 3,	// -Z
+		7, 6, 5, 7, 5, 4,	// +Z
+		4, 5, 1, 4, 1, 0,	// -X
+		3, 2, 6, 3, 6, 7,	// +X
+		1, 5, 6, 1, 6, 2,	// +Y
+		4, 0, 3, 4, 3, 7	// -Y
+	};
+
+	// Camera at street level, looking down the grid - a left-handed perspective projection
+	const float nearZ = 0.1f;
+	const float farZ = 500.0f;
+	const float q = farZ / (farZ - nearZ);
+	float projection[16] =
+	{
+		1.0f / (16.0f / 9.0f), 0, 0, 0,
+		0, 1, 0, 0,
+		0, 0, q, 1,
+		0, 0, -nearZ * q, 0
+	};
+	float view[16];
+	Translation(0.0f, -2.0f, 5.0f, view);
+	float viewProjection[16];
+	Multiply(view, projection, viewProjection);
+
+	// 32 x 32 buildings, streets between them
+	srand(1);
+	std::vector<float> buildingWorlds;
+	for (int z = 0; z < 32; z++)
+	{
+		for (int x = -16; x < 16; x++)
+		{
+			float size = Random(2.0f, 4.0f);
+			float tall = Random(4.0f, 30.0f);
+			float world[16] = { size, 0, 0, 0, 0, tall, 0, 0, 0, 0, size, 0, x * 12.0f + 6.0f, tall, z * 12.0f + 6.0f, 1 };
+			buildingWorlds.insert(buildingWorlds.end(), world, world + 16);
+		}
+	}
+	unsigned int buildingCount = (unsigned int)buildingWorlds.size() / 16;
+
+	// Things in the streets and behind the buildings
+	const unsigned int boxCount = 20000;
+	std::vector<float> boxWorlds(boxCount * 16);
+	for (unsigned int i = 0; i < boxCount; i++)
+		Translation(Random(-190.0f, 190.0f), Random(0.5f, 3.0f), Random(1.0f, 380.0f), &boxWorlds[i * 16]);
+	const float boxMin[3] = { -0.5f, -0.5f, -0.5f };
+	const float boxMax[3] = { 0.5f, 0.5f, 0.5f };
+
+	OcclusionCuller culler(width, height);
+	JobSystem jobs;
+	auto addOccluders = [&]()
+	{
+		culler.BeginFrame(viewProjection);
+		for (unsigned int b = 0; b < buildingCount; b++)
+			culler.AddOccluder(cube, 8, cubeIndices, 36, &buildingWorlds[b * 16]);
+	};
+
+	printf("%ux%u, %u occluders (%u triangles), %u boxes, %u workers\n",
+		width, height, buildingCount, buildingCount * 12, boxCount, jobs.GetWorkerCount());
+	printf("%-10s %16s %14s %18s\n", "", "Rasterize (ms)", "Hi-Z (ms)", "Total (ms)");
+
+	for (int parallel = 0; parallel < 2; parallel++)
+	{
+		// Best of each part, over the same runs
+		double bestRasterize = 0.0;
+		double bestHiZ = 0.0;
+		double total = BenchmarkTimer::Best(20, [&]()
+			{
+				addOccluders();
+				culler.Rasterize(parallel ? &jobs : 0);
+				if (bestRasterize == 0.0 || culler.GetRasterizeTime() < bestRasterize)
+					bestRasterize = culler.GetRasterizeTime();
+				if (bestHiZ == 0.0 || culler.GetHiZTime() < bestHiZ)
+					bestHiZ = culler.GetHiZTime();
+			});
+		printf("%-10s %16.3f %14.3f %18.3f\n", parallel ? "Jobs" : "Serial", bestRasterize, bestHiZ, total);
+	}
+
+	unsigned int visible = 0;
+	double testing = BenchmarkTimer::Best(20, [&]()
+		{
+			visible = 0;
+			for (unsigned int i = 0; i < boxCount; i++)
+				visible += culler.IsVisible(boxMin, boxMax, &boxWorlds[i * 16]);
+		});
+	printf("Testing %u boxes: %.3f ms (%.1f ns each), %u visible, %u triangles rasterized\n",
+		boxCount, testing, testing * 1e6 / boxCount, visible, culler.GetTrianglesRasterized());
+	return 0;
+}
@@ -0,0 +1,311 @@
+#include "TestFramework.h"
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static const float NearZ = 0.5f;
+static const float FarZ = 100.0f;
+static const float XScale = 1.0f;
+static const float YScale = 2.0f;
+
+static const float Identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+static float Random(float low, float high)
+{
+	return low + (high - low) * (float)rand() / RAND_MAX;
+}
+
+// A left-handed perspective projection, row-major for row vectors, with the camera at the origin
+static void GetViewProjection(float out[16])
+{
+	float q = FarZ / (FarZ - NearZ);
+	float m[16] =
+	{
+		XScale, 0, 0, 0,
+		0, YScale, 0, 0,
+		0, 0, q, 1,
+		0, 0, -NearZ * q, 0
+	};
+	memcpy(out, m, sizeof(m));
+}
+
+static void GetTranslation(const float offset[3], float out[16])
+{
+	memcpy(out, Identity, sizeof(Identity));
+	out[12] = offset[0];
+	out[13] = offset[1];
+	out[14] = offset[2];
+}
+
+// A rectangle facing the camera at one depth - drawn with both windings,
+// so exactly one of each pair survives back face culling
+struct Quad
+{
+	float Min[2];
+	float Max[2];
+	float Z;
+	float Positions[12];
+};
+
+static const unsigned int QuadIndices[12] = { 0, 1, 2, 0, 2, 3, 0, 2, 1, 0, 3, 2 };
+
+static void MakeQuad(Quad& quad, float minX, float minY, float maxX, float maxY, float z)
+{
+	quad.Min[0] = minX;
+	quad.Min[1] = minY;
+	quad.Max[0] = maxX;
+	quad.Max[1] = maxY;
+	quad.Z = z;
+	float positions[12] = { minX, minY, z, minX, maxY, z, maxX, maxY, z, maxX, minY, z };
+	memcpy(quad.Positions, positions, sizeof(positions));
+}
+
+// Where a ray from the camera first enters a box, in view z - or a negative value for a miss
+static float EnterBox(float dx, float dy, const float boxMin[3], const float boxMax[3])
+{
+	float direction[3] = { dx, dy, 1.0f };
+	float enter = 0.0f;
+	float exit = 1e30f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (fabsf(direction[axis]) < 1e-12f)
+		{
+			if (boxMin[axis] > 0.0f || boxMax[axis] < 0.0f)
+				return -1.0f;
+			continue;
+		}
+		float t0 = boxMin[axis] / direction[axis];
+		float t1 = boxMax[axis] / direction[axis];
+		if (t0 > t1)
+		{
+			float t = t0;
+			t0 = t1;
+			t1 = t;
+		}
+		enter = fmaxf(enter, t0);
+		exit = fminf(exit, t1);
+	}
+	return enter <= exit ? enter : -1.0f;
+}
+
+// Can the camera see any part of the box through a pixel center, past every quad?
+// Quads are grown a little, so a pixel on a quad's edge never counts as a clear view
+static bool IsVisibleByRayCasting(OcclusionCuller& culler, const std::vector<Quad>& quads, const float boxMin[3], const float boxMax[3])
+{
+	unsigned int width = culler.GetWidth();
+	unsigned int height = culler.GetHeight();
+	for (unsigned int py = 0; py < height; py++)
+	{
+		for (unsigned int px = 0; px < width; px++)
+		{
+			float dx = (((px + 0.5f) / width) * 2.0f - 1.0f) / XScale;
+			float dy = (1.0f - ((py + 0.5f) / height) * 2.0f) / YScale;
+			float z = EnterBox(dx, dy, boxMin, boxMax);
+			if (z < NearZ || z > FarZ)
+				continue;
+
+			bool hidden = false;
+			for (const Quad& quad : quads)
+			{
+				const float margin = 0.02f;
+				float x = dx * quad.Z;
+				float y = dy * quad.Z;
+				if (quad.Z <= z + margin &&
+					x >= quad.Min[0] - margin && x <= quad.Max[0] + margin &&
+					y >= quad.Min[1] - margin && y <= quad.Max[1] + margin)
+				{
+					hidden = true;
+					break;
+				}
+			}
+			if (!hidden)
+				return true;
+		}
+	}
+	return false;
+}
+
+static void AddRandomQuads(OcclusionCuller& culler, std::vector<Quad>& quads, unsigned int count)
+{
+	quads.resize(count);
+	for (Quad& quad : quads)
+	{
+		float z = Random(4.0f, 40.0f);
+		float x = Random(-0.8f, 0.8f) * z;
+		float y = Random(-0.4f, 0.4f) * z;
+		float halfWidth = Random(0.1f, 0.5f) * z;
+		float halfHeight = Random(0.05f, 0.3f) * z;
+		MakeQuad(quad, x - halfWidth, y - halfHeight, x + halfWidth, y + halfHeight, z);
+		culler.AddOccluder(quad.Positions, 4, QuadIndices, 12, Identity);
+	}
+}
+
+TEST(NeverCullsABoxThatRayCastingCanSee)
+{
+	srand(3);
+	float viewProjection[16];
+	GetViewProjection(viewProjection);
+
+	unsigned int culled = 0;
+	unsigned int falseCulls = 0;
+	for (int round = 0; round < 4; round++)
+	{
+		OcclusionCuller culler(64, 32);
+		culler.BeginFrame(viewProjection);
+		std::vector<Quad> quads;
+		AddRandomQuads(culler, quads, 12);
+		culler.Rasterize(0);
+
+		for (int i = 0; i < 150; i++)
+		{
+			// Boxes in object space, placed by their world matrix
+			float size[3] = { Random(0.1f, 3.0f), Random(0.1f, 3.0f), Random(0.1f, 3.0f) };
+			float boxMin[3] = { -size[0], -size[1], -size[2] };
+			float boxMax[3] = { size[0], size[1], size[2] };
+			float z = Random(4.0f, 60.0f);
+			float offset[3] = { Random(-1.0f, 1.0f) * z, Random(-0.5f, 0.5f) * z, z };
+			float world[16];
+			GetTranslation(offset, world);
+
+			if (culler.IsVisible(boxMin, boxMax, world))
+				continue;
+			culled++;
+
+			float worldMin[3], worldMax[3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				worldMin[axis] = boxMin[axis] + offset[axis];
+				worldMax[axis] = boxMax[axis] + offset[axis];
+			}
+			if (IsVisibleByRayCasting(culler, quads, worldMin, worldMax))
+				falseCulls++;
+		}
+	}
+	CHECK(falseCulls == 0);
+
+	// Otherwise the test proves nothing
+	CHECK(culled > 0);
+}
+
+TEST(BoxBehindAWallIsCulledAndInFrontIsNot)
+{
+	float viewProjection[16];
+	GetViewProjection(viewProjection);
+
+	OcclusionCuller culler(64, 32);
+	culler.BeginFrame(viewProjection);
+	Quad wall;
+	MakeQuad(wall, -100.0f, -100.0f, 100.0f, 100.0f, 10.0f);
+	culler.AddOccluder(wall.Positions, 4, QuadIndices, 12, Identity);
+	culler.Rasterize(0);
+	CHECK(culler.GetTrianglesRasterized() == 2);
+
+	float boxMin[3] = { -1.0f, -1.0f, -1.0f };
+	float boxMax[3] = { 1.0f, 1.0f, 1.0f };
+	float world[16];
+
+	float behind[3] = { 0.0f, 0.0f, 20.0f };
+	GetTranslation(behind, world);
+	CHECK(!culler.IsVisible(boxMin, boxMax, world));
+
+	float inFront[3] = { 0.0f, 0.0f, 5.0f };
+	GetTranslation(inFront, world);
+	CHECK(culler.IsVisible(boxMin, boxMax, world));
+
+	// Poking through the wall
+	float through[3] = { 0.0f, 0.0f, 10.5f };
+	GetTranslation(through, world);
+	CHECK(culler.IsVisible(boxMin, boxMax, world));
+
+	// Crossing the near plane is always visible
+	float crossing[3] = { 0.0f, 0.0f, 0.0f };
+	GetTranslation(crossing, world);
+	CHECK(culler.IsVisible(boxMin, boxMax, world));
+}
+
+TEST(ParallelRasterizingMatchesSerial)
+{
+	srand(5);
+	float viewProjection[16];
+	GetViewProjection(viewProjection);
+
+	// Random triangles, some crossing bands, the near plane and the buffer's edges
+	std::vector<float> positions(3 * 3 * 400);
+	std::vector<unsigned int> indices(3 * 400);
+	for (size_t i = 0; i < positions.size(); i += 3)
+	{
+		float z = Random(-1.0f, 50.0f);
+		positions[i + 0] = Random(-1.2f, 1.2f) * fabsf(z);
+		positions[i + 1] = Random(-0.7f, 0.7f) * fabsf(z);
+		positions[i + 2] = z;
+	}
+	for (unsigned int i = 0; i < indices.size(); i++)
+		indices[i] = i;
+
+	OcclusionCuller serial(256, 128);
+	OcclusionCuller parallel(256, 128);
+	JobSystem jobs(3);
+	for (OcclusionCuller* culler : { &serial, &parallel })
+	{
+		culler->BeginFrame(viewProjection);
+		for (unsigned int i = 0; i < 400; i += 50)
+			culler->AddOccluder(positions.data(), 3 * 400, indices.data() + i * 3, 50 * 3, Identity);
+	}
+	serial.Rasterize(0);
+	parallel.Rasterize(&jobs);
+
+	CHECK(serial.GetTrianglesRasterized() > 0);
+	CHECK(serial.GetTrianglesRasterized() == parallel.GetTrianglesRasterized());
+	CHECK(memcmp(serial.GetDepth(), parallel.GetDepth(), 256 * 128 * sizeof(float)) == 0);
+
+	bool mipsMatch = true;
+	for (unsigned int mip = 0; mip < serial.GetMipCount(); mip++)
+	{
+		size_t bytes = serial.GetMipWidth(mip) * serial.GetMipHeight(mip) * sizeof(float);
+		if (memcmp(serial.GetMip(mip), parallel.GetMip(mip), bytes) != 0)
+			mipsMatch = false;
+	}
+	CHECK(mipsMatch);
+
+	// Something was actually drawn
+	unsigned int written = 0;
+	for (unsigned int i = 0; i < 256 * 128; i++)
+		written += serial.GetDepth()[i] < 1.0f;
+	CHECK(written > 0);
+}
+
+TEST(HiZKeepsTheFarthestDepth)
+{
+	srand(9);
+	float viewProjection[16];
+	GetViewProjection(viewProjection);
+
+	OcclusionCuller culler(100, 37);
+	culler.BeginFrame(viewProjection);
+	std::vector<Quad> quads;
+	AddRandomQuads(culler, quads, 20);
+	culler.Rasterize(0);
+
+	// Every texel is at least as far as everything it covers in mip 0
+	unsigned int nearer = 0;
+	const float* depth = culler.GetDepth();
+	for (unsigned int mip = 1; mip < culler.GetMipCount(); mip++)
+	{
+		const float* texels = culler.GetMip(mip);
+		for (unsigned int y = 0; y < culler.GetHeight(); y++)
+		{
+			for (unsigned int x = 0; x < culler.GetWidth(); x++)
+			{
+				if (texels[(y >> mip) * culler.GetMipWidth(mip) + (x >> mip)] < depth[y * culler.GetWidth() + x])
+					nearer++;
+			}
+		}
+	}
+	CHECK(nearer == 0);
+	CHECK(culler.GetMipWidth(culler.GetMipCount() - 1) == 1);
+	CHECK(culler.GetMipHeight(culler.GetMipCount() - 1) == 1);
+}
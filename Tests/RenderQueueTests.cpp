@@ -0,0 +1,103 @@
+#include "TestFramework.h"
+#include "RenderQueue.h"
+
+#include <stdlib.h>
+
+TEST(KeysSortByPipelineThenMaterialThenMesh)
+{
+	CHECK(RenderQueue::MakeSortKey(1, 0, 0) > RenderQueue::MakeSortKey(0, 0xFFFF, 0xFFFF));
+	CHECK(RenderQueue::MakeSortKey(0, 1, 0) > RenderQueue::MakeSortKey(0, 0, 0xFFFF));
+	CHECK(RenderQueue::MakeSortKey(0, 0, 1) > RenderQueue::MakeSortKey(0, 0, 0));
+
+	// Ids past 16 bits are masked rather than spilling into the next field
+	CHECK(RenderQueue::MakeSortKey(0, 0, 0x10001) == RenderQueue::MakeSortKey(0, 0, 1));
+}
+
+TEST(SortIsByKeyThenIndex)
+{
+	RenderQueue queue;
+	srand(42);
+	for (unsigned int i = 0; i < 1000; i++)
+		queue.Add(RenderQueue::MakeSortKey(rand() % 3, rand() % 5, rand() % 7), 999 - i);
+	queue.Sort();
+
+	CHECK(queue.GetCount() == 1000);
+	unsigned int outOfOrder = 0;
+	for (unsigned int i = 1; i < queue.GetCount(); i++)
+	{
+		const RenderQueue::Item& a = queue[i - 1];
+		const RenderQueue::Item& b = queue[i];
+		if (a.SortKey > b.SortKey || (a.SortKey == b.SortKey && a.Index >= b.Index))
+			outOfOrder++;
+	}
+	CHECK(outOfOrder == 0);
+}
+
+TEST(SortedOrderDoesntDependOnInsertionOrder)
+{
+	RenderQueue forward;
+	RenderQueue backward;
+	for (unsigned int i = 0; i < 100; i++)
+	{
+		forward.Add(RenderQueue::MakeSortKey(i % 2, i % 3, 0), i);
+		backward.Add(RenderQueue::MakeSortKey((99 - i) % 2, (99 - i) % 3, 0), 99 - i);
+	}
+	forward.Sort();
+	backward.Sort();
+
+	unsigned int different = 0;
+	for (unsigned int i = 0; i < 100; i++)
+		different += forward[i].Index != backward[i].Index;
+	CHECK(different == 0);
+}
+
+TEST(PartitionCoversTheQueueInOrder)
+{
+	RenderQueue queue;
+	for (unsigned int count = 0; count < 50; count++)
+	{
+		queue.Clear();
+		for (unsigned int i = 0; i < count; i++)
+			queue.Add(0, i);
+
+		for (unsigned int maxChunks = 1; maxChunks <= 8; maxChunks++)
+		{
+			for (unsigned int minItems = 0; minItems <= 6; minItems++)
+			{
+				std::vector<RenderQueueChunk> chunks;
+				queue.Partition(maxChunks, minItems, chunks);
+
+				CHECK(chunks.size() <= maxChunks);
+				CHECK((count == 0) == chunks.empty());
+
+				// Contiguous, in order, and near equal
+				unsigned int next = 0;
+				unsigned int smallest = count;
+				unsigned int largest = 0;
+				for (const RenderQueueChunk& chunk : chunks)
+				{
+					CHECK(chunk.First == next);
+					next += chunk.Count;
+					smallest = chunk.Count < smallest ? chunk.Count : smallest;
+					largest = chunk.Count > largest ? chunk.Count : largest;
+				}
+				CHECK(next == count);
+				if (!chunks.empty())
+				{
+					CHECK(largest - smallest <= 1);
+					if (chunks.size() > 1)
+						CHECK(smallest >= minItems);
+				}
+			}
+		}
+	}
+}
+
+TEST(PartitionWithNoChunksIsEmpty)
+{
+	RenderQueue queue;
+	queue.Add(0, 0);
+	std::vector<RenderQueueChunk> chunks(3);
+	queue.Partition(0, 1, chunks);
+	CHECK(chunks.empty());
+}
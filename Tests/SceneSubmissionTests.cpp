@@ -0,0 +1,233 @@
+#include "TestFramework.h"
+#include "DemoScene.h"
+#include "NullRenderDevice.h"
+#include "RenderQueue.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// The game's demo scene, built on the null backend with
+// stand-in shaders laid out like the real ones
+// --------------------------------------------------------
+struct NullDemoScene
+{
+	std::shared_ptr<NullRenderDevice> Device;
+	std::shared_ptr<JobSystem> Jobs;
+	std::shared_ptr<TextureManager> Textures;
+	std::shared_ptr<SamplerManager> Samplers;
+	std::shared_ptr<DemoScene> Scene;
+
+	NullDemoScene()
+	{
+		Device = std::make_shared<NullRenderDevice>();
+		Jobs = std::make_shared<JobSystem>(2);
+		Textures = std::make_shared<TextureManager>(Device, Jobs);
+		Samplers = std::make_shared<SamplerManager>(Device);
+
+		NullRenderContext* context = Device->GetImmediateContext();
+		DemoScene::Shaders shaders;
+		shaders.VS = std::make_shared<NullRenderShader>(context,
+			std::vector<NullRenderShader::Variable>{ { "world", 64 }, { "worldInvTrans", 64 }, { "view", 64 }, { "projection", 64 } },
+			std::vector<std::string>(),
+			std::vector<std::string>());
+		shaders.PS = std::make_shared<NullRenderShader>(context,
+			std::vector<NullRenderShader::Variable>{ { "colorTint", 16 }, { "cameraPosition", 12 }, { "totalTime", 4 } },
+			std::vector<std::string>{ "AlbedoMap", "NormalMap", "RoughnessMap", "MetalnessMap" },
+			std::vector<std::string>{ "BasicSampler" });
+		shaders.SkyVS = std::make_shared<NullRenderShader>(context,
+			std::vector<NullRenderShader::Variable>{ { "view", 64 }, { "projection", 64 } },
+			std::vector<std::string>(),
+			std::vector<std::string>());
+		shaders.SkyPS = std::make_shared<NullRenderShader>(context,
+			std::vector<NullRenderShader::Variable>(),
+			std::vector<std::string>{ "SkyCube" },
+			std::vector<std::string>{ "SkySampler" });
+		Scene = std::make_shared<DemoScene>(Device, Jobs, Textures, Samplers, shaders, ASSET_FOLDER);
+
+		// Draw with the real textures, as benchmarks do
+		Textures->WaitForLoads();
+		Textures->CreatePendingTextures();
+	}
+
+	// The game's starting camera, and every renderable as it stands
+	void CaptureFrame(FrameCamera& camera, std::vector<FrameDrawItem>& items)
+	{
+		camera.Position = XMFLOAT3(0.0f, 2.5f, -15.0f);
+		XMStoreFloat4x4(&camera.View, XMMatrixLookToLH(XMLoadFloat3(&camera.Position), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)));
+		XMStoreFloat4x4(&camera.Projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.01f, 100.0f));
+
+		const std::vector<std::shared_ptr<Renderable>>& renderables = Scene->GetRenderables();
+		items.resize(renderables.size());
+		for (unsigned int i = 0; i < renderables.size(); i++)
+		{
+			items[i].RenderableIndex = i;
+			items[i].World = renderables[i]->GetTransform()->GetWorldMatrix();
+			items[i].WorldInvTrans = renderables[i]->GetTransform()->GetWorldInverseTransposeMatrix();
+			items[i].DynamicCaster = false;
+		}
+	}
+
+	// Sorted, then drawn one at a time, then the sky - as Game::DrawFrame() does serially
+	void Sort(const std::vector<FrameDrawItem>& items, RenderQueue& queue)
+	{
+		queue.Clear();
+		for (unsigned int i = 0; i < items.size(); i++)
+			queue.Add(Scene->GetSortKeys()[items[i].RenderableIndex], i);
+		queue.Sort();
+	}
+
+	void Draw(RenderContext* context, const FrameCamera& camera, const std::vector<FrameDrawItem>& items)
+	{
+		RenderQueue queue;
+		Sort(items, queue);
+		for (unsigned int i = 0; i < queue.GetCount(); i++)
+		{
+			const FrameDrawItem& item = items[queue[i].Index];
+			Scene->GetRenderables()[item.RenderableIndex]->Draw(context, camera, item, 1.0f);
+		}
+		Scene->GetSky()->Draw(context, camera.View, camera.Projection);
+	}
+};
+
+TEST(DemoSceneIsBuiltAsTheGameExpects)
+{
+	NullDemoScene scene;
+	const std::vector<std::shared_ptr<Renderable>>& renderables = scene.Scene->GetRenderables();
+	CHECK(scene.Scene->GetMeshes().size() == 7);
+	CHECK(renderables.size() == 7);
+
+	// Every OBJ loaded, with its triangles kept for occlusion culling
+	for (const std::shared_ptr<Mesh>& mesh : scene.Scene->GetMeshes())
+	{
+		CHECK(mesh->GetIndexCount() > 0);
+		CHECK(mesh->GetIndexCount() % 3 == 0);
+		CHECK(mesh->GetPositions().size() == mesh->GetIndices().size());
+	}
+
+	// The cube is two units across, centered on its origin
+	const BoundingBox& cube = scene.Scene->GetMeshes()[0]->GetBounds();
+	CHECK(fabsf(cube.Center.x) < 1e-5f && fabsf(cube.Center.y) < 1e-5f && fabsf(cube.Center.z) < 1e-5f);
+	CHECK(fabsf(cube.Extents.x - 1) < 1e-5f && fabsf(cube.Extents.y - 1) < 1e-5f && fabsf(cube.Extents.z - 1) < 1e-5f);
+
+	// Lined up along x, with the four simple shapes occluding
+	unsigned int occluders = 0;
+	for (unsigned int i = 0; i < renderables.size(); i++)
+	{
+		CHECK(renderables[i]->GetTransform()->GetPosition().x == -9.0f + 3.0f * i);
+		occluders += renderables[i]->IsOccluder() ? 1 : 0;
+	}
+	CHECK(occluders == 4);
+
+	// No two renderables share both a mesh and a material
+	CHECK(scene.Scene->GetBucketRenderables().size() == 7);
+
+	// Sorting groups the two materials: the first material's four, then the second's three
+	FrameCamera camera;
+	std::vector<FrameDrawItem> items;
+	scene.CaptureFrame(camera, items);
+	RenderQueue queue;
+	scene.Sort(items, queue);
+	const unsigned int sorted[] = { 0, 2, 4, 6, 1, 3, 5 };
+	for (unsigned int i = 0; i < 7; i++)
+		CHECK(queue[i].Index == sorted[i]);
+
+	// Every texture file that exists replaced its stand-in (one normal map is missing)
+	TextureManager::Stats stats = scene.Textures->GetStats();
+	CHECK(stats.Failures == 1);
+}
+
+TEST(SubmittingTheSceneCountsDrawsAndBinds)
+{
+	NullDemoScene scene;
+	NullRenderContext* context = scene.Device->GetImmediateContext();
+	FrameCamera camera;
+	std::vector<FrameDrawItem> items;
+	scene.CaptureFrame(camera, items);
+
+	uint64_t sceneIndices = 0;
+	for (const std::shared_ptr<Renderable>& r : scene.Scene->GetRenderables())
+		sceneIndices += r->GetMesh()->GetIndexCount();
+	sceneIndices += scene.Scene->GetMeshes()[0]->GetIndexCount(); // The sky's cube
+
+	// First frame, with nothing bound yet
+	// - The first renderable binds 8 things: both shaders and their
+	//   constants, textures, samplers, vertex and index buffers
+	// - The other six bind those 8 and rebind both shaders' constants
+	//   when they're copied, and only the buffers change (and the
+	//   textures, once, when the material does) - so 6 are redundant
+	// - The sky binds its pipeline state, both shaders, the vertex
+	//   shader's constants, its cube, its sampler (the same as the
+	//   materials', in the same slot) and the cube's buffers
+	context->Invalidate();
+	context->BeginFrame();
+	scene.Draw(context, camera, items);
+	NullRenderContext::Stats first = context->GetFrameStats();
+	CHECK(first.Draws == 8);
+	CHECK(first.IndirectDraws == 0);
+	CHECK(first.Indices == sceneIndices);
+	CHECK(first.Binds == 8 + 6 * 10 + 8);
+	CHECK(first.RedundantBinds == 0 + 5 * 6 + 5 + 1);
+	CHECK(first.BytesUploaded == 7 * (256 + 32) + 128);
+
+	// The next frame starts from the sky's state instead of nothing
+	// - The first renderable's copies don't rebind anything, with the
+	//   sky's shaders bound, so it binds the same 8 things as before
+	// - But the sky's cube is the first renderable's mesh, and its
+	//   sampler is the materials', so 3 of those are redundant
+	// - Renderables leave the pipeline state alone (the game resets it
+	//   through the state cache), so the sky's is redundant too
+	context->BeginFrame();
+	scene.Draw(context, camera, items);
+	NullRenderContext::Stats second = context->GetFrameStats();
+	CHECK(second.Draws == first.Draws);
+	CHECK(second.Indices == first.Indices);
+	CHECK(second.Binds == first.Binds);
+	CHECK(second.RedundantBinds == first.RedundantBinds + 3 + 1);
+}
+
+TEST(RecordedSubmissionMatchesSerial)
+{
+	NullDemoScene scene;
+	FrameCamera camera;
+	std::vector<FrameDrawItem> items;
+	scene.CaptureFrame(camera, items);
+	RenderQueue queue;
+	scene.Sort(items, queue);
+
+	// Constants are copied up front, then the draws recorded on their own
+	// context with the captured slices - as Game::DrawRenderablesParallel() does
+	struct Record
+	{
+		Renderable* Object;
+		RenderConstantBufferRanges VSRanges;
+		RenderConstantBufferRanges PSRanges;
+	};
+	std::vector<Record> records(queue.GetCount());
+	for (unsigned int i = 0; i < queue.GetCount(); i++)
+	{
+		const FrameDrawItem& item = items[queue[i].Index];
+		records[i].Object = scene.Scene->GetRenderables()[item.RenderableIndex].get();
+		CHECK(records[i].Object->CopyConstants(camera, item, 1.0f, &records[i].VSRanges, &records[i].PSRanges));
+	}
+
+	NullRenderContext recording;
+	recording.BeginFrame();
+	for (const Record& record : records)
+		record.Object->Record(&recording, record.VSRanges, record.PSRanges);
+	NullRenderContext::Stats recorded = recording.GetFrameStats();
+
+	// Each draw binds its own slices, so nothing is rebound at copy time
+	// - After the first, each keeps both shaders, the textures and the
+	//   sampler (4 redundant binds), but changes both slices and buffers
+	// - Except that the textures change once, with the material
+	CHECK(recorded.Draws == 7);
+	CHECK(recorded.Binds == 7 * 8);
+	CHECK(recorded.RedundantBinds == 6 * 4 - 1);
+
+	// And every slice is a different part of the ring
+	for (unsigned int i = 1; i < records.size(); i++)
+	{
+		CHECK(records[i].VSRanges.FirstConstant[0] != records[i - 1].VSRanges.FirstConstant[0]);
+		CHECK(records[i].PSRanges.FirstConstant[0] != records[i - 1].PSRanges.FirstConstant[0]);
+	}
+}
@@ -0,0 +1,151 @@
+#include "TestFramework.h"
+#include "ShadowAtlasAllocator.h"
+
+#include <iterator>
+#include <map>
+#include <stdlib.h>
+
+typedef ShadowAtlasAllocator::Tile Tile;
+
+static bool Overlap(const Tile& a, const Tile& b)
+{
+	return a.X < b.X + b.Size && b.X < a.X + a.Size &&
+		a.Y < b.Y + b.Size && b.Y < a.Y + a.Size;
+}
+
+TEST(SizesRoundToPowersOfTwoInRange)
+{
+	ShadowAtlasAllocator allocator(1000, 50);
+	CHECK(allocator.GetAtlasSize() == 1024);
+	CHECK(allocator.GetMinTileSize() == 64);
+	CHECK(allocator.RoundTileSize(1) == 64);
+	CHECK(allocator.RoundTileSize(100) == 128);
+	CHECK(allocator.RoundTileSize(5000) == 1024);
+}
+
+TEST(TilesKeepTheirPlaceBetweenFrames)
+{
+	ShadowAtlasAllocator allocator(1024, 64);
+	Tile first = {};
+	CHECK(allocator.Allocate(7, 256, &first));
+
+	for (int frame = 0; frame < 5; frame++)
+	{
+		allocator.BeginFrame();
+
+		// Asking in a different order each frame changes nothing
+		Tile other = {};
+		Tile again = {};
+		CHECK(allocator.Allocate(100 + frame, 128, &other));
+		CHECK(allocator.Allocate(7, 256, &again));
+		CHECK(again.X == first.X && again.Y == first.Y && again.Size == 256);
+		CHECK(!Overlap(again, other));
+	}
+}
+
+TEST(ChangingSizeMovesTheTile)
+{
+	ShadowAtlasAllocator allocator(1024, 64);
+	Tile tile = {};
+	CHECK(allocator.Allocate(1, 256, &tile));
+	CHECK(allocator.Allocate(1, 512, &tile));
+	CHECK(tile.Size == 512);
+	CHECK(allocator.GetAllocationCount() == 1);
+	CHECK(allocator.GetUsedArea() == 512 * 512);
+}
+
+TEST(FullAtlasEvictsStaleTilesFirst)
+{
+	ShadowAtlasAllocator allocator(512, 64);
+	Tile tile = {};
+	for (uint64_t key = 0; key < 4; key++)
+		CHECK(allocator.Allocate(key, 256, &tile));
+
+	// Key 2 is used again, so the oldest of the rest (key 0) goes first
+	allocator.BeginFrame();
+	CHECK(allocator.Allocate(2, 256, &tile));
+	allocator.BeginFrame();
+	CHECK(allocator.Allocate(1, 256, &tile));
+	CHECK(allocator.Allocate(3, 256, &tile));
+	CHECK(allocator.Allocate(2, 256, &tile));
+	CHECK(allocator.Allocate(10, 256, &tile));
+
+	CHECK(allocator.GetEvictionCount() == 1);
+	CHECK(allocator.GetAllocationCount() == 4);
+	CHECK(allocator.Allocate(1, 256, &tile) && allocator.GetEvictionCount() == 1);
+}
+
+TEST(RequestsShrinkWhenNothingCanBeEvicted)
+{
+	ShadowAtlasAllocator allocator(512, 64);
+	Tile tile = {};
+	CHECK(allocator.Allocate(0, 256, &tile));
+	CHECK(allocator.Allocate(1, 256, &tile));
+	CHECK(allocator.Allocate(2, 256, &tile));
+
+	// Three quarters are taken this frame, so a full-size request gets the last quarter
+	CHECK(allocator.Allocate(3, 512, &tile));
+	CHECK(tile.Size == 256);
+	CHECK(allocator.GetEvictionCount() == 0);
+
+	// And with no room left at all, even the smallest tile fails
+	CHECK(!allocator.Allocate(4, 64, &tile));
+}
+
+TEST(ReleasedTilesMergeBackTogether)
+{
+	ShadowAtlasAllocator allocator(1024, 64);
+	Tile tile = {};
+	for (uint64_t key = 0; key < 256; key++)
+		CHECK(allocator.Allocate(key, 64, &tile));
+	CHECK(allocator.GetUsedArea() == 1024 * 1024);
+
+	for (uint64_t key = 0; key < 256; key++)
+		allocator.Release(key);
+	CHECK(allocator.GetUsedArea() == 0);
+
+	// Only possible if every quarter merged back into the whole atlas
+	CHECK(allocator.Allocate(0, 1024, &tile));
+	CHECK(tile.X == 0 && tile.Y == 0 && tile.Size == 1024);
+	CHECK(allocator.GetEvictionCount() == 0);
+}
+
+TEST(RandomWorkloadNeverOverlaps)
+{
+	ShadowAtlasAllocator allocator(2048, 32);
+	srand(1234);
+	for (int frame = 0; frame < 200; frame++)
+	{
+		allocator.BeginFrame();
+
+		// Tiles asked for this frame can't be evicted until the next, so they must all be disjoint
+		std::map<uint64_t, Tile> used;
+		unsigned int requests = 10 + rand() % 40;
+		for (unsigned int i = 0; i < requests; i++)
+		{
+			uint64_t key = rand() % 80;
+			Tile tile = {};
+			if (allocator.Allocate(key, 32u << (rand() % 6), &tile))
+				used[key] = tile;
+			else
+				used.erase(key);
+
+			if (rand() % 10 == 0)
+			{
+				uint64_t released = rand() % 80;
+				allocator.Release(released);
+				used.erase(released);
+			}
+		}
+
+		for (auto a = used.begin(); a != used.end(); ++a)
+		{
+			const Tile& t = a->second;
+			CHECK(t.X + t.Size <= 2048 && t.Y + t.Size <= 2048);
+			CHECK(t.X % t.Size == 0 && t.Y % t.Size == 0);
+			for (auto b = std::next(a); b != used.end(); ++b)
+				CHECK(!Overlap(t, b->second));
+		}
+		CHECK(allocator.GetUsedArea() <= (uint64_t)2048 * 2048);
+	}
+}
@@ -0,0 +1,160 @@
+#include "TestFramework.h"
+#include "ShadowCascades.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// The game's shadow settings, with a camera that can be
+// moved around between fits
+// --------------------------------------------------------
+struct CascadeFitter
+{
+	ShadowCascades Cascades;
+	XMFLOAT3 LightDirection;
+
+	CascadeFitter() : Cascades(2048), LightDirection(0.3f, -1.0f, 0.2f) {}
+
+	static XMFLOAT4X4 View(XMFLOAT3 position, float yaw, float pitch)
+	{
+		XMFLOAT4X4 view;
+		XMVECTOR forward = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), XMQuaternionRotationRollPitchYaw(pitch, yaw, 0));
+		XMStoreFloat4x4(&view, XMMatrixLookToLH(XMLoadFloat3(&position), forward, XMVectorSet(0, 1, 0, 0)));
+		return view;
+	}
+
+	void Fit(XMFLOAT3 position, float yaw = 0.0f, float pitch = 0.0f)
+	{
+		Cascades.Fit(View(position, yaw, pitch), XM_PIDIV4, 16.0f / 9.0f, 0.01f, LightDirection, 4, 40.0f, 0.6f, 50.0f);
+	}
+
+	bool SameMatrices(const ShadowCascades::Cascade (&before)[ShadowCascades::MaxCascades])
+	{
+		for (unsigned int c = 0; c < Cascades.GetCascadeCount(); c++)
+		{
+			if (memcmp(&before[c].ViewProjection, &Cascades.GetCascade(c).ViewProjection, sizeof(XMFLOAT4X4)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	void Save(ShadowCascades::Cascade (&out)[ShadowCascades::MaxCascades])
+	{
+		for (unsigned int c = 0; c < Cascades.GetCascadeCount(); c++)
+			out[c] = Cascades.GetCascade(c);
+	}
+};
+
+static float TexelSize(ShadowCascades& cascades, unsigned int c)
+{
+	return 2.0f / (cascades.GetCascade(c).Projection.m[0][0] * cascades.GetResolution());
+}
+
+TEST(SmallCameraMovesKeepTheCascades)
+{
+	CascadeFitter fitter;
+	fitter.Fit(XMFLOAT3(3.0f, 2.5f, -15.0f), 0.3f, -0.1f);
+	ShadowCascades::Placement first = fitter.Cascades.GetPlacement();
+	ShadowCascades::Cascade before[ShadowCascades::MaxCascades];
+	fitter.Save(before);
+
+	// A couple of texels of the smallest cascade, along every axis
+	float texel = TexelSize(fitter.Cascades, 0);
+	fitter.Fit(XMFLOAT3(3.0f + texel * 2, 2.5f - texel * 2, -15.0f + texel * 2), 0.3f, -0.1f);
+	CHECK(ShadowCascades::SamePlacement(first, fitter.Cascades.GetPlacement()));
+	CHECK(fitter.SameMatrices(before));
+
+	// Turning a little moves the slices' centers about as much
+	fitter.Fit(XMFLOAT3(3.0f, 2.5f, -15.0f), 0.301f, -0.1f);
+	CHECK(ShadowCascades::SamePlacement(first, fitter.Cascades.GetPlacement()));
+	CHECK(fitter.SameMatrices(before));
+
+	// Walking slowly, a texel at a time, only moves the smallest cascade
+	// once it has drifted past the slack - and then it centers itself again
+	unsigned int moves = 0;
+	for (int step = 1; step <= 100; step++)
+	{
+		ShadowCascades::Placement last = fitter.Cascades.GetPlacement();
+		fitter.Fit(XMFLOAT3(3.0f + step * texel, 2.5f, -15.0f), 0.3f, -0.1f);
+		moves += memcmp(last.Center[0], fitter.Cascades.GetPlacement().Center[0], sizeof(last.Center[0])) != 0 ? 1 : 0;
+	}
+	CHECK(moves > 0);
+	CHECK(moves <= 100 / ShadowCascades::SnapSlack + 1);
+}
+
+TEST(LargeMovesAndNewLightsMoveTheCascades)
+{
+	CascadeFitter fitter;
+	fitter.Fit(XMFLOAT3(0.0f, 2.5f, -15.0f));
+	ShadowCascades::Placement first = fitter.Cascades.GetPlacement();
+
+	fitter.Fit(XMFLOAT3(1.0f, 2.5f, -15.0f));
+	CHECK(!ShadowCascades::SamePlacement(first, fitter.Cascades.GetPlacement()));
+
+	// Back where it started, the cascades land where they first did
+	fitter.Fit(XMFLOAT3(0.0f, 2.5f, -15.0f));
+	CHECK(ShadowCascades::SamePlacement(first, fitter.Cascades.GetPlacement()));
+
+	fitter.LightDirection = XMFLOAT3(0.31f, -1.0f, 0.2f);
+	fitter.Fit(XMFLOAT3(0.0f, 2.5f, -15.0f));
+	CHECK(!ShadowCascades::SamePlacement(first, fitter.Cascades.GetPlacement()));
+
+	// Fewer cascades are a different placement too
+	fitter.Cascades.Fit(CascadeFitter::View(XMFLOAT3(0.0f, 2.5f, -15.0f), 0, 0), XM_PIDIV4, 16.0f / 9.0f, 0.01f, fitter.LightDirection, 3, 40.0f, 0.6f, 50.0f);
+	CHECK(fitter.Cascades.GetCascadeCount() == 3);
+	CHECK(!ShadowCascades::SamePlacement(first, fitter.Cascades.GetPlacement()));
+}
+
+TEST(SlicesStayInsideTheirCascades)
+{
+	CascadeFitter fitter;
+	srand(36);
+	XMFLOAT3 position(0.0f, 2.5f, -15.0f);
+	float yaw = 0.0f;
+	float pitch = 0.0f;
+	for (int frame = 0; frame < 200; frame++)
+	{
+		// Mostly small steps, with the odd jump
+		float step = (frame % 25 == 0) ? 5.0f : 0.05f;
+		position.x += step * (rand() / (float)RAND_MAX - 0.5f);
+		position.y += step * (rand() / (float)RAND_MAX - 0.5f);
+		position.z += step * (rand() / (float)RAND_MAX - 0.5f);
+		yaw += 0.1f * (rand() / (float)RAND_MAX - 0.5f);
+		pitch = fmaxf(-1.0f, fminf(1.0f, pitch + 0.1f * (rand() / (float)RAND_MAX - 0.5f)));
+		fitter.Fit(position, yaw, pitch);
+
+		XMFLOAT4X4 view = CascadeFitter::View(position, yaw, pitch);
+		XMMATRIX invView = XMMatrixInverse(0, XMLoadFloat4x4(&view));
+		float tanY = tanf(XM_PIDIV4 * 0.5f);
+		float tanX = tanY * 16.0f / 9.0f;
+		for (unsigned int c = 0; c < fitter.Cascades.GetCascadeCount(); c++)
+		{
+			const ShadowCascades::Cascade& cascade = fitter.Cascades.GetCascade(c);
+			XMMATRIX viewProj = XMLoadFloat4x4(&cascade.ViewProjection);
+
+			// Every corner of the slice lands in the map, in front of the near plane
+			float depths[2] = { cascade.SplitNear, cascade.SplitFar };
+			for (unsigned int i = 0; i < 8; i++)
+			{
+				float z = depths[i / 4];
+				XMVECTOR corner = XMVectorSet((i & 1) ? tanX * z : -tanX * z, (i & 2) ? tanY * z : -tanY * z, z, 1);
+				XMFLOAT3 ndc;
+				XMStoreFloat3(&ndc, XMVector3TransformCoord(XMVector3TransformCoord(corner, invView), viewProj));
+				CHECK(ndc.x >= -1.0f && ndc.x <= 1.0f);
+				CHECK(ndc.y >= -1.0f && ndc.y <= 1.0f);
+				CHECK(ndc.z >= 0.0f && ndc.z <= 1.0f);
+			}
+
+			// And the world's origin always lands on a texel corner
+			XMFLOAT3 origin;
+			XMStoreFloat3(&origin, XMVector3TransformCoord(XMVectorZero(), viewProj));
+			float x = origin.x * fitter.Cascades.GetResolution() * 0.5f;
+			float y = origin.y * fitter.Cascades.GetResolution() * 0.5f;
+			CHECK(fabsf(x - roundf(x)) < 0.01f);
+			CHECK(fabsf(y - roundf(y)) < 0.01f);
+		}
+	}
+}
@@ -0,0 +1,170 @@
+#include "TestFramework.h"
+#include "StateCache.h"
+
+#include <string>
+
+// Records every call that makes it through the cache
+class RecordingBackend : public StateCacheBackend
+{
+public:
+	std::vector<std::string> Calls;
+
+	void SetInputLayout(ID3D11InputLayout*) { Calls.push_back("InputLayout"); }
+	void SetPrimitiveTopology(unsigned int) { Calls.push_back("Topology"); }
+	void SetVertexBuffers(unsigned int, unsigned int, ID3D11Buffer* const*, const unsigned int*, const unsigned int*) { Calls.push_back("VertexBuffers"); }
+	void SetIndexBuffer(ID3D11Buffer*, unsigned int, unsigned int) { Calls.push_back("IndexBuffer"); }
+	void SetVertexShader(ID3D11VertexShader*) { Calls.push_back("VertexShader"); }
+	void SetPixelShader(ID3D11PixelShader*) { Calls.push_back("PixelShader"); }
+	void SetConstantBuffers(Stage stage, unsigned int, unsigned int, ID3D11Buffer* const*, const unsigned int* firstConstants, const unsigned int*)
+	{
+		Calls.push_back(std::string(stage == VertexStage ? "VS" : "PS") + (firstConstants ? "ConstantBuffers1" : "ConstantBuffers"));
+	}
+	void SetShaderResources(Stage stage, unsigned int, unsigned int, ID3D11ShaderResourceView* const*) { Calls.push_back(stage == VertexStage ? "VSShaderResources" : "PSShaderResources"); }
+	void SetSamplers(Stage stage, unsigned int, unsigned int, ID3D11SamplerState* const*) { Calls.push_back(stage == VertexStage ? "VSSamplers" : "PSSamplers"); }
+	void SetRasterizerState(ID3D11RasterizerState*) { Calls.push_back("RasterizerState"); }
+	void SetDepthStencilState(ID3D11DepthStencilState*, unsigned int) { Calls.push_back("DepthStencilState"); }
+	void DrawIndexed(unsigned int, unsigned int, int) { Calls.push_back("DrawIndexed"); }
+	void DrawIndexedInstancedIndirect(ID3D11Buffer*, unsigned int) { Calls.push_back("DrawIndirect"); }
+};
+
+// Distinct, never dereferenced "objects" of any type
+static char objects[64];
+template<typename T>
+static T* Object(unsigned int index) { return reinterpret_cast<T*>(&objects[index]); }
+
+struct Fixture
+{
+	std::shared_ptr<RecordingBackend> backend = std::make_shared<RecordingBackend>();
+	StateCache cache = StateCache(backend);
+};
+
+TEST(RepeatedBindsAreFiltered)
+{
+	Fixture f;
+	f.cache.VSSetShader(Object<ID3D11VertexShader>(1));
+	f.cache.VSSetShader(Object<ID3D11VertexShader>(1));
+	f.cache.RSSetState(0);
+	f.cache.RSSetState(0);
+	f.cache.OMSetDepthStencilState(0, 1);
+	f.cache.OMSetDepthStencilState(0, 2);
+
+	CHECK(f.backend->Calls.size() == 4);
+	CHECK(f.cache.GetFrameStats().Issued == 4);
+	CHECK(f.cache.GetFrameStats().Filtered == 2);
+}
+
+TEST(FirstBindAfterInvalidateIsIssued)
+{
+	Fixture f;
+	f.cache.IASetPrimitiveTopology(4);
+	f.cache.IASetInputLayout(0);
+	f.cache.Invalidate();
+	f.cache.IASetPrimitiveTopology(4);
+	f.cache.IASetInputLayout(0);
+	f.cache.IASetInputLayout(0);
+
+	CHECK(f.backend->Calls.size() == 4);
+	CHECK(f.cache.GetFrameStats().Filtered == 1);
+}
+
+TEST(ConstantBufferRangesCompareOffsets)
+{
+	Fixture f;
+	ID3D11Buffer* ring = Object<ID3D11Buffer>(2);
+	unsigned int first[] = { 0 };
+	unsigned int count[] = { 16 };
+	f.cache.PSSetConstantBuffers1(0, 1, &ring, first, count);
+	f.cache.PSSetConstantBuffers1(0, 1, &ring, first, count);
+	first[0] = 16;
+	f.cache.PSSetConstantBuffers1(0, 1, &ring, first, count);
+
+	// A whole-buffer bind of the same buffer is still a change
+	f.cache.PSSetConstantBuffers(0, 1, &ring);
+	f.cache.PSSetConstantBuffers(0, 1, &ring);
+
+	CHECK(f.backend->Calls.size() == 3);
+	CHECK(f.backend->Calls.size() == 3 && f.backend->Calls[2] == "PSConstantBuffers");
+	CHECK(f.cache.GetFrameStats().Filtered == 2);
+}
+
+TEST(StagesAreTrackedSeparately)
+{
+	Fixture f;
+	ID3D11ShaderResourceView* view = Object<ID3D11ShaderResourceView>(3);
+	f.cache.VSSetShaderResources(0, 1, &view);
+	f.cache.PSSetShaderResources(0, 1, &view);
+	f.cache.PSSetShaderResources(0, 1, &view);
+
+	CHECK(f.backend->Calls.size() == 2);
+	CHECK(f.cache.GetFrameStats().Filtered == 1);
+}
+
+TEST(NullBindsAreTrackedToo)
+{
+	Fixture f;
+	ID3D11SamplerState* sampler = Object<ID3D11SamplerState>(4);
+	f.cache.PSSetSamplers(0, 1, &sampler);
+	f.cache.PSSetSamplers(0, 1, 0);
+	f.cache.PSSetSamplers(0, 1, 0);
+
+	ID3D11SamplerState* none = 0;
+	f.cache.PSSetSamplers(0, 1, &none);
+
+	CHECK(f.backend->Calls.size() == 2);
+	CHECK(f.cache.GetFrameStats().Filtered == 2);
+}
+
+TEST(SlotsPastTheShadowedOnesAreAlwaysIssued)
+{
+	Fixture f;
+	ID3D11ShaderResourceView* views[2] = { Object<ID3D11ShaderResourceView>(5), Object<ID3D11ShaderResourceView>(6) };
+	f.cache.PSSetShaderResources(StateCache::MaxShaderResources - 1, 2, views);
+	f.cache.PSSetShaderResources(StateCache::MaxShaderResources - 1, 2, views);
+
+	CHECK(f.backend->Calls.size() == 2);
+	CHECK(f.cache.GetFrameStats().Filtered == 0);
+}
+
+TEST(AnyChangedVertexBufferSlotIssuesTheCall)
+{
+	Fixture f;
+	ID3D11Buffer* buffers[2] = { Object<ID3D11Buffer>(7), Object<ID3D11Buffer>(8) };
+	unsigned int strides[2] = { 32, 16 };
+	unsigned int offsets[2] = { 0, 0 };
+	f.cache.IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	f.cache.IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	offsets[1] = 64;
+	f.cache.IASetVertexBuffers(0, 2, buffers, strides, offsets);
+
+	f.cache.IASetIndexBuffer(buffers[0], 42, 0);
+	f.cache.IASetIndexBuffer(buffers[0], 42, 0);
+	f.cache.IASetIndexBuffer(buffers[0], 57, 0);
+
+	CHECK(f.backend->Calls.size() == 4);
+	CHECK(f.cache.GetFrameStats().Filtered == 2);
+}
+
+TEST(DrawsAlwaysGoThroughUncounted)
+{
+	Fixture f;
+	f.cache.DrawIndexed(3, 0, 0);
+	f.cache.DrawIndexed(3, 0, 0);
+	f.cache.DrawIndexedInstancedIndirect(Object<ID3D11Buffer>(9), 0);
+
+	CHECK(f.backend->Calls.size() == 3);
+	CHECK(f.cache.GetFrameStats().Issued == 0);
+}
+
+TEST(BeginFrameMovesStatsToLastFrame)
+{
+	Fixture f;
+	f.cache.PSSetShader(Object<ID3D11PixelShader>(10));
+	f.cache.PSSetShader(Object<ID3D11PixelShader>(10));
+	f.cache.BeginFrame();
+
+	// State carries over between frames, only the counts start again
+	f.cache.PSSetShader(Object<ID3D11PixelShader>(10));
+
+	CHECK(f.cache.GetLastFrameStats().Issued == 1 && f.cache.GetLastFrameStats().Filtered == 1);
+	CHECK(f.cache.GetFrameStats().Issued == 0 && f.cache.GetFrameStats().Filtered == 1);
+}
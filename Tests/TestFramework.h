@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+// --------------------------------------------------------
+// Just enough of a unit test framework for the portable
+// parts of the renderer (see CMakeLists.txt)
+//
+// - TEST(Name) { ... } registers a test, and TestMain.cpp
+//   runs every test linked into the executable
+// - CHECK() records a failure and keeps going, so one run
+//   reports everything that's wrong
+// --------------------------------------------------------
+class TestRegistry
+{
+public:
+	typedef void (*TestFunction)();
+
+	struct Test
+	{
+		const char* Name;
+		TestFunction Function;
+	};
+
+	static std::vector<Test>& GetTests()
+	{
+		static std::vector<Test> tests;
+		return tests;
+	}
+
+	static unsigned int& GetFailureCount()
+	{
+		static unsigned int failures = 0;
+		return failures;
+	}
+
+	static void Fail(const char* file, int line, const char* expression)
+	{
+		printf("%s(%d): CHECK failed: %s\n", file, line, expression);
+		GetFailureCount()++;
+	}
+};
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, TestRegistry::TestFunction function)
+	{
+		TestRegistry::Test test = { name, function };
+		TestRegistry::GetTests().push_back(test);
+	}
+};
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(expression) \
+	do { if (!(expression)) TestRegistry::Fail(__FILE__, __LINE__, #expression); } while (0)
@@ -0,0 +1,19 @@
+#include "TestFramework.h"
+
+// --------------------------------------------------------
+// Runs every registered test, and fails if any check did
+// --------------------------------------------------------
+int main()
+{
+	std::vector<TestRegistry::Test>& tests = TestRegistry::GetTests();
+	for (unsigned int i = 0; i < tests.size(); i++)
+	{
+		unsigned int failuresBefore = TestRegistry::GetFailureCount();
+		tests[i].Function();
+		printf("%s %s\n", TestRegistry::GetFailureCount() == failuresBefore ? "[ pass ]" : "[ FAIL ]", tests[i].Name);
+	}
+
+	unsigned int failures = TestRegistry::GetFailureCount();
+	printf("%u tests, %u failed checks\n", (unsigned int)tests.size(), failures);
+	return failures == 0 ? 0 : 1;
+}
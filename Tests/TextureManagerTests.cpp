@@ -0,0 +1,76 @@
+#include "TestFramework.h"
+#include "TextureManager.h"
+#include "NullRenderDevice.h"
+#include "ImageWriter.h"
+
+#include <filesystem>
+
+// A small gradient, written once into the temp directory
+static std::string WriteTestImage(const char* name, unsigned int width, unsigned int height)
+{
+	std::vector<unsigned char> pixels(width * height * 4);
+	for (unsigned int i = 0; i < width * height; i++)
+	{
+		pixels[i * 4 + 0] = (unsigned char)(i * 7);
+		pixels[i * 4 + 1] = (unsigned char)(i * 3);
+		pixels[i * 4 + 2] = (unsigned char)i;
+		pixels[i * 4 + 3] = 255;
+	}
+
+	std::string path = (std::filesystem::temp_directory_path() / name).string();
+	WritePpm(path, pixels.data(), width * 4, width, height);
+	return path;
+}
+
+TEST(CanonicalPathsMatch)
+{
+	CHECK(TextureManager::CanonicalizePath("a/../b.png") == TextureManager::CanonicalizePath("b.png"));
+	CHECK(TextureManager::CanonicalizePath("a/./b.png") == TextureManager::CanonicalizePath("a\\b.png"));
+	CHECK(TextureManager::CanonicalizePath("a/b.png") != TextureManager::CanonicalizePath("b.png"));
+}
+
+TEST(SameFileLoadsOnceWithFullMips)
+{
+	std::shared_ptr<NullRenderDevice> device = std::make_shared<NullRenderDevice>();
+	std::shared_ptr<JobSystem> jobs = std::make_shared<JobSystem>(2);
+	TextureManager textures(device, jobs);
+	std::string path = WriteTestImage("TextureManagerTests.ppm", 16, 8);
+	std::string dir = std::filesystem::path(path).parent_path().string();
+
+	std::shared_ptr<RenderTexture> first;
+	std::shared_ptr<RenderTexture> second;
+	textures.LoadAsync(path, [&](std::shared_ptr<RenderTexture> t) { first = t; });
+	textures.LoadAsync(dir + "/x/../TextureManagerTests.ppm", [&](std::shared_ptr<RenderTexture> t) { second = t; });
+	textures.WaitForLoads();
+
+	CHECK(first != 0);
+	CHECK(first == second);
+	if (first)
+		CHECK(first->GetDesc().Width == 16 && first->GetDesc().Height == 8 && first->GetDesc().MipLevels == 5);
+
+	TextureManager::Stats stats = textures.GetStats();
+	CHECK(stats.Loads == 1);
+	CHECK(stats.Hits == 1);
+	CHECK(stats.Pending == 0);
+	CHECK(device->GetStats().Textures == 1);
+
+	// Loaded already, so the callback runs right away
+	std::shared_ptr<RenderTexture> third;
+	textures.LoadAsync(path, [&](std::shared_ptr<RenderTexture> t) { third = t; });
+	CHECK(third == first);
+}
+
+TEST(MissingFilesFailWithoutCallbacks)
+{
+	std::shared_ptr<NullRenderDevice> device = std::make_shared<NullRenderDevice>();
+	std::shared_ptr<JobSystem> jobs = std::make_shared<JobSystem>(1);
+	TextureManager textures(device, jobs);
+
+	bool called = false;
+	textures.LoadAsync("does/not/exist.png", [&](std::shared_ptr<RenderTexture>) { called = true; });
+	textures.WaitForLoads();
+
+	CHECK(!called);
+	CHECK(textures.GetStats().Failures == 1);
+	CHECK(textures.GetStats().Pending == 0);
+}
@@ -0,0 +1,417 @@
+#include "TextureManager.h"
+#include "ImageReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctype.h>
+
+TextureManager::TextureManager(std::shared_ptr<RenderDevice> device, std::shared_ptr<JobSystem> jobSystem) :
+	device(device),
+	jobSystem(jobSystem),
+	pending(0),
+	loads(0),
+	hits(0),
+	failures(0),
+	batches(0),
+	decodeMicroseconds(0)
+{
+}
+
+TextureManager::~TextureManager()
+{
+	// The jobs write into loads we own
+	jobSystem->Wait(&decodeJobs);
+}
+
+void TextureManager::LoadAsync(const std::string& path, ReadyCallback onReady)
+{
+	StartLoad(std::vector<std::string>(1, path), onReady);
+}
+
+void TextureManager::LoadCubeAsync(
+	const std::string& right,
+	const std::string& left,
+	const std::string& up,
+	const std::string& down,
+	const std::string& front,
+	const std::string& back,
+	ReadyCallback onReady)
+{
+	std::vector<std::string> paths = { right, left, up, down, front, back };
+	StartLoad(paths, onReady);
+}
+
+// --------------------------------------------------------
+// Finds the texture for a set of files, starting to load it
+// if it's not already loaded (or loading)
+// - Each file is decoded by its own job, so a cube map's
+//   faces decode in parallel too
+// --------------------------------------------------------
+void TextureManager::StartLoad(const std::vector<std::string>& paths, ReadyCallback onReady)
+{
+	// Every file is part of the key, so cube maps only match the same six faces
+	std::string key;
+	for (unsigned int i = 0; i < paths.size(); i++)
+	{
+		if (i > 0)
+			key += '|';
+		key += CanonicalizePath(paths[i]);
+	}
+
+	std::shared_ptr<RenderTexture> loaded;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		std::unordered_map<std::string, Entry>::iterator found = textures.find(key);
+		if (found != textures.end())
+		{
+			hits++;
+			if (!found->second.Texture)
+			{
+				// Still loading - it'll be handed over with the rest
+				if (onReady)
+					found->second.Waiting.push_back(onReady);
+				return;
+			}
+			loaded = found->second.Texture;
+		}
+		else
+		{
+			Entry& entry = textures[key];
+			entry.Path = paths[0];
+			if (onReady)
+				entry.Waiting.push_back(onReady);
+			pending++;
+		}
+	}
+
+	// Already loaded, so there's nothing to wait for
+	if (loaded)
+	{
+		if (onReady)
+			onReady(loaded);
+		return;
+	}
+
+	std::shared_ptr<PendingLoad> load = std::make_shared<PendingLoad>();
+	load->Key = key;
+	load->Paths = paths;
+	load->GenerateMips = paths.size() == 1;	// Cube maps (the sky) don't need them
+	load->Images.resize(paths.size());
+	load->Remaining = (unsigned int)paths.size();
+	load->Failed = false;
+	for (unsigned int i = 0; i < paths.size(); i++)
+	{
+		jobSystem->RunBackground([this, load, i]() { Decode(load, i); }, &decodeJobs);
+	}
+}
+
+// --------------------------------------------------------
+// Decodes one file and builds its mips, on a job
+// - The last of a texture's jobs to finish queues it up
+//   for CreatePendingTextures()
+// --------------------------------------------------------
+void TextureManager::Decode(std::shared_ptr<PendingLoad> load, unsigned int index)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	const std::string& path = load->Paths[index];
+	Image& image = load->Images[index];
+	image.Mips.resize(1);
+
+	std::string extension = path.size() >= 4 ? path.substr(path.size() - 4) : "";
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)tolower((unsigned char)c); });
+	bool read = extension == ".ppm" ?
+		ReadPpm(path, &image.Mips[0], &image.Width, &image.Height) :
+		ReadPng(path, &image.Mips[0], &image.Width, &image.Height);
+
+	if (!read)
+	{
+		load->Failed = true;
+	}
+	else if (load->GenerateMips)
+	{
+		// Each mip comes from the one before it, down to a single texel
+		unsigned int width = image.Width;
+		unsigned int height = image.Height;
+		while (width > 1 || height > 1)
+		{
+			unsigned int mipWidth = width > 1 ? width / 2 : 1;
+			unsigned int mipHeight = height > 1 ? height / 2 : 1;
+			image.Mips.push_back(std::vector<unsigned char>((size_t)mipWidth * mipHeight * 4));
+			Downsample(image.Mips[image.Mips.size() - 2].data(), width, height, image.Mips.back().data());
+			width = mipWidth;
+			height = mipHeight;
+		}
+	}
+
+	decodeMicroseconds += (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::high_resolution_clock::now() - start).count();
+
+	if (--load->Remaining == 0)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(load);
+	}
+}
+
+// --------------------------------------------------------
+// Makes every decoded texture on the device, then hands
+// each one to whoever asked for it
+// - The textures are created outside the lock, so jobs can
+//   keep finishing meanwhile
+// --------------------------------------------------------
+unsigned int TextureManager::CreatePendingTextures()
+{
+	std::vector<std::shared_ptr<PendingLoad>> batch;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		batch.swap(decoded);
+	}
+	if (batch.empty())
+		return 0;
+
+	std::vector<std::shared_ptr<RenderTexture>> created(batch.size());
+	for (unsigned int i = 0; i < batch.size(); i++)
+	{
+		if (!batch[i]->Failed)
+			created[i] = CreateTexture(*batch[i]);
+	}
+
+	std::vector<std::pair<std::shared_ptr<RenderTexture>, ReadyCallback>> ready;
+	unsigned int createdCount = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (unsigned int i = 0; i < batch.size(); i++)
+		{
+			pending--;
+
+			// Failures aren't remembered, so a file can be fixed and loaded again
+			std::unordered_map<std::string, Entry>::iterator entry = textures.find(batch[i]->Key);
+			if (!created[i])
+			{
+				failures++;
+				textures.erase(entry);
+				continue;
+			}
+
+			loads++;
+			createdCount++;
+			entry->second.Texture = created[i];
+			for (ReadyCallback& callback : entry->second.Waiting)
+				ready.push_back(std::make_pair(created[i], callback));
+			entry->second.Waiting.clear();
+		}
+		if (createdCount > 0)
+			batches++;
+	}
+
+	for (unsigned int i = 0; i < ready.size(); i++)
+		ready[i].second(ready[i].first);
+	return createdCount;
+}
+
+void TextureManager::WaitForLoads()
+{
+	jobSystem->Wait(&decodeJobs);
+	CreatePendingTextures();
+}
+
+std::shared_ptr<RenderTexture> TextureManager::CreateTexture(const PendingLoad& load)
+{
+	// Cube faces all have to match
+	const Image& first = load.Images[0];
+	for (const Image& image : load.Images)
+	{
+		if (image.Width != first.Width || image.Height != first.Height || image.Mips.size() != first.Mips.size())
+			return 0;
+	}
+
+	RenderTextureDesc desc = {};
+	desc.Width = first.Width;
+	desc.Height = first.Height;
+	desc.MipLevels = (unsigned int)first.Mips.size();
+	desc.ArraySize = (unsigned int)load.Images.size();
+	desc.Cube = load.Images.size() == 6;
+
+	// Every mip of the first slice, then every mip of the next
+	std::vector<const void*> data;
+	for (const Image& image : load.Images)
+	{
+		for (const std::vector<unsigned char>& mip : image.Mips)
+			data.push_back(mip.data());
+	}
+	return device->CreateTexture(desc, data.data());
+}
+
+std::shared_ptr<RenderTexture> TextureManager::GetSolidTexture(unsigned char r, unsigned char g, unsigned char b, unsigned char a, bool cube)
+{
+	uint64_t key = r | (g << 8) | (b << 16) | ((uint64_t)a << 24) | ((uint64_t)cube << 32);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::unordered_map<uint64_t, std::shared_ptr<RenderTexture>>::iterator found = solidTextures.find(key);
+	if (found != solidTextures.end())
+		return found->second;
+
+	// Every face of a cube is the same texel
+	RenderTextureDesc desc = { 1, 1, 1, cube ? 6u : 1u, cube };
+	unsigned char texel[4] = { r, g, b, a };
+	const void* data[6] = { texel, texel, texel, texel, texel, texel };
+	std::shared_ptr<RenderTexture> texture = device->CreateTexture(desc, data);
+	if (texture)
+		solidTextures[key] = texture;
+	return texture;
+}
+
+unsigned int TextureManager::ReleaseUnused()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	unsigned int released = 0;
+	for (std::unordered_map<std::string, Entry>::iterator i = textures.begin(); i != textures.end();)
+	{
+		if (i->second.Texture && i->second.Texture.use_count() == 1)
+		{
+			i = textures.erase(i);
+			released++;
+		}
+		else
+		{
+			++i;
+		}
+	}
+	return released;
+}
+
+std::vector<TextureManager::TextureInfo> TextureManager::GetTextureInfo()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<TextureInfo> info;
+	info.reserve(textures.size());
+	for (std::unordered_map<std::string, Entry>::iterator i = textures.begin(); i != textures.end(); ++i)
+	{
+		if (!i->second.Texture)
+			continue;
+
+		TextureInfo texture = {};
+		texture.Path = i->second.Path;
+		texture.Desc = i->second.Texture->GetDesc();
+		texture.Bytes = GetTextureBytes(texture.Desc);
+		texture.References = (unsigned int)i->second.Texture.use_count() - 1;
+		info.push_back(texture);
+	}
+
+	std::sort(info.begin(), info.end(),
+		[](const TextureInfo& a, const TextureInfo& b) { return a.Bytes > b.Bytes; });
+	return info;
+}
+
+TextureManager::Stats TextureManager::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Stats stats = {};
+	for (std::unordered_map<std::string, Entry>::iterator i = textures.begin(); i != textures.end(); ++i)
+	{
+		if (!i->second.Texture)
+			continue;
+		stats.Textures++;
+		stats.Bytes += GetTextureBytes(i->second.Texture->GetDesc());
+	}
+	stats.Pending = pending;
+	stats.Loads = loads;
+	stats.Hits = hits;
+	stats.Failures = failures;
+	stats.Batches = batches;
+	stats.DecodeMilliseconds = decodeMicroseconds.load() / 1000.0;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Turns a path into the key it's matched by
+// - Both slashes become '/', repeated slashes and "." are
+//   dropped, and ".." removes the directory before it
+// - Windows paths are case insensitive, so they're lowered
+// - Doesn't touch the file system, so links aren't resolved
+// --------------------------------------------------------
+std::string TextureManager::CanonicalizePath(const std::string& path)
+{
+	bool rooted = !path.empty() && (path[0] == '/' || path[0] == '\\');
+
+	// Split into directories, resolving as we go
+	std::vector<std::string> parts;
+	std::string part;
+	for (size_t i = 0; i <= path.size(); i++)
+	{
+		char c = i < path.size() ? path[i] : '/';
+		if (c != '/' && c != '\\')
+		{
+#ifdef _WIN32
+			c = (char)tolower((unsigned char)c);
+#endif
+			part += c;
+			continue;
+		}
+
+		if (part == "..")
+		{
+			// Only back out of a real directory - leading ".."s have to stay
+			if (!parts.empty() && parts.back() != "..")
+				parts.pop_back();
+			else if (!rooted)
+				parts.push_back(part);
+		}
+		else if (!part.empty() && part != ".")
+		{
+			parts.push_back(part);
+		}
+		part.clear();
+	}
+
+	std::string canonical = rooted ? "/" : "";
+	for (unsigned int i = 0; i < parts.size(); i++)
+	{
+		if (i > 0)
+			canonical += '/';
+		canonical += parts[i];
+	}
+	return canonical;
+}
+
+size_t TextureManager::GetTextureBytes(const RenderTextureDesc& desc)
+{
+	// Each mip halves both sides, down to one texel
+	size_t bytes = 0;
+	unsigned int width = desc.Width;
+	unsigned int height = desc.Height;
+	for (unsigned int mip = 0; mip < desc.MipLevels; mip++)
+	{
+		bytes += (size_t)width * height * 4;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return bytes * (desc.ArraySize > 0 ? desc.ArraySize : 1);
+}
+
+void TextureManager::Downsample(const unsigned char* source, unsigned int width, unsigned int height, unsigned char* destination)
+{
+	unsigned int destinationWidth = width > 1 ? width / 2 : 1;
+	unsigned int destinationHeight = height > 1 ? height / 2 : 1;
+
+	// Odd (or one texel) sides just repeat their last row or column
+	for (unsigned int y = 0; y < destinationHeight; y++)
+	{
+		const unsigned char* row0 = source + (size_t)(y * 2) * width * 4;
+		const unsigned char* row1 = source + (size_t)(y * 2 + 1 < height ? y * 2 + 1 : y * 2) * width * 4;
+		unsigned char* out = destination + (size_t)y * destinationWidth * 4;
+		for (unsigned int x = 0; x < destinationWidth; x++)
+		{
+			unsigned int x0 = x * 2 * 4;
+			unsigned int x1 = (x * 2 + 1 < width ? x * 2 + 1 : x * 2) * 4;
+			for (unsigned int c = 0; c < 4; c++)
+				out[x * 4 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+		}
+	}
+}
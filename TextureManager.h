@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "RenderDevice.h"
+#include "JobSystem.h"
+
+// --------------------------------------------------------
+// Loads each texture file once, in the background, and hands
+// the same texture to everything that asks for it again
+//
+// - Files are decoded as background jobs, with the portable
+//   readers in ImageReader.h (PNG, or PPM by extension), and
+//   2D textures get their full mip chain built there too -
+//   so a frame's ParallelFor() never waits behind a decode
+// - Decoded textures wait until CreatePendingTextures() makes
+//   them all on the device in one batch, then their callbacks
+//   run - so whoever draws can swap them in between frames
+// - Until then, callers draw with something like a 1x1
+//   GetSolidTexture(), and if a file fails it stays that way
+// - Files are matched by canonical path, so "a/../b.png"
+//   and "b.png" (and, on Windows, "B.PNG") are one texture
+// - Cube maps are matched by all six of their faces
+// - The manager holds one reference to everything it has
+//   loaded, so loading the same set again costs nothing even
+//   after the first set is released - ReleaseUnused() drops
+//   the textures nothing else holds
+// - Safe to call from any thread, but callbacks only run on
+//   the threads that call LoadAsync() (for textures that are
+//   already loaded) and CreatePendingTextures()
+// - Portable C++ - builds anywhere
+// --------------------------------------------------------
+class TextureManager
+{
+public:
+	// Given the finished texture - never called for files that failed
+	typedef std::function<void(std::shared_ptr<RenderTexture> texture)> ReadyCallback;
+
+	// What one loaded texture costs
+	struct TextureInfo
+	{
+		std::string Path;			// The first file, for cube maps
+		RenderTextureDesc Desc;
+		size_t Bytes;				// Every mip and array slice, at four bytes a texel
+		unsigned int References;	// Holders other than the manager
+	};
+
+	struct Stats
+	{
+		unsigned int Textures;
+		size_t Bytes;
+		unsigned int Pending;		// Still decoding, or waiting to be created
+		unsigned int Loads;			// Files actually loaded
+		unsigned int Hits;			// Requests that found the texture already loaded (or loading)
+		unsigned int Failures;
+		unsigned int Batches;		// CreatePendingTextures() calls that created something
+		double DecodeMilliseconds;	// Summed over every job, so it can exceed the wall time
+	};
+
+	TextureManager(std::shared_ptr<RenderDevice> device, std::shared_ptr<JobSystem> jobSystem);
+	~TextureManager();
+
+	// Starts loading a texture from one file, or a cube map from six (+X, -X, +Y, -Y, +Z, -Z)
+	// - Returns right away; onReady (if any) runs once the texture exists
+	void LoadAsync(const std::string& path, ReadyCallback onReady);
+	void LoadCubeAsync(
+		const std::string& right,
+		const std::string& left,
+		const std::string& up,
+		const std::string& down,
+		const std::string& front,
+		const std::string& back,
+		ReadyCallback onReady);
+
+	// Creates every texture that has finished decoding, then runs their callbacks
+	// - Call once a frame from the thread that draws, before drawing
+	// - Returns how many textures were created
+	unsigned int CreatePendingTextures();
+
+	// Waits for every load started so far, then creates them all
+	// - For runs that need every texture from the first frame, like benchmarks
+	void WaitForLoads();
+
+	// A 1x1 texture (or cube map) of one color, 0 - 255 per channel, made once per color
+	std::shared_ptr<RenderTexture> GetSolidTexture(unsigned char r, unsigned char g, unsigned char b, unsigned char a, bool cube = false);
+
+	// Drops every texture that only the manager still holds
+	// - Returns how many were released
+	unsigned int ReleaseUnused();
+
+	// Every texture, largest first
+	std::vector<TextureInfo> GetTextureInfo();
+	Stats GetStats();
+
+	// The key a path is matched by - separators unified and "." and ".." resolved
+	static std::string CanonicalizePath(const std::string& path);
+
+	// A texture's size, at four bytes a texel
+	static size_t GetTextureBytes(const RenderTextureDesc& desc);
+
+	// Halves an RGBA8 image (rounding odd sides down, to at least one texel) with a box filter
+	static void Downsample(const unsigned char* source, unsigned int width, unsigned int height, unsigned char* destination);
+
+private:
+	// One file, decoded, with its mips
+	struct Image
+	{
+		unsigned int Width;
+		unsigned int Height;
+		std::vector<std::vector<unsigned char>> Mips;
+	};
+
+	// Files being decoded for one texture - shared with its jobs
+	struct PendingLoad
+	{
+		std::string Key;
+		std::vector<std::string> Paths;
+		bool GenerateMips;
+		std::vector<Image> Images;				// One per path, each written by its own job
+		std::atomic<unsigned int> Remaining;	// Jobs still decoding
+		std::atomic<bool> Failed;
+	};
+
+	struct Entry
+	{
+		std::string Path;
+		std::shared_ptr<RenderTexture> Texture;	// Null until it's created
+		std::vector<ReadyCallback> Waiting;
+	};
+
+	std::shared_ptr<RenderDevice> device;
+	std::shared_ptr<JobSystem> jobSystem;
+	JobCounter decodeJobs;
+
+	std::mutex mutex;
+	std::unordered_map<std::string, Entry> textures;
+	std::unordered_map<uint64_t, std::shared_ptr<RenderTexture>> solidTextures;
+	std::vector<std::shared_ptr<PendingLoad>> decoded;	// Waiting for CreatePendingTextures()
+	unsigned int pending;
+	unsigned int loads;
+	unsigned int hits;
+	unsigned int failures;
+	unsigned int batches;
+	std::atomic<uint64_t> decodeMicroseconds;
+
+	void StartLoad(const std::vector<std::string>& paths, ReadyCallback onReady);
+	void Decode(std::shared_ptr<PendingLoad> load, unsigned int index);
+	std::shared_ptr<RenderTexture> CreateTexture(const PendingLoad& load);
+};
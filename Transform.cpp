@@ -5,7 +5,8 @@ using namespace DirectX;
 Transform::Transform() :
 	position(0,0,0),
 	pitchYawRoll(0,0,0),
-	scale(1,1,1)
+	scale(1,1,1),
+	version(0)
 {
 	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
 	XMStoreFloat4x4(&worldInverseTranspose, XMMatrixIdentity());
@@ -21,6 +22,7 @@ void Transform::MoveAbsolute(float x, float y, float z)
 	XMVECTOR offset = XMVectorSet(x, y, z, 0);
 	XMStoreFloat3(&position, XMVectorAdd(start, offset));
 	matrixDirty = true;
+	version++;
 }
 
 void Transform::MoveRelative(float x, float y, float z)
@@ -34,6 +36,7 @@ void Transform::MoveRelative(float x, float y, float z)
 	// Add and store, and invalidate the matrices
 	XMStoreFloat3(&position, XMLoadFloat3(&position) + dir);
 	matrixDirty = true;
+	version++;
 }
 
 void Transform::Rotate(float p, float y, float r)
@@ -42,6 +45,7 @@ void Transform::Rotate(float p, float y, float r)
 	XMVECTOR offset = XMVectorSet(p, y, r, 0);
 	XMStoreFloat3(&pitchYawRoll, XMVectorAdd(start, offset));
 	matrixDirty = true;
+	version++;
 }
 
 void Transform::Scale(float x, float y, float z)
@@ -50,6 +54,7 @@ void Transform::Scale(float x, float y, float z)
 	XMVECTOR offset = XMVectorSet(x, y, z, 0);
 	XMStoreFloat3(&scale, XMVectorMultiply(start, offset));
 	matrixDirty = true;
+	version++;
 }
 
 // Setters
@@ -60,6 +65,7 @@ void Transform::SetPosition(float x, float y, float z)
 	position.y = y;
 	position.z = z;
 	matrixDirty = true;
+	version++;
 }
 
 void Transform::SetPitchYawRoll(float p, float y, float r)
@@ -68,6 +74,7 @@ void Transform::SetPitchYawRoll(float p, float y, float r)
 	pitchYawRoll.y = y;
 	pitchYawRoll.z = r;
 	matrixDirty = true;
+	version++;
 }
 
 void Transform::SetScale(float x, float y, float z)
@@ -76,6 +83,7 @@ void Transform::SetScale(float x, float y, float z)
 	scale.y = y;
 	scale.z = z;
 	matrixDirty = true;
+	version++;
 }
 
 DirectX::XMFLOAT3 Transform::GetPosition()
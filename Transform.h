@@ -34,6 +34,10 @@ public:
 	// Get the inverse transpose of the world matrix
 	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
 
+	// Goes up every time the transform changes, so anything
+	// cached from it can tell when it's out of date
+	unsigned int GetVersion() { return version; }
+
 private:
 	// Raw Transformation Data
 	DirectX::XMFLOAT3 position;
@@ -50,6 +54,7 @@ private:
 
 	bool matrixDirty;
 	bool vectorsDirty;
+	unsigned int version;
 
 	void UpdateVectors();
 };
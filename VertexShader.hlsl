@@ -39,7 +39,10 @@ VertexToPixel main( VertexShaderInput input )
 	matrix wvp = mul(projection, mul(view, world));
 	
 	// Here go the output values
-	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+	// - The position is precise, and computed exactly as in ShadowVS, so
+	//   the depth prepass and the main pass land on the same depths
+	precise float4 screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+	output.screenPosition = screenPosition;
 	output.uv = input.uv; // The uvs are just passing through here
 	output.normal = mul((float3x3)worldInvTrans, input.normal);
 	output.worldPosition = mul(world, float4(input.localPosition, 1.0f)).xyz;
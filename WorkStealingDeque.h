@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+// --------------------------------------------------------
+// A fixed-size Chase-Lev work-stealing deque of pointers
+//
+// - Only the owning thread may Push() and Pop(), which work
+//   on the bottom (newest) end, like a stack
+// - Any thread may Steal(), which takes from the top
+//   (oldest) end
+// - Push() fails when full instead of growing, so callers
+//   should have a fallback (like running the work inline)
+//
+// Memory orderings follow Le, Pop, Cohen & Zappa Nardelli,
+// "Correct and Efficient Work-Stealing for Weak Memory
+// Models" (PPoPP 2013)
+// --------------------------------------------------------
+template<typename T>
+class WorkStealingDeque
+{
+public:
+	// capacity - Rounded up to a power of two
+	WorkStealingDeque(unsigned int capacity = 4096)
+		:
+		top(0),
+		bottom(0)
+	{
+		size = 1;
+		while (size < capacity) size <<= 1;
+		mask = size - 1;
+		items.reset(new std::atomic<T*>[size]);
+		for (unsigned int i = 0; i < size; i++)
+			items[i].store(0, std::memory_order_relaxed);
+	}
+
+	// Owner only - Adds to the bottom, returns false if full
+	bool Push(T* item)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		if (b - t >= (int64_t)size)
+			return false;
+
+		items[b & mask].store(item, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Owner only - Takes from the bottom, returns null if empty
+	T* Pop()
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			// Empty - put bottom back
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return 0;
+		}
+
+		T* item = items[b & mask].load(std::memory_order_relaxed);
+		if (t == b)
+		{
+			// Last item - race the thieves for it
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				item = 0;
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	// Any thread - Takes from the top, returns null if empty or if another thread won the race
+	T* Steal()
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return 0;
+
+		T* item = items[t & mask].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return 0;
+		return item;
+	}
+
+	// Approximate when other threads are pushing or stealing
+	bool IsEmpty()
+	{
+		return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+	}
+
+private:
+	// Keep the two ends on separate cache lines, since they're written by different threads
+	alignas(64) std::atomic<int64_t> top;
+	alignas(64) std::atomic<int64_t> bottom;
+	std::unique_ptr<std::atomic<T*>[]> items;
+	unsigned int size;
+	unsigned int mask;
+};
+